@@ -0,0 +1,333 @@
+#region ================== Namespaces
+
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Runtime.InteropServices;
+using System.Text;
+using CodeImp.DoomBuilder.Config;
+using CodeImp.DoomBuilder.IO;
+
+#endregion
+
+namespace CodeImp.DoomBuilder.Compilers
+{
+	// Builds the nodes with the nodebuilder in BuilderNative instead of running an external program.
+	// The parameters select the node format: "vanilla", "extended" (XNOD) or "compressed" (ZNOD).
+	// UDMF maps always get GL nodes in the ZNODES lump, compressed unless "extended" is given.
+	internal sealed unsafe class NativeNodesCompiler : Compiler
+	{
+		#region ================== Constants
+
+		private const int DOOM_LINEDEF_SIZE = 14;
+		private const int HEXEN_LINEDEF_SIZE = 16;
+		private const int SIDEDEF_SIZE = 30;
+		private const int SECTOR_SIZE = 26;
+
+		#endregion
+
+		#region ================== Constructor / Disposer
+
+		// Constructor
+		public NativeNodesCompiler(CompilerInfo info) : base(info, false)
+		{
+			// We have no destructor
+			GC.SuppressFinalize(this);
+		}
+
+		#endregion
+
+		#region ================== Methods
+
+		// This builds the nodes for the map in the input file
+		public override bool Run()
+		{
+			string inputpath = Path.Combine(workingdir, inputfile);
+			string outputpath = Path.Combine(workingdir, outputfile);
+
+			General.WriteLogLine("Running native nodebuilder...");
+			General.WriteLogLine("Parameters: " + parameters);
+			long starttime = Clock.CurrentTime;
+
+			try
+			{
+				if(!string.Equals(inputpath, outputpath, StringComparison.OrdinalIgnoreCase))
+					File.Copy(inputpath, outputpath, true);
+
+				using(WAD wad = new WAD(outputpath))
+				{
+					BuildNodes(wad);
+				}
+			}
+			catch(Exception e)
+			{
+				ReportError(new CompilerError(e.Message));
+				General.WriteLogLine("Native nodebuilder failed: " + e.Message);
+				return false;
+			}
+
+			General.WriteLogLine("Compile time: " + ((Clock.CurrentTime - starttime) / 1000.0).ToString("########0.00") + " seconds");
+			return true;
+		}
+
+		// This builds the nodes for the first map in the WAD and adds them to it
+		private void BuildNodes(WAD wad)
+		{
+			if(wad.Lumps.Count == 0) throw new Exception("The build file contains no map");
+
+			List<NodeBuilderVertex> vertices = new List<NodeBuilderVertex>();
+			List<NodeBuilderLine> lines = new List<NodeBuilderLine>();
+			string options = parameters.ToLowerInvariant();
+			bool extended = options.Contains("extended");
+			bool compressed = options.Contains("compressed");
+
+			Lump textmap = wad.FindLump("TEXTMAP", 1);
+			if(textmap != null)
+			{
+				ReadUniversalMap(textmap, vertices, lines);
+				byte[][] lumps = Build(vertices, lines, extended ? NodeBuilderFormat.XGL3 : NodeBuilderFormat.ZGL3);
+				WriteLump(wad, "ZNODES", lumps[(int)NodeBuilderLump.Nodes]);
+			}
+			else
+			{
+				Lump sectors = wad.FindLump("SECTORS", 1);
+				int numsectors = (sectors != null ? sectors.Length / SECTOR_SIZE : 0);
+				ReadBinaryMap(wad, wad.FindLump("BEHAVIOR", 1) != null, vertices, lines);
+
+				NodeBuilderFormat format = (compressed ? NodeBuilderFormat.ZNOD : (extended ? NodeBuilderFormat.XNOD : NodeBuilderFormat.Vanilla));
+				byte[][] lumps = Build(vertices, lines, format);
+
+				// Extended nodes keep the original vertices and leave the vanilla lumps empty
+				if(format == NodeBuilderFormat.Vanilla) WriteLump(wad, "VERTEXES", lumps[(int)NodeBuilderLump.Vertexes]);
+				WriteLump(wad, "SEGS", lumps[(int)NodeBuilderLump.Segs]);
+				WriteLump(wad, "SSECTORS", lumps[(int)NodeBuilderLump.SubSectors]);
+				WriteLump(wad, "NODES", lumps[(int)NodeBuilderLump.Nodes]);
+
+				// An empty reject table allows every sector to see every other sector
+				WriteLump(wad, "REJECT", new byte[(numsectors * numsectors + 7) / 8]);
+				WriteLump(wad, "BLOCKMAP", lumps[(int)NodeBuilderLump.Blockmap]);
+			}
+
+			wad.WriteHeaders();
+		}
+
+		// This reads the vertices and lines from the Doom or Hexen map lumps
+		private static void ReadBinaryMap(WAD wad, bool hexenformat, List<NodeBuilderVertex> vertices, List<NodeBuilderLine> lines)
+		{
+			byte[] vertexdata = ReadLump(wad, "VERTEXES");
+			byte[] linedata = ReadLump(wad, "LINEDEFS");
+			byte[] sidedata = ReadLump(wad, "SIDEDEFS");
+
+			for(int i = 0; i + 4 <= vertexdata.Length; i += 4)
+				vertices.Add(new NodeBuilderVertex { X = BitConverter.ToInt16(vertexdata, i), Y = BitConverter.ToInt16(vertexdata, i + 2) });
+
+			int linesize = (hexenformat ? HEXEN_LINEDEF_SIZE : DOOM_LINEDEF_SIZE);
+			int sidesoffset = linesize - 4;
+			int numsides = sidedata.Length / SIDEDEF_SIZE;
+			for(int i = 0; i + linesize <= linedata.Length; i += linesize)
+			{
+				int front = BitConverter.ToUInt16(linedata, i + sidesoffset);
+				int back = BitConverter.ToUInt16(linedata, i + sidesoffset + 2);
+
+				NodeBuilderLine line = new NodeBuilderLine();
+				line.V1 = BitConverter.ToUInt16(linedata, i);
+				line.V2 = BitConverter.ToUInt16(linedata, i + 2);
+				line.FrontSector = (front < numsides ? BitConverter.ToUInt16(sidedata, front * SIDEDEF_SIZE + 28) : -1);
+				line.BackSector = (back < numsides ? BitConverter.ToUInt16(sidedata, back * SIDEDEF_SIZE + 28) : -1);
+				lines.Add(line);
+			}
+		}
+
+		// This reads the vertices and lines from the TEXTMAP lump
+		private static void ReadUniversalMap(Lump textmap, List<NodeBuilderVertex> vertices, List<NodeBuilderLine> lines)
+		{
+			UniversalParser parser = new UniversalParser();
+			byte[] data = new byte[textmap.Length];
+			textmap.Stream.Seek(0, SeekOrigin.Begin);
+			textmap.Stream.Read(data, 0, data.Length);
+			parser.InputConfiguration(data);
+			if(parser.ErrorResult != 0)
+				throw new Exception("Error on line " + parser.ErrorLine + " while parsing UDMF map data:\n" + parser.ErrorDescription);
+
+			List<int> sidesectors = new List<int>();
+			List<UniversalCollection> linedefs = new List<UniversalCollection>();
+			foreach(UniversalEntry e in parser.Root)
+			{
+				UniversalCollection c = e.Value as UniversalCollection;
+				if(c == null) continue;
+
+				switch(e.Key)
+				{
+					case "vertex":
+						vertices.Add(new NodeBuilderVertex { X = GetNumber(c, "x", 0.0), Y = GetNumber(c, "y", 0.0) });
+						break;
+
+					case "sidedef":
+						sidesectors.Add((int)GetNumber(c, "sector", -1));
+						break;
+
+					case "linedef":
+						linedefs.Add(c);
+						break;
+				}
+			}
+
+			// Sidedefs may come after the lines that use them
+			foreach(UniversalCollection c in linedefs)
+			{
+				int front = (int)GetNumber(c, "sidefront", -1);
+				int back = (int)GetNumber(c, "sideback", -1);
+
+				NodeBuilderLine line = new NodeBuilderLine();
+				line.V1 = (int)GetNumber(c, "v1", -1);
+				line.V2 = (int)GetNumber(c, "v2", -1);
+				line.FrontSector = (front >= 0 && front < sidesectors.Count ? sidesectors[front] : -1);
+				line.BackSector = (back >= 0 && back < sidesectors.Count ? sidesectors[back] : -1);
+				lines.Add(line);
+			}
+		}
+
+		// This returns a numeric UDMF field
+		private static double GetNumber(UniversalCollection c, string key, double defaultvalue)
+		{
+			foreach(UniversalEntry e in c)
+			{
+				if(e.Key != key) continue;
+				if(e.Value is int) return (int)e.Value;
+				if(e.Value is double) return (double)e.Value;
+			}
+			return defaultvalue;
+		}
+
+		// This returns the data of a map lump
+		private static byte[] ReadLump(WAD wad, string name)
+		{
+			Lump lump = wad.FindLump(name, 1);
+			if(lump == null) throw new Exception("The map has no " + name + " lump");
+
+			byte[] data = new byte[lump.Length];
+			lump.Stream.Seek(0, SeekOrigin.Begin);
+			lump.Stream.Read(data, 0, data.Length);
+			return data;
+		}
+
+		// This replaces a map lump, or adds it to the end of the map
+		private static void WriteLump(WAD wad, string name, byte[] data)
+		{
+			int index = wad.FindLumpIndex(name, 1);
+			if(index > -1)
+				wad.RemoveAt(index, false);
+			else
+				index = wad.FindLumpIndex("ENDMAP", 1);
+
+			if(index < 0) index = wad.Lumps.Count;
+
+			Lump lump = wad.Insert(name, index, data.Length, false);
+			lump.Stream.Seek(0, SeekOrigin.Begin);
+			lump.Stream.Write(data, 0, data.Length);
+		}
+
+		// This runs the native nodebuilder and returns the lumps it made
+		private static byte[][] Build(List<NodeBuilderVertex> vertices, List<NodeBuilderLine> lines, NodeBuilderFormat format)
+		{
+			IntPtr builder = NodeBuilder_New();
+			try
+			{
+				NodeBuilderVertex[] vertexarray = vertices.ToArray();
+				NodeBuilderLine[] linearray = lines.ToArray();
+				fixed(NodeBuilderVertex* vertexptr = vertexarray)
+				fixed(NodeBuilderLine* lineptr = linearray)
+				{
+					if(!NodeBuilder_Build(builder, vertexptr, vertexarray.Length, lineptr, linearray.Length, format))
+					{
+						StringBuilder sb = new StringBuilder(4096);
+						BuilderNative_GetError(sb, sb.Capacity);
+						throw new Exception(sb.ToString());
+					}
+				}
+
+				byte[][] lumps = new byte[(int)NodeBuilderLump.Count][];
+				for(int i = 0; i < lumps.Length; i++)
+					lumps[i] = GetLump(builder, (NodeBuilderLump)i);
+				return lumps;
+			}
+			finally
+			{
+				NodeBuilder_Delete(builder);
+			}
+		}
+
+		// This copies a lump out of the native nodebuilder
+		private static byte[] GetLump(IntPtr builder, NodeBuilderLump lump)
+		{
+			IntPtr data;
+			int size;
+			if(!NodeBuilder_GetLump(builder, lump, out data, out size))
+			{
+				StringBuilder sb = new StringBuilder(4096);
+				BuilderNative_GetError(sb, sb.Capacity);
+				throw new Exception(sb.ToString());
+			}
+
+			byte[] result = new byte[size];
+			if(size > 0) Marshal.Copy(data, result, 0, size);
+			return result;
+		}
+
+		#endregion
+
+		#region ================== Native
+
+		private enum NodeBuilderFormat : int
+		{
+			Vanilla,
+			XNOD,
+			ZNOD,
+			XGL3,
+			ZGL3
+		}
+
+		private enum NodeBuilderLump : int
+		{
+			Vertexes,
+			Segs,
+			SubSectors,
+			Nodes,
+			Blockmap,
+			Count
+		}
+
+		[StructLayout(LayoutKind.Sequential)]
+		private struct NodeBuilderVertex
+		{
+			public double X;
+			public double Y;
+		}
+
+		[StructLayout(LayoutKind.Sequential)]
+		private struct NodeBuilderLine
+		{
+			public int V1;
+			public int V2;
+			public int FrontSector;
+			public int BackSector;
+		}
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern IntPtr NodeBuilder_New();
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern void NodeBuilder_Delete(IntPtr builder);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern bool NodeBuilder_Build(IntPtr builder, NodeBuilderVertex* vertices, int numvertices, NodeBuilderLine* lines, int numlines, NodeBuilderFormat format);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern bool NodeBuilder_GetLump(IntPtr builder, NodeBuilderLump lump, out IntPtr data, out int size);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+		static extern void BuilderNative_GetError(StringBuilder str, int length);
+
+		#endregion
+	}
+}
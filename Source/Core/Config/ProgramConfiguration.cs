@@ -152,6 +152,9 @@ namespace CodeImp.DoomBuilder.Config
 		private bool classicRendering;
 		private bool flatShadeVertices;
 		private bool alwaysShowVertices;
+		private bool compactWorldVertices;
+		private bool threadedRendering;
+		private bool softwareRendering;
 
 		// These are not stored in the configuration, only used at runtime
 		private int defaultbrightness;
@@ -292,6 +295,12 @@ namespace CodeImp.DoomBuilder.Config
 
 		public bool AlwaysShowVertices {  get { return alwaysShowVertices; } internal set { alwaysShowVertices = value; } }
 
+		public bool CompactWorldVertices { get { return compactWorldVertices; } internal set { compactWorldVertices = value; } }
+
+		public bool ThreadedRendering { get { return threadedRendering; } internal set { threadedRendering = value; } }
+
+		public bool SoftwareRendering { get { return softwareRendering; } internal set { softwareRendering = value; } }
+
 		//mxd. Left here for compatibility reasons...
 		public string DefaultTexture { get { return General.Map != null ? General.Map.Options.DefaultWallTexture : "-"; } set { if(General.Map != null) General.Map.Options.DefaultWallTexture = value; } }
 		public string DefaultFloorTexture { get { return General.Map != null ? General.Map.Options.DefaultFloorTexture : "-"; } set { if(General.Map != null) General.Map.Options.DefaultFloorTexture = value; } }
@@ -436,6 +445,9 @@ namespace CodeImp.DoomBuilder.Config
 				classicRendering = cfg.ReadSetting("classicrendering", false);
 				alwaysShowVertices = cfg.ReadSetting("alwaysshowvertices", true);
 				flatShadeVertices = cfg.ReadSetting("flatshadevertices", false);
+				compactWorldVertices = cfg.ReadSetting("compactworldvertices", true);
+				threadedRendering = cfg.ReadSetting("threadedrendering", false);
+				softwareRendering = cfg.ReadSetting("softwarerendering", false);
 
 				//mxd. Sector defaults
 				defaultceilheight = cfg.ReadSetting("defaultceilheight", 128);
@@ -586,6 +598,9 @@ namespace CodeImp.DoomBuilder.Config
 			cfg.WriteSetting("classicrendering", classicRendering);
 			cfg.WriteSetting("alwaysshowvertices", alwaysShowVertices);
 			cfg.WriteSetting("flatshadevertices", flatShadeVertices);
+			cfg.WriteSetting("compactworldvertices", compactWorldVertices);
+			cfg.WriteSetting("threadedrendering", threadedRendering);
+			cfg.WriteSetting("softwarerendering", softwareRendering);
 
 			// Toasts
 			General.ToastManager.WriteSettings(cfg);
@@ -3543,12 +3543,7 @@ namespace CodeImp.DoomBuilder.Data
 				skyimage = ResizeImage(skyimage, (int)Math.Round(skyimage.Width * scaler), (int)Math.Round(skyimage.Height * scaler));
 			}
 
-			// Make custom rendertarget
 			const int cubemaptexsize = 1024;
-			Texture rendertarget = new Texture(cubemaptexsize, cubemaptexsize, TextureFormat.Rgba8);
-
-            // Start rendering
-            General.Map.Graphics.StartRendering(true, new Color4(), rendertarget, true);
 
 			// Load the skysphere model...
 			BoundingBoxSizes bbs = new BoundingBoxSizes();
@@ -3592,9 +3587,11 @@ namespace CodeImp.DoomBuilder.Data
             General.Map.Graphics.SetShader(ShaderName.world3d_fullbright);
             General.Map.Graphics.SetUniform(UniformName.fogsettings, new Vector4f(-1.0f));
 
-            // Render to the six faces of the cube map
+            // Render straight into the six faces of the cube map
             for (int i = 0; i < 6; i++)
 			{
+                General.Map.Graphics.StartRendering(true, new Color4(), cubemap, (CubeMapFace)i);
+
 				Matrix faceview = GetCubeMapViewMatrix((CubeMapFace)i);
                 General.Map.Graphics.SetUniform(UniformName.world, mworld);
                 General.Map.Graphics.SetUniform(UniformName.view, faceview);
@@ -3615,15 +3612,12 @@ namespace CodeImp.DoomBuilder.Data
 					// Render mesh
 					meshes.Meshes[j].Draw(General.Map.Graphics);
 				}
-
-                General.Map.Graphics.CopyTexture(cubemap, (CubeMapFace)i);
 			}
 
 			// End rendering
 			General.Map.Graphics.FinishRendering();
 
 			// Dispose unneeded stuff
-			rendertarget.Dispose();
 			textop.Dispose();
 			texside.Dispose();
 			texbottom.Dispose();
@@ -64,6 +64,7 @@ namespace CodeImp.DoomBuilder.Data
 					lumpdata.Seek(0, SeekOrigin.Begin);
 					lumpdata.Read(membytes, 0, (int)lumpdata.Length);
 				}
+				lumpdata.Dispose();
 					
 				MemoryStream mem = new MemoryStream(membytes);
 				mem.Seek(0, SeekOrigin.Begin);
@@ -135,6 +135,7 @@ namespace CodeImp.DoomBuilder.Data
 					data.Seek(0, SeekOrigin.Begin);
 					data.Read(membytes, 0, (int)data.Length);
 				}
+				data.Dispose();
 					
 				MemoryStream mem = new MemoryStream(membytes);
 				mem.Seek(0, SeekOrigin.Begin);
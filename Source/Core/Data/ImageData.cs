@@ -312,10 +312,7 @@ namespace CodeImp.DoomBuilder.Data
             // Do the loading
             LocalLoadResult loadResult = LocalLoadImage();
 
-            MakeUncorrectedImage(loadResult);
-            ConvertImageFormat(loadResult, usecolorcorrection);
-            MakeImagePreview(loadResult);
-            MakeAlphaTestImage(loadResult);
+            ProcessImage(loadResult, usecolorcorrection);
 
             // Save memory by disposing the original image immediately if we only used it to load a preview image
             bool onlyPreview = false;
@@ -489,28 +486,12 @@ namespace CodeImp.DoomBuilder.Data
 			{
 				width = bitmap.Size.Width;
 				height = bitmap.Size.Height;
-
-				// Do we still have to set a scale?
-				if((scale.x == 0.0f) && (scale.y == 0.0f))
-				{
-					if((General.Map != null) && (General.Map.Config != null))
-					{
-						scale.x = General.Map.Config.DefaultTextureScale;
-						scale.y = General.Map.Config.DefaultTextureScale;
-					}
-					else
-					{
-						scale.x = 1.0f;
-						scale.y = 1.0f;
-					}
-				}
+				SetDefaultScale();
 
 				if(!loadfailed)
 				{
 					//mxd. Check translucency and calculate average color?
-					if(General.Map != null && General.Map.Data != null && General.Map.Data.GlowingFlats != null &&
-						General.Map.Data.GlowingFlats.ContainsKey(longname) &&
-						General.Map.Data.GlowingFlats[longname].CalculateTextureColor)
+					if(NeedsGlowColor())
 					{
 						BitmapData bmpdata = null;
 						try
@@ -542,28 +523,7 @@ namespace CodeImp.DoomBuilder.Data
 							}
 
 							// Update glow data
-							int br = (int)(r / numpixels);
-							int bg = (int)(g / numpixels);
-							int bb = (int)(b / numpixels);
-
-							int max = Math.Max(br, Math.Max(bg, bb));
-
-							// Black can't glow...
-							if(max == 0)
-							{
-								General.Map.Data.GlowingFlats.Remove(longname);
-							}
-							else
-							{
-								// That's how it's done in GZDoom (and I may be totally wrong about this)
-								br = Math.Min(255, br * 153 / max);
-								bg = Math.Min(255, bg * 153 / max);
-								bb = Math.Min(255, bb * 153 / max);
-
-								General.Map.Data.GlowingFlats[longname].Color = new PixelColor(255, (byte)br, (byte)bg, (byte)bb);
-								General.Map.Data.GlowingFlats[longname].CalculateTextureColor = false;
-								if(!General.Map.Data.GlowingFlats[longname].Fullbright) General.Map.Data.GlowingFlats[longname].Brightness = (br + bg + bb) / 3;
-							}
+							UpdateGlowColor(r, g, b, numpixels);
 
 							// Release the data
 							bitmap.UnlockBits(bmpdata);
@@ -604,6 +564,106 @@ namespace CodeImp.DoomBuilder.Data
             loadResult.bitmap = bitmap;
 		}
 
+		// This sets the default scale when the image doesn't have one yet
+		private void SetDefaultScale()
+		{
+			if((scale.x == 0.0f) && (scale.y == 0.0f))
+			{
+				if((General.Map != null) && (General.Map.Config != null))
+				{
+					scale.x = General.Map.Config.DefaultTextureScale;
+					scale.y = General.Map.Config.DefaultTextureScale;
+				}
+				else
+				{
+					scale.x = 1.0f;
+					scale.y = 1.0f;
+				}
+			}
+		}
+
+		//mxd. This returns true when the average color is needed for a glowing flat
+		private bool NeedsGlowColor()
+		{
+			return General.Map != null && General.Map.Data != null && General.Map.Data.GlowingFlats != null &&
+				General.Map.Data.GlowingFlats.ContainsKey(longname) &&
+				General.Map.Data.GlowingFlats[longname].CalculateTextureColor;
+		}
+
+		// This updates the glowing flat color from the color sums of the image
+		private void UpdateGlowColor(uint r, uint g, uint b, int numpixels)
+		{
+			int br = (int)(r / numpixels);
+			int bg = (int)(g / numpixels);
+			int bb = (int)(b / numpixels);
+
+			int max = Math.Max(br, Math.Max(bg, bb));
+
+			// Black can't glow...
+			if(max == 0)
+			{
+				General.Map.Data.GlowingFlats.Remove(longname);
+			}
+			else
+			{
+				// That's how it's done in GZDoom (and I may be totally wrong about this)
+				br = Math.Min(255, br * 153 / max);
+				bg = Math.Min(255, bg * 153 / max);
+				bb = Math.Min(255, bb * 153 / max);
+
+				General.Map.Data.GlowingFlats[longname].Color = new PixelColor(255, (byte)br, (byte)bg, (byte)bb);
+				General.Map.Data.GlowingFlats[longname].CalculateTextureColor = false;
+				if(!General.Map.Data.GlowingFlats[longname].Fullbright) General.Map.Data.GlowingFlats[longname].Brightness = (br + bg + bb) / 3;
+			}
+		}
+
+		// This does the work of MakeUncorrectedImage, ConvertImageFormat, MakeImagePreview and MakeAlphaTestImage
+		// in one native pass. The loaded bitmap is kept as the uncorrected image instead of being copied.
+		private void ProcessImage(LocalLoadResult loadResult, bool withcolorcorrection)
+		{
+			Bitmap image = loadResult.bitmap;
+			if(image == null || image.PixelFormat != PixelFormat.Format32bppArgb)
+			{
+				MakeUncorrectedImage(loadResult);
+				ConvertImageFormat(loadResult, withcolorcorrection);
+				MakeImagePreview(loadResult);
+				MakeAlphaTestImage(loadResult);
+				return;
+			}
+
+			int imagewidth = image.Width;
+			int imageheight = image.Height;
+			int previewwidth, previewheight;
+			GetPreviewSize(imagewidth, imageheight, out previewwidth, out previewheight);
+
+			Bitmap corrected = new Bitmap(imagewidth, imageheight, PixelFormat.Format32bppArgb);
+			Bitmap preview = new Bitmap(previewwidth, previewheight, PixelFormat.Format32bppArgb);
+			int[] alphamask = new int[(imagewidth * imageheight + 31) / 32];
+			ImageDecoder.ImageStats stats = ImageDecoder.Process(image, withcolorcorrection ? General.Colors.CorrectionTable : null, corrected, preview, alphamask);
+
+			loadResult.uncorrected = image;
+			loadResult.bitmap = corrected;
+			loadResult.preview = preview;
+			loadResult.alphatestWidth = imagewidth;
+			loadResult.alphatestHeight = imageheight;
+			if(stats.Masked != 0)
+				loadResult.alphatest = new BitArray(alphamask) { Length = imagewidth * imageheight };
+
+			width = imagewidth;
+			height = imageheight;
+			SetDefaultScale();
+
+			if(!loadfailed)
+			{
+				if(stats.Translucent != 0) istranslucent = true;
+				if(stats.Masked != 0) ismasked = true;
+
+				//mxd. Calculate average color?
+				if(NeedsGlowColor())
+					UpdateGlowColor((uint)stats.Red, (uint)stats.Green, (uint)stats.Blue, imagewidth * imageheight);
+			}
+		}
+
         // Dimensions of a single preview image
         const int MAX_PREVIEW_SIZE = 256; //mxd
 
@@ -615,6 +675,18 @@ namespace CodeImp.DoomBuilder.Data
 	        loadResult.uncorrected = new Bitmap(loadResult.bitmap);
         }
 
+        // This determines the size of the preview image
+        private static void GetPreviewSize(int imagewidth, int imageheight, out int previewwidth, out int previewheight)
+        {
+            float scalex = (imagewidth > MAX_PREVIEW_SIZE) ? (MAX_PREVIEW_SIZE / (float)imagewidth) : 1.0f;
+            float scaley = (imageheight > MAX_PREVIEW_SIZE) ? (MAX_PREVIEW_SIZE / (float)imageheight) : 1.0f;
+            float scale = Math.Min(scalex, scaley);
+            previewwidth = (int)(imagewidth * scale);
+            previewheight = (int)(imageheight * scale);
+            if (previewwidth < 1) previewwidth = 1;
+            if (previewheight < 1) previewheight = 1;
+        }
+
         // This makes a preview for the given image and updates the image settings
         private void MakeImagePreview(LocalLoadResult loadResult)
         {
@@ -628,13 +700,8 @@ namespace CodeImp.DoomBuilder.Data
             int imageheight = image.Height;
 
             // Determine preview size
-            float scalex = (imagewidth > MAX_PREVIEW_SIZE) ? (MAX_PREVIEW_SIZE / (float)imagewidth) : 1.0f;
-            float scaley = (imageheight > MAX_PREVIEW_SIZE) ? (MAX_PREVIEW_SIZE / (float)imageheight) : 1.0f;
-            float scale = Math.Min(scalex, scaley);
-            int previewwidth = (int)(imagewidth * scale);
-            int previewheight = (int)(imageheight * scale);
-            if (previewwidth < 1) previewwidth = 1;
-            if (previewheight < 1) previewheight = 1;
+            int previewwidth, previewheight;
+            GetPreviewSize(imagewidth, imageheight, out previewwidth, out previewheight);
 
             //mxd. Expected and actual image sizes and format match?
             if (previewwidth == imagewidth && previewheight == imageheight && image.PixelFormat == PixelFormat.Format32bppArgb)
@@ -761,22 +828,13 @@ namespace CodeImp.DoomBuilder.Data
 
 		Bitmap CreateIndexedBitmap(Bitmap original, Playpal palette)
 		{
-			int[] indices = new int[original.Width * original.Height];
-			
 			Bitmap indexed = new Bitmap(original.Width, original.Height, PixelFormat.Format32bppArgb);
 			BitmapData indata = original.LockBits(new Rectangle(0, 0, original.Size.Width, original.Size.Height), ImageLockMode.ReadOnly, PixelFormat.Format32bppArgb);
 			PixelColor* inpixels = (PixelColor*)indata.Scan0.ToPointer();
-			General.Colors.QuantizeColorsToPlaypal(inpixels, indices, palette);
 
 			BitmapData outdata = indexed.LockBits(new Rectangle(0, 0, indexed.Size.Width, indexed.Size.Height), ImageLockMode.WriteOnly, PixelFormat.Format32bppArgb);
 			PixelColor *outpixels = (PixelColor*)outdata.Scan0.ToPointer();
-			for (int i = 0; i < indices.Length; i++)
-			{
-				outpixels[i].r = (byte)indices[i];
-				outpixels[i].g = 0;
-				outpixels[i].b = 0;
-				outpixels[i].a = inpixels[i].a;
-			}
+			General.Colors.QuantizeColorsToPlaypal(inpixels, outpixels, original.Width * original.Height, palette);
 			
 			original.UnlockBits(indata);
 			indexed.UnlockBits(outdata);
@@ -41,6 +41,7 @@ namespace CodeImp.DoomBuilder.Data
 		private /*readonly*/ Dictionary<string, byte[]> sevenzipentries; //mxd
 		private bool batchmode = true; //mxd
 		private FileStream filestream;
+		private NativeArchive nativearchive; // Read-only zip files are read in BuilderNative without SharpCompress
 
 		#endregion
 
@@ -103,45 +104,63 @@ namespace CodeImp.DoomBuilder.Data
             // Make list of all files
             List<DirectoryFileEntry> fileentries = new List<DirectoryFileEntry>();
 
-			// Take the detour with a FileStream because SharpCompress doesn't directly support opening files as read-only
-			filestream = File.Open(location.location, FileMode.OpenOrCreate, access, share);
+			// Read-only zip files don't need SharpCompress, unless they have entries the native reader can't read
+			if (isreadonly) nativearchive = OpenNativeArchive();
+			if (nativearchive != null)
+			{
+				archivetype = ArchiveType.Zip;
 
-			// Create archive
-			archive = ArchiveFactory.Open(filestream);
-            archivetype = archive.Type;
+				for (int i = 0; i < nativearchive.Count; i++)
+				{
+					if (nativearchive.IsDirectory(i)) continue;
 
-            // Random access of 7z archives works TERRIBLY slow in SharpCompress
-            if (archivetype == ArchiveType.SevenZip)
-            {
-                isreadonly = true; // Unsaveable...
-                sevenzipentries = new Dictionary<string, byte[]>(StringComparer.Ordinal);
+					string name = nativearchive.GetName(i);
+					if (CheckInvalidPathChars(name))
+						fileentries.Add(new DirectoryFileEntry(name));
+				}
+			}
+			else
+			{
+				// Take the detour with a FileStream because SharpCompress doesn't directly support opening files as read-only
+				filestream = File.Open(location.location, FileMode.OpenOrCreate, access, share);
 
-                IReader reader = archive.ExtractAllEntries();
-                while (reader.MoveToNextEntry())
-                {
-                    if (reader.Entry.IsDirectory || !CheckInvalidPathChars(reader.Entry.Key)) continue;
+				// Create archive
+				archive = ArchiveFactory.Open(filestream);
+				archivetype = archive.Type;
 
-                    MemoryStream s = new MemoryStream();
-                    reader.WriteEntryTo(s);
-                    sevenzipentries.Add(reader.Entry.Key.ToLowerInvariant(), s.ToArray());
-                    fileentries.Add(new DirectoryFileEntry(reader.Entry.Key));
-                }
-			}
-            else
-            {
-                foreach (IArchiveEntry entry in archive.Entries)
-                {
-                    if (!entry.IsDirectory && CheckInvalidPathChars(entry.Key))
-                        fileentries.Add(new DirectoryFileEntry(entry.Key));
-                }
-            }
+				// Random access of 7z archives works TERRIBLY slow in SharpCompress
+				if (archivetype == ArchiveType.SevenZip)
+				{
+					isreadonly = true; // Unsaveable...
+					sevenzipentries = new Dictionary<string, byte[]>(StringComparer.Ordinal);
 
-            // Get rid of archive
-            archive.Dispose();
-            archive = null;
+					IReader reader = archive.ExtractAllEntries();
+					while (reader.MoveToNextEntry())
+					{
+						if (reader.Entry.IsDirectory || !CheckInvalidPathChars(reader.Entry.Key)) continue;
 
-			filestream.Dispose();
-			filestream = null;
+						MemoryStream s = new MemoryStream();
+						reader.WriteEntryTo(s);
+						sevenzipentries.Add(reader.Entry.Key.ToLowerInvariant(), s.ToArray());
+						fileentries.Add(new DirectoryFileEntry(reader.Entry.Key));
+					}
+				}
+				else
+				{
+					foreach (IArchiveEntry entry in archive.Entries)
+					{
+						if (!entry.IsDirectory && CheckInvalidPathChars(entry.Key))
+							fileentries.Add(new DirectoryFileEntry(entry.Key));
+					}
+				}
+
+				// Get rid of archive
+				archive.Dispose();
+				archive = null;
+
+				filestream.Dispose();
+				filestream = null;
+			}
 
             // Make files list
             files = new DirectoryFilesList(dl.GetDisplayName(), config, Silent, fileentries);
@@ -175,6 +194,12 @@ namespace CodeImp.DoomBuilder.Data
 					archive = null;
 				}
 
+				if(nativearchive != null)
+				{
+					nativearchive.Dispose();
+					nativearchive = null;
+				}
+
 				if(filestream != null)
 				{
 					filestream.Dispose();
@@ -191,7 +216,7 @@ namespace CodeImp.DoomBuilder.Data
 		{
 			lock (this)
 			{
-				if (archivetype == ArchiveType.SevenZip) return;
+				if (archivetype == ArchiveType.SevenZip || nativearchive != null) return;
 
 				if (enable && archive == null)
 				{
@@ -232,6 +257,28 @@ namespace CodeImp.DoomBuilder.Data
 			}
 		}
 
+		// This opens the file as a native zip archive. Returns null when it isn't one,
+		// or when it has entries that are encrypted or compressed with something other than deflate.
+		private NativeArchive OpenNativeArchive()
+		{
+			NativeArchive na = NativeArchive.Open(location.location);
+			if (na == null) return null;
+
+			bool supported = (na.Format == NativeArchive.ArchiveFormat.Zip);
+			for (int i = 0; supported && i < na.Count; i++)
+			{
+				if (!na.IsDirectory(i) && !na.CanRead(i)) supported = false;
+			}
+
+			if (!supported)
+			{
+				na.Dispose();
+				return null;
+			}
+
+			return na;
+		}
+
         #endregion
 
         #region ================== Textures
@@ -258,7 +305,7 @@ namespace CodeImp.DoomBuilder.Data
 				if(FileExists(pname))
 				{
 					patchlocation = location.GetDisplayName();
-					return LoadFile(pname);
+					return LoadFileStream(pname);
 				}
 				return null;
 			}
@@ -272,7 +319,7 @@ namespace CodeImp.DoomBuilder.Data
 					if((filename != null) && FileExists(filename))
 					{
 						patchlocation = location.GetDisplayName();
-						return LoadFile(filename);
+						return LoadFileStream(filename);
 					}
 				}
 			}
@@ -283,7 +330,7 @@ namespace CodeImp.DoomBuilder.Data
 				if((filename != null) && FileExists(filename))
 				{
 					patchlocation = location.GetDisplayName();
-					return LoadFile(filename);
+					return LoadFileStream(filename);
 				}
 			}
 
@@ -313,7 +360,7 @@ namespace CodeImp.DoomBuilder.Data
 				if(FileExists(pname))
 				{
 					texturelocation = location.GetDisplayName();
-					return LoadFile(pname);
+					return LoadFileStream(pname);
 				}
 				return null;
 			}
@@ -323,7 +370,7 @@ namespace CodeImp.DoomBuilder.Data
 			if(!string.IsNullOrEmpty(filename) && FileExists(filename))
 			{
 				texturelocation = location.GetDisplayName();
-				return LoadFile(filename);
+				return LoadFileStream(filename);
 			}
 
 			// Nothing found
@@ -349,7 +396,7 @@ namespace CodeImp.DoomBuilder.Data
 			if(!string.IsNullOrEmpty(filename) && FileExists(filename))
 			{
 				hireslocation = location.GetDisplayName();
-				return LoadFile(filename);
+				return LoadFileStream(filename);
 			}
 
 			// Nothing found
@@ -405,7 +452,7 @@ namespace CodeImp.DoomBuilder.Data
 			if((filename != null) && FileExists(filename))
 			{
 				spritelocation = location.GetDisplayName(); //mxd
-				return LoadFile(filename);
+				return LoadFileStream(filename);
 			}
 
 			// Nothing found
@@ -595,6 +642,23 @@ namespace CodeImp.DoomBuilder.Data
 				fn = fn.ToLowerInvariant();
 				if(sevenzipentries.ContainsKey(fn)) filedata = new MemoryStream(sevenzipentries[fn]);
 			} 
+			else if(nativearchive != null)
+			{
+				// No lock needed, so entries are inflated on all threads that load resources at the same time
+				int index = FindNativeEntry(fn);
+				if(index != -1)
+				{
+					try
+					{
+						filedata = new MemoryStream(nativearchive.ReadAll(index));
+					}
+					catch(Exception e)
+					{
+						if (!Silent) General.ErrorLogger.Add(ErrorType.Error, "Cannot load the file \"" + filename + "\" from archive \"" + location.GetDisplayName() + "\". " + e.Message);
+						return null;
+					}
+				}
+			}
 			else 
 			{
 				lock (this)
@@ -654,6 +718,39 @@ namespace CodeImp.DoomBuilder.Data
 			return filedata;
 		}
 
+		// This returns a stream of the file in native memory when it is in a native zip archive.
+		// Otherwise it's the same as LoadFile. Callers are responsible for disposing the stream!
+		private Stream LoadFileStream(string filename)
+		{
+			if(nativearchive == null) return LoadFile(filename);
+
+			string fn = filename.Replace(Path.DirectorySeparatorChar, Path.AltDirectorySeparatorChar);
+			int index = FindNativeEntry(fn);
+			if(index == -1)
+			{
+				if (!Silent) General.ErrorLogger.Add(ErrorType.Error, "Cannot find the file \"" + filename + "\" in archive \"" + location.GetDisplayName() + "\".");
+				return null;
+			}
+
+			try
+			{
+				return nativearchive.OpenStream(index);
+			}
+			catch(Exception e)
+			{
+				if (!Silent) General.ErrorLogger.Add(ErrorType.Error, "Cannot load the file \"" + filename + "\" from archive \"" + location.GetDisplayName() + "\". " + e.Message);
+				return null;
+			}
+		}
+
+		// This finds the first file entry with the name in the native zip archive, returns -1 when not found
+		private int FindNativeEntry(string filename)
+		{
+			int index = nativearchive.Find(filename);
+			while(index != -1 && nativearchive.IsDirectory(index)) index = nativearchive.FindNext(index);
+			return index;
+		}
+
 		//mxd
 		internal override bool SaveFile(MemoryStream stream, string filename, int unused) { return SaveFile(stream, filename); }
 		internal override bool SaveFile(MemoryStream stream, string filename)
@@ -20,6 +20,8 @@ using System;
 using System.Drawing;
 using System.Drawing.Imaging;
 using System.IO;
+using System.Runtime.InteropServices;
+using System.Text;
 using CodeImp.DoomBuilder.Rendering;
 
 #endregion
@@ -36,6 +38,13 @@ namespace CodeImp.DoomBuilder.Data
 
 		private PixelColor[] colors;
 
+		// The colors as ARGB integers, for the native code
+		private int[] argbcolors;
+
+		// Native nearest color lookup, created on first use. It can be used by many loader threads at once.
+		private volatile IntPtr quantizer;
+		private readonly object quantizercreatelock = new object();
+
 		#endregion
 
 		#region ================== Properties
@@ -84,6 +93,16 @@ namespace CodeImp.DoomBuilder.Data
 			}
 		}
 
+		// Destructor
+		~Playpal()
+		{
+			if(quantizer != IntPtr.Zero)
+			{
+				PaletteQuantizer_Delete(quantizer);
+				quantizer = IntPtr.Zero;
+			}
+		}
+
 		#endregion
 
 		#region ================== Methods
@@ -123,6 +142,84 @@ namespace CodeImp.DoomBuilder.Data
 			return minIndex;
 		}
 
+		// This returns the colors as ARGB integers
+		internal int[] GetArgbColors()
+		{
+			if(argbcolors == null)
+			{
+				int[] result = new int[colors.Length];
+				for(int i = 0; i < colors.Length; i++) result[i] = colors[i].ToInt();
+				argbcolors = result;
+			}
+			return argbcolors;
+		}
+
+		// This finds the closest color for every pixel, like FindClosestColor does.
+		// The palette index goes into the red channel, alpha is kept.
+		internal unsafe void QuantizeColors(PixelColor* inpixels, PixelColor* outpixels, int count)
+		{
+			if(!PaletteQuantizer_Convert(GetQuantizer(), inpixels, outpixels, count))
+				ThrowNativeError();
+
+			// The finalizer deletes the quantizer, so this must stay alive until the call is done
+			GC.KeepAlive(this);
+		}
+
+		// This returns the native quantizer, creating it when this is the first call
+		private unsafe IntPtr GetQuantizer()
+		{
+			IntPtr result = quantizer;
+			if(result != IntPtr.Zero) return result;
+
+			lock(quantizercreatelock)
+			{
+				if(quantizer == IntPtr.Zero)
+				{
+					int[] palette = GetArgbColors();
+
+					// Only published once the palette is set, because that can't be done while other threads convert
+					result = PaletteQuantizer_New();
+					fixed(int* paletteptr = palette)
+					{
+						if(!PaletteQuantizer_SetPalette(result, paletteptr, palette.Length))
+						{
+							PaletteQuantizer_Delete(result);
+							ThrowNativeError();
+						}
+					}
+					quantizer = result;
+				}
+
+				return quantizer;
+			}
+		}
+
+		private static void ThrowNativeError()
+		{
+			StringBuilder sb = new StringBuilder(4096);
+			BuilderNative_GetError(sb, sb.Capacity);
+			throw new Exception(sb.ToString());
+		}
+
+		#endregion
+
+		#region ================== Native
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern IntPtr PaletteQuantizer_New();
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern void PaletteQuantizer_Delete(IntPtr quantizer);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern unsafe bool PaletteQuantizer_SetPalette(IntPtr quantizer, int* palette, int count);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern unsafe bool PaletteQuantizer_Convert(IntPtr quantizer, PixelColor* inpixels, PixelColor* outpixels, int count);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+		static extern void BuilderNative_GetError(StringBuilder str, int length);
+
 		#endregion
 	}
 }
@@ -76,6 +76,7 @@ namespace CodeImp.DoomBuilder.Data
 					patchdata.Seek(0, SeekOrigin.Begin);
 					patchdata.Read(membytes, 0, (int)patchdata.Length);
 				}
+				patchdata.Dispose();
 					
 				MemoryStream mem = new MemoryStream(membytes);
 				mem.Seek(0, SeekOrigin.Begin);
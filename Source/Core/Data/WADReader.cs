@@ -681,7 +681,7 @@ namespace CodeImp.DoomBuilder.Data
 			foreach(LumpRange range in patchranges) 
 			{
 				lump = file.FindLump(pname, range.start, range.end);
-				if(lump != null) return lump.GetSafeStream();
+				if(lump != null) return lump.GetArchiveStream();
 			}
 			
 			if(!strictpatches) 
@@ -693,7 +693,7 @@ namespace CodeImp.DoomBuilder.Data
 					if(lump != null)
 					{
 						patchlocation = location.GetDisplayName();
-						return lump.GetSafeStream();
+						return lump.GetArchiveStream();
 					}
 				}
 
@@ -704,7 +704,7 @@ namespace CodeImp.DoomBuilder.Data
 					if(lump != null)
 					{
 						patchlocation = location.GetDisplayName();
-						return lump.GetSafeStream();
+						return lump.GetArchiveStream();
 					}
 				}
 			}
@@ -726,7 +726,7 @@ namespace CodeImp.DoomBuilder.Data
 				if(lump != null)
 				{
 					texturelocation = location.GetDisplayName(); //mxd
-					return lump.GetSafeStream();
+					return lump.GetArchiveStream();
 				}
 			}
 
@@ -746,7 +746,7 @@ namespace CodeImp.DoomBuilder.Data
 				if(lump != null)
 				{
 					hireslocation = location.GetDisplayName();
-					return lump.GetSafeStream();
+					return lump.GetArchiveStream();
 				}
 			}
 
@@ -851,7 +851,7 @@ namespace CodeImp.DoomBuilder.Data
 				if(lump != null)
 				{
 					flatlocation = location.GetDisplayName(); //mxd
-                    return lump.GetSafeStream();
+                    return lump.GetArchiveStream();
 				}
 			}
 			
@@ -935,7 +935,7 @@ namespace CodeImp.DoomBuilder.Data
 				if(lump != null)
 				{
 					spritelocation = location.GetDisplayName(); //mxd
-					return lump.GetSafeStream(); // [ZZ] return duplicate MemoryStream, not direct WAD stream. hopefully reduces esoteric errors and crashes.
+					return lump.GetArchiveStream(); // [ZZ] do not return the direct WAD stream. hopefully reduces esoteric errors and crashes.
 				}
 			}
 
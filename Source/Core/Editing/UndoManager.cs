@@ -271,6 +271,11 @@ namespace CodeImp.DoomBuilder.Editing
 		// Background thread
 		private void BackgroundThread()
 		{
+			// Snapshots are packed against the last packed one, which
+			// is usually the one recorded right before
+			UndoSnapshot.PackedData lastpacked = null;
+			byte[] lastpackeddata = null;
+
 			while(true)
 			{
 				if(dobackgroundwork)
@@ -292,11 +297,11 @@ namespace CodeImp.DoomBuilder.Editing
 								break;
 						}
 
-						// Write to file or load from file, if needed
-						if(us.StoreOnDisk && !us.IsOnDisk)
-							us.WriteToFile();
-						else if(!us.StoreOnDisk && us.IsOnDisk)
-							us.RestoreFromFile();
+						// Pack or unpack, if needed
+						if(us.StorePacked && !us.IsPacked)
+							us.Pack(ref lastpacked, ref lastpackeddata);
+						else if(!us.StorePacked && us.IsPacked)
+							us.Unpack();
 
 						// Next
 						undolevel++;
@@ -314,11 +319,11 @@ namespace CodeImp.DoomBuilder.Editing
 								break;
 						}
 
-						// Write to file or load from file, if needed
-						if(us.StoreOnDisk && !us.IsOnDisk)
-							us.WriteToFile();
-						else if(!us.StoreOnDisk && us.IsOnDisk)
-							us.RestoreFromFile();
+						// Pack or unpack, if needed
+						if(us.StorePacked && !us.IsPacked)
+							us.Pack(ref lastpacked, ref lastpackeddata);
+						else if(!us.StorePacked && us.IsPacked)
+							us.Unpack();
 
 						// Next
 						redolevel++;
@@ -538,9 +543,9 @@ namespace CodeImp.DoomBuilder.Editing
 				{
 					lock(undos)
 					{
-						// The current top of the stack can now be written to disk
+						// The current top of the stack can now be packed
 						// because it is no longer the next immediate undo level
-						if(undos.Count > 0) undos[0].StoreOnDisk = true;
+						if(undos.Count > 0) undos[0].StorePacked = true;
 						
 						// Put it on the stack
 						undos.Insert(0, snapshot);
@@ -638,9 +643,9 @@ namespace CodeImp.DoomBuilder.Editing
 									// function and should go on the redo list
 									lock(redos)
 									{
-										// The current top of the stack can now be written to disk
+										// The current top of the stack can now be packed
 										// because it is no longer the next immediate redo level
-										if(redos.Count > 0) redos[0].StoreOnDisk = true;
+										if(redos.Count > 0) redos[0].StorePacked = true;
 											
 										// Put it on the stack
 										redos.Insert(0, snapshot);
@@ -667,9 +672,9 @@ namespace CodeImp.DoomBuilder.Editing
 										u = undos[0];
 										undos.RemoveAt(0);
 											
-										// Make the current top of the stack load into memory
+										// Make the current top of the stack unpack
 										// because it just became the next immediate undo level
-										if(undos.Count > 0) undos[0].StoreOnDisk = false;
+										if(undos.Count > 0) undos[0].StorePacked = false;
 									}
 									else
 									{
@@ -789,9 +794,9 @@ namespace CodeImp.DoomBuilder.Editing
 										// function and should go on the undo list
 										lock(undos)
 										{
-											// The current top of the stack can now be written to disk
+											// The current top of the stack can now be packed
 											// because it is no longer the next immediate undo level
-											if(undos.Count > 0) undos[0].StoreOnDisk = true;
+											if(undos.Count > 0) undos[0].StorePacked = true;
 
 											// Put it on the stack
 											undos.Insert(0, snapshot);
@@ -811,9 +816,9 @@ namespace CodeImp.DoomBuilder.Editing
 											r = redos[0];
 											redos.RemoveAt(0);
 											
-											// Make the current top of the stack load into memory
+											// Make the current top of the stack unpack
 											// because it just became the next immediate undo level
-											if(redos.Count > 0) redos[0].StoreOnDisk = false;
+											if(redos.Count > 0) redos[0].StorePacked = false;
 										}
 										else
 										{
@@ -18,7 +18,7 @@
 
 using System;
 using System.IO;
-using CodeImp.DoomBuilder.GZBuilder.Data; //mxd
+using CodeImp.DoomBuilder.IO;
 
 #endregion
 
@@ -26,14 +26,60 @@ namespace CodeImp.DoomBuilder.Editing
 {
 	public class UndoSnapshot : IDisposable
 	{
+		#region ================== Constants
+
+		// Packed snapshots are compressed against the data of the previously packed snapshot,
+		// which has to be unpacked first. This limits how many of those can be in a row.
+		private const int MAX_REFERENCE_DEPTH = 8;
+
+		// Don't compress against a reference that is much larger than the snapshot itself
+		private const int MAX_REFERENCE_SIZE_FACTOR = 4;
+		private const int MIN_REFERENCE_SIZE = 65536;
+
+		#endregion
+
+		#region ================== Packed data
+
+		// Compressed snapshot data. This stays alive for as long as other packed data
+		// refers to it, even when the snapshot it came from is already disposed.
+		internal sealed class PackedData
+		{
+			private readonly byte[] data;
+			private readonly int length;
+			private readonly PackedData reference;
+			private readonly int depth;
+
+			public int Length { get { return length; } }
+			public int Depth { get { return depth; } }
+
+			public PackedData(byte[] rawdata, int length, PackedData reference, byte[] referencedata)
+			{
+				this.length = length;
+				this.reference = reference;
+				this.depth = (reference != null) ? reference.depth + 1 : 0;
+				this.data = SnapshotCodec.Compress(rawdata, length, referencedata, (reference != null) ? reference.length : 0);
+			}
+
+			// This returns the uncompressed data
+			public byte[] Unpack()
+			{
+				byte[] referencedata = (reference != null) ? reference.Unpack() : null;
+				byte[] output = new byte[length];
+				SnapshotCodec.Decompress(data, data.Length, referencedata, (reference != null) ? reference.length : 0, output, length);
+				return output;
+			}
+		}
+
+		#endregion
+
 		#region ================== Variables
 
 		private MemoryStream recstream;
-		private string filename;
+		private PackedData packed;
 		private string description;
 		private readonly int ticketid;			// For safe withdrawing
-		private volatile bool storeondisk;
-		private volatile bool isondisk;
+		private volatile bool storepacked;
+		private volatile bool ispacked;
 		private bool isdisposed;
 		//private Dictionary<string, MemoryStream> customdata;
 		
@@ -43,8 +89,8 @@ namespace CodeImp.DoomBuilder.Editing
 
 		public string Description { get { return description; } set { description = value; } }
 		public int TicketID { get { return ticketid; } }
-		internal bool StoreOnDisk { get { return storeondisk; } set { storeondisk = value; } }
-		public bool IsOnDisk { get { return isondisk; } }
+		internal bool StorePacked { get { return storepacked; } set { storepacked = value; } }
+		public bool IsPacked { get { return ispacked; } }
 		
 		#endregion
 
@@ -57,7 +103,6 @@ namespace CodeImp.DoomBuilder.Editing
 			this.ticketid = ticketid;
 			this.description = description;
 			this.recstream = recstream;
-			this.filename = null;
 		}
 
 		// Constructor
@@ -67,7 +112,6 @@ namespace CodeImp.DoomBuilder.Editing
 			this.ticketid = info.ticketid;
 			this.description = info.description;
 			this.recstream = recstream;
-			this.filename = null;
 		}
 
 		// Disposer
@@ -78,8 +122,8 @@ namespace CodeImp.DoomBuilder.Editing
 				isdisposed = true;
 				if(recstream != null) recstream.Dispose();
 				recstream = null;
-				if(isondisk) File.Delete(filename);
-				isondisk = false;
+				packed = null;
+				ispacked = false;
 			}
 		}
 
@@ -92,61 +136,56 @@ namespace CodeImp.DoomBuilder.Editing
 		{
 			lock(this)
 			{
-				// Restore into memory if needed
-				if(isondisk) RestoreFromFile();
+				// Unpack if needed
+				if(ispacked) Unpack();
 				
 				// Return the buffer
 				return recstream;
 			}
 		}
 		
-		// This moves the snapshot from memory to harddisk
-		internal void WriteToFile()
+		// This compresses the snapshot in memory. The reference is the previously packed data and
+		// its uncompressed bytes, which are replaced by the ones of this snapshot when done.
+		internal void Pack(ref PackedData reference, ref byte[] referencedata)
 		{
 			lock(this)
 			{
 				if(isdisposed) return;
-				if(isondisk) return;
-				isondisk = true;
-				
-				// Compress data
-				recstream.Seek(0, SeekOrigin.Begin);
-				MemoryStream outstream = SharpCompressHelper.CompressStream(recstream); //mxd
-
-				// Make temporary file
-				filename = General.MakeTempFilename(General.Map.TempPath, "snapshot");
+				if(ispacked) return;
 
-				// Write data to file
-				File.WriteAllBytes(filename, outstream.ToArray());
+				// Compress data
+				byte[] data = recstream.ToArray();
+				int length = data.Length;
+				if((reference != null) && ((reference.Depth >= MAX_REFERENCE_DEPTH - 1) ||
+				   (reference.Length > Math.Max(length * MAX_REFERENCE_SIZE_FACTOR, MIN_REFERENCE_SIZE))))
+				{
+					reference = null;
+					referencedata = null;
+				}
+				packed = new PackedData(data, length, reference, referencedata);
+				ispacked = true;
 
 				// Remove data from memory
 				recstream.Dispose();
 				recstream = null;
-				outstream.Dispose();
+
+				reference = packed;
+				referencedata = data;
 			}
 		}
 
-		// This loads the snapshot from harddisk into memory
-		internal void RestoreFromFile()
+		// This decompresses the snapshot into memory
+		internal void Unpack()
 		{
 			lock(this)
 			{
 				if(isdisposed) return;
-				if(!isondisk) return;
-				isondisk = false;
+				if(!ispacked) return;
+				ispacked = false;
 
-				// Read the file data
-				MemoryStream instream = new MemoryStream(File.ReadAllBytes(filename));
-				
 				// Decompress data
-				MemoryStream outstream = SharpCompressHelper.DecompressStream(instream); //mxd
-				recstream = new MemoryStream(outstream.ToArray());
-				
-				// Clean up
-				instream.Dispose();
-				File.Delete(filename);
-				filename = null;
-				outstream.Dispose();
+				recstream = new MemoryStream(packed.Unpack());
+				packed = null;
 			}
 		}
 		
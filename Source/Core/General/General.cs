@@ -707,6 +707,9 @@ namespace CodeImp.DoomBuilder
 				// Initialize static classes
 				MapSet.Initialize();
 
+				// Pick the native render backend before any render resource is created
+				RenderDevice.SelectBackend();
+
 				// Create main window
 				General.WriteLogLine("Loading main interface window...");
 				mainwindow = new MainForm();
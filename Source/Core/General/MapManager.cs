@@ -626,12 +626,12 @@ namespace CodeImp.DoomBuilder
 						
 #if DEBUG
 						// Restore map
-						newmap.Deserialize(SharpCompressHelper.DecompressStream(new MemoryStream(File.ReadAllBytes(backuppath))));
+						newmap.Deserialize(ReadBackup(backuppath));
 #else
 						try
 						{
 							// Restore map
-							newmap.Deserialize(SharpCompressHelper.DecompressStream(new MemoryStream(File.ReadAllBytes(backuppath))));
+							newmap.Deserialize(ReadBackup(backuppath));
 
 							// Delete the backup
 							File.Delete(backuppath);
@@ -1206,7 +1206,7 @@ namespace CodeImp.DoomBuilder
 					// Export map
 					MemoryStream ms = map.Serialize();
 					ms.Seek(0, SeekOrigin.Begin);
-					File.WriteAllBytes(backuppath, SharpCompressHelper.CompressStream(ms).ToArray());
+					File.WriteAllBytes(backuppath, SnapshotCodec.CompressStream(ms).ToArray());
 
 					// Log it
 					General.WriteLogLine("Map backup saved to \"" + backuppath + "\"");
@@ -1226,6 +1226,16 @@ namespace CodeImp.DoomBuilder
 #endif
 		}
 
+		// This reads a map backup. Backups made by older versions are BZip2 compressed.
+		private static MemoryStream ReadBackup(string backuppath)
+		{
+			byte[] data = File.ReadAllBytes(backuppath);
+			if(SnapshotCodec.IsCompressedStream(data))
+				return SnapshotCodec.DecompressStream(data);
+			else
+				return SharpCompressHelper.DecompressStream(new MemoryStream(data));
+		}
+
 		#endregion
 
 		#region ================== Nodebuild
@@ -20,6 +20,8 @@ using System;
 using System.Collections.Generic;
 using CodeImp.DoomBuilder.Map;
 using System.Collections.ObjectModel;
+using System.Runtime.InteropServices;
+using System.Text;
 using CodeImp.DoomBuilder.IO;
 
 #endregion
@@ -91,6 +93,103 @@ namespace CodeImp.DoomBuilder.Geometry
 			return t;
 		}
 
+		// Constructor for many sectors at once. This uses the native triangulator,
+		// which spreads the sectors over all cores and gives the same results.
+		public static unsafe Triangulation[] Create(IList<Sector> sectors)
+		{
+			// Count the sidedefs
+			int numsides = 0;
+			foreach(Sector s in sectors) numsides += s.Sidedefs.Count;
+
+			// Flatten the sidedefs of all sectors
+			Sidedef[] sidedefslist = new Sidedef[numsides];
+			TriangulatorSide[] sides = new TriangulatorSide[numsides];
+			int[] firstside = new int[sectors.Count + 1];
+			int index = 0;
+			for(int i = 0; i < sectors.Count; i++)
+			{
+				Sector s = sectors[i];
+				firstside[i] = index;
+				foreach(Sidedef sd in s.Sidedefs)
+				{
+					Linedef ld = sd.Line;
+					Vertex from = sd.IsFront ? ld.Start : ld.End;
+
+					// The tracing visits the lines of a vertex in this order
+					int order = 0;
+					foreach(Linedef l in from.Linedefs)
+					{
+						if(l == ld) break;
+						order++;
+					}
+
+					sidedefslist[index] = sd;
+					sides[index].X1 = ld.Start.Position.x;
+					sides[index].Y1 = ld.Start.Position.y;
+					sides[index].X2 = ld.End.Position.x;
+					sides[index].Y2 = ld.End.Position.y;
+					sides[index].Angle = ld.Angle;
+					sides[index].Start = ld.Start.Index;
+					sides[index].End = ld.End.Index;
+					sides[index].Front = sd.IsFront ? 1 : 0;
+					sides[index].Skip = (sd.Other != null && sd.Other.Sector == s) ? 1 : 0;
+					sides[index].Order = order;
+					index++;
+				}
+			}
+			firstside[sectors.Count] = index;
+
+			Triangulation[] results = new Triangulation[sectors.Count];
+			IntPtr triangulator = Triangulator_New();
+			try
+			{
+				bool result;
+				fixed(TriangulatorSide* sidesptr = sides)
+				fixed(int* firstsideptr = firstside)
+				{
+					result = Triangulator_Run(triangulator, sidesptr, firstsideptr, sectors.Count);
+				}
+
+				if(!result)
+				{
+					StringBuilder sb = new StringBuilder(4096);
+					BuilderNative_GetError(sb, sb.Capacity);
+					throw new Exception(sb.ToString());
+				}
+
+				for(int i = 0; i < sectors.Count; i++)
+				{
+					int* islands, sideindices;
+					double* vertexdata;
+					int numislands, numvertices;
+					Triangulator_GetResult(triangulator, i, &islands, &numislands, &vertexdata, &sideindices, &numvertices);
+
+					int[] islandslist = new int[numislands];
+					for(int j = 0; j < numislands; j++) islandslist[j] = islands[j];
+
+					Vector2D[] verticeslist = new Vector2D[numvertices];
+					Sidedef[] sideslist = new Sidedef[numvertices];
+					for(int j = 0; j < numvertices; j++)
+					{
+						verticeslist[j] = new Vector2D(vertexdata[j * 2], vertexdata[j * 2 + 1]);
+						if(sideindices[j] >= 0) sideslist[j] = sidedefslist[firstside[i] + sideindices[j]];
+					}
+
+					Triangulation t = new Triangulation();
+					t.islandvertices = Array.AsReadOnly(islandslist);
+					t.vertices = Array.AsReadOnly(verticeslist);
+					t.sidedefs = Array.AsReadOnly(sideslist);
+					results[i] = t;
+				}
+			}
+			finally
+			{
+				Triangulator_Delete(triangulator);
+			}
+
+			return results;
+		}
+
 		// Constructor
 		public Triangulation()
 		{
@@ -966,5 +1065,37 @@ namespace CodeImp.DoomBuilder.Geometry
 		}
 		
 		#endregion
+
+		#region ================== Native
+
+		[StructLayout(LayoutKind.Sequential)]
+		private struct TriangulatorSide
+		{
+			public double X1, Y1, X2, Y2;
+			public double Angle;
+			public int Start;
+			public int End;
+			public int Front;
+			public int Skip;
+			public int Order;
+			public int Padding;
+		}
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern IntPtr Triangulator_New();
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern void Triangulator_Delete(IntPtr triangulator);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern unsafe bool Triangulator_Run(IntPtr triangulator, TriangulatorSide* sides, int* firstside, int numsectors);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern unsafe bool Triangulator_GetResult(IntPtr triangulator, int sector, int** islands, int* numislands, double** vertices, int** sides, int* numvertices);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+		static extern void BuilderNative_GetError(StringBuilder str, int length);
+
+		#endregion
 	}
 }
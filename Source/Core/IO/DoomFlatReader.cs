@@ -70,104 +70,19 @@ namespace CodeImp.DoomBuilder.IO
 		// Returns null on failure
 		public Bitmap ReadAsBitmap(Stream stream, out int offsetx, out int offsety)
 		{
-			offsetx = int.MinValue;
-			offsety = int.MinValue;
-
-			int width, height;
-			Bitmap bmp;
-
-			// Read pixel data
-			PixelColor[] pixeldata = ReadAsPixelData(stream, out width, out height);
-			if(pixeldata != null)
-			{
-				try
-				{
-					// Create bitmap and lock pixels
-					bmp = new Bitmap(width, height, PixelFormat.Format32bppArgb);
-					BitmapData bitmapdata = bmp.LockBits(new Rectangle(0, 0, width, height), ImageLockMode.WriteOnly, PixelFormat.Format32bppArgb);
-					PixelColor* targetdata = (PixelColor*)bitmapdata.Scan0.ToPointer();
-
-					//mxd. Copy the pixels
-					int size = pixeldata.Length - 1;
-					for(PixelColor* cp = targetdata + size; cp >= targetdata; cp--)
-						*cp = pixeldata[size--];
-
-					// Done
-					bmp.UnlockBits(bitmapdata);
-				}
-				catch(Exception e)
-				{
-					// Unable to make bitmap
-					General.ErrorLogger.Add(ErrorType.Error, "Unable to make Doom flat data. " + e.GetType().Name + ": " + e.Message);
-					return null;
-				}
-			}
-			else
-			{
-				// Failed loading picture
-				bmp = null;
-			}
-
-			// Return result
-			return bmp;
-		}
-
-		// This creates pixel color data from the given data
-		// Returns null on failure
-		private PixelColor[] ReadAsPixelData(Stream stream, out int width, out int height)
-		{
-			// Check if the flat is square
-			float sqrlength = (float)Math.Sqrt(stream.Length);
-			if(sqrlength == (float)Math.Truncate(sqrlength))
-			{
-				// Calculate image size
-				width = (int)sqrlength;
-				height = (int)sqrlength;
-			}
-			// Check if the data is more than 4096
-			else if(stream.Length > 4096)
-			{
-				// Image will be 64x64
-				width = 64;
-				height = 64;
-			}
-			else
-			{
-				// Invalid
-				width = 0;
-				height = 0;
-				return null;
-			}
-
-			#if !DEBUG
 			try
 			{
-			#endif
-			
-			// Valid width and height?
-			if((width <= 0) || (height <= 0)) return null;
-
-			// Allocate memory
-			PixelColor[] pixeldata = new PixelColor[width * height];
-
-			// Read flat bytes from stream
-			byte[] bytes = new byte[width * height];
-			stream.Read(bytes, 0, width * height);
-
-			// Convert bytes with palette
-			for(uint i = 0; i < width * height; i++) pixeldata[i] = palette[bytes[i]];
-
-			// Return pointer
-			return pixeldata;
-			
-			#if !DEBUG
+				// Decode natively
+				return ImageDecoder.Decode(stream, ImageDecoder.ImageDecoderFormat.DoomFlat, palette, out offsetx, out offsety);
 			}
-			catch(Exception)
+			catch(Exception e)
 			{
-				// Return nothing
+				// Unable to make bitmap
+				General.ErrorLogger.Add(ErrorType.Error, "Unable to make Doom flat data. " + e.GetType().Name + ": " + e.Message);
+				offsetx = int.MinValue;
+				offsety = int.MinValue;
 				return null;
 			}
-			#endif
 		}
 		
 		#endregion
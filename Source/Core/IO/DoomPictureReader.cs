@@ -90,135 +90,19 @@ namespace CodeImp.DoomBuilder.IO
 		// Returns null on failure
 		public Bitmap ReadAsBitmap(Stream stream, out int offsetx, out int offsety)
 		{
-			int width, height;
-			Bitmap bmp;
-
-			// Read pixel data
-			PixelColor[] pixeldata = ReadAsPixelData(stream, out width, out height, out offsetx, out offsety);
-			if(pixeldata != null)
-			{
-				// Create bitmap and lock pixels
-				try
-				{
-					bmp = new Bitmap(width, height, PixelFormat.Format32bppArgb);
-					BitmapData bitmapdata = bmp.LockBits(new Rectangle(0, 0, width, height), ImageLockMode.WriteOnly, PixelFormat.Format32bppArgb);
-					PixelColor* targetdata = (PixelColor*)bitmapdata.Scan0.ToPointer();
-
-					//mxd. Copy the pixels
-					int size = pixeldata.Length - 1;
-					for(PixelColor* cp = targetdata + size; cp >= targetdata; cp--)
-						*cp = pixeldata[size--];
-
-					// Done
-					bmp.UnlockBits(bitmapdata);
-				}
-				catch(Exception e)
-				{
-					// Unable to make bitmap
-					General.ErrorLogger.Add(ErrorType.Error, "Unable to make Doom picture data. " + e.GetType().Name + ": " + e.Message);
-					return null;
-				}
-			}
-			else
-			{
-				// Failed loading picture
-				bmp = null;
-			}
-
-			// Return result
-			return bmp;
-		}
-		
-		// This creates pixel color data from the given data
-		// Returns null on failure
-		private PixelColor[] ReadAsPixelData(Stream stream, out int width, out int height, out int offsetx, out int offsety)
-		{
-			BinaryReader reader = new BinaryReader(stream);
-
-			// Initialize
-			width = 0;
-			height = 0;
-			offsetx = 0;
-			offsety = 0;
-			int dataoffset = (int)stream.Position;
-
-			// Need at least 4 bytes
-			if((stream.Length - stream.Position) < 4) return null;
-			
-			#if !DEBUG
 			try
 			{
-			#endif
-			
-			// Read size and offset
-			width = reader.ReadInt16();
-			height = reader.ReadInt16();
-			offsetx = reader.ReadInt16();
-			offsety = reader.ReadInt16();
-			
-			// Valid width and height?
-			if((width <= 0) || (height <= 0)) return null;
-			
-			// Read the column addresses
-			int[] columns = new int[width];
-			for(int x = 0; x < width; x++) columns[x] = reader.ReadInt32();
-			
-			// Allocate memory
-			PixelColor[] pixeldata = new PixelColor[width * height];
-			
-			// Go for all columns
-			for(int x = 0; x < width; x++)
-			{
-				// Seek to column start
-				stream.Seek(dataoffset + columns[x], SeekOrigin.Begin);
-				
-				// Read first post start
-				int y = reader.ReadByte();
-				int read_y = y;
-				
-				// Continue while not end of column reached
-				while(read_y < 255)
-				{
-					// Read number of pixels in post
-					int count = reader.ReadByte();
-
-					// Skip unused pixel
-					stream.Seek(1, SeekOrigin.Current);
-
-					// Draw post
-					for(int yo = 0; yo < count; yo++)
-					{
-						// Read pixel color index
-						int p = reader.ReadByte();
-
-						//mxd. Sanity check required...
-						int offset = (y + yo) * width + x;
-						if(offset > pixeldata.Length - 1) return null;
-
-						// Draw pixel
-						pixeldata[offset] = palette[p];
-					}
-
-					// Skip unused pixel
-					stream.Seek(1, SeekOrigin.Current);
-
-					// Read next post start
-					read_y = reader.ReadByte();
-					if(read_y < y || (height > 256 && read_y == y)) y += read_y; else y = read_y; //mxd. Fix for tall patches higher than 508 pixels
-				}
-			}
-
-			// Return pointer
-			return pixeldata;
-			
-			#if !DEBUG
+				// Decode natively
+				return ImageDecoder.Decode(stream, ImageDecoder.ImageDecoderFormat.DoomPicture, palette, out offsetx, out offsety);
 			}
-			catch(Exception)
+			catch(Exception e)
 			{
-				// Return nothing
+				// Unable to make bitmap
+				General.ErrorLogger.Add(ErrorType.Error, "Unable to make Doom picture data. " + e.GetType().Name + ": " + e.Message);
+				offsetx = int.MinValue;
+				offsety = int.MinValue;
 				return null;
 			}
-			#endif
 		}
 		
 		#endregion
@@ -575,6 +575,16 @@ namespace CodeImp.DoomBuilder.IO
 
         public Bitmap ReadAsBitmap(Stream stream, out int offsetx, out int offsety)
         {
+            // Most PNGs can be decoded natively. The rest, like those with color profiles, go through the framework.
+            if (isPng)
+            {
+                long position = stream.Position;
+                Bitmap bitmap = ImageDecoder.Decode(stream, ImageDecoder.ImageDecoderFormat.PNG, null, out offsetx, out offsety);
+                if (bitmap != null)
+                    return bitmap;
+                stream.Position = position;
+            }
+
             using (var image = Image.FromStream(new NoCloseStream(stream)))
             {
                 ReadPngOffsets(stream, out offsetx, out offsety);
@@ -0,0 +1,163 @@
+#region ================== Namespaces
+
+using System;
+using System.Drawing;
+using System.Drawing.Imaging;
+using System.IO;
+using System.Runtime.InteropServices;
+using System.Text;
+using CodeImp.DoomBuilder.Data;
+using CodeImp.DoomBuilder.Rendering;
+
+#endregion
+
+namespace CodeImp.DoomBuilder.IO
+{
+	// Decodes Doom pictures, flats and PNG files in BuilderNative
+	internal static unsafe class ImageDecoder
+	{
+		#region ================== Methods
+
+		// This decodes the remaining data of the stream into a 32 bits ARGB bitmap.
+		// Returns null when the data can't be decoded. The palette is not used for PNG files.
+		public static Bitmap Decode(Stream stream, ImageDecoderFormat format, Playpal palette, out int offsetx, out int offsety)
+		{
+			// Entries of native archives can be decoded where they are
+			UnmanagedMemoryStream unmanaged = stream as UnmanagedMemoryStream;
+			if(unmanaged != null)
+			{
+				byte* position = unmanaged.PositionPointer;
+				int remaining = (int)(unmanaged.Length - unmanaged.Position);
+				unmanaged.Position = unmanaged.Length;
+
+				Bitmap bmp = Decode(position, remaining, format, palette, out offsetx, out offsety);
+				GC.KeepAlive(unmanaged);
+				return bmp;
+			}
+
+			byte[] data = new byte[stream.Length - stream.Position];
+			int length = 0;
+			while(length < data.Length)
+			{
+				int count = stream.Read(data, length, data.Length - length);
+				if(count == 0) break;
+				length += count;
+			}
+
+			fixed(byte* dataptr = data)
+			{
+				return Decode(dataptr, length, format, palette, out offsetx, out offsety);
+			}
+		}
+
+		private static Bitmap Decode(byte* data, int length, ImageDecoderFormat format, Playpal palette, out int offsetx, out int offsety)
+		{
+			offsetx = int.MinValue;
+			offsety = int.MinValue;
+
+			IntPtr decoder = ImageDecoder_New();
+			try
+			{
+				int[] colors = (palette != null) ? palette.GetArgbColors() : null;
+
+				bool result;
+				fixed(int* paletteptr = colors)
+				{
+					result = ImageDecoder_Decode(decoder, format, data, length, paletteptr);
+				}
+				if(!result) return null;
+
+				int width, height;
+				ImageDecoder_GetInfo(decoder, out width, out height, out offsetx, out offsety);
+
+				Bitmap bmp = new Bitmap(width, height, PixelFormat.Format32bppArgb);
+				BitmapData bmpdata = bmp.LockBits(new Rectangle(0, 0, width, height), ImageLockMode.WriteOnly, PixelFormat.Format32bppArgb);
+				ImageDecoder_CopyPixels(decoder, (PixelColor*)bmpdata.Scan0.ToPointer());
+				bmp.UnlockBits(bmpdata);
+				return bmp;
+			}
+			finally
+			{
+				ImageDecoder_Delete(decoder);
+			}
+		}
+
+		// This makes the color corrected image, the preview and the alpha test mask of a 32 bits ARGB image in one pass.
+		// The correction table may be null. Returns the sums of the color channels and the alpha information.
+		public static ImageStats Process(Bitmap image, byte[] correction, Bitmap corrected, Bitmap preview, int[] alphamask)
+		{
+			Rectangle rect = new Rectangle(0, 0, image.Width, image.Height);
+			Rectangle previewrect = new Rectangle(0, 0, preview.Width, preview.Height);
+			BitmapData imagedata = image.LockBits(rect, ImageLockMode.ReadOnly, PixelFormat.Format32bppArgb);
+			BitmapData correcteddata = corrected.LockBits(rect, ImageLockMode.WriteOnly, PixelFormat.Format32bppArgb);
+			BitmapData previewdata = preview.LockBits(previewrect, ImageLockMode.WriteOnly, PixelFormat.Format32bppArgb);
+
+			ImageStats stats;
+			bool result;
+			fixed(byte* correctionptr = correction)
+			fixed(int* alphamaskptr = alphamask)
+			{
+				result = ImageDecoder_Process((PixelColor*)imagedata.Scan0.ToPointer(), image.Width, image.Height, correctionptr,
+					(PixelColor*)correcteddata.Scan0.ToPointer(), (PixelColor*)previewdata.Scan0.ToPointer(), preview.Width, preview.Height,
+					alphamaskptr, out stats);
+			}
+
+			image.UnlockBits(imagedata);
+			corrected.UnlockBits(correcteddata);
+			preview.UnlockBits(previewdata);
+
+			if(!result)
+			{
+				StringBuilder sb = new StringBuilder(4096);
+				BuilderNative_GetError(sb, sb.Capacity);
+				throw new Exception(sb.ToString());
+			}
+
+			return stats;
+		}
+
+		#endregion
+
+		#region ================== Native
+
+		public enum ImageDecoderFormat : int
+		{
+			DoomPicture,
+			DoomFlat,
+			PNG
+		}
+
+		[StructLayout(LayoutKind.Sequential)]
+		public struct ImageStats
+		{
+			public ulong Red;
+			public ulong Green;
+			public ulong Blue;
+			public int Translucent;
+			public int Masked;
+		}
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern IntPtr ImageDecoder_New();
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern void ImageDecoder_Delete(IntPtr decoder);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern bool ImageDecoder_Decode(IntPtr decoder, ImageDecoderFormat format, byte* data, int size, int* palette);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern void ImageDecoder_GetInfo(IntPtr decoder, out int width, out int height, out int offsetx, out int offsety);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern void ImageDecoder_CopyPixels(IntPtr decoder, PixelColor* dest);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern bool ImageDecoder_Process(PixelColor* pixels, int width, int height, byte* correction, PixelColor* corrected, PixelColor* preview, int previewwidth, int previewheight, int* alphamask, out ImageStats stats);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+		static extern void BuilderNative_GetError(StringBuilder str, int length);
+
+		#endregion
+	}
+}
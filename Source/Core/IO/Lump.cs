@@ -41,6 +41,10 @@ namespace CodeImp.DoomBuilder.IO
 		
 		// Data stream
 		private readonly ClippedStream stream;
+
+		// Native archive of the wad this lump can be read from without locking, or null
+		private readonly NativeArchive archive;
+		private readonly int index;
 		
 		// Data info
 		private string name;
@@ -71,10 +75,17 @@ namespace CodeImp.DoomBuilder.IO
 		#region ================== Constructor / Disposer
 
 		// Constructor
-		internal Lump(Stream data, WAD owner, byte[] fixedname, int offset, int length)
+		internal Lump(Stream data, WAD owner, byte[] fixedname, int offset, int length) : this(data, owner, fixedname, offset, length, null, -1)
+		{
+		}
+
+		// Constructor for lumps of read-only wads, which are also read from the native archive
+		internal Lump(Stream data, WAD owner, byte[] fixedname, int offset, int length, NativeArchive archive, int index)
 		{
 			// Initialize
 			this.stream = new ClippedStream(data, offset, length);
+			this.archive = archive;
+			this.index = index;
 			this.owner = owner;
 			this.fixedname = fixedname;
 			this.offset = offset;
@@ -208,6 +219,10 @@ namespace CodeImp.DoomBuilder.IO
             if (stream == null || stream.BaseStream == null)
                 return null;
 
+            // Lumps in a native archive can be copied without the lock
+            if (archive != null)
+                return new MemoryStream(archive.ReadAll(index));
+
             // create new stream. do NOT return the WAD stream. This causes problems with multithreading, and other readers create a MemoryStream.
             byte[] data;
             lock (stream.BaseStream)
@@ -220,6 +235,17 @@ namespace CodeImp.DoomBuilder.IO
             ms.Position = 0;
             return ms;
         }
+
+        // This returns a read-only stream of the lump data in native memory, which saves copying it into a managed array.
+        // Lumps of wads that are not opened as a native archive get a stream from GetSafeStream instead.
+        // Callers should dispose the stream, which gives its native buffer back.
+        internal Stream GetArchiveStream()
+        {
+            if (archive != null)
+                return archive.OpenStream(index);
+
+            return GetSafeStream();
+        }
 		
 		#endregion
 	}
@@ -0,0 +1,313 @@
+#region ================== Namespaces
+
+using System;
+using System.IO;
+using System.Runtime.InteropServices;
+using System.Text;
+using System.Threading;
+
+#endregion
+
+namespace CodeImp.DoomBuilder.IO
+{
+	// A read-only WAD or zip file that is read in BuilderNative. Entries are found with a hash table instead of
+	// searching, and all reading methods can be used from many threads at once. The file is not mapped into memory
+	// and stays open with all sharing allowed, so other programs can still save or delete it while it is loaded.
+	internal sealed unsafe class NativeArchive : IDisposable
+	{
+		#region ================== Constants
+
+		private const int ENTRY_DIRECTORY = 1;
+		private const int ENTRY_UNSUPPORTED = 4;
+
+		#endregion
+
+		#region ================== Variables
+
+		private IntPtr handle;
+
+		// The archive is closed when this reaches 0. Every open entry stream and every call in progress has a reference,
+		// so that disposing while other threads are still reading throws instead of reading from a closed file.
+		private int refcount = 1;
+		private bool isdisposed;
+
+		#endregion
+
+		#region ================== Properties
+
+		public ArchiveFormat Format { get { AddRef(); try { return Archive_GetFormat(handle); } finally { Release(); } } }
+		public int Count { get { AddRef(); try { return Archive_GetCount(handle); } finally { Release(); } } }
+		public bool IsDisposed { get { return isdisposed; } }
+
+		#endregion
+
+		#region ================== Constructor / Disposer
+
+		private NativeArchive(IntPtr handle)
+		{
+			this.handle = handle;
+		}
+
+		// This opens a WAD or zip file. Returns null when it isn't one or can't be opened, so that callers can fall back to reading it themselves.
+		public static NativeArchive Open(string filename)
+		{
+			IntPtr handle;
+			fixed(byte* filenameptr = ToUTF8(filename))
+			{
+				handle = Archive_Open(filenameptr);
+			}
+
+			return (handle != IntPtr.Zero) ? new NativeArchive(handle) : null;
+		}
+
+		// Disposer. The file stays open until all streams from OpenStream are disposed as well.
+		public void Dispose()
+		{
+			if(!isdisposed)
+			{
+				isdisposed = true;
+				Release();
+			}
+		}
+
+		private void AddRef()
+		{
+			while(true)
+			{
+				int count = refcount;
+				if(count == 0) throw new ObjectDisposedException("NativeArchive");
+				if(Interlocked.CompareExchange(ref refcount, count + 1, count) == count) return;
+			}
+		}
+
+		private void Release()
+		{
+			if(Interlocked.Decrement(ref refcount) == 0)
+			{
+				Archive_Close(handle);
+				handle = IntPtr.Zero;
+			}
+		}
+
+		#endregion
+
+		#region ================== Methods
+
+		// This returns the name of an entry. Zip entries have their full path.
+		public string GetName(int index)
+		{
+			AddRef();
+			try
+			{
+				ArchiveEntryInfo info = GetEntry(index);
+				int length = 0;
+				while(info.Name[length] != 0) length++;
+				return Encoding.UTF8.GetString(info.Name, length);
+			}
+			finally
+			{
+				Release();
+			}
+		}
+
+		// This returns the uncompressed size of an entry
+		public long GetLength(int index)
+		{
+			AddRef();
+			try { return GetEntry(index).Size; }
+			finally { Release(); }
+		}
+
+		// This returns true when the entry is a folder of a zip file
+		public bool IsDirectory(int index)
+		{
+			AddRef();
+			try { return (GetEntry(index).Flags & ENTRY_DIRECTORY) != 0; }
+			finally { Release(); }
+		}
+
+		// This returns false for entries that are encrypted, compressed with anything other than deflate, or outside the file
+		public bool CanRead(int index)
+		{
+			AddRef();
+			try { return (GetEntry(index).Flags & ENTRY_UNSUPPORTED) == 0; }
+			finally { Release(); }
+		}
+
+		// This finds the first entry with the name, ignoring case and slash direction. Returns -1 when not found.
+		public int Find(string name)
+		{
+			AddRef();
+			try
+			{
+				fixed(byte* nameptr = ToUTF8(name))
+				{
+					return Archive_Find(handle, nameptr);
+				}
+			}
+			finally
+			{
+				Release();
+			}
+		}
+
+		// This returns the next entry with the same name as the given one, or -1 when there are no more
+		public int FindNext(int index)
+		{
+			AddRef();
+			try { return Archive_FindNext(handle, index); }
+			finally { Release(); }
+		}
+
+		// This reads the entire entry into a new array
+		public byte[] ReadAll(int index)
+		{
+			AddRef();
+			try
+			{
+				byte[] data = new byte[GetEntry(index).Size];
+
+				bool result;
+				fixed(byte* dataptr = data)
+				{
+					result = Archive_Read(handle, index, dataptr, data.LongLength);
+				}
+				if(!result) ThrowNativeError();
+
+				return data;
+			}
+			finally
+			{
+				Release();
+			}
+		}
+
+		// This returns a read-only stream of the entry, which is read or inflated into a pooled native buffer.
+		// The stream must be disposed to give the buffer back.
+		public Stream OpenStream(int index)
+		{
+			AddRef();
+
+			byte* data;
+			long size;
+			IntPtr buffer;
+			if(!Archive_Acquire(handle, index, out data, out size, out buffer))
+			{
+				Release();
+				ThrowNativeError();
+			}
+
+			return new ArchiveEntryStream(this, data, size, buffer);
+		}
+
+		private ArchiveEntryInfo GetEntry(int index)
+		{
+			ArchiveEntryInfo info;
+			if(!Archive_GetEntry(handle, index, out info)) ThrowNativeError();
+			return info;
+		}
+
+		private static byte[] ToUTF8(string str)
+		{
+			byte[] bytes = new byte[Encoding.UTF8.GetByteCount(str) + 1];
+			Encoding.UTF8.GetBytes(str, 0, str.Length, bytes, 0);
+			return bytes;
+		}
+
+		private static void ThrowNativeError()
+		{
+			StringBuilder sb = new StringBuilder(4096);
+			BuilderNative_GetError(sb, sb.Capacity);
+			throw new Exception(sb.ToString());
+		}
+
+		#endregion
+
+		#region ================== Entry stream
+
+		// Keeps the archive open and the data alive until it is disposed
+		private sealed class ArchiveEntryStream : UnmanagedMemoryStream
+		{
+			private NativeArchive archive;
+			private IntPtr buffer;
+
+			public ArchiveEntryStream(NativeArchive archive, byte* data, long size, IntPtr buffer) : base(data, size)
+			{
+				this.archive = archive;
+				this.buffer = buffer;
+			}
+
+			~ArchiveEntryStream()
+			{
+				Dispose(false);
+			}
+
+			protected override void Dispose(bool disposing)
+			{
+				NativeArchive owner = Interlocked.Exchange(ref archive, null);
+				if(owner != null)
+				{
+					if(buffer != IntPtr.Zero) Archive_ReleaseBuffer(buffer);
+					buffer = IntPtr.Zero;
+					owner.Release();
+					GC.SuppressFinalize(this);
+				}
+
+				base.Dispose(disposing);
+			}
+		}
+
+		#endregion
+
+		#region ================== Native
+
+		public enum ArchiveFormat : int
+		{
+			WAD,
+			Zip
+		}
+
+		[StructLayout(LayoutKind.Sequential)]
+		private struct ArchiveEntryInfo
+		{
+			public byte* Name;
+			public long Size;
+			public int Flags;
+		}
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern IntPtr Archive_Open(byte* filename);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern void Archive_Close(IntPtr archive);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern ArchiveFormat Archive_GetFormat(IntPtr archive);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern int Archive_GetCount(IntPtr archive);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern bool Archive_GetEntry(IntPtr archive, int index, out ArchiveEntryInfo info);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern int Archive_Find(IntPtr archive, byte* name);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern int Archive_FindNext(IntPtr archive, int index);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern bool Archive_Read(IntPtr archive, int index, byte* dst, long size);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern bool Archive_Acquire(IntPtr archive, int index, out byte* data, out long size, out IntPtr buffer);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern void Archive_ReleaseBuffer(IntPtr buffer);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+		static extern void BuilderNative_GetError(StringBuilder str, int length);
+
+		#endregion
+	}
+}
@@ -0,0 +1,132 @@
+#region ================== Namespaces
+
+using System;
+using System.IO;
+using System.Runtime.InteropServices;
+using System.Text;
+
+#endregion
+
+namespace CodeImp.DoomBuilder.IO
+{
+	// Fast compression in BuilderNative, used for undo snapshots and map backups. Data can be
+	// compressed against a reference, which makes everything it has in common with it almost free.
+	internal static unsafe class SnapshotCodec
+	{
+		#region ================== Constants
+
+		// Start of a compressed stream, followed by the uncompressed length
+		private const int STREAM_SIGNATURE = 0x7A534455; // "UDSz"
+
+		#endregion
+
+		#region ================== Methods
+
+		// This compresses the first length bytes of data. The reference may be null.
+		public static byte[] Compress(byte[] data, int length, byte[] reference, int referencelength)
+		{
+			if(length > data.Length) throw new ArgumentOutOfRangeException("length");
+			if(referencelength > ((reference != null) ? reference.Length : 0)) throw new ArgumentOutOfRangeException("referencelength");
+
+			byte[] packed = new byte[SnapshotCodec_CompressBound(length)];
+			int written;
+			bool result;
+			fixed(byte* dataptr = data)
+			fixed(byte* referenceptr = reference)
+			fixed(byte* packedptr = packed)
+			{
+				result = SnapshotCodec_Compress(dataptr, length, referenceptr, referencelength, packedptr, packed.Length, out written);
+			}
+			if(!result) ThrowNativeError();
+
+			Array.Resize(ref packed, written);
+			return packed;
+		}
+
+		// This decompresses into the first length bytes of output. The reference must be the same as the data was compressed with.
+		public static void Decompress(byte[] packed, int packedlength, byte[] reference, int referencelength, byte[] output, int length)
+		{
+			if(packedlength > packed.Length) throw new ArgumentOutOfRangeException("packedlength");
+			if(referencelength > ((reference != null) ? reference.Length : 0)) throw new ArgumentOutOfRangeException("referencelength");
+			if(length > output.Length) throw new ArgumentOutOfRangeException("length");
+
+			bool result;
+			fixed(byte* packedptr = packed)
+			fixed(byte* referenceptr = reference)
+			fixed(byte* outputptr = output)
+			{
+				result = SnapshotCodec_Decompress(packedptr, packedlength, referenceptr, referencelength, outputptr, length);
+			}
+			if(!result) ThrowNativeError();
+		}
+
+		// This compresses the remaining data of the stream into a new stream with a header
+		public static MemoryStream CompressStream(Stream stream)
+		{
+			byte[] data = new byte[stream.Length - stream.Position];
+			int length = 0;
+			while(length < data.Length)
+			{
+				int count = stream.Read(data, length, data.Length - length);
+				if(count == 0) break;
+				length += count;
+			}
+
+			byte[] packed = Compress(data, length, null, 0);
+			MemoryStream ms = new MemoryStream(packed.Length + 8);
+			BinaryWriter writer = new BinaryWriter(ms);
+			writer.Write(STREAM_SIGNATURE);
+			writer.Write(length);
+			writer.Write(packed);
+			writer.Flush();
+			return ms;
+		}
+
+		// This checks if the data was made by CompressStream
+		public static bool IsCompressedStream(byte[] data)
+		{
+			return (data.Length >= 8) && (BitConverter.ToInt32(data, 0) == STREAM_SIGNATURE);
+		}
+
+		// This decompresses data made by CompressStream
+		public static MemoryStream DecompressStream(byte[] data)
+		{
+			if(!IsCompressedStream(data)) throw new InvalidDataException("Data is not a compressed snapshot stream");
+
+			int length = BitConverter.ToInt32(data, 4);
+			if(length < 0) throw new InvalidDataException("Invalid compressed snapshot stream length");
+
+			byte[] packed = new byte[data.Length - 8];
+			Array.Copy(data, 8, packed, 0, packed.Length);
+
+			byte[] output = new byte[length];
+			Decompress(packed, packed.Length, null, 0, output, length);
+			return new MemoryStream(output);
+		}
+
+		private static void ThrowNativeError()
+		{
+			StringBuilder sb = new StringBuilder(4096);
+			BuilderNative_GetError(sb, sb.Capacity);
+			throw new InvalidDataException(sb.ToString());
+		}
+
+		#endregion
+
+		#region ================== Native
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern int SnapshotCodec_CompressBound(int size);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern bool SnapshotCodec_Compress(byte* data, int size, byte* reference, int referencesize, byte* dest, int destsize, out int written);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern bool SnapshotCodec_Decompress(byte* data, int size, byte* reference, int referencesize, byte* dest, int destsize);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+		static extern void BuilderNative_GetError(StringBuilder str, int length);
+
+		#endregion
+	}
+}
@@ -21,6 +21,7 @@ using System.IO;
 using System.Text;
 using System.Globalization;
 using System.Collections.Generic;
+using System.Runtime.InteropServices;
 
 #endregion
 
@@ -657,6 +658,49 @@ namespace CodeImp.DoomBuilder.IO
 		}
 		
 		
+		// This adds a field read by the native parser to the collection
+		private void AddNativeField(UniversalCollection cs, ref UDMFField field, string[] strings)
+		{
+			string fieldkey = strings[field.Key];
+			switch(field.Type)
+			{
+				case UDMFValueType.Int:
+					// Values that don't fit in an Int32 were read as Int64 before
+					if(field.Value >= int.MinValue && field.Value <= int.MaxValue)
+						cs.Add(new UniversalEntry(fieldkey, (int)field.Value));
+					else
+						cs.Add(new UniversalEntry(fieldkey, field.Value));
+					break;
+
+				case UDMFValueType.Float:
+					double fval = BitConverter.Int64BitsToDouble(field.Value);
+					if(double.IsNaN(fval))
+					{
+						// Do not add NaN, just drop it with a warning
+						warnings.Add("UDMF map data line " + field.Line + ": value of field " + fieldkey + " has a value of NaN (not a number). Field is being dropped permanently.");
+					}
+					else
+					{
+						cs.Add(new UniversalEntry(fieldkey, fval));
+					}
+					break;
+
+				case UDMFValueType.Bool:
+					cs.Add(new UniversalEntry(fieldkey, field.Value != 0));
+					break;
+
+				case UDMFValueType.String:
+					cs.Add(new UniversalEntry(fieldkey, strings[(int)field.Value]));
+					break;
+
+				case UDMFValueType.Empty:
+					// Assignments without a value were always skipped, so only warn about them
+					warnings.Add("UDMF map data line " + field.Line + ": field " + fieldkey + " has no value assigned. Field is being dropped permanently.");
+					break;
+			}
+		}
+		
+		
 		// This will create a data structure from the given object
 		private string OutputStructure(UniversalCollection cs, int level, string newline, bool whitespace)
 		{
@@ -840,7 +884,132 @@ namespace CodeImp.DoomBuilder.IO
 			// Return true when done, false when errors occurred
 			return (cpErrorResult == 0);
 		}
+
+
+		// This will load UDMF map data with the native parser.
+		// Unlike the other overloads, blocks can't be nested.
+		public unsafe bool InputConfiguration(byte[] data)
+		{
+			// Clear errors
+			ClearError();
+			root = new UniversalCollection();
+
+			IntPtr parser = UDMFParser_New();
+			try
+			{
+				bool result;
+				fixed(byte* dataptr = data)
+				{
+					result = UDMFParser_Parse(parser, dataptr, data.Length, strictchecking);
+				}
+
+				if(!result)
+				{
+					StringBuilder sb = new StringBuilder(4096);
+					BuilderNative_GetError(sb, sb.Capacity);
+					RaiseError(UDMFParser_GetErrorLine(parser) - 1, sb.ToString());
+					return false;
+				}
+
+				// Every distinct key and string value is only decoded once
+				int numstrings;
+				int* offsets;
+				byte* stringdata = UDMFParser_GetStrings(parser, &offsets, &numstrings);
+				string[] strings = new string[numstrings];
+				for(int i = 0; i < numstrings; i++)
+					strings[i] = new string((sbyte*)stringdata, offsets[i], offsets[i + 1] - offsets[i], Encoding.ASCII);
+
+				int numentries, numfields, numblocks;
+				UDMFField* entries = UDMFParser_GetEntries(parser, &numentries);
+				UDMFField* fields = UDMFParser_GetFields(parser, &numfields);
+				UDMFBlock* blocks = UDMFParser_GetBlocks(parser, &numblocks);
+
+				root.Capacity = numentries;
+				for(int i = 0; i < numentries; i++)
+				{
+					if(entries[i].Type == UDMFValueType.Block)
+					{
+						UDMFBlock block = blocks[entries[i].Value];
+						UniversalCollection cs = new UniversalCollection();
+						cs.Capacity = block.NumFields;
+						for(int j = 0; j < block.NumFields; j++)
+							AddNativeField(cs, ref fields[block.FirstField + j], strings);
+						root.Add(new UniversalEntry(strings[block.Key], cs));
+					}
+					else
+					{
+						AddNativeField(root, ref entries[i], strings);
+					}
+				}
+			}
+			finally
+			{
+				UDMFParser_Delete(parser);
+			}
+
+			return true;
+		}
 		
 		#endregion
+
+		#region ================== Native
+
+		private enum UDMFValueType : int
+		{
+			Int,
+			Float,
+			Bool,
+			String,
+			Block,
+			Empty
+		}
+
+		[StructLayout(LayoutKind.Sequential)]
+		private struct UDMFField
+		{
+			public int Key;
+			public UDMFValueType Type;
+			public int Line;
+			public int Padding;
+			public long Value; // Int64, the bits of a double, or a string index
+		}
+
+		[StructLayout(LayoutKind.Sequential)]
+		private struct UDMFBlock
+		{
+			public int Key;
+			public int FirstField;
+			public int NumFields;
+			public int Line;
+		}
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern IntPtr UDMFParser_New();
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern void UDMFParser_Delete(IntPtr parser);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern unsafe bool UDMFParser_Parse(IntPtr parser, byte* data, int size, bool strict);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern int UDMFParser_GetErrorLine(IntPtr parser);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern unsafe UDMFField* UDMFParser_GetEntries(IntPtr parser, int* count);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern unsafe UDMFField* UDMFParser_GetFields(IntPtr parser, int* count);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern unsafe UDMFBlock* UDMFParser_GetBlocks(IntPtr parser, int* count);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern unsafe byte* UDMFParser_GetStrings(IntPtr parser, int** offsets, int* count);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+		static extern void BuilderNative_GetError(StringBuilder str, int length);
+
+		#endregion
 	}
 }
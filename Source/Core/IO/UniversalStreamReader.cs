@@ -134,16 +134,19 @@ namespace CodeImp.DoomBuilder.IO
 		// This reads from a stream
 		public void Read(MapSet map, Stream stream)
 		{
-			StreamReader reader = new StreamReader(stream, Encoding.ASCII);
 			UniversalParser textmap = new UniversalParser();
 			textmap.StrictChecking = strictchecking;
 			
 			// Read UDMF from stream
-			List<string> data = new List<string>(1000);
-			while(!reader.EndOfStream) data.Add(reader.ReadLine());
+			byte[] data;
+			using(MemoryStream memstream = new MemoryStream())
+			{
+				stream.CopyTo(memstream);
+				data = memstream.ToArray();
+			}
 
-			// Parse it
-			textmap.InputConfiguration(data.ToArray());
+			// Parse it natively
+			textmap.InputConfiguration(data);
 
 			// Check for errors
 			if(textmap.ErrorResult != 0)
@@ -0,0 +1,145 @@
+#region ================== Namespaces
+
+using System;
+using System.Drawing;
+using System.Drawing.Imaging;
+using System.Runtime.InteropServices;
+using System.Text;
+using CodeImp.DoomBuilder.Rendering;
+
+#endregion
+
+namespace CodeImp.DoomBuilder.IO
+{
+	// Loads KVX voxels in BuilderNative
+	internal static unsafe class VoxelDecoder
+	{
+		#region ================== Structures
+
+		[StructLayout(LayoutKind.Sequential)]
+		public struct VoxelInfo
+		{
+			public int SizeX;
+			public int SizeY;
+			public int SizeZ;
+			public float PivotX;
+			public float PivotY;
+			public float PivotZ;
+		}
+
+		#endregion
+
+		#region ================== Methods
+
+		// This makes the mesh of a voxel. Visible faces of neighbouring voxels with the same color are merged into a single quad.
+		public static void BuildMesh(byte[] data, out VoxelInfo info, out WorldVertex[] vertices, out int[] indices)
+		{
+			IntPtr model = Load(data, out info);
+			try
+			{
+				int vertexcount, indexcount;
+				VoxelModel_BuildMesh(model, out vertexcount, out indexcount);
+
+				vertices = new WorldVertex[vertexcount];
+				indices = new int[indexcount];
+				fixed(WorldVertex* verticesptr = vertices)
+				fixed(int* indicesptr = indices)
+				{
+					VoxelModel_CopyMesh(model, verticesptr, indicesptr);
+				}
+			}
+			finally
+			{
+				VoxelModel_Delete(model);
+			}
+		}
+
+		// This makes the front projection of a voxel as seen from a cardinal direction
+		public static Bitmap Project(byte[] data, int angle, PixelColor[] palette, out VoxelInfo info)
+		{
+			IntPtr model = Load(data, out info);
+			try
+			{
+				int width = (angle == 0 || angle == 180) ? info.SizeX : info.SizeY;
+				Bitmap bmp = new Bitmap(width, info.SizeZ, PixelFormat.Format32bppArgb);
+				BitmapData bmpdata = bmp.LockBits(new Rectangle(0, 0, bmp.Width, bmp.Height), ImageLockMode.WriteOnly, PixelFormat.Format32bppArgb);
+
+				bool result;
+				fixed(PixelColor* paletteptr = palette)
+				{
+					result = VoxelModel_Project(model, angle, paletteptr, (PixelColor*)bmpdata.Scan0.ToPointer());
+				}
+
+				bmp.UnlockBits(bmpdata);
+				if(!result)
+				{
+					bmp.Dispose();
+					ThrowNativeError();
+				}
+
+				return bmp;
+			}
+			finally
+			{
+				VoxelModel_Delete(model);
+			}
+		}
+
+		private static IntPtr Load(byte[] data, out VoxelInfo info)
+		{
+			IntPtr model = VoxelModel_New();
+
+			bool result;
+			fixed(byte* dataptr = data)
+			{
+				result = VoxelModel_Load(model, dataptr, data.Length);
+			}
+
+			if(!result)
+			{
+				VoxelModel_Delete(model);
+				ThrowNativeError();
+			}
+
+			VoxelModel_GetInfo(model, out info.SizeX, out info.SizeY, out info.SizeZ, out info.PivotX, out info.PivotY, out info.PivotZ);
+			return model;
+		}
+
+		private static void ThrowNativeError()
+		{
+			StringBuilder sb = new StringBuilder(4096);
+			BuilderNative_GetError(sb, sb.Capacity);
+			throw new Exception(sb.ToString());
+		}
+
+		#endregion
+
+		#region ================== Native
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern IntPtr VoxelModel_New();
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern void VoxelModel_Delete(IntPtr model);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern bool VoxelModel_Load(IntPtr model, byte* data, int size);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern void VoxelModel_GetInfo(IntPtr model, out int sizex, out int sizey, out int sizez, out float pivotx, out float pivoty, out float pivotz);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern void VoxelModel_BuildMesh(IntPtr model, out int vertexcount, out int indexcount);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern void VoxelModel_CopyMesh(IntPtr model, WorldVertex* vertices, int* indices);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern bool VoxelModel_Project(IntPtr model, int angle, PixelColor* palette, PixelColor* dest);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+		static extern void BuilderNative_GetError(StringBuilder str, int length);
+
+		#endregion
+	}
+}
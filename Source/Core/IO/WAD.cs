@@ -141,6 +141,10 @@ namespace CodeImp.DoomBuilder.IO
 		
 		// Lumps
 		private List<Lump> lumps;
+
+		// Read-only wads are also opened as a native archive, so that lumps can be read without locking and found without searching
+		private NativeArchive archive;
+		private bool usearchivelookup;
 		
 		// Status
 		private bool isreadonly;
@@ -201,6 +205,7 @@ namespace CodeImp.DoomBuilder.IO
 				
 				// Clean up
 				if(lumps != null) foreach(Lump l in lumps) l.Dispose();
+				if(archive != null) archive.Dispose();
 				if(writer != null) writer.Close();
 				if(reader != null) reader.Close();
 				if(file != null) file.Dispose();
@@ -303,6 +308,20 @@ namespace CodeImp.DoomBuilder.IO
 			if(lumps != null) foreach(Lump l in lumps) l.Dispose();
 			lumps = new List<Lump>(numlumps);
 
+			// Open the file as a native archive when it can't change
+			if(isreadonly && archive == null)
+			{
+				archive = NativeArchive.Open(filename);
+				if(archive != null && (archive.Format != NativeArchive.ArchiveFormat.WAD || archive.Count != numlumps))
+				{
+					archive.Dispose();
+					archive = null;
+				}
+			}
+
+			// The name lookup of the archive can only be used when it has the same names as the lumps
+			usearchivelookup = (archive != null);
+
 			// Go for all lumps
 			for(int i = 0; i < numlumps; i++)
 			{
@@ -312,7 +331,16 @@ namespace CodeImp.DoomBuilder.IO
 				byte[] fixedname = reader.ReadBytes(8);
 
 				// Create the lump
-				lumps.Add(new Lump(file, this, fixedname, offset, length));
+				if(archive != null)
+				{
+					Lump lump = new Lump(file, this, fixedname, offset, length, (archive.CanRead(i) ? archive : null), i);
+					if(usearchivelookup && lump.Name != archive.GetName(i).ToUpperInvariant()) usearchivelookup = false;
+					lumps.Add(lump);
+				}
+				else
+				{
+					lumps.Add(new Lump(file, this, fixedname, offset, length));
+				}
 			}
 		}
 
@@ -557,6 +585,17 @@ namespace CodeImp.DoomBuilder.IO
 			start = Math.Max(start, 0);
 			end = General.Clamp(end, 0, lumps.Count - 1);
 
+			// Only check the lumps with the same name, in ascending order
+			if(CanUseArchiveLookup(name))
+			{
+				for(int i = archive.Find(name); i != -1 && i <= end; i = archive.FindNext(i))
+				{
+					if(i >= start && lumps[i].LongName == longname) return i;
+				}
+
+				return -1;
+			}
+
 			// Loop through the lumps
 			for(int i = start; i < end + 1; i++)
 			{
@@ -620,6 +659,18 @@ namespace CodeImp.DoomBuilder.IO
 			start = Math.Max(start, 0);
 			end = General.Clamp(end, 0, lumps.Count - 1);
 
+			// Only check the lumps with the same name, keeping the last one in range
+			if(CanUseArchiveLookup(name))
+			{
+				int found = -1;
+				for(int i = archive.Find(name); i != -1 && i <= end; i = archive.FindNext(i))
+				{
+					if(i >= start && lumps[i].LongName == longname) found = i;
+				}
+
+				return found;
+			}
+
 			// Loop through the lumps in backwards order
 			for(int i = end; i > start - 1; i--)
 			{
@@ -635,6 +686,19 @@ namespace CodeImp.DoomBuilder.IO
 			return -1;
 		}
 
+		// The archive ignores the case of ASCII characters only, so other names are searched the slow way
+		private bool CanUseArchiveLookup(string name)
+		{
+			if(!usearchivelookup || archive.IsDisposed || lumps.Count != numlumps) return false;
+
+			foreach(char c in name)
+			{
+				if(c >= 128) return false;
+			}
+
+			return true;
+		}
+
 		#endregion
 	}
 }
@@ -57,6 +57,9 @@ namespace CodeImp.DoomBuilder.Map
 		
 		//mxd
 		private const string SELECTION_GROUPS_PATH = "selectiongroups";
+
+		// Below this many changed sectors the managed triangulation is faster than starting the native one
+		private const int BATCH_TRIANGULATION_THRESHOLD = 64;
 		
 		// Handler for tag fields
 		public delegate void TagHandler<T>(MapElement element, bool actionargument, UniversalType type, ref int value, T obj);
@@ -1127,6 +1130,18 @@ namespace CodeImp.DoomBuilder.Map
 			// Update all sectors
 			if(dosectors)
 			{
+				// Triangulate many sectors at once natively, such as after loading a map
+				List<Sector> dirtysectors = new List<Sector>();
+				foreach(Sector s in sectors)
+					if(s.TriangulationNeeded) dirtysectors.Add(s);
+
+				if(dirtysectors.Count >= BATCH_TRIANGULATION_THRESHOLD)
+				{
+					Triangulation[] triangulations = Triangulation.Create(dirtysectors);
+					for(int i = 0; i < dirtysectors.Count; i++)
+						dirtysectors[i].SetTriangulation(triangulations[i]);
+				}
+
 				foreach (Sector s in sectors)
 				{
 					s.Triangulate();
@@ -358,24 +358,27 @@ namespace CodeImp.DoomBuilder.Map
 		// This triangulates the sector geometry
 		internal void Triangulate()
 		{
-			if(updateneeded)
-			{
-				// Triangulate again?
-				if(triangulationneeded || (triangles == null))
-				{
-					// Triangulate sector
-					triangles = Triangulation.Create(this);
-					triangulationneeded = false;
-					updateneeded = true;
-					
-					// Make label positions
-					labels = Array.AsReadOnly(Tools.FindLabelPositions(this).ToArray());
-					
-					// Number of vertices changed?
-					if(triangles.Vertices.Count != surfaceentries.totalvertices)
-						General.Map.CRenderer2D.Surfaces.FreeSurfaces(surfaceentries);
-				}
-			}
+			// Triangulate again?
+			if(TriangulationNeeded)
+				SetTriangulation(Triangulation.Create(this));
+		}
+
+		// This returns true when Triangulate would triangulate the sector again
+		internal bool TriangulationNeeded { get { return updateneeded && (triangulationneeded || (triangles == null)); } }
+
+		// This applies a triangulation that was made for this sector elsewhere
+		internal void SetTriangulation(Triangulation t)
+		{
+			triangles = t;
+			triangulationneeded = false;
+			updateneeded = true;
+			
+			// Make label positions
+			labels = Array.AsReadOnly(Tools.FindLabelPositions(this).ToArray());
+			
+			// Number of vertices changed?
+			if(triangles.Vertices.Count != surfaceentries.totalvertices)
+				General.Map.CRenderer2D.Surfaces.FreeSurfaces(surfaceentries);
 		}
 		
 		// This makes new vertices as well as floor and ceiling surfaces
@@ -0,0 +1,463 @@
+#region ================== Namespaces
+
+using System;
+using System.Collections.Generic;
+using System.Drawing;
+using System.Runtime.InteropServices;
+using System.Text;
+using CodeImp.DoomBuilder.Geometry;
+
+#endregion
+
+namespace CodeImp.DoomBuilder.Map
+{
+	public enum SpatialIndexType
+	{
+		Grid, // Uniform blocks, like BlockMap
+		BVH // Bounding volume hierarchy, for maps where the geometry is very unevenly spread
+	}
+
+	// Finds linedefs, vertices, things and sectors near a position or inside a rectangle.
+	// The index lives in BuilderNative, where building it is a single call and queries can
+	// be done for many positions at once. Elements can be added, moved and removed one at
+	// a time, so the index only has to be built again when the whole map changes.
+	public sealed unsafe class SpatialIndex : IDisposable
+	{
+		#region ================== Variables
+
+		private IntPtr index;
+		private readonly SpatialIndexType type;
+
+		// The elements by their index in the native sets. Removed elements leave a null behind.
+		private List<Linedef> linedefs = new List<Linedef>();
+		private List<Vertex> vertices = new List<Vertex>();
+		private List<Thing> things = new List<Thing>();
+		private List<Sector> sectors = new List<Sector>();
+
+		#endregion
+
+		#region ================== Properties
+
+		public bool IsDisposed { get { return index == IntPtr.Zero; } }
+		public SpatialIndexType Type { get { return type; } }
+
+		#endregion
+
+		#region ================== Constructor / Disposer
+
+		// Constructor
+		public SpatialIndex() : this(SpatialIndexType.Grid, 128)
+		{
+		}
+
+		// Constructor
+		public SpatialIndex(SpatialIndexType type) : this(type, 128)
+		{
+		}
+
+		// Constructor
+		public SpatialIndex(SpatialIndexType type, int blocksize)
+		{
+			this.type = type;
+			index = SpatialIndex_New(type, blocksize);
+		}
+
+		// Destructor
+		~SpatialIndex()
+		{
+			Dispose();
+		}
+
+		// Disposer
+		public void Dispose()
+		{
+			if(index != IntPtr.Zero)
+			{
+				SpatialIndex_Delete(index);
+				index = IntPtr.Zero;
+				GC.SuppressFinalize(this);
+			}
+		}
+
+		#endregion
+
+		#region ================== Elements
+
+		// This replaces all linedefs in the index
+		public void SetLinedefs(ICollection<Linedef> lines)
+		{
+			linedefs = new List<Linedef>(lines);
+			SpatialIndexLine[] data = new SpatialIndexLine[linedefs.Count];
+			for(int i = 0; i < data.Length; i++) data[i] = GetLine(linedefs[i]);
+
+			fixed(SpatialIndexLine* dataptr = data)
+			{
+				if(!SpatialIndex_SetLines(index, dataptr, data.Length)) ThrowNativeError();
+			}
+		}
+
+		// This adds a linedef, or updates it when it is already in the index
+		public void UpdateLinedef(Linedef l)
+		{
+			int slot = FindSlot(linedefs, l);
+			if(slot == -1)
+			{
+				slot = linedefs.Count;
+				linedefs.Add(l);
+			}
+
+			SpatialIndexLine line = GetLine(l);
+			if(!SpatialIndex_SetLine(index, slot, &line)) ThrowNativeError();
+		}
+
+		// This removes a linedef
+		public void RemoveLinedef(Linedef l)
+		{
+			Remove(linedefs, SpatialIndexSet.Linedefs, l);
+		}
+
+		// This replaces all vertices in the index
+		public void SetVertices(ICollection<Vertex> verts)
+		{
+			vertices = new List<Vertex>(verts);
+			Vector2D[] positions = new Vector2D[vertices.Count];
+			for(int i = 0; i < positions.Length; i++) positions[i] = vertices[i].Position;
+			SetPoints(SpatialIndexSet.Vertices, positions);
+		}
+
+		// This adds a vertex, or updates it when it is already in the index
+		public void UpdateVertex(Vertex v)
+		{
+			UpdatePoint(vertices, SpatialIndexSet.Vertices, v, v.Position);
+		}
+
+		// This removes a vertex
+		public void RemoveVertex(Vertex v)
+		{
+			Remove(vertices, SpatialIndexSet.Vertices, v);
+		}
+
+		// This replaces all things in the index
+		public void SetThings(ICollection<Thing> newthings)
+		{
+			things = new List<Thing>(newthings);
+			Vector2D[] positions = new Vector2D[things.Count];
+			for(int i = 0; i < positions.Length; i++) positions[i] = things[i].Position;
+			SetPoints(SpatialIndexSet.Things, positions);
+		}
+
+		// This adds a thing, or updates it when it is already in the index
+		public void UpdateThing(Thing t)
+		{
+			UpdatePoint(things, SpatialIndexSet.Things, t, t.Position);
+		}
+
+		// This removes a thing
+		public void RemoveThing(Thing t)
+		{
+			Remove(things, SpatialIndexSet.Things, t);
+		}
+
+		// This replaces all sectors in the index
+		public void SetSectors(ICollection<Sector> newsectors)
+		{
+			sectors = new List<Sector>(newsectors);
+			Dictionary<Sector, int> slots = new Dictionary<Sector, int>(sectors.Count);
+			for(int i = 0; i < sectors.Count; i++) slots[sectors[i]] = i;
+
+			List<SpatialIndexSectorSide> sides = new List<SpatialIndexSectorSide>();
+			int[] sidecounts = new int[sectors.Count];
+			for(int i = 0; i < sectors.Count; i++)
+			{
+				foreach(Sidedef sd in sectors[i].Sidedefs)
+				{
+					int front, back;
+					if(sd.Line.Front == null || !slots.TryGetValue(sd.Line.Front.Sector, out front)) front = -1;
+					if(sd.Line.Back == null || !slots.TryGetValue(sd.Line.Back.Sector, out back)) back = -1;
+					sides.Add(GetSectorSide(sd, front, back));
+				}
+				sidecounts[i] = sectors[i].Sidedefs.Count;
+			}
+
+			SpatialIndexSectorSide[] sidesarray = sides.ToArray();
+			fixed(SpatialIndexSectorSide* sidesptr = sidesarray)
+			fixed(int* sidecountsptr = sidecounts)
+			{
+				if(!SpatialIndex_SetSectors(index, sidesptr, sidecountsptr, sidecounts.Length)) ThrowNativeError();
+			}
+		}
+
+		// This adds a sector, or updates it when it is already in the index
+		public void UpdateSector(Sector s)
+		{
+			int slot = FindSlot(sectors, s);
+			if(slot == -1)
+			{
+				slot = sectors.Count;
+				sectors.Add(s);
+			}
+
+			SpatialIndexSectorSide[] sides = new SpatialIndexSectorSide[s.Sidedefs.Count];
+			int i = 0;
+			foreach(Sidedef sd in s.Sidedefs)
+			{
+				int front = (sd.Line.Front != null ? FindSlot(sectors, sd.Line.Front.Sector) : -1);
+				int back = (sd.Line.Back != null ? FindSlot(sectors, sd.Line.Back.Sector) : -1);
+				sides[i++] = GetSectorSide(sd, front, back);
+			}
+
+			fixed(SpatialIndexSectorSide* sidesptr = sides)
+			{
+				if(!SpatialIndex_SetSector(index, slot, sidesptr, sides.Length)) ThrowNativeError();
+			}
+		}
+
+		// This removes a sector
+		public void RemoveSector(Sector s)
+		{
+			Remove(sectors, SpatialIndexSet.Sectors, s);
+		}
+
+		// The slot of an element is usually its index in the map, unless elements were removed since
+		private static int FindSlot<T>(List<T> slots, T element) where T : MapElement
+		{
+			int i = element.Index;
+			if(i >= 0 && i < slots.Count && slots[i] == element) return i;
+			return slots.IndexOf(element);
+		}
+
+		private void Remove<T>(List<T> slots, SpatialIndexSet set, T element) where T : MapElement
+		{
+			int slot = FindSlot(slots, element);
+			if(slot == -1) return;
+
+			slots[slot] = null;
+			if(!SpatialIndex_Remove(index, set, slot)) ThrowNativeError();
+		}
+
+		private void SetPoints(SpatialIndexSet set, Vector2D[] positions)
+		{
+			fixed(Vector2D* positionsptr = positions)
+			{
+				if(!SpatialIndex_SetPoints(index, set, positionsptr, positions.Length)) ThrowNativeError();
+			}
+		}
+
+		private void UpdatePoint<T>(List<T> slots, SpatialIndexSet set, T element, Vector2D position) where T : MapElement
+		{
+			int slot = FindSlot(slots, element);
+			if(slot == -1)
+			{
+				slot = slots.Count;
+				slots.Add(element);
+			}
+
+			if(!SpatialIndex_SetPoint(index, set, slot, &position)) ThrowNativeError();
+		}
+
+		private static SpatialIndexLine GetLine(Linedef l)
+		{
+			return new SpatialIndexLine { X1 = l.Start.Position.x, Y1 = l.Start.Position.y, X2 = l.End.Position.x, Y2 = l.End.Position.y };
+		}
+
+		private static SpatialIndexSectorSide GetSectorSide(Sidedef sd, int front, int back)
+		{
+			Linedef l = sd.Line;
+			return new SpatialIndexSectorSide { X1 = l.Start.Position.x, Y1 = l.Start.Position.y, X2 = l.End.Position.x, Y2 = l.End.Position.y, Front = front, Back = back };
+		}
+
+		#endregion
+
+		#region ================== Queries
+
+		// This finds the linedef closest to the specified position
+		public Linedef NearestLinedef(Vector2D pos)
+		{
+			return NearestLinedefs(new[] { pos }, -1.0)[0];
+		}
+
+		// This finds the linedef closest to the specified position, like MapSet.NearestLinedefRange
+		public Linedef NearestLinedefRange(Vector2D pos, double maxrange)
+		{
+			return NearestLinedefs(new[] { pos }, Math.Max(maxrange, 0.0))[0];
+		}
+
+		// This finds the closest linedef for each position. A negative range searches the whole map.
+		public Linedef[] NearestLinedefs(Vector2D[] positions, double maxrange)
+		{
+			int[] results = new int[positions.Length];
+			fixed(Vector2D* positionsptr = positions)
+			fixed(int* resultsptr = results)
+			{
+				if(!SpatialIndex_NearestLines(index, positionsptr, positions.Length, maxrange, resultsptr)) ThrowNativeError();
+			}
+			return GetElements(linedefs, results);
+		}
+
+		// This finds the vertex closest to the specified position, like MapSet.NearestVertexSquareRange
+		public Vertex NearestVertexSquareRange(Vector2D pos, double maxrange)
+		{
+			return NearestPoint(vertices, SpatialIndexSet.Vertices, pos, maxrange);
+		}
+
+		// This finds the thing with the closest position. Unlike MapSet.NearestThingSquareRange the size of the thing does not matter.
+		public Thing NearestThingSquareRange(Vector2D pos, double maxrange)
+		{
+			return NearestPoint(things, SpatialIndexSet.Things, pos, maxrange);
+		}
+
+		// This returns the sector at the given coordinates, like VisualBlockMap.GetSectorAt
+		public Sector GetSectorAt(Vector2D pos)
+		{
+			return GetSectorsAt(new[] { pos })[0];
+		}
+
+		// This returns the sector at each position, or null where there is none
+		public Sector[] GetSectorsAt(Vector2D[] positions)
+		{
+			int[] results = new int[positions.Length];
+			fixed(Vector2D* positionsptr = positions)
+			fixed(int* resultsptr = results)
+			{
+				if(!SpatialIndex_FindSectors(index, positionsptr, positions.Length, resultsptr)) ThrowNativeError();
+			}
+			return GetElements(sectors, results);
+		}
+
+		// This returns the linedefs that cross or touch the rectangle
+		public List<Linedef> GetLinedefsInRect(RectangleF rect)
+		{
+			return QueryRect(linedefs, SpatialIndexSet.Linedefs, rect);
+		}
+
+		// This returns the vertices inside the rectangle
+		public List<Vertex> GetVerticesInRect(RectangleF rect)
+		{
+			return QueryRect(vertices, SpatialIndexSet.Vertices, rect);
+		}
+
+		// This returns the things inside the rectangle
+		public List<Thing> GetThingsInRect(RectangleF rect)
+		{
+			return QueryRect(things, SpatialIndexSet.Things, rect);
+		}
+
+		// This returns the sectors with a bounding box overlapping the rectangle
+		public List<Sector> GetSectorsInRect(RectangleF rect)
+		{
+			return QueryRect(sectors, SpatialIndexSet.Sectors, rect);
+		}
+
+		private T NearestPoint<T>(List<T> slots, SpatialIndexSet set, Vector2D pos, double maxrange) where T : MapElement
+		{
+			int result;
+			if(!SpatialIndex_NearestPoints(index, set, &pos, 1, Math.Max(maxrange, 0.0), &result)) ThrowNativeError();
+			return (result != -1 ? slots[result] : null);
+		}
+
+		private List<T> QueryRect<T>(List<T> slots, SpatialIndexSet set, RectangleF rect) where T : MapElement
+		{
+			IntPtr results;
+			int count;
+			if(!SpatialIndex_QueryRect(index, set, rect.Left, rect.Top, rect.Right, rect.Bottom, out results, out count)) ThrowNativeError();
+
+			List<T> elements = new List<T>(count);
+			int* resultsptr = (int*)results;
+			for(int i = 0; i < count; i++) elements.Add(slots[resultsptr[i]]);
+			return elements;
+		}
+
+		private static T[] GetElements<T>(List<T> slots, int[] results) where T : MapElement
+		{
+			T[] elements = new T[results.Length];
+			for(int i = 0; i < results.Length; i++)
+			{
+				if(results[i] != -1) elements[i] = slots[results[i]];
+			}
+			return elements;
+		}
+
+		private static void ThrowNativeError()
+		{
+			StringBuilder sb = new StringBuilder(4096);
+			BuilderNative_GetError(sb, sb.Capacity);
+			throw new Exception(sb.ToString());
+		}
+
+		#endregion
+
+		#region ================== Native
+
+		private enum SpatialIndexSet : int
+		{
+			Linedefs,
+			Vertices,
+			Things,
+			Sectors
+		}
+
+		[StructLayout(LayoutKind.Sequential)]
+		private struct SpatialIndexLine
+		{
+			public double X1;
+			public double Y1;
+			public double X2;
+			public double Y2;
+		}
+
+		[StructLayout(LayoutKind.Sequential)]
+		private struct SpatialIndexSectorSide
+		{
+			public double X1;
+			public double Y1;
+			public double X2;
+			public double Y2;
+			public int Front;
+			public int Back;
+		}
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern IntPtr SpatialIndex_New(SpatialIndexType type, int blocksize);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern void SpatialIndex_Delete(IntPtr index);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern bool SpatialIndex_SetLines(IntPtr index, SpatialIndexLine* lines, int count);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern bool SpatialIndex_SetLine(IntPtr index, int element, SpatialIndexLine* line);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern bool SpatialIndex_SetPoints(IntPtr index, SpatialIndexSet set, Vector2D* points, int count);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern bool SpatialIndex_SetPoint(IntPtr index, SpatialIndexSet set, int element, Vector2D* point);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern bool SpatialIndex_SetSectors(IntPtr index, SpatialIndexSectorSide* sides, int* sidecounts, int count);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern bool SpatialIndex_SetSector(IntPtr index, int element, SpatialIndexSectorSide* sides, int sidecount);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern bool SpatialIndex_Remove(IntPtr index, SpatialIndexSet set, int element);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern bool SpatialIndex_NearestLines(IntPtr index, Vector2D* positions, int count, double maxrange, int* results);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern bool SpatialIndex_NearestPoints(IntPtr index, SpatialIndexSet set, Vector2D* positions, int count, double maxrange, int* results);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern bool SpatialIndex_FindSectors(IntPtr index, Vector2D* positions, int count, int* results);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern bool SpatialIndex_QueryRect(IntPtr index, SpatialIndexSet set, double left, double top, double right, double bottom, out IntPtr results, out int count);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+		static extern void BuilderNative_GetError(StringBuilder str, int length);
+
+		#endregion
+	}
+}
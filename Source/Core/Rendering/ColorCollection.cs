@@ -115,6 +115,7 @@ namespace CodeImp.DoomBuilder.Rendering
 		public PixelColor[] Colors { get { return colors; } }
 		public PixelColor[] BrightColors { get { return brightcolors; } }
 		public PixelColor[] DarkColors { get { return darkcolors; } }
+		internal byte[] CorrectionTable { get { return correctiontable; } }
 		
 		public PixelColor Background { get { return colors[BACKGROUND]; } internal set { colors[BACKGROUND] = value; } }
 		public PixelColor Vertices { get { return colors[VERTICES]; } internal set { colors[VERTICES] = value; } }
@@ -277,10 +278,10 @@ namespace CodeImp.DoomBuilder.Rendering
 			}
 		}
 
-		// This quantizes an image to a PLAYPAL lump, putting indices into an array of integers.
-		internal unsafe void QuantizeColorsToPlaypal(PixelColor* inPixels, int[] indices, Playpal playpal)
+		// This quantizes an image to a PLAYPAL lump, putting the indices into the red channel of the output pixels.
+		internal unsafe void QuantizeColorsToPlaypal(PixelColor* inPixels, PixelColor* outPixels, int numpixels, Playpal playpal)
 		{
-			System.Threading.Tasks.Parallel.For(0, indices.Length, (i) => indices[i] = playpal.FindClosestColor(inPixels[i]));
+			playpal.QuantizeColors(inPixels, outPixels, numpixels);
 		}
 		
 		// This clamps a value between 0 and 1
@@ -0,0 +1,24 @@
+
+#region ================== Namespaces
+using System.Runtime.InteropServices;
+#endregion
+
+namespace CodeImp.DoomBuilder.Rendering
+{
+    // InstanceVertex: per-instance data for RenderDevice.DrawInstanced
+    [StructLayout(LayoutKind.Sequential)]
+    public struct InstanceVertex
+	{
+		// Vertex format
+		public const int Stride = 28; //7 * 4
+
+		// Members
+		public float x;
+		public float y;
+		public float z;
+		public float size;
+		public float angle; // In radians
+		public float sprite; // Cell index in the sprite atlas
+		public int c;
+	}
+}
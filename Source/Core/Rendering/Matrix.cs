@@ -276,6 +276,71 @@ namespace CodeImp.DoomBuilder.Rendering
 
 #endif
 
+        // Transforms the x, y, z at the start of each vertex in place
+        public static unsafe void TransformCoordinates(WorldVertex[] vertices, Matrix transform)
+        {
+            fixed (WorldVertex* v = vertices)
+                Matrix_TransformPoints(ref transform, v, WorldVertex.Stride, v, WorldVertex.Stride, vertices.Length);
+        }
+
+        public static unsafe void TransformCoordinates(Vector3f[] points, Matrix transform, Vector3f[] result)
+        {
+            if (result.Length < points.Length)
+                throw new ArgumentException("Result array is too small");
+
+            fixed (Vector3f* src = points)
+            fixed (Vector3f* dst = result)
+                Matrix_TransformPoints(ref transform, src, sizeof(Vector3f), dst, sizeof(Vector3f), points.Length);
+        }
+
+        // Projects points to screen coordinates. The result holds the screen x and y, the normalized depth and
+        // the clip space w. Points with a w of zero or less are behind the camera.
+        public static unsafe void Project(Vector3f[] points, Matrix viewproj, float width, float height, Vector4f[] result)
+        {
+            if (result.Length < points.Length)
+                throw new ArgumentException("Result array is too small");
+
+            fixed (Vector3f* src = points)
+            fixed (Vector4f* dst = result)
+                Matrix_ProjectPoints(ref viewproj, src, sizeof(Vector3f), points.Length, width, height, dst);
+        }
+
+        public static unsafe bool BoundingBox(Vector3f[] points, out Vector3f min, out Vector3f max)
+        {
+            Vector3f* box = stackalloc Vector3f[2];
+            bool result;
+            fixed (Vector3f* src = points)
+                result = Matrix_BoundingBox(src, sizeof(Vector3f), points.Length, box);
+            min = box[0];
+            max = box[1];
+            return result;
+        }
+
+        // Tests boxes against the view frustum of viewproj. Boxes are stored as min, max pairs.
+        // Returns the number of visible boxes.
+        public static unsafe int CullBoxes(Vector3f[] boxes, Matrix viewproj, bool[] visible)
+        {
+            int count = boxes.Length / 2;
+            if (visible.Length < count)
+                throw new ArgumentException("Visibility array is too small");
+
+            fixed (Vector3f* src = boxes)
+            fixed (bool* dst = visible)
+                return Matrix_CullBoxes(ref viewproj, src, count, dst);
+        }
+
+        [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+        static extern unsafe void Matrix_TransformPoints(ref Matrix m, void* src, int srcstride, void* dst, int dststride, int count);
+
+        [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+        static extern unsafe void Matrix_ProjectPoints(ref Matrix m, void* src, int srcstride, int count, float width, float height, Vector4f* result);
+
+        [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+        static extern unsafe bool Matrix_BoundingBox(void* src, int stride, int count, Vector3f* result);
+
+        [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+        static extern unsafe int Matrix_CullBoxes(ref Matrix m, Vector3f* boxes, int count, bool* visible);
+
         public static Matrix LookAt(Vector3f eye, Vector3f target, Vector3f up)
         {
             Vector3f zaxis = Vector3f.Normalize(target - eye);
@@ -17,6 +17,7 @@
 #region ================== Namespaces
 
 using System;
+using System.Runtime.InteropServices;
 using CodeImp.DoomBuilder.Geometry;
 
 #endregion
@@ -33,8 +34,12 @@ namespace CodeImp.DoomBuilder.Rendering
 
         #region ================== Variables
 
-        // Memory
-        private PixelColor[] pixels;
+        // Drawing calls recorded since the last DrawContents. They are rasterized
+        // natively straight into the texture's pixel buffer.
+        private PlotterCommand[] commands;
+        private int numcommands;
+        private bool clearpending;
+        private IntPtr handle;
         private int width;
         private int height;
         private int visiblewidth;
@@ -59,8 +64,12 @@ namespace CodeImp.DoomBuilder.Rendering
         public Plotter(int width, int height)
         {
             // Initialize
+            handle = Plotter_New(width, height);
+            if (handle == IntPtr.Zero)
+                throw new Exception("Plotter_New failed");
+
             Texture = new Texture(width, height, TextureFormat.Bgra8);
-            this.pixels = new PixelColor[width*height];
+            this.commands = new PlotterCommand[1024];
             this.width = width;
             this.height = height;
             this.visiblewidth = width;
@@ -74,312 +83,81 @@ namespace CodeImp.DoomBuilder.Rendering
                 Texture.Dispose();
                 Texture = null;
             }
+
+            if (handle != IntPtr.Zero)
+            {
+                Plotter_Delete(handle);
+                handle = IntPtr.Zero;
+            }
         }
 
         #endregion
 
         #region ================== Pixel Rendering
 
-        private int TransformY(int y)
+        private static uint ToUInt(ref PixelColor c)
         {
-            return height - y;
+            return ((uint)c.a << 24) | ((uint)c.r << 16) | ((uint)c.g << 8) | c.b;
+        }
+
+        private void AddCommand(PlotterCommandType type, int x1, int y1, int x2, int y2, int size, ref PixelColor c, uint mask)
+        {
+            if (numcommands == commands.Length)
+                Array.Resize(ref commands, commands.Length * 2);
+
+            uint color = ToUInt(ref c);
+            commands[numcommands++] = new PlotterCommand { Type = type, X1 = x1, Y1 = y1, X2 = x2, Y2 = y2, Size = size, Color = color, LightColor = color, DarkColor = color, Mask = mask };
         }
 
         // This clears all pixels black
         public void Clear()
         {
-            // Clear memory
-            fixed(PixelColor* pixel = pixels)
-            {
-                uint* op = (uint*)pixel;
-                for (int i = 0; i < pixels.Length; i++)
-                {
-                    *op = 0;
-                    op++;
-                }
-            }
+            // Anything drawn before is overwritten anyway
+            numcommands = 0;
+            clearpending = true;
         }
 
         // This draws a pixel normally
         public void DrawPixelSolid(int x, int y, ref PixelColor c)
         {
-            y = TransformY(y);
-
-            // Draw pixel when within range
-            if ((x >= 0) && (x < visiblewidth) && (y >= 0) && (y < visibleheight))
-                pixels[y * width + x] = c;
+            AddCommand(PlotterCommandType.PixelSolid, x, y, 0, 0, 0, ref c, 0xffffffff);
         }
 
         // This draws a pixel normally
         public void DrawVertexSolid(int x, int y, int size, ref PixelColor c, ref PixelColor l, ref PixelColor d)
         {
-            y = TransformY(y);
+            AddCommand(PlotterCommandType.VertexSolid, x, y, 0, 0, size, ref c, 0xffffffff);
 
-            int x1 = x - size;
-            int x2 = x + size;
-            int y1 = y - size;
-            int y2 = y + size;
-
-            // Do unchecked?
-            if ((x1 >= 0) && (x2 < visiblewidth) && (y1 >= 0) && (y2 < visibleheight))
+            if (!General.Settings.FlatShadeVertices)
             {
-                // Filled square
-                for (int yp = y1; yp <= y2; yp++)
-                    for (int xp = x1; xp <= x2; xp++)
-                        pixels[yp * width + xp] = c;
-
-                if (!General.Settings.FlatShadeVertices)
-                {
-                    // Vertical edges
-                    for (int yp = y1 + 1; yp <= y2 - 1; yp++)
-                    {
-                        pixels[yp * width + x1] = l;
-                        pixels[yp * width + x2] = d;
-                    }
-
-                    // Horizontal edges
-                    for (int xp = x1 + 1; xp <= x2 - 1; xp++)
-                    {
-                        pixels[y1 * width + xp] = l;
-                        pixels[y2 * width + xp] = d;
-                    }
-
-                    // Corners
-                    pixels[y2 * width + x2] = d;
-                    pixels[y1 * width + x1] = l;
-                }
+                commands[numcommands - 1].LightColor = ToUInt(ref l);
+                commands[numcommands - 1].DarkColor = ToUInt(ref d);
             }
-            /*
-			else
-			{
-				// Filled square
-				for(yp = y - size; yp <= y + size; yp++)
-					for(xp = x - size; xp <= x + size; xp++)
-						DrawPixelSolid(xp, yp, c);
-
-				// Vertical edges
-				for(yp = y - size + 1; yp <= y + size - 1; yp++)
-				{
-					DrawPixelSolid(x - size, yp, l);
-					DrawPixelSolid(x + size, yp, d);
-				}
-
-				// Horizontal edges
-				for(xp = x - size + 1; xp <= x + size - 1; xp++)
-				{
-					DrawPixelSolid(xp, y - size, l);
-					DrawPixelSolid(xp, y + size, d);
-				}
-
-				// Corners
-				DrawPixelSolid(x + size, y + size, d);
-				DrawPixelSolid(x - size, y - size, l);
-			}
-			*/
         }
 
         // This draws a dotted grid line horizontally
         public void DrawGridLineH(int y, int x1, int x2, ref PixelColor c)
         {
-            y = TransformY(y);
-
-            int numpixels = visiblewidth >> 1;
-            int offset = y & 0x01;
-            int ywidth = y * width;
-            x1 = General.Clamp(x1 >> 1, 0, numpixels - 1);
-            x2 = General.Clamp(x2 >> 1, 0, numpixels - 1);
-
-            if ((y >= 0) && (y < height))
-            {
-                // Draw all pixels on this line
-                for (int i = x1; i < x2; i++) pixels[ywidth + ((i << 1) | offset)] = c;
-            }
+            AddCommand(PlotterCommandType.GridLineH, x1, y, x2, y, 0, ref c, 0xffffffff);
         }
 
         // This draws a dotted grid line vertically
         public void DrawGridLineV(int x, int y1, int y2, ref PixelColor c)
         {
-            y1 = TransformY(y1);
-            y2 = TransformY(y2);
-
-            int numpixels = visibleheight >> 1;
-            int offset = x & 0x01;
-            y1 = General.Clamp(y1 >> 1, 0, numpixels - 1);
-            y2 = General.Clamp(y2 >> 1, 0, numpixels - 1);
-
-            if ((x >= 0) && (x < width))
-            {
-                // Draw all pixels on this line
-                for (int i = y2; i < y1; i++) pixels[((i << 1) | offset) * width + x] = c;
-            }
+            AddCommand(PlotterCommandType.GridLineV, x, y1, x, y2, 0, ref c, 0xffffffff);
         }
 
         // This draws a pixel alpha blended
         public void DrawPixelAlpha(int x, int y, ref PixelColor c)
         {
-            y = TransformY(y);
-
-            fixed (PixelColor* pixels = this.pixels)
-            {
-                // Draw only when within range
-                if ((x >= 0) && (x < visiblewidth) && (y >= 0) && (y < visibleheight))
-                {
-                    // Get the target pixel
-                    PixelColor* p = pixels + (y * width + x);
-
-                    // Not drawn on target yet?
-                    if (*(int*)p == 0)
-                    {
-                        // Simply apply color to pixel
-                        *p = c;
-                    }
-                    else
-                    {
-                        // Blend with pixel
-                        float a = c.a * 0.003921568627450980392156862745098f;
-                        if (p->a + c.a > 255) p->a = 255; else p->a += c.a;
-                        p->r = (byte)(p->r * (1f - a) + c.r * a);
-                        p->g = (byte)(p->g * (1f - a) + c.g * a);
-                        p->b = (byte)(p->b * (1f - a) + c.b * a);
-                    }
-                }
-            }
+            AddCommand(PlotterCommandType.PixelAlpha, x, y, 0, 0, 0, ref c, 0xffffffff);
         }
 
         // This draws a line normally
         // See: http://en.wikipedia.org/wiki/Bresenham%27s_line_algorithm
         public void DrawLineSolid(int x1, int y1, int x2, int y2, ref PixelColor c, uint mask = 0xffffffff)
         {
-            y1 = TransformY(y1);
-            y2 = TransformY(y2);
-
-            // Check if the line is outside the screen for sure.
-            // This is quickly done by checking in which area both points are. When this
-            // is above, below, right or left of the screen, then skip drawing the line.
-            if (((x1 < 0) && (x2 < 0)) ||
-               ((x1 > visiblewidth) && (x2 > visiblewidth)) ||
-               ((y1 < 0) && (y2 < 0)) ||
-               ((y1 > visibleheight) && (y2 > visibleheight))) return;
-
-            // Distance of the line
-            int dx = x2 - x1;
-            int dy = y2 - y1;
-
-            // Positive (absolute) distance
-            int dxabs = Math.Abs(dx);
-            int dyabs = Math.Abs(dy);
-
-            // Half distance
-            int x = dyabs >> 1;
-            int y = dxabs >> 1;
-
-            // Direction
-            int sdx = Math.Sign(dx);
-            int sdy = Math.Sign(dy);
-
-            // Start position
-            int px = x1;
-            int py = y1;
-
-            // When the line is completely inside screen,
-            // then do an unchecked draw, because all of its pixels are
-            // guaranteed to be within the memory range
-            if ((x1 >= 0) && (x2 >= 0) && (x1 < visiblewidth) && (x2 < visiblewidth) &&
-               (y1 >= 0) && (y2 >= 0) && (y1 < visibleheight) && (y2 < visibleheight))
-            {
-                // Draw first pixel
-                pixels[py * width + px] = c;
-
-                // Check if the line is more horizontal than vertical
-                if (dxabs >= dyabs)
-                {
-                    for (int i = 0; i < dxabs; i++)
-                    {
-                        y += dyabs;
-                        if (y >= dxabs)
-                        {
-                            y -= dxabs;
-                            py += sdy;
-                        }
-                        px += sdx;
-
-                        // Draw pixel
-                        if ((mask & (1 << (i & 0x7))) != 0)
-                        {
-                            pixels[py * width + px] = c;
-                        }
-                    }
-                }
-                // Else the line is more vertical than horizontal
-                else
-                {
-                    for (int i = 0; i < dyabs; i++)
-                    {
-                        x += dxabs;
-                        if (x >= dyabs)
-                        {
-                            x -= dyabs;
-                            px += sdx;
-                        }
-                        py += sdy;
-
-                        // Draw pixel
-                        if ((mask & (1 << (i & 0x7))) != 0)
-                        {
-                            pixels[py * width + px] = c;
-                        }
-                    }
-                }
-            }
-            else
-            {
-                // Draw first pixel
-                if ((px >= 0) && (px < visiblewidth) && (py >= 0) && (py < visibleheight))
-                    pixels[py * width + px] = c;
-
-                // Check if the line is more horizontal than vertical
-                if (dxabs >= dyabs)
-                {
-                    for (int i = 0; i < dxabs; i++)
-                    {
-                        y += dyabs;
-                        if (y >= dxabs)
-                        {
-                            y -= dxabs;
-                            py += sdy;
-                        }
-                        px += sdx;
-
-                        // Draw pixel
-                        if ((mask & (1 << (i & 0x7))) != 0)
-                        {
-                            if ((px >= 0) && (px < visiblewidth) && (py >= 0) && (py < visibleheight))
-                                pixels[py * width + px] = c;
-                        }
-                    }
-                }
-                // Else the line is more vertical than horizontal
-                else
-                {
-                    for (int i = 0; i < dyabs; i++)
-                    {
-                        x += dxabs;
-                        if (x >= dyabs)
-                        {
-                            x -= dyabs;
-                            px += sdx;
-                        }
-                        py += sdy;
-
-                        // Draw pixel
-                        if ((mask & (1 << (i & 0x7))) != 0)
-                        {
-                            if ((px >= 0) && (px < visiblewidth) && (py >= 0) && (py < visibleheight))
-                                pixels[py * width + px] = c;
-                        }
-                    }
-                }
-            }
+            AddCommand(PlotterCommandType.LineSolid, x1, y1, x2, y2, 0, ref c, mask);
         }
 
         //mxd
@@ -413,18 +191,60 @@ namespace CodeImp.DoomBuilder.Rendering
 
         public void DrawContents(RenderDevice graphics)
         {
-            // set pixels of texture
-            // convert from pixelcolor to uint
-            fixed (PixelColor* pixels = this.pixels)
+            // Rasterize everything recorded since the last call into the texture
+            bool result;
+            fixed (PlotterCommand* cmds = commands)
             {
-                uint* uintpixels = (uint*)pixels;
-                uint* targetpixels = (uint*)graphics.MapPBO(Texture);
-                for (int i = 0; i < this.pixels.Length; i++)
-                    *targetpixels++ = *uintpixels++;
+                void* targetpixels = graphics.MapPBO(Texture);
+                result = Plotter_Draw(handle, cmds, numcommands, clearpending, targetpixels);
                 graphics.UnmapPBO(Texture);
             }
+
+            numcommands = 0;
+            clearpending = false;
+
+            if (!result)
+                throw new Exception("Plotter_Draw failed");
         }
 
         #endregion
+
+        #region ================== Native
+
+        private enum PlotterCommandType : int
+        {
+            PixelSolid,
+            PixelAlpha,
+            VertexSolid,
+            GridLineH,
+            GridLineV,
+            LineSolid
+        }
+
+        [StructLayout(LayoutKind.Sequential)]
+        private struct PlotterCommand
+        {
+            public PlotterCommandType Type;
+            public int X1;
+            public int Y1;
+            public int X2;
+            public int Y2;
+            public int Size;
+            public uint Color;
+            public uint LightColor;
+            public uint DarkColor;
+            public uint Mask;
+        }
+
+        [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+        static extern IntPtr Plotter_New(int width, int height);
+
+        [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+        static extern void Plotter_Delete(IntPtr handle);
+
+        [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+        static extern bool Plotter_Draw(IntPtr handle, PlotterCommand* commands, int count, bool clear, void* target);
+
+        #endregion
     }
 }
@@ -46,7 +46,28 @@ namespace CodeImp.DoomBuilder.Rendering
             RenderTarget = rendertarget;
 
             CreateDevice();
+            Initialize();
+        }
+
+        // Headless device without a window. The backbuffer is a framebuffer object of the given size.
+        public RenderDevice(int width, int height)
+        {
+            offscreensize = new Size(width, height);
+
+            SelectBackend();
+            Handle = RenderDevice_NewOffscreen(width, height);
+            if (Handle == IntPtr.Zero)
+            {
+                StringBuilder sb = new StringBuilder(4096);
+                BuilderNative_GetError(sb, sb.Capacity);
+                throw new RenderDeviceException(string.Format("Could not create offscreen render device: {0}", sb));
+            }
 
+            Initialize();
+        }
+
+        void Initialize()
+        {
             DeclareUniform(UniformName.rendersettings, "rendersettings", UniformType.Vec4f);
             DeclareUniform(UniformName.projection, "projection", UniformType.Mat4);
             DeclareUniform(UniformName.desaturation, "desaturation", UniformType.Float);
@@ -83,6 +104,9 @@ namespace CodeImp.DoomBuilder.Rendering
 
             DeclareUniform(UniformName.skew, "skew", UniformType.Vec2f);
 
+            // instanced rendering
+            DeclareUniform(UniformName.spriteAtlasGrid, "spriteAtlasGrid", UniformType.Vec2f);
+
             // 2d fsaa
             CompileShader(ShaderName.display2d_fsaa, "display2d.shader", "display2d_fsaa");
             
@@ -94,6 +118,7 @@ namespace CodeImp.DoomBuilder.Rendering
             CompileShader(ShaderName.things2d_thing, "things2d.shader", "things2d_thing");
             CompileShader(ShaderName.things2d_sprite, "things2d.shader", "things2d_sprite");
             CompileShader(ShaderName.things2d_fill, "things2d.shader", "things2d_fill");
+            CompileShader(ShaderName.things2d_thing_instanced, "things2d.shader", "things2d_thing_instanced");
 
             // non-fog 3d shaders
             CompileShader(ShaderName.world3d_main, "world3d.shader", "world3d_main");
@@ -129,8 +154,17 @@ namespace CodeImp.DoomBuilder.Rendering
             Dispose();
         }
 
+        // The native backend is fixed once the first device or resource has been created, so a changed setting applies after a restart
+        internal static void SelectBackend()
+        {
+            bool software = General.Settings != null && General.Settings.SoftwareRendering;
+            BuilderNative_SetBackend(software ? 1 : 0);
+        }
+
         void CreateDevice()
         {
+            SelectBackend();
+
             // Grab the X11 Display handle by abusing reflection to access internal classes in the mono implementation.
             // That's par for the course for everything in Linux, so yeah..
             IntPtr display = IntPtr.Zero;
@@ -140,7 +174,11 @@ namespace CodeImp.DoomBuilder.Rendering
                 display = (IntPtr)xplatui.GetField("DisplayHandle", BindingFlags.Static | BindingFlags.NonPublic).GetValue(null);
             }
 
-            Handle = RenderDevice_New(display, RenderTarget.Handle, General.DebugRenderDevice);
+            // The render thread would share the X11 display connection with WinForms, so threaded rendering is Windows only
+            if (General.Settings.ThreadedRendering && display == IntPtr.Zero)
+                Handle = RenderDevice_NewThreaded(display, RenderTarget.Handle, General.DebugRenderDevice);
+            else
+                Handle = RenderDevice_New(display, RenderTarget.Handle, General.DebugRenderDevice);
             if (Handle == IntPtr.Zero)
             {
                 StringBuilder sb = new StringBuilder(4096);
@@ -334,6 +372,11 @@ namespace CodeImp.DoomBuilder.Rendering
             RenderDevice_SetIndexBuffer(Handle, buffer != null ? buffer.Handle : IntPtr.Zero);
         }
 
+        public void SetInstanceBuffer(VertexBuffer buffer)
+        {
+            RenderDevice_SetInstanceBuffer(Handle, buffer != null ? buffer.Handle : IntPtr.Zero);
+        }
+
         public void SetAlphaBlendEnable(bool value)
         {
             RenderDevice_SetAlphaBlendEnable(Handle, value);
@@ -419,6 +462,12 @@ namespace CodeImp.DoomBuilder.Rendering
             ThrowIfFailed(RenderDevice_DrawData(Handle, type, startIndex, primitiveCount, data));
         }
 
+        // Draws the current vertex buffer once per InstanceVertex in the current instance buffer
+        public void DrawInstanced(PrimitiveType type, int startIndex, int primitiveCount, int instanceCount)
+        {
+            ThrowIfFailed(RenderDevice_DrawInstanced(Handle, type, startIndex, primitiveCount, instanceCount));
+        }
+
         public void StartRendering(bool clear, Color4 backcolor)
         {
             ThrowIfFailed(RenderDevice_StartRendering(Handle, clear, backcolor.ToArgb(), IntPtr.Zero, true));
@@ -429,6 +478,12 @@ namespace CodeImp.DoomBuilder.Rendering
             ThrowIfFailed(RenderDevice_StartRendering(Handle, clear, backcolor.ToArgb(), target.Handle, usedepthbuffer));
         }
 
+        // Renders directly into one face of the cube texture. Mipmaps are updated by FinishRendering.
+        public void StartRendering(bool clear, Color4 backcolor, CubeTexture target, CubeMapFace face)
+        {
+            ThrowIfFailed(RenderDevice_StartCubeRendering(Handle, clear, backcolor.ToArgb(), target.Handle, face));
+        }
+
         public void FinishRendering()
         {
             ThrowIfFailed(RenderDevice_FinishRendering(Handle));
@@ -456,7 +511,14 @@ namespace CodeImp.DoomBuilder.Rendering
 
         public void SetBufferData(VertexBuffer buffer, int length, VertexFormat format)
         {
-            int stride = (format == VertexFormat.Flat) ? FlatVertex.Stride : WorldVertex.Stride;
+            // WorldCompact buffers are filled with WorldVertex data and packed by the device
+            int stride;
+            switch (format)
+            {
+                case VertexFormat.Flat: stride = FlatVertex.Stride; break;
+                case VertexFormat.Instance: stride = InstanceVertex.Stride; break;
+                default: stride = WorldVertex.Stride; break;
+            }
             ThrowIfFailed(RenderDevice_SetVertexBufferData(Handle, buffer.Handle, IntPtr.Zero, length * stride, format));
         }
 
@@ -470,6 +532,11 @@ namespace CodeImp.DoomBuilder.Rendering
             ThrowIfFailed(RenderDevice_SetVertexBufferData(Handle, buffer.Handle, data, data.Length * Marshal.SizeOf<WorldVertex>(), VertexFormat.World));
         }
 
+        public void SetBufferData(VertexBuffer buffer, InstanceVertex[] data)
+        {
+            ThrowIfFailed(RenderDevice_SetVertexBufferData(Handle, buffer.Handle, data, data.Length * Marshal.SizeOf<InstanceVertex>(), VertexFormat.Instance));
+        }
+
         public void SetBufferSubdata(VertexBuffer buffer, long destOffset, FlatVertex[] data)
         {
             ThrowIfFailed(RenderDevice_SetVertexBufferSubdata(Handle, buffer.Handle, destOffset * FlatVertex.Stride, data, data.Length * FlatVertex.Stride));
@@ -486,6 +553,12 @@ namespace CodeImp.DoomBuilder.Rendering
             ThrowIfFailed(RenderDevice_SetVertexBufferSubdata(Handle, buffer.Handle, 0, data, size * FlatVertex.Stride));
         }
 
+        public void SetBufferSubdata(VertexBuffer buffer, InstanceVertex[] data, long size)
+        {
+            if (size < 0 || size > data.Length) throw new ArgumentOutOfRangeException("size");
+            ThrowIfFailed(RenderDevice_SetVertexBufferSubdata(Handle, buffer.Handle, 0, data, size * InstanceVertex.Stride));
+        }
+
         public void SetPixels(Texture texture, System.Drawing.Bitmap bitmap)
         {
             System.Drawing.Imaging.BitmapData bmpdata = bitmap.LockBits(
@@ -537,6 +610,26 @@ namespace CodeImp.DoomBuilder.Rendering
             ThrowIfFailed(RenderDevice_UnmapPBO(Handle, texture.Handle));
         }
 
+        // Starts reading back a render target, or the backbuffer when target is null. The backbuffer must be read before Present.
+        // Rows are stored bottom to top. Readbacks of the same target are mapped in the order they were requested.
+        public void ReadPixelsAsync(Texture target, TextureFormat format)
+        {
+            ThrowIfFailed(RenderDevice_ReadPixelsAsync(Handle, target != null ? target.Handle : IntPtr.Zero, format));
+        }
+
+        // Returns IntPtr.Zero if the oldest readback of the target isn't finished yet and wait is false
+        public IntPtr MapReadback(Texture target, bool wait)
+        {
+            IntPtr data;
+            ThrowIfFailed(RenderDevice_MapReadback(Handle, target != null ? target.Handle : IntPtr.Zero, wait, out data));
+            return data;
+        }
+
+        public void UnmapReadback(Texture target)
+        {
+            ThrowIfFailed(RenderDevice_UnmapReadback(Handle, target != null ? target.Handle : IntPtr.Zero));
+        }
+
         internal void RegisterResource(IRenderResource res)
         {
         }
@@ -579,6 +672,12 @@ namespace CodeImp.DoomBuilder.Rendering
         [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
         static extern IntPtr RenderDevice_New(IntPtr display, IntPtr window, bool debug);
 
+        [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+        static extern IntPtr RenderDevice_NewThreaded(IntPtr display, IntPtr window, bool debug);
+
+        [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+        static extern IntPtr RenderDevice_NewOffscreen(int width, int height);
+
         [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
         static extern void RenderDevice_Delete(IntPtr handle);
 
@@ -591,6 +690,9 @@ namespace CodeImp.DoomBuilder.Rendering
         [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
         static extern void BuilderNative_GetError(StringBuilder str, int length);
 
+        [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+        static extern bool BuilderNative_SetBackend(int type);
+
         [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
         static extern bool RenderDevice_SetShader(IntPtr handle, ShaderName name);
 
@@ -657,9 +759,18 @@ namespace CodeImp.DoomBuilder.Rendering
         [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
         static extern bool RenderDevice_DrawData(IntPtr handle, PrimitiveType type, int startIndex, int primitiveCount, FlatVertex[] data);
 
+        [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+        static extern void RenderDevice_SetInstanceBuffer(IntPtr handle, IntPtr buffer);
+
+        [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+        static extern bool RenderDevice_DrawInstanced(IntPtr handle, PrimitiveType type, int startIndex, int primitiveCount, int instanceCount);
+
         [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
         static extern bool RenderDevice_StartRendering(IntPtr handle, bool clear, int backcolor, IntPtr target, bool usedepthbuffer);
 
+        [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+        static extern bool RenderDevice_StartCubeRendering(IntPtr handle, bool clear, int backcolor, IntPtr target, CubeMapFace face);
+
         [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
         static extern bool RenderDevice_FinishRendering(IntPtr handle);
 
@@ -684,12 +795,18 @@ namespace CodeImp.DoomBuilder.Rendering
         [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
         static extern bool RenderDevice_SetVertexBufferData(IntPtr handle, IntPtr buffer, WorldVertex[] data, long size, VertexFormat format);
 
+        [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+        static extern bool RenderDevice_SetVertexBufferData(IntPtr handle, IntPtr buffer, InstanceVertex[] data, long size, VertexFormat format);
+
         [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
         static extern bool RenderDevice_SetVertexBufferSubdata(IntPtr handle, IntPtr buffer, long destOffset, FlatVertex[] data, long sizeInBytes);
 
         [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
         static extern bool RenderDevice_SetVertexBufferSubdata(IntPtr handle, IntPtr buffer, long destOffset, WorldVertex[] data, long sizeInBytes);
 
+        [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+        static extern bool RenderDevice_SetVertexBufferSubdata(IntPtr handle, IntPtr buffer, long destOffset, InstanceVertex[] data, long sizeInBytes);
+
         [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
         protected static extern bool RenderDevice_SetPixels(IntPtr handle, IntPtr texture, IntPtr data);
 
@@ -699,6 +816,15 @@ namespace CodeImp.DoomBuilder.Rendering
         [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
         protected static extern bool RenderDevice_UnmapPBO(IntPtr handle, IntPtr texture);
 
+        [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+        static extern bool RenderDevice_ReadPixelsAsync(IntPtr handle, IntPtr target, TextureFormat format);
+
+        [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+        static extern bool RenderDevice_MapReadback(IntPtr handle, IntPtr target, bool wait, out IntPtr data);
+
+        [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+        static extern bool RenderDevice_UnmapReadback(IntPtr handle, IntPtr target);
+
         [DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
         protected static extern bool RenderDevice_SetCubePixels(IntPtr handle, IntPtr texture, CubeMapFace face, IntPtr data);
 
@@ -710,6 +836,10 @@ namespace CodeImp.DoomBuilder.Rendering
 
         internal RenderTargetControl RenderTarget { get; private set; }
 
+        // Size of the backbuffer, for both window and offscreen devices
+        internal Size ClientSize { get { return (RenderTarget != null) ? RenderTarget.ClientSize : offscreensize; } }
+        Size offscreensize;
+
 		// This makes a Vector3 from Vector3D
 		public static Vector3f V3(Vector3D v3d)
 		{
@@ -763,7 +893,8 @@ namespace CodeImp.DoomBuilder.Rendering
 		world3d_slope_handle,
         world3d_classic,
         world3d_p19,
-        world3d_classic_highlight
+        world3d_classic_highlight,
+        things2d_thing_instanced
     }
 
     public enum UniformType : int
@@ -813,10 +944,11 @@ namespace CodeImp.DoomBuilder.Rendering
         doomlightlevels,
         skew,
 		lightStrengthAndLinearity,
-		useLightStrength
+		useLightStrength,
+        spriteAtlasGrid
     }
 
-    public enum VertexFormat : int { Flat, World }
+    public enum VertexFormat : int { Flat, World, WorldCompact, Instance }
     public enum Cull : int { None, Clockwise }
     public enum Blend : int { InverseSourceAlpha, SourceAlpha, One }
     public enum BlendOperation : int { Add, ReverseSubtract }
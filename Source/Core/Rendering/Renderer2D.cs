@@ -76,6 +76,10 @@ namespace CodeImp.DoomBuilder.Rendering
 		
 		// Batch buffer for things rendering
 		private VertexBuffer thingsvertices;
+
+		// Thing boxes are drawn as instances of one quad
+		private VertexBuffer thingsquad;
+		private VertexBuffer thingsinstances;
 		
 		// Render settings
 		private int vertexsize;
@@ -363,7 +367,11 @@ namespace CodeImp.DoomBuilder.Rendering
 			
 			// Trash things batch buffer
 			if(thingsvertices != null) thingsvertices.Dispose();
+			if(thingsquad != null) thingsquad.Dispose();
+			if(thingsinstances != null) thingsinstances.Dispose();
 			thingsvertices = null;
+			thingsquad = null;
+			thingsinstances = null;
 			lastgridscale = -1f;
 			lastgridsize = 0.0f;
 		}
@@ -375,8 +383,8 @@ namespace CodeImp.DoomBuilder.Rendering
 			DestroyRendertargets();
 
 			// Get new width and height
-			windowsize.Width = graphics.RenderTarget.ClientSize.Width;
-			windowsize.Height = graphics.RenderTarget.ClientSize.Height;
+			windowsize.Width = graphics.ClientSize.Width;
+			windowsize.Height = graphics.ClientSize.Height;
 
 			// Create rendertargets textures
 			plotter = new Plotter(windowsize.Width, windowsize.Height);
@@ -403,6 +411,10 @@ namespace CodeImp.DoomBuilder.Rendering
 			screenverts = new VertexBuffer();
 			thingsvertices = new VertexBuffer();
             graphics.SetBufferData(thingsvertices, THING_BUFFER_SIZE * 12, VertexFormat.Flat);
+			thingsquad = new VertexBuffer();
+			graphics.SetBufferData(thingsquad, CreateThingQuadVerts());
+			thingsinstances = new VertexBuffer();
+			graphics.SetBufferData(thingsinstances, THING_BUFFER_SIZE, VertexFormat.Instance);
 
 			// Make screen vertices
 			FlatVertex[] verts = CreateScreenVerts(new Size(windowsize.Width, windowsize.Height));
@@ -1074,9 +1086,38 @@ namespace CodeImp.DoomBuilder.Rendering
 
 		#region ================== Things
 
-		// This makes vertices for a thing
+		// This makes the quad that thing boxes are instanced from
+		private static FlatVertex[] CreateThingQuadVerts()
+		{
+			FlatVertex[] verts = new FlatVertex[6];
+			verts[0].x = -1f;
+			verts[0].y = -1f;
+			verts[0].c = -1;
+			verts[0].u = 0f;
+			verts[0].v = 0f;
+			verts[1].x = 1f;
+			verts[1].y = -1f;
+			verts[1].c = -1;
+			verts[1].u = 1f;
+			verts[1].v = 0f;
+			verts[2].x = -1f;
+			verts[2].y = 1f;
+			verts[2].c = -1;
+			verts[2].u = 0f;
+			verts[2].v = 1f;
+			verts[3] = verts[1];
+			verts[4] = verts[2];
+			verts[5].x = 1f;
+			verts[5].y = 1f;
+			verts[5].c = -1;
+			verts[5].u = 1f;
+			verts[5].v = 1f;
+			return verts;
+		}
+
+		// This makes the box instance for a thing
 		// Returns false when not on the screen
-		private bool CreateThingBoxVerts(Thing t, ref FlatVertex[] verts, ref List<Line3D> bboxes, Dictionary<Thing, Vector3D> thingsByPosition, int offset, PixelColor c, byte bboxalpha)
+		private bool CreateThingBoxInstance(Thing t, InstanceVertex[] instances, List<Line3D> bboxes, Dictionary<Thing, Vector3D> thingsByPosition, int offset, PixelColor c, byte bboxalpha)
 		{
 			if(t.Size * scale < MINIMUM_THING_RADIUS) return false; //mxd. Don't render tiny little things
 
@@ -1109,37 +1150,14 @@ namespace CodeImp.DoomBuilder.Rendering
 			   ((screenpos.y + screensize) <= 0.0f) || ((screenpos.y - screensize) >= windowsize.Height))
 				return false;
 
-			// Get integral color
-			int color = c.ToInt();
-
 			// Setup fixed rect for circle
-			verts[offset].x = (float)screenpos.x - circlesize;
-			verts[offset].y = (float)screenpos.y - circlesize;
-			verts[offset].c = color;
-			verts[offset].u = 0f;
-			verts[offset].v = 0f;
-			offset++;
-			verts[offset].x = (float)screenpos.x + circlesize;
-			verts[offset].y = (float)screenpos.y - circlesize;
-			verts[offset].c = color;
-			verts[offset].u = 0.5f;
-			verts[offset].v = 0f;
-			offset++;
-			verts[offset].x = (float)screenpos.x - circlesize;
-			verts[offset].y = (float)screenpos.y + circlesize;
-			verts[offset].c = color;
-			verts[offset].u = 0f;
-			verts[offset].v = 1f;
-			offset++;
-			verts[offset] = verts[offset - 2];
-			offset++;
-			verts[offset] = verts[offset - 2];
-			offset++;
-			verts[offset].x = (float)screenpos.x + circlesize;
-			verts[offset].y = (float)screenpos.y + circlesize;
-			verts[offset].c = color;
-			verts[offset].u = 0.5f;
-			verts[offset].v = 1f;
+			instances[offset].x = (float)screenpos.x;
+			instances[offset].y = (float)screenpos.y;
+			instances[offset].z = 0f;
+			instances[offset].size = circlesize;
+			instances[offset].angle = 0f;
+			instances[offset].sprite = 0f;
+			instances[offset].c = c.ToInt();
 
 			//mxd. Add to list
 			thingsByPosition.Add(t, screenpos);
@@ -1280,17 +1298,22 @@ namespace CodeImp.DoomBuilder.Rendering
 				graphics.SetDestinationBlend(Blend.InverseSourceAlpha);
 				graphics.SetAlphaTestEnable(false);
                 graphics.SetUniform(UniformName.texturefactor, alphacolor);
-				graphics.SetVertexBuffer(thingsvertices);
 				
 				// Set things texture
 				graphics.SetTexture(General.Map.Data.ThingTexture.Texture); //mxd
 				SetWorldTransformation(false);
-                graphics.SetShader(ShaderName.things2d_thing);
 				SetThings2DSettings(alpha);
 				
+				// Thing boxes are instances of one quad. The box is the left cell of the things texture.
+				graphics.SetShader(ShaderName.things2d_thing_instanced);
+				graphics.SetUniform(UniformName.spriteAtlasGrid, new Vector2f(2f, 1f));
+				graphics.SetVertexBuffer(thingsquad);
+				graphics.SetInstanceBuffer(thingsinstances);
+
 				// Determine next lock size
 				int locksize = (things.Count > THING_BUFFER_SIZE) ? THING_BUFFER_SIZE : things.Count;
-				FlatVertex[] verts = new FlatVertex[THING_BUFFER_SIZE * 6];
+				InstanceVertex[] instances = new InstanceVertex[THING_BUFFER_SIZE];
+				FlatVertex[] verts;
 				List<Line3D> bboxes = new List<Line3D>(locksize); //mxd
 
 				//mxd
@@ -1313,10 +1336,10 @@ namespace CodeImp.DoomBuilder.Rendering
 						modelsByType[t.Type].Add(t);
 					}
 					
-					// Create vertices
+					// Create instance
 					PixelColor tc = fixedcolor ? c : DetermineThingColor(t);
 					byte bboxalpha = (byte)(alpha * ((!fixedcolor && !t.Selected && isthingsmode) ? 128 : 255));
-					if(CreateThingBoxVerts(t, ref verts, ref bboxes, thingsByPosition, buffercount * 6, tc, bboxalpha))
+					if(CreateThingBoxInstance(t, instances, bboxes, thingsByPosition, buffercount, tc, bboxalpha))
 					{
 						buffercount++;
 
@@ -1331,10 +1354,10 @@ namespace CodeImp.DoomBuilder.Rendering
 					if(buffercount == locksize)
 					{
 						// Write to buffer
-                        graphics.SetBufferSubdata(thingsvertices, verts, buffercount * 6);
+						graphics.SetBufferSubdata(thingsinstances, instances, buffercount);
 						
 						// Draw!
-						graphics.Draw(PrimitiveType.TriangleList, 0, buffercount * 2);
+						graphics.DrawInstanced(PrimitiveType.TriangleList, 0, 2, buffercount);
 						buffercount = 0;
 						
 						// Determine next lock size
@@ -1343,11 +1366,15 @@ namespace CodeImp.DoomBuilder.Rendering
 				}
 
 				// Write to buffer
-				if(buffercount > 0) graphics.SetBufferSubdata(thingsvertices, verts, buffercount * 6);
+				if(buffercount > 0) graphics.SetBufferSubdata(thingsinstances, instances, buffercount);
 				
 				// Draw what's still remaining
 				if(buffercount > 0)
-					graphics.Draw(PrimitiveType.TriangleList, 0, buffercount * 2);
+					graphics.DrawInstanced(PrimitiveType.TriangleList, 0, 2, buffercount);
+
+				// The remaining passes write their vertices per thing
+				graphics.SetInstanceBuffer(null);
+				graphics.SetVertexBuffer(thingsvertices);
 
 				//mxd. Render sprites
 				int selectionColor = General.Colors.Selection.ToInt();
@@ -1622,7 +1649,7 @@ namespace CodeImp.DoomBuilder.Rendering
 			renderlayer = RenderLayers.Surface;
 
             // Recreate render targets if the window was resized
-            if (windowsize.Width != graphics.RenderTarget.ClientSize.Width || windowsize.Height != graphics.RenderTarget.ClientSize.Height)
+            if (windowsize.Width != graphics.ClientSize.Width || windowsize.Height != graphics.ClientSize.Height)
                 CreateRendertargets();
 
 			// Rendertargets available?
@@ -149,6 +149,18 @@ namespace CodeImp.DoomBuilder.Rendering.Shaders
                         case "Normal":
                             location = 3;
                             break;
+                        case "PackedNormal":
+                            location = 4;
+                            break;
+                        case "InstancePosition":
+                            location = 5;
+                            break;
+                        case "InstanceParams":
+                            location = 6;
+                            break;
+                        case "InstanceColor":
+                            location = 7;
+                            break;
                         default:
                             throw new ShaderCompileException("Invalid input field {0} (not supported)", field.Name);
                     }
@@ -11,6 +11,9 @@ uniforms
 	vec4 texturefactor;
 
 	vec4 fillColor;
+
+	// Columns and rows of the sprite atlas used by instanced shaders
+	vec2 spriteAtlasGrid;
 }
 
 functions
@@ -20,6 +23,13 @@ functions
 		float gray = (texel.r * 0.3 + texel.g * 0.56 + texel.b * 0.14);
 		return mix(texel, vec3(gray), desaturation);
 	}
+
+	vec2 getSpriteUV(vec2 uv, float sprite)
+	{
+		vec2 grid = max(spriteAtlasGrid, vec2(1.0));
+		vec2 cell = vec2(mod(sprite, grid.x), floor(sprite / grid.x));
+		return (cell + uv) / grid;
+	}
 }
 
 shader things2d
@@ -102,4 +112,29 @@ shader things2d_sprite extends things2d
 		if (out.FragColor.a < 0.5) discard;
 		#endif
 	}
+}
+
+// Draws one thing per instance. The vertex buffer holds a unit quad centered on the origin.
+shader things2d_thing_instanced extends things2d_thing
+{
+	in
+	{
+		vec3 Position;
+		vec4 Color;
+		vec2 TextureCoordinate;
+		vec3 InstancePosition;
+		vec3 InstanceParams; // size, angle, sprite index
+		vec4 InstanceColor;
+	}
+
+	vertex
+	{
+		vec2 corner = in.Position.xy * in.InstanceParams.x;
+		float s = sin(in.InstanceParams.y);
+		float c = cos(in.InstanceParams.y);
+		vec2 rotated = vec2(corner.x * c - corner.y * s, corner.x * s + corner.y * c);
+		gl_Position = projection * vec4(in.InstancePosition + vec3(rotated, in.Position.z), 1.0);
+		v2f.Color = in.Color * in.InstanceColor;
+		v2f.UV = getSpriteUV(in.TextureCoordinate, in.InstanceParams.z);
+	}
 }
\ No newline at end of file
@@ -117,6 +117,20 @@ functions
         return level;
     }
 
+	// WorldCompact vertices store an octahedral normal in xy and set z to mark it as present
+	vec3 getVertexNormal(vec3 normal, vec4 packednormal)
+	{
+		if (packednormal.z < 0.5)
+			return normal;
+
+		vec3 n = vec3(packednormal.xy, 1.0 - abs(packednormal.x) - abs(packednormal.y));
+		if (n.z < 0.0)
+		{
+			n.xy = (1.0 - abs(n.yx)) * (step(0.0, n.xy) * 2.0 - 1.0);
+		}
+		return normalize(n);
+	}
+
 	// This adds fog color to current pixel color
 	vec4 getFogColor(vec3 PosW, vec4 color)
 	{
@@ -211,6 +225,7 @@ shader world3d_main
 		vec4 Color;
 		vec2 TextureCoordinate;
 		vec3 Normal;
+		vec4 PackedNormal;
 	}
 
 	v2f
@@ -236,9 +251,10 @@ shader world3d_main
 		v2f.PosW = (world * vec4(in.Position, 1.0)).xyz;
 		v2f.Color = in.Color;
 		v2f.UV = in.TextureCoordinate;
-		v2f.Normal = normalize((modelnormal * vec4(in.Normal, 1.0)).xyz);
+		vec3 normal = getVertexNormal(in.Normal, in.PackedNormal);
+		v2f.Normal = normalize((modelnormal * vec4(normal, 1.0)).xyz);
 		v2f.flatColor = in.Color;
-		v2f.flatNormal = normalize(in.Normal);
+		v2f.flatNormal = normalize(normal);
 	}
 	
 	fragment
@@ -440,7 +456,7 @@ shader world3d_main_fog_vertexcolor extends world3d_main_fog
 		v2f.PosW = (world * vec4(in.Position, 1.0)).xyz;
 		v2f.Color = vertexColor;
 		v2f.UV = in.TextureCoordinate;
-		v2f.Normal = normalize((modelnormal * vec4(in.Normal, 1.0)).xyz);
+		v2f.Normal = normalize((modelnormal * vec4(getVertexNormal(in.Normal, in.PackedNormal), 1.0)).xyz);
 	}
 }
 
@@ -453,7 +469,7 @@ shader world3d_main_highlight_fog_vertexcolor extends world3d_main_highlight_fog
 		v2f.PosW = (world * vec4(in.Position, 1.0)).xyz;
 		v2f.Color = vertexColor;
 		v2f.UV = in.TextureCoordinate;
-		v2f.Normal = normalize((modelnormal * vec4(in.Normal, 1.0)).xyz);
+		v2f.Normal = normalize((modelnormal * vec4(getVertexNormal(in.Normal, in.PackedNormal), 1.0)).xyz);
 	}
 }
 
@@ -140,9 +140,9 @@ namespace CodeImp.DoomBuilder.VisualModes
 			// Any vertics?
 			if(numverts > 0)
 			{
-				// Make a new buffer
+				// Make a new buffer. Compact buffers only pack the normals
 				geobuffer = new VertexBuffer();
-                graphics.SetBufferData(geobuffer, numverts, VertexFormat.World);
+                graphics.SetBufferData(geobuffer, numverts, General.Settings.CompactWorldVertices ? VertexFormat.WorldCompact : VertexFormat.World);
 
 				// Fill the buffer
 				foreach(VisualGeometry g in allgeometry)
@@ -369,12 +369,11 @@ namespace CodeImp.DoomBuilder.VisualModes
 
 						// Apply transform
 						float zoffset = ((thing.Pitch == 0f && thing.Position.z == 0f) ? 0.1f : 0f); // Slight offset to avoid z-fighting...
-						for(int i = 0; i < vertices[c].Length; i++)
+						Matrix.TransformCoordinates(vertices[c], transform);
+						if(zoffset != 0f)
 						{
-							Vector4f transformed = Vector3f.Transform(new Vector3f(vertices[c][i].x, vertices[c][i].y, vertices[c][i].z), transform);
-							vertices[c][i].x = transformed.X;
-							vertices[c][i].y = transformed.Y;
-							vertices[c][i].z = transformed.Z + zoffset;
+							for(int i = 0; i < vertices[c].Length; i++)
+								vertices[c][i].z += zoffset;
 						}
 						break;
 
@@ -397,13 +396,7 @@ namespace CodeImp.DoomBuilder.VisualModes
 						}
 
 						// Apply transform
-						for(int i = 0; i < vertices[c].Length; i++)
-						{
-							Vector4f transformed = Vector3f.Transform(new Vector3f(vertices[c][i].x, vertices[c][i].y, vertices[c][i].z), transform);
-							vertices[c][i].x = transformed.X;
-							vertices[c][i].y = transformed.Y;
-							vertices[c][i].z = transformed.Z;
-						}
+						Matrix.TransformCoordinates(vertices[c], transform);
 						break;
 
 					#region Some old GLOOME FLOOR_SPRITE/CEILING_SPRITE support code
@@ -508,13 +501,7 @@ namespace CodeImp.DoomBuilder.VisualModes
 						}
 
 						// Apply transform
-						for(int i = 0; i < vertices[c].Length; i++)
-						{
-							Vector4f transformed = Vector3f.Transform(new Vector3f(vertices[c][i].x, vertices[c][i].y, vertices[c][i].z), transform);
-							vertices[c][i].x = transformed.X;
-							vertices[c][i].y = transformed.Y;
-							vertices[c][i].z = transformed.Z;
-						}
+						Matrix.TransformCoordinates(vertices[c], transform);
 						break;
 
 					default: throw new NotImplementedException("Unknown ThingRenderMode");
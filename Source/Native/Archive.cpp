@@ -0,0 +1,793 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "Precomp.h"
+#include "Archive.h"
+#include "Backend.h"
+#include "Inflate.h"
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	uint16_t ReadUInt16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+	uint32_t ReadUInt32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+	uint64_t ReadUInt64(const uint8_t* p) { return ReadUInt32(p) | ((uint64_t)ReadUInt32(p + 4) << 32); }
+
+	const uint32_t ZipLocalHeader = 0x04034b50;
+	const uint32_t ZipCentralHeader = 0x02014b50;
+	const uint32_t ZipEndOfDirectory = 0x06054b50;
+	const uint32_t Zip64EndOfDirectory = 0x06064b50;
+	const uint32_t Zip64Locator = 0x07064b50;
+	const uint16_t Zip64ExtraField = 0x0001;
+
+	const int MethodStored = 0;
+	const int MethodDeflate = 8;
+
+	// Code page 437 characters 128-255, for zip entry names without the UTF-8 flag
+	const uint16_t CP437[128] =
+	{
+		0x00c7, 0x00fc, 0x00e9, 0x00e2, 0x00e4, 0x00e0, 0x00e5, 0x00e7, 0x00ea, 0x00eb, 0x00e8, 0x00ef, 0x00ee, 0x00ec, 0x00c4, 0x00c5,
+		0x00c9, 0x00e6, 0x00c6, 0x00f4, 0x00f6, 0x00f2, 0x00fb, 0x00f9, 0x00ff, 0x00d6, 0x00dc, 0x00a2, 0x00a3, 0x00a5, 0x20a7, 0x0192,
+		0x00e1, 0x00ed, 0x00f3, 0x00fa, 0x00f1, 0x00d1, 0x00aa, 0x00ba, 0x00bf, 0x2310, 0x00ac, 0x00bd, 0x00bc, 0x00a1, 0x00ab, 0x00bb,
+		0x2591, 0x2592, 0x2593, 0x2502, 0x2524, 0x2561, 0x2562, 0x2556, 0x2555, 0x2563, 0x2551, 0x2557, 0x255d, 0x255c, 0x255b, 0x2510,
+		0x2514, 0x2534, 0x252c, 0x251c, 0x2500, 0x253c, 0x255e, 0x255f, 0x255a, 0x2554, 0x2569, 0x2566, 0x2560, 0x2550, 0x256c, 0x2567,
+		0x2568, 0x2564, 0x2565, 0x2559, 0x2558, 0x2552, 0x2553, 0x256b, 0x256a, 0x2518, 0x250c, 0x2588, 0x2584, 0x258c, 0x2590, 0x2580,
+		0x03b1, 0x00df, 0x0393, 0x03c0, 0x03a3, 0x03c3, 0x00b5, 0x03c4, 0x03a6, 0x0398, 0x03a9, 0x03b4, 0x221e, 0x03c6, 0x03b5, 0x2229,
+		0x2261, 0x00b1, 0x2265, 0x2264, 0x2320, 0x2321, 0x00f7, 0x2248, 0x00b0, 0x2219, 0x00b7, 0x221a, 0x207f, 0x00b2, 0x25a0, 0x00a0
+	};
+
+	std::string CP437ToUTF8(const uint8_t* name, size_t length)
+	{
+		std::string result;
+		result.reserve(length);
+		for (size_t i = 0; i < length; i++)
+		{
+			uint32_t c = (name[i] < 128) ? name[i] : CP437[name[i] - 128];
+			if (c < 0x80)
+			{
+				result.push_back((char)c);
+			}
+			else if (c < 0x800)
+			{
+				result.push_back((char)(0xc0 | (c >> 6)));
+				result.push_back((char)(0x80 | (c & 0x3f)));
+			}
+			else
+			{
+				result.push_back((char)(0xe0 | (c >> 12)));
+				result.push_back((char)(0x80 | ((c >> 6) & 0x3f)));
+				result.push_back((char)(0x80 | (c & 0x3f)));
+			}
+		}
+		return result;
+	}
+
+	char FoldNameChar(char c)
+	{
+		if (c >= 'A' && c <= 'Z')
+			return c - 'A' + 'a';
+		else if (c == '\\')
+			return '/';
+		else
+			return c;
+	}
+
+	// Buffers for inflated entries, in sizes of powers of two. Loading resources inflates thousands of
+	// entries of about the same sizes, so keeping the buffers around saves most of the allocations.
+	class BufferPool
+	{
+	public:
+		struct Buffer
+		{
+			int SizeClass; // -1 for buffers that are too big to keep
+			Buffer* Next;
+		};
+
+		uint8_t* Alloc(uint64_t size, void** handle)
+		{
+			int sizeclass = MinSizeClass;
+			while (sizeclass <= MaxSizeClass && ((uint64_t)1 << sizeclass) < size)
+				sizeclass++;
+
+			Buffer* buffer = nullptr;
+			if (sizeclass <= MaxSizeClass)
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				buffer = mFree[sizeclass - MinSizeClass];
+				if (buffer)
+				{
+					mFree[sizeclass - MinSizeClass] = buffer->Next;
+					mFreeBytes -= (uint64_t)1 << sizeclass;
+				}
+			}
+			else
+			{
+				sizeclass = -1;
+			}
+
+			if (!buffer)
+			{
+				uint64_t capacity = (sizeclass != -1) ? ((uint64_t)1 << sizeclass) : size;
+				buffer = (Buffer*)malloc(sizeof(Buffer) + capacity);
+				if (!buffer)
+					return nullptr;
+				buffer->SizeClass = sizeclass;
+			}
+
+			buffer->Next = nullptr;
+			*handle = buffer;
+			return (uint8_t*)(buffer + 1);
+		}
+
+		void Free(void* handle)
+		{
+			Buffer* buffer = (Buffer*)handle;
+			if (buffer->SizeClass != -1)
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				uint64_t capacity = (uint64_t)1 << buffer->SizeClass;
+				if (mFreeBytes + capacity <= MaxFreeBytes)
+				{
+					buffer->Next = mFree[buffer->SizeClass - MinSizeClass];
+					mFree[buffer->SizeClass - MinSizeClass] = buffer;
+					mFreeBytes += capacity;
+					return;
+				}
+			}
+			free(buffer);
+		}
+
+	private:
+		static const int MinSizeClass = 12; // 4 KB
+		static const int MaxSizeClass = 24; // 16 MB
+		static const uint64_t MaxFreeBytes = 64 << 20;
+
+		std::mutex mMutex;
+		Buffer* mFree[MaxSizeClass - MinSizeClass + 1] = {};
+		uint64_t mFreeBytes = 0;
+	};
+
+	// Never destroyed, since buffers can be given back while the library unloads
+	BufferPool* SharedBufferPool = new BufferPool();
+}
+
+Archive::Archive()
+{
+}
+
+Archive::~Archive()
+{
+	CloseFile();
+}
+
+bool Archive::Open(const char* filename)
+{
+	CloseFile();
+	mEntries.clear();
+
+	if (!OpenFile(filename))
+		return false;
+
+	uint8_t header[12];
+	if (mSize >= 12 && ReadAt(0, header, 12) && (memcmp(header, "IWAD", 4) == 0 || memcmp(header, "PWAD", 4) == 0))
+	{
+		mFormat = ArchiveFormat::WAD;
+		if (!ReadWAD(header))
+			return false;
+	}
+	else
+	{
+		mFormat = ArchiveFormat::Zip;
+		if (!ReadZip())
+			return false;
+	}
+
+	BuildNameTable();
+	return true;
+}
+
+#ifdef WIN32
+
+bool Archive::OpenFile(const char* filename)
+{
+	int length = MultiByteToWideChar(CP_UTF8, 0, filename, -1, nullptr, 0);
+	std::wstring wfilename(length, 0);
+	MultiByteToWideChar(CP_UTF8, 0, filename, -1, &wfilename[0], length);
+
+	// Other programs may write, replace or delete the file while it is open
+	mFile = CreateFileW(wfilename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (mFile == INVALID_HANDLE_VALUE)
+	{
+		SetError("Could not open %s", filename);
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(mFile, &size))
+	{
+		SetError("Could not get the size of %s", filename);
+		return false;
+	}
+
+	mSize = size.QuadPart;
+	return true;
+}
+
+void Archive::CloseFile()
+{
+	if (mFile != INVALID_HANDLE_VALUE)
+		CloseHandle(mFile);
+
+	mFile = INVALID_HANDLE_VALUE;
+	mSize = 0;
+}
+
+bool Archive::ReadAt(uint64_t offset, void* dst, uint64_t size) const
+{
+	uint8_t* out = (uint8_t*)dst;
+	while (size > 0)
+	{
+		// The offset is passed with every read, so that several threads can read at once
+		OVERLAPPED overlapped = {};
+		overlapped.Offset = (DWORD)offset;
+		overlapped.OffsetHigh = (DWORD)(offset >> 32);
+
+		DWORD count = (DWORD)std::min(size, (uint64_t)0x40000000);
+		DWORD read = 0;
+		if (!ReadFile(mFile, out, count, &read, &overlapped) || read == 0)
+			return false;
+
+		out += read;
+		offset += read;
+		size -= read;
+	}
+	return true;
+}
+
+#else
+
+bool Archive::OpenFile(const char* filename)
+{
+	mFile = open(filename, O_RDONLY);
+	if (mFile == -1)
+	{
+		SetError("Could not open %s", filename);
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(mFile, &info) != 0)
+	{
+		SetError("Could not get the size of %s", filename);
+		return false;
+	}
+
+	mSize = info.st_size;
+	return true;
+}
+
+void Archive::CloseFile()
+{
+	if (mFile != -1)
+		close(mFile);
+
+	mFile = -1;
+	mSize = 0;
+}
+
+bool Archive::ReadAt(uint64_t offset, void* dst, uint64_t size) const
+{
+	uint8_t* out = (uint8_t*)dst;
+	while (size > 0)
+	{
+		size_t count = (size_t)std::min(size, (uint64_t)0x40000000);
+		ssize_t result = pread(mFile, out, count, (off_t)offset);
+		if (result == -1 && errno == EINTR)
+			continue;
+		if (result <= 0)
+			return false;
+
+		out += result;
+		offset += result;
+		size -= result;
+	}
+	return true;
+}
+
+#endif
+
+bool Archive::ReadWAD(const uint8_t* header)
+{
+	int32_t numlumps = (int32_t)ReadUInt32(header + 4);
+	int32_t lumpsoffset = (int32_t)ReadUInt32(header + 8);
+	if (numlumps < 0 || lumpsoffset < 0 || (uint64_t)lumpsoffset + (uint64_t)numlumps * 16 > mSize)
+	{
+		SetError("Invalid lumps table in wad file");
+		return false;
+	}
+
+	std::vector<uint8_t> table((size_t)numlumps * 16);
+	if (!table.empty() && !ReadAt(lumpsoffset, table.data(), table.size()))
+	{
+		SetError("Could not read the lumps table of the wad file");
+		return false;
+	}
+
+	mEntries.resize(numlumps);
+	for (int i = 0; i < numlumps; i++)
+	{
+		const uint8_t* lump = table.data() + i * 16;
+		Entry& entry = mEntries[i];
+
+		// The editor reads the offset and length as signed numbers
+		int32_t offset = (int32_t)ReadUInt32(lump);
+		int32_t length = (int32_t)ReadUInt32(lump + 4);
+
+		const char* name = (const char*)(lump + 8);
+		size_t namelength = 0;
+		while (namelength < 8 && name[namelength] != 0)
+			namelength++;
+
+		// Lump names are trimmed just like the editor does
+		size_t namestart = 0;
+		while (namestart < namelength && name[namestart] == ' ')
+			namestart++;
+		while (namelength > namestart && name[namelength - 1] == ' ')
+			namelength--;
+
+		entry.Name.assign(name + namestart, namelength - namestart);
+		entry.Offset = (uint64_t)offset;
+		entry.CompressedSize = (uint64_t)length;
+		entry.Size = (uint64_t)length;
+		entry.Method = MethodStored;
+		entry.Flags = ArchiveEntryStored;
+
+		if (offset < 0 || length < 0 || (uint64_t)offset + (uint64_t)length > mSize)
+			entry.Flags = ArchiveEntryUnsupported;
+	}
+
+	return true;
+}
+
+bool Archive::ReadZip()
+{
+	// The end of central directory record is at the end, followed by a comment of at most 64 KB
+	if (mSize < 22)
+	{
+		SetError("Not a wad or zip file");
+		return false;
+	}
+
+	uint64_t tailoffset = (mSize > 22 + 0xffff) ? mSize - 22 - 0xffff : 0;
+	std::vector<uint8_t> tail((size_t)(mSize - tailoffset));
+	if (!ReadAt(tailoffset, tail.data(), tail.size()))
+	{
+		SetError("Could not read the end of the zip file");
+		return false;
+	}
+
+	size_t eocd = tail.size() - 22;
+	while (ReadUInt32(tail.data() + eocd) != ZipEndOfDirectory)
+	{
+		if (eocd == 0)
+		{
+			SetError("Not a wad or zip file");
+			return false;
+		}
+		eocd--;
+	}
+
+	uint64_t count = ReadUInt16(tail.data() + eocd + 10);
+	uint64_t directorysize = ReadUInt32(tail.data() + eocd + 12);
+	uint64_t directoryoffset = ReadUInt32(tail.data() + eocd + 16);
+
+	// Zip64 archives keep the real values in another record, found with the locator in front of this one
+	uint8_t locator[20];
+	uint64_t locatoroffset = tailoffset + eocd - 20;
+	if ((count == 0xffff || directorysize == 0xffffffff || directoryoffset == 0xffffffff) && tailoffset + eocd >= 20 && ReadAt(locatoroffset, locator, 20) && ReadUInt32(locator) == Zip64Locator)
+	{
+		// The offset comes from the file, so it is checked without adding to it
+		uint8_t record[56];
+		uint64_t eocd64 = ReadUInt64(locator + 8);
+		if (eocd64 > mSize || mSize - eocd64 < 56 || !ReadAt(eocd64, record, 56) || ReadUInt32(record) != Zip64EndOfDirectory)
+		{
+			SetError("Invalid zip64 end of central directory record");
+			return false;
+		}
+
+		count = ReadUInt64(record + 32);
+		directorysize = ReadUInt64(record + 40);
+		directoryoffset = ReadUInt64(record + 48);
+	}
+
+	if (directoryoffset > mSize || directorysize > mSize - directoryoffset || count > directorysize / 46)
+	{
+		SetError("Invalid zip central directory");
+		return false;
+	}
+
+	std::vector<uint8_t> directory((size_t)directorysize);
+	if (!directory.empty() && !ReadAt(directoryoffset, directory.data(), directory.size()))
+	{
+		SetError("Could not read the zip central directory");
+		return false;
+	}
+
+	mEntries.resize((size_t)count);
+	const uint8_t* pos = directory.data();
+	const uint8_t* end = pos + directorysize;
+	for (uint64_t i = 0; i < count; i++)
+	{
+		if (end - pos < 46 || ReadUInt32(pos) != ZipCentralHeader)
+		{
+			SetError("Invalid zip central directory entry %d", (int)i);
+			return false;
+		}
+
+		uint16_t flags = ReadUInt16(pos + 8);
+		uint16_t method = ReadUInt16(pos + 10);
+		uint64_t compressedsize = ReadUInt32(pos + 20);
+		uint64_t size = ReadUInt32(pos + 24);
+		uint16_t namelength = ReadUInt16(pos + 28);
+		uint16_t extralength = ReadUInt16(pos + 30);
+		uint16_t commentlength = ReadUInt16(pos + 32);
+		uint64_t offset = ReadUInt32(pos + 42);
+
+		if (end - pos < 46 + namelength + extralength + commentlength)
+		{
+			SetError("Invalid zip central directory entry %d", (int)i);
+			return false;
+		}
+
+		// The zip64 extra field only has the values that didn't fit, in this order
+		const uint8_t* extra = pos + 46 + namelength;
+		const uint8_t* extraend = extra + extralength;
+		while (extraend - extra >= 4)
+		{
+			uint16_t id = ReadUInt16(extra);
+			uint16_t length = ReadUInt16(extra + 2);
+			const uint8_t* field = extra + 4;
+			const uint8_t* fieldend = field + std::min<ptrdiff_t>(length, extraend - field);
+			if (id == Zip64ExtraField)
+			{
+				if (size == 0xffffffff && fieldend - field >= 8) { size = ReadUInt64(field); field += 8; }
+				if (compressedsize == 0xffffffff && fieldend - field >= 8) { compressedsize = ReadUInt64(field); field += 8; }
+				if (offset == 0xffffffff && fieldend - field >= 8) { offset = ReadUInt64(field); field += 8; }
+			}
+			extra = fieldend;
+		}
+
+		Entry& entry = mEntries[(size_t)i];
+		if (flags & 0x800)
+			entry.Name.assign((const char*)pos + 46, namelength);
+		else
+			entry.Name = CP437ToUTF8(pos + 46, namelength);
+		entry.Offset = offset;
+		entry.CompressedSize = compressedsize;
+		entry.Size = size;
+		entry.Method = method;
+		entry.Flags = 0;
+
+		if (!entry.Name.empty() && (entry.Name.back() == '/' || entry.Name.back() == '\\'))
+			entry.Flags |= ArchiveEntryDirectory;
+
+		if ((flags & 1) != 0 || (method != MethodStored && method != MethodDeflate) || (method == MethodStored && size != compressedsize) || offset > mSize || compressedsize > mSize)
+			entry.Flags |= ArchiveEntryUnsupported;
+		else if (method == MethodStored)
+			entry.Flags |= ArchiveEntryStored;
+
+		pos += 46 + namelength + extralength + commentlength;
+	}
+
+	return true;
+}
+
+void Archive::BuildNameTable()
+{
+	size_t bucketcount = 16;
+	while (bucketcount < mEntries.size() * 2)
+		bucketcount <<= 1;
+
+	mBuckets.assign(bucketcount, -1);
+	mNextSameName.assign(mEntries.size(), -1);
+
+	// The last entry of each name, to add the next one at the end of the chain
+	std::vector<int32_t> last(mEntries.size(), -1);
+
+	for (int i = 0; i < (int)mEntries.size(); i++)
+	{
+		const std::string& name = mEntries[i].Name;
+		size_t bucket = HashName(name.data(), name.size()) & (bucketcount - 1);
+		while (true)
+		{
+			int first = mBuckets[bucket];
+			if (first == -1)
+			{
+				mBuckets[bucket] = i;
+				last[i] = i;
+				break;
+			}
+			else if (NameEquals(mEntries[first].Name, name.data(), name.size()))
+			{
+				mNextSameName[last[first]] = i;
+				last[first] = i;
+				break;
+			}
+			bucket = (bucket + 1) & (bucketcount - 1);
+		}
+	}
+}
+
+uint32_t Archive::HashName(const char* name, size_t length)
+{
+	// FNV-1a
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < length; i++)
+	{
+		hash ^= (uint8_t)FoldNameChar(name[i]);
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+bool Archive::NameEquals(const std::string& a, const char* b, size_t length)
+{
+	if (a.size() != length)
+		return false;
+
+	for (size_t i = 0; i < length; i++)
+	{
+		if (FoldNameChar(a[i]) != FoldNameChar(b[i]))
+			return false;
+	}
+	return true;
+}
+
+int Archive::Find(const char* name) const
+{
+	if (mBuckets.empty())
+		return -1;
+
+	size_t length = strlen(name);
+	size_t bucket = HashName(name, length) & (mBuckets.size() - 1);
+	while (true)
+	{
+		int first = mBuckets[bucket];
+		if (first == -1)
+			return -1;
+		else if (NameEquals(mEntries[first].Name, name, length))
+			return first;
+		bucket = (bucket + 1) & (mBuckets.size() - 1);
+	}
+}
+
+int Archive::FindNext(int index) const
+{
+	if (index < 0 || index >= (int)mNextSameName.size())
+		return -1;
+	return mNextSameName[index];
+}
+
+bool Archive::CheckIndex(int index) const
+{
+	if (index < 0 || index >= (int)mEntries.size())
+	{
+		SetError("Entry index %d out of range", index);
+		return false;
+	}
+	return true;
+}
+
+bool Archive::GetEntry(int index, ArchiveEntryInfo& info) const
+{
+	if (!CheckIndex(index))
+		return false;
+
+	const Entry& entry = mEntries[index];
+	info.Name = entry.Name.c_str();
+	info.Size = (int64_t)entry.Size;
+	info.Flags = entry.Flags;
+	return true;
+}
+
+bool Archive::GetDataOffset(const Entry& entry, uint64_t& offset) const
+{
+	if (entry.Flags & ArchiveEntryUnsupported)
+	{
+		SetError("Unsupported compression method or corrupt entry %s", entry.Name.c_str());
+		return false;
+	}
+
+	offset = entry.Offset;
+	if (mFormat == ArchiveFormat::Zip)
+	{
+		// The local header has its own name and extra field lengths
+		uint8_t header[30];
+		if (offset > mSize || mSize - offset < 30 || !ReadAt(offset, header, 30) || ReadUInt32(header) != ZipLocalHeader)
+		{
+			SetError("Invalid zip local header for %s", entry.Name.c_str());
+			return false;
+		}
+		offset += 30 + ReadUInt16(header + 26) + ReadUInt16(header + 28);
+	}
+
+	if (offset > mSize || entry.CompressedSize > mSize - offset)
+	{
+		SetError("Data of %s is outside the file", entry.Name.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+bool Archive::Read(int index, uint8_t* dst, int64_t size) const
+{
+	if (!CheckIndex(index))
+		return false;
+
+	const Entry& entry = mEntries[index];
+	if (size != (int64_t)entry.Size)
+	{
+		SetError("Buffer size does not match the size of %s", entry.Name.c_str());
+		return false;
+	}
+
+	uint64_t offset;
+	if (!GetDataOffset(entry, offset))
+		return false;
+
+	if (entry.Method == MethodStored)
+	{
+		if (size != 0 && !ReadAt(offset, dst, (uint64_t)size))
+		{
+			SetError("Could not read %s", entry.Name.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	void* buffer;
+	uint8_t* data = SharedBufferPool->Alloc(entry.CompressedSize, &buffer);
+	if (!data)
+	{
+		SetError("Out of memory reading %s", entry.Name.c_str());
+		return false;
+	}
+
+	bool result = ReadAt(offset, data, entry.CompressedSize);
+	if (!result)
+	{
+		SetError("Could not read %s", entry.Name.c_str());
+	}
+	else
+	{
+		size_t written;
+		result = Inflate(data, (size_t)entry.CompressedSize, dst, (size_t)size, written) && written == (size_t)size;
+		if (!result)
+			SetError("Could not inflate %s", entry.Name.c_str());
+	}
+
+	SharedBufferPool->Free(buffer);
+	return result;
+}
+
+bool Archive::Acquire(int index, const uint8_t** data, int64_t* size, void** buffer) const
+{
+	if (!CheckIndex(index))
+		return false;
+
+	const Entry& entry = mEntries[index];
+	uint8_t* dst = SharedBufferPool->Alloc(entry.Size, buffer);
+	if (!dst)
+	{
+		SetError("Out of memory reading %s", entry.Name.c_str());
+		return false;
+	}
+
+	if (!Read(index, dst, (int64_t)entry.Size))
+	{
+		ReleaseBuffer(*buffer);
+		*buffer = nullptr;
+		return false;
+	}
+
+	*data = dst;
+	*size = (int64_t)entry.Size;
+	return true;
+}
+
+void Archive::ReleaseBuffer(void* buffer)
+{
+	if (buffer)
+		SharedBufferPool->Free(buffer);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+extern "C"
+{
+
+Archive* Archive_Open(const char* filename)
+{
+	Archive* archive = new Archive();
+	if (!archive->Open(filename))
+	{
+		delete archive;
+		return nullptr;
+	}
+	return archive;
+}
+
+void Archive_Close(Archive* archive)
+{
+	delete archive;
+}
+
+ArchiveFormat Archive_GetFormat(Archive* archive)
+{
+	return archive->GetFormat();
+}
+
+int Archive_GetCount(Archive* archive)
+{
+	return archive->GetCount();
+}
+
+bool Archive_GetEntry(Archive* archive, int index, ArchiveEntryInfo* info)
+{
+	return archive->GetEntry(index, *info);
+}
+
+int Archive_Find(Archive* archive, const char* name)
+{
+	return archive->Find(name);
+}
+
+int Archive_FindNext(Archive* archive, int index)
+{
+	return archive->FindNext(index);
+}
+
+bool Archive_Read(Archive* archive, int index, uint8_t* dst, int64_t size)
+{
+	return archive->Read(index, dst, size);
+}
+
+bool Archive_Acquire(Archive* archive, int index, const uint8_t** data, int64_t* size, void** buffer)
+{
+	return archive->Acquire(index, data, size, buffer);
+}
+
+void Archive_ReleaseBuffer(void* buffer)
+{
+	Archive::ReleaseBuffer(buffer);
+}
+
+}
@@ -0,0 +1,112 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#pragma once
+
+enum class ArchiveFormat : int32_t
+{
+	WAD, // IWAD or PWAD
+	Zip  // PK3, PKE, IPK3 etc., including zip64
+};
+
+enum ArchiveEntryFlags : int32_t
+{
+	ArchiveEntryDirectory = 1,  // A folder entry of a zip
+	ArchiveEntryStored = 2,     // The data is not compressed
+	ArchiveEntryUnsupported = 4 // Encrypted, compressed with something other than deflate, or out of bounds
+};
+
+struct ArchiveEntryInfo
+{
+	const char* Name; // UTF-8
+	int64_t Size;
+	int32_t Flags;
+};
+
+// A read-only WAD or zip file. The directory is read when it is opened, and the names are kept in a
+// hash table that ignores case and slash direction. Entries are read from the file when they are
+// needed, so the file is never mapped into memory. It stays open with all sharing allowed, which
+// lets other programs save or delete it in the meantime. Reading an entry then fails instead of
+// crashing, the same as a truncated or corrupt file. All reading functions can be used from many
+// threads at once.
+class Archive
+{
+public:
+	Archive();
+	~Archive();
+
+	bool Open(const char* filename);
+
+	ArchiveFormat GetFormat() const { return mFormat; }
+	int GetCount() const { return (int)mEntries.size(); }
+	bool GetEntry(int index, ArchiveEntryInfo& info) const;
+
+	// Returns the first entry with the name, or -1. FindNext returns the next entry with the same name.
+	int Find(const char* name) const;
+	int FindNext(int index) const;
+
+	// Copies or inflates the data of an entry. The size must be the size of the entry.
+	bool Read(int index, uint8_t* dst, int64_t size) const;
+
+	// Reads the data of an entry into a buffer from a pool shared by all archives,
+	// which has to be given back with ReleaseBuffer
+	bool Acquire(int index, const uint8_t** data, int64_t* size, void** buffer) const;
+	static void ReleaseBuffer(void* buffer);
+
+private:
+	struct Entry
+	{
+		std::string Name;
+		uint64_t Offset; // Local header for zip entries, data for WAD lumps
+		uint64_t CompressedSize;
+		uint64_t Size;
+		int32_t Method;
+		int32_t Flags;
+	};
+
+	bool OpenFile(const char* filename);
+	void CloseFile();
+	bool ReadAt(uint64_t offset, void* dst, uint64_t size) const;
+	bool ReadWAD(const uint8_t* header);
+	bool ReadZip();
+	void BuildNameTable();
+	bool GetDataOffset(const Entry& entry, uint64_t& offset) const;
+	bool CheckIndex(int index) const;
+
+	static uint32_t HashName(const char* name, size_t length);
+	static bool NameEquals(const std::string& a, const char* b, size_t length);
+
+	// Size of the file when it was opened
+	uint64_t mSize = 0;
+#ifdef WIN32
+	HANDLE mFile = INVALID_HANDLE_VALUE;
+#else
+	int mFile = -1;
+#endif
+
+	ArchiveFormat mFormat = ArchiveFormat::WAD;
+	std::vector<Entry> mEntries;
+
+	// Open addressing table with the first entry of every name. The other entries are chained in mNextSameName.
+	std::vector<int32_t> mBuckets;
+	std::vector<int32_t> mNextSameName;
+};
@@ -21,13 +21,34 @@
 
 #include "Precomp.h"
 #include "Backend.h"
+#include "ThreadedRenderDevice.h"
 #include "OpenGL/GLBackend.h"
+#include "Software/SWBackend.h"
 
 namespace
 {
-	std::string mLastError;
-	std::string mReturnError;
-	char mSetErrorBuffer[4096];
+	// Per thread so that errors raised on a render thread don't race with the UI thread
+	thread_local std::string mLastError;
+	thread_local std::string mReturnError;
+	thread_local char mSetErrorBuffer[4096];
+
+	enum class BackendType : int { OpenGL, Software };
+
+	// Selected by BuilderNative_SetBackend. Fixed once the backend has been created.
+	BackendType mBackendType = BackendType::OpenGL;
+	std::unique_ptr<ThreadedBackend> mBackend;
+
+	ThreadedBackend* GetThreadedBackend()
+	{
+		if (!mBackend)
+		{
+			if (mBackendType == BackendType::Software)
+				mBackend.reset(new ThreadedBackend(new SWBackend()));
+			else
+				mBackend.reset(new ThreadedBackend(new GLBackend()));
+		}
+		return mBackend.get();
+	}
 }
 
 void SetError(const char* fmt, ...)
@@ -56,10 +77,7 @@ const char* GetError()
 
 Backend* Backend::Get()
 {
-	static std::unique_ptr<Backend> backend;
-	if (!backend)
-		backend.reset(new GLBackend());
-	return backend.get();
+	return GetThreadedBackend();
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -71,11 +89,42 @@ extern "C"
 		return Backend::Get()->NewRenderDevice(disp, window, debug);
 	}
 
+	RenderDevice* RenderDevice_NewThreaded(void* disp, void* window, bool debug)
+	{
+		return GetThreadedBackend()->NewThreadedRenderDevice(disp, window, debug);
+	}
+
+	RenderDevice* RenderDevice_NewOffscreen(int width, int height)
+	{
+		if (width <= 0 || height <= 0)
+		{
+			SetError("Invalid offscreen size %dx%d", width, height);
+			return nullptr;
+		}
+		return Backend::Get()->NewOffscreenRenderDevice(width, height, false);
+	}
+
 	void RenderDevice_Delete(RenderDevice* device)
 	{
 		Backend::Get()->DeleteRenderDevice(device);
 	}
 
+	bool BuilderNative_SetBackend(int type)
+	{
+		if (type != (int)BackendType::OpenGL && type != (int)BackendType::Software)
+		{
+			SetError("Unknown backend type %d", type);
+			return false;
+		}
+		if (mBackend && (int)mBackendType != type)
+		{
+			SetError("The backend can't be changed after it has been created");
+			return false;
+		}
+		mBackendType = (BackendType)type;
+		return true;
+	}
+
 	void BuilderNative_GetError(char *out, int len)
 	{
         std::string result = mLastError;
@@ -194,11 +243,26 @@ extern "C"
 		return device->DrawData(type, startIndex, primitiveCount, data);
 	}
 
+	void RenderDevice_SetInstanceBuffer(RenderDevice* device, VertexBuffer* buffer)
+	{
+		device->SetInstanceBuffer(buffer);
+	}
+
+	bool RenderDevice_DrawInstanced(RenderDevice* device, PrimitiveType type, int startIndex, int primitiveCount, int instanceCount)
+	{
+		return device->DrawInstanced(type, startIndex, primitiveCount, instanceCount);
+	}
+
 	bool RenderDevice_StartRendering(RenderDevice* device, bool clear, int backcolor, Texture* target, bool usedepthbuffer)
 	{
 		return device->StartRendering(clear, backcolor, target, usedepthbuffer);
 	}
 
+	bool RenderDevice_StartCubeRendering(RenderDevice* device, bool clear, int backcolor, Texture* target, CubeMapFace face)
+	{
+		return device->StartCubeRendering(clear, backcolor, target, face);
+	}
+
 	bool RenderDevice_FinishRendering(RenderDevice* device)
 	{
 		return device->FinishRendering();
@@ -254,6 +318,21 @@ extern "C"
 		return device->UnmapPBO(texture);
 	}
 
+	bool RenderDevice_ReadPixelsAsync(RenderDevice* device, Texture* target, PixelFormat format)
+	{
+		return device->ReadPixelsAsync(target, format);
+	}
+
+	bool RenderDevice_MapReadback(RenderDevice* device, Texture* target, bool wait, void** data)
+	{
+		return device->MapReadback(target, wait, data);
+	}
+
+	bool RenderDevice_UnmapReadback(RenderDevice* device, Texture* target)
+	{
+		return device->UnmapReadback(target);
+	}
+
 	////////////////////////////////////////////////////////////////////////////
 
 	IndexBuffer* IndexBuffer_New()
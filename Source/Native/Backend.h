@@ -25,8 +25,8 @@
 #include <mutex>
 
 enum class CubeMapFace : int { PositiveX, PositiveY, PositiveZ, NegativeX, NegativeY, NegativeZ };
-enum class VertexFormat : int32_t { Flat, World };
-enum class DeclarationUsage : int32_t { Position, Color, TextureCoordinate, Normal };
+enum class VertexFormat : int32_t { Flat, World, WorldCompact, Instance };
+enum class DeclarationUsage : int32_t { Position, Color, TextureCoordinate, Normal, PackedNormal, InstancePosition, InstanceParams, InstanceColor };
 
 enum class Cull : int { None, Clockwise };
 enum class Blend : int { InverseSourceAlpha, SourceAlpha, One };
@@ -89,7 +89,12 @@ public:
 	virtual bool Draw(PrimitiveType type, int startIndex, int primitiveCount) = 0;
 	virtual bool DrawIndexed(PrimitiveType type, int startIndex, int primitiveCount) = 0;
 	virtual bool DrawData(PrimitiveType type, int startIndex, int primitiveCount, const void* data) = 0;
+	virtual void SetInstanceBuffer(VertexBuffer* buffer) = 0;
+	virtual bool DrawInstanced(PrimitiveType type, int startIndex, int primitiveCount, int instanceCount) = 0;
 	virtual bool StartRendering(bool clear, int backcolor, Texture* target, bool usedepthbuffer) = 0;
+
+	// Renders straight into one face of a cube texture. Its mipmaps are updated by FinishRendering.
+	virtual bool StartCubeRendering(bool clear, int backcolor, Texture* target, CubeMapFace face) = 0;
 	virtual bool FinishRendering() = 0;
 	virtual bool Present() = 0;
 	virtual bool ClearTexture(int backcolor, Texture* texture) = 0;
@@ -101,6 +106,12 @@ public:
 	virtual bool SetCubePixels(Texture* texture, CubeMapFace face, const void* data) = 0;
 	virtual void* MapPBO(Texture* texture) = 0;
 	virtual bool UnmapPBO(Texture* texture) = 0;
+
+	// Asynchronous readback of a render target, or of the backbuffer when target is null. Readbacks of the
+	// same target complete in request order. MapReadback sets data to null if the oldest one isn't ready yet.
+	virtual bool ReadPixelsAsync(Texture* target, PixelFormat format) = 0;
+	virtual bool MapReadback(Texture* target, bool wait, void** data) = 0;
+	virtual bool UnmapReadback(Texture* target) = 0;
 };
 
 class VertexBuffer
@@ -110,6 +121,25 @@ public:
 
 	static const int FlatStride = 24;
 	static const int WorldStride = 36;
+
+	// WorldCompact buffers are filled with World vertices. Sizes and offsets passed to
+	// SetVertexBufferData/SetVertexBufferSubdata are in World bytes and packed on upload.
+	static const int WorldCompactStride = 28;
+
+	// Per-instance data for DrawInstanced: position xyz, size, angle, sprite index, BGRA color
+	static const int InstanceStride = 28;
+
+	static int GetStride(VertexFormat format)
+	{
+		switch (format)
+		{
+		default:
+		case VertexFormat::Flat: return FlatStride;
+		case VertexFormat::World: return WorldStride;
+		case VertexFormat::WorldCompact: return WorldCompactStride;
+		case VertexFormat::Instance: return InstanceStride;
+		}
+	}
 };
 
 class IndexBuffer
@@ -124,6 +154,34 @@ public:
 	virtual ~Texture() = default;
 	virtual void Set2DImage(int width, int height, PixelFormat format) = 0;
 	virtual void SetCubeImage(int size, PixelFormat format) = 0;
+
+	virtual int GetWidth() const = 0;
+	virtual int GetHeight() const = 0;
+	virtual PixelFormat GetFormat() const = 0;
+
+	static int GetBytesPerPixel(PixelFormat format)
+	{
+		switch (format)
+		{
+		default:
+		case PixelFormat::Rgba8:
+		case PixelFormat::Bgra8:
+		case PixelFormat::Rg16f:
+		case PixelFormat::R32f:
+		case PixelFormat::D24_S8:
+		case PixelFormat::A2Bgr10:
+		case PixelFormat::A2Rgb10_snorm:
+			return 4;
+		case PixelFormat::Rgba16f:
+		case PixelFormat::Rg32f:
+		case PixelFormat::D32f_S8:
+			return 8;
+		case PixelFormat::Rgb32f:
+			return 12;
+		case PixelFormat::Rgba32f:
+			return 16;
+		}
+	}
 };
 
 class Backend
@@ -134,6 +192,7 @@ public:
 	static Backend* Get();
 
 	virtual RenderDevice* NewRenderDevice(void* disp, void* window, bool debug) = 0;
+	virtual RenderDevice* NewOffscreenRenderDevice(int width, int height, bool debug) = 0;
 	virtual void DeleteRenderDevice(RenderDevice* device) = 0;
 
 	virtual VertexBuffer* NewVertexBuffer() = 0;
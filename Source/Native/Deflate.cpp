@@ -0,0 +1,238 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Precomp.h"
+#include "Deflate.h"
+#include <cstring>
+
+namespace
+{
+	const int WindowSize = 32768;
+	const int HashBits = 15;
+	const int MinMatch = 3;
+	const int MaxMatch = 258;
+	const int MaxChain = 64;
+
+	const int LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const int LengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const int DistBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const int DistExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	int ReverseBits(int v, int bits)
+	{
+		int result = 0;
+		for (int i = 0; i < bits; i++)
+		{
+			result = (result << 1) | (v & 1);
+			v >>= 1;
+		}
+		return result;
+	}
+
+	// The fixed huffman codes from the deflate specification, stored bit reversed
+	struct FixedCodes
+	{
+		FixedCodes()
+		{
+			for (int i = 0; i < 288; i++)
+			{
+				int code, length;
+				if (i < 144) { code = 0x30 + i; length = 8; }
+				else if (i < 256) { code = 0x190 + i - 144; length = 9; }
+				else if (i < 280) { code = i - 256; length = 7; }
+				else { code = 0xc0 + i - 280; length = 8; }
+				Literal[i] = (uint16_t)ReverseBits(code, length);
+				LiteralSize[i] = (uint8_t)length;
+			}
+			for (int i = 0; i < 30; i++)
+				Distance[i] = (uint16_t)ReverseBits(i, 5);
+
+			for (int i = 0; i < 29; i++)
+			{
+				int end = (i == 28) ? MaxMatch + 1 : LengthBase[i + 1];
+				for (int length = LengthBase[i]; length < end; length++)
+					LengthCode[length] = (uint8_t)i;
+			}
+		}
+
+		uint16_t Literal[288];
+		uint8_t LiteralSize[288];
+		uint16_t Distance[30];
+		uint8_t LengthCode[MaxMatch + 1];
+	};
+
+	const FixedCodes& GetFixedCodes()
+	{
+		static FixedCodes codes;
+		return codes;
+	}
+
+	class BitWriter
+	{
+	public:
+		BitWriter(std::vector<uint8_t>& dst) : mDst(dst) { }
+
+		void Write(uint32_t bits, int count)
+		{
+			mBuffer |= (uint64_t)bits << mCount;
+			mCount += count;
+			while (mCount >= 8)
+			{
+				mDst.push_back((uint8_t)mBuffer);
+				mBuffer >>= 8;
+				mCount -= 8;
+			}
+		}
+
+		void Flush()
+		{
+			if (mCount > 0)
+				mDst.push_back((uint8_t)mBuffer);
+			mBuffer = 0;
+			mCount = 0;
+		}
+
+	private:
+		std::vector<uint8_t>& mDst;
+		uint64_t mBuffer = 0;
+		int mCount = 0;
+	};
+
+	int DistanceCode(int distance)
+	{
+		int code = 0;
+		while (code < 29 && DistBase[code + 1] <= distance)
+			code++;
+		return code;
+	}
+
+	uint32_t Hash(const uint8_t* p)
+	{
+		uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+		return (v * 2654435761u) >> (32 - HashBits);
+	}
+
+	uint32_t Adler32(const uint8_t* data, size_t size)
+	{
+		uint32_t a = 1, b = 0;
+		while (size > 0)
+		{
+			size_t count = std::min(size, (size_t)5552);
+			size -= count;
+			while (count--)
+			{
+				a += *(data++);
+				b += a;
+			}
+			a %= 65521;
+			b %= 65521;
+		}
+		return (b << 16) | a;
+	}
+}
+
+void DeflateZlib(const uint8_t* src, size_t srcsize, std::vector<uint8_t>& dst)
+{
+	const FixedCodes& codes = GetFixedCodes();
+
+	// Header: deflate with a 32K window, default compression level
+	dst.push_back(0x78);
+	dst.push_back(0x9c);
+
+	BitWriter bits(dst);
+	bits.Write(1, 1); // Last block
+	bits.Write(1, 2); // Fixed huffman codes
+
+	std::vector<int> head(1 << HashBits, -1);
+	std::vector<int> prev(WindowSize, -1);
+
+	auto insert = [&](size_t pos) {
+		uint32_t h = Hash(src + pos);
+		prev[pos & (WindowSize - 1)] = head[h];
+		head[h] = (int)pos;
+	};
+
+	size_t pos = 0;
+	while (pos < srcsize)
+	{
+		int bestlength = 0;
+		int bestdistance = 0;
+
+		if (pos + MinMatch <= srcsize)
+		{
+			int maxlength = (int)std::min(srcsize - pos, (size_t)MaxMatch);
+			int candidate = head[Hash(src + pos)];
+			for (int chain = 0; chain < MaxChain && candidate >= 0 && pos - candidate <= WindowSize; chain++)
+			{
+				const uint8_t* a = src + pos;
+				const uint8_t* b = src + candidate;
+				if (b[bestlength] == a[bestlength])
+				{
+					int length = 0;
+					while (length < maxlength && a[length] == b[length])
+						length++;
+					if (length > bestlength)
+					{
+						bestlength = length;
+						bestdistance = (int)(pos - candidate);
+						if (length == maxlength)
+							break;
+					}
+				}
+				candidate = prev[candidate & (WindowSize - 1)];
+			}
+		}
+
+		if (bestlength >= MinMatch)
+		{
+			int lcode = codes.LengthCode[bestlength];
+			bits.Write(codes.Literal[257 + lcode], codes.LiteralSize[257 + lcode]);
+			bits.Write(bestlength - LengthBase[lcode], LengthExtra[lcode]);
+
+			int dcode = DistanceCode(bestdistance);
+			bits.Write(codes.Distance[dcode], 5);
+			bits.Write(bestdistance - DistBase[dcode], DistExtra[dcode]);
+
+			size_t end = pos + bestlength;
+			for (; pos < end; pos++)
+			{
+				if (pos + MinMatch <= srcsize)
+					insert(pos);
+			}
+		}
+		else
+		{
+			bits.Write(codes.Literal[src[pos]], codes.LiteralSize[src[pos]]);
+			if (pos + MinMatch <= srcsize)
+				insert(pos);
+			pos++;
+		}
+	}
+
+	bits.Write(codes.Literal[256], codes.LiteralSize[256]);
+	bits.Flush();
+
+	uint32_t adler = Adler32(src, srcsize);
+	dst.push_back((uint8_t)(adler >> 24));
+	dst.push_back((uint8_t)(adler >> 16));
+	dst.push_back((uint8_t)(adler >> 8));
+	dst.push_back((uint8_t)adler);
+}
@@ -0,0 +1,626 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Precomp.h"
+#include "ImageDecoder.h"
+#include "Inflate.h"
+#include "Backend.h"
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	// Larger images are left to the framework decoder
+	const int64_t MaxPixels = 1 << 26;
+
+	inline int ReadInt16(const uint8_t* p) { return (int16_t)(p[0] | (p[1] << 8)); }
+	inline int ReadInt32(const uint8_t* p) { return (int32_t)(p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24)); }
+	inline uint32_t ReadBigEndian32(const uint8_t* p) { return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+	inline int ReadBigEndian16(const uint8_t* p) { return (p[0] << 8) | p[1]; }
+
+	inline uint32_t MakeColor(int r, int g, int b, int a) { return ((uint32_t)a << 24) | (r << 16) | (g << 8) | b; }
+
+	inline int Paeth(int a, int b, int c)
+	{
+		int p = a + b - c;
+		int pa = std::abs(p - a);
+		int pb = std::abs(p - b);
+		int pc = std::abs(p - c);
+		if (pa <= pb && pa <= pc) return a;
+		else if (pb <= pc) return b;
+		else return c;
+	}
+
+	// Start, step and size of the Adam7 passes. A non-interlaced image is one pass over everything.
+	struct PNGPass
+	{
+		int X, Y, StepX, StepY;
+	};
+
+	const PNGPass Adam7[7] =
+	{
+		{ 0, 0, 8, 8 }, { 4, 0, 8, 8 }, { 0, 4, 4, 8 }, { 2, 0, 4, 4 }, { 0, 2, 2, 4 }, { 1, 0, 2, 2 }, { 0, 1, 1, 2 }
+	};
+
+	const PNGPass NoInterlace[1] = { { 0, 0, 1, 1 } };
+
+	struct PNGInfo
+	{
+		int Width = 0;
+		int Height = 0;
+		int BitDepth = 0;
+		int ColorType = 0;
+		int Channels = 0;
+		uint32_t Palette[256];
+		bool HasTransparentColor = false;
+		int TransparentColor[3] = {};
+
+		int64_t RowBytes(int width) const { return ((int64_t)width * Channels * BitDepth + 7) / 8; }
+		int PixelBytes() const { return std::max(Channels * BitDepth / 8, 1); }
+
+		// Converts one unfiltered row of a pass, writing every stepx'th pixel
+		void ConvertRow(const uint8_t* row, int count, uint32_t* dest, int stepx) const
+		{
+			if (BitDepth < 8)
+			{
+				// Grayscale or palette with 1, 2 or 4 bits per pixel
+				int mask = (1 << BitDepth) - 1;
+				int scale = 255 / mask;
+				for (int x = 0; x < count; x++)
+				{
+					int bit = x * BitDepth;
+					int v = (row[bit >> 3] >> (8 - BitDepth - (bit & 7))) & mask;
+					if (ColorType == 3)
+					{
+						dest[x * stepx] = Palette[v];
+					}
+					else
+					{
+						int a = (HasTransparentColor && v == TransparentColor[0]) ? 0 : 255;
+						dest[x * stepx] = MakeColor(v * scale, v * scale, v * scale, a);
+					}
+				}
+				return;
+			}
+
+			// 16-bit samples are reduced to their high byte
+			int samplebytes = BitDepth / 8;
+			int pixelbytes = Channels * samplebytes;
+			for (int x = 0; x < count; x++)
+			{
+				const uint8_t* p = row + x * pixelbytes;
+				uint32_t color;
+				switch (ColorType)
+				{
+				default:
+				case 0: // Grayscale
+				{
+					int a = 255;
+					if (HasTransparentColor && (samplebytes == 2 ? ReadBigEndian16(p) : p[0]) == TransparentColor[0])
+						a = 0;
+					color = MakeColor(p[0], p[0], p[0], a);
+					break;
+				}
+				case 2: // RGB
+				{
+					int a = 255;
+					if (HasTransparentColor)
+					{
+						if (samplebytes == 2)
+						{
+							if (ReadBigEndian16(p) == TransparentColor[0] && ReadBigEndian16(p + 2) == TransparentColor[1] && ReadBigEndian16(p + 4) == TransparentColor[2])
+								a = 0;
+						}
+						else if (p[0] == TransparentColor[0] && p[1] == TransparentColor[1] && p[2] == TransparentColor[2])
+						{
+							a = 0;
+						}
+					}
+					color = MakeColor(p[0], p[samplebytes], p[samplebytes * 2], a);
+					break;
+				}
+				case 3: // Palette
+					color = Palette[p[0]];
+					break;
+				case 4: // Grayscale with alpha
+					color = MakeColor(p[0], p[0], p[0], p[samplebytes]);
+					break;
+				case 6: // RGBA
+					color = MakeColor(p[0], p[samplebytes], p[samplebytes * 2], p[samplebytes * 3]);
+					break;
+				}
+				dest[x * stepx] = color;
+			}
+		}
+	};
+}
+
+bool ImageDecoder::Decode(ImageDecoderFormat format, const uint8_t* data, int size, const uint32_t* palette)
+{
+	mWidth = 0;
+	mHeight = 0;
+	mOffsetX = INT_MIN;
+	mOffsetY = INT_MIN;
+	mPixels.clear();
+
+	if (!data || size < 0 || (!palette && format != ImageDecoderFormat::PNG))
+	{
+		SetError("Invalid image decoder input");
+		return false;
+	}
+
+	switch (format)
+	{
+	case ImageDecoderFormat::DoomPicture: return DecodeDoomPicture(data, size, palette);
+	case ImageDecoderFormat::DoomFlat: return DecodeDoomFlat(data, size, palette);
+	case ImageDecoderFormat::PNG: return DecodePNG(data, size);
+	default:
+		SetError("Unknown image format %d", (int)format);
+		return false;
+	}
+}
+
+bool ImageDecoder::DecodeDoomPicture(const uint8_t* data, int size, const uint32_t* palette)
+{
+	if (size < 8)
+	{
+		SetError("Doom picture is too small");
+		return false;
+	}
+
+	int width = ReadInt16(data);
+	int height = ReadInt16(data + 2);
+	int offsetx = ReadInt16(data + 4);
+	int offsety = ReadInt16(data + 6);
+	if (width <= 0 || height <= 0 || 8 + width * 4 > size)
+	{
+		SetError("Invalid Doom picture header");
+		return false;
+	}
+
+	mPixels.assign(width * height, 0);
+	uint32_t* pixels = mPixels.data();
+	int numpixels = width * height;
+
+	for (int x = 0; x < width; x++)
+	{
+		int pos = ReadInt32(data + 8 + x * 4);
+
+		// Reads past the end of the lump fail, like they do in DoomPictureReader
+		if (pos < 0 || pos >= size)
+		{
+			SetError("Doom picture column %d is out of range", x);
+			return false;
+		}
+
+		int y = data[pos++];
+		int read_y = y;
+		while (read_y < 255)
+		{
+			if (pos >= size)
+			{
+				SetError("Doom picture column %d is out of range", x);
+				return false;
+			}
+			int count = data[pos];
+			pos += 2;
+
+			// Also covers the unused pixel and the next post start
+			if ((int64_t)pos + count + 2 > size)
+			{
+				SetError("Doom picture column %d is out of range", x);
+				return false;
+			}
+
+			for (int yo = 0; yo < count; yo++)
+			{
+				int offset = (y + yo) * width + x;
+				if (offset > numpixels - 1)
+				{
+					SetError("Doom picture post is out of range");
+					return false;
+				}
+				pixels[offset] = palette[data[pos + yo]];
+			}
+			pos += count + 1;
+
+			// Next post start. Tall patches use relative offsets once past 254.
+			read_y = data[pos++];
+			if (read_y < y || (height > 256 && read_y == y)) y += read_y; else y = read_y;
+		}
+	}
+
+	mWidth = width;
+	mHeight = height;
+	mOffsetX = offsetx;
+	mOffsetY = offsety;
+	return true;
+}
+
+bool ImageDecoder::DecodeDoomFlat(const uint8_t* data, int size, const uint32_t* palette)
+{
+	// Same size rules as DoomFlatReader, including its float precision
+	int width, height;
+	float sqrlength = (float)std::sqrt((double)size);
+	if (sqrlength == (float)std::trunc((double)sqrlength))
+	{
+		width = (int)sqrlength;
+		height = (int)sqrlength;
+	}
+	else if (size > 4096)
+	{
+		width = 64;
+		height = 64;
+	}
+	else
+	{
+		width = 0;
+		height = 0;
+	}
+
+	if (width <= 0 || height <= 0)
+	{
+		SetError("Invalid Doom flat size");
+		return false;
+	}
+
+	// Missing bytes read as palette index 0
+	int count = width * height;
+	int available = std::min(count, size);
+	mPixels.resize(count);
+	for (int i = 0; i < available; i++)
+		mPixels[i] = palette[data[i]];
+	for (int i = available; i < count; i++)
+		mPixels[i] = palette[0];
+
+	mWidth = width;
+	mHeight = height;
+	return true;
+}
+
+bool ImageDecoder::DecodePNG(const uint8_t* data, int size)
+{
+	static const uint8_t signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	if (size < 8 || memcmp(data, signature, 8) != 0)
+	{
+		SetError("Not a PNG file");
+		return false;
+	}
+
+	PNGInfo info;
+	for (int i = 0; i < 256; i++)
+		info.Palette[i] = 0xff000000;
+
+	int interlace = 0;
+	bool hasheader = false;
+	bool seenidat = false;
+	std::vector<uint8_t> idat;
+
+	int pos = 8;
+	while (size - pos >= 8)
+	{
+		uint32_t length = ReadBigEndian32(data + pos);
+		const uint8_t* name = data + pos + 4;
+		pos += 8;
+		if (length > (uint32_t)(size - pos))
+		{
+			SetError("Truncated PNG chunk");
+			return false;
+		}
+		const uint8_t* chunk = data + pos;
+
+		if (memcmp(name, "IHDR", 4) == 0 && length >= 13)
+		{
+			info.Width = (int)ReadBigEndian32(chunk);
+			info.Height = (int)ReadBigEndian32(chunk + 4);
+			info.BitDepth = chunk[8];
+			info.ColorType = chunk[9];
+			interlace = chunk[12];
+			if (chunk[10] != 0 || chunk[11] != 0 || interlace > 1)
+			{
+				SetError("Unsupported PNG compression, filter or interlace method");
+				return false;
+			}
+			hasheader = true;
+		}
+		else if (memcmp(name, "PLTE", 4) == 0)
+		{
+			int count = std::min((int)length / 3, 256);
+			for (int i = 0; i < count; i++)
+				info.Palette[i] = MakeColor(chunk[i * 3], chunk[i * 3 + 1], chunk[i * 3 + 2], 255);
+		}
+		else if (memcmp(name, "tRNS", 4) == 0)
+		{
+			if (info.ColorType == 3)
+			{
+				int count = std::min((int)length, 256);
+				for (int i = 0; i < count; i++)
+					info.Palette[i] = (info.Palette[i] & 0x00ffffff) | ((uint32_t)chunk[i] << 24);
+			}
+			else if (info.ColorType == 0 && length >= 2)
+			{
+				info.HasTransparentColor = true;
+				info.TransparentColor[0] = ReadBigEndian16(chunk);
+			}
+			else if (info.ColorType == 2 && length >= 6)
+			{
+				info.HasTransparentColor = true;
+				info.TransparentColor[0] = ReadBigEndian16(chunk);
+				info.TransparentColor[1] = ReadBigEndian16(chunk + 2);
+				info.TransparentColor[2] = ReadBigEndian16(chunk + 4);
+			}
+		}
+		else if (memcmp(name, "gAMA", 4) == 0 || memcmp(name, "iCCP", 4) == 0)
+		{
+			// Anything but the sRGB gamma may be color corrected by the framework decoder
+			if (name[0] == 'i' || length < 4 || std::abs((int)ReadBigEndian32(chunk) - 45455) > 100)
+			{
+				SetError("PNG color management is not supported");
+				return false;
+			}
+		}
+		else if (memcmp(name, "grAb", 4) == 0)
+		{
+			// FrameworkImageReader stops looking for offsets at the first IDAT
+			if (!seenidat && length >= 8)
+			{
+				mOffsetX = (int)ReadBigEndian32(chunk);
+				mOffsetY = (int)ReadBigEndian32(chunk + 4);
+			}
+		}
+		else if (memcmp(name, "IDAT", 4) == 0)
+		{
+			idat.insert(idat.end(), chunk, chunk + length);
+			seenidat = true;
+		}
+		else if (memcmp(name, "IEND", 4) == 0)
+		{
+			break;
+		}
+
+		// Skip the data and the CRC
+		pos += length;
+		pos += std::min(size - pos, 4);
+	}
+
+	if (!hasheader || !seenidat)
+	{
+		SetError("PNG file has no image data");
+		return false;
+	}
+
+	switch (info.ColorType)
+	{
+	case 0: info.Channels = 1; break;
+	case 2: info.Channels = 3; break;
+	case 3: info.Channels = 1; break;
+	case 4: info.Channels = 2; break;
+	case 6: info.Channels = 4; break;
+	default:
+		SetError("Invalid PNG color type %d", info.ColorType);
+		return false;
+	}
+
+	int bits = info.BitDepth;
+	bool validdepth = (bits == 8) || (bits == 16 && info.ColorType != 3) || ((bits == 1 || bits == 2 || bits == 4) && (info.ColorType == 0 || info.ColorType == 3));
+	if (!validdepth)
+	{
+		SetError("Invalid PNG bit depth %d", bits);
+		return false;
+	}
+
+	if (info.Width <= 0 || info.Height <= 0 || (int64_t)info.Width * info.Height > MaxPixels)
+	{
+		SetError("Unsupported PNG size %dx%d", info.Width, info.Height);
+		return false;
+	}
+
+	// Size of the filtered data of all passes. Rows are indexed with ints, so bigger images are left to the framework decoder.
+	const PNGPass* passes = interlace ? Adam7 : NoInterlace;
+	int numpasses = interlace ? 7 : 1;
+	int64_t rawsize = 0;
+	for (int i = 0; i < numpasses; i++)
+	{
+		int passwidth = (info.Width - passes[i].X + passes[i].StepX - 1) / passes[i].StepX;
+		int passheight = (info.Height - passes[i].Y + passes[i].StepY - 1) / passes[i].StepY;
+		if (passwidth > 0 && passheight > 0)
+			rawsize += (int64_t)passheight * (1 + info.RowBytes(passwidth));
+	}
+
+	if (rawsize > INT_MAX)
+	{
+		SetError("Unsupported PNG size %dx%d", info.Width, info.Height);
+		return false;
+	}
+
+	std::vector<uint8_t> raw(rawsize);
+	size_t written;
+	if (!InflateZlib(idat.data(), idat.size(), raw.data(), raw.size(), written))
+		return false;
+	if (written != (size_t)rawsize)
+	{
+		SetError("PNG image data is too short");
+		return false;
+	}
+
+	mPixels.assign((size_t)info.Width * info.Height, 0);
+
+	int pixelbytes = info.PixelBytes();
+	std::vector<uint8_t> prevrow;
+	uint8_t* src = raw.data();
+	for (int i = 0; i < numpasses; i++)
+	{
+		const PNGPass& pass = passes[i];
+		int passwidth = (info.Width - pass.X + pass.StepX - 1) / pass.StepX;
+		int passheight = (info.Height - pass.Y + pass.StepY - 1) / pass.StepY;
+		if (passwidth <= 0 || passheight <= 0)
+			continue;
+
+		int rowbytes = (int)info.RowBytes(passwidth);
+		prevrow.assign(rowbytes, 0);
+		for (int y = 0; y < passheight; y++)
+		{
+			int filter = *(src++);
+			uint8_t* row = src;
+			const uint8_t* prev = prevrow.data();
+			switch (filter)
+			{
+			case 0:
+				break;
+			case 1: // Sub
+				for (int x = pixelbytes; x < rowbytes; x++)
+					row[x] += row[x - pixelbytes];
+				break;
+			case 2: // Up
+				for (int x = 0; x < rowbytes; x++)
+					row[x] += prev[x];
+				break;
+			case 3: // Average
+				for (int x = 0; x < pixelbytes; x++)
+					row[x] += prev[x] >> 1;
+				for (int x = pixelbytes; x < rowbytes; x++)
+					row[x] += (row[x - pixelbytes] + prev[x]) >> 1;
+				break;
+			case 4: // Paeth
+				for (int x = 0; x < pixelbytes; x++)
+					row[x] += prev[x];
+				for (int x = pixelbytes; x < rowbytes; x++)
+					row[x] += Paeth(row[x - pixelbytes], prev[x], prev[x - pixelbytes]);
+				break;
+			default:
+				SetError("Invalid PNG filter type %d", filter);
+				return false;
+			}
+
+			uint32_t* dest = mPixels.data() + (size_t)(pass.Y + y * pass.StepY) * info.Width + pass.X;
+			info.ConvertRow(row, passwidth, dest, pass.StepX);
+
+			memcpy(prevrow.data(), row, rowbytes);
+			src += rowbytes;
+		}
+	}
+
+	mWidth = info.Width;
+	mHeight = info.Height;
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+extern "C"
+{
+
+ImageDecoder* ImageDecoder_New()
+{
+	return new ImageDecoder();
+}
+
+void ImageDecoder_Delete(ImageDecoder* decoder)
+{
+	delete decoder;
+}
+
+bool ImageDecoder_Decode(ImageDecoder* decoder, ImageDecoderFormat format, const uint8_t* data, int size, const uint32_t* palette)
+{
+	return decoder->Decode(format, data, size, palette);
+}
+
+void ImageDecoder_GetInfo(ImageDecoder* decoder, int* width, int* height, int* offsetx, int* offsety)
+{
+	*width = decoder->GetWidth();
+	*height = decoder->GetHeight();
+	*offsetx = decoder->GetOffsetX();
+	*offsety = decoder->GetOffsetY();
+}
+
+void ImageDecoder_CopyPixels(ImageDecoder* decoder, uint32_t* dest)
+{
+	memcpy(dest, decoder->GetPixels(), (size_t)decoder->GetWidth() * decoder->GetHeight() * sizeof(uint32_t));
+}
+
+// Makes the color corrected image, the preview, the alpha test mask and the stats of a loaded image in one pass.
+// The correction table may be null. The alpha mask gets one bit per pixel, set for pixels that aren't fully transparent.
+bool ImageDecoder_Process(const uint32_t* pixels, int width, int height, const uint8_t* correction, uint32_t* corrected, uint32_t* preview, int previewwidth, int previewheight, int32_t* alphamask, ImageStats* stats)
+{
+	if (!pixels || !corrected || !preview || !alphamask || !stats || width <= 0 || height <= 0 || previewwidth <= 0 || previewheight <= 0)
+	{
+		SetError("Invalid image processing input");
+		return false;
+	}
+
+	uint64_t red = 0, green = 0, blue = 0;
+	int translucent = 0, masked = 0;
+	int numpixels = width * height;
+	memset(alphamask, 0, ((numpixels + 31) / 32) * sizeof(int32_t));
+
+	for (int i = 0; i < numpixels; i++)
+	{
+		uint32_t c = pixels[i];
+		uint32_t a = c >> 24;
+		uint32_t r = (c >> 16) & 0xff;
+		uint32_t g = (c >> 8) & 0xff;
+		uint32_t b = c & 0xff;
+		if (correction)
+		{
+			r = correction[r];
+			g = correction[g];
+			b = correction[b];
+		}
+		corrected[i] = (a << 24) | (r << 16) | (g << 8) | b;
+
+		red += r;
+		green += g;
+		blue += b;
+
+		if (a == 0)
+			masked = 1;
+		else
+			alphamask[i >> 5] |= 1u << (i & 31);
+		if (a > 0 && a < 255)
+			translucent = 1;
+	}
+
+	if (previewwidth == width && previewheight == height)
+	{
+		memcpy(preview, corrected, (size_t)numpixels * sizeof(uint32_t));
+	}
+	else
+	{
+		// Nearest neighbour, sampling at the center of each preview pixel
+		for (int y = 0; y < previewheight; y++)
+		{
+			const uint32_t* line = corrected + (int64_t)(2 * y + 1) * height / (2 * previewheight) * width;
+			uint32_t* dest = preview + y * previewwidth;
+			for (int x = 0; x < previewwidth; x++)
+				dest[x] = line[(int64_t)(2 * x + 1) * width / (2 * previewwidth)];
+		}
+	}
+
+	stats->Red = red;
+	stats->Green = green;
+	stats->Blue = blue;
+	stats->Translucent = translucent;
+	stats->Masked = masked;
+	return true;
+}
+
+}
@@ -0,0 +1,68 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <climits>
+
+enum class ImageDecoderFormat : int
+{
+	DoomPicture,
+	DoomFlat,
+	PNG
+};
+
+// Decodes Doom pictures, flats and PNG files into 32-bit BGRA pixels.
+// The Doom formats give the same results as DoomPictureReader and DoomFlatReader.
+class ImageDecoder
+{
+public:
+	bool Decode(ImageDecoderFormat format, const uint8_t* data, int size, const uint32_t* palette);
+
+	int GetWidth() const { return mWidth; }
+	int GetHeight() const { return mHeight; }
+	int GetOffsetX() const { return mOffsetX; }
+	int GetOffsetY() const { return mOffsetY; }
+	const uint32_t* GetPixels() const { return mPixels.data(); }
+
+private:
+	bool DecodeDoomPicture(const uint8_t* data, int size, const uint32_t* palette);
+	bool DecodeDoomFlat(const uint8_t* data, int size, const uint32_t* palette);
+	bool DecodePNG(const uint8_t* data, int size);
+
+	int mWidth = 0;
+	int mHeight = 0;
+	int mOffsetX = INT_MIN;
+	int mOffsetY = INT_MIN;
+	std::vector<uint32_t> mPixels;
+};
+
+// What ImageData needs to know about a loaded image
+struct ImageStats
+{
+	// Sum of the color channels after color correction
+	uint64_t Red;
+	uint64_t Green;
+	uint64_t Blue;
+
+	int32_t Translucent; // Pixels with 0 < alpha < 255
+	int32_t Masked; // Pixels with alpha 0
+};
@@ -0,0 +1,451 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Precomp.h"
+#include "Inflate.h"
+#include "Backend.h"
+#include <cstring>
+
+namespace
+{
+	const int FastBits = 9;
+	const int FastMask = (1 << FastBits) - 1;
+
+	const int LengthBase[31] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258, 0, 0 };
+	const int LengthExtra[31] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0, 0, 0 };
+	const int DistBase[32] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577, 0, 0 };
+	const int DistExtra[32] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13, 0, 0 };
+	const uint8_t CodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	int ReverseBits(int v, int bits)
+	{
+		int result = 0;
+		for (int i = 0; i < bits; i++)
+		{
+			result = (result << 1) | (v & 1);
+			v >>= 1;
+		}
+		return result;
+	}
+
+	// Canonical huffman code. Codes up to FastBits long are decoded with a single table lookup.
+	struct HuffmanTable
+	{
+		uint16_t Fast[1 << FastBits];
+		uint16_t FirstCode[16];
+		int MaxCode[17];
+		uint16_t FirstSymbol[16];
+		uint8_t Size[288];
+		uint16_t Value[288];
+
+		bool Build(const uint8_t* lengths, int count)
+		{
+			int sizes[17] = {};
+			int nextcode[16];
+			memset(Fast, 0, sizeof(Fast));
+
+			for (int i = 0; i < count; i++)
+				sizes[lengths[i]]++;
+			sizes[0] = 0;
+			for (int i = 1; i < 16; i++)
+			{
+				if (sizes[i] > (1 << i))
+					return false;
+			}
+
+			int code = 0, symbol = 0;
+			for (int i = 1; i < 16; i++)
+			{
+				nextcode[i] = code;
+				FirstCode[i] = (uint16_t)code;
+				FirstSymbol[i] = (uint16_t)symbol;
+				code += sizes[i];
+				if (sizes[i] && code - 1 >= (1 << i))
+					return false;
+				MaxCode[i] = code << (16 - i);
+				code <<= 1;
+				symbol += sizes[i];
+			}
+			MaxCode[16] = 0x10000;
+
+			for (int i = 0; i < count; i++)
+			{
+				int length = lengths[i];
+				if (length)
+				{
+					int c = nextcode[length] - FirstCode[length] + FirstSymbol[length];
+					Size[c] = (uint8_t)length;
+					Value[c] = (uint16_t)i;
+					if (length <= FastBits)
+					{
+						uint16_t entry = (uint16_t)((length << 9) | i);
+						for (int j = ReverseBits(nextcode[length], length); j < (1 << FastBits); j += 1 << length)
+							Fast[j] = entry;
+					}
+					nextcode[length]++;
+				}
+			}
+			return true;
+		}
+	};
+
+	class InflateState
+	{
+	public:
+		InflateState(const uint8_t* src, size_t srcsize, uint8_t* dst, size_t dstsize) : mSrc(src), mSrcEnd(src + srcsize), mDst(dst), mDstPos(dst), mDstEnd(dst + dstsize) { }
+
+		bool Run()
+		{
+			bool last;
+			do
+			{
+				last = GetBits(1) != 0;
+				int type = GetBits(2);
+				if (type == 0)
+				{
+					if (!StoredBlock()) return false;
+				}
+				else if (type == 1)
+				{
+					if (!FixedBlock()) return false;
+				}
+				else if (type == 2)
+				{
+					if (!DynamicBlock()) return false;
+				}
+				else
+				{
+					SetError("Invalid deflate block type");
+					return false;
+				}
+			} while (!last);
+			return true;
+		}
+
+		size_t Written() const { return mDstPos - mDst; }
+
+	private:
+		void Fill()
+		{
+			while (mNumBits <= 56)
+			{
+				if (mSrc < mSrcEnd)
+					mBits |= (uint64_t)*(mSrc++) << mNumBits;
+				else
+					mOverrun++;
+				mNumBits += 8;
+			}
+		}
+
+		int GetBits(int count)
+		{
+			if (mNumBits < count) Fill();
+			int value = (int)(mBits & ((1ull << count) - 1));
+			mBits >>= count;
+			mNumBits -= count;
+			return value;
+		}
+
+		bool Overrun() const
+		{
+			// The bit buffer may hold padding bytes as long as they weren't consumed
+			return mOverrun * 8 > mNumBits;
+		}
+
+		int Decode(const HuffmanTable& table)
+		{
+			if (mNumBits < 16) Fill();
+
+			int entry = table.Fast[mBits & FastMask];
+			if (entry)
+			{
+				int length = entry >> 9;
+				mBits >>= length;
+				mNumBits -= length;
+				return entry & 511;
+			}
+
+			int k = ReverseBits((int)(mBits & 0xffff), 16);
+			int length;
+			for (length = FastBits + 1; k >= table.MaxCode[length]; length++);
+			if (length >= 16)
+				return -1;
+
+			int c = (k >> (16 - length)) - table.FirstCode[length] + table.FirstSymbol[length];
+			if (c >= 288 || table.Size[c] != length)
+				return -1;
+			mBits >>= length;
+			mNumBits -= length;
+			return table.Value[c];
+		}
+
+		bool StoredBlock()
+		{
+			// Align to a byte boundary and rewind the bytes still in the bit buffer
+			GetBits(mNumBits & 7);
+			uint8_t header[4];
+			for (int i = 0; i < 4; i++)
+				header[i] = (uint8_t)GetBits(8);
+			if (Overrun())
+			{
+				SetError("Unexpected end of deflate data");
+				return false;
+			}
+			mSrc -= mNumBits / 8 - mOverrun;
+			mBits = 0;
+			mNumBits = 0;
+			mOverrun = 0;
+
+			int length = header[0] | (header[1] << 8);
+			int nlength = header[2] | (header[3] << 8);
+			if (length != (nlength ^ 0xffff))
+			{
+				SetError("Corrupt stored deflate block");
+				return false;
+			}
+			if (length > mSrcEnd - mSrc || length > mDstEnd - mDstPos)
+			{
+				SetError("Stored deflate block doesn't fit");
+				return false;
+			}
+			memcpy(mDstPos, mSrc, length);
+			mDstPos += length;
+			mSrc += length;
+			return true;
+		}
+
+		bool FixedBlock()
+		{
+			if (!mFixedBuilt)
+			{
+				uint8_t lengths[288 + 32];
+				memset(lengths, 8, 144);
+				memset(lengths + 144, 9, 112);
+				memset(lengths + 256, 7, 24);
+				memset(lengths + 280, 8, 8);
+				memset(lengths + 288, 5, 32);
+				mFixedLength.Build(lengths, 288);
+				mFixedDist.Build(lengths + 288, 32);
+				mFixedBuilt = true;
+			}
+			return Block(mFixedLength, mFixedDist);
+		}
+
+		bool DynamicBlock()
+		{
+			int numlength = GetBits(5) + 257;
+			int numdist = GetBits(5) + 1;
+			int numcodelength = GetBits(4) + 4;
+
+			uint8_t codelengths[19] = {};
+			for (int i = 0; i < numcodelength; i++)
+				codelengths[CodeLengthOrder[i]] = (uint8_t)GetBits(3);
+
+			HuffmanTable codelengthtable;
+			if (!codelengthtable.Build(codelengths, 19))
+			{
+				SetError("Invalid deflate code lengths");
+				return false;
+			}
+
+			uint8_t lengths[286 + 32];
+			int total = numlength + numdist;
+			int n = 0;
+			while (n < total)
+			{
+				int c = Decode(codelengthtable);
+				if (c < 0 || c >= 19)
+				{
+					SetError("Invalid deflate code lengths");
+					return false;
+				}
+
+				if (c < 16)
+				{
+					lengths[n++] = (uint8_t)c;
+					continue;
+				}
+
+				int repeat;
+				uint8_t fill = 0;
+				if (c == 16)
+				{
+					if (n == 0)
+					{
+						SetError("Invalid deflate code lengths");
+						return false;
+					}
+					repeat = GetBits(2) + 3;
+					fill = lengths[n - 1];
+				}
+				else if (c == 17)
+				{
+					repeat = GetBits(3) + 3;
+				}
+				else
+				{
+					repeat = GetBits(7) + 11;
+				}
+
+				if (total - n < repeat)
+				{
+					SetError("Invalid deflate code lengths");
+					return false;
+				}
+				memset(lengths + n, fill, repeat);
+				n += repeat;
+			}
+
+			HuffmanTable lengthtable, disttable;
+			if (!lengthtable.Build(lengths, numlength) || !disttable.Build(lengths + numlength, numdist))
+			{
+				SetError("Invalid deflate huffman codes");
+				return false;
+			}
+			return Block(lengthtable, disttable);
+		}
+
+		bool Block(const HuffmanTable& lengthtable, const HuffmanTable& disttable)
+		{
+			uint8_t* dst = mDstPos;
+			while (true)
+			{
+				int symbol = Decode(lengthtable);
+				if (symbol < 256)
+				{
+					if (symbol < 0)
+					{
+						SetError("Corrupt deflate data");
+						return false;
+					}
+					if (dst == mDstEnd)
+					{
+						SetError("Inflated data is larger than expected");
+						return false;
+					}
+					*(dst++) = (uint8_t)symbol;
+				}
+				else if (symbol == 256)
+				{
+					mDstPos = dst;
+					if (Overrun())
+					{
+						SetError("Unexpected end of deflate data");
+						return false;
+					}
+					return true;
+				}
+				else
+				{
+					symbol -= 257;
+					if (symbol >= 29)
+					{
+						SetError("Corrupt deflate data");
+						return false;
+					}
+					int length = LengthBase[symbol] + (LengthExtra[symbol] ? GetBits(LengthExtra[symbol]) : 0);
+
+					symbol = Decode(disttable);
+					if (symbol < 0 || symbol >= 30)
+					{
+						SetError("Corrupt deflate data");
+						return false;
+					}
+					int dist = DistBase[symbol] + (DistExtra[symbol] ? GetBits(DistExtra[symbol]) : 0);
+
+					if (dist > dst - mDst)
+					{
+						SetError("Corrupt deflate data");
+						return false;
+					}
+					if (length > mDstEnd - dst)
+					{
+						SetError("Inflated data is larger than expected");
+						return false;
+					}
+
+					const uint8_t* from = dst - dist;
+					if (dist >= 8 && mDstEnd - dst >= length + 8)
+					{
+						// Copy in 8 byte steps, overshooting into space that will be overwritten later
+						uint8_t* end = dst + length;
+						do
+						{
+							memcpy(dst, from, 8);
+							dst += 8;
+							from += 8;
+						} while (dst < end);
+						dst = end;
+					}
+					else if (dist == 1)
+					{
+						memset(dst, *from, length);
+						dst += length;
+					}
+					else
+					{
+						for (int i = 0; i < length; i++)
+							*(dst++) = *(from++);
+					}
+				}
+
+				if (mOverrun > 8)
+				{
+					SetError("Unexpected end of deflate data");
+					return false;
+				}
+			}
+		}
+
+		const uint8_t* mSrc;
+		const uint8_t* mSrcEnd;
+		uint8_t* mDst;
+		uint8_t* mDstPos;
+		uint8_t* mDstEnd;
+
+		uint64_t mBits = 0;
+		int mNumBits = 0;
+		int mOverrun = 0;
+
+		bool mFixedBuilt = false;
+		HuffmanTable mFixedLength;
+		HuffmanTable mFixedDist;
+	};
+}
+
+bool Inflate(const uint8_t* src, size_t srcsize, uint8_t* dst, size_t dstsize, size_t& written)
+{
+	InflateState state(src, srcsize, dst, dstsize);
+	bool result = state.Run();
+	written = state.Written();
+	return result;
+}
+
+bool InflateZlib(const uint8_t* src, size_t srcsize, uint8_t* dst, size_t dstsize, size_t& written)
+{
+	written = 0;
+	if (srcsize < 2 || ((src[0] << 8) | src[1]) % 31 != 0 || (src[0] & 15) != 8 || (src[1] & 32) != 0)
+	{
+		SetError("Invalid zlib header");
+		return false;
+	}
+	return Inflate(src + 2, srcsize - 2, dst, dstsize, written);
+}
@@ -0,0 +1,29 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+// Decompresses a raw deflate stream into a buffer. Fails when the data is corrupt or
+// doesn't fit. The number of bytes produced is returned in written.
+bool Inflate(const uint8_t* src, size_t srcsize, uint8_t* dst, size_t dstsize, size_t& written);
+
+// Same for a zlib stream (deflate with a two byte header, as used by PNG)
+bool InflateZlib(const uint8_t* src, size_t srcsize, uint8_t* dst, size_t dstsize, size_t& written);
@@ -27,7 +27,7 @@
 #include "fasttrig.h"
 
 #ifndef NO_SSE
-#include <xmmintrin.h>
+#include <emmintrin.h>
 #endif
 
 extern "C"
@@ -184,3 +184,234 @@ void Matrix_Multiply(const float a[4][4], const float b[4][4], float result[4][4
 #endif
 
 }
+
+/////////////////////////////////////////////////////////////////////////////
+// Batch kernels
+//
+// Points are read as three floats at the start of each element, so arrays of Vector3f, WorldVertex
+// or any other vertex struct can be passed directly with their stride. Transforms use the same
+// row vector convention as Vector3f.Transform.
+
+namespace
+{
+	// Planes of the view frustum in clip space (-w <= x, y, z <= w) for a row vector matrix.
+	// Stored as x, y, z and d rows with two padding planes that always pass.
+	void GetFrustumPlanes(const float m[4][4], float planes[4][8])
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			planes[i][0] = m[i][3] + m[i][0];
+			planes[i][1] = m[i][3] - m[i][0];
+			planes[i][2] = m[i][3] + m[i][1];
+			planes[i][3] = m[i][3] - m[i][1];
+			planes[i][4] = m[i][3] + m[i][2];
+			planes[i][5] = m[i][3] - m[i][2];
+			planes[i][6] = i == 3 ? 1.0f : 0.0f;
+			planes[i][7] = i == 3 ? 1.0f : 0.0f;
+		}
+	}
+
+#ifdef NO_SSE
+
+	void TransformPoints(const float m[4][4], const uint8_t* src, int srcstride, uint8_t* dst, int dststride, int count)
+	{
+		for (int i = 0; i < count; i++, src += srcstride, dst += dststride)
+		{
+			const float* p = reinterpret_cast<const float*>(src);
+			float x = p[0], y = p[1], z = p[2];
+			float* r = reinterpret_cast<float*>(dst);
+			r[0] = x * m[0][0] + y * m[1][0] + z * m[2][0] + m[3][0];
+			r[1] = x * m[0][1] + y * m[1][1] + z * m[2][1] + m[3][1];
+			r[2] = x * m[0][2] + y * m[1][2] + z * m[2][2] + m[3][2];
+		}
+	}
+
+	void ProjectPoints(const float m[4][4], const uint8_t* src, int srcstride, int count, float width, float height, float* result)
+	{
+		for (int i = 0; i < count; i++, src += srcstride, result += 4)
+		{
+			const float* p = reinterpret_cast<const float*>(src);
+			float x = p[0], y = p[1], z = p[2];
+			float cx = x * m[0][0] + y * m[1][0] + z * m[2][0] + m[3][0];
+			float cy = x * m[0][1] + y * m[1][1] + z * m[2][1] + m[3][1];
+			float cz = x * m[0][2] + y * m[1][2] + z * m[2][2] + m[3][2];
+			float cw = x * m[0][3] + y * m[1][3] + z * m[2][3] + m[3][3];
+			float rcp = 1.0f / cw;
+			result[0] = (cx * rcp * 0.5f + 0.5f) * width;
+			result[1] = (0.5f - cy * rcp * 0.5f) * height;
+			result[2] = cz * rcp;
+			result[3] = cw;
+		}
+	}
+
+	void BoundingBox(const uint8_t* src, int stride, int count, float* result)
+	{
+		const float* p = reinterpret_cast<const float*>(src);
+		float minx = p[0], miny = p[1], minz = p[2];
+		float maxx = p[0], maxy = p[1], maxz = p[2];
+		for (int i = 1; i < count; i++)
+		{
+			p = reinterpret_cast<const float*>(src + (size_t)i * stride);
+			minx = std::min(minx, p[0]); maxx = std::max(maxx, p[0]);
+			miny = std::min(miny, p[1]); maxy = std::max(maxy, p[1]);
+			minz = std::min(minz, p[2]); maxz = std::max(maxz, p[2]);
+		}
+		result[0] = minx; result[1] = miny; result[2] = minz;
+		result[3] = maxx; result[4] = maxy; result[5] = maxz;
+	}
+
+	int CullBoxes(const float planes[4][8], const float* boxes, int count, uint8_t* visible)
+	{
+		int numvisible = 0;
+		for (int i = 0; i < count; i++, boxes += 6)
+		{
+			// A box is outside when its corner furthest along a plane normal is still behind the plane
+			bool inside = true;
+			for (int j = 0; j < 6 && inside; j++)
+			{
+				float dist =
+					std::max(planes[0][j] * boxes[0], planes[0][j] * boxes[3]) +
+					std::max(planes[1][j] * boxes[1], planes[1][j] * boxes[4]) +
+					std::max(planes[2][j] * boxes[2], planes[2][j] * boxes[5]) +
+					planes[3][j];
+				inside = dist >= 0.0f;
+			}
+			visible[i] = inside ? 1 : 0;
+			numvisible += inside ? 1 : 0;
+		}
+		return numvisible;
+	}
+
+#else
+
+	// Reads x, y, z without touching memory past the third float
+	inline __m128 LoadPoint(const uint8_t* src)
+	{
+		const float* p = reinterpret_cast<const float*>(src);
+		return _mm_movelh_ps(_mm_unpacklo_ps(_mm_load_ss(p), _mm_load_ss(p + 1)), _mm_load_ss(p + 2));
+	}
+
+	inline void StorePoint(uint8_t* dst, __m128 v)
+	{
+		float* p = reinterpret_cast<float*>(dst);
+		_mm_storel_pi(reinterpret_cast<__m64*>(p), v);
+		_mm_store_ss(p + 2, _mm_movehl_ps(v, v));
+	}
+
+	void TransformPoints(const float m[4][4], const uint8_t* src, int srcstride, uint8_t* dst, int dststride, int count)
+	{
+		__m128 row0 = _mm_loadu_ps(m[0]);
+		__m128 row1 = _mm_loadu_ps(m[1]);
+		__m128 row2 = _mm_loadu_ps(m[2]);
+		__m128 row3 = _mm_loadu_ps(m[3]);
+		for (int i = 0; i < count; i++, src += srcstride, dst += dststride)
+		{
+			__m128 p = LoadPoint(src);
+			__m128 r = _mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(0, 0, 0, 0)), row0), row3);
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1)), row1));
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 2, 2)), row2));
+			StorePoint(dst, r);
+		}
+	}
+
+	void ProjectPoints(const float m[4][4], const uint8_t* src, int srcstride, int count, float width, float height, float* result)
+	{
+		__m128 row0 = _mm_loadu_ps(m[0]);
+		__m128 row1 = _mm_loadu_ps(m[1]);
+		__m128 row2 = _mm_loadu_ps(m[2]);
+		__m128 row3 = _mm_loadu_ps(m[3]);
+		__m128 scale = _mm_setr_ps(0.5f * width, -0.5f * height, 1.0f, 0.0f);
+		__m128 offset = _mm_setr_ps(0.5f * width, 0.5f * height, 0.0f, 0.0f);
+		__m128 wmask = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+		for (int i = 0; i < count; i++, src += srcstride, result += 4)
+		{
+			__m128 p = LoadPoint(src);
+			__m128 clip = _mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(0, 0, 0, 0)), row0), row3);
+			clip = _mm_add_ps(clip, _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1)), row1));
+			clip = _mm_add_ps(clip, _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 2, 2)), row2));
+			__m128 w = _mm_shuffle_ps(clip, clip, _MM_SHUFFLE(3, 3, 3, 3));
+			__m128 ndc = _mm_div_ps(clip, w);
+			__m128 screen = _mm_add_ps(_mm_mul_ps(ndc, scale), offset);
+			_mm_storeu_ps(result, _mm_or_ps(_mm_andnot_ps(wmask, screen), _mm_and_ps(wmask, clip)));
+		}
+	}
+
+	void BoundingBox(const uint8_t* src, int stride, int count, float* result)
+	{
+		__m128 minv = LoadPoint(src);
+		__m128 maxv = minv;
+		for (int i = 1; i < count; i++)
+		{
+			__m128 p = LoadPoint(src + (size_t)i * stride);
+			minv = _mm_min_ps(minv, p);
+			maxv = _mm_max_ps(maxv, p);
+		}
+		StorePoint(reinterpret_cast<uint8_t*>(result), minv);
+		StorePoint(reinterpret_cast<uint8_t*>(result + 3), maxv);
+	}
+
+	int CullBoxes(const float planes[4][8], const float* boxes, int count, uint8_t* visible)
+	{
+		__m128 nx0 = _mm_loadu_ps(planes[0]), nx1 = _mm_loadu_ps(planes[0] + 4);
+		__m128 ny0 = _mm_loadu_ps(planes[1]), ny1 = _mm_loadu_ps(planes[1] + 4);
+		__m128 nz0 = _mm_loadu_ps(planes[2]), nz1 = _mm_loadu_ps(planes[2] + 4);
+		__m128 d0 = _mm_loadu_ps(planes[3]), d1 = _mm_loadu_ps(planes[3] + 4);
+		__m128 zero = _mm_setzero_ps();
+
+		int numvisible = 0;
+		for (int i = 0; i < count; i++, boxes += 6)
+		{
+			__m128 minx = _mm_set1_ps(boxes[0]), miny = _mm_set1_ps(boxes[1]), minz = _mm_set1_ps(boxes[2]);
+			__m128 maxx = _mm_set1_ps(boxes[3]), maxy = _mm_set1_ps(boxes[4]), maxz = _mm_set1_ps(boxes[5]);
+
+			__m128 dist0 = _mm_add_ps(d0, _mm_max_ps(_mm_mul_ps(nx0, minx), _mm_mul_ps(nx0, maxx)));
+			dist0 = _mm_add_ps(dist0, _mm_max_ps(_mm_mul_ps(ny0, miny), _mm_mul_ps(ny0, maxy)));
+			dist0 = _mm_add_ps(dist0, _mm_max_ps(_mm_mul_ps(nz0, minz), _mm_mul_ps(nz0, maxz)));
+
+			__m128 dist1 = _mm_add_ps(d1, _mm_max_ps(_mm_mul_ps(nx1, minx), _mm_mul_ps(nx1, maxx)));
+			dist1 = _mm_add_ps(dist1, _mm_max_ps(_mm_mul_ps(ny1, miny), _mm_mul_ps(ny1, maxy)));
+			dist1 = _mm_add_ps(dist1, _mm_max_ps(_mm_mul_ps(nz1, minz), _mm_mul_ps(nz1, maxz)));
+
+			int outside = _mm_movemask_ps(_mm_or_ps(_mm_cmplt_ps(dist0, zero), _mm_cmplt_ps(dist1, zero)));
+			visible[i] = outside == 0 ? 1 : 0;
+			numvisible += outside == 0 ? 1 : 0;
+		}
+		return numvisible;
+	}
+
+#endif
+}
+
+extern "C"
+{
+
+void Matrix_TransformPoints(const float matrix[4][4], const void* src, int srcstride, void* dst, int dststride, int count)
+{
+	if (count > 0)
+		TransformPoints(matrix, static_cast<const uint8_t*>(src), srcstride, static_cast<uint8_t*>(dst), dststride, count);
+}
+
+void Matrix_ProjectPoints(const float matrix[4][4], const void* src, int srcstride, int count, float width, float height, float* result)
+{
+	if (count > 0)
+		ProjectPoints(matrix, static_cast<const uint8_t*>(src), srcstride, count, width, height, result);
+}
+
+bool Matrix_BoundingBox(const void* src, int stride, int count, float* result)
+{
+	if (count <= 0)
+		return false;
+	BoundingBox(static_cast<const uint8_t*>(src), stride, count, result);
+	return true;
+}
+
+int Matrix_CullBoxes(const float matrix[4][4], const float* boxes, int count, uint8_t* visible)
+{
+	if (count <= 0)
+		return 0;
+	float planes[4][8];
+	GetFrustumPlanes(matrix, planes);
+	return CullBoxes(planes, boxes, count, visible);
+}
+
+}
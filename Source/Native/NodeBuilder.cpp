@@ -0,0 +1,1126 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Precomp.h"
+#include "NodeBuilder.h"
+#include "Deflate.h"
+#include "Backend.h"
+#include "Software/SWRasterizer.h"
+#include <array>
+#include <atomic>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+
+namespace
+{
+	const double PI = 3.14159265358979323846;
+
+	// Distance from a partition at which a point counts as being on it
+	const double SideEpsilon = 0.001;
+
+	// Tolerances for fitting segs onto the edges of a GL subsector
+	const double EdgeEpsilon = 0.01;
+	const double GapEpsilon = 0.01;
+
+	// Partition scoring. Splits are weighed against the difference in seg count between the
+	// two sides, and splits that leave a piece under a map unit long are avoided.
+	const int SplitCost = 8;
+	const int TinySplitCost = 64;
+
+	// Only this many partition lines are scored per node. If none of them divides the segs
+	// the remaining lines are tried as well.
+	const int MaxCandidates = 128;
+
+	// Below this many seg tests per node the worker threads cost more than they save
+	const int64_t ParallelThreshold = 16384;
+
+	enum SegSide
+	{
+		Front,
+		Back,
+		Split
+	};
+
+	class LumpWriter
+	{
+	public:
+		LumpWriter(std::vector<uint8_t>& data) : mData(data) { }
+
+		void UInt8(int v) { mData.push_back((uint8_t)v); }
+		void Int16(int v) { UInt8(v); UInt8(v >> 8); }
+		void Int32(int64_t v) { Int16((int)v); Int16((int)(v >> 16)); }
+		void Tag(const char* tag) { mData.insert(mData.end(), tag, tag + 4); }
+
+	private:
+		std::vector<uint8_t>& mData;
+	};
+
+	int ToInt16(double v)
+	{
+		return (int)std::max(std::min(std::round(v), 32767.0), -32768.0);
+	}
+
+	int64_t ToFixed(double v)
+	{
+		return (int64_t)std::llround(v * 65536.0);
+	}
+
+	int BBoxToInt16(const double* bbox, int i)
+	{
+		// Top, bottom, left and right, rounded outwards
+		return ToInt16((i == 0 || i == 3) ? std::ceil(bbox[i]) : std::floor(bbox[i]));
+	}
+
+	void ClearBounds(double* bbox)
+	{
+		bbox[0] = -DBL_MAX;
+		bbox[1] = DBL_MAX;
+		bbox[2] = DBL_MAX;
+		bbox[3] = -DBL_MAX;
+	}
+
+	void AddToBounds(double* bbox, double x, double y)
+	{
+		bbox[0] = std::max(bbox[0], y);
+		bbox[1] = std::min(bbox[1], y);
+		bbox[2] = std::min(bbox[2], x);
+		bbox[3] = std::max(bbox[3], x);
+	}
+
+	struct Point
+	{
+		double X, Y;
+	};
+
+	// Clips a convex polygon to the front (or back) of a partition
+	template<typename PartitionType>
+	void ClipPolygon(std::vector<Point>& polygon, const PartitionType& part, bool keepfront)
+	{
+		if (polygon.empty())
+			return;
+
+		std::vector<Point> result;
+		result.reserve(polygon.size() + 1);
+		double sign = keepfront ? 1.0 : -1.0;
+		for (size_t i = 0; i < polygon.size(); i++)
+		{
+			const Point& p = polygon[i];
+			const Point& q = polygon[(i + 1) % polygon.size()];
+			double dp = ((p.X - part.X) * part.DY - (p.Y - part.Y) * part.DX) * part.InvLength * sign;
+			double dq = ((q.X - part.X) * part.DY - (q.Y - part.Y) * part.DX) * part.InvLength * sign;
+			bool pinside = dp >= -SideEpsilon;
+			bool qinside = dq >= -SideEpsilon;
+			if (pinside)
+				result.push_back(p);
+			if (pinside != qinside)
+			{
+				double t = dp / (dp - dq);
+				result.push_back({ p.X + (q.X - p.X) * t, p.Y + (q.Y - p.Y) * t });
+			}
+		}
+
+		// Drop the points that ended up on top of each other
+		polygon.clear();
+		for (const Point& p : result)
+		{
+			if (polygon.empty() || std::abs(p.X - polygon.back().X) > SideEpsilon || std::abs(p.Y - polygon.back().Y) > SideEpsilon)
+				polygon.push_back(p);
+		}
+		while (polygon.size() > 1 && std::abs(polygon.front().X - polygon.back().X) <= SideEpsilon && std::abs(polygon.front().Y - polygon.back().Y) <= SideEpsilon)
+			polygon.pop_back();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+NodeBuilder::NodeBuilder()
+{
+	mPool = SWWorkerPool::GetShared();
+}
+
+NodeBuilder::~NodeBuilder()
+{
+}
+
+bool NodeBuilder::Build(const NodeBuilderVertex* vertices, int numvertices, const NodeBuilderLine* lines, int numlines, NodeBuilderFormat format)
+{
+	if (numvertices < 0 || numlines < 0 || (numvertices > 0 && !vertices) || (numlines > 0 && !lines))
+	{
+		SetError("Invalid nodebuilder input");
+		return false;
+	}
+
+	mLines = lines;
+	mNumLines = numlines;
+	mNumOriginalVertices = numvertices;
+	mVertices.assign(vertices, vertices + numvertices);
+	mVertexLookup.clear();
+	mSegs.clear();
+	mNodes.clear();
+	mSubSectors.clear();
+	mGLSubSectors.clear();
+	mLineMark.assign(numlines, 0);
+	mLineStamp = 0;
+	for (auto& lump : mLumps)
+		lump.clear();
+
+	for (int i = 0; i < numvertices; i++)
+		mVertexLookup.insert({ ((uint64_t)ToFixed(vertices[i].X) << 32) ^ (uint32_t)ToFixed(vertices[i].Y), i });
+
+	// Every side of a line becomes a seg, running clockwise around its sector
+	for (int i = 0; i < numlines; i++)
+	{
+		const NodeBuilderLine& line = lines[i];
+		if (line.V1 < 0 || line.V1 >= numvertices || line.V2 < 0 || line.V2 >= numvertices)
+		{
+			SetError("Linedef %d references an invalid vertex", i);
+			return false;
+		}
+
+		const NodeBuilderVertex& v1 = vertices[line.V1];
+		const NodeBuilderVertex& v2 = vertices[line.V2];
+		if (v1.X == v2.X && v1.Y == v2.Y)
+			continue;
+
+		if (line.FrontSector >= 0)
+			mSegs.push_back({ line.V1, line.V2, i, 0, line.FrontSector });
+		if (line.BackSector >= 0)
+			mSegs.push_back({ line.V2, line.V1, i, 1, line.BackSector });
+	}
+
+	if (mSegs.empty())
+	{
+		SetError("The map has no lines to build nodes from");
+		return false;
+	}
+
+	BuildTree();
+
+	switch (format)
+	{
+	case NodeBuilderFormat::Vanilla:
+		if (!WriteVanilla())
+			return false;
+		break;
+	case NodeBuilderFormat::XNOD:
+	case NodeBuilderFormat::ZNOD:
+		if (!WriteExtended(format == NodeBuilderFormat::ZNOD))
+			return false;
+		break;
+	case NodeBuilderFormat::XGL3:
+	case NodeBuilderFormat::ZGL3:
+		return WriteGL(format == NodeBuilderFormat::ZGL3);
+	default:
+		SetError("Unknown node format %d", (int)format);
+		return false;
+	}
+
+	WriteBlockmap();
+	return true;
+}
+
+void NodeBuilder::BuildTree()
+{
+	struct Work
+	{
+		std::vector<int> Segs;
+		int Parent;
+		int Side;
+	};
+
+	std::vector<Work> stack;
+	stack.push_back({ {}, -1, 0 });
+	stack.back().Segs.reserve(mSegs.size());
+	for (int i = 0; i < (int)mSegs.size(); i++)
+		stack.back().Segs.push_back(i);
+
+	while (!stack.empty())
+	{
+		Work work = std::move(stack.back());
+		stack.pop_back();
+
+		// A set of segs that all face each other is convex, but it may still hold more than one
+		// sector. Those are separated by moving the segs of one line behind a partition on it.
+		bool shove = false;
+		int partition = ChoosePartition(work.Segs);
+		if (partition == -1)
+		{
+			partition = FindSectorSplit(work.Segs);
+			shove = (partition != -1);
+		}
+
+		std::vector<int> front, back;
+		if (partition != -1)
+			SplitSegs(work.Segs, partition, shove, front, back);
+
+		int child;
+		if (front.empty() || back.empty())
+		{
+			if (partition != -1)
+			{
+				work.Segs = std::move(front);
+				work.Segs.insert(work.Segs.end(), back.begin(), back.end());
+			}
+			child = ~(int)mSubSectors.size();
+			mSubSectors.push_back({ std::move(work.Segs), work.Parent, work.Side });
+		}
+		else
+		{
+			Node node;
+			node.Line = mSegs[partition].Line;
+			node.Side = mSegs[partition].Side;
+			node.Children[0] = 0;
+			node.Children[1] = 0;
+			node.Parent = work.Parent;
+			node.ParentSide = work.Side;
+			GetBounds(front, node.BBox[0]);
+			GetBounds(back, node.BBox[1]);
+
+			child = (int)mNodes.size();
+			mNodes.push_back(node);
+			stack.push_back({ std::move(back), child, 1 });
+			stack.push_back({ std::move(front), child, 0 });
+		}
+
+		if (work.Parent >= 0)
+			mNodes[work.Parent].Children[work.Side] = child;
+		else
+			mRoot = child;
+	}
+}
+
+int NodeBuilder::ChoosePartition(const std::vector<int>& segs)
+{
+	// All segs of a line give the same partition, so each line is tried once
+	std::vector<int> candidates;
+	mLineStamp++;
+	for (int index : segs)
+	{
+		int line = mSegs[index].Line;
+		if (mLineMark[line] != mLineStamp)
+		{
+			mLineMark[line] = mLineStamp;
+			candidates.push_back(index);
+		}
+	}
+
+	if (candidates.size() <= 1 && segs.size() > 1 && candidates.size() == segs.size())
+		return -1;
+
+	if ((int)candidates.size() > MaxCandidates)
+	{
+		std::vector<int> sample(MaxCandidates);
+		for (int i = 0; i < MaxCandidates; i++)
+			sample[i] = candidates[(size_t)i * candidates.size() / MaxCandidates];
+
+		int best = FindBestCandidate(sample, segs);
+		if (best != -1)
+			return best;
+	}
+
+	return FindBestCandidate(candidates, segs);
+}
+
+int NodeBuilder::FindBestCandidate(const std::vector<int>& candidates, const std::vector<int>& segs)
+{
+	std::vector<int> costs(candidates.size());
+	std::atomic<int> bestcost(INT_MAX);
+
+	auto evaluate = [&](int i) {
+		int cost = EvaluatePartition(candidates[i], segs, bestcost.load(std::memory_order_relaxed));
+		costs[i] = cost;
+		if (cost >= 0)
+		{
+			int current = bestcost.load(std::memory_order_relaxed);
+			while (cost < current && !bestcost.compare_exchange_weak(current, cost, std::memory_order_relaxed));
+		}
+	};
+
+	if ((int64_t)segs.size() * (int64_t)candidates.size() >= ParallelThreshold && mPool->GetThreadCount() > 1)
+	{
+		mPool->Run((int)candidates.size(), evaluate);
+	}
+	else
+	{
+		for (int i = 0; i < (int)candidates.size(); i++)
+			evaluate(i);
+	}
+
+	// Candidates are only abandoned when they are strictly worse than another, which keeps the
+	// choice the same no matter how the work was spread over the threads
+	int best = -1;
+	for (int i = 0; i < (int)candidates.size(); i++)
+	{
+		if (costs[i] >= 0 && (best == -1 || costs[i] < costs[best]))
+			best = i;
+	}
+	return best != -1 ? candidates[best] : -1;
+}
+
+int NodeBuilder::EvaluatePartition(int candidate, const std::vector<int>& segs, int bestcost) const
+{
+	const Seg& pseg = mSegs[candidate];
+	Partition part = GetPartition(pseg.Line, pseg.Side);
+
+	int front = 0, back = 0, splits = 0, tiny = 0;
+	int remaining = (int)segs.size();
+	for (int index : segs)
+	{
+		remaining--;
+
+		const Seg& seg = mSegs[index];
+		if (seg.Line == pseg.Line)
+		{
+			if (seg.Side == pseg.Side)
+				front++;
+			else
+				back++;
+			continue;
+		}
+
+		double a, b;
+		switch (Classify(part, seg, a, b))
+		{
+		case Front:
+			front++;
+			break;
+		case Back:
+			back++;
+			break;
+		default:
+		{
+			front++;
+			back++;
+			splits++;
+
+			const NodeBuilderVertex& v1 = mVertices[seg.V1];
+			const NodeBuilderVertex& v2 = mVertices[seg.V2];
+			double length = std::sqrt((v2.X - v1.X) * (v2.X - v1.X) + (v2.Y - v1.Y) * (v2.Y - v1.Y));
+			double t = a / (a - b);
+			if (length * t < 1.0 || length * (1.0 - t) < 1.0)
+				tiny++;
+
+			// The segs left can at best even out the sides
+			if (splits * SplitCost + tiny * TinySplitCost + std::max(std::abs(front - back) - remaining, 0) > bestcost)
+				return INT_MAX;
+			break;
+		}
+		}
+	}
+
+	if (front == 0 || back == 0)
+		return -1;
+
+	return splits * SplitCost + tiny * TinySplitCost + std::abs(front - back);
+}
+
+int NodeBuilder::FindSectorSplit(const std::vector<int>& segs) const
+{
+	int sector = mSegs[segs[0]].Sector;
+	for (int index : segs)
+	{
+		if (mSegs[index].Sector != sector)
+			return index;
+	}
+	return -1;
+}
+
+int NodeBuilder::Classify(const Partition& part, const Seg& seg, double& a, double& b) const
+{
+	a = part.Distance(mVertices[seg.V1]);
+	b = part.Distance(mVertices[seg.V2]);
+
+	if (a > -SideEpsilon && b > -SideEpsilon)
+	{
+		if (a < SideEpsilon && b < SideEpsilon)
+		{
+			// On the partition. The seg belongs to the side it is facing.
+			const NodeBuilderVertex& v1 = mVertices[seg.V1];
+			const NodeBuilderVertex& v2 = mVertices[seg.V2];
+			return ((v2.X - v1.X) * part.DX + (v2.Y - v1.Y) * part.DY) > 0.0 ? Front : Back;
+		}
+		return Front;
+	}
+	else if (a < SideEpsilon && b < SideEpsilon)
+	{
+		return Back;
+	}
+	return Split;
+}
+
+void NodeBuilder::SplitSegs(const std::vector<int>& segs, int partition, bool shove, std::vector<int>& front, std::vector<int>& back)
+{
+	int pline = mSegs[partition].Line;
+	int pside = mSegs[partition].Side;
+	Partition part = GetPartition(pline, pside);
+
+	for (int index : segs)
+	{
+		Seg seg = mSegs[index];
+		if (seg.Line == pline)
+		{
+			if (seg.Side == pside && !shove)
+				front.push_back(index);
+			else
+				back.push_back(index);
+			continue;
+		}
+
+		double a, b;
+		int side = Classify(part, seg, a, b);
+		if (side == Front && shove && a < SideEpsilon && b < SideEpsilon)
+			side = Back;
+
+		if (side == Front)
+		{
+			front.push_back(index);
+		}
+		else if (side == Back)
+		{
+			back.push_back(index);
+		}
+		else
+		{
+			// Both sides of a line are split with their vertices in the same order,
+			// so that they end up sharing the new vertex
+			const NodeBuilderVertex& v1 = mVertices[seg.V1];
+			const NodeBuilderVertex& v2 = mVertices[seg.V2];
+			double x, y;
+			if (seg.V1 < seg.V2)
+			{
+				double t = a / (a - b);
+				x = v1.X + (v2.X - v1.X) * t;
+				y = v1.Y + (v2.Y - v1.Y) * t;
+			}
+			else
+			{
+				double t = b / (b - a);
+				x = v2.X + (v1.X - v2.X) * t;
+				y = v2.Y + (v1.Y - v2.Y) * t;
+			}
+
+			int vertex = AddVertex(x, y);
+			if (vertex == seg.V1 || vertex == seg.V2)
+			{
+				// Too close to an end to split
+				if (std::abs(a) > std::abs(b))
+					(a > 0.0 ? front : back).push_back(index);
+				else
+					(b > 0.0 ? front : back).push_back(index);
+				continue;
+			}
+
+			Seg first = seg;
+			Seg second = seg;
+			first.V2 = vertex;
+			second.V1 = vertex;
+			mSegs[index] = first;
+			int secondindex = (int)mSegs.size();
+			mSegs.push_back(second);
+
+			if (a > 0.0)
+			{
+				front.push_back(index);
+				back.push_back(secondindex);
+			}
+			else
+			{
+				back.push_back(index);
+				front.push_back(secondindex);
+			}
+		}
+	}
+}
+
+int NodeBuilder::AddVertex(double x, double y)
+{
+	uint64_t key = ((uint64_t)ToFixed(x) << 32) ^ (uint32_t)ToFixed(y);
+	auto it = mVertexLookup.find(key);
+	if (it != mVertexLookup.end())
+		return it->second;
+
+	int index = (int)mVertices.size();
+	mVertices.push_back({ x, y });
+	mVertexLookup.insert({ key, index });
+	return index;
+}
+
+void NodeBuilder::GetBounds(const std::vector<int>& segs, double* bbox) const
+{
+	ClearBounds(bbox);
+	for (int index : segs)
+	{
+		const Seg& seg = mSegs[index];
+		AddToBounds(bbox, mVertices[seg.V1].X, mVertices[seg.V1].Y);
+		AddToBounds(bbox, mVertices[seg.V2].X, mVertices[seg.V2].Y);
+	}
+}
+
+NodeBuilder::Partition NodeBuilder::GetPartition(int line, int side) const
+{
+	// The partition runs along the whole linedef, which keeps its coordinates exact
+	const NodeBuilderVertex& v1 = mVertices[side == 0 ? mLines[line].V1 : mLines[line].V2];
+	const NodeBuilderVertex& v2 = mVertices[side == 0 ? mLines[line].V2 : mLines[line].V1];
+
+	Partition part;
+	part.X = v1.X;
+	part.Y = v1.Y;
+	part.DX = v2.X - v1.X;
+	part.DY = v2.Y - v1.Y;
+	part.InvLength = 1.0 / std::sqrt(part.DX * part.DX + part.DY * part.DY);
+	return part;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+void NodeBuilder::BuildGLSubSectors()
+{
+	mGLSubSectors.clear();
+	mGLSubSectors.resize(mSubSectors.size());
+
+	ClearBounds(mMapBounds);
+	for (const NodeBuilderVertex& v : mVertices)
+		AddToBounds(mMapBounds, v.X, v.Y);
+
+	mPool->Run((int)mSubSectors.size(), [&](int i) {
+		BuildGLSubSector(mSubSectors[i], mGLSubSectors[i]);
+	});
+
+	// Vertices are shared between subsectors, so they are only made after all are done
+	for (std::vector<GLSeg>& loop : mGLSubSectors)
+	{
+		for (GLSeg& seg : loop)
+		{
+			if (seg.V == -1)
+				seg.V = AddVertex(seg.X, seg.Y);
+		}
+
+		// Minisegs that got merged into a single vertex
+		std::vector<GLSeg> segs;
+		for (size_t i = 0; i < loop.size(); i++)
+		{
+			if (loop[i].Line != -1 || loop[i].V != loop[(i + 1) % loop.size()].V)
+				segs.push_back(loop[i]);
+		}
+		loop = std::move(segs);
+	}
+}
+
+void NodeBuilder::BuildGLSubSector(const SubSector& sub, std::vector<GLSeg>& loop) const
+{
+	// The area of a subsector is the part of the map that is on its side of every partition
+	// above it and in front of all its segs. Start with a box around the whole map.
+	const double* bounds = mMapBounds;
+	std::vector<Point> polygon = {
+		{ bounds[2] - 64.0, bounds[0] + 64.0 },
+		{ bounds[3] + 64.0, bounds[0] + 64.0 },
+		{ bounds[3] + 64.0, bounds[1] - 64.0 },
+		{ bounds[2] - 64.0, bounds[1] - 64.0 }
+	};
+
+	for (int node = sub.Parent, side = sub.ParentSide; node >= 0; side = mNodes[node].ParentSide, node = mNodes[node].Parent)
+		ClipPolygon(polygon, GetPartition(mNodes[node].Line, mNodes[node].Side), side == 0);
+
+	for (int index : sub.Segs)
+		ClipPolygon(polygon, GetPartition(mSegs[index].Line, mSegs[index].Side), true);
+
+	if (polygon.size() < 3)
+	{
+		BuildGLSubSectorFallback(sub, loop);
+		return;
+	}
+
+	// Find the edge of the polygon each seg lies on
+	int numedges = (int)polygon.size();
+	std::vector<std::vector<std::pair<double, int>>> edgesegs(numedges);
+	for (int index : sub.Segs)
+	{
+		const Seg& seg = mSegs[index];
+		const NodeBuilderVertex& v1 = mVertices[seg.V1];
+		const NodeBuilderVertex& v2 = mVertices[seg.V2];
+
+		bool found = false;
+		for (int e = 0; e < numedges && !found; e++)
+		{
+			const Point& p = polygon[e];
+			const Point& q = polygon[(e + 1) % numedges];
+			double dx = q.X - p.X;
+			double dy = q.Y - p.Y;
+			double invlength = 1.0 / std::sqrt(dx * dx + dy * dy);
+			double d1 = ((v1.X - p.X) * dy - (v1.Y - p.Y) * dx) * invlength;
+			double d2 = ((v2.X - p.X) * dy - (v2.Y - p.Y) * dx) * invlength;
+			if (std::abs(d1) < EdgeEpsilon && std::abs(d2) < EdgeEpsilon && (v2.X - v1.X) * dx + (v2.Y - v1.Y) * dy > 0.0)
+			{
+				edgesegs[e].push_back({ ((v1.X - p.X) * dx + (v1.Y - p.Y) * dy) * invlength, index });
+				found = true;
+			}
+		}
+
+		if (!found)
+		{
+			BuildGLSubSectorFallback(sub, loop);
+			return;
+		}
+	}
+
+	// Corners of the polygon reuse the vertices of the segs when they are close enough
+	auto corner = [&](const Point& p) -> GLSeg {
+		for (int index : sub.Segs)
+		{
+			for (int v : { mSegs[index].V1, mSegs[index].V2 })
+			{
+				if (std::abs(mVertices[v].X - p.X) < GapEpsilon && std::abs(mVertices[v].Y - p.Y) < GapEpsilon)
+					return { v, mVertices[v].X, mVertices[v].Y, -1, 0 };
+			}
+		}
+		return { -1, p.X, p.Y, -1, 0 };
+	};
+
+	auto gap = [](const GLSeg& a, const GLSeg& b) {
+		return std::abs(a.X - b.X) >= GapEpsilon || std::abs(a.Y - b.Y) >= GapEpsilon;
+	};
+
+	// Walk around the polygon, filling the stretches between the segs with minisegs
+	GLSeg current = corner(polygon[0]);
+	for (int e = 0; e < numedges; e++)
+	{
+		std::sort(edgesegs[e].begin(), edgesegs[e].end());
+		for (const auto& entry : edgesegs[e])
+		{
+			const Seg& seg = mSegs[entry.second];
+			GLSeg start = { seg.V1, mVertices[seg.V1].X, mVertices[seg.V1].Y, seg.Line, seg.Side };
+			if (gap(current, start))
+				loop.push_back(current);
+			loop.push_back(start);
+			current = { seg.V2, mVertices[seg.V2].X, mVertices[seg.V2].Y, -1, 0 };
+		}
+
+		GLSeg end = corner(polygon[(e + 1) % numedges]);
+		if (gap(current, end))
+		{
+			loop.push_back(current);
+			current = end;
+		}
+	}
+
+	if (!loop.empty() && gap(current, loop.front()))
+		loop.push_back(current);
+}
+
+void NodeBuilder::BuildGLSubSectorFallback(const SubSector& sub, std::vector<GLSeg>& loop) const
+{
+	// Order the segs clockwise around their center and connect the ends that don't meet
+	double cx = 0.0, cy = 0.0;
+	for (int index : sub.Segs)
+	{
+		cx += mVertices[mSegs[index].V1].X + mVertices[mSegs[index].V2].X;
+		cy += mVertices[mSegs[index].V1].Y + mVertices[mSegs[index].V2].Y;
+	}
+	cx /= sub.Segs.size() * 2;
+	cy /= sub.Segs.size() * 2;
+
+	std::vector<std::pair<double, int>> sorted;
+	for (int index : sub.Segs)
+	{
+		const NodeBuilderVertex& v1 = mVertices[mSegs[index].V1];
+		const NodeBuilderVertex& v2 = mVertices[mSegs[index].V2];
+		sorted.push_back({ -std::atan2((v1.Y + v2.Y) * 0.5 - cy, (v1.X + v2.X) * 0.5 - cx), index });
+	}
+	std::sort(sorted.begin(), sorted.end());
+
+	for (size_t i = 0; i < sorted.size(); i++)
+	{
+		const Seg& seg = mSegs[sorted[i].second];
+		const Seg& next = mSegs[sorted[(i + 1) % sorted.size()].second];
+		loop.push_back({ seg.V1, mVertices[seg.V1].X, mVertices[seg.V1].Y, seg.Line, seg.Side });
+		if (seg.V2 != next.V1)
+			loop.push_back({ seg.V2, mVertices[seg.V2].X, mVertices[seg.V2].Y, -1, 0 });
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+bool NodeBuilder::WriteVanilla()
+{
+	if (mVertices.size() > 65535 || mSegs.size() > 65535 || mSubSectors.size() > 32767 || mNodes.size() > 32767)
+	{
+		SetError("The map is too big for vanilla nodes (%d vertices, %d segs, %d subsectors, %d nodes). Use extended nodes instead.",
+			(int)mVertices.size(), (int)mSegs.size(), (int)mSubSectors.size(), (int)mNodes.size());
+		return false;
+	}
+
+	LumpWriter vertexes(mLumps[(int)NodeBuilderLump::Vertexes]);
+	for (const NodeBuilderVertex& v : mVertices)
+	{
+		vertexes.Int16(ToInt16(v.X));
+		vertexes.Int16(ToInt16(v.Y));
+	}
+
+	LumpWriter segs(mLumps[(int)NodeBuilderLump::Segs]);
+	LumpWriter subsectors(mLumps[(int)NodeBuilderLump::SubSectors]);
+	int firstseg = 0;
+	for (const SubSector& sub : mSubSectors)
+	{
+		subsectors.Int16((int)sub.Segs.size());
+		subsectors.Int16(firstseg);
+		firstseg += (int)sub.Segs.size();
+
+		for (int index : sub.Segs)
+		{
+			const Seg& seg = mSegs[index];
+			const NodeBuilderLine& line = mLines[seg.Line];
+			const NodeBuilderVertex& start = mVertices[seg.Side == 0 ? line.V1 : line.V2];
+			const NodeBuilderVertex& end = mVertices[seg.Side == 0 ? line.V2 : line.V1];
+			const NodeBuilderVertex& v1 = mVertices[seg.V1];
+			double angle = std::atan2(end.Y - start.Y, end.X - start.X);
+
+			segs.Int16(seg.V1);
+			segs.Int16(seg.V2);
+			segs.Int16((int)std::llround(angle * (32768.0 / PI)));
+			segs.Int16(seg.Line);
+			segs.Int16(seg.Side);
+			segs.Int16((int)std::llround(std::sqrt((v1.X - start.X) * (v1.X - start.X) + (v1.Y - start.Y) * (v1.Y - start.Y))));
+		}
+	}
+
+	// The root node has to come last, so the nodes are written in reverse
+	int numnodes = (int)mNodes.size();
+	LumpWriter nodes(mLumps[(int)NodeBuilderLump::Nodes]);
+	for (int i = numnodes - 1; i >= 0; i--)
+	{
+		const Node& node = mNodes[i];
+		Partition part = GetPartition(node.Line, node.Side);
+		int dx = ToInt16(part.DX);
+		int dy = ToInt16(part.DY);
+
+		// Very long lines don't fit, but only the direction matters
+		double scale = std::max(std::abs(part.DX), std::abs(part.DY)) / 32767.0;
+		if (scale > 1.0)
+		{
+			dx = ToInt16(part.DX / scale);
+			dy = ToInt16(part.DY / scale);
+		}
+
+		nodes.Int16(ToInt16(part.X));
+		nodes.Int16(ToInt16(part.Y));
+		nodes.Int16(dx);
+		nodes.Int16(dy);
+		for (int side = 0; side < 2; side++)
+		{
+			for (int j = 0; j < 4; j++)
+				nodes.Int16(BBoxToInt16(node.BBox[side], j));
+		}
+		for (int side = 0; side < 2; side++)
+		{
+			int child = node.Children[side];
+			nodes.Int16(child >= 0 ? numnodes - 1 - child : (0x8000 | ~child));
+		}
+	}
+
+	return true;
+}
+
+bool NodeBuilder::WriteExtended(bool compress)
+{
+	if (mNumLines > 65535)
+	{
+		SetError("The map has too many linedefs for extended nodes");
+		return false;
+	}
+
+	std::vector<uint8_t> data;
+	LumpWriter writer(data);
+
+	writer.Int32(mNumOriginalVertices);
+	writer.Int32((int)mVertices.size() - mNumOriginalVertices);
+	for (size_t i = mNumOriginalVertices; i < mVertices.size(); i++)
+	{
+		writer.Int32(ToFixed(mVertices[i].X));
+		writer.Int32(ToFixed(mVertices[i].Y));
+	}
+
+	writer.Int32((int)mSubSectors.size());
+	for (const SubSector& sub : mSubSectors)
+		writer.Int32((int)sub.Segs.size());
+
+	writer.Int32((int)mSegs.size());
+	for (const SubSector& sub : mSubSectors)
+	{
+		for (int index : sub.Segs)
+		{
+			const Seg& seg = mSegs[index];
+			writer.Int32(seg.V1);
+			writer.Int32(seg.V2);
+			writer.Int16(seg.Line);
+			writer.UInt8(seg.Side);
+		}
+	}
+
+	int numnodes = (int)mNodes.size();
+	writer.Int32(numnodes);
+	for (int i = numnodes - 1; i >= 0; i--)
+	{
+		const Node& node = mNodes[i];
+		Partition part = GetPartition(node.Line, node.Side);
+		double scale = std::max(1.0, std::max(std::abs(part.DX), std::abs(part.DY)) / 32767.0);
+		writer.Int16(ToInt16(part.X));
+		writer.Int16(ToInt16(part.Y));
+		writer.Int16(ToInt16(part.DX / scale));
+		writer.Int16(ToInt16(part.DY / scale));
+		for (int side = 0; side < 2; side++)
+		{
+			for (int j = 0; j < 4; j++)
+				writer.Int16(BBoxToInt16(node.BBox[side], j));
+		}
+		for (int side = 0; side < 2; side++)
+		{
+			int child = node.Children[side];
+			writer.Int32(child >= 0 ? (int64_t)(numnodes - 1 - child) : (0x80000000LL | ~child));
+		}
+	}
+
+	std::vector<uint8_t>& lump = mLumps[(int)NodeBuilderLump::Nodes];
+	LumpWriter(lump).Tag(compress ? "ZNOD" : "XNOD");
+	if (compress)
+		DeflateZlib(data.data(), data.size(), lump);
+	else
+		lump.insert(lump.end(), data.begin(), data.end());
+	return true;
+}
+
+bool NodeBuilder::WriteGL(bool compress)
+{
+	BuildGLSubSectors();
+
+	// Subsector bounds include the minisegs, which can reach past the segs
+	std::vector<std::array<double, 4>> subbounds(mSubSectors.size());
+	for (size_t i = 0; i < mGLSubSectors.size(); i++)
+	{
+		ClearBounds(subbounds[i].data());
+		for (const GLSeg& seg : mGLSubSectors[i])
+			AddToBounds(subbounds[i].data(), mVertices[seg.V].X, mVertices[seg.V].Y);
+	}
+
+	// Nodes are made before their children, so walking backwards sees the children first
+	std::vector<std::array<double, 4>> nodebounds(mNodes.size());
+	for (int i = (int)mNodes.size() - 1; i >= 0; i--)
+	{
+		Node& node = mNodes[i];
+		ClearBounds(nodebounds[i].data());
+		for (int side = 0; side < 2; side++)
+		{
+			int child = node.Children[side];
+			const double* childbounds = child >= 0 ? nodebounds[child].data() : subbounds[~child].data();
+			for (int j = 0; j < 4; j++)
+				node.BBox[side][j] = childbounds[j];
+			AddToBounds(nodebounds[i].data(), childbounds[2], childbounds[0]);
+			AddToBounds(nodebounds[i].data(), childbounds[3], childbounds[1]);
+		}
+	}
+
+	// Partner segs run along the same stretch in the other direction
+	std::unordered_map<uint64_t, int> segindex;
+	int numsegs = 0;
+	for (const std::vector<GLSeg>& loop : mGLSubSectors)
+	{
+		for (size_t i = 0; i < loop.size(); i++)
+			segindex[((uint64_t)loop[i].V << 32) | (uint32_t)loop[(i + 1) % loop.size()].V] = numsegs++;
+	}
+
+	std::vector<uint8_t> data;
+	LumpWriter writer(data);
+
+	writer.Int32(mNumOriginalVertices);
+	writer.Int32((int)mVertices.size() - mNumOriginalVertices);
+	for (size_t i = mNumOriginalVertices; i < mVertices.size(); i++)
+	{
+		writer.Int32(ToFixed(mVertices[i].X));
+		writer.Int32(ToFixed(mVertices[i].Y));
+	}
+
+	writer.Int32((int)mGLSubSectors.size());
+	for (const std::vector<GLSeg>& loop : mGLSubSectors)
+		writer.Int32((int)loop.size());
+
+	writer.Int32(numsegs);
+	for (const std::vector<GLSeg>& loop : mGLSubSectors)
+	{
+		for (size_t i = 0; i < loop.size(); i++)
+		{
+			const GLSeg& seg = loop[i];
+			int next = loop[(i + 1) % loop.size()].V;
+			auto partner = segindex.find(((uint64_t)next << 32) | (uint32_t)seg.V);
+			writer.Int32(seg.V);
+			writer.Int32(partner != segindex.end() ? partner->second : 0xffffffffLL);
+			writer.Int32(seg.Line != -1 ? seg.Line : 0xffffffffLL);
+			writer.UInt8(seg.Side);
+		}
+	}
+
+	int numnodes = (int)mNodes.size();
+	writer.Int32(numnodes);
+	for (int i = numnodes - 1; i >= 0; i--)
+	{
+		const Node& node = mNodes[i];
+		Partition part = GetPartition(node.Line, node.Side);
+		writer.Int32(ToFixed(part.X));
+		writer.Int32(ToFixed(part.Y));
+		writer.Int32(ToFixed(part.DX));
+		writer.Int32(ToFixed(part.DY));
+		for (int side = 0; side < 2; side++)
+		{
+			for (int j = 0; j < 4; j++)
+				writer.Int16(BBoxToInt16(node.BBox[side], j));
+		}
+		for (int side = 0; side < 2; side++)
+		{
+			int child = node.Children[side];
+			writer.Int32(child >= 0 ? (int64_t)(numnodes - 1 - child) : (0x80000000LL | ~child));
+		}
+	}
+
+	std::vector<uint8_t>& lump = mLumps[(int)NodeBuilderLump::Nodes];
+	LumpWriter(lump).Tag(compress ? "ZGL3" : "XGL3");
+	if (compress)
+		DeflateZlib(data.data(), data.size(), lump);
+	else
+		lump.insert(lump.end(), data.begin(), data.end());
+	return true;
+}
+
+void NodeBuilder::WriteBlockmap()
+{
+	const int BlockSize = 128;
+
+	double bounds[4];
+	ClearBounds(bounds);
+	for (int i = 0; i < mNumOriginalVertices; i++)
+		AddToBounds(bounds, mVertices[i].X, mVertices[i].Y);
+
+	int originx = (int)std::floor(bounds[2]) - 8;
+	int originy = (int)std::floor(bounds[1]) - 8;
+	int columns = ((int)std::ceil(bounds[3]) - originx) / BlockSize + 1;
+	int rows = ((int)std::ceil(bounds[0]) - originy) / BlockSize + 1;
+
+	// Lines are added to every block they touch, in the order of the linedefs
+	std::vector<std::vector<int>> blocks((size_t)columns * rows);
+	for (int i = 0; i < mNumLines; i++)
+	{
+		const NodeBuilderVertex& v1 = mVertices[mLines[i].V1];
+		const NodeBuilderVertex& v2 = mVertices[mLines[i].V2];
+		double x1 = v1.X - originx, y1 = v1.Y - originy;
+		double x2 = v2.X - originx, y2 = v2.Y - originy;
+
+		int bx1 = (int)std::floor(std::min(x1, x2) / BlockSize);
+		int bx2 = (int)std::floor(std::max(x1, x2) / BlockSize);
+		int by1 = (int)std::floor(std::min(y1, y2) / BlockSize);
+		int by2 = (int)std::floor(std::max(y1, y2) / BlockSize);
+		for (int by = by1; by <= by2; by++)
+		{
+			for (int bx = bx1; bx <= bx2; bx++)
+			{
+				// The line touches the block when the corners aren't all on one side of it
+				double left = bx * BlockSize, bottom = by * BlockSize;
+				double right = left + BlockSize, top = bottom + BlockSize;
+				double dx = x2 - x1, dy = y2 - y1;
+				double s1 = (left - x1) * dy - (bottom - y1) * dx;
+				double s2 = (right - x1) * dy - (bottom - y1) * dx;
+				double s3 = (left - x1) * dy - (top - y1) * dx;
+				double s4 = (right - x1) * dy - (top - y1) * dx;
+				if ((s1 > 0.0 && s2 > 0.0 && s3 > 0.0 && s4 > 0.0) || (s1 < 0.0 && s2 < 0.0 && s3 < 0.0 && s4 < 0.0))
+					continue;
+				blocks[(size_t)by * columns + bx].push_back(i);
+			}
+		}
+	}
+
+	// Blocks with the same lines share one list
+	std::vector<uint16_t> offsets(blocks.size());
+	std::vector<int> lists;
+	std::map<std::vector<int>, int> shared;
+	int start = 4 + (int)blocks.size();
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		auto it = shared.find(blocks[i]);
+		if (it == shared.end())
+		{
+			int offset = start + (int)lists.size();
+			if (offset > 65535)
+			{
+				// Too big for the format. Ports that can handle such maps build their own.
+				return;
+			}
+
+			it = shared.insert({ blocks[i], offset }).first;
+			lists.push_back(0);
+			lists.insert(lists.end(), blocks[i].begin(), blocks[i].end());
+			lists.push_back(-1);
+		}
+		offsets[i] = (uint16_t)it->second;
+	}
+
+	LumpWriter writer(mLumps[(int)NodeBuilderLump::Blockmap]);
+	writer.Int16(originx);
+	writer.Int16(originy);
+	writer.Int16(columns);
+	writer.Int16(rows);
+	for (uint16_t offset : offsets)
+		writer.Int16(offset);
+	for (int line : lists)
+		writer.Int16(line);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+extern "C"
+{
+
+NodeBuilder* NodeBuilder_New()
+{
+	return new NodeBuilder();
+}
+
+void NodeBuilder_Delete(NodeBuilder* builder)
+{
+	delete builder;
+}
+
+bool NodeBuilder_Build(NodeBuilder* builder, const NodeBuilderVertex* vertices, int numvertices, const NodeBuilderLine* lines, int numlines, NodeBuilderFormat format)
+{
+	return builder->Build(vertices, numvertices, lines, numlines, format);
+}
+
+bool NodeBuilder_GetLump(NodeBuilder* builder, NodeBuilderLump lump, const uint8_t** data, int* size)
+{
+	if ((int)lump < 0 || lump >= NodeBuilderLump::Count)
+	{
+		SetError("Invalid nodebuilder lump %d", (int)lump);
+		return false;
+	}
+
+	const std::vector<uint8_t>& result = builder->GetLump(lump);
+	*data = result.data();
+	*size = (int)result.size();
+	return true;
+}
+
+}
@@ -0,0 +1,154 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <unordered_map>
+
+class SWWorkerPool;
+
+struct NodeBuilderVertex
+{
+	double X, Y;
+};
+
+// A linedef with the sectors of its sides, or -1 for a missing side
+struct NodeBuilderLine
+{
+	int32_t V1, V2;
+	int32_t FrontSector, BackSector;
+};
+
+enum class NodeBuilderFormat : int32_t
+{
+	Vanilla, // SEGS, SSECTORS and NODES, with the split vertices appended to VERTEXES
+	XNOD,    // ZDoom extended nodes in the NODES lump
+	ZNOD,    // Compressed XNOD
+	XGL3,    // ZDoom GL nodes with fixed point partitions, for the ZNODES lump of UDMF maps
+	ZGL3     // Compressed XGL3
+};
+
+enum class NodeBuilderLump : int32_t
+{
+	Vertexes,
+	Segs,
+	SubSectors,
+	Nodes,
+	Blockmap,
+	Count
+};
+
+// Builds the BSP tree of a map. The partition line of each node is picked by scoring the
+// candidate lines on the software renderer's worker threads.
+class NodeBuilder
+{
+public:
+	NodeBuilder();
+	~NodeBuilder();
+
+	bool Build(const NodeBuilderVertex* vertices, int numvertices, const NodeBuilderLine* lines, int numlines, NodeBuilderFormat format);
+
+	const std::vector<uint8_t>& GetLump(NodeBuilderLump lump) const { return mLumps[(int)lump]; }
+
+private:
+	struct Seg
+	{
+		int V1, V2;
+		int Line;
+		int Side;
+		int Sector;
+	};
+
+	struct Partition
+	{
+		double X, Y, DX, DY;
+		double InvLength;
+
+		double Distance(const NodeBuilderVertex& v) const { return ((v.X - X) * DY - (v.Y - Y) * DX) * InvLength; }
+	};
+
+	struct Node
+	{
+		int Line;
+		int Side;
+		double BBox[2][4];
+		int Children[2]; // Node index, or ~subsector
+		int Parent;
+		int ParentSide;
+	};
+
+	struct SubSector
+	{
+		std::vector<int> Segs;
+		int Parent;
+		int ParentSide;
+	};
+
+	// One seg of a closed GL subsector. The end is the start of the next seg in the subsector.
+	struct GLSeg
+	{
+		int V; // -1 until a vertex has been made for X and Y
+		double X, Y;
+		int Line; // -1 for a miniseg
+		int Side;
+	};
+
+	void BuildTree();
+	int ChoosePartition(const std::vector<int>& segs);
+	int FindBestCandidate(const std::vector<int>& candidates, const std::vector<int>& segs);
+	int EvaluatePartition(int candidate, const std::vector<int>& segs, int bestcost) const;
+	int FindSectorSplit(const std::vector<int>& segs) const;
+	void SplitSegs(const std::vector<int>& segs, int partition, bool shove, std::vector<int>& front, std::vector<int>& back);
+	int Classify(const Partition& part, const Seg& seg, double& a, double& b) const;
+	int AddVertex(double x, double y);
+	void GetBounds(const std::vector<int>& segs, double* bbox) const;
+	Partition GetPartition(int line, int side) const;
+
+	void BuildGLSubSector(const SubSector& sub, std::vector<GLSeg>& loop) const;
+	void BuildGLSubSectorFallback(const SubSector& sub, std::vector<GLSeg>& loop) const;
+	void BuildGLSubSectors();
+
+	bool WriteVanilla();
+	bool WriteExtended(bool compress);
+	bool WriteGL(bool compress);
+	void WriteBlockmap();
+
+	std::shared_ptr<SWWorkerPool> mPool;
+
+	const NodeBuilderLine* mLines = nullptr;
+	int mNumLines = 0;
+	int mNumOriginalVertices = 0;
+
+	std::vector<NodeBuilderVertex> mVertices;
+	std::unordered_map<uint64_t, int> mVertexLookup;
+	std::vector<Seg> mSegs;
+	std::vector<Node> mNodes;
+	std::vector<SubSector> mSubSectors;
+	int mRoot = 0;
+
+	std::vector<int> mLineMark;
+	int mLineStamp = 0;
+	double mMapBounds[4] = {};
+
+	std::vector<std::vector<GLSeg>> mGLSubSectors;
+
+	std::vector<uint8_t> mLumps[(int)NodeBuilderLump::Count];
+};
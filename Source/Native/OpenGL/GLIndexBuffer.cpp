@@ -30,13 +30,14 @@ GLIndexBuffer::~GLIndexBuffer()
 
 void GLIndexBuffer::Finalize()
 {
-	if (Device)
+	GLRenderDevice* device = Device;
+	if (device)
 	{
-		Device->mIndexBuffers.erase(ItBuffer);
+		device->mIndexBuffers.erase(ItBuffer);
 		Device = nullptr;
 
 		if (mBuffer != 0)
-			glDeleteBuffers(1, &mBuffer);
+			device->ReleaseBuffer(mBuffer);
 		mBuffer = 0;
 	}
 }
@@ -44,6 +45,12 @@ void GLIndexBuffer::Finalize()
 GLuint GLIndexBuffer::GetBuffer()
 {
 	if (mBuffer == 0)
-		glGenBuffers(1, &mBuffer);
+	{
+		GLRenderDevice* device = Device;
+		if (device)
+			mBuffer = device->AcquireBuffer();
+		if (mBuffer == 0)
+			glGenBuffers(1, &mBuffer);
+	}
 	return mBuffer;
 }
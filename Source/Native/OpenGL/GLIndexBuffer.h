@@ -23,6 +23,7 @@
 
 #include "../Backend.h"
 #include <list>
+#include <atomic>
 
 class GLRenderDevice;
 
@@ -35,8 +36,9 @@ public:
 
 	GLuint GetBuffer();
 
-	GLRenderDevice* Device = nullptr;
+	std::atomic<GLRenderDevice*> Device{ nullptr };
 	std::list<GLIndexBuffer*>::iterator ItBuffer;
+	GLIndexBuffer* NextDeleted = nullptr;
 
 private:
 	GLuint mBuffer = 0;
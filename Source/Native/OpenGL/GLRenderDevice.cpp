@@ -29,6 +29,18 @@
 #include <cstdarg>
 #include <algorithm>
 #include <cmath>
+#include <thread>
+
+// Pooled GL names are reused no sooner than this many frames after release
+static const int64_t PoolReuseDelay = 2;
+
+// Pooled GL names not reused within this many frames are deleted
+static const int64_t PoolLifetime = 300;
+
+static const int MaxPooledTextures = 256;
+static const size_t MaxPooledBuffers = 256;
+
+std::atomic<int> GLRenderDevice::DeleteObjectUsers{ 0 };
 
 static void APIENTRY GLLogCallback(GLenum source, GLenum type, GLuint id,
 	GLenum severity, GLsizei length, const GLchar* message, const void* userParam)
@@ -47,51 +59,103 @@ static const char* GLLogCheckNull(const GLubyte* str)
 GLRenderDevice::GLRenderDevice(void* disp, void* window, bool debug)
 {
 	Context = IOpenGLContext::Create(disp, window);
+	if (Context)
+		InitContext(debug);
+}
+
+GLRenderDevice::GLRenderDevice(int width, int height, bool debug)
+{
+	Context = IOpenGLContext::CreateOffscreen(width, height);
 	if (Context)
 	{
-		Context->MakeCurrent();
+		InitContext(debug);
+		CreateBackbuffer(width, height);
+	}
+}
+
+void GLRenderDevice::InitContext(bool debug)
+{
+	Context->MakeCurrent();
 
 //#ifdef _DEBUG
-		if (debug)
+	if (debug)
+	{
+		FILE* f = fopen("OpenGLDebug.log", "wb");
+		if (f)
 		{
-			FILE* f = fopen("OpenGLDebug.log", "wb");
-			if (f)
-			{
-				fprintf(f, "GL_VENDOR = %s\r\n", GLLogCheckNull(glGetString(GL_VENDOR)));
-				fprintf(f, "GL_RENDERER = %s\r\n", GLLogCheckNull(glGetString(GL_RENDERER)));
-				fprintf(f, "GL_VERSION = %s\r\n", GLLogCheckNull(glGetString(GL_VERSION)));
-				fprintf(f, "GL_SHADING_LANGUAGE_VERSION = %s\r\n", GLLogCheckNull(glGetString(GL_SHADING_LANGUAGE_VERSION)));
-				fclose(f);
-
-				glEnable(GL_DEBUG_OUTPUT);
-				glDebugMessageCallback(&GLLogCallback, nullptr);
-			}
+			fprintf(f, "GL_VENDOR = %s\r\n", GLLogCheckNull(glGetString(GL_VENDOR)));
+			fprintf(f, "GL_RENDERER = %s\r\n", GLLogCheckNull(glGetString(GL_RENDERER)));
+			fprintf(f, "GL_VERSION = %s\r\n", GLLogCheckNull(glGetString(GL_VERSION)));
+			fprintf(f, "GL_SHADING_LANGUAGE_VERSION = %s\r\n", GLLogCheckNull(glGetString(GL_SHADING_LANGUAGE_VERSION)));
+			fclose(f);
+
+			glEnable(GL_DEBUG_OUTPUT);
+			glDebugMessageCallback(&GLLogCallback, nullptr);
 		}
+	}
 //#endif
 
-		glGenVertexArrays(1, &mStreamVAO);
-		glGenBuffers(1, &mStreamVertexBuffer);
-		glBindVertexArray(mStreamVAO);
-		glBindBuffer(GL_ARRAY_BUFFER, mStreamVertexBuffer);
-		GLSharedVertexBuffer::SetupFlatVAO();
+	glGenVertexArrays(1, &mStreamVAO);
+	glGenBuffers(1, &mStreamVertexBuffer);
+	glBindVertexArray(mStreamVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, mStreamVertexBuffer);
+	GLSharedVertexBuffer::SetupFlatVAO();
 
-		int i = 0;
-		for (auto& sharedbuf : mSharedVertexBuffers)
-		{
-			sharedbuf.reset(new GLSharedVertexBuffer((VertexFormat)i, (int64_t)16 * 1024 * 1024));
-			glBindBuffer(GL_ARRAY_BUFFER, sharedbuf->GetBuffer());
-			glBufferData(GL_ARRAY_BUFFER, sharedbuf->Size, nullptr, GL_STATIC_DRAW);
-			i++;
-		}
+	int i = 0;
+	for (auto& sharedbuf : mSharedVertexBuffers)
+	{
+		sharedbuf.reset(new GLSharedVertexBuffer((VertexFormat)i, (int64_t)16 * 1024 * 1024));
+		glBindBuffer(GL_ARRAY_BUFFER, sharedbuf->GetBuffer());
+		glBufferData(GL_ARRAY_BUFFER, sharedbuf->Size, nullptr, GL_STATIC_DRAW);
+		i++;
+	}
 
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-		mShaderManager = std::make_unique<GLShaderManager>();
+	mShaderManager = std::make_unique<GLShaderManager>();
 
-		CheckGLError();
+	CheckGLError();
+}
+
+void GLRenderDevice::CreateBackbuffer(int width, int height)
+{
+	// Offscreen contexts have no default framebuffer (or only a pbuffer without depth), so the backbuffer is a framebuffer object
+	glGenRenderbuffers(1, &mBackbufferColor);
+	glBindRenderbuffer(GL_RENDERBUFFER, mBackbufferColor);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+	glGenRenderbuffers(1, &mBackbufferDepthStencil);
+	glBindRenderbuffer(GL_RENDERBUFFER, mBackbufferDepthStencil);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &mBackbufferFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, mBackbufferFramebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, mBackbufferColor);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, mBackbufferDepthStencil);
+	GLenum result = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (result != GL_FRAMEBUFFER_COMPLETE)
+	{
+		SetError("Could not create the offscreen backbuffer (framebuffer status %d)", (int)result);
+		DeleteBackbuffer();
 	}
 }
 
+void GLRenderDevice::DeleteBackbuffer()
+{
+	if (mBackbufferFramebuffer != 0)
+		glDeleteFramebuffers(1, &mBackbufferFramebuffer);
+	if (mBackbufferColor != 0)
+		glDeleteRenderbuffers(1, &mBackbufferColor);
+	if (mBackbufferDepthStencil != 0)
+		glDeleteRenderbuffers(1, &mBackbufferDepthStencil);
+	mBackbufferFramebuffer = 0;
+	mBackbufferColor = 0;
+	mBackbufferDepthStencil = 0;
+}
+
 GLRenderDevice::~GLRenderDevice()
 {
 	if (Context)
@@ -99,21 +163,32 @@ GLRenderDevice::~GLRenderDevice()
 		Context->MakeCurrent();
 
 		ProcessDeleteList();
-		for (GLTexture* tex : mTextures) mDeleteList.Textures.push_back(tex);
-		for (GLIndexBuffer* buffer : mIndexBuffers) mDeleteList.IndexBuffers.push_back(buffer);
-		for (GLVertexBuffer* buffer : mSharedVertexBuffers[0]->VertexBuffers) mDeleteList.VertexBuffers.push_back(buffer);
-		for (GLVertexBuffer* buffer : mSharedVertexBuffers[1]->VertexBuffers) mDeleteList.VertexBuffers.push_back(buffer);
-		ProcessDeleteList(true);
+
+		// Detach the objects still alive. They are deleted without GL calls when released later.
+		while (!mTextures.empty()) mTextures.front()->Finalize();
+		while (!mIndexBuffers.empty()) mIndexBuffers.front()->Finalize();
+		for (auto& sharedbuf : mSharedVertexBuffers)
+		{
+			while (!sharedbuf->VertexBuffers.empty()) sharedbuf->VertexBuffers.front()->Finalize();
+		}
+
+		// Anything queued by a DeleteObject call that saw this device before it was detached
+		while (DeleteObjectUsers.load() != 0)
+			std::this_thread::yield();
+		ProcessDeleteList();
+		while (!mReadbacks.empty())
+			DiscardReadbacks(mReadbacks.front().Target);
+		TrimPools(true);
 
 		glDeleteBuffers(1, &mStreamVertexBuffer);
 		glDeleteVertexArrays(1, &mStreamVAO);
+		DeleteBackbuffer();
 
 		for (auto& sharedbuf : mSharedVertexBuffers)
 		{
 			GLuint handle = sharedbuf->GetBuffer();
 			glDeleteBuffers(1, &handle);
-			handle = sharedbuf->GetVAO();
-			glDeleteVertexArrays(1, &handle);
+			sharedbuf->ReleaseVAOs();
 		}
 
 		for (auto& it : mTextureUnit)
@@ -396,6 +471,36 @@ bool GLRenderDevice::DrawData(PrimitiveType type, int startIndex, int primitiveC
 	return ApplyVertexBuffer();
 }
 
+void GLRenderDevice::SetInstanceBuffer(VertexBuffer* buffer)
+{
+	mInstanceBuffer = static_cast<GLVertexBuffer*>(buffer);
+}
+
+bool GLRenderDevice::DrawInstanced(PrimitiveType type, int startIndex, int primitiveCount, int instanceCount)
+{
+	static const int modes[] = { GL_LINES, GL_TRIANGLES, GL_TRIANGLE_STRIP };
+	static const int toVertexCount[] = { 2, 3, 1 };
+	static const int toVertexStart[] = { 0, 0, 2 };
+
+	if (mVertexBuffer == -1 || !mInstanceBuffer || mInstanceBuffer->Format != VertexFormat::Instance)
+	{
+		SetError("DrawInstanced requires a vertex buffer and an instance buffer");
+		return false;
+	}
+
+	if (mNeedApply && !ApplyChanges()) return false;
+
+	// The instanced VAO shares the template attributes with the regular VAO and adds the per-instance ones
+	glBindVertexArray(mSharedVertexBuffers[mVertexBuffer]->GetInstancedVAO());
+	glBindBuffer(GL_ARRAY_BUFFER, mSharedVertexBuffers[(int)VertexFormat::Instance]->GetBuffer());
+	GLSharedVertexBuffer::SetupInstanceAttributes(mInstanceBuffer->BufferOffset);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glDrawArraysInstanced(modes[(int)type], mVertexBufferStartIndex + startIndex, toVertexStart[(int)type] + primitiveCount * toVertexCount[(int)type], instanceCount);
+	if (!CheckGLError()) return false;
+
+	return ApplyVertexBuffer();
+}
+
 void GLRenderDevice::RequireContext()
 {
 	Context->MakeCurrent();
@@ -411,6 +516,7 @@ void GLRenderDevice::CheckContext()
 bool GLRenderDevice::StartRendering(bool clear, int backcolor, Texture* itarget, bool usedepthbuffer)
 {
 	RequireContext();
+	UpdateCubeMipmaps();
 
 	GLTexture* target = static_cast<GLTexture*>(itarget);
 	if (target)
@@ -432,12 +538,66 @@ bool GLRenderDevice::StartRendering(bool clear, int backcolor, Texture* itarget,
 	}
 	else
 	{
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glBindFramebuffer(GL_FRAMEBUFFER, mBackbufferFramebuffer);
 		mViewportWidth = Context->GetWidth();
 		mViewportHeight = Context->GetHeight();
 		if (!ApplyViewport()) return false;
 	}
 
+	return BeginRenderPass(clear, backcolor, usedepthbuffer);
+}
+
+bool GLRenderDevice::StartCubeRendering(bool clear, int backcolor, Texture* itarget, CubeMapFace face)
+{
+	GLTexture* target = static_cast<GLTexture*>(itarget);
+	if (!target->IsCubeTexture())
+	{
+		SetError("StartCubeRendering requires a cube texture");
+		return false;
+	}
+
+	RequireContext();
+	if (mCubeMipmapTarget != target)
+		UpdateCubeMipmaps();
+
+	GLuint framebuffer = 0;
+	try
+	{
+		framebuffer = target->GetFramebuffer(this, false, face);
+	}
+	catch (std::runtime_error& e)
+	{
+		SetError("Error setting render target: %s", e.what());
+		return false;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	mViewportWidth = target->GetWidth();
+	mViewportHeight = target->GetHeight();
+	if (!ApplyViewport()) return false;
+
+	mCubeMipmapTarget = target;
+
+	return BeginRenderPass(clear, backcolor, false);
+}
+
+// Mipmaps of a cube texture are generated once all the faces have been rendered
+void GLRenderDevice::UpdateCubeMipmaps()
+{
+	if (!mCubeMipmapTarget)
+		return;
+
+	GLint oldTexture = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_CUBE_MAP, &oldTexture);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, mCubeMipmapTarget->GetTexture(this));
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, 1000);
+	glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, oldTexture);
+
+	mCubeMipmapTarget = nullptr;
+}
+
+bool GLRenderDevice::BeginRenderPass(bool clear, int backcolor, bool usedepthbuffer)
+{
 	if (clear && usedepthbuffer)
 	{
 		glEnable(GL_DEPTH_TEST);
@@ -467,6 +627,11 @@ bool GLRenderDevice::StartRendering(bool clear, int backcolor, Texture* itarget,
 
 bool GLRenderDevice::FinishRendering()
 {
+	if (mCubeMipmapTarget)
+	{
+		CheckContext();
+		UpdateCubeMipmaps();
+	}
 	mContextIsCurrent = false;
 	return true;
 }
@@ -476,6 +641,8 @@ bool GLRenderDevice::Present()
 	Context->MakeCurrent();
 	Context->SwapBuffers();
 	ProcessDeleteList();
+	mEpoch++;
+	TrimPools(false);
 	return CheckGLError();
 }
 
@@ -489,23 +656,17 @@ bool GLRenderDevice::CopyTexture(Texture* idst, CubeMapFace face)
 {
 	GLTexture* dst = static_cast<GLTexture*>(idst);
 
-	static const GLenum facegl[] = {
-		GL_TEXTURE_CUBE_MAP_POSITIVE_X,
-		GL_TEXTURE_CUBE_MAP_POSITIVE_Y,
-		GL_TEXTURE_CUBE_MAP_POSITIVE_Z,
-		GL_TEXTURE_CUBE_MAP_NEGATIVE_X,
-		GL_TEXTURE_CUBE_MAP_NEGATIVE_Y,
-		GL_TEXTURE_CUBE_MAP_NEGATIVE_Z
-	};
-
 	CheckContext();
 	GLint oldTexture = 0;
 	glGetIntegerv(GL_TEXTURE_BINDING_CUBE_MAP, &oldTexture);
 
 	glBindTexture(GL_TEXTURE_CUBE_MAP, dst->GetTexture(this));
-	glCopyTexSubImage2D(facegl[(int)face], 0, 0, 0, 0, 0, dst->GetWidth(), dst->GetHeight());
+	glCopyTexSubImage2D(GLTexture::ToCubeMapFace(face), 0, 0, 0, 0, 0, dst->GetWidth(), dst->GetHeight());
 	if (face == CubeMapFace::NegativeZ)
+	{
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, 1000);
 		glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+	}
 
 	glBindTexture(GL_TEXTURE_CUBE_MAP, oldTexture);
 	bool result = CheckGLError();
@@ -539,7 +700,7 @@ void GLRenderDevice::GarbageCollectBuffer(int size, VertexFormat format)
 	glBindBuffer(GL_COPY_READ_BUFFER, old->GetBuffer());
 
 	// Copy all ranges still in use to the new buffer
-	int stride = (format == VertexFormat::Flat ? VertexBuffer::FlatStride : VertexBuffer::WorldStride);
+	int stride = VertexBuffer::GetStride(format);
 	int readPos = 0;
 	int writePos = 0;
 	int copySize = 0;
@@ -565,7 +726,7 @@ void GLRenderDevice::GarbageCollectBuffer(int size, VertexFormat format)
 	glBindBuffer(GL_COPY_READ_BUFFER, 0);
 
 	GLuint handle = old->GetVAO();
-	glDeleteVertexArrays(1, &handle);
+	old->ReleaseVAOs();
 	if (handle == oldvao) oldvao = sharedbuf->GetVAO();
 
 	handle = old->GetBuffer();
@@ -585,12 +746,17 @@ bool GLRenderDevice::SetVertexBufferData(VertexBuffer* ibuffer, void* data, int6
 
 	GLVertexBuffer* buffer = static_cast<GLVertexBuffer*>(ibuffer);
 
-	if (buffer->Device)
+	GLRenderDevice* owner = buffer->Device;
+	if (owner)
 	{
-		buffer->Device->mSharedVertexBuffers[(int)buffer->Format]->VertexBuffers.erase(buffer->ListIt);
+		owner->mSharedVertexBuffers[(int)buffer->Format]->VertexBuffers.erase(buffer->ListIt);
 		buffer->Device = nullptr;
 	}
 
+	// Compact buffers receive World vertices and store them packed
+	if (format == VertexFormat::WorldCompact)
+		size = size / VertexBuffer::WorldStride * VertexBuffer::WorldCompactStride;
+
 	GarbageCollectBuffer(size, format);
 
 	auto& sharedbuf = mSharedVertexBuffers[(int)format];
@@ -604,11 +770,17 @@ bool GLRenderDevice::SetVertexBufferData(VertexBuffer* ibuffer, void* data, int6
 	buffer->Size = size;
 	buffer->Format = format;
 	buffer->BufferOffset = sharedbuf->NextPos;
-	buffer->BufferStartIndex = buffer->BufferOffset / (format == VertexFormat::Flat ? VertexBuffer::FlatStride : VertexBuffer::WorldStride);
+	buffer->BufferStartIndex = buffer->BufferOffset / VertexBuffer::GetStride(format);
 	sharedbuf->NextPos += size;
 
 	if (data)
 	{
+		if (format == VertexFormat::WorldCompact)
+		{
+			mPackBuffer.resize((size_t)size);
+			GLSharedVertexBuffer::PackWorldCompact(mPackBuffer.data(), data, size / VertexBuffer::WorldCompactStride * VertexBuffer::WorldStride);
+			data = mPackBuffer.data();
+		}
 		glBufferSubData(GL_ARRAY_BUFFER, buffer->BufferOffset, size, data);
 	}
 
@@ -621,6 +793,15 @@ bool GLRenderDevice::SetVertexBufferSubdata(VertexBuffer* ibuffer, int64_t destO
 {
 	CheckContext();
 	GLVertexBuffer* buffer = static_cast<GLVertexBuffer*>(ibuffer);
+	if (buffer->Format == VertexFormat::WorldCompact)
+	{
+		int64_t count = size / VertexBuffer::WorldStride;
+		mPackBuffer.resize((size_t)(count * VertexBuffer::WorldCompactStride));
+		GLSharedVertexBuffer::PackWorldCompact(mPackBuffer.data(), data, size);
+		destOffset = destOffset / VertexBuffer::WorldStride * VertexBuffer::WorldCompactStride;
+		size = count * VertexBuffer::WorldCompactStride;
+		data = mPackBuffer.data();
+	}
 	GLint oldbinding = 0;
 	glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &oldbinding);
 	glBindBuffer(GL_ARRAY_BUFFER, mSharedVertexBuffers[(int)buffer->Format]->GetBuffer());
@@ -694,6 +875,174 @@ bool GLRenderDevice::UnmapPBO(Texture* itexture)
 	return result;
 }
 
+bool GLRenderDevice::ReadPixelsAsync(Texture* itarget, PixelFormat format)
+{
+	if (format == PixelFormat::D32f_S8 || format == PixelFormat::D24_S8 || format == PixelFormat::A2Bgr10 || format == PixelFormat::A2Rgb10_snorm)
+	{
+		SetError("Unsupported readback pixel format %d", (int)format);
+		return false;
+	}
+
+	CheckContext();
+
+	GLTexture* target = static_cast<GLTexture*>(itarget);
+	GLuint framebuffer = mBackbufferFramebuffer;
+	int width = Context->GetWidth();
+	int height = Context->GetHeight();
+	if (target)
+	{
+		try
+		{
+			framebuffer = target->GetFramebuffer(this, false);
+		}
+		catch (std::runtime_error& e)
+		{
+			SetError("Error setting readback source: %s", e.what());
+			return false;
+		}
+		width = target->GetWidth();
+		height = target->GetHeight();
+	}
+
+	Readback readback;
+	readback.Target = itarget;
+	readback.Size = (GLsizeiptr)width * height * Texture::GetBytesPerPixel(format);
+	readback.Data = nullptr;
+	readback.Buffer = AcquireBuffer();
+	if (readback.Buffer == 0)
+		glGenBuffers(1, &readback.Buffer);
+
+	GLint oldReadFramebuffer = 0;
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &oldReadFramebuffer);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.Buffer);
+	glBufferData(GL_PIXEL_PACK_BUFFER, readback.Size, nullptr, GL_STREAM_READ);
+	glReadPixels(0, 0, width, height, GLTexture::ToDataFormat(format), GLTexture::ToDataType(format), nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, oldReadFramebuffer);
+
+	// Flush so the fence is submitted and polling MapReadback can see it signal
+	readback.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();
+
+	if (!CheckGLError())
+	{
+		if (readback.Fence)
+			glDeleteSync(readback.Fence);
+		ReleaseBuffer(readback.Buffer);
+		return false;
+	}
+
+	mReadbacks.push_back(readback);
+	return true;
+}
+
+bool GLRenderDevice::MapReadback(Texture* target, bool wait, void** data)
+{
+	*data = nullptr;
+
+	auto it = std::find_if(mReadbacks.begin(), mReadbacks.end(), [=](const Readback& r) { return r.Target == target; });
+	if (it == mReadbacks.end())
+	{
+		SetError("No readback was requested for this render target");
+		return false;
+	}
+
+	if (it->Data)
+	{
+		*data = it->Data;
+		return true;
+	}
+
+	CheckContext();
+
+	if (it->Fence)
+	{
+		GLenum status = glClientWaitSync(it->Fence, 0, 0);
+		while (wait && status == GL_TIMEOUT_EXPIRED)
+			status = glClientWaitSync(it->Fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+
+		if (status == GL_TIMEOUT_EXPIRED)
+			return true;
+
+		glDeleteSync(it->Fence);
+		it->Fence = 0;
+
+		if (status == GL_WAIT_FAILED)
+		{
+			SetError("glClientWaitSync failed");
+			return false;
+		}
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, it->Buffer);
+	it->Data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, it->Size, GL_MAP_READ_BIT);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	if (!CheckGLError())
+		return false;
+
+	if (!it->Data)
+	{
+		SetError("glMapBufferRange failed for the readback buffer");
+		return false;
+	}
+
+	*data = it->Data;
+	return true;
+}
+
+bool GLRenderDevice::UnmapReadback(Texture* target)
+{
+	auto it = std::find_if(mReadbacks.begin(), mReadbacks.end(), [=](const Readback& r) { return r.Target == target; });
+	if (it == mReadbacks.end())
+	{
+		SetError("No readback was requested for this render target");
+		return false;
+	}
+
+	CheckContext();
+
+	if (it->Data)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, it->Buffer);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+	if (it->Fence)
+		glDeleteSync(it->Fence);
+	ReleaseBuffer(it->Buffer);
+	mReadbacks.erase(it);
+
+	return CheckGLError();
+}
+
+void GLRenderDevice::DiscardReadbacks(Texture* target)
+{
+	for (auto it = mReadbacks.begin(); it != mReadbacks.end();)
+	{
+		if (it->Target == target)
+		{
+			if (it->Data)
+			{
+				glBindBuffer(GL_PIXEL_PACK_BUFFER, it->Buffer);
+				glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+				glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			}
+			if (it->Fence)
+				glDeleteSync(it->Fence);
+			ReleaseBuffer(it->Buffer);
+			it = mReadbacks.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
 bool GLRenderDevice::InvalidateTexture(GLTexture* texture)
 {
 	if (texture->IsTextureCreated())
@@ -978,57 +1327,150 @@ bool GLRenderDevice::ApplyTextures()
     return hasError;
 }
 
-std::mutex& GLRenderDevice::GetMutex()
-{
-	static std::mutex m;
-	return m;
-}
-
 void GLRenderDevice::DeleteObject(GLVertexBuffer* buffer)
 {
-	std::unique_lock<std::mutex> lock(GLRenderDevice::GetMutex());
-	if (buffer->Device)
-		buffer->Device->mDeleteList.VertexBuffers.push_back(buffer);
-	else
+	DeleteObjectUsers++;
+	GLRenderDevice* device = buffer->Device;
+	if (device)
+		device->mDeletedVertexBuffers.Push(buffer);
+	DeleteObjectUsers--;
+
+	if (!device)
 		delete buffer;
 }
 
 void GLRenderDevice::DeleteObject(GLIndexBuffer* buffer)
 {
-	std::unique_lock<std::mutex> lock(GLRenderDevice::GetMutex());
-	if (buffer->Device)
-		buffer->Device->mDeleteList.IndexBuffers.push_back(buffer);
-	else
+	DeleteObjectUsers++;
+	GLRenderDevice* device = buffer->Device;
+	if (device)
+		device->mDeletedIndexBuffers.Push(buffer);
+	DeleteObjectUsers--;
+
+	if (!device)
 		delete buffer;
 }
 
 void GLRenderDevice::DeleteObject(GLTexture* texture)
 {
-	std::unique_lock<std::mutex> lock(GLRenderDevice::GetMutex());
-	if (texture->Device)
-		texture->Device->mDeleteList.Textures.push_back(texture);
-	else
+	DeleteObjectUsers++;
+	GLRenderDevice* device = texture->Device;
+	if (device)
+		device->mDeletedTextures.Push(texture);
+	DeleteObjectUsers--;
+
+	if (!device)
 		delete texture;
 }
 
-void GLRenderDevice::ProcessDeleteList(bool finalize)
+template<typename T>
+static void DeleteQueuedObjects(T* object)
+{
+	while (object)
+	{
+		T* next = object->NextDeleted;
+		delete object;
+		object = next;
+	}
+}
+
+void GLRenderDevice::ProcessDeleteList()
+{
+	DeleteQueuedObjects(mDeletedIndexBuffers.TakeAll());
+	GLVertexBuffer* vertexbuffers = mDeletedVertexBuffers.TakeAll();
+	for (GLVertexBuffer* buffer = vertexbuffers; buffer; buffer = buffer->NextDeleted)
+	{
+		if (mInstanceBuffer == buffer) mInstanceBuffer = nullptr;
+	}
+	DeleteQueuedObjects(vertexbuffers);
+	// A deleted texture's address may be reused by a new one, so its pending readbacks go with it
+	GLTexture* textures = mDeletedTextures.TakeAll();
+	if (!mReadbacks.empty())
+	{
+		for (GLTexture* texture = textures; texture; texture = texture->NextDeleted)
+			DiscardReadbacks(texture);
+	}
+	DeleteQueuedObjects(textures);
+}
+
+GLuint GLRenderDevice::AcquireTexture(int width, int height, PixelFormat format, bool cube)
 {
-	std::unique_lock<std::mutex> lock(GLRenderDevice::GetMutex());
+	auto it = mTexturePool.find({ width, height, format, cube });
+	if (it == mTexturePool.end() || it->second.front().Epoch + PoolReuseDelay > mEpoch)
+		return 0;
+
+	GLuint handle = it->second.front().Handle;
+	it->second.erase(it->second.begin());
+	if (it->second.empty())
+		mTexturePool.erase(it);
+	mPooledTextureCount--;
+	return handle;
+}
 
-	if (!finalize)
+void GLRenderDevice::ReleaseTexture(GLuint handle, int width, int height, PixelFormat format, bool cube)
+{
+	if (mPooledTextureCount >= MaxPooledTextures)
 	{
-		for (auto buffer : mDeleteList.IndexBuffers) delete buffer;
-		for (auto buffer : mDeleteList.VertexBuffers) delete buffer;
-		for (auto texture : mDeleteList.Textures) delete texture;
+		glDeleteTextures(1, &handle);
+		return;
 	}
+
+	// Drop the mipmap chain of the previous user. Uploads that generate mipmaps raise the limit again.
+	GLenum target = cube ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+	GLint oldActiveTex = GL_TEXTURE0;
+	glGetIntegerv(GL_ACTIVE_TEXTURE, &oldActiveTex);
+	glActiveTexture(GL_TEXTURE0);
+	GLint oldBinding = 0;
+	glGetIntegerv(cube ? GL_TEXTURE_BINDING_CUBE_MAP : GL_TEXTURE_BINDING_2D, &oldBinding);
+	glBindTexture(target, handle);
+	glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, 0);
+	glBindTexture(target, oldBinding);
+	glActiveTexture(oldActiveTex);
+
+	mTexturePool[{ width, height, format, cube }].push_back({ handle, mEpoch });
+	mPooledTextureCount++;
+}
+
+GLuint GLRenderDevice::AcquireBuffer()
+{
+	if (mBufferPool.empty() || mBufferPool.front().Epoch + PoolReuseDelay > mEpoch)
+		return 0;
+
+	GLuint handle = mBufferPool.front().Handle;
+	mBufferPool.erase(mBufferPool.begin());
+	return handle;
+}
+
+void GLRenderDevice::ReleaseBuffer(GLuint handle)
+{
+	if (mBufferPool.size() >= MaxPooledBuffers)
+		glDeleteBuffers(1, &handle);
 	else
+		mBufferPool.push_back({ handle, mEpoch });
+}
+
+void GLRenderDevice::TrimPools(bool all)
+{
+	// Entries are stored in release order, so the expired ones are at the front
+	for (auto it = mTexturePool.begin(); it != mTexturePool.end();)
 	{
-		for (auto buffer : mDeleteList.IndexBuffers) buffer->Finalize();
-		for (auto buffer : mDeleteList.VertexBuffers) buffer->Finalize();
-		for (auto texture : mDeleteList.Textures) texture->Finalize();
+		auto& entries = it->second;
+		while (!entries.empty() && (all || entries.front().Epoch + PoolLifetime < mEpoch))
+		{
+			glDeleteTextures(1, &entries.front().Handle);
+			entries.erase(entries.begin());
+			mPooledTextureCount--;
+		}
+
+		if (entries.empty())
+			it = mTexturePool.erase(it);
+		else
+			++it;
 	}
 
-	mDeleteList.IndexBuffers.clear();
-	mDeleteList.VertexBuffers.clear();
-	mDeleteList.Textures.clear();
+	while (!mBufferPool.empty() && (all || mBufferPool.front().Epoch + PoolLifetime < mEpoch))
+	{
+		glDeleteBuffers(1, &mBufferPool.front().Handle);
+		mBufferPool.erase(mBufferPool.begin());
+	}
 }
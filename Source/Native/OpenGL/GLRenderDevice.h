@@ -24,6 +24,8 @@
 #include "../Backend.h"
 #include "OpenGLContext.h"
 #include <list>
+#include <atomic>
+#include <tuple>
 
 class GLSharedVertexBuffer;
 class GLShader;
@@ -32,10 +34,31 @@ class GLVertexBuffer;
 class GLIndexBuffer;
 class GLTexture;
 
+// Intrusive multi-producer, single-consumer stack. Any thread may push, the device takes the whole list at once.
+template<typename T>
+class GLDeleteQueue
+{
+public:
+	void Push(T* object)
+	{
+		T* head = mHead.load(std::memory_order_relaxed);
+		do
+		{
+			object->NextDeleted = head;
+		} while (!mHead.compare_exchange_weak(head, object, std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	T* TakeAll() { return mHead.exchange(nullptr, std::memory_order_acquire); }
+
+private:
+	std::atomic<T*> mHead{ nullptr };
+};
+
 class GLRenderDevice : public RenderDevice
 {
 public:
 	GLRenderDevice(void* disp, void* window, bool debug);
+	GLRenderDevice(int width, int height, bool debug);
 	~GLRenderDevice();
 
 	void DeclareUniform(UniformName name, const char* glslname, UniformType type) override;
@@ -60,7 +83,10 @@ public:
 	bool Draw(PrimitiveType type, int startIndex, int primitiveCount) override;
 	bool DrawIndexed(PrimitiveType type, int startIndex, int primitiveCount) override;
 	bool DrawData(PrimitiveType type, int startIndex, int primitiveCount, const void* data) override;
+	void SetInstanceBuffer(VertexBuffer* buffer) override;
+	bool DrawInstanced(PrimitiveType type, int startIndex, int primitiveCount, int instanceCount) override;
 	bool StartRendering(bool clear, int backcolor, Texture* target, bool usedepthbuffer) override;
+	bool StartCubeRendering(bool clear, int backcolor, Texture* target, CubeMapFace face) override;
 	bool FinishRendering() override;
 	bool Present() override;
 	bool ClearTexture(int backcolor, Texture* texture) override;
@@ -74,11 +100,23 @@ public:
 	bool SetCubePixels(Texture* texture, CubeMapFace face, const void* data) override;
 	void* MapPBO(Texture* texture) override;
 	bool UnmapPBO(Texture* texture) override;
+	bool ReadPixelsAsync(Texture* target, PixelFormat format) override;
+	bool MapReadback(Texture* target, bool wait, void** data) override;
+	bool UnmapReadback(Texture* target) override;
 
 	bool InvalidateTexture(GLTexture* texture);
 
+	void DiscardReadbacks(Texture* target);
+
+	void InitContext(bool debug);
+	void CreateBackbuffer(int width, int height);
+	void DeleteBackbuffer();
+
 	void GarbageCollectBuffer(int size, VertexFormat format);
 
+	bool BeginRenderPass(bool clear, int backcolor, bool usedepthbuffer);
+	void UpdateCubeMipmaps();
+
 	bool ApplyViewport();
 	bool ApplyChanges();
 	bool ApplyVertexBuffer();
@@ -99,21 +137,68 @@ public:
 
 	GLint GetGLMinFilter(TextureFilter filter, MipmapFilter mipfilter);
 
-	static std::mutex& GetMutex();
+	// Safe to call from any thread, including .NET finalizer threads
 	static void DeleteObject(GLVertexBuffer* buffer);
 	static void DeleteObject(GLIndexBuffer* buffer);
 	static void DeleteObject(GLTexture* texture);
 
-	void ProcessDeleteList(bool finalize = false);
+	void ProcessDeleteList();
+
+	GLuint AcquireTexture(int width, int height, PixelFormat format, bool cube);
+	void ReleaseTexture(GLuint handle, int width, int height, PixelFormat format, bool cube);
+	GLuint AcquireBuffer();
+	void ReleaseBuffer(GLuint handle);
+	void TrimPools(bool all);
 
 	std::unique_ptr<IOpenGLContext> Context;
 
-	struct DeleteList
+	// Framebuffer object standing in for the default framebuffer of offscreen devices. Zero for window devices.
+	GLuint GetBackbufferFramebuffer() const { return mBackbufferFramebuffer; }
+
+	// Number of DeleteObject calls in progress. A device waits for zero before it frees itself.
+	static std::atomic<int> DeleteObjectUsers;
+
+	GLDeleteQueue<GLVertexBuffer> mDeletedVertexBuffers;
+	GLDeleteQueue<GLIndexBuffer> mDeletedIndexBuffers;
+	GLDeleteQueue<GLTexture> mDeletedTextures;
+
+	// Incremented by every Present. Pooled GL names are only reused once the frames that used them are done.
+	int64_t mEpoch = 0;
+
+	struct TexturePoolKey
+	{
+		int Width;
+		int Height;
+		PixelFormat Format;
+		bool Cube;
+
+		bool operator<(const TexturePoolKey& b) const { return std::tie(Width, Height, Format, Cube) < std::tie(b.Width, b.Height, b.Format, b.Cube); }
+	};
+
+	struct PooledObject
+	{
+		GLuint Handle;
+		int64_t Epoch;
+	};
+
+	std::map<TexturePoolKey, std::vector<PooledObject>> mTexturePool;
+	std::vector<PooledObject> mBufferPool;
+	int mPooledTextureCount = 0;
+
+	// Pixels read into a pixel pack buffer, oldest first. Target is null for the backbuffer.
+	struct Readback
 	{
-		std::vector<GLVertexBuffer*> VertexBuffers;
-		std::vector<GLIndexBuffer*> IndexBuffers;
-		std::vector<GLTexture*> Textures;
-	} mDeleteList;
+		Texture* Target;
+		GLuint Buffer;
+		GLsync Fence;
+		GLsizeiptr Size;
+		void* Data;
+	};
+
+	std::list<Readback> mReadbacks;
+
+	// Cube texture rendered to by StartCubeRendering that still needs its mipmaps updated
+	GLTexture* mCubeMipmapTarget = nullptr;
 	
 	struct TextureUnit
 	{
@@ -150,8 +235,11 @@ public:
 	int64_t mVertexBufferStartIndex = 0;
 
 	GLIndexBuffer* mIndexBuffer = nullptr;
+	GLVertexBuffer* mInstanceBuffer = nullptr;
+
+	std::unique_ptr<GLSharedVertexBuffer> mSharedVertexBuffers[4];
 
-	std::unique_ptr<GLSharedVertexBuffer> mSharedVertexBuffers[2];
+	std::vector<uint8_t> mPackBuffer;
 
 	std::list<GLTexture*> mTextures;
 	std::list<GLIndexBuffer*> mIndexBuffers;
@@ -173,6 +261,10 @@ public:
 	GLuint mStreamVertexBuffer = 0;
 	GLuint mStreamVAO = 0;
 
+	GLuint mBackbufferFramebuffer = 0;
+	GLuint mBackbufferColor = 0;
+	GLuint mBackbufferDepthStencil = 0;
+
 	Cull mCullMode = Cull::None;
 	FillMode mFillMode = FillMode::Solid;
 	bool mAlphaTest = false;
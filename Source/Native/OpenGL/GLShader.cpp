@@ -105,6 +105,10 @@ void GLShader::CreateProgram(GLRenderDevice* device)
 	glBindAttribLocation(mProgram, (GLuint)DeclarationUsage::Color, "AttrColor");
 	glBindAttribLocation(mProgram, (GLuint)DeclarationUsage::TextureCoordinate, "AttrUV");
 	glBindAttribLocation(mProgram, (GLuint)DeclarationUsage::Normal, "AttrNormal");
+	glBindAttribLocation(mProgram, (GLuint)DeclarationUsage::PackedNormal, "AttrPackedNormal");
+	glBindAttribLocation(mProgram, (GLuint)DeclarationUsage::InstancePosition, "AttrInstancePosition");
+	glBindAttribLocation(mProgram, (GLuint)DeclarationUsage::InstanceParams, "AttrInstanceParams");
+	glBindAttribLocation(mProgram, (GLuint)DeclarationUsage::InstanceColor, "AttrInstanceColor");
 	glLinkProgram(mProgram);
 
 	GLint status = 0;
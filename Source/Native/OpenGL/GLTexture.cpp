@@ -74,8 +74,11 @@ bool GLTexture::SetPixels(GLRenderDevice* device, const void* data)
 	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 	glBindTexture(GL_TEXTURE_2D, mTexture);
 	glTexImage2D(GL_TEXTURE_2D, 0, ToInternalFormat(mFormat), mWidth, mHeight, 0, ToDataFormat(mFormat), ToDataType(mFormat), data);
-	if (data != nullptr) 
+	if (data != nullptr)
+	{
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
 		glGenerateMipmap(GL_TEXTURE_2D);
+	}
 
 	//
 
@@ -87,12 +90,6 @@ bool GLTexture::SetPixels(GLRenderDevice* device, const void* data)
 
 bool GLTexture::SetCubePixels(GLRenderDevice* device, CubeMapFace face, const void* data)
 {
-	static GLint cubeMapFaceToGL[] =
-	{
-		GL_TEXTURE_CUBE_MAP_POSITIVE_X, GL_TEXTURE_CUBE_MAP_POSITIVE_Y, GL_TEXTURE_CUBE_MAP_POSITIVE_Z,
-		GL_TEXTURE_CUBE_MAP_NEGATIVE_X, GL_TEXTURE_CUBE_MAP_NEGATIVE_Y, GL_TEXTURE_CUBE_MAP_NEGATIVE_Z
-	};
-
 	GLint texture = GetTexture(device);
 	if (!texture) return false;
 
@@ -106,9 +103,12 @@ bool GLTexture::SetCubePixels(GLRenderDevice* device, CubeMapFace face, const vo
 
 	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, mTexture);
-	glTexImage2D(cubeMapFaceToGL[(int)face], 0, ToInternalFormat(mFormat), mWidth, mHeight, 0, ToDataFormat(mFormat), ToDataType(mFormat), data);
+	glTexImage2D(ToCubeMapFace(face), 0, ToInternalFormat(mFormat), mWidth, mHeight, 0, ToDataFormat(mFormat), ToDataType(mFormat), data);
 	if (data != nullptr && face == CubeMapFace::NegativeZ)
+	{
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, 1000);
 		glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+	}
 
 	//
 
@@ -120,15 +120,20 @@ bool GLTexture::SetCubePixels(GLRenderDevice* device, CubeMapFace face, const vo
 
 void GLTexture::Invalidate()
 {
+	GLRenderDevice* device = Device;
 	if (mDepthRenderbuffer) glDeleteRenderbuffers(1, &mDepthRenderbuffer);
 	if (mFramebuffer) glDeleteFramebuffers(1, &mFramebuffer);
-	if (mTexture) glDeleteTextures(1, &mTexture);
-	if (mPBO) glDeleteBuffers(1, &mPBO);
+	if (mTexture && device) device->ReleaseTexture(mTexture, mWidth, mHeight, mFormat, mCubeTexture);
+	else if (mTexture) glDeleteTextures(1, &mTexture);
+	if (mPBO && device) device->ReleaseBuffer(mPBO);
+	else if (mPBO) glDeleteBuffers(1, &mPBO);
 	mDepthRenderbuffer = 0;
 	mFramebuffer = 0;
+	mFramebufferFace = {};
 	mTexture = 0;
 	mPBO = 0;
-	if (Device) Device->mTextures.erase(ItTexture);
+	if (device && device->mCubeMipmapTarget == this) device->mCubeMipmapTarget = nullptr;
+	if (device) device->mTextures.erase(ItTexture);
 	Device = nullptr;
 }
 
@@ -139,9 +144,13 @@ GLuint GLTexture::GetTexture(GLRenderDevice* device)
 		if (Device == nullptr)
 		{
 			Device = device;
-			ItTexture = Device->mTextures.insert(Device->mTextures.end(), this);
+			ItTexture = device->mTextures.insert(device->mTextures.end(), this);
 		}
 
+		mTexture = Device.load()->AcquireTexture(mWidth, mHeight, mFormat, mCubeTexture);
+		if (mTexture != 0)
+			return mTexture;
+
 		GLint oldActiveTex = GL_TEXTURE0;
 		glGetIntegerv(GL_ACTIVE_TEXTURE, &oldActiveTex);
 		glActiveTexture(GL_TEXTURE0);
@@ -181,8 +190,11 @@ GLuint GLTexture::GetTexture(GLRenderDevice* device)
 	return mTexture;
 }
 
-GLuint GLTexture::GetFramebuffer(GLRenderDevice* device, bool usedepthbuffer)
+GLuint GLTexture::GetFramebuffer(GLRenderDevice* device, bool usedepthbuffer, CubeMapFace face)
 {
+	// Cube textures share one framebuffer between the faces
+	GLenum textarget = mCubeTexture ? ToCubeMapFace(face) : GL_TEXTURE_2D;
+
 	if (!usedepthbuffer)
 	{
 		if (mFramebuffer == 0)
@@ -190,11 +202,11 @@ GLuint GLTexture::GetFramebuffer(GLRenderDevice* device, bool usedepthbuffer)
 			GLuint texture = GetTexture(device);
 			glGenFramebuffers(1, &mFramebuffer);
 			glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
-			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, textarget, texture, 0);
+			mFramebufferFace = face;
 			if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 				throw std::runtime_error("glCheckFramebufferStatus did not return GL_FRAMEBUFFER_COMPLETE");
 		}
-		return mFramebuffer;
 	}
 	else
 	{
@@ -203,7 +215,7 @@ GLuint GLTexture::GetFramebuffer(GLRenderDevice* device, bool usedepthbuffer)
 			if (Device == nullptr)
 			{
 				Device = device;
-				ItTexture = Device->mTextures.insert(Device->mTextures.end(), this);
+				ItTexture = device->mTextures.insert(device->mTextures.end(), this);
 			}
 
 			glGenRenderbuffers(1, &mDepthRenderbuffer);
@@ -217,14 +229,23 @@ GLuint GLTexture::GetFramebuffer(GLRenderDevice* device, bool usedepthbuffer)
 			GLuint texture = GetTexture(device);
 			glGenFramebuffers(1, &mFramebuffer);
 			glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
-			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, textarget, texture, 0);
 			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, mDepthRenderbuffer);
+			mFramebufferFace = face;
 			if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 				throw std::runtime_error("glCheckFramebufferStatus did not return GL_FRAMEBUFFER_COMPLETE");
 			glBindFramebuffer(GL_FRAMEBUFFER, 0);
 		}
-		return mFramebuffer;
 	}
+
+	if (mCubeTexture && mFramebufferFace != face)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, textarget, mTexture, 0);
+		mFramebufferFace = face;
+	}
+
+	return mFramebuffer;
 }
 
 GLuint GLTexture::GetPBO(GLRenderDevice* device)
@@ -234,10 +255,12 @@ GLuint GLTexture::GetPBO(GLRenderDevice* device)
 		if (Device == nullptr)
 		{
 			Device = device;
-			ItTexture = Device->mTextures.insert(Device->mTextures.end(), this);
+			ItTexture = device->mTextures.insert(device->mTextures.end(), this);
 		}
 
-		glGenBuffers(1, &mPBO);
+		mPBO = device->AcquireBuffer();
+		if (mPBO == 0)
+			glGenBuffers(1, &mPBO);
 		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mPBO);
 		glBufferData(GL_PIXEL_UNPACK_BUFFER, mWidth*mHeight * 4, NULL, GL_STREAM_DRAW);
 	}
@@ -298,3 +321,17 @@ GLenum GLTexture::ToDataType(PixelFormat format)
 	};
 	return cvt[(int)format];
 }
+
+GLenum GLTexture::ToCubeMapFace(CubeMapFace face)
+{
+	static GLenum cvt[] =
+	{
+		GL_TEXTURE_CUBE_MAP_POSITIVE_X,
+		GL_TEXTURE_CUBE_MAP_POSITIVE_Y,
+		GL_TEXTURE_CUBE_MAP_POSITIVE_Z,
+		GL_TEXTURE_CUBE_MAP_NEGATIVE_X,
+		GL_TEXTURE_CUBE_MAP_NEGATIVE_Y,
+		GL_TEXTURE_CUBE_MAP_NEGATIVE_Z
+	};
+	return cvt[(int)face];
+}
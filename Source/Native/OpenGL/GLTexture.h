@@ -23,6 +23,7 @@
 
 #include "../Backend.h"
 #include <list>
+#include <atomic>
 
 class GLRenderDevice;
 
@@ -41,23 +42,27 @@ public:
 	bool SetCubePixels(GLRenderDevice* device, CubeMapFace face, const void* data);
 
 	bool IsCubeTexture() const { return mCubeTexture; }
-	int GetWidth() const { return mWidth; }
-	int GetHeight() const { return mHeight; }
+	int GetWidth() const override { return mWidth; }
+	int GetHeight() const override { return mHeight; }
+	PixelFormat GetFormat() const override { return mFormat; }
 
 	bool IsTextureCreated() const { return mTexture; }
 	void Invalidate();
 
 	GLuint GetTexture(GLRenderDevice* device);
-	GLuint GetFramebuffer(GLRenderDevice* device, bool usedepthbuffer);
+	GLuint GetFramebuffer(GLRenderDevice* device, bool usedepthbuffer, CubeMapFace face = CubeMapFace::PositiveX);
 	GLuint GetPBO(GLRenderDevice* device);
 
-	GLRenderDevice* Device = nullptr;
+	std::atomic<GLRenderDevice*> Device{ nullptr };
 	std::list<GLTexture*>::iterator ItTexture;
+	GLTexture* NextDeleted = nullptr;
 
-private:
 	static GLint ToInternalFormat(PixelFormat format);
 	static GLenum ToDataFormat(PixelFormat format);
 	static GLenum ToDataType(PixelFormat format);
+	static GLenum ToCubeMapFace(CubeMapFace face);
+
+private:
 
 	int mWidth = 0;
 	int mHeight = 0;
@@ -66,6 +71,7 @@ private:
 	bool mPBOTexture = false;
 	GLuint mTexture = 0;
 	GLuint mFramebuffer = 0;
+	CubeMapFace mFramebufferFace = {};
 	GLuint mDepthRenderbuffer = 0;
 	GLuint mPBO = 0;
 };
@@ -23,6 +23,7 @@
 #include "GLVertexBuffer.h"
 #include "GLShader.h"
 #include "GLRenderDevice.h"
+#include <cmath>
 
 GLuint GLSharedVertexBuffer::GetBuffer()
 {
@@ -40,6 +41,8 @@ GLuint GLSharedVertexBuffer::GetVAO()
 		glBindBuffer(GL_ARRAY_BUFFER, GetBuffer());
 		if (Format == VertexFormat::Flat)
 			SetupFlatVAO();
+		else if (Format == VertexFormat::WorldCompact)
+			SetupWorldCompactVAO();
 		else
 			SetupWorldVAO();
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -47,6 +50,40 @@ GLuint GLSharedVertexBuffer::GetVAO()
 	return mVAO;
 }
 
+GLuint GLSharedVertexBuffer::GetInstancedVAO()
+{
+	if (!mInstancedVAO)
+	{
+		glGenVertexArrays(1, &mInstancedVAO);
+		glBindVertexArray(mInstancedVAO);
+		glBindBuffer(GL_ARRAY_BUFFER, GetBuffer());
+		if (Format == VertexFormat::Flat)
+			SetupFlatVAO();
+		else if (Format == VertexFormat::WorldCompact)
+			SetupWorldCompactVAO();
+		else
+			SetupWorldVAO();
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		// Instance attribute pointers are set by DrawInstanced, as the instance buffer offset varies per draw
+		glEnableVertexAttribArray((int)DeclarationUsage::InstancePosition);
+		glEnableVertexAttribArray((int)DeclarationUsage::InstanceParams);
+		glEnableVertexAttribArray((int)DeclarationUsage::InstanceColor);
+		glVertexAttribDivisor((int)DeclarationUsage::InstancePosition, 1);
+		glVertexAttribDivisor((int)DeclarationUsage::InstanceParams, 1);
+		glVertexAttribDivisor((int)DeclarationUsage::InstanceColor, 1);
+	}
+	return mInstancedVAO;
+}
+
+void GLSharedVertexBuffer::ReleaseVAOs()
+{
+	if (mVAO) glDeleteVertexArrays(1, &mVAO);
+	if (mInstancedVAO) glDeleteVertexArrays(1, &mInstancedVAO);
+	mVAO = 0;
+	mInstancedVAO = 0;
+}
+
 void GLSharedVertexBuffer::SetupFlatVAO()
 {
 	glEnableVertexAttribArray((int)DeclarationUsage::Position);
@@ -69,6 +106,76 @@ void GLSharedVertexBuffer::SetupWorldVAO()
 	glVertexAttribPointer((int)DeclarationUsage::Normal, 3, GL_FLOAT, GL_FALSE, VertexBuffer::WorldStride, (const void*)24);
 }
 
+void GLSharedVertexBuffer::SetupWorldCompactVAO()
+{
+	// Normal is left disabled so the shader reads a zero normal and picks up PackedNormal instead
+	glEnableVertexAttribArray((int)DeclarationUsage::Position);
+	glEnableVertexAttribArray((int)DeclarationUsage::Color);
+	glEnableVertexAttribArray((int)DeclarationUsage::TextureCoordinate);
+	glEnableVertexAttribArray((int)DeclarationUsage::PackedNormal);
+	glVertexAttribPointer((int)DeclarationUsage::Position, 3, GL_FLOAT, GL_FALSE, VertexBuffer::WorldCompactStride, (const void*)0);
+	glVertexAttribPointer((int)DeclarationUsage::Color, GL_BGRA, GL_UNSIGNED_BYTE, GL_TRUE, VertexBuffer::WorldCompactStride, (const void*)12);
+	glVertexAttribPointer((int)DeclarationUsage::TextureCoordinate, 2, GL_FLOAT, GL_FALSE, VertexBuffer::WorldCompactStride, (const void*)16);
+	glVertexAttribPointer((int)DeclarationUsage::PackedNormal, 4, GL_INT_2_10_10_10_REV, GL_TRUE, VertexBuffer::WorldCompactStride, (const void*)24);
+}
+
+void GLSharedVertexBuffer::SetupInstanceAttributes(int64_t offset)
+{
+	glVertexAttribPointer((int)DeclarationUsage::InstancePosition, 3, GL_FLOAT, GL_FALSE, VertexBuffer::InstanceStride, (const void*)(offset));
+	glVertexAttribPointer((int)DeclarationUsage::InstanceParams, 3, GL_FLOAT, GL_FALSE, VertexBuffer::InstanceStride, (const void*)(offset + 12));
+	glVertexAttribPointer((int)DeclarationUsage::InstanceColor, GL_BGRA, GL_UNSIGNED_BYTE, GL_TRUE, VertexBuffer::InstanceStride, (const void*)(offset + 24));
+}
+
+static int32_t PackSnorm10(float value)
+{
+	value = std::max(-1.0f, std::min(value, 1.0f));
+	return (int32_t)std::lround(value * 511.0f) & 0x3ff;
+}
+
+static uint32_t PackOctahedralNormal(float nx, float ny, float nz)
+{
+	// Zero normals (things, sprites) are stored with the valid bit cleared so the shader keeps them zero
+	float l1 = std::abs(nx) + std::abs(ny) + std::abs(nz);
+	if (l1 == 0.0f)
+		return 0;
+
+	float ox = nx / l1;
+	float oy = ny / l1;
+	if (nz < 0.0f)
+	{
+		float fx = (1.0f - std::abs(oy)) * (ox >= 0.0f ? 1.0f : -1.0f);
+		float fy = (1.0f - std::abs(ox)) * (oy >= 0.0f ? 1.0f : -1.0f);
+		ox = fx;
+		oy = fy;
+	}
+
+	return (uint32_t)PackSnorm10(ox) | ((uint32_t)PackSnorm10(oy) << 10) | ((uint32_t)PackSnorm10(1.0f) << 20);
+}
+
+void GLSharedVertexBuffer::PackWorldCompact(uint8_t* dest, const void* src, int64_t srcsize)
+{
+	struct WorldVertex { float x, y, z; uint32_t c; float u, v; float nx, ny, nz; };
+	struct WorldCompactVertex { float x, y, z; uint32_t c; float u, v; uint32_t n; };
+	static_assert(sizeof(WorldVertex) == VertexBuffer::WorldStride, "WorldVertex must match VertexBuffer::WorldStride");
+	static_assert(sizeof(WorldCompactVertex) == VertexBuffer::WorldCompactStride, "WorldCompactVertex must match VertexBuffer::WorldCompactStride");
+
+	const WorldVertex* input = static_cast<const WorldVertex*>(src);
+	WorldCompactVertex* output = reinterpret_cast<WorldCompactVertex*>(dest);
+	int64_t count = srcsize / VertexBuffer::WorldStride;
+	for (int64_t i = 0; i < count; i++)
+	{
+		const WorldVertex& v = input[i];
+		WorldCompactVertex& cv = output[i];
+		cv.x = v.x;
+		cv.y = v.y;
+		cv.z = v.z;
+		cv.c = v.c;
+		cv.u = v.u;
+		cv.v = v.v;
+		cv.n = PackOctahedralNormal(v.nx, v.ny, v.nz);
+	}
+}
+
 /////////////////////////////////////////////////////////////////////////////
 
 GLVertexBuffer::~GLVertexBuffer()
@@ -78,9 +185,10 @@ GLVertexBuffer::~GLVertexBuffer()
 
 void GLVertexBuffer::Finalize()
 {
-	if (Device)
+	GLRenderDevice* device = Device;
+	if (device)
 	{
-		Device->mSharedVertexBuffers[(int)Format]->VertexBuffers.erase(ListIt);
+		device->mSharedVertexBuffers[(int)Format]->VertexBuffers.erase(ListIt);
 		Device = nullptr;
 	}
 }
@@ -22,6 +22,7 @@
 #pragma once
 
 #include <list>
+#include <atomic>
 
 #include "../Backend.h"
 
@@ -35,6 +36,8 @@ public:
 
 	GLuint GetBuffer();
 	GLuint GetVAO();
+	GLuint GetInstancedVAO();
+	void ReleaseVAOs();
 
 	VertexFormat Format = VertexFormat::Flat;
 
@@ -45,10 +48,15 @@ public:
 
 	static void SetupFlatVAO();
 	static void SetupWorldVAO();
+	static void SetupWorldCompactVAO();
+	static void SetupInstanceAttributes(int64_t offset);
+
+	static void PackWorldCompact(uint8_t* dest, const void* src, int64_t srcsize);
 	
 private:
 	GLuint mBuffer = 0;
 	GLuint mVAO = 0;
+	GLuint mInstancedVAO = 0;
 };
 
 class GLVertexBuffer : public VertexBuffer
@@ -60,8 +68,9 @@ public:
 
 	VertexFormat Format = VertexFormat::Flat;
 
-	GLRenderDevice* Device = nullptr;
+	std::atomic<GLRenderDevice*> Device{ nullptr };
 	std::list<GLVertexBuffer*>::iterator ListIt;
+	GLVertexBuffer* NextDeleted = nullptr;
 
 	int BufferOffset = 0;
 	int BufferStartIndex = 0;
@@ -95,7 +95,7 @@ public:
 class OpenGLContext : public IOpenGLContext
 {
 public:
-	OpenGLContext(void* window);
+	OpenGLContext(void* window, bool ownsWindow = false);
 	~OpenGLContext();
 
 	void MakeCurrent() override;
@@ -110,6 +110,7 @@ public:
 
 private:
 	HWND window;
+	bool ownsWindow;
 	HDC dc;
 	HGLRC context;
 
@@ -134,7 +135,7 @@ private:
 
 /////////////////////////////////////////////////////////////////////////////
 
-OpenGLContext::OpenGLContext(void* windowptr) : window((HWND)windowptr)
+OpenGLContext::OpenGLContext(void* windowptr, bool ownsWindow) : window((HWND)windowptr), ownsWindow(ownsWindow)
 {
 	dc = GetDC(window);
 	context = CreateGL3Context(window, dc, 0);
@@ -152,6 +153,8 @@ OpenGLContext::~OpenGLContext()
 		wglDeleteContext(context);
 	if (dc)
 		ReleaseDC(window, dc);
+	if (ownsWindow)
+		DestroyWindow(window);
 }
 
 void OpenGLContext::MakeCurrent()
@@ -351,6 +354,21 @@ std::unique_ptr<IOpenGLContext> IOpenGLContext::Create(void* disp, void* window)
 	return ctx;
 }
 
+std::unique_ptr<IOpenGLContext> IOpenGLContext::CreateOffscreen(int width, int height)
+{
+	// WGL has no surfaceless contexts. A popup window that is never shown provides the pixel format.
+	HWND window = CreateWindowEx(0, WC_STATIC, TEXT(""), WS_POPUP, 0, 0, width, height, 0, 0, GetModuleHandle(0), 0);
+	if (!window)
+	{
+		SetError("Could not create the window for the offscreen context");
+		return nullptr;
+	}
+
+	auto ctx = std::make_unique<OpenGLContext>(window, true);
+	if (!ctx->IsValid()) return nullptr;
+	return ctx;
+}
+
 #elif defined(__APPLE__)
 
 // Use our UDB_MAC implementation instead
@@ -382,6 +400,12 @@ std::unique_ptr<IOpenGLContext> IOpenGLContext::Create(void* disp, void* window)
 	return ctx;
 }
 
+std::unique_ptr<IOpenGLContext> IOpenGLContext::CreateOffscreen(int width, int height)
+{
+	SetError("Offscreen rendering is not supported on this platform");
+	return nullptr;
+}
+
 #else
 
 #include <X11/Xlib.h>
@@ -484,6 +508,7 @@ class OpenGLContext : public IOpenGLContext
 {
 public:
 	OpenGLContext(void* display, void* window);
+	OpenGLContext(int width, int height);
 	~OpenGLContext();
 
 	void MakeCurrent() override;
@@ -503,6 +528,12 @@ private:
 	::Window window = 0;
 	GLXContext opengl_context = 0;
 
+	// Offscreen contexts render to a pbuffer on a display connection of their own
+	bool offscreen = false;
+	GLXPbuffer pbuffer = 0;
+	int pbuffer_width = 0;
+	int pbuffer_height = 0;
+
 	XVisualInfo* opengl_visual_info = nullptr;
 	GLXFBConfig fbconfig;
 
@@ -524,6 +555,11 @@ private:
 
 GL_GLXFunctions glx_global;
 
+static void LoadOpenGLFunctions()
+{
+	static OpenGLLoadFunctions loadFunctions;
+}
+
 #include <cstdio>
 
 #define GL_USE_DLOPEN // Using dlopen for linux by default
@@ -554,7 +590,46 @@ OpenGLContext::OpenGLContext(void* display, void* window) : disp((::Display*)dis
 	if (opengl_context)
 	{
 		MakeCurrent();
-		static OpenGLLoadFunctions loadFunctions;
+		LoadOpenGLFunctions();
+		ClearCurrent();
+	}
+}
+
+OpenGLContext::OpenGLContext(int width, int height) : offscreen(true), pbuffer_width(width), pbuffer_height(height)
+{
+	disp = XOpenDisplay(nullptr);
+	if (!disp)
+	{
+		SetError("Could not open an X display for the offscreen context");
+		return;
+	}
+
+	try
+	{
+		CreateContext();
+
+		int pbuffer_attribs[] = { GLX_PBUFFER_WIDTH, width, GLX_PBUFFER_HEIGHT, height, None };
+		pbuffer = glx.glXCreatePbuffer ? glx.glXCreatePbuffer(disp, fbconfig, pbuffer_attribs) : 0;
+		if (!pbuffer)
+			throw std::runtime_error("glXCreatePbuffer failed");
+		window = pbuffer;
+
+		glx_global = glx;
+	}
+	catch (const std::exception& e)
+	{
+		SetError("Could not create the offscreen OpenGL context: %s", e.what());
+		if (opengl_context)
+		{
+			glx.glXDestroyContext(disp, opengl_context);
+			opengl_context = nullptr;
+		}
+	}
+
+	if (opengl_context)
+	{
+		MakeCurrent();
+		LoadOpenGLFunctions();
 		ClearCurrent();
 	}
 }
@@ -577,6 +652,18 @@ OpenGLContext::~OpenGLContext()
 
 		opengl_context = nullptr;
 	}
+
+	if (pbuffer)
+	{
+		glx.glXDestroyPbuffer(disp, pbuffer);
+		pbuffer = 0;
+	}
+
+	if (offscreen && disp)
+	{
+		XCloseDisplay(disp);
+		disp = nullptr;
+	}
 }
 
 void OpenGLContext::MakeCurrent()
@@ -601,6 +688,9 @@ void OpenGLContext::SwapBuffers()
 
 int OpenGLContext::GetWidth() const
 {
+	if (offscreen)
+		return pbuffer_width;
+
 	::Window root_window;
 	int x, y;
 	unsigned int width, height, border_width, depth;
@@ -610,6 +700,9 @@ int OpenGLContext::GetWidth() const
 
 int OpenGLContext::GetHeight() const
 {
+	if (offscreen)
+		return pbuffer_height;
+
 	::Window root_window;
 	int x, y;
 	unsigned int width, height, border_width, depth;
@@ -727,14 +820,22 @@ void OpenGLContext::create_glx_1_3(::Display* disp)
 	std::vector<int> gl_attribs;
 	gl_attribs.reserve(64);
 
-	gl_attribs.push_back(GLX_X_RENDERABLE);
-	gl_attribs.push_back(True);
-	gl_attribs.push_back(GLX_DRAWABLE_TYPE);
-	gl_attribs.push_back(GLX_WINDOW_BIT);
-	//gl_attribs.push_back(GLX_RENDER_TYPE);
-	//gl_attribs.push_back(GLX_RGBA_BIT);
-	gl_attribs.push_back(GLX_X_VISUAL_TYPE);
-	gl_attribs.push_back(GLX_TRUE_COLOR);
+	if (offscreen)
+	{
+		gl_attribs.push_back(GLX_DRAWABLE_TYPE);
+		gl_attribs.push_back(GLX_PBUFFER_BIT);
+	}
+	else
+	{
+		gl_attribs.push_back(GLX_X_RENDERABLE);
+		gl_attribs.push_back(True);
+		gl_attribs.push_back(GLX_DRAWABLE_TYPE);
+		gl_attribs.push_back(GLX_WINDOW_BIT);
+		//gl_attribs.push_back(GLX_RENDER_TYPE);
+		//gl_attribs.push_back(GLX_RGBA_BIT);
+		gl_attribs.push_back(GLX_X_VISUAL_TYPE);
+		gl_attribs.push_back(GLX_TRUE_COLOR);
+	}
 	gl_attribs.push_back(GLX_RED_SIZE);
 	gl_attribs.push_back(8);
 	gl_attribs.push_back(GLX_GREEN_SIZE);
@@ -748,7 +849,7 @@ void OpenGLContext::create_glx_1_3(::Display* disp)
 	gl_attribs.push_back(GLX_STENCIL_SIZE);
 	gl_attribs.push_back(8);
 	gl_attribs.push_back(GLX_DOUBLEBUFFER);
-	gl_attribs.push_back(True);
+	gl_attribs.push_back(offscreen ? False : True);
 	gl_attribs.push_back(GLX_STEREO);
 	gl_attribs.push_back(False);
 	gl_attribs.push_back(None);
@@ -757,7 +858,11 @@ void OpenGLContext::create_glx_1_3(::Display* disp)
 	int fb_count;
 	GLXFBConfig* fbc = glx.glXChooseFBConfig(disp, DefaultScreen(disp), &gl_attribs[0], &fb_count);
 
-	if (!fbc)
+	if (!fbc && offscreen)
+	{
+		throw std::runtime_error("No pbuffer capable GLXFBConfig found");
+	}
+	else if (!fbc)
 	{
 		printf("Requested visual not supported by your OpenGL implementation. Falling back on singlebuffered Visual!\n");
 		fbc = glx.glXChooseFBConfig(disp, DefaultScreen(disp), gl_attribs_single, &fb_count);
@@ -808,7 +913,7 @@ void OpenGLContext::create_glx_1_3(::Display* disp)
 
 	if (opengl_visual_info) XFree(opengl_visual_info);
 	opengl_visual_info = glx.glXGetVisualFromFBConfig(disp, fbconfig);
-	if (opengl_visual_info == nullptr)
+	if (opengl_visual_info == nullptr && !offscreen)
 	{
 		throw std::runtime_error("glXGetVisualFromFBConfig failed");
 	}
@@ -819,7 +924,7 @@ void OpenGLContext::create_glx_1_3(::Display* disp)
 
 bool OpenGLContext::is_glx_extension_supported(const char* ext_name)
 {
-	const char* ext_string = glx.glXQueryExtensionsString(disp, opengl_visual_info->screen);
+	const char* ext_string = glx.glXQueryExtensionsString(disp, opengl_visual_info ? opengl_visual_info->screen : DefaultScreen(disp));
 	if (ext_string)
 	{
 		const char* start;
@@ -930,9 +1035,312 @@ GLXContext OpenGLContext::create_context_glx_1_3(GLXContext shared_context)
 	return context;
 }
 
+/////////////////////////////////////////////////////////////////////////////
+
+// EGL is loaded at runtime like GLX, so only the few declarations needed are repeated here
+
+typedef void* EGLDisplay;
+typedef void* EGLConfig;
+typedef void* EGLContext;
+typedef void* EGLSurface;
+typedef int32_t EGLint;
+typedef unsigned int EGLBoolean;
+typedef unsigned int EGLenum;
+
+#define EGL_NONE                                0x3038
+#define EGL_EXTENSIONS                          0x3055
+#define EGL_SURFACE_TYPE                        0x3033
+#define EGL_PBUFFER_BIT                         0x0001
+#define EGL_RENDERABLE_TYPE                     0x3040
+#define EGL_OPENGL_BIT                          0x0008
+#define EGL_RED_SIZE                            0x3024
+#define EGL_GREEN_SIZE                          0x3023
+#define EGL_BLUE_SIZE                           0x3022
+#define EGL_ALPHA_SIZE                          0x3021
+#define EGL_WIDTH                               0x3057
+#define EGL_HEIGHT                              0x3056
+#define EGL_OPENGL_API                          0x30A2
+#define EGL_CONTEXT_MAJOR_VERSION               0x3098
+#define EGL_CONTEXT_MINOR_VERSION               0x30FB
+#define EGL_CONTEXT_OPENGL_PROFILE_MASK         0x30FD
+#define EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT     0x0001
+#define EGL_PLATFORM_SURFACELESS_MESA           0x31DD
+
+class GL_EGLFunctions
+{
+public:
+	typedef void* (*ptr_eglGetProcAddress)(const char* procname);
+	typedef EGLDisplay(*ptr_eglGetDisplay)(void* display_id);
+	typedef EGLDisplay(*ptr_eglGetPlatformDisplayEXT)(EGLenum platform, void* native_display, const EGLint* attrib_list);
+	typedef EGLBoolean(*ptr_eglInitialize)(EGLDisplay dpy, EGLint* major, EGLint* minor);
+	typedef const char* (*ptr_eglQueryString)(EGLDisplay dpy, EGLint name);
+	typedef EGLBoolean(*ptr_eglBindAPI)(EGLenum api);
+	typedef EGLBoolean(*ptr_eglChooseConfig)(EGLDisplay dpy, const EGLint* attrib_list, EGLConfig* configs, EGLint config_size, EGLint* num_config);
+	typedef EGLContext(*ptr_eglCreateContext)(EGLDisplay dpy, EGLConfig config, EGLContext share_context, const EGLint* attrib_list);
+	typedef EGLBoolean(*ptr_eglDestroyContext)(EGLDisplay dpy, EGLContext ctx);
+	typedef EGLSurface(*ptr_eglCreatePbufferSurface)(EGLDisplay dpy, EGLConfig config, const EGLint* attrib_list);
+	typedef EGLBoolean(*ptr_eglDestroySurface)(EGLDisplay dpy, EGLSurface surface);
+	typedef EGLBoolean(*ptr_eglMakeCurrent)(EGLDisplay dpy, EGLSurface draw, EGLSurface read, EGLContext ctx);
+	typedef EGLContext(*ptr_eglGetCurrentContext)(void);
+	typedef EGLint(*ptr_eglGetError)(void);
+
+public:
+	ptr_eglGetProcAddress eglGetProcAddress = nullptr;
+	ptr_eglGetDisplay eglGetDisplay = nullptr;
+	ptr_eglGetPlatformDisplayEXT eglGetPlatformDisplayEXT = nullptr;
+	ptr_eglInitialize eglInitialize = nullptr;
+	ptr_eglQueryString eglQueryString = nullptr;
+	ptr_eglBindAPI eglBindAPI = nullptr;
+	ptr_eglChooseConfig eglChooseConfig = nullptr;
+	ptr_eglCreateContext eglCreateContext = nullptr;
+	ptr_eglDestroyContext eglDestroyContext = nullptr;
+	ptr_eglCreatePbufferSurface eglCreatePbufferSurface = nullptr;
+	ptr_eglDestroySurface eglDestroySurface = nullptr;
+	ptr_eglMakeCurrent eglMakeCurrent = nullptr;
+	ptr_eglGetCurrentContext eglGetCurrentContext = nullptr;
+	ptr_eglGetError eglGetError = nullptr;
+};
+
+GL_EGLFunctions egl_global;
+
+// Headless context for servers without an X display, such as Mesa llvmpipe on a build machine.
+// Uses a surfaceless context when EGL_KHR_surfaceless_context is available and a pbuffer otherwise.
+class EGLOffscreenContext : public IOpenGLContext
+{
+public:
+	EGLOffscreenContext(int width, int height);
+	~EGLOffscreenContext();
+
+	void MakeCurrent() override;
+	void ClearCurrent() override;
+	void SwapBuffers() override;
+	bool IsCurrent() override;
+
+	int GetWidth() const override { return width; }
+	int GetHeight() const override { return height; }
+
+	bool IsValid() const { return context != nullptr; }
+
+private:
+	void CreateContext();
+	bool is_egl_extension_supported(const char* ext_string, const char* ext_name);
+
+	GL_EGLFunctions egl;
+	void* egl_lib_handle = nullptr;
+
+	EGLDisplay display = nullptr;
+	EGLConfig config = nullptr;
+	EGLContext context = nullptr;
+	EGLSurface surface = nullptr;
+
+	int width = 0;
+	int height = 0;
+};
+
+#define GL_EGL_LIBRARY "libEGL.so.1"
+
+EGLOffscreenContext::EGLOffscreenContext(int width, int height) : width(width), height(height)
+{
+	try
+	{
+		CreateContext();
+		egl_global = egl;
+	}
+	catch (const std::exception& e)
+	{
+		SetError("Could not create the offscreen OpenGL context: %s", e.what());
+		if (context)
+		{
+			egl.eglDestroyContext(display, context);
+			context = nullptr;
+		}
+	}
+
+	if (context)
+	{
+		MakeCurrent();
+		LoadOpenGLFunctions();
+		ClearCurrent();
+	}
+}
+
+EGLOffscreenContext::~EGLOffscreenContext()
+{
+	if (context)
+	{
+		if (IsCurrent())
+			ClearCurrent();
+		egl.eglDestroyContext(display, context);
+		context = nullptr;
+	}
+
+	if (surface)
+	{
+		egl.eglDestroySurface(display, surface);
+		surface = nullptr;
+	}
+
+	// The display is not terminated. Other offscreen contexts may share it, and eglTerminate would invalidate them too.
+}
+
+void EGLOffscreenContext::MakeCurrent()
+{
+	egl.eglMakeCurrent(display, surface, surface, context);
+}
+
+void EGLOffscreenContext::ClearCurrent()
+{
+	egl.eglMakeCurrent(display, nullptr, nullptr, nullptr);
+}
+
+void EGLOffscreenContext::SwapBuffers()
+{
+	// Nothing is displayed. Flushing keeps the frame pacing of the window contexts.
+	glFlush();
+}
+
+bool EGLOffscreenContext::IsCurrent()
+{
+	return egl.eglGetCurrentContext() == context;
+}
+
+void EGLOffscreenContext::CreateContext()
+{
+	egl_lib_handle = dlopen(GL_EGL_LIBRARY, RTLD_NOW | RTLD_GLOBAL);
+	if (!egl_lib_handle)
+		throw std::runtime_error(std::string("Cannot open EGL library: ") + GL_EGL_LIBRARY);
+
+	egl.eglGetProcAddress = (GL_EGLFunctions::ptr_eglGetProcAddress)dlsym(egl_lib_handle, "eglGetProcAddress");
+	egl.eglGetDisplay = (GL_EGLFunctions::ptr_eglGetDisplay)dlsym(egl_lib_handle, "eglGetDisplay");
+	egl.eglInitialize = (GL_EGLFunctions::ptr_eglInitialize)dlsym(egl_lib_handle, "eglInitialize");
+	egl.eglQueryString = (GL_EGLFunctions::ptr_eglQueryString)dlsym(egl_lib_handle, "eglQueryString");
+	egl.eglBindAPI = (GL_EGLFunctions::ptr_eglBindAPI)dlsym(egl_lib_handle, "eglBindAPI");
+	egl.eglChooseConfig = (GL_EGLFunctions::ptr_eglChooseConfig)dlsym(egl_lib_handle, "eglChooseConfig");
+	egl.eglCreateContext = (GL_EGLFunctions::ptr_eglCreateContext)dlsym(egl_lib_handle, "eglCreateContext");
+	egl.eglDestroyContext = (GL_EGLFunctions::ptr_eglDestroyContext)dlsym(egl_lib_handle, "eglDestroyContext");
+	egl.eglCreatePbufferSurface = (GL_EGLFunctions::ptr_eglCreatePbufferSurface)dlsym(egl_lib_handle, "eglCreatePbufferSurface");
+	egl.eglDestroySurface = (GL_EGLFunctions::ptr_eglDestroySurface)dlsym(egl_lib_handle, "eglDestroySurface");
+	egl.eglMakeCurrent = (GL_EGLFunctions::ptr_eglMakeCurrent)dlsym(egl_lib_handle, "eglMakeCurrent");
+	egl.eglGetCurrentContext = (GL_EGLFunctions::ptr_eglGetCurrentContext)dlsym(egl_lib_handle, "eglGetCurrentContext");
+	egl.eglGetError = (GL_EGLFunctions::ptr_eglGetError)dlsym(egl_lib_handle, "eglGetError");
+
+	if (!egl.eglGetProcAddress || !egl.eglGetDisplay || !egl.eglInitialize || !egl.eglQueryString || !egl.eglBindAPI ||
+		!egl.eglChooseConfig || !egl.eglCreateContext || !egl.eglDestroyContext || !egl.eglCreatePbufferSurface ||
+		!egl.eglDestroySurface || !egl.eglMakeCurrent || !egl.eglGetCurrentContext || !egl.eglGetError)
+	{
+		throw std::runtime_error("Cannot obtain required EGL functions");
+	}
+
+	// Client extensions can be queried without a display
+	const char* client_extensions = egl.eglQueryString(nullptr, EGL_EXTENSIONS);
+	if (client_extensions && is_egl_extension_supported(client_extensions, "EGL_MESA_platform_surfaceless"))
+	{
+		egl.eglGetPlatformDisplayEXT = (GL_EGLFunctions::ptr_eglGetPlatformDisplayEXT)egl.eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (egl.eglGetPlatformDisplayEXT)
+			display = egl.eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, nullptr, nullptr);
+	}
+
+	EGLint egl_major = 0, egl_minor = 0;
+	if (!display || !egl.eglInitialize(display, &egl_major, &egl_minor))
+	{
+		display = egl.eglGetDisplay(nullptr);
+		if (!display || !egl.eglInitialize(display, &egl_major, &egl_minor))
+			throw std::runtime_error("eglInitialize failed");
+	}
+
+	if (!egl.eglBindAPI(EGL_OPENGL_API))
+		throw std::runtime_error("Desktop OpenGL is not supported by the EGL implementation");
+
+	bool surfaceless = is_egl_extension_supported(egl.eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+
+	EGLint config_attribs[] =
+	{
+		EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_ALPHA_SIZE, 8,
+		EGL_NONE
+	};
+
+	EGLint num_configs = 0;
+	if (!egl.eglChooseConfig(display, config_attribs, &config, 1, &num_configs) || num_configs == 0)
+		throw std::runtime_error("eglChooseConfig found no OpenGL config");
+
+	for (int version : { 46, 45, 44, 43, 42, 41, 40, 33, 32 })
+	{
+		EGLint context_attribs[] =
+		{
+			EGL_CONTEXT_MAJOR_VERSION, version / 10,
+			EGL_CONTEXT_MINOR_VERSION, version % 10,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE
+		};
+
+		context = egl.eglCreateContext(display, config, nullptr, context_attribs);
+		if (context)
+			break;
+	}
+
+	if (!context)
+		throw std::runtime_error("No OpenGL 3.2 support found (EGL error " + std::to_string(egl.eglGetError()) + ")");
+
+	if (!surfaceless)
+	{
+		EGLint surface_attribs[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+		surface = egl.eglCreatePbufferSurface(display, config, surface_attribs);
+		if (!surface)
+			throw std::runtime_error("eglCreatePbufferSurface failed");
+	}
+}
+
+bool EGLOffscreenContext::is_egl_extension_supported(const char* ext_string, const char* ext_name)
+{
+	if (!ext_string)
+		return false;
+
+	size_t ext_len = strlen(ext_name);
+	for (const char* start = ext_string; ; )
+	{
+		const char* where = strstr(start, ext_name);
+		if (!where)
+			return false;
+
+		const char* terminator = where + ext_len;
+		if ((where == start || *(where - 1) == ' ') && (*terminator == ' ' || *terminator == '\0'))
+			return true;
+
+		start = terminator;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+std::unique_ptr<IOpenGLContext> IOpenGLContext::Create(void* disp, void* window)
+{
+	auto ctx = std::make_unique<OpenGLContext>(disp, window);
+	if (!ctx->IsValid()) return nullptr;
+	return ctx;
+}
+
+std::unique_ptr<IOpenGLContext> IOpenGLContext::CreateOffscreen(int width, int height)
+{
+	// EGL works without an X server. GLX pbuffers are the fallback for drivers without desktop GL on EGL.
+	auto eglctx = std::make_unique<EGLOffscreenContext>(width, height);
+	if (eglctx->IsValid()) return std::move(eglctx);
+
+	auto glxctx = std::make_unique<OpenGLContext>(width, height);
+	if (glxctx->IsValid()) return std::move(glxctx);
+
+	return nullptr;
+}
+
 void* GL_GetProcAddress(const char* function_name)
 {
-	if (glx_global.glXGetProcAddressARB)
+	if (egl_global.eglGetProcAddress)
+		return egl_global.eglGetProcAddress(function_name);
+	else if (glx_global.glXGetProcAddressARB)
 		return (void*)glx_global.glXGetProcAddressARB((GLubyte*)function_name);
 	else if (glx_global.glXGetProcAddress)
 		return (void*)glx_global.glXGetProcAddress((GLubyte*)function_name);
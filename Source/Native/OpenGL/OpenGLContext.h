@@ -37,4 +37,7 @@ public:
 	virtual int GetHeight() const = 0;
 	
 	static std::unique_ptr<IOpenGLContext> Create(void* disp, void* window);
+
+	// Context without a visible window. The device renders into its own framebuffer object.
+	static std::unique_ptr<IOpenGLContext> CreateOffscreen(int width, int height);
 };
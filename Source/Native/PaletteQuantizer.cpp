@@ -0,0 +1,235 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Precomp.h"
+#include "PaletteQuantizer.h"
+#include "Backend.h"
+#include "Software/SWRasterizer.h"
+#include <algorithm>
+#include <climits>
+
+namespace
+{
+	// Playpal.FindClosestColor starts its search at this distance and returns index 0 when nothing is closer
+	const int MaxDistance = 99999;
+
+	// Pixels per worker task
+	const int ChunkSize = 16384;
+
+	inline int Square(int v) { return v * v; }
+}
+
+PaletteQuantizer::PaletteQuantizer()
+{
+	mPool = SWWorkerPool::GetShared();
+}
+
+PaletteQuantizer::~PaletteQuantizer()
+{
+}
+
+bool PaletteQuantizer::SetPalette(const uint32_t* palette, int count)
+{
+	if (!palette || count <= 0 || count > 256)
+	{
+		SetError("Invalid palette size %d", count);
+		return false;
+	}
+
+	mNumColors = count;
+	mPalette.resize(count * 3);
+	for (int i = 0; i < count; i++)
+	{
+		mPalette[i * 3] = (palette[i] >> 16) & 0xff;
+		mPalette[i * 3 + 1] = (palette[i] >> 8) & 0xff;
+		mPalette[i * 3 + 2] = palette[i] & 0xff;
+	}
+
+	mCells.resize(CellsPerAxis * CellsPerAxis * CellsPerAxis);
+
+	// Each red slice of the cube gets its own candidate list, which are joined afterwards
+	std::vector<std::vector<uint8_t>> slices(CellsPerAxis);
+	mPool->RunOrInline(CellsPerAxis, [&](int cr) {
+		std::vector<uint8_t>& candidates = slices[cr];
+		std::vector<int> mindist(count);
+		std::vector<int> maxdist(count);
+		for (int cg = 0; cg < CellsPerAxis; cg++)
+		{
+			for (int cb = 0; cb < CellsPerAxis; cb++)
+			{
+				int lo[3] = { cr << CellShift, cg << CellShift, cb << CellShift };
+				int hi[3] = { lo[0] + (1 << CellShift) - 1, lo[1] + (1 << CellShift) - 1, lo[2] + (1 << CellShift) - 1 };
+
+				// Find the smallest distance that is guaranteed to be reached from anywhere in the cell
+				int limit = INT_MAX;
+				for (int i = 0; i < count; i++)
+				{
+					int nearest = 0, farthest = 0;
+					for (int c = 0; c < 3; c++)
+					{
+						int v = mPalette[i * 3 + c];
+						nearest += Square(std::max(std::max(lo[c] - v, v - hi[c]), 0));
+						farthest += Square(std::max(v - lo[c], hi[c] - v));
+					}
+					mindist[i] = nearest;
+					maxdist[i] = farthest;
+					limit = std::min(limit, farthest);
+				}
+
+				// Entries that can't come closer than that are strictly worse for every color in the cell
+				Cell& cell = mCells[(cr << (CellBits * 2)) | (cg << CellBits) | cb];
+				cell.First = (uint32_t)candidates.size();
+				cell.Count = 0;
+				for (int i = 0; i < count; i++)
+				{
+					if (mindist[i] <= limit)
+					{
+						candidates.push_back(i);
+						cell.Count++;
+					}
+				}
+
+				// A single candidate always wins, unless the cap in FindClosestColor can kick in
+				if (cell.Count == 1 && maxdist[candidates.back()] < MaxDistance)
+				{
+					cell.First = candidates.back();
+					cell.Count = 0;
+					candidates.pop_back();
+				}
+			}
+		}
+	});
+
+	mCandidates.clear();
+	for (int cr = 0; cr < CellsPerAxis; cr++)
+	{
+		Cell* cells = mCells.data() + (cr << (CellBits * 2));
+		for (int i = 0; i < CellsPerAxis * CellsPerAxis; i++)
+		{
+			if (cells[i].Count != 0)
+				cells[i].First += (uint32_t)mCandidates.size();
+		}
+		mCandidates.insert(mCandidates.end(), slices[cr].begin(), slices[cr].end());
+	}
+
+	return true;
+}
+
+int PaletteQuantizer::FindClosestColor(uint32_t pixel) const
+{
+	int r = (pixel >> 16) & 0xff;
+	int g = (pixel >> 8) & 0xff;
+	int b = pixel & 0xff;
+
+	const Cell& cell = mCells[((r >> CellShift) << (CellBits * 2)) | ((g >> CellShift) << CellBits) | (b >> CellShift)];
+	if (cell.Count == 0)
+		return cell.First;
+
+	// Candidates are in palette order, so ties go to the lowest index like in the full search
+	const uint8_t* candidates = mCandidates.data() + cell.First;
+	int mindist = MaxDistance;
+	int minindex = 0;
+	for (uint32_t i = 0; i < cell.Count; i++)
+	{
+		const uint8_t* color = mPalette.data() + candidates[i] * 3;
+		int dist = Square(r - color[0]) + Square(g - color[1]) + Square(b - color[2]);
+		if (dist < mindist)
+		{
+			mindist = dist;
+			minindex = candidates[i];
+		}
+	}
+	return minindex;
+}
+
+void PaletteQuantizer::ConvertRange(const uint32_t* inpixels, uint32_t* outpixels, int count) const
+{
+	// Neighbouring pixels are often the same color
+	uint32_t lastcolor = 0;
+	uint32_t lastindex = FindClosestColor(0);
+	for (int i = 0; i < count; i++)
+	{
+		uint32_t pixel = inpixels[i];
+		uint32_t color = pixel & 0x00ffffff;
+		if (color != lastcolor)
+		{
+			lastcolor = color;
+			lastindex = FindClosestColor(color);
+		}
+		outpixels[i] = (pixel & 0xff000000) | (lastindex << 16);
+	}
+}
+
+bool PaletteQuantizer::Convert(const uint32_t* inpixels, uint32_t* outpixels, int count) const
+{
+	if (mNumColors == 0)
+	{
+		SetError("No palette set on the quantizer");
+		return false;
+	}
+
+	if (count < 0 || (count > 0 && (!inpixels || !outpixels)))
+	{
+		SetError("Invalid quantizer input");
+		return false;
+	}
+
+	int numchunks = (count + ChunkSize - 1) / ChunkSize;
+	if (numchunks <= 1)
+	{
+		ConvertRange(inpixels, outpixels, count);
+	}
+	else
+	{
+		mPool->RunOrInline(numchunks, [&](int chunk) {
+			int start = chunk * ChunkSize;
+			ConvertRange(inpixels + start, outpixels + start, std::min(ChunkSize, count - start));
+		});
+	}
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+extern "C"
+{
+
+PaletteQuantizer* PaletteQuantizer_New()
+{
+	return new PaletteQuantizer();
+}
+
+void PaletteQuantizer_Delete(PaletteQuantizer* quantizer)
+{
+	delete quantizer;
+}
+
+bool PaletteQuantizer_SetPalette(PaletteQuantizer* quantizer, const uint32_t* palette, int count)
+{
+	return quantizer->SetPalette(palette, count);
+}
+
+bool PaletteQuantizer_Convert(PaletteQuantizer* quantizer, const uint32_t* inpixels, uint32_t* outpixels, int count)
+{
+	return quantizer->Convert(inpixels, outpixels, count);
+}
+
+}
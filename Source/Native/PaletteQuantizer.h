@@ -0,0 +1,58 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+class SWWorkerPool;
+
+// Maps 32-bit colors to the nearest entry of a palette, like Playpal.FindClosestColor does.
+// A 32x32x32 table lists for every cell of the color cube the palette entries that can be
+// the nearest one for a color inside it, so the results are identical to a full search.
+class PaletteQuantizer
+{
+public:
+	PaletteQuantizer();
+	~PaletteQuantizer();
+
+	bool SetPalette(const uint32_t* palette, int count);
+
+	// Writes the palette index into the red channel and keeps the alpha of the input pixel.
+	// Can be called from several threads at once, but not together with SetPalette.
+	bool Convert(const uint32_t* inpixels, uint32_t* outpixels, int count) const;
+
+private:
+	struct Cell
+	{
+		uint32_t First; // Palette index when Count is 0, otherwise the first candidate
+		uint32_t Count;
+	};
+
+	int FindClosestColor(uint32_t pixel) const;
+	void ConvertRange(const uint32_t* inpixels, uint32_t* outpixels, int count) const;
+
+	enum { CellBits = 5, CellShift = 8 - CellBits, CellsPerAxis = 1 << CellBits };
+
+	std::shared_ptr<SWWorkerPool> mPool;
+	std::vector<uint8_t> mPalette; // r,g,b per entry
+	std::vector<Cell> mCells;
+	std::vector<uint8_t> mCandidates;
+	int mNumColors = 0;
+};
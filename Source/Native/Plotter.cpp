@@ -0,0 +1,449 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "Precomp.h"
+#include "Plotter.h"
+#include "Backend.h"
+#include "Software/SWRasterizer.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PLOTTER_USE_SSE2
+#endif
+
+namespace
+{
+	int Clamp(int value, int min, int max)
+	{
+		return std::min(std::max(min, value), max);
+	}
+}
+
+Plotter::Plotter(int width, int height) : mWidth(width), mHeight(height), mVisibleWidth(width), mVisibleHeight(height)
+{
+	mPixels.resize((size_t)width * height);
+	mBins.resize((height + BandHeight - 1) >> BandShift);
+
+	mPool = SWWorkerPool::GetShared();
+}
+
+Plotter::~Plotter()
+{
+}
+
+bool Plotter::Draw(const PlotterCommand* commands, int count, bool clear, void* target)
+{
+	if (count < 0 || (count > 0 && !commands))
+	{
+		SetError("Invalid plotter command batch");
+		return false;
+	}
+
+	// Sort the commands into the bands they touch, keeping their order within each band
+	for (std::vector<int>& bin : mBins)
+		bin.clear();
+
+	for (int i = 0; i < count; i++)
+	{
+		int y0, y1;
+		if (GetRowRange(commands[i], y0, y1))
+		{
+			for (int band = y0 >> BandShift, last = y1 >> BandShift; band <= last; band++)
+				mBins[band].push_back(i);
+		}
+	}
+
+	mPool->Run((int)mBins.size(), [&](int band) { DrawBand(commands, band, clear, target); });
+
+#ifdef PLOTTER_USE_SSE2
+	if (target)
+		_mm_sfence();
+#endif
+	return true;
+}
+
+bool Plotter::GetRowRange(const PlotterCommand& command, int& y0, int& y1) const
+{
+	switch (command.Type)
+	{
+	case PlotterCommandType::PixelSolid:
+	case PlotterCommandType::PixelAlpha:
+	case PlotterCommandType::GridLineH:
+		y0 = y1 = TransformY(command.Y1);
+		break;
+	case PlotterCommandType::VertexSolid:
+		y0 = TransformY(command.Y1) - command.Size;
+		y1 = TransformY(command.Y1) + command.Size;
+		break;
+	case PlotterCommandType::GridLineV:
+	case PlotterCommandType::LineSolid:
+		y0 = std::min(TransformY(command.Y1), TransformY(command.Y2)) - 1;
+		y1 = std::max(TransformY(command.Y1), TransformY(command.Y2)) + 1;
+		break;
+	default:
+		return false;
+	}
+
+	if (y1 < 0 || y0 >= mHeight)
+		return false;
+
+	y0 = std::max(y0, 0);
+	y1 = std::min(y1, mHeight - 1);
+	return true;
+}
+
+void Plotter::DrawBand(const PlotterCommand* commands, int band, bool clear, void* target)
+{
+	int bandY0 = band << BandShift;
+	int bandY1 = std::min(bandY0 + BandHeight, mHeight);
+
+	if (clear)
+		FillSpan(mPixels.data() + (size_t)bandY0 * mWidth, (bandY1 - bandY0) * mWidth, 0);
+
+	for (int index : mBins[band])
+	{
+		const PlotterCommand& command = commands[index];
+		switch (command.Type)
+		{
+		case PlotterCommandType::PixelSolid: DrawPixelSolid(command, bandY0, bandY1); break;
+		case PlotterCommandType::PixelAlpha: DrawPixelAlpha(command, bandY0, bandY1); break;
+		case PlotterCommandType::VertexSolid: DrawVertexSolid(command, bandY0, bandY1); break;
+		case PlotterCommandType::GridLineH: DrawGridLineH(command, bandY0, bandY1); break;
+		case PlotterCommandType::GridLineV: DrawGridLineV(command, bandY0, bandY1); break;
+		case PlotterCommandType::LineSolid: DrawLineSolid(command, bandY0, bandY1); break;
+		}
+	}
+
+	if (target)
+	{
+		size_t offset = (size_t)bandY0 * mWidth;
+		StreamCopy(static_cast<uint32_t*>(target) + offset, mPixels.data() + offset, (bandY1 - bandY0) * mWidth);
+	}
+}
+
+void Plotter::DrawPixelSolid(const PlotterCommand& command, int bandY0, int bandY1)
+{
+	int x = command.X1;
+	int y = TransformY(command.Y1);
+	if (x >= 0 && x < mVisibleWidth && y >= bandY0 && y < bandY1 && y < mVisibleHeight)
+		mPixels[(size_t)y * mWidth + x] = command.Color;
+}
+
+void Plotter::DrawPixelAlpha(const PlotterCommand& command, int bandY0, int bandY1)
+{
+	int x = command.X1;
+	int y = TransformY(command.Y1);
+	if (x < 0 || x >= mVisibleWidth || y < bandY0 || y >= bandY1 || y >= mVisibleHeight)
+		return;
+
+	uint32_t& p = mPixels[(size_t)y * mWidth + x];
+	uint32_t c = command.Color;
+
+	// Not drawn on target yet?
+	if (p == 0)
+	{
+		p = c;
+		return;
+	}
+
+	uint32_t ca = c >> 24;
+	uint32_t pa = p >> 24;
+	float a = ca * 0.003921568627450980392156862745098f;
+	float ia = 1.0f - a;
+	uint32_t r = (uint32_t)(((p >> 16) & 0xff) * ia + ((c >> 16) & 0xff) * a);
+	uint32_t g = (uint32_t)(((p >> 8) & 0xff) * ia + ((c >> 8) & 0xff) * a);
+	uint32_t b = (uint32_t)((p & 0xff) * ia + (c & 0xff) * a);
+	uint32_t alpha = std::min(pa + ca, 255u);
+	p = (alpha << 24) | ((r & 0xff) << 16) | ((g & 0xff) << 8) | (b & 0xff);
+}
+
+void Plotter::DrawVertexSolid(const PlotterCommand& command, int bandY0, int bandY1)
+{
+	int size = command.Size;
+	int y = TransformY(command.Y1);
+	int x1 = command.X1 - size;
+	int x2 = command.X1 + size;
+	int y1 = y - size;
+	int y2 = y + size;
+
+	// Vertices are only drawn when they are completely visible
+	if (x1 < 0 || x2 >= mVisibleWidth || y1 < 0 || y2 >= mVisibleHeight)
+		return;
+
+	uint32_t c = command.Color;
+	uint32_t l = command.LightColor;
+	uint32_t d = command.DarkColor;
+
+	// The top left edges are light, the bottom right edges dark. The other two corners keep the fill color.
+	for (int yp = std::max(y1, bandY0), yend = std::min(y2 + 1, bandY1); yp < yend; yp++)
+	{
+		uint32_t* line = mPixels.data() + (size_t)yp * mWidth;
+		if (size == 0)
+		{
+			line[x1] = l;
+		}
+		else if (yp == y1)
+		{
+			FillSpan(line + x1, x2 - x1, l);
+			line[x2] = c;
+		}
+		else if (yp == y2)
+		{
+			line[x1] = c;
+			FillSpan(line + x1 + 1, x2 - x1, d);
+		}
+		else
+		{
+			line[x1] = l;
+			FillSpan(line + x1 + 1, x2 - x1 - 1, c);
+			line[x2] = d;
+		}
+	}
+}
+
+void Plotter::DrawGridLineH(const PlotterCommand& command, int bandY0, int bandY1)
+{
+	int y = TransformY(command.Y1);
+	if (y < 0 || y >= mHeight || y < bandY0 || y >= bandY1)
+		return;
+
+	int numpixels = mVisibleWidth >> 1;
+	int offset = y & 0x01;
+	int x1 = Clamp(command.X1 >> 1, 0, numpixels - 1);
+	int x2 = Clamp(command.X2 >> 1, 0, numpixels - 1);
+
+	uint32_t* line = mPixels.data() + (size_t)y * mWidth;
+	uint32_t c = command.Color;
+	for (int i = x1; i < x2; i++)
+		line[(i << 1) | offset] = c;
+}
+
+void Plotter::DrawGridLineV(const PlotterCommand& command, int bandY0, int bandY1)
+{
+	int x = command.X1;
+	if (x < 0 || x >= mWidth)
+		return;
+
+	int numpixels = mVisibleHeight >> 1;
+	int offset = x & 0x01;
+	int y1 = Clamp(TransformY(command.Y1) >> 1, 0, numpixels - 1);
+	int y2 = Clamp(TransformY(command.Y2) >> 1, 0, numpixels - 1);
+
+	// Only the dots that land in this band
+	int start = std::max(y2, (bandY0 - offset + 1) >> 1);
+	int end = std::min(y1, (bandY1 - offset + 1) >> 1);
+
+	uint32_t c = command.Color;
+	for (int i = start; i < end; i++)
+		mPixels[(size_t)((i << 1) | offset) * mWidth + x] = c;
+}
+
+// Same stepping as the managed Bresenham implementation, including where the dash mask starts.
+// Instead of walking the whole line, each band jumps straight to the first step that enters it.
+void Plotter::DrawLineSolid(const PlotterCommand& command, int bandY0, int bandY1)
+{
+	int x1 = command.X1;
+	int y1 = TransformY(command.Y1);
+	int x2 = command.X2;
+	int y2 = TransformY(command.Y2);
+
+	// Check if the line is outside the screen for sure
+	if ((x1 < 0 && x2 < 0) ||
+		(x1 > mVisibleWidth && x2 > mVisibleWidth) ||
+		(y1 < 0 && y2 < 0) ||
+		(y1 > mVisibleHeight && y2 > mVisibleHeight))
+		return;
+
+	int rowY0 = bandY0;
+	int rowY1 = std::min(bandY1, mVisibleHeight);
+
+	int dx = x2 - x1;
+	int dy = y2 - y1;
+	int sdx = (dx > 0) - (dx < 0);
+	int sdy = (dy > 0) - (dy < 0);
+	int64_t dxabs = std::abs((int64_t)dx);
+	int64_t dyabs = std::abs((int64_t)dy);
+
+	// Steps along the major axis. The minor axis advances whenever the accumulator wraps.
+	bool xmajor = dxabs >= dyabs;
+	int64_t major = xmajor ? dxabs : dyabs;
+	int64_t minor = xmajor ? dyabs : dxabs;
+	int64_t half = major >> 1;
+	int smajor = xmajor ? sdx : sdy;
+	int majorStart = xmajor ? x1 : y1;
+	int majorEnd = xmajor ? mVisibleWidth : rowY1;
+	int majorBegin = xmajor ? 0 : rowY0;
+
+	// Range of steps where the major axis coordinate is inside the visible area and band
+	int64_t kmin = 0;
+	int64_t kmax = major;
+	if (smajor > 0)
+	{
+		kmin = std::max(kmin, (int64_t)majorBegin - majorStart);
+		kmax = std::min(kmax, (int64_t)majorEnd - 1 - majorStart);
+	}
+	else if (smajor < 0)
+	{
+		kmin = std::max(kmin, (int64_t)majorStart - (majorEnd - 1));
+		kmax = std::min(kmax, (int64_t)majorStart - majorBegin);
+	}
+
+	// Range of steps where the rows are inside the band, for lines that are mostly horizontal
+	if (xmajor)
+	{
+		if (sdy == 0)
+		{
+			if (y1 < rowY0 || y1 >= rowY1)
+				return;
+		}
+		else
+		{
+			int64_t tlo = sdy > 0 ? rowY0 - y1 : y1 - (rowY1 - 1);
+			int64_t thi = sdy > 0 ? rowY1 - 1 - y1 : y1 - rowY0;
+			if (thi < 0)
+				return;
+
+			// Smallest step count where the minor axis has advanced at least t times
+			auto firstStep = [&](int64_t t) -> int64_t { return t <= 0 ? 0 : (t * major - half + minor - 1) / minor; };
+			kmin = std::max(kmin, firstStep(tlo));
+			kmax = std::min(kmax, firstStep(thi + 1) - 1);
+		}
+	}
+
+	if (kmin > kmax)
+		return;
+
+	// Reconstruct the state after kmin steps
+	int64_t acc = half + kmin * minor;
+	int64_t advanced = major > 0 ? acc / major : 0;
+	acc -= advanced * major;
+	int px = x1 + (int)(xmajor ? sdx * kmin : sdx * advanced);
+	int py = y1 + (int)(xmajor ? sdy * advanced : sdy * kmin);
+
+	int* pmajor = xmajor ? &px : &py;
+	int* pminor = xmajor ? &py : &px;
+	int sminor = xmajor ? sdy : sdx;
+
+	uint32_t c = command.Color;
+	uint32_t mask = command.Mask;
+	uint32_t* pixels = mPixels.data();
+	int width = mWidth;
+	int visiblewidth = mVisibleWidth;
+
+	for (int64_t k = kmin; ; )
+	{
+		// The first pixel is always drawn, then the mask decides per step
+		if ((k == 0 || (mask & (1u << ((k - 1) & 0x7)))) && px >= 0 && px < visiblewidth && py >= rowY0 && py < rowY1)
+			pixels[(size_t)py * width + px] = c;
+
+		if (++k > kmax)
+			break;
+
+		acc += minor;
+		if (acc >= major)
+		{
+			acc -= major;
+			*pminor += sminor;
+		}
+		*pmajor += smajor;
+	}
+}
+
+void Plotter::FillSpan(uint32_t* dest, int count, uint32_t color)
+{
+	int i = 0;
+#ifdef PLOTTER_USE_SSE2
+	while (i < count && ((size_t)(dest + i) & 15) != 0)
+		dest[i++] = color;
+
+	__m128i value = _mm_set1_epi32((int)color);
+	for (; i + 16 <= count; i += 16)
+	{
+		_mm_store_si128((__m128i*)(dest + i), value);
+		_mm_store_si128((__m128i*)(dest + i + 4), value);
+		_mm_store_si128((__m128i*)(dest + i + 8), value);
+		_mm_store_si128((__m128i*)(dest + i + 12), value);
+	}
+	for (; i + 4 <= count; i += 4)
+		_mm_store_si128((__m128i*)(dest + i), value);
+#endif
+	for (; i < count; i++)
+		dest[i] = color;
+}
+
+void Plotter::StreamCopy(uint32_t* dest, const uint32_t* src, int count)
+{
+	int i = 0;
+#ifdef PLOTTER_USE_SSE2
+	// The target is write combined memory in most drivers. Bypass the cache and write full lines.
+	while (i < count && ((size_t)(dest + i) & 15) != 0)
+	{
+		dest[i] = src[i];
+		i++;
+	}
+
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)(src + i));
+		__m128i b = _mm_loadu_si128((const __m128i*)(src + i + 4));
+		__m128i c = _mm_loadu_si128((const __m128i*)(src + i + 8));
+		__m128i d = _mm_loadu_si128((const __m128i*)(src + i + 12));
+		_mm_stream_si128((__m128i*)(dest + i), a);
+		_mm_stream_si128((__m128i*)(dest + i + 4), b);
+		_mm_stream_si128((__m128i*)(dest + i + 8), c);
+		_mm_stream_si128((__m128i*)(dest + i + 12), d);
+	}
+	for (; i + 4 <= count; i += 4)
+		_mm_stream_si128((__m128i*)(dest + i), _mm_loadu_si128((const __m128i*)(src + i)));
+#endif
+	if (i < count)
+		memcpy(dest + i, src + i, (count - i) * sizeof(uint32_t));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+extern "C"
+{
+
+Plotter* Plotter_New(int width, int height)
+{
+	if (width <= 0 || height <= 0)
+	{
+		SetError("Invalid plotter size %dx%d", width, height);
+		return nullptr;
+	}
+	return new Plotter(width, height);
+}
+
+void Plotter_Delete(Plotter* plotter)
+{
+	delete plotter;
+}
+
+bool Plotter_Draw(Plotter* plotter, const PlotterCommand* commands, int count, bool clear, void* target)
+{
+	return plotter->Draw(commands, count, clear, target);
+}
+
+}
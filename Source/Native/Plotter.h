@@ -0,0 +1,93 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class SWWorkerPool;
+
+enum class PlotterCommandType : int32_t
+{
+	PixelSolid,
+	PixelAlpha,
+	VertexSolid,
+	GridLineH,
+	GridLineV,
+	LineSolid
+};
+
+// One drawing call recorded by the managed Plotter. Coordinates are passed untransformed,
+// exactly as given to the managed methods. Colors are BGRA8 packed the same way as PixelColor.
+struct PlotterCommand
+{
+	PlotterCommandType Type;
+	int32_t X1;
+	int32_t Y1;
+	int32_t X2;
+	int32_t Y2;
+	int32_t Size;
+	uint32_t Color;
+	uint32_t LightColor;
+	uint32_t DarkColor;
+	uint32_t Mask;
+};
+
+// Rasterizes batches of 2D map elements into a persistent surface, split into horizontal bands
+// that are drawn in parallel. Each band is streamed into the target (usually a mapped PBO) as
+// soon as it is done, while it is still in the cache.
+class Plotter
+{
+public:
+	Plotter(int width, int height);
+	~Plotter();
+
+	bool Draw(const PlotterCommand* commands, int count, bool clear, void* target);
+
+private:
+	static const int BandShift = 5;
+	static const int BandHeight = 1 << BandShift;
+
+	int TransformY(int y) const { return mHeight - y; }
+	bool GetRowRange(const PlotterCommand& command, int& y0, int& y1) const;
+
+	void DrawBand(const PlotterCommand* commands, int band, bool clear, void* target);
+	void DrawPixelSolid(const PlotterCommand& command, int bandY0, int bandY1);
+	void DrawPixelAlpha(const PlotterCommand& command, int bandY0, int bandY1);
+	void DrawVertexSolid(const PlotterCommand& command, int bandY0, int bandY1);
+	void DrawGridLineH(const PlotterCommand& command, int bandY0, int bandY1);
+	void DrawGridLineV(const PlotterCommand& command, int bandY0, int bandY1);
+	void DrawLineSolid(const PlotterCommand& command, int bandY0, int bandY1);
+
+	static void FillSpan(uint32_t* dest, int count, uint32_t color);
+	static void StreamCopy(uint32_t* dest, const uint32_t* src, int count);
+
+	int mWidth = 0;
+	int mHeight = 0;
+	int mVisibleWidth = 0;
+	int mVisibleHeight = 0;
+	std::vector<uint32_t> mPixels;
+	std::vector<std::vector<int>> mBins;
+	std::shared_ptr<SWWorkerPool> mPool;
+};
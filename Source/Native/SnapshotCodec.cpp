@@ -0,0 +1,427 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "Precomp.h"
+#include "SnapshotCodec.h"
+#include "Backend.h"
+#include <cstring>
+
+// The compressed data is a list of sequences. Each starts with a token byte: the high
+// nibble is the number of literals and the low nibble the match length minus MinMatch.
+// A nibble of 15 is followed by the rest of the length as a 7 bits per byte varint, so
+// that the long matches against a reference stay small. Then come the literals,
+// followed by the match distance, also as a varint. The distance is counted back from
+// the current position and may reach into the reference. The last sequence only has literals, which is how the decoder knows
+// to stop.
+
+namespace
+{
+	const size_t MinMatch = 4;
+
+	// Matches are not searched for this close to the end of the data
+	const size_t EndMargin = 8;
+
+	inline uint32_t Read32(const uint8_t* p)
+	{
+		uint32_t v;
+		memcpy(&v, p, sizeof(uint32_t));
+		return v;
+	}
+
+	inline uint32_t Hash(uint32_t v, int bits)
+	{
+		return (v * 2654435761u) >> (32 - bits);
+	}
+
+	// Length of the match between a and b, where b comes after a and end is the end of the data
+	inline size_t MatchLength(const uint8_t* a, const uint8_t* b, const uint8_t* end)
+	{
+		const uint8_t* start = b;
+		while (b + sizeof(uint32_t) <= end && Read32(a) == Read32(b))
+		{
+			a += sizeof(uint32_t);
+			b += sizeof(uint32_t);
+		}
+		while (b < end && *a == *b)
+		{
+			a++;
+			b++;
+		}
+		return b - start;
+	}
+
+	inline size_t VarintSize(size_t value)
+	{
+		size_t size = 1;
+		while (value >= 0x80)
+		{
+			value >>= 7;
+			size++;
+		}
+		return size;
+	}
+
+	void WriteVarint(uint8_t*& dst, size_t value)
+	{
+		while (value >= 0x80)
+		{
+			*dst++ = (uint8_t)(value | 0x80);
+			value >>= 7;
+		}
+		*dst++ = (uint8_t)value;
+	}
+
+	// Number of bytes WriteSequence writes
+	inline size_t SequenceSize(size_t literalcount, size_t matchlength, size_t distance)
+	{
+		size_t size = 1 + literalcount;
+		if (literalcount >= 15)
+			size += VarintSize(literalcount - 15);
+		if (matchlength != 0)
+		{
+			size += VarintSize(distance);
+			if (matchlength - MinMatch >= 15)
+				size += VarintSize(matchlength - MinMatch - 15);
+		}
+		return size;
+	}
+
+	// Returns false without writing anything when the sequence doesn't fit before dstend
+	bool WriteSequence(uint8_t*& dst, uint8_t* dstend, const uint8_t* literals, size_t literalcount, size_t matchlength, size_t distance)
+	{
+		if (SequenceSize(literalcount, matchlength, distance) > (size_t)(dstend - dst))
+			return false;
+
+		uint8_t* token = dst++;
+		size_t matchcode = (matchlength != 0) ? matchlength - MinMatch : 0;
+		*token = (uint8_t)((std::min(literalcount, (size_t)15) << 4) | std::min(matchcode, (size_t)15));
+
+		if (literalcount >= 15)
+			WriteVarint(dst, literalcount - 15);
+		if (literalcount != 0)
+			memcpy(dst, literals, literalcount);
+		dst += literalcount;
+
+		if (matchlength != 0)
+		{
+			WriteVarint(dst, distance);
+			if (matchcode >= 15)
+				WriteVarint(dst, matchcode - 15);
+		}
+		return true;
+	}
+
+	// Writes all data as literals, which is what the compressor falls back to when the compressed data doesn't fit
+	size_t StoreLiterals(const uint8_t* src, size_t srcsize, uint8_t* dst, size_t dstsize)
+	{
+		uint8_t* out = dst;
+		if (!WriteSequence(out, dst + dstsize, src, srcsize, 0, 0))
+			return 0;
+		return out - dst;
+	}
+
+	bool ReadVarint(const uint8_t*& src, const uint8_t* srcend, size_t& value)
+	{
+		value = 0;
+		for (int shift = 0; shift < 64; shift += 7)
+		{
+			if (src == srcend)
+				return false;
+			uint8_t v = *src++;
+			value |= (size_t)(v & 0x7f) << shift;
+			if ((v & 0x80) == 0)
+				return true;
+		}
+		return false;
+	}
+}
+
+size_t SnapshotCompressBound(size_t srcsize)
+{
+	// A match is only used when its whole sequence, including the token and the varints, is no
+	// larger than the data it covers. That leaves the last sequence, which in the worst case
+	// holds all data as literals.
+	return SequenceSize(srcsize, 0, 0);
+}
+
+size_t SnapshotCompress(const uint8_t* src, size_t srcsize, const uint8_t* reference, size_t referencesize, uint8_t* dst, size_t dstsize)
+{
+	// Put the reference right before the data so that matches can simply look back into it
+	std::vector<uint8_t> window;
+	const uint8_t* base = src;
+	if (referencesize != 0)
+	{
+		window.resize(referencesize + srcsize);
+		memcpy(window.data(), reference, referencesize);
+		if (srcsize != 0)
+			memcpy(window.data() + referencesize, src, srcsize);
+		base = window.data();
+	}
+
+	size_t start = referencesize;
+	size_t end = referencesize + srcsize;
+
+	int hashbits = 12;
+	while (hashbits < 20 && ((size_t)1 << hashbits) < end)
+		hashbits++;
+	std::vector<uint32_t> table((size_t)1 << hashbits);
+
+	for (size_t i = 0; i + MinMatch <= start; i++)
+		table[Hash(Read32(base + i), hashbits)] = (uint32_t)i;
+
+	uint8_t* out = dst;
+	uint8_t* outend = dst + dstsize;
+	size_t anchor = start;
+	size_t pos = start;
+	size_t misses = 0;
+
+	// Besides the hash table candidate, try the distances of the last two matches and the
+	// same position in the reference. When a snapshot is compressed against an older one,
+	// most of the data is found at one of those, while the hash table tends to find the
+	// short repeats within the records.
+	size_t repeats[3] = { 0, 0, referencesize };
+
+	while (pos + EndMargin <= end)
+	{
+		const uint8_t* cur = base + pos;
+		uint32_t v = Read32(cur);
+		uint32_t h = Hash(v, hashbits);
+		size_t candidate = table[h];
+		table[h] = (uint32_t)pos;
+
+		// Take the longest of the candidates
+		size_t match = 0;
+		size_t length = 0;
+		for (size_t distance : repeats)
+		{
+			if (distance != 0 && distance <= pos && Read32(cur - distance) == v)
+			{
+				size_t len = MatchLength(cur - distance, cur, base + end);
+				if (len > length)
+				{
+					match = pos - distance;
+					length = len;
+				}
+			}
+		}
+		if (candidate < pos && Read32(base + candidate) == v)
+		{
+			size_t len = MatchLength(base + candidate, cur, base + end);
+			if (len > length)
+			{
+				match = candidate;
+				length = len;
+			}
+		}
+
+		if (length == 0)
+		{
+			pos += 1 + (misses++ >> 6);
+			continue;
+		}
+
+		// Extend the match backwards into the pending literals
+		size_t matchpos = pos;
+		while (matchpos > anchor && match > 0 && base[matchpos - 1] == base[match - 1])
+		{
+			matchpos--;
+			match--;
+			length++;
+		}
+
+		// Splitting the literals for the match costs a token and varints. Skip the match when they
+		// are larger than the match, so that compressed data is never larger than SnapshotCompressBound.
+		size_t distance = matchpos - match;
+		size_t literalcount = matchpos - anchor;
+		if (SequenceSize(literalcount, length, distance) > literalcount + length)
+		{
+			pos++;
+			misses++;
+			continue;
+		}
+
+		if (!WriteSequence(out, outend, base + anchor, literalcount, length, distance))
+			return StoreLiterals(src, srcsize, dst, dstsize);
+		if (distance != repeats[0])
+		{
+			repeats[1] = repeats[0];
+			repeats[0] = distance;
+		}
+		misses = 0;
+
+		pos = matchpos + length;
+		anchor = pos;
+		if (pos + 2 <= end)
+			table[Hash(Read32(base + pos - 2), hashbits)] = (uint32_t)(pos - 2);
+	}
+
+	if (!WriteSequence(out, outend, base + anchor, end - anchor, 0, 0))
+		return StoreLiterals(src, srcsize, dst, dstsize);
+	return out - dst;
+}
+
+bool SnapshotDecompress(const uint8_t* src, size_t srcsize, const uint8_t* reference, size_t referencesize, uint8_t* dst, size_t dstsize)
+{
+	const uint8_t* srcend = src + srcsize;
+	uint8_t* out = dst;
+	uint8_t* outend = dst + dstsize;
+	while (true)
+	{
+		if (src == srcend)
+		{
+			SetError("Compressed snapshot data is truncated");
+			return false;
+		}
+
+		uint8_t token = *src++;
+		size_t literalcount = token >> 4;
+		if (literalcount == 15)
+		{
+			size_t extra;
+			if (!ReadVarint(src, srcend, extra) || extra > dstsize)
+			{
+				SetError("Compressed snapshot data is corrupt");
+				return false;
+			}
+			literalcount += extra;
+		}
+
+		if (literalcount > (size_t)(srcend - src) || literalcount > (size_t)(outend - out))
+		{
+			SetError("Compressed snapshot data is corrupt");
+			return false;
+		}
+		if (literalcount != 0)
+			memcpy(out, src, literalcount);
+		src += literalcount;
+		out += literalcount;
+
+		if (src == srcend)
+			break;
+
+		size_t distance;
+		if (!ReadVarint(src, srcend, distance))
+		{
+			SetError("Compressed snapshot data is corrupt");
+			return false;
+		}
+
+		size_t length = token & 15;
+		if (length == 15)
+		{
+			size_t extra;
+			if (!ReadVarint(src, srcend, extra) || extra > dstsize)
+			{
+				SetError("Compressed snapshot data is corrupt");
+				return false;
+			}
+			length += extra;
+		}
+		length += MinMatch;
+
+		size_t pos = out - dst;
+		if (distance == 0 || distance > pos + referencesize || length > (size_t)(outend - out))
+		{
+			SetError("Compressed snapshot data is corrupt");
+			return false;
+		}
+
+		// The part of the match that lies in the reference
+		if (distance > pos)
+		{
+			size_t refpos = referencesize - (distance - pos);
+			size_t count = std::min(length, referencesize - refpos);
+			memcpy(out, reference + refpos, count);
+			out += count;
+			length -= count;
+		}
+
+		const uint8_t* match = out - distance;
+		if (distance >= length)
+		{
+			memcpy(out, match, length);
+			out += length;
+		}
+		else
+		{
+			// Overlapping match, which repeats the last distance bytes
+			for (size_t i = 0; i < length; i++)
+				out[i] = match[i];
+			out += length;
+		}
+	}
+
+	if (out != outend)
+	{
+		SetError("Compressed snapshot data has the wrong size");
+		return false;
+	}
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+extern "C"
+{
+
+int SnapshotCodec_CompressBound(int size)
+{
+	return (int)SnapshotCompressBound(size);
+}
+
+bool SnapshotCodec_Compress(const uint8_t* src, int srcsize, const uint8_t* reference, int referencesize, uint8_t* dst, int dstsize, int* written)
+{
+	*written = 0;
+	if (srcsize < 0 || referencesize < 0 || (size_t)srcsize + (size_t)referencesize > 0x7fffffff || (!src && srcsize != 0) || (!reference && referencesize != 0))
+	{
+		SetError("Invalid snapshot compression input");
+		return false;
+	}
+	if (dstsize < 0 || (!dst && dstsize != 0))
+	{
+		SetError("Invalid snapshot compression buffer");
+		return false;
+	}
+
+	size_t size = SnapshotCompress(src, srcsize, reference, referencesize, dst, dstsize);
+	if (size == 0)
+	{
+		SetError("Snapshot compression buffer is too small");
+		return false;
+	}
+
+	*written = (int)size;
+	return true;
+}
+
+bool SnapshotCodec_Decompress(const uint8_t* src, int srcsize, const uint8_t* reference, int referencesize, uint8_t* dst, int dstsize)
+{
+	if (srcsize < 0 || referencesize < 0 || dstsize < 0 || (!src && srcsize != 0) || (!reference && referencesize != 0) || (!dst && dstsize != 0))
+	{
+		SetError("Invalid snapshot decompression input");
+		return false;
+	}
+
+	return SnapshotDecompress(src, srcsize, reference, referencesize, dst, dstsize);
+}
+
+}
@@ -0,0 +1,40 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#pragma once
+
+// Fast LZ compression in the spirit of LZ4, used for undo snapshots and map backups.
+//
+// Matches may reach back into an optional reference buffer as if it came right before
+// the data. Compressing a snapshot against a previous one that is mostly the same makes
+// it cost little more than its changes. Decompression needs the exact same reference.
+
+// Worst case size of the compressed data
+size_t SnapshotCompressBound(size_t srcsize);
+
+// Compresses src into dst. Returns the number of bytes written, or 0 when dstsize is too small.
+// Nothing past dstsize is written, and SnapshotCompressBound(srcsize) bytes are always enough.
+size_t SnapshotCompress(const uint8_t* src, size_t srcsize, const uint8_t* reference, size_t referencesize, uint8_t* dst, size_t dstsize);
+
+// Decompresses data made by SnapshotCompress. Fails when the data is corrupt or
+// doesn't decompress to exactly dstsize bytes.
+bool SnapshotDecompress(const uint8_t* src, size_t srcsize, const uint8_t* reference, size_t referencesize, uint8_t* dst, size_t dstsize);
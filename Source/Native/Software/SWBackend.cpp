@@ -0,0 +1,164 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "Precomp.h"
+#include "SWBackend.h"
+#include "SWRenderDevice.h"
+#include "SWVertexBuffer.h"
+#include "SWIndexBuffer.h"
+#include "SWTexture.h"
+
+SWBackend::~SWBackend()
+{
+	ProcessDeleteList();
+}
+
+RenderDevice* SWBackend::NewRenderDevice(void* disp, void* window, bool debug)
+{
+	SWRenderDevice* device = new SWRenderDevice(this, disp, window);
+	if (!device->IsValid())
+	{
+		delete device;
+		return nullptr;
+	}
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	mDevices.push_back(device);
+	return device;
+}
+
+RenderDevice* SWBackend::NewOffscreenRenderDevice(int width, int height, bool debug)
+{
+	SWRenderDevice* device = new SWRenderDevice(this, width, height);
+	if (!device->IsValid())
+	{
+		delete device;
+		return nullptr;
+	}
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	mDevices.push_back(device);
+	return device;
+}
+
+void SWBackend::DeleteRenderDevice(RenderDevice* device)
+{
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		mDevices.remove(static_cast<SWRenderDevice*>(device));
+	}
+	delete device;
+	ProcessDeleteList();
+}
+
+VertexBuffer* SWBackend::NewVertexBuffer()
+{
+	return new SWVertexBuffer();
+}
+
+void SWBackend::DeleteVertexBuffer(VertexBuffer* buffer)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	if (mDevices.empty())
+	{
+		lock.unlock();
+		delete buffer;
+	}
+	else
+	{
+		mDeletedVertexBuffers.push_back(buffer);
+	}
+}
+
+IndexBuffer* SWBackend::NewIndexBuffer()
+{
+	return new SWIndexBuffer();
+}
+
+void SWBackend::DeleteIndexBuffer(IndexBuffer* buffer)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	if (mDevices.empty())
+	{
+		lock.unlock();
+		delete buffer;
+	}
+	else
+	{
+		mDeletedIndexBuffers.push_back(buffer);
+	}
+}
+
+Texture* SWBackend::NewTexture()
+{
+	return new SWTexture();
+}
+
+void SWBackend::DeleteTexture(Texture* texture)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	if (mDevices.empty())
+	{
+		lock.unlock();
+		delete texture;
+	}
+	else
+	{
+		mDeletedTextures.push_back(texture);
+	}
+}
+
+void SWBackend::ProcessDeleteList()
+{
+	std::vector<VertexBuffer*> vertexBuffers;
+	std::vector<IndexBuffer*> indexBuffers;
+	std::vector<Texture*> textures;
+	std::list<SWRenderDevice*> devices;
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		vertexBuffers.swap(mDeletedVertexBuffers);
+		indexBuffers.swap(mDeletedIndexBuffers);
+		textures.swap(mDeletedTextures);
+		devices = mDevices;
+	}
+
+	for (VertexBuffer* buffer : vertexBuffers)
+	{
+		for (SWRenderDevice* device : devices)
+			device->ForgetObject(buffer);
+		delete buffer;
+	}
+
+	for (IndexBuffer* buffer : indexBuffers)
+	{
+		for (SWRenderDevice* device : devices)
+			device->ForgetObject(buffer);
+		delete buffer;
+	}
+
+	for (Texture* texture : textures)
+	{
+		for (SWRenderDevice* device : devices)
+			device->ForgetObject(texture);
+		delete texture;
+	}
+}
@@ -0,0 +1,707 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "Precomp.h"
+#include "SWRasterizer.h"
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SW_USE_SSE2
+#endif
+
+namespace
+{
+	std::weak_ptr<SWWorkerPool> SharedPool;
+	std::mutex SharedPoolMutex;
+
+	// The pool whose task the current thread is running, to run nested calls inline instead of deadlocking
+	thread_local SWWorkerPool* CurrentPool = nullptr;
+}
+
+std::shared_ptr<SWWorkerPool> SWWorkerPool::GetShared()
+{
+	std::unique_lock<std::mutex> lock(SharedPoolMutex);
+	std::shared_ptr<SWWorkerPool> pool = SharedPool.lock();
+	if (!pool)
+	{
+		pool = std::make_shared<SWWorkerPool>();
+		SharedPool = pool;
+	}
+	return pool;
+}
+
+SWWorkerPool::SWWorkerPool() : mNext(0)
+{
+	int count = (int)std::thread::hardware_concurrency() - 1;
+	count = std::min(std::max(count, 0), 15);
+	for (int i = 0; i < count; i++)
+		mThreads.push_back(std::thread([this]() { WorkerMain(); }));
+}
+
+SWWorkerPool::~SWWorkerPool()
+{
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		mStop = true;
+	}
+	mWakeCondition.notify_all();
+	for (std::thread& thread : mThreads)
+		thread.join();
+}
+
+void SWWorkerPool::Run(int count, const std::function<void(int)>& task)
+{
+	if (count <= 1 || mThreads.empty() || CurrentPool == this)
+	{
+		for (int i = 0; i < count; i++)
+			task(i);
+		return;
+	}
+
+	std::unique_lock<std::mutex> runlock(mRunMutex);
+	RunLocked(count, task);
+}
+
+void SWWorkerPool::RunOrInline(int count, const std::function<void(int)>& task)
+{
+	std::unique_lock<std::mutex> runlock;
+	if (CurrentPool != this)
+		runlock = std::unique_lock<std::mutex>(mRunMutex, std::try_to_lock);
+
+	if (count <= 1 || mThreads.empty() || !runlock.owns_lock())
+	{
+		for (int i = 0; i < count; i++)
+			task(i);
+		return;
+	}
+
+	RunLocked(count, task);
+}
+
+void SWWorkerPool::RunLocked(int count, const std::function<void(int)>& task)
+{
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		mTask = &task;
+		mCount = count;
+		mNext.store(0);
+		mBusy = (int)mThreads.size();
+		mGeneration++;
+	}
+	mWakeCondition.notify_all();
+
+	Work();
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	mDoneCondition.wait(lock, [&]() { return mBusy == 0; });
+	mTask = nullptr;
+}
+
+void SWWorkerPool::WorkerMain()
+{
+	uint64_t generation = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWakeCondition.wait(lock, [&]() { return mStop || mGeneration != generation; });
+			if (mStop)
+				return;
+			generation = mGeneration;
+		}
+
+		Work();
+
+		std::unique_lock<std::mutex> lock(mMutex);
+		if (--mBusy == 0)
+			mDoneCondition.notify_one();
+	}
+}
+
+void SWWorkerPool::Work()
+{
+	SWWorkerPool* previous = CurrentPool;
+	CurrentPool = this;
+	while (true)
+	{
+		int index = mNext.fetch_add(1);
+		if (index >= mCount)
+			break;
+		(*mTask)(index);
+	}
+	CurrentPool = previous;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+	// Below this many covered bounding box pixels a draw is rasterized on the calling thread
+	const int64_t ParallelAreaThreshold = 16384;
+
+	const int MaxClipVertices = 9;
+
+	// Clip space planes as (x, y, z, w) dot products that must be positive: left, right, bottom, top, near, far
+	const float ClipPlanes[6][4] =
+	{
+		{ 1.0f, 0.0f, 0.0f, 1.0f },
+		{ -1.0f, 0.0f, 0.0f, 1.0f },
+		{ 0.0f, 1.0f, 0.0f, 1.0f },
+		{ 0.0f, -1.0f, 0.0f, 1.0f },
+		{ 0.0f, 0.0f, 1.0f, 1.0f },
+		{ 0.0f, 0.0f, -1.0f, 1.0f }
+	};
+
+	inline float ClipDistance(const SWVertexOutput& v, int plane)
+	{
+		const float* p = ClipPlanes[plane];
+		return v.clip[0] * p[0] + v.clip[1] * p[1] + v.clip[2] * p[2] + v.clip[3] * p[3];
+	}
+
+	void Lerp(SWVertexOutput& dest, const SWVertexOutput& a, const SWVertexOutput& b, float t, int varyingCount)
+	{
+		for (int i = 0; i < 4; i++)
+			dest.clip[i] = a.clip[i] + (b.clip[i] - a.clip[i]) * t;
+		for (int i = 0; i < varyingCount; i++)
+			dest.varyings[i] = a.varyings[i] + (b.varyings[i] - a.varyings[i]) * t;
+	}
+
+	// Snaps to 8 bits of subpixel precision, like the hardware rasterizers do
+	inline float Snap(float v) { return std::round(v * 256.0f) * (1.0f / 256.0f); }
+
+	inline float Clamp01(float v) { return std::min(std::max(v, 0.0f), 1.0f); }
+
+	inline float BlendFactor(Blend blend, float srcAlpha)
+	{
+		switch (blend)
+		{
+		default:
+		case Blend::InverseSourceAlpha: return 1.0f - srcAlpha;
+		case Blend::SourceAlpha: return srcAlpha;
+		case Blend::One: return 1.0f;
+		}
+	}
+
+	inline uint32_t ToBgra8(const SWVec4& c)
+	{
+		uint32_t r = (uint32_t)(Clamp01(c.x) * 255.0f + 0.5f);
+		uint32_t g = (uint32_t)(Clamp01(c.y) * 255.0f + 0.5f);
+		uint32_t b = (uint32_t)(Clamp01(c.z) * 255.0f + 0.5f);
+		uint32_t a = (uint32_t)(Clamp01(c.w) * 255.0f + 0.5f);
+		return (a << 24) | (r << 16) | (g << 8) | b;
+	}
+
+	struct WindowVertex
+	{
+		float X, Y, Z, InvW;
+		const float* Varyings;
+	};
+
+	SWRasterizer::Plane PlaneFrom(const WindowVertex* v, float f0, float f1, float f2)
+	{
+		float dx1 = v[1].X - v[0].X, dy1 = v[1].Y - v[0].Y;
+		float dx2 = v[2].X - v[0].X, dy2 = v[2].Y - v[0].Y;
+		float det = dx1 * dy2 - dx2 * dy1;
+		SWRasterizer::Plane plane;
+		plane.A = ((f1 - f0) * dy2 - (f2 - f0) * dy1) / det;
+		plane.B = ((f2 - f0) * dx1 - (f1 - f0) * dx2) / det;
+		plane.C = f0 - plane.A * v[0].X - plane.B * v[0].Y;
+		return plane;
+	}
+}
+
+void SWRasterizer::DrawTriangles(const SWRasterState& state, const SWRenderTarget& target, const SWShadeContext& ctx, const SWVertexOutput* vertices, size_t count)
+{
+	if (!target.Color || target.Width <= 0 || target.Height <= 0)
+		return;
+
+	if (state.Fill == FillMode::Wireframe)
+	{
+		std::vector<SWVertexOutput> lines;
+		lines.reserve(count * 2);
+		for (size_t i = 0; i + 2 < count; i += 3)
+		{
+			const SWVertexOutput* v = vertices + i;
+
+			// Face orientation from the homogeneous determinant. Only trusted when all vertices are in front of the eye.
+			if (state.CullMode == Cull::Clockwise && v[0].clip[3] > 0.0f && v[1].clip[3] > 0.0f && v[2].clip[3] > 0.0f)
+			{
+				float det =
+					v[0].clip[0] * (v[1].clip[1] * v[2].clip[3] - v[2].clip[1] * v[1].clip[3]) -
+					v[1].clip[0] * (v[0].clip[1] * v[2].clip[3] - v[2].clip[1] * v[0].clip[3]) +
+					v[2].clip[0] * (v[0].clip[1] * v[1].clip[3] - v[1].clip[1] * v[0].clip[3]);
+				if (det > 0.0f)
+					continue;
+			}
+
+			for (int e = 0; e < 3; e++)
+			{
+				lines.push_back(v[e]);
+				lines.push_back(v[(e + 1) % 3]);
+				memcpy(lines.back().flat, v[2].flat, sizeof(v[2].flat));
+			}
+		}
+		DrawLines(state, target, ctx, lines.data(), lines.size());
+		return;
+	}
+
+	mState = state;
+	mTarget = target;
+	mContext = &ctx;
+	mVaryingCount = ctx.Program.VaryingCount;
+
+	mTriangles.clear();
+	for (size_t i = 0; i + 2 < count; i += 3)
+	{
+		const SWVertexOutput* v = vertices + i;
+
+		bool inside = true;
+		for (int plane = 0; plane < 6 && inside; plane++)
+			inside = ClipDistance(v[0], plane) >= 0.0f && ClipDistance(v[1], plane) >= 0.0f && ClipDistance(v[2], plane) >= 0.0f;
+
+		if (inside)
+		{
+			SetupClippedTriangle(state, target, mVaryingCount, v, v + 1, v + 2);
+			continue;
+		}
+
+		// Sutherland-Hodgman against the view frustum
+		SWVertexOutput buffers[2][MaxClipVertices];
+		int counts[2] = { 3, 0 };
+		for (int j = 0; j < 3; j++)
+			buffers[0][j] = v[j];
+
+		int src = 0;
+		for (int plane = 0; plane < 6 && counts[src] >= 3; plane++)
+		{
+			int dst = 1 - src;
+			counts[dst] = 0;
+			for (int j = 0; j < counts[src]; j++)
+			{
+				const SWVertexOutput& a = buffers[src][j];
+				const SWVertexOutput& b = buffers[src][(j + 1) % counts[src]];
+				float da = ClipDistance(a, plane);
+				float db = ClipDistance(b, plane);
+				if (da >= 0.0f)
+					buffers[dst][counts[dst]++] = a;
+				if ((da >= 0.0f) != (db >= 0.0f) && counts[dst] < MaxClipVertices)
+					Lerp(buffers[dst][counts[dst]++], a, b, da / (da - db), mVaryingCount);
+			}
+			src = dst;
+		}
+
+		for (int j = 1; j + 1 < counts[src]; j++)
+		{
+			memcpy(buffers[src][j + 1].flat, v[2].flat, sizeof(v[2].flat));
+			SetupClippedTriangle(state, target, mVaryingCount, &buffers[src][0], &buffers[src][j], &buffers[src][j + 1]);
+		}
+	}
+
+	if (mTriangles.empty())
+		return;
+
+	int64_t area = 0;
+	for (const SetupTriangle& tri : mTriangles)
+		area += (int64_t)(tri.MaxX - tri.MinX + 1) * (tri.MaxY - tri.MinY + 1);
+
+	RunBands(target, area, [&](int y0, int y1)
+	{
+		for (const SetupTriangle& tri : mTriangles)
+		{
+			if (tri.MaxY >= y0 && tri.MinY < y1)
+				RasterizeTriangle(tri, y0, y1);
+		}
+	});
+
+	mContext = nullptr;
+}
+
+void SWRasterizer::SetupClippedTriangle(const SWRasterState& state, const SWRenderTarget& target, int varyingCount, const SWVertexOutput* v0, const SWVertexOutput* v1, const SWVertexOutput* v2)
+{
+	const SWVertexOutput* src[3] = { v0, v1, v2 };
+	WindowVertex v[3];
+	for (int i = 0; i < 3; i++)
+	{
+		float invw = 1.0f / src[i]->clip[3];
+		v[i].X = Snap((src[i]->clip[0] * invw * 0.5f + 0.5f) * target.Width);
+		v[i].Y = Snap((src[i]->clip[1] * invw * 0.5f + 0.5f) * target.Height);
+		v[i].Z = src[i]->clip[2] * invw * 0.5f + 0.5f;
+		v[i].InvW = invw;
+		v[i].Varyings = src[i]->varyings;
+		if (!std::isfinite(v[i].X) || !std::isfinite(v[i].Y) || !std::isfinite(v[i].Z))
+			return;
+	}
+
+	// Positive area is counter-clockwise with y pointing up. The OpenGL backend treats clockwise as the front face.
+	float area = (v[1].X - v[0].X) * (v[2].Y - v[0].Y) - (v[2].X - v[0].X) * (v[1].Y - v[0].Y);
+	if (area == 0.0f || (state.CullMode == Cull::Clockwise && area > 0.0f))
+		return;
+	if (area < 0.0f)
+		std::swap(v[1], v[2]);
+
+	SetupTriangle tri;
+	tri.MinX = std::max((int)std::floor(std::min(std::min(v[0].X, v[1].X), v[2].X)), 0);
+	tri.MinY = std::max((int)std::floor(std::min(std::min(v[0].Y, v[1].Y), v[2].Y)), 0);
+	tri.MaxX = std::min((int)std::ceil(std::max(std::max(v[0].X, v[1].X), v[2].X)), target.Width - 1);
+	tri.MaxY = std::min((int)std::ceil(std::max(std::max(v[0].Y, v[1].Y), v[2].Y)), target.Height - 1);
+	if (tri.MinX > tri.MaxX || tri.MinY > tri.MaxY)
+		return;
+
+	for (int i = 0; i < 3; i++)
+	{
+		const WindowVertex& a = v[i];
+		const WindowVertex& b = v[(i + 1) % 3];
+		float dx = b.X - a.X;
+		float dy = b.Y - a.Y;
+		tri.Edge[i].A = -dy;
+		tri.Edge[i].B = dx;
+		tri.Edge[i].C = dy * a.X - dx * a.Y;
+		tri.TopLeft[i] = dy < 0.0f || (dy == 0.0f && dx < 0.0f);
+	}
+
+	tri.Z = PlaneFrom(v, v[0].Z, v[1].Z, v[2].Z);
+	tri.InvW = PlaneFrom(v, v[0].InvW, v[1].InvW, v[2].InvW);
+	for (int i = 0; i < varyingCount; i++)
+		tri.Varyings[i] = PlaneFrom(v, v[0].Varyings[i] * v[0].InvW, v[1].Varyings[i] * v[1].InvW, v[2].Varyings[i] * v[2].InvW);
+	memcpy(tri.Flat, v2->flat, sizeof(tri.Flat));
+
+	mTriangles.push_back(tri);
+}
+
+void SWRasterizer::RasterizeTriangle(const SetupTriangle& tri, int y0, int y1)
+{
+	int ystart = std::max(tri.MinY, y0);
+	int yend = std::min(tri.MaxY + 1, y1);
+	bool depthTest = mState.DepthTest && mTarget.Depth;
+	float varyings[SWMaxVaryings];
+
+#ifdef SW_USE_SSE2
+	const __m128 laneOffset = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 xlimit = _mm_set1_ps((float)(tri.MaxX + 1));
+	__m128 topLeft[3];
+	for (int i = 0; i < 3; i++)
+		topLeft[i] = tri.TopLeft[i] ? _mm_castsi128_ps(_mm_set1_epi32(-1)) : zero;
+
+	for (int y = ystart; y < yend; y++)
+	{
+		float fy = y + 0.5f;
+		__m128 edgeA[3], edgeRow[3];
+		for (int i = 0; i < 3; i++)
+		{
+			edgeA[i] = _mm_set1_ps(tri.Edge[i].A);
+			edgeRow[i] = _mm_set1_ps(tri.Edge[i].B * fy + tri.Edge[i].C);
+		}
+		__m128 zA = _mm_set1_ps(tri.Z.A);
+		__m128 zRow = _mm_set1_ps(tri.Z.B * fy + tri.Z.C);
+		float* depthRow = depthTest ? mTarget.Depth + (size_t)y * mTarget.Width : nullptr;
+
+		for (int x = tri.MinX; x <= tri.MaxX; x += 4)
+		{
+			__m128 fx = _mm_add_ps(_mm_set1_ps((float)x), laneOffset);
+			__m128 mask = _mm_cmplt_ps(fx, xlimit);
+			for (int i = 0; i < 3; i++)
+			{
+				__m128 e = _mm_add_ps(_mm_mul_ps(edgeA[i], fx), edgeRow[i]);
+				__m128 inside = _mm_or_ps(_mm_cmpgt_ps(e, zero), _mm_and_ps(_mm_cmpeq_ps(e, zero), topLeft[i]));
+				mask = _mm_and_ps(mask, inside);
+			}
+			int bits = _mm_movemask_ps(mask);
+			if (bits == 0)
+				continue;
+
+			__m128 z = _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_mul_ps(zA, fx), zRow), zero), one);
+			if (depthTest)
+			{
+				__m128 depth;
+				if (x + 4 <= mTarget.Width)
+				{
+					depth = _mm_loadu_ps(depthRow + x);
+				}
+				else
+				{
+					float tail[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+					for (int i = 0; x + i < mTarget.Width; i++)
+						tail[i] = depthRow[x + i];
+					depth = _mm_loadu_ps(tail);
+				}
+				bits &= _mm_movemask_ps(_mm_cmple_ps(z, depth));
+				if (bits == 0)
+					continue;
+			}
+
+			float zvalues[4];
+			_mm_storeu_ps(zvalues, z);
+			for (int lane = 0; lane < 4; lane++)
+			{
+				if (bits & (1 << lane))
+				{
+					float px = x + lane + 0.5f;
+					float w = 1.0f / tri.InvW.Eval(px, fy);
+					for (int i = 0; i < mVaryingCount; i++)
+						varyings[i] = tri.Varyings[i].Eval(px, fy) * w;
+					ShadePixel(x + lane, y, zvalues[lane], varyings, tri.Flat);
+				}
+			}
+		}
+	}
+#else
+	for (int y = ystart; y < yend; y++)
+	{
+		float fy = y + 0.5f;
+		for (int x = tri.MinX; x <= tri.MaxX; x++)
+		{
+			float px = x + 0.5f;
+			bool inside = true;
+			for (int i = 0; i < 3 && inside; i++)
+			{
+				float e = tri.Edge[i].Eval(px, fy);
+				inside = e > 0.0f || (e == 0.0f && tri.TopLeft[i]);
+			}
+			if (!inside)
+				continue;
+
+			float z = Clamp01(tri.Z.Eval(px, fy));
+			if (depthTest && z > mTarget.Depth[(size_t)y * mTarget.Width + x])
+				continue;
+
+			float w = 1.0f / tri.InvW.Eval(px, fy);
+			for (int i = 0; i < mVaryingCount; i++)
+				varyings[i] = tri.Varyings[i].Eval(px, fy) * w;
+			ShadePixel(x, y, z, varyings, tri.Flat);
+		}
+	}
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+void SWRasterizer::DrawLines(const SWRasterState& state, const SWRenderTarget& target, const SWShadeContext& ctx, const SWVertexOutput* vertices, size_t count)
+{
+	if (!target.Color || target.Width <= 0 || target.Height <= 0)
+		return;
+
+	mState = state;
+	mTarget = target;
+	mContext = &ctx;
+	mVaryingCount = ctx.Program.VaryingCount;
+
+	mLines.clear();
+	for (size_t i = 0; i + 1 < count; i += 2)
+	{
+		// Liang-Barsky against the view frustum
+		const SWVertexOutput& a = vertices[i];
+		const SWVertexOutput& b = vertices[i + 1];
+		float t0 = 0.0f, t1 = 1.0f;
+		bool visible = true;
+		for (int plane = 0; plane < 6 && visible; plane++)
+		{
+			float da = ClipDistance(a, plane);
+			float db = ClipDistance(b, plane);
+			if (da < 0.0f && db < 0.0f)
+				visible = false;
+			else if (da < 0.0f)
+				t0 = std::max(t0, da / (da - db));
+			else if (db < 0.0f)
+				t1 = std::min(t1, da / (da - db));
+		}
+		if (!visible || t0 > t1)
+			continue;
+
+		if (t0 == 0.0f && t1 == 1.0f)
+		{
+			SetupClippedLine(target, mVaryingCount, a, b);
+		}
+		else
+		{
+			SWVertexOutput ca, cb;
+			Lerp(ca, a, b, t0, mVaryingCount);
+			Lerp(cb, a, b, t1, mVaryingCount);
+			memcpy(cb.flat, b.flat, sizeof(b.flat));
+			SetupClippedLine(target, mVaryingCount, ca, cb);
+		}
+	}
+
+	if (mLines.empty())
+		return;
+
+	int64_t length = 0;
+	for (const SetupLine& line : mLines)
+		length += (int64_t)(std::abs(line.X1 - line.X0) + std::abs(line.Y1 - line.Y0));
+
+	RunBands(target, length, [&](int y0, int y1)
+	{
+		for (const SetupLine& line : mLines)
+			RasterizeLine(line, y0, y1);
+	});
+
+	mContext = nullptr;
+}
+
+void SWRasterizer::SetupClippedLine(const SWRenderTarget& target, int varyingCount, const SWVertexOutput& v0, const SWVertexOutput& v1)
+{
+	SetupLine line;
+	line.InvW0 = 1.0f / v0.clip[3];
+	line.InvW1 = 1.0f / v1.clip[3];
+	line.X0 = (v0.clip[0] * line.InvW0 * 0.5f + 0.5f) * target.Width;
+	line.Y0 = (v0.clip[1] * line.InvW0 * 0.5f + 0.5f) * target.Height;
+	line.X1 = (v1.clip[0] * line.InvW1 * 0.5f + 0.5f) * target.Width;
+	line.Y1 = (v1.clip[1] * line.InvW1 * 0.5f + 0.5f) * target.Height;
+	line.Z0 = v0.clip[2] * line.InvW0 * 0.5f + 0.5f;
+	line.Z1 = v1.clip[2] * line.InvW1 * 0.5f + 0.5f;
+	if (!std::isfinite(line.X0) || !std::isfinite(line.Y0) || !std::isfinite(line.X1) || !std::isfinite(line.Y1))
+		return;
+
+	for (int i = 0; i < varyingCount; i++)
+	{
+		line.Varyings0[i] = v0.varyings[i] * line.InvW0;
+		line.Varyings1[i] = v1.varyings[i] * line.InvW1;
+	}
+	memcpy(line.Flat, v1.flat, sizeof(line.Flat));
+	mLines.push_back(line);
+}
+
+void SWRasterizer::RasterizeLine(const SetupLine& line, int y0, int y1)
+{
+	// Steps along the major axis through the pixel centers between the end points. Like OpenGL the last pixel is not drawn.
+	float dx = line.X1 - line.X0;
+	float dy = line.Y1 - line.Y0;
+	bool xmajor = std::abs(dx) >= std::abs(dy);
+	float start = xmajor ? line.X0 : line.Y0;
+	float end = xmajor ? line.X1 : line.Y1;
+	float delta = end - start;
+	if (delta == 0.0f)
+		return;
+
+	int step = delta > 0.0f ? 1 : -1;
+	int first = delta > 0.0f ? (int)std::ceil(start - 0.5f) : (int)std::floor(start - 0.5f);
+	int last = delta > 0.0f ? (int)std::ceil(end - 0.5f) - 1 : (int)std::floor(end - 0.5f) + 1;
+	if ((last - first) * step < 0)
+		return;
+
+	// Restrict the steps to the ones that can land in this band
+	int majorSize = xmajor ? mTarget.Width : mTarget.Height;
+	int lo = std::min(first, last), hi = std::max(first, last);
+	lo = std::max(lo, 0);
+	hi = std::min(hi, majorSize - 1);
+	if (xmajor)
+	{
+		if (dy == 0.0f)
+		{
+			int py = (int)std::floor(line.Y0);
+			if (py < y0 || py >= y1)
+				return;
+		}
+		else
+		{
+			float ta = (y0 - line.Y0) / dy;
+			float tb = (y1 - line.Y0) / dy;
+			float xa = line.X0 + std::min(ta, tb) * dx - 0.5f;
+			float xb = line.X0 + std::max(ta, tb) * dx - 0.5f;
+			if (xa > xb)
+				std::swap(xa, xb);
+			lo = std::max(lo, (int)std::floor(xa) - 1);
+			hi = std::min(hi, (int)std::ceil(xb) + 1);
+		}
+	}
+	else
+	{
+		lo = std::max(lo, y0);
+		hi = std::min(hi, y1 - 1);
+	}
+	if (lo > hi)
+		return;
+
+	bool depthTest = mState.DepthTest && mTarget.Depth;
+	float varyings[SWMaxVaryings];
+	for (int m = lo; m <= hi; m++)
+	{
+		float t = (m + 0.5f - start) / delta;
+		int px, py;
+		if (xmajor)
+		{
+			px = m;
+			py = (int)std::floor(line.Y0 + t * dy);
+		}
+		else
+		{
+			px = (int)std::floor(line.X0 + t * dx);
+			py = m;
+		}
+		if (py < y0 || py >= y1 || px < 0 || px >= mTarget.Width)
+			continue;
+
+		float z = Clamp01(line.Z0 + (line.Z1 - line.Z0) * t);
+		if (depthTest && z > mTarget.Depth[(size_t)py * mTarget.Width + px])
+			continue;
+
+		float w = 1.0f / (line.InvW0 + (line.InvW1 - line.InvW0) * t);
+		for (int i = 0; i < mVaryingCount; i++)
+			varyings[i] = (line.Varyings0[i] + (line.Varyings1[i] - line.Varyings0[i]) * t) * w;
+		ShadePixel(px, py, z, varyings, line.Flat);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+void SWRasterizer::RunBands(const SWRenderTarget& target, int64_t area, const std::function<void(int, int)>& band)
+{
+	int bandCount = (target.Height + BandHeight - 1) / BandHeight;
+	if (area < ParallelAreaThreshold || bandCount <= 1 || mPool.GetThreadCount() == 1)
+	{
+		band(0, target.Height);
+		return;
+	}
+
+	mPool.Run(bandCount, [&](int index)
+	{
+		band(index * BandHeight, std::min((index + 1) * BandHeight, target.Height));
+	});
+}
+
+void SWRasterizer::ShadePixel(int x, int y, float z, const float* varyings, const float* flat)
+{
+	SWVec4 src;
+	if (!SWRunFragmentProgram(*mContext, varyings, flat, src))
+		return;
+
+	size_t offset = (size_t)y * mTarget.Width + x;
+	if (mState.DepthTest && mState.DepthWrite && mTarget.Depth)
+		mTarget.Depth[offset] = z;
+
+	uint32_t& dest = mTarget.Color[offset];
+	if (mState.AlphaBlend)
+	{
+		src = SWVec4(Clamp01(src.x), Clamp01(src.y), Clamp01(src.z), Clamp01(src.w));
+		SWVec4 dst = SWVec4::FromBgra8(dest);
+		float sf = BlendFactor(mState.SourceBlend, src.w);
+		float df = BlendFactor(mState.DestinationBlend, src.w);
+		if (mState.BlendOp == BlendOperation::ReverseSubtract)
+			src = dst * df - src * sf;
+		else
+			src = src * sf + dst * df;
+	}
+	dest = ToBgra8(src);
+}
@@ -0,0 +1,146 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include "SWShaders.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+// Persistent worker threads. The calling thread takes part in the work and Run returns once every task is done.
+class SWWorkerPool
+{
+public:
+	SWWorkerPool();
+	~SWWorkerPool();
+
+	// The pool shared by all native modules other than the software render device.
+	// It is created on first use and stops when the last user lets go of it.
+	static std::shared_ptr<SWWorkerPool> GetShared();
+
+	int GetThreadCount() const { return (int)mThreads.size() + 1; }
+
+	// Waits when another thread is using the pool. Tasks that call Run again run those tasks inline.
+	void Run(int count, const std::function<void(int)>& task);
+
+	// Runs every task on the calling thread instead of waiting when another thread is using the pool
+	void RunOrInline(int count, const std::function<void(int)>& task);
+
+private:
+	void RunLocked(int count, const std::function<void(int)>& task);
+	void WorkerMain();
+	void Work();
+
+	std::vector<std::thread> mThreads;
+	std::mutex mRunMutex; // One caller at a time
+	std::mutex mMutex;
+	std::condition_variable mWakeCondition;
+	std::condition_variable mDoneCondition;
+	uint64_t mGeneration = 0;
+	int mBusy = 0;
+	bool mStop = false;
+
+	const std::function<void(int)>* mTask = nullptr;
+	int mCount = 0;
+	std::atomic<int> mNext;
+};
+
+struct SWRenderTarget
+{
+	uint32_t* Color = nullptr;
+	float* Depth = nullptr;
+	int Width = 0;
+	int Height = 0;
+};
+
+struct SWRasterState
+{
+	Cull CullMode = Cull::None;
+	FillMode Fill = FillMode::Solid;
+	bool DepthTest = false;
+	bool DepthWrite = false;
+	bool AlphaBlend = false;
+	BlendOperation BlendOp = BlendOperation::Add;
+	Blend SourceBlend = Blend::SourceAlpha;
+	Blend DestinationBlend = Blend::InverseSourceAlpha;
+};
+
+// Clips, sets up and rasterizes primitives whose vertices already went through the vertex program.
+// The target is split into horizontal bands that are rasterized in parallel, each band drawing
+// every primitive in submission order, so the result matches a serial rasterizer.
+class SWRasterizer
+{
+public:
+	void DrawTriangles(const SWRasterState& state, const SWRenderTarget& target, const SWShadeContext& ctx, const SWVertexOutput* vertices, size_t count);
+	void DrawLines(const SWRasterState& state, const SWRenderTarget& target, const SWShadeContext& ctx, const SWVertexOutput* vertices, size_t count);
+
+	static const int BandHeight = 32;
+
+	struct Plane
+	{
+		float A, B, C;
+		float Eval(float x, float y) const { return A * x + B * y + C; }
+	};
+
+	struct SetupTriangle
+	{
+		// Edge functions are positive inside. TopLeft edges also own the pixels exactly on them.
+		Plane Edge[3];
+		bool TopLeft[3];
+		int MinX, MinY, MaxX, MaxY;
+		Plane Z;
+		Plane InvW;
+		Plane Varyings[SWMaxVaryings];
+		float Flat[SWFlatCount];
+	};
+
+	struct SetupLine
+	{
+		float X0, Y0, X1, Y1;
+		float Z0, Z1;
+		float InvW0, InvW1;
+		float Varyings0[SWMaxVaryings];
+		float Varyings1[SWMaxVaryings];
+		float Flat[SWFlatCount];
+	};
+
+private:
+	void SetupClippedTriangle(const SWRasterState& state, const SWRenderTarget& target, int varyingCount, const SWVertexOutput* v0, const SWVertexOutput* v1, const SWVertexOutput* v2);
+	void SetupClippedLine(const SWRenderTarget& target, int varyingCount, const SWVertexOutput& v0, const SWVertexOutput& v1);
+	void RunBands(const SWRenderTarget& target, int64_t area, const std::function<void(int, int)>& band);
+
+	void RasterizeTriangle(const SetupTriangle& tri, int y0, int y1);
+	void RasterizeLine(const SetupLine& line, int y0, int y1);
+	void ShadePixel(int x, int y, float z, const float* varyings, const float* flat);
+
+	SWWorkerPool mPool;
+	std::vector<SetupTriangle> mTriangles;
+	std::vector<SetupLine> mLines;
+
+	// Valid for the duration of a draw
+	SWRasterState mState;
+	SWRenderTarget mTarget;
+	const SWShadeContext* mContext = nullptr;
+	int mVaryingCount = 0;
+};
@@ -0,0 +1,712 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "Precomp.h"
+#include "SWRenderDevice.h"
+#include "SWBackend.h"
+#include "SWVertexBuffer.h"
+#include "SWIndexBuffer.h"
+#include <cstring>
+
+namespace
+{
+	bool GetWindowSize(void* disp, void* window, int& width, int& height);
+	bool PresentPixels(void* disp, void* window, const uint32_t* pixels, int width, int height);
+}
+
+SWRenderDevice::SWRenderDevice(SWBackend* backend, void* disp, void* window) : mBackend(backend), mDisp(disp), mWindow(window)
+{
+	mValid = UpdateBackbufferSize();
+}
+
+SWRenderDevice::SWRenderDevice(SWBackend* backend, int width, int height) : mBackend(backend)
+{
+	mBackbuffer.Set2DImage(width, height, PixelFormat::Bgra8);
+	mValid = true;
+}
+
+SWRenderDevice::~SWRenderDevice()
+{
+}
+
+bool SWRenderDevice::UpdateBackbufferSize()
+{
+	if (!mWindow)
+		return true;
+
+	int width = 0, height = 0;
+	if (!GetWindowSize(mDisp, mWindow, width, height))
+		return false;
+
+	width = std::max(width, 1);
+	height = std::max(height, 1);
+	if (width != mBackbuffer.GetWidth() || height != mBackbuffer.GetHeight())
+		mBackbuffer.Set2DImage(width, height, PixelFormat::Bgra8);
+	return true;
+}
+
+void SWRenderDevice::DeclareUniform(UniformName name, const char* glslname, UniformType type)
+{
+	size_t index = (size_t)name;
+	if (mUniformInfo.size() <= index)
+		mUniformInfo.resize(index + 1);
+
+	UniformInfo& info = mUniformInfo[index];
+	info.Used = SWUniforms::FindField(glslname, info.Offset, info.Size);
+}
+
+void SWRenderDevice::DeclareShader(ShaderName index, const char* name, const char* vertexshader, const char* fragmentshader)
+{
+	// The GLSL source is not used. Shaders without a native program fail when they are drawn with.
+	if (mShaders.size() <= (size_t)index)
+		mShaders.resize((size_t)index + 1);
+	mShaders[index] = SWShaderProgram::Find(name);
+}
+
+void SWRenderDevice::SetShader(ShaderName name)
+{
+	mShaderName = name;
+}
+
+void SWRenderDevice::SetUniform(UniformName name, const void* values, int count, int bytesize)
+{
+	if ((size_t)name >= mUniformInfo.size() || !mUniformInfo[name].Used)
+		return;
+
+	const UniformInfo& info = mUniformInfo[name];
+	memcpy(reinterpret_cast<uint8_t*>(&mUniforms) + info.Offset, values, std::min((size_t)bytesize, info.Size));
+}
+
+void SWRenderDevice::SetVertexBuffer(VertexBuffer* buffer)
+{
+	mVertexBuffer = static_cast<SWVertexBuffer*>(buffer);
+}
+
+void SWRenderDevice::SetIndexBuffer(IndexBuffer* buffer)
+{
+	mIndexBuffer = static_cast<SWIndexBuffer*>(buffer);
+}
+
+void SWRenderDevice::SetAlphaBlendEnable(bool value)
+{
+	mRasterState.AlphaBlend = value;
+}
+
+void SWRenderDevice::SetAlphaTestEnable(bool value)
+{
+	mAlphaTest = value;
+}
+
+void SWRenderDevice::SetCullMode(Cull mode)
+{
+	mRasterState.CullMode = mode;
+}
+
+void SWRenderDevice::SetBlendOperation(BlendOperation op)
+{
+	mRasterState.BlendOp = op;
+}
+
+void SWRenderDevice::SetSourceBlend(Blend blend)
+{
+	mRasterState.SourceBlend = blend;
+}
+
+void SWRenderDevice::SetDestinationBlend(Blend blend)
+{
+	mRasterState.DestinationBlend = blend;
+}
+
+void SWRenderDevice::SetFillMode(FillMode mode)
+{
+	mRasterState.Fill = mode;
+}
+
+void SWRenderDevice::SetMultisampleAntialias(bool value)
+{
+}
+
+void SWRenderDevice::SetZEnable(bool value)
+{
+	mRasterState.DepthTest = value;
+}
+
+void SWRenderDevice::SetZWriteEnable(bool value)
+{
+	mRasterState.DepthWrite = value;
+}
+
+void SWRenderDevice::SetTexture(int unit, Texture* texture)
+{
+	mTextureUnit[unit].Tex = static_cast<SWTexture*>(texture);
+}
+
+void SWRenderDevice::SetSamplerFilter(int unit, TextureFilter minfilter, TextureFilter magfilter, MipmapFilter mipfilter, float maxanisotropy)
+{
+	// Textures have no mipmaps here, so the magnification filter is used for both directions
+	mTextureUnit[unit].MagFilter = magfilter;
+}
+
+void SWRenderDevice::SetSamplerState(int unit, TextureAddress address)
+{
+	mTextureUnit[unit].WrapMode = address;
+}
+
+int SWRenderDevice::GetVertexCount(PrimitiveType type, int primitiveCount)
+{
+	static const int toVertexCount[] = { 2, 3, 1 };
+	static const int toVertexStart[] = { 0, 0, 2 };
+	return toVertexStart[(int)type] + primitiveCount * toVertexCount[(int)type];
+}
+
+SWVertexInput SWRenderDevice::ReadVertex(const uint8_t* data, VertexFormat format)
+{
+	SWVertexInput v;
+	if (format == VertexFormat::Flat)
+	{
+		memcpy(&v, data, VertexBuffer::FlatStride);
+		v.nx = 0.0f;
+		v.ny = 0.0f;
+		v.nz = 0.0f;
+	}
+	else
+	{
+		memcpy(&v, data, VertexBuffer::WorldStride);
+	}
+	return v;
+}
+
+bool SWRenderDevice::Draw(PrimitiveType type, int startIndex, int primitiveCount)
+{
+	if (!mVertexBuffer)
+		return true;
+
+	int vertexCount = GetVertexCount(type, primitiveCount);
+	size_t stride = mVertexBuffer->GetStride();
+	if (startIndex < 0 || ((size_t)startIndex + vertexCount) * stride > mVertexBuffer->Data.size())
+	{
+		SetError("Draw call reads past the end of the vertex buffer");
+		return false;
+	}
+
+	const uint8_t* data = mVertexBuffer->Data.data() + startIndex * stride;
+	VertexFormat format = mVertexBuffer->Format;
+	return DrawVertices(type, vertexCount, [&](int i, SWVertexInput& v) { v = ReadVertex(data + i * stride, format); }, nullptr, 1);
+}
+
+bool SWRenderDevice::DrawIndexed(PrimitiveType type, int startIndex, int primitiveCount)
+{
+	if (!mVertexBuffer || !mIndexBuffer)
+		return true;
+
+	int vertexCount = GetVertexCount(type, primitiveCount);
+	if (startIndex < 0 || (size_t)startIndex + vertexCount > mIndexBuffer->Indices.size())
+	{
+		SetError("DrawIndexed call reads past the end of the index buffer");
+		return false;
+	}
+
+	const uint32_t* indices = mIndexBuffer->Indices.data() + startIndex;
+	size_t stride = mVertexBuffer->GetStride();
+	size_t bufferVertexCount = mVertexBuffer->Data.size() / stride;
+	for (int i = 0; i < vertexCount; i++)
+	{
+		if (indices[i] >= bufferVertexCount)
+		{
+			SetError("Index %u is out of range for the vertex buffer", indices[i]);
+			return false;
+		}
+	}
+
+	const uint8_t* data = mVertexBuffer->Data.data();
+	VertexFormat format = mVertexBuffer->Format;
+	return DrawVertices(type, vertexCount, [&](int i, SWVertexInput& v) { v = ReadVertex(data + indices[i] * stride, format); }, nullptr, 1);
+}
+
+bool SWRenderDevice::DrawData(PrimitiveType type, int startIndex, int primitiveCount, const void* data)
+{
+	const uint8_t* vertices = static_cast<const uint8_t*>(data) + startIndex * (size_t)VertexBuffer::FlatStride;
+	return DrawVertices(type, GetVertexCount(type, primitiveCount), [&](int i, SWVertexInput& v) { v = ReadVertex(vertices + i * (size_t)VertexBuffer::FlatStride, VertexFormat::Flat); }, nullptr, 1);
+}
+
+void SWRenderDevice::SetInstanceBuffer(VertexBuffer* buffer)
+{
+	mInstanceBuffer = static_cast<SWVertexBuffer*>(buffer);
+}
+
+bool SWRenderDevice::DrawInstanced(PrimitiveType type, int startIndex, int primitiveCount, int instanceCount)
+{
+	if (!mVertexBuffer || !mInstanceBuffer || mInstanceBuffer->Format != VertexFormat::Instance)
+	{
+		SetError("DrawInstanced requires a vertex buffer and an instance buffer");
+		return false;
+	}
+
+	int vertexCount = GetVertexCount(type, primitiveCount);
+	size_t stride = mVertexBuffer->GetStride();
+	if (startIndex < 0 || ((size_t)startIndex + vertexCount) * stride > mVertexBuffer->Data.size())
+	{
+		SetError("DrawInstanced call reads past the end of the vertex buffer");
+		return false;
+	}
+	if (instanceCount < 0 || (size_t)instanceCount * VertexBuffer::InstanceStride > mInstanceBuffer->Data.size())
+	{
+		SetError("DrawInstanced call reads past the end of the instance buffer");
+		return false;
+	}
+
+	const uint8_t* data = mVertexBuffer->Data.data() + startIndex * stride;
+	VertexFormat format = mVertexBuffer->Format;
+	return DrawVertices(type, vertexCount, [&](int i, SWVertexInput& v) { v = ReadVertex(data + i * stride, format); }, mInstanceBuffer->Data.data(), instanceCount);
+}
+
+bool SWRenderDevice::DrawVertices(PrimitiveType type, int vertexCount, const std::function<void(int, SWVertexInput&)>& fetch, const uint8_t* instances, int instanceCount)
+{
+	if ((size_t)mShaderName >= mShaders.size() || !mShaders[mShaderName].Valid)
+	{
+		SetError("Shader %d is not supported by the software renderer", (int)mShaderName);
+		return false;
+	}
+
+	SWShadeContext ctx;
+	ctx.Program = mShaders[mShaderName];
+	ctx.Uniforms = &mUniforms;
+	ctx.AlphaTest = mAlphaTest;
+	for (int i = 0; i < 3; i++)
+	{
+		ctx.Samplers[i].Tex = mTextureUnit[i].Tex;
+		ctx.Samplers[i].Filter = mTextureUnit[i].MagFilter;
+		ctx.Samplers[i].Address = mTextureUnit[i].WrapMode;
+	}
+
+	SWTexture* target = mRenderTarget ? mRenderTarget : &mBackbuffer;
+	SWRenderTarget rt;
+	rt.Color = target->GetPixels(mRenderTarget ? mRenderTargetFace : 0);
+	rt.Depth = (target == &mBackbuffer || mUseDepthBuffer) ? target->GetDepth() : nullptr;
+	rt.Width = target->GetWidth();
+	rt.Height = target->GetHeight();
+
+	if (vertexCount <= 0 || instanceCount <= 0)
+		return true;
+
+	mVertexInput.resize(vertexCount);
+	for (int i = 0; i < vertexCount; i++)
+		fetch(i, mVertexInput[i]);
+
+	mTransformed.resize(vertexCount);
+	mVertexOutput.clear();
+	for (int instanceIndex = 0; instanceIndex < instanceCount; instanceIndex++)
+	{
+		SWInstanceInput instance;
+		if (instances)
+			memcpy(&instance, instances + instanceIndex * (size_t)VertexBuffer::InstanceStride, sizeof(SWInstanceInput));
+
+		for (int i = 0; i < vertexCount; i++)
+		{
+			mTransformed[i] = {};
+			SWRunVertexProgram(ctx.Program.Vertex, mUniforms, mVertexInput[i], instances ? &instance : nullptr, mTransformed[i]);
+		}
+
+		switch (type)
+		{
+		case PrimitiveType::LineList:
+		case PrimitiveType::TriangleList:
+			mVertexOutput.insert(mVertexOutput.end(), mTransformed.begin(), mTransformed.end());
+			break;
+
+		case PrimitiveType::TriangleStrip:
+			// Every other triangle swaps its first two vertices to keep the winding. The last vertex stays the provoking one.
+			for (int i = 0; i + 2 < vertexCount; i++)
+			{
+				mVertexOutput.push_back(mTransformed[(i & 1) ? i + 1 : i]);
+				mVertexOutput.push_back(mTransformed[(i & 1) ? i : i + 1]);
+				mVertexOutput.push_back(mTransformed[i + 2]);
+			}
+			break;
+		}
+	}
+
+	if (type == PrimitiveType::LineList)
+		mRasterizer.DrawLines(mRasterState, rt, ctx, mVertexOutput.data(), mVertexOutput.size());
+	else
+		mRasterizer.DrawTriangles(mRasterState, rt, ctx, mVertexOutput.data(), mVertexOutput.size());
+	return true;
+}
+
+bool SWRenderDevice::StartRendering(bool clear, int backcolor, Texture* itarget, bool usedepthbuffer)
+{
+	SWTexture* target = static_cast<SWTexture*>(itarget);
+	if (target)
+	{
+		if (target->IsCubeTexture() || target->GetWidth() <= 0 || target->GetHeight() <= 0)
+		{
+			SetError("Error setting render target: the texture is not a 2D image");
+			return false;
+		}
+		mRenderTarget = target;
+		mRenderTargetFace = 0;
+		mUseDepthBuffer = usedepthbuffer;
+	}
+	else
+	{
+		if (!UpdateBackbufferSize())
+			return false;
+		mRenderTarget = nullptr;
+		mRenderTargetFace = 0;
+		mUseDepthBuffer = true;
+		target = &mBackbuffer;
+	}
+
+	if (clear)
+	{
+		uint32_t* pixels = target->GetPixels();
+		std::fill(pixels, pixels + (size_t)target->GetWidth() * target->GetHeight(), (uint32_t)backcolor);
+		if (usedepthbuffer)
+		{
+			float* depth = target->GetDepth();
+			std::fill(depth, depth + (size_t)target->GetWidth() * target->GetHeight(), 1.0f);
+		}
+	}
+
+	return true;
+}
+
+bool SWRenderDevice::StartCubeRendering(bool clear, int backcolor, Texture* itarget, CubeMapFace face)
+{
+	SWTexture* target = static_cast<SWTexture*>(itarget);
+	if (!target->IsCubeTexture())
+	{
+		SetError("StartCubeRendering requires a cube texture");
+		return false;
+	}
+
+	mRenderTarget = target;
+	mRenderTargetFace = (int)face;
+	mUseDepthBuffer = false;
+
+	if (clear)
+	{
+		uint32_t* pixels = target->GetPixels(mRenderTargetFace);
+		std::fill(pixels, pixels + (size_t)target->GetWidth() * target->GetHeight(), (uint32_t)backcolor);
+	}
+
+	return true;
+}
+
+bool SWRenderDevice::FinishRendering()
+{
+	return true;
+}
+
+bool SWRenderDevice::Present()
+{
+	bool result = true;
+	if (mWindow)
+		result = PresentPixels(mDisp, mWindow, mBackbuffer.GetPixels(), mBackbuffer.GetWidth(), mBackbuffer.GetHeight());
+	mBackend->ProcessDeleteList();
+	return result;
+}
+
+bool SWRenderDevice::ClearTexture(int backcolor, Texture* texture)
+{
+	if (!StartRendering(true, backcolor, texture, false)) return false;
+	return FinishRendering();
+}
+
+bool SWRenderDevice::CopyTexture(Texture* idst, CubeMapFace face)
+{
+	SWTexture* dst = static_cast<SWTexture*>(idst);
+	if (!dst->IsCubeTexture())
+	{
+		SetError("CopyTexture requires a cube texture");
+		return false;
+	}
+
+	const SWTexture* src = mRenderTarget ? mRenderTarget : &mBackbuffer;
+	int width = std::min(dst->GetWidth(), src->GetWidth());
+	int height = std::min(dst->GetHeight(), src->GetHeight());
+	for (int y = 0; y < height; y++)
+		memcpy(dst->GetPixels((int)face) + (size_t)y * dst->GetWidth(), src->GetPixels() + (size_t)y * src->GetWidth(), width * sizeof(uint32_t));
+	return true;
+}
+
+bool SWRenderDevice::SetVertexBufferData(VertexBuffer* ibuffer, void* data, int64_t size, VertexFormat format)
+{
+	SWVertexBuffer* buffer = static_cast<SWVertexBuffer*>(ibuffer);
+	buffer->Format = format;
+	if (data)
+		buffer->Data.assign(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+	else
+		buffer->Data.assign((size_t)size, 0);
+	return true;
+}
+
+bool SWRenderDevice::SetVertexBufferSubdata(VertexBuffer* ibuffer, int64_t destOffset, void* data, int64_t size)
+{
+	SWVertexBuffer* buffer = static_cast<SWVertexBuffer*>(ibuffer);
+	if (destOffset < 0 || size < 0 || (uint64_t)(destOffset + size) > buffer->Data.size())
+	{
+		SetError("SetVertexBufferSubdata writes past the end of the vertex buffer");
+		return false;
+	}
+	memcpy(buffer->Data.data() + destOffset, data, (size_t)size);
+	return true;
+}
+
+bool SWRenderDevice::SetIndexBufferData(IndexBuffer* ibuffer, void* data, int64_t size)
+{
+	SWIndexBuffer* buffer = static_cast<SWIndexBuffer*>(ibuffer);
+	buffer->Indices.resize((size_t)size / sizeof(uint32_t));
+	if (data)
+		memcpy(buffer->Indices.data(), data, buffer->Indices.size() * sizeof(uint32_t));
+	return true;
+}
+
+bool SWRenderDevice::SetPixels(Texture* texture, const void* data)
+{
+	static_cast<SWTexture*>(texture)->SetPixels(0, data);
+	return true;
+}
+
+bool SWRenderDevice::SetCubePixels(Texture* texture, CubeMapFace face, const void* data)
+{
+	static_cast<SWTexture*>(texture)->SetPixels((int)face, data);
+	return true;
+}
+
+void* SWRenderDevice::MapPBO(Texture* texture)
+{
+	return static_cast<SWTexture*>(texture)->MapPBO();
+}
+
+bool SWRenderDevice::UnmapPBO(Texture* texture)
+{
+	static_cast<SWTexture*>(texture)->UnmapPBO();
+	return true;
+}
+
+bool SWRenderDevice::ReadPixelsAsync(Texture* itarget, PixelFormat format)
+{
+	if (format == PixelFormat::D32f_S8 || format == PixelFormat::D24_S8 || format == PixelFormat::A2Bgr10 || format == PixelFormat::A2Rgb10_snorm)
+	{
+		SetError("Unsupported readback pixel format %d", (int)format);
+		return false;
+	}
+
+	const SWTexture* source = itarget ? static_cast<SWTexture*>(itarget) : &mBackbuffer;
+	if (source->IsCubeTexture())
+	{
+		SetError("Error setting readback source: the texture is not a 2D image");
+		return false;
+	}
+
+	size_t count = (size_t)source->GetWidth() * source->GetHeight();
+	Readback readback;
+	readback.Target = itarget;
+	readback.Data.resize(count * Texture::GetBytesPerPixel(format));
+	SWTexture::ConvertFromBgra8(readback.Data.data(), source->GetPixels(), count, format);
+	mReadbacks.push_back(std::move(readback));
+	return true;
+}
+
+bool SWRenderDevice::MapReadback(Texture* target, bool wait, void** data)
+{
+	*data = nullptr;
+
+	auto it = std::find_if(mReadbacks.begin(), mReadbacks.end(), [=](const Readback& r) { return r.Target == target; });
+	if (it == mReadbacks.end())
+	{
+		SetError("No readback was requested for this render target");
+		return false;
+	}
+
+	*data = it->Data.data();
+	return true;
+}
+
+bool SWRenderDevice::UnmapReadback(Texture* target)
+{
+	auto it = std::find_if(mReadbacks.begin(), mReadbacks.end(), [=](const Readback& r) { return r.Target == target; });
+	if (it == mReadbacks.end())
+	{
+		SetError("No readback was requested for this render target");
+		return false;
+	}
+
+	mReadbacks.erase(it);
+	return true;
+}
+
+void SWRenderDevice::ForgetObject(VertexBuffer* buffer)
+{
+	if (mVertexBuffer == buffer) mVertexBuffer = nullptr;
+	if (mInstanceBuffer == buffer) mInstanceBuffer = nullptr;
+}
+
+void SWRenderDevice::ForgetObject(IndexBuffer* buffer)
+{
+	if (mIndexBuffer == buffer) mIndexBuffer = nullptr;
+}
+
+void SWRenderDevice::ForgetObject(Texture* texture)
+{
+	for (TextureUnit& unit : mTextureUnit)
+	{
+		if (unit.Tex == texture)
+			unit.Tex = nullptr;
+	}
+
+	if (mRenderTarget == texture)
+		mRenderTarget = nullptr;
+
+	mReadbacks.remove_if([=](const Readback& r) { return r.Target == texture; });
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+#ifdef WIN32
+
+namespace
+{
+	bool GetWindowSize(void* disp, void* window, int& width, int& height)
+	{
+		RECT box = {};
+		if (!GetClientRect((HWND)window, &box))
+		{
+			SetError("GetClientRect failed");
+			return false;
+		}
+		width = box.right - box.left;
+		height = box.bottom - box.top;
+		return true;
+	}
+
+	bool PresentPixels(void* disp, void* window, const uint32_t* pixels, int width, int height)
+	{
+		// A positive height makes the DIB bottom-up, which matches the row order of the backbuffer
+		BITMAPINFO info = {};
+		info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+		info.bmiHeader.biWidth = width;
+		info.bmiHeader.biHeight = height;
+		info.bmiHeader.biPlanes = 1;
+		info.bmiHeader.biBitCount = 32;
+		info.bmiHeader.biCompression = BI_RGB;
+
+		HDC dc = GetDC((HWND)window);
+		if (!dc)
+		{
+			SetError("GetDC failed");
+			return false;
+		}
+		int lines = SetDIBitsToDevice(dc, 0, 0, width, height, 0, 0, 0, height, pixels, &info, DIB_RGB_COLORS);
+		ReleaseDC((HWND)window, dc);
+		if (lines == 0)
+		{
+			SetError("SetDIBitsToDevice failed");
+			return false;
+		}
+		return true;
+	}
+}
+
+#elif defined(__APPLE__)
+
+namespace
+{
+	bool GetWindowSize(void* disp, void* window, int& width, int& height)
+	{
+		SetError("Software rendering to a window is not supported on this platform");
+		return false;
+	}
+
+	bool PresentPixels(void* disp, void* window, const uint32_t* pixels, int width, int height)
+	{
+		SetError("Software rendering to a window is not supported on this platform");
+		return false;
+	}
+}
+
+#else
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+namespace
+{
+	bool GetWindowSize(void* disp, void* window, int& width, int& height)
+	{
+		::Window root = 0;
+		int x = 0, y = 0;
+		unsigned int w = 0, h = 0, border = 0, depth = 0;
+		if (!XGetGeometry((::Display*)disp, (::Window)window, &root, &x, &y, &w, &h, &border, &depth))
+		{
+			SetError("XGetGeometry failed");
+			return false;
+		}
+		width = (int)w;
+		height = (int)h;
+		return true;
+	}
+
+	bool PresentPixels(void* disp, void* window, const uint32_t* pixels, int width, int height)
+	{
+		::Display* display = (::Display*)disp;
+		::Window xwindow = (::Window)window;
+
+		XWindowAttributes attributes = {};
+		if (!XGetWindowAttributes(display, xwindow, &attributes))
+		{
+			SetError("XGetWindowAttributes failed");
+			return false;
+		}
+		if (attributes.depth != 24 && attributes.depth != 32)
+		{
+			SetError("Software rendering requires a 24 or 32 bit visual");
+			return false;
+		}
+
+		// X images are top-down
+		static thread_local std::vector<uint32_t> flipped;
+		flipped.resize((size_t)width * height);
+		for (int y = 0; y < height; y++)
+			memcpy(flipped.data() + (size_t)y * width, pixels + (size_t)(height - 1 - y) * width, width * sizeof(uint32_t));
+
+		XImage* image = XCreateImage(display, attributes.visual, attributes.depth, ZPixmap, 0, (char*)flipped.data(), width, height, 32, 0);
+		if (!image)
+		{
+			SetError("XCreateImage failed");
+			return false;
+		}
+
+		GC gc = XCreateGC(display, xwindow, 0, nullptr);
+		XPutImage(display, xwindow, gc, image, 0, 0, 0, 0, width, height);
+		XFreeGC(display, gc);
+		XFlush(display);
+
+		// The pixels are not owned by the image
+		image->data = nullptr;
+		XDestroyImage(image);
+		return true;
+	}
+}
+
+#endif
@@ -0,0 +1,146 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include "../Backend.h"
+#include "SWRasterizer.h"
+#include "SWTexture.h"
+#include <list>
+
+class SWBackend;
+class SWVertexBuffer;
+class SWIndexBuffer;
+
+// Render device drawing on the CPU. Shaders are matched by name to the native programs in SWShaders
+// and the result is copied to the window at Present. Used where no suitable OpenGL driver is available.
+class SWRenderDevice : public RenderDevice
+{
+public:
+	SWRenderDevice(SWBackend* backend, void* disp, void* window);
+	SWRenderDevice(SWBackend* backend, int width, int height);
+	~SWRenderDevice();
+
+	bool IsValid() const { return mValid; }
+
+	void DeclareUniform(UniformName name, const char* glslname, UniformType type) override;
+	void DeclareShader(ShaderName index, const char* name, const char* vertexshader, const char* fragmentshader) override;
+	void SetShader(ShaderName name) override;
+	void SetUniform(UniformName name, const void* values, int count, int bytesize) override;
+	void SetVertexBuffer(VertexBuffer* buffer) override;
+	void SetIndexBuffer(IndexBuffer* buffer) override;
+	void SetAlphaBlendEnable(bool value) override;
+	void SetAlphaTestEnable(bool value) override;
+	void SetCullMode(Cull mode) override;
+	void SetBlendOperation(BlendOperation op) override;
+	void SetSourceBlend(Blend blend) override;
+	void SetDestinationBlend(Blend blend) override;
+	void SetFillMode(FillMode mode) override;
+	void SetMultisampleAntialias(bool value) override;
+	void SetZEnable(bool value) override;
+	void SetZWriteEnable(bool value) override;
+	void SetTexture(int unit, Texture* texture) override;
+	void SetSamplerFilter(int unit, TextureFilter minfilter, TextureFilter magfilter, MipmapFilter mipfilter, float maxanisotropy) override;
+	void SetSamplerState(int unit, TextureAddress address) override;
+	bool Draw(PrimitiveType type, int startIndex, int primitiveCount) override;
+	bool DrawIndexed(PrimitiveType type, int startIndex, int primitiveCount) override;
+	bool DrawData(PrimitiveType type, int startIndex, int primitiveCount, const void* data) override;
+	void SetInstanceBuffer(VertexBuffer* buffer) override;
+	bool DrawInstanced(PrimitiveType type, int startIndex, int primitiveCount, int instanceCount) override;
+	bool StartRendering(bool clear, int backcolor, Texture* target, bool usedepthbuffer) override;
+	bool StartCubeRendering(bool clear, int backcolor, Texture* target, CubeMapFace face) override;
+	bool FinishRendering() override;
+	bool Present() override;
+	bool ClearTexture(int backcolor, Texture* texture) override;
+	bool CopyTexture(Texture* dst, CubeMapFace face) override;
+	bool SetVertexBufferData(VertexBuffer* buffer, void* data, int64_t size, VertexFormat format) override;
+	bool SetVertexBufferSubdata(VertexBuffer* buffer, int64_t destOffset, void* data, int64_t size) override;
+	bool SetIndexBufferData(IndexBuffer* buffer, void* data, int64_t size) override;
+	bool SetPixels(Texture* texture, const void* data) override;
+	bool SetCubePixels(Texture* texture, CubeMapFace face, const void* data) override;
+	void* MapPBO(Texture* texture) override;
+	bool UnmapPBO(Texture* texture) override;
+	bool ReadPixelsAsync(Texture* target, PixelFormat format) override;
+	bool MapReadback(Texture* target, bool wait, void** data) override;
+	bool UnmapReadback(Texture* target) override;
+
+	// Called by the backend before it frees an object this device may still reference
+	void ForgetObject(VertexBuffer* buffer);
+	void ForgetObject(IndexBuffer* buffer);
+	void ForgetObject(Texture* texture);
+
+private:
+	bool UpdateBackbufferSize();
+	bool PrepareDraw();
+	bool DrawVertices(PrimitiveType type, int vertexCount, const std::function<void(int, SWVertexInput&)>& fetch, const uint8_t* instances, int instanceCount);
+
+	static int GetVertexCount(PrimitiveType type, int primitiveCount);
+	static SWVertexInput ReadVertex(const uint8_t* data, VertexFormat format);
+
+	SWBackend* mBackend = nullptr;
+	void* mDisp = nullptr;
+	void* mWindow = nullptr;
+	bool mValid = false;
+
+	SWTexture mBackbuffer;
+	SWTexture* mRenderTarget = nullptr;
+	int mRenderTargetFace = 0;
+	bool mUseDepthBuffer = false;
+
+	SWRasterizer mRasterizer;
+	SWRasterState mRasterState;
+	bool mAlphaTest = false;
+
+	SWUniforms mUniforms = {};
+	struct UniformInfo
+	{
+		bool Used = false;
+		size_t Offset = 0;
+		size_t Size = 0;
+	};
+	std::vector<UniformInfo> mUniformInfo;
+
+	std::vector<SWShaderProgram> mShaders;
+	ShaderName mShaderName = {};
+
+	SWVertexBuffer* mVertexBuffer = nullptr;
+	SWIndexBuffer* mIndexBuffer = nullptr;
+	SWVertexBuffer* mInstanceBuffer = nullptr;
+
+	struct TextureUnit
+	{
+		SWTexture* Tex = nullptr;
+		TextureAddress WrapMode = TextureAddress::Wrap;
+		TextureFilter MagFilter = TextureFilter::Nearest;
+	} mTextureUnit[10];
+
+	// Readbacks are copied when requested, so they are always ready. Target is null for the backbuffer.
+	struct Readback
+	{
+		Texture* Target;
+		std::vector<uint8_t> Data;
+	};
+	std::list<Readback> mReadbacks;
+
+	std::vector<SWVertexInput> mVertexInput;
+	std::vector<SWVertexOutput> mTransformed;
+	std::vector<SWVertexOutput> mVertexOutput;
+};
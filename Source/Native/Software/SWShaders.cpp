@@ -0,0 +1,697 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "Precomp.h"
+#include "SWShaders.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+namespace
+{
+	struct UniformField
+	{
+		const char* Name;
+		size_t Offset;
+		size_t Size;
+	};
+
+	#define SW_UNIFORM(name) { #name, offsetof(SWUniforms, name), sizeof(SWUniforms::name) }
+
+	const UniformField UniformFields[] =
+	{
+		SW_UNIFORM(projection),
+		SW_UNIFORM(view),
+		SW_UNIFORM(world),
+		SW_UNIFORM(modelnormal),
+		SW_UNIFORM(campos),
+		SW_UNIFORM(highlightcolor),
+		SW_UNIFORM(stencilColor),
+		SW_UNIFORM(fogsettings),
+		SW_UNIFORM(fogcolor),
+		SW_UNIFORM(sectorfogcolor),
+		SW_UNIFORM(vertexColor),
+		SW_UNIFORM(rendersettings),
+		SW_UNIFORM(texturefactor),
+		SW_UNIFORM(fillColor),
+		SW_UNIFORM(desaturation),
+		SW_UNIFORM(lightsEnabled),
+		SW_UNIFORM(ignoreNormals),
+		SW_UNIFORM(useLightStrength),
+		SW_UNIFORM(slopeHandleLength),
+		SW_UNIFORM(skew),
+		SW_UNIFORM(spriteAtlasGrid),
+		SW_UNIFORM(drawPaletted),
+		SW_UNIFORM(colormapSize),
+		SW_UNIFORM(doomlightlevels),
+		SW_UNIFORM(sectorLightLevel),
+		SW_UNIFORM(lightPosAndRadius),
+		SW_UNIFORM(lightOrientation),
+		SW_UNIFORM(lightColor),
+		SW_UNIFORM(light2Radius),
+		SW_UNIFORM(lightStrengthAndLinearity)
+	};
+
+	#undef SW_UNIFORM
+
+	struct ProgramName
+	{
+		const char* Name;
+		SWVertexProgram Vertex;
+		SWFragmentProgram Fragment;
+	};
+
+	const ProgramName ProgramNames[] =
+	{
+		{ "display2d_normal", SWVertexProgram::Display2D, SWFragmentProgram::Display2DNormal },
+		{ "display2d_fullbright", SWVertexProgram::Display2D, SWFragmentProgram::Display2DFullbright },
+		{ "display2d_fsaa", SWVertexProgram::Display2D, SWFragmentProgram::Display2DFsaa },
+		{ "things2d_fill", SWVertexProgram::Display2D, SWFragmentProgram::Things2DFill },
+		{ "things2d_thing", SWVertexProgram::Display2D, SWFragmentProgram::Things2DThing },
+		{ "things2d_sprite", SWVertexProgram::Display2D, SWFragmentProgram::Things2DSprite },
+		{ "things2d_thing_instanced", SWVertexProgram::Instanced2D, SWFragmentProgram::Things2DThing },
+		{ "world3d_main", SWVertexProgram::World3D, SWFragmentProgram::World3DMain },
+		{ "world3d_fullbright", SWVertexProgram::World3D, SWFragmentProgram::World3DFullbright },
+		{ "world3d_main_highlight", SWVertexProgram::World3D, SWFragmentProgram::World3DMainHighlight },
+		{ "world3d_fullbright_highlight", SWVertexProgram::World3D, SWFragmentProgram::World3DFullbrightHighlight },
+		{ "world3d_vertex_color", SWVertexProgram::World3D, SWFragmentProgram::World3DVertexColor },
+		{ "world3d_main_vertexcolor", SWVertexProgram::World3DVertexColor, SWFragmentProgram::World3DMain },
+		{ "world3d_constant_color", SWVertexProgram::World3DVertexColor, SWFragmentProgram::World3DConstantColor },
+		{ "world3d_main_highlight_vertexcolor", SWVertexProgram::World3DVertexColor, SWFragmentProgram::World3DMainHighlight },
+		{ "world3d_main_fog", SWVertexProgram::World3D, SWFragmentProgram::World3DMainFog },
+		{ "world3d_main_highlight_fog", SWVertexProgram::World3D, SWFragmentProgram::World3DMainHighlightFog },
+		{ "world3d_main_fog_vertexcolor", SWVertexProgram::World3DVertexColor, SWFragmentProgram::World3DMainFog },
+		{ "world3d_main_highlight_fog_vertexcolor", SWVertexProgram::World3DVertexColor, SWFragmentProgram::World3DMainHighlightFog },
+		{ "world3d_slope_handle", SWVertexProgram::SlopeHandle, SWFragmentProgram::World3DVertexColor },
+		{ "world3d_classic", SWVertexProgram::World3D, SWFragmentProgram::World3DClassic },
+		{ "world3d_classic_highlight", SWVertexProgram::World3D, SWFragmentProgram::World3DClassicHighlight },
+		{ "world3d_skybox", SWVertexProgram::Skybox, SWFragmentProgram::World3DSkybox }
+	};
+
+	struct Vec3
+	{
+		float x, y, z;
+
+		Vec3() = default;
+		Vec3(float x, float y, float z) : x(x), y(y), z(z) { }
+
+		Vec3 operator+(const Vec3& b) const { return Vec3(x + b.x, y + b.y, z + b.z); }
+		Vec3 operator-(const Vec3& b) const { return Vec3(x - b.x, y - b.y, z - b.z); }
+		Vec3 operator*(const Vec3& b) const { return Vec3(x * b.x, y * b.y, z * b.z); }
+		Vec3 operator*(float s) const { return Vec3(x * s, y * s, z * s); }
+	};
+
+	inline float Dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	inline float Length(const Vec3& v) { return std::sqrt(Dot(v, v)); }
+	inline float Distance(const Vec3& a, const Vec3& b) { return Length(a - b); }
+	inline float Clamp(float v, float lo, float hi) { return std::min(std::max(v, lo), hi); }
+	inline float Mix(float a, float b, float t) { return a + (b - a) * t; }
+	inline SWVec4 Mix(const SWVec4& a, const SWVec4& b, float t) { return a + (b - a) * t; }
+	inline Vec3 XYZ(const SWVec4& v) { return Vec3(v.x, v.y, v.z); }
+
+	inline Vec3 Normalize(const Vec3& v)
+	{
+		float len = Length(v);
+		return len > 0.0f ? v * (1.0f / len) : v;
+	}
+
+	inline float Smoothstep(float edge0, float edge1, float x)
+	{
+		float t = Clamp((x - edge0) / (edge1 - edge0), 0.0f, 1.0f);
+		return t * t * (3.0f - 2.0f * t);
+	}
+
+	// Column-major, the same layout as the matrices passed to glUniformMatrix4fv
+	inline SWVec4 Transform(const float* m, float x, float y, float z, float w)
+	{
+		return SWVec4(
+			m[0] * x + m[4] * y + m[8] * z + m[12] * w,
+			m[1] * x + m[5] * y + m[9] * z + m[13] * w,
+			m[2] * x + m[6] * y + m[10] * z + m[14] * w,
+			m[3] * x + m[7] * y + m[11] * z + m[15] * w);
+	}
+
+	inline void Store(float* dest, const SWVec4& v) { dest[0] = v.x; dest[1] = v.y; dest[2] = v.z; dest[3] = v.w; }
+	inline void Store(float* dest, const Vec3& v) { dest[0] = v.x; dest[1] = v.y; dest[2] = v.z; }
+	inline SWVec4 Load4(const float* src) { return SWVec4(src[0], src[1], src[2], src[3]); }
+	inline Vec3 Load3(const float* src) { return Vec3(src[0], src[1], src[2]); }
+
+	inline uint32_t ClampCoord(int v, int size) { return (uint32_t)std::min(std::max(v, 0), size - 1); }
+	inline uint32_t WrapCoord(int v, int size) { v %= size; return (uint32_t)(v < 0 ? v + size : v); }
+
+	inline float Gray(float r, float g, float b) { return r * 0.3f + g * 0.56f + b * 0.14f; }
+
+	SWVec4 Desaturate(const SWUniforms& u, SWVec4 c)
+	{
+		float gray = Gray(c.x, c.y, c.z);
+		return SWVec4(Mix(c.x, gray, u.desaturation), Mix(c.y, gray, u.desaturation), Mix(c.z, gray, u.desaturation), c.w);
+	}
+
+	SWVec4 AddColor(const SWVec4& c1, const SWVec4& c2)
+	{
+		return SWVec4(std::max(c1.x, c2.x), std::max(c1.y, c2.y), std::max(c1.z, c2.z), Clamp(c1.w + c2.w * 0.5f, 0.0f, 1.0f));
+	}
+
+	SWVec4 Highlight(const SWUniforms& u, const SWVec4& c, float alpha)
+	{
+		const SWVec4& h = u.highlightcolor;
+		return SWVec4(h.x * h.w + (c.x - 0.4f * h.w), h.y * h.w + (c.y - 0.4f * h.w), h.z * h.w + (c.z - 0.4f * h.w), alpha);
+	}
+
+	SWVec4 ApplyStencil(const SWUniforms& u, const SWVec4& c)
+	{
+		return Mix(c, SWVec4(u.stencilColor.x, u.stencilColor.y, u.stencilColor.z, c.w), u.stencilColor.w);
+	}
+
+	SWVec4 ApplyLinearFog(const SWUniforms& u, const SWVec4& c, float viewZ)
+	{
+		if (u.fogsettings.x < 0.0f)
+			return c;
+		return Mix(c, u.fogcolor, Clamp((-viewZ - u.fogsettings.x) / (u.fogsettings.y - u.fogsettings.x), 0.0f, 1.0f));
+	}
+
+	SWVec4 GetFogColor(const SWUniforms& u, const Vec3& posW, SWVec4 c)
+	{
+		float fogdist = std::max(16.0f, Distance(posW, XYZ(u.campos)));
+		float fogfactor = std::exp2(u.campos.w * fogdist);
+		c.x = Mix(u.sectorfogcolor.x, c.x, fogfactor);
+		c.y = Mix(u.sectorfogcolor.y, c.y, fogfactor);
+		c.z = Mix(u.sectorfogcolor.z, c.z, fogfactor);
+		return c;
+	}
+
+	float InverseSquareDistanceAttenuation(float dist, float radius, float strength, float linearity)
+	{
+		float a = dist / radius;
+		float b = Clamp(1.0f - a * a * a * a, 0.0f, 1.0f);
+		return Mix((b * b) / (dist * dist + 1.0f) * strength, Clamp((radius - dist) / radius, 0.0f, 1.0f), linearity);
+	}
+
+	Vec3 GetOneDynLightContribution(const SWUniforms& u, const Vec3& posW, const Vec3& normal, const Vec3& light, int i)
+	{
+		const SWVec4& lColor = u.lightColor[i];
+		const SWVec4& lPosAndRadius = u.lightPosAndRadius[i];
+		const SWVec4& lOrientation = u.lightOrientation[i];
+		Vec3 lPos = XYZ(lPosAndRadius);
+		bool attenuated = lColor.w > 0.979f && lColor.w < 0.981f;
+
+		float diffuseContribution = Dot(normal, Normalize(lPos - posW + normal * 3.0f));
+		if (diffuseContribution < 0.0f && (u.ignoreNormals == 0.0f || attenuated))
+			return light;
+
+		diffuseContribution = std::max(diffuseContribution, 0.0f);
+
+		float dist = Distance(posW, lPos);
+		if (dist > lPosAndRadius.w)
+			return light;
+
+		float power = 1.0f;
+		if (u.useLightStrength > 0.0f)
+			power *= InverseSquareDistanceAttenuation(dist, lPosAndRadius.w, u.lightStrengthAndLinearity[i][0], u.lightStrengthAndLinearity[i][1]);
+		else
+			power *= std::max(lPosAndRadius.w - dist, 0.0f) / lPosAndRadius.w;
+
+		if (lOrientation.w > 0.5f)
+		{
+			Vec3 lightDirection = Normalize(lPos - posW);
+			float cosDir = Dot(lightDirection, XYZ(lOrientation));
+			power *= Smoothstep(u.light2Radius[i][1], u.light2Radius[i][0], cosDir);
+		}
+
+		if (attenuated)
+			power *= diffuseContribution;
+
+		power *= lColor.w;
+
+		if (lColor.w >= 1.0f)
+			return light - XYZ(lColor) * power;
+		return light + XYZ(lColor) * power;
+	}
+
+	SWVec4 GetDynLightContribution(const SWUniforms& u, const SWVec4& tcolor, const SWVec4& baselight, const Vec3& posW, const Vec3& normal)
+	{
+		Vec3 light(0.0f, 0.0f, 0.0f);
+		Vec3 addlight(0.0f, 0.0f, 0.0f);
+
+		if (u.lightsEnabled != 0.0f)
+		{
+			for (int i = 0; i < 64; i++)
+			{
+				if (u.lightColor[i].w == 0.0f)
+					break;
+				if (u.lightColor[i].w < 0.4f)
+					addlight = GetOneDynLightContribution(u, posW, normal, addlight, i);
+				else
+					light = GetOneDynLightContribution(u, posW, normal, light, i);
+			}
+		}
+
+		Vec3 rgb = XYZ(tcolor) * (XYZ(baselight) + light) + addlight;
+		return SWVec4(rgb.x, rgb.y, rgb.z, tcolor.w * baselight.w);
+	}
+
+	int LightLevelFromVertexColor(const SWUniforms& u, const float* flatColor)
+	{
+		float result = std::max(std::max(flatColor[0], flatColor[1]), flatColor[2]) * 255.0f;
+		if (result < 192.0f && u.doomlightlevels > 0)
+			result = -0.666667f * (-96.0f - result);
+		return (int)result;
+	}
+
+	int ClassicLightLevelToColorMapOffset(const SWUniforms& u, int lightLevel, const Vec3& position, const Vec3& normal)
+	{
+		const int LIGHTLEVELS = 16;
+		const int LIGHTSEGSHIFT = 4;
+		const int NUMCOLORMAPS = 32;
+		const int MAXLIGHTSCALE = 48;
+		const int DISTMAP = 2;
+
+		int scaledLightLevel = lightLevel >> LIGHTSEGSHIFT;
+		bool isFlat = std::abs(normal.z) > 1e-3f;
+		float dist = Distance(position, XYZ(u.campos));
+
+		int level;
+		if (!isFlat)
+		{
+			int startmap = ((LIGHTLEVELS - 1 - scaledLightLevel) * 2) * NUMCOLORMAPS / LIGHTLEVELS;
+			int index = (int)(2560.0f / dist);
+			if (index >= MAXLIGHTSCALE) index = MAXLIGHTSCALE - 1;
+			level = startmap - index / DISTMAP;
+		}
+		else
+		{
+			float startmap = 2.0f * (30.0f - lightLevel / 8.0f);
+			level = (int)(startmap - (1280.0f / dist)) + 1;
+		}
+
+		return std::min(std::max(level, 0), NUMCOLORMAPS - 1);
+	}
+
+	SWVec4 SampleSkewed(const SWShadeContext& ctx, const float* uv)
+	{
+		const SWUniforms& u = *ctx.Uniforms;
+		return ctx.Samplers[0].Sample(uv[0], uv[1] + (uv[0] - u.skew[0]) * u.skew[1]);
+	}
+
+	SWVec4 ShadeClassic(const SWShadeContext& ctx, const float* v, const float* flat, bool highlight)
+	{
+		const SWUniforms& u = *ctx.Uniforms;
+		SWVec4 pcolor;
+		if (u.drawPaletted != 0)
+		{
+			SWVec4 color = SampleSkewed(ctx, v + SWVaryingUV);
+			int entry = (int)(color.x * 255.0f);
+			int lightLevel = LightLevelFromVertexColor(u, flat);
+			if (highlight)
+				lightLevel = std::max(lightLevel, 128);
+			int depth = ClassicLightLevelToColorMapOffset(u, lightLevel, Load3(v + SWVaryingPosW), Load3(flat + 4));
+			pcolor = ctx.Samplers[1].Sample((entry + 0.5f) / u.colormapSize[0], (depth + 0.5f) / u.colormapSize[1]);
+			pcolor.w = color.w;
+		}
+		else
+		{
+			pcolor = ctx.Samplers[0].Sample(v[SWVaryingUV], v[SWVaryingUV + 1]);
+		}
+
+		if (highlight && pcolor.w > 0.0f)
+			return Highlight(u, pcolor, std::max(pcolor.w + 0.25f, 0.5f));
+		return pcolor;
+	}
+}
+
+bool SWUniforms::FindField(const char* glslname, size_t& offset, size_t& size)
+{
+	for (const UniformField& field : UniformFields)
+	{
+		if (strcmp(field.Name, glslname) == 0)
+		{
+			offset = field.Offset;
+			size = field.Size;
+			return true;
+		}
+	}
+	return false;
+}
+
+SWShaderProgram SWShaderProgram::Find(const char* name)
+{
+	SWShaderProgram program;
+	for (const ProgramName& entry : ProgramNames)
+	{
+		if (strcmp(entry.Name, name) == 0)
+		{
+			program.Valid = true;
+			program.Vertex = entry.Vertex;
+			program.Fragment = entry.Fragment;
+			switch (entry.Vertex)
+			{
+			case SWVertexProgram::Display2D:
+			case SWVertexProgram::Instanced2D: program.VaryingCount = SWVaryingPosW; break;
+			case SWVertexProgram::Skybox: program.VaryingCount = SWMaxVaryings; break;
+			default: program.VaryingCount = SWVaryingTex; break;
+			}
+			break;
+		}
+	}
+	return program;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+SWVec4 SWSampler::SampleFace(const uint32_t* pixels, float u, float v, bool clamp) const
+{
+	int width = Tex->GetWidth();
+	int height = Tex->GetHeight();
+	if (Filter == TextureFilter::Nearest)
+	{
+		int x = (int)std::floor(u * width);
+		int y = (int)std::floor(v * height);
+		uint32_t px = clamp ? ClampCoord(x, width) : WrapCoord(x, width);
+		uint32_t py = clamp ? ClampCoord(y, height) : WrapCoord(y, height);
+		return SWVec4::FromBgra8(pixels[py * width + px]);
+	}
+	else
+	{
+		float fx = u * width - 0.5f;
+		float fy = v * height - 0.5f;
+		float x0f = std::floor(fx);
+		float y0f = std::floor(fy);
+		float tx = fx - x0f;
+		float ty = fy - y0f;
+		int x0 = (int)x0f;
+		int y0 = (int)y0f;
+		uint32_t px0 = clamp ? ClampCoord(x0, width) : WrapCoord(x0, width);
+		uint32_t px1 = clamp ? ClampCoord(x0 + 1, width) : WrapCoord(x0 + 1, width);
+		uint32_t py0 = clamp ? ClampCoord(y0, height) : WrapCoord(y0, height);
+		uint32_t py1 = clamp ? ClampCoord(y0 + 1, height) : WrapCoord(y0 + 1, height);
+		SWVec4 c00 = SWVec4::FromBgra8(pixels[py0 * width + px0]);
+		SWVec4 c10 = SWVec4::FromBgra8(pixels[py0 * width + px1]);
+		SWVec4 c01 = SWVec4::FromBgra8(pixels[py1 * width + px0]);
+		SWVec4 c11 = SWVec4::FromBgra8(pixels[py1 * width + px1]);
+		return Mix(Mix(c00, c10, tx), Mix(c01, c11, tx), ty);
+	}
+}
+
+SWVec4 SWSampler::Sample(float u, float v) const
+{
+	// OpenGL returns opaque black for incomplete textures
+	if (!Tex || Tex->GetWidth() <= 0 || Tex->GetHeight() <= 0 || Tex->IsCubeTexture())
+		return SWVec4(0.0f, 0.0f, 0.0f, 1.0f);
+	return SampleFace(Tex->GetPixels(), u, v, Address == TextureAddress::Clamp);
+}
+
+SWVec4 SWSampler::SampleCube(float x, float y, float z) const
+{
+	if (!Tex || Tex->GetWidth() <= 0 || !Tex->IsCubeTexture())
+		return SWVec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+	// Face selection from table 8.19 of the OpenGL specification
+	float ax = std::abs(x), ay = std::abs(y), az = std::abs(z);
+	CubeMapFace face;
+	float sc, tc, ma;
+	if (ax >= ay && ax >= az)
+	{
+		face = x >= 0.0f ? CubeMapFace::PositiveX : CubeMapFace::NegativeX;
+		sc = x >= 0.0f ? -z : z;
+		tc = -y;
+		ma = ax;
+	}
+	else if (ay >= az)
+	{
+		face = y >= 0.0f ? CubeMapFace::PositiveY : CubeMapFace::NegativeY;
+		sc = x;
+		tc = y >= 0.0f ? z : -z;
+		ma = ay;
+	}
+	else
+	{
+		face = z >= 0.0f ? CubeMapFace::PositiveZ : CubeMapFace::NegativeZ;
+		sc = z >= 0.0f ? x : -x;
+		tc = -y;
+		ma = az;
+	}
+
+	if (ma == 0.0f)
+		return SWVec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+	float s = (sc / ma + 1.0f) * 0.5f;
+	float t = (tc / ma + 1.0f) * 0.5f;
+	return SampleFace(Tex->GetPixels((int)face), s, t, true);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+void SWRunVertexProgram(SWVertexProgram program, const SWUniforms& u, const SWVertexInput& in, const SWInstanceInput* instance, SWVertexOutput& out)
+{
+	SWVec4 color = SWVec4::FromBgra8(in.color);
+
+	switch (program)
+	{
+	case SWVertexProgram::Display2D:
+	case SWVertexProgram::Instanced2D:
+	{
+		float px = in.x, py = in.y, pz = in.z;
+		float uvx = in.u, uvy = in.v;
+		if (program == SWVertexProgram::Instanced2D && instance)
+		{
+			float cx = in.x * instance->size;
+			float cy = in.y * instance->size;
+			float s = std::sin(instance->angle);
+			float c = std::cos(instance->angle);
+			px = instance->x + (cx * c - cy * s);
+			py = instance->y + (cx * s + cy * c);
+			pz = instance->z + in.z;
+			color = color * SWVec4::FromBgra8(instance->color);
+
+			float gridx = std::max(u.spriteAtlasGrid[0], 1.0f);
+			float gridy = std::max(u.spriteAtlasGrid[1], 1.0f);
+			float cellx = instance->sprite - gridx * std::floor(instance->sprite / gridx);
+			float celly = std::floor(instance->sprite / gridx);
+			uvx = (cellx + in.u) / gridx;
+			uvy = (celly + in.v) / gridy;
+		}
+		Store(out.clip, Transform(u.projection, px, py, pz, 1.0f));
+		Store(out.varyings + SWVaryingColor, color);
+		out.varyings[SWVaryingUV] = uvx;
+		out.varyings[SWVaryingUV + 1] = uvy;
+		break;
+	}
+
+	case SWVertexProgram::World3D:
+	case SWVertexProgram::World3DVertexColor:
+	case SWVertexProgram::SlopeHandle:
+	case SWVertexProgram::Skybox:
+	{
+		float px = program == SWVertexProgram::SlopeHandle ? in.x * u.slopeHandleLength : in.x;
+		SWVec4 worldpos = Transform(u.world, px, in.y, in.z, 1.0f);
+		SWVec4 viewpos = Transform(u.view, worldpos.x, worldpos.y, worldpos.z, worldpos.w);
+		Store(out.clip, Transform(u.projection, viewpos.x, viewpos.y, viewpos.z, viewpos.w));
+
+		if (program == SWVertexProgram::World3DVertexColor)
+			color = u.vertexColor;
+		else if (program == SWVertexProgram::SlopeHandle)
+			color = color * u.vertexColor;
+
+		Vec3 normal(in.nx, in.ny, in.nz);
+		Store(out.varyings + SWVaryingColor, color);
+		out.varyings[SWVaryingUV] = in.u;
+		out.varyings[SWVaryingUV + 1] = in.v;
+		Store(out.varyings + SWVaryingPosW, XYZ(worldpos));
+		Store(out.varyings + SWVaryingNormal, Normalize(XYZ(Transform(u.modelnormal, normal.x, normal.y, normal.z, 1.0f))));
+		out.varyings[SWVaryingViewZ] = viewpos.z;
+		Store(out.flat, SWVec4::FromBgra8(in.color));
+		Store(out.flat + 4, Normalize(normal));
+
+		if (program == SWVertexProgram::Skybox)
+		{
+			Vec3 skynormal = Normalize(XYZ(Transform(u.world, 0.0f, 1.0f, 0.0f, 0.0f)));
+			Vec3 incident = XYZ(worldpos) - XYZ(u.campos);
+			Store(out.varyings + SWVaryingTex, incident - skynormal * (2.0f * Dot(skynormal, incident)));
+		}
+		break;
+	}
+	}
+}
+
+bool SWRunFragmentProgram(const SWShadeContext& ctx, const float* v, const float* flat, SWVec4& out)
+{
+	const SWUniforms& u = *ctx.Uniforms;
+	SWVec4 color = Load4(v + SWVaryingColor);
+	const float* uv = v + SWVaryingUV;
+	bool linearFog = true;
+
+	switch (ctx.Program.Fragment)
+	{
+	case SWFragmentProgram::Display2DNormal:
+	case SWFragmentProgram::Things2DThing:
+	{
+		SWVec4 c = ctx.Samplers[0].Sample(uv[0], uv[1]);
+		c.w *= u.rendersettings.w;
+		out = Desaturate(u, c) * color * u.texturefactor;
+		linearFog = false;
+		break;
+	}
+
+	case SWFragmentProgram::Display2DFullbright:
+	{
+		SWVec4 c = ctx.Samplers[0].Sample(uv[0], uv[1]);
+		c.w *= u.rendersettings.w;
+		out = c * u.texturefactor;
+		linearFog = false;
+		break;
+	}
+
+	case SWFragmentProgram::Display2DFsaa:
+	{
+		const SWSampler& s = ctx.Samplers[0];
+		SWVec4 c = s.Sample(uv[0], uv[1]);
+		if (c.w < 0.1f)
+		{
+			SWVec4 n(0.0f, 0.0f, 0.0f, 0.0f);
+			n = AddColor(n, s.Sample(uv[0] + u.rendersettings.x, uv[1]));
+			n = AddColor(n, s.Sample(uv[0] - u.rendersettings.x, uv[1]));
+			n = AddColor(n, s.Sample(uv[0], uv[1] + u.rendersettings.y));
+			n = AddColor(n, s.Sample(uv[0], uv[1] - u.rendersettings.y));
+			n.w *= u.rendersettings.z * u.rendersettings.w;
+			out = Desaturate(u, n);
+		}
+		else
+		{
+			c.w *= u.rendersettings.w;
+			out = Desaturate(u, c) * color;
+		}
+		out = out * u.texturefactor;
+		linearFog = false;
+		break;
+	}
+
+	case SWFragmentProgram::Things2DFill:
+		out = u.fillColor;
+		linearFog = false;
+		break;
+
+	case SWFragmentProgram::Things2DSprite:
+	{
+		SWVec4 c = ctx.Samplers[0].Sample(uv[0], uv[1]);
+		SWVec4 cr = Desaturate(u, c);
+		if (color.w > 0.0f)
+			out = SWVec4((cr.x + color.x) * 0.5f, (cr.y + color.y) * 0.5f, (cr.z + color.z) * 0.5f, c.w * u.rendersettings.w * color.w);
+		else
+			out = SWVec4(cr.x, cr.y, cr.z, c.w * u.rendersettings.w);
+		out = out * u.texturefactor;
+		linearFog = false;
+		break;
+	}
+
+	case SWFragmentProgram::World3DMain:
+	{
+		SWVec4 tcolor = ApplyStencil(u, SampleSkewed(ctx, uv));
+		tcolor = GetDynLightContribution(u, tcolor, color, Load3(v + SWVaryingPosW), Load3(v + SWVaryingNormal));
+		out = Desaturate(u, tcolor);
+		break;
+	}
+
+	case SWFragmentProgram::World3DFullbright:
+	{
+		SWVec4 tcolor = ApplyStencil(u, SampleSkewed(ctx, uv));
+		tcolor.w *= color.w;
+		out = tcolor;
+		break;
+	}
+
+	case SWFragmentProgram::World3DMainHighlight:
+	{
+		SWVec4 tcolor = ApplyStencil(u, SampleSkewed(ctx, uv));
+		tcolor = GetDynLightContribution(u, tcolor, color, Load3(v + SWVaryingPosW), Load3(v + SWVaryingNormal));
+		out = tcolor.w == 0.0f ? tcolor : Highlight(u, Desaturate(u, tcolor), std::max(color.w + 0.25f, 0.5f));
+		break;
+	}
+
+	case SWFragmentProgram::World3DFullbrightHighlight:
+	{
+		SWVec4 tcolor = ApplyStencil(u, SampleSkewed(ctx, uv));
+		out = tcolor.w == 0.0f ? tcolor : Highlight(u, tcolor, std::max(color.w + 0.25f, 0.5f));
+		break;
+	}
+
+	case SWFragmentProgram::World3DVertexColor:
+		out = color;
+		break;
+
+	case SWFragmentProgram::World3DConstantColor:
+		out = u.vertexColor;
+		break;
+
+	case SWFragmentProgram::World3DMainFog:
+	{
+		Vec3 posW = Load3(v + SWVaryingPosW);
+		SWVec4 tcolor = ApplyStencil(u, SampleSkewed(ctx, uv));
+		tcolor = GetDynLightContribution(u, tcolor, color, posW, Load3(v + SWVaryingNormal));
+		out = tcolor.w == 0.0f ? tcolor : Desaturate(u, GetFogColor(u, posW, tcolor));
+		break;
+	}
+
+	case SWFragmentProgram::World3DMainHighlightFog:
+	{
+		Vec3 posW = Load3(v + SWVaryingPosW);
+		SWVec4 tcolor = ApplyStencil(u, SampleSkewed(ctx, uv));
+		float alpha = tcolor.w;
+		tcolor = GetDynLightContribution(u, tcolor, color, posW, Load3(v + SWVaryingNormal));
+		tcolor.w = alpha;
+		if (tcolor.w == 0.0f)
+		{
+			out = tcolor;
+		}
+		else
+		{
+			SWVec4 ncolor = Desaturate(u, GetFogColor(u, posW, tcolor));
+			out = Highlight(u, ncolor, std::max(ncolor.w + 0.25f, 0.5f));
+		}
+		break;
+	}
+
+	case SWFragmentProgram::World3DClassic:
+		out = ShadeClassic(ctx, v, flat, false);
+		linearFog = false;
+		break;
+
+	case SWFragmentProgram::World3DClassicHighlight:
+		out = ShadeClassic(ctx, v, flat, true);
+		linearFog = false;
+		break;
+
+	case SWFragmentProgram::World3DSkybox:
+	{
+		SWVec4 ncolor = ctx.Samplers[0].SampleCube(v[SWVaryingTex], v[SWVaryingTex + 1], v[SWVaryingTex + 2]);
+		out = Highlight(u, ncolor, 1.0f);
+		break;
+	}
+	}
+
+	if (ctx.AlphaTest && out.w < 0.5f)
+		return false;
+
+	if (linearFog)
+		out = ApplyLinearFog(u, out, v[SWVaryingViewZ]);
+
+	return true;
+}
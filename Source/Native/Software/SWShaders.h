@@ -0,0 +1,163 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include "../Backend.h"
+#include "SWTexture.h"
+#include <cmath>
+
+struct SWVec4
+{
+	float x, y, z, w;
+
+	SWVec4() = default;
+	SWVec4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) { }
+
+	static SWVec4 FromBgra8(uint32_t c) { return SWVec4(((c >> 16) & 0xff) * (1.0f / 255.0f), ((c >> 8) & 0xff) * (1.0f / 255.0f), (c & 0xff) * (1.0f / 255.0f), (c >> 24) * (1.0f / 255.0f)); }
+
+	SWVec4 operator+(const SWVec4& b) const { return SWVec4(x + b.x, y + b.y, z + b.z, w + b.w); }
+	SWVec4 operator-(const SWVec4& b) const { return SWVec4(x - b.x, y - b.y, z - b.z, w - b.w); }
+	SWVec4 operator*(const SWVec4& b) const { return SWVec4(x * b.x, y * b.y, z * b.z, w * b.w); }
+	SWVec4 operator*(float s) const { return SWVec4(x * s, y * s, z * s, w * s); }
+};
+
+// Storage for the uniforms the shaders in Source/Core/Resources declare, filled by SetUniform through the GLSL name
+struct SWUniforms
+{
+	float projection[16];
+	float view[16];
+	float world[16];
+	float modelnormal[16];
+	SWVec4 campos;
+	SWVec4 highlightcolor;
+	SWVec4 stencilColor;
+	SWVec4 fogsettings;
+	SWVec4 fogcolor;
+	SWVec4 sectorfogcolor;
+	SWVec4 vertexColor;
+	SWVec4 rendersettings;
+	SWVec4 texturefactor;
+	SWVec4 fillColor;
+	float desaturation;
+	float lightsEnabled;
+	float ignoreNormals;
+	float useLightStrength;
+	float slopeHandleLength;
+	float skew[2];
+	float spriteAtlasGrid[2];
+	int32_t drawPaletted;
+	int32_t colormapSize[2];
+	int32_t doomlightlevels;
+	int32_t sectorLightLevel;
+	SWVec4 lightPosAndRadius[64];
+	SWVec4 lightOrientation[64];
+	SWVec4 lightColor[64];
+	float light2Radius[64][2];
+	float lightStrengthAndLinearity[64][2];
+
+	// Returns false for names the software shaders don't use
+	static bool FindField(const char* glslname, size_t& offset, size_t& size);
+};
+
+struct SWSampler
+{
+	const SWTexture* Tex = nullptr;
+	TextureFilter Filter = TextureFilter::Nearest;
+	TextureAddress Address = TextureAddress::Wrap;
+
+	SWVec4 Sample(float u, float v) const;
+	SWVec4 SampleCube(float x, float y, float z) const;
+
+private:
+	SWVec4 SampleFace(const uint32_t* pixels, float u, float v, bool clamp) const;
+};
+
+// Interpolated values passed from the vertex to the fragment programs
+enum SWVarying
+{
+	SWVaryingColor = 0,
+	SWVaryingUV = 4,
+	SWVaryingPosW = 6,
+	SWVaryingNormal = 9,
+	SWVaryingViewZ = 12,
+	SWVaryingTex = 13,
+	SWMaxVaryings = 16
+};
+
+// Values taken from the provoking vertex: flatColor rgba and flatNormal xyz
+static const int SWFlatCount = 7;
+
+enum class SWVertexProgram { Display2D, Instanced2D, World3D, World3DVertexColor, SlopeHandle, Skybox };
+
+enum class SWFragmentProgram
+{
+	Display2DNormal, Display2DFullbright, Display2DFsaa,
+	Things2DFill, Things2DThing, Things2DSprite,
+	World3DMain, World3DFullbright, World3DMainHighlight, World3DFullbrightHighlight, World3DVertexColor, World3DConstantColor,
+	World3DMainFog, World3DMainHighlightFog, World3DClassic, World3DClassicHighlight, World3DSkybox
+};
+
+struct SWVertexInput
+{
+	float x, y, z;
+	uint32_t color;
+	float u, v;
+	float nx, ny, nz;
+};
+
+struct SWInstanceInput
+{
+	float x, y, z;
+	float size, angle, sprite;
+	uint32_t color;
+};
+
+struct SWVertexOutput
+{
+	float clip[4];
+	float varyings[SWMaxVaryings];
+	float flat[SWFlatCount];
+};
+
+// Native versions of the shaders declared by the editor. Programs are found by the shader name given to DeclareShader.
+struct SWShaderProgram
+{
+	bool Valid = false;
+	SWVertexProgram Vertex = SWVertexProgram::Display2D;
+	SWFragmentProgram Fragment = SWFragmentProgram::Display2DNormal;
+	int VaryingCount = 0;
+
+	static SWShaderProgram Find(const char* name);
+};
+
+struct SWShadeContext
+{
+	SWShaderProgram Program;
+	const SWUniforms* Uniforms = nullptr;
+	SWSampler Samplers[3];
+	bool AlphaTest = false;
+};
+
+void SWRunVertexProgram(SWVertexProgram program, const SWUniforms& u, const SWVertexInput& in, const SWInstanceInput* instance, SWVertexOutput& out);
+
+// Returns false if the fragment is discarded
+bool SWRunFragmentProgram(const SWShadeContext& ctx, const float* varyings, const float* flat, SWVec4& out);
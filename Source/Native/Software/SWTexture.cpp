@@ -0,0 +1,176 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Precomp.h"
+#include "SWTexture.h"
+#include <cstring>
+#include <cmath>
+
+void SWTexture::Set2DImage(int width, int height, PixelFormat format)
+{
+	mWidth = width;
+	mHeight = height;
+	mFormat = format;
+	mCubeTexture = false;
+	mPixels.assign((size_t)width * height, 0);
+	mDepth.clear();
+	mPBO.clear();
+}
+
+void SWTexture::SetCubeImage(int size, PixelFormat format)
+{
+	mWidth = size;
+	mHeight = size;
+	mFormat = format;
+	mCubeTexture = true;
+	mPixels.assign((size_t)size * size * 6, 0);
+	mDepth.clear();
+	mPBO.clear();
+}
+
+float* SWTexture::GetDepth()
+{
+	if (mDepth.empty())
+		mDepth.assign((size_t)mWidth * mHeight, 1.0f);
+	return mDepth.data();
+}
+
+void SWTexture::SetPixels(int face, const void* data)
+{
+	ConvertToBgra8(GetPixels(face), data, (size_t)mWidth * mHeight, mFormat);
+}
+
+void* SWTexture::MapPBO()
+{
+	mPBO.resize((size_t)mWidth * mHeight);
+	return mPBO.data();
+}
+
+void SWTexture::UnmapPBO()
+{
+	// PBO uploads are always BGRA8, like the OpenGL backend
+	if (!mPBO.empty() && !mPixels.empty())
+		memcpy(GetPixels(), mPBO.data(), (size_t)mWidth * mHeight * sizeof(uint32_t));
+}
+
+static float HalfToFloat(uint16_t h)
+{
+	uint32_t sign = (h >> 15) & 1;
+	int exponent = (h >> 10) & 0x1f;
+	uint32_t mantissa = h & 0x3ff;
+	float value;
+	if (exponent == 0)
+		value = std::ldexp((float)mantissa, -24);
+	else if (exponent == 31)
+		value = mantissa ? NAN : INFINITY;
+	else
+		value = std::ldexp((float)(mantissa | 0x400), exponent - 25);
+	return sign ? -value : value;
+}
+
+static uint16_t FloatToHalf(float f)
+{
+	uint32_t bits;
+	memcpy(&bits, &f, sizeof(float));
+	uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+	int exponent = (int)((bits >> 23) & 0xff) - 127 + 15;
+	uint32_t mantissa = bits & 0x7fffff;
+	if (exponent <= 0)
+		return sign;
+	if (exponent >= 31)
+		return sign | 0x7c00;
+	return sign | (uint16_t)(exponent << 10) | (uint16_t)(mantissa >> 13);
+}
+
+static uint32_t PackBgra8(float r, float g, float b, float a)
+{
+	auto cvt = [](float v) { return (uint32_t)(std::min(std::max(v, 0.0f), 1.0f) * 255.0f + 0.5f); };
+	return (cvt(a) << 24) | (cvt(r) << 16) | (cvt(g) << 8) | cvt(b);
+}
+
+void SWTexture::ConvertToBgra8(uint32_t* dest, const void* src, size_t count, PixelFormat format)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(src);
+	const uint16_t* halfs = static_cast<const uint16_t*>(src);
+	const float* floats = static_cast<const float*>(src);
+	switch (format)
+	{
+	case PixelFormat::Bgra8:
+		memcpy(dest, src, count * sizeof(uint32_t));
+		break;
+	case PixelFormat::Rgba8:
+		for (size_t i = 0; i < count; i++)
+			dest[i] = ((uint32_t)bytes[i * 4 + 3] << 24) | ((uint32_t)bytes[i * 4] << 16) | ((uint32_t)bytes[i * 4 + 1] << 8) | bytes[i * 4 + 2];
+		break;
+	case PixelFormat::Rg16f:
+		for (size_t i = 0; i < count; i++)
+			dest[i] = PackBgra8(HalfToFloat(halfs[i * 2]), HalfToFloat(halfs[i * 2 + 1]), 0.0f, 1.0f);
+		break;
+	case PixelFormat::Rgba16f:
+		for (size_t i = 0; i < count; i++)
+			dest[i] = PackBgra8(HalfToFloat(halfs[i * 4]), HalfToFloat(halfs[i * 4 + 1]), HalfToFloat(halfs[i * 4 + 2]), HalfToFloat(halfs[i * 4 + 3]));
+		break;
+	case PixelFormat::R32f:
+		for (size_t i = 0; i < count; i++)
+			dest[i] = PackBgra8(floats[i], 0.0f, 0.0f, 1.0f);
+		break;
+	case PixelFormat::Rg32f:
+		for (size_t i = 0; i < count; i++)
+			dest[i] = PackBgra8(floats[i * 2], floats[i * 2 + 1], 0.0f, 1.0f);
+		break;
+	case PixelFormat::Rgb32f:
+		for (size_t i = 0; i < count; i++)
+			dest[i] = PackBgra8(floats[i * 3], floats[i * 3 + 1], floats[i * 3 + 2], 1.0f);
+		break;
+	case PixelFormat::Rgba32f:
+		for (size_t i = 0; i < count; i++)
+			dest[i] = PackBgra8(floats[i * 4], floats[i * 4 + 1], floats[i * 4 + 2], floats[i * 4 + 3]);
+		break;
+	default:
+		// Depth and packed 10 bit formats are never sampled as colors
+		memset(dest, 0, count * sizeof(uint32_t));
+		break;
+	}
+}
+
+void SWTexture::ConvertFromBgra8(void* dest, const uint32_t* src, size_t count, PixelFormat format)
+{
+	uint8_t* bytes = static_cast<uint8_t*>(dest);
+	uint16_t* halfs = static_cast<uint16_t*>(dest);
+	float* floats = static_cast<float*>(dest);
+	for (size_t i = 0; i < count; i++)
+	{
+		uint32_t c = src[i];
+		float r = RPART(c) * (1.0f / 255.0f), g = GPART(c) * (1.0f / 255.0f), b = BPART(c) * (1.0f / 255.0f), a = APART(c) * (1.0f / 255.0f);
+		switch (format)
+		{
+		default:
+		case PixelFormat::Bgra8: memcpy(bytes + i * 4, &c, 4); break;
+		case PixelFormat::Rgba8: bytes[i * 4] = RPART(c); bytes[i * 4 + 1] = GPART(c); bytes[i * 4 + 2] = BPART(c); bytes[i * 4 + 3] = APART(c); break;
+		case PixelFormat::Rg16f: halfs[i * 2] = FloatToHalf(r); halfs[i * 2 + 1] = FloatToHalf(g); break;
+		case PixelFormat::Rgba16f: halfs[i * 4] = FloatToHalf(r); halfs[i * 4 + 1] = FloatToHalf(g); halfs[i * 4 + 2] = FloatToHalf(b); halfs[i * 4 + 3] = FloatToHalf(a); break;
+		case PixelFormat::R32f: floats[i] = r; break;
+		case PixelFormat::Rg32f: floats[i * 2] = r; floats[i * 2 + 1] = g; break;
+		case PixelFormat::Rgb32f: floats[i * 3] = r; floats[i * 3 + 1] = g; floats[i * 3 + 2] = b; break;
+		case PixelFormat::Rgba32f: floats[i * 4] = r; floats[i * 4 + 1] = g; floats[i * 4 + 2] = b; floats[i * 4 + 3] = a; break;
+		}
+	}
+}
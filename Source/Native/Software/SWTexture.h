@@ -0,0 +1,62 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include "../Backend.h"
+#include <vector>
+
+class SWTexture : public Texture
+{
+public:
+	void Set2DImage(int width, int height, PixelFormat format) override;
+	void SetCubeImage(int size, PixelFormat format) override;
+
+	int GetWidth() const override { return mWidth; }
+	int GetHeight() const override { return mHeight; }
+	PixelFormat GetFormat() const override { return mFormat; }
+	bool IsCubeTexture() const { return mCubeTexture; }
+
+	// Pixels are stored as BGRA8 with rows bottom to top, the same layout as an OpenGL texture
+	uint32_t* GetPixels(int face = 0) { return mPixels.data() + (size_t)face * mWidth * mHeight; }
+	const uint32_t* GetPixels(int face = 0) const { return mPixels.data() + (size_t)face * mWidth * mHeight; }
+
+	// Depth buffer used when the texture is a render target with depth. Allocated on first use.
+	float* GetDepth();
+
+	// Converts from the texture's pixel format
+	void SetPixels(int face, const void* data);
+
+	void* MapPBO();
+	void UnmapPBO();
+
+	static void ConvertToBgra8(uint32_t* dest, const void* src, size_t count, PixelFormat format);
+	static void ConvertFromBgra8(void* dest, const uint32_t* src, size_t count, PixelFormat format);
+
+private:
+	int mWidth = 0;
+	int mHeight = 0;
+	PixelFormat mFormat = {};
+	bool mCubeTexture = false;
+	std::vector<uint32_t> mPixels;
+	std::vector<float> mDepth;
+	std::vector<uint32_t> mPBO;
+};
@@ -0,0 +1,583 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "Precomp.h"
+#include "SoundGraph.h"
+#include "Backend.h"
+#include "Software/SWRasterizer.h"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <queue>
+
+namespace
+{
+	// Lines per worker task when building the domains
+	const int BatchSize = 4096;
+
+	double Distance(const SoundGraphPoint& a, const SoundGraphPoint& b)
+	{
+		double dx = b.X - a.X;
+		double dy = b.Y - a.Y;
+		return std::sqrt(dx * dx + dy * dy);
+	}
+
+	// Union-find that many threads can add links to at the same time. A set is always linked
+	// below the set with the lower root, so the root of every set ends up as its lowest sector.
+	class ConcurrentSets
+	{
+	public:
+		ConcurrentSets(int count) : mParents(count)
+		{
+			for (int i = 0; i < count; i++)
+				mParents[i].store(i, std::memory_order_relaxed);
+		}
+
+		int32_t Find(int32_t x)
+		{
+			while (true)
+			{
+				int32_t parent = mParents[x].load();
+				if (parent == x)
+					return x;
+
+				// Path halving
+				int32_t grandparent = mParents[parent].load();
+				if (parent != grandparent)
+					mParents[x].compare_exchange_weak(parent, grandparent);
+				x = grandparent;
+			}
+		}
+
+		void Link(int32_t a, int32_t b)
+		{
+			while (true)
+			{
+				a = Find(a);
+				b = Find(b);
+				if (a == b)
+					return;
+
+				if (a < b)
+					std::swap(a, b);
+
+				// Fails when another thread linked a somewhere in the meantime
+				int32_t expected = a;
+				if (mParents[a].compare_exchange_strong(expected, b))
+					return;
+			}
+		}
+
+	private:
+		std::vector<std::atomic<int32_t>> mParents;
+	};
+
+	struct LeakState
+	{
+		double F, G;
+		int32_t State;
+
+		bool operator>(const LeakState& other) const { return F > other.F; }
+	};
+}
+
+SoundGraph::SoundGraph()
+{
+	mPool = SWWorkerPool::GetShared();
+}
+
+SoundGraph::~SoundGraph()
+{
+}
+
+bool SoundGraph::SetMap(const SoundGraphSector* sectors, int sectorcount, const SoundGraphLine* lines, int linecount)
+{
+	if (sectorcount < 0 || (sectorcount > 0 && !sectors))
+	{
+		SetError("Invalid sector count %d", sectorcount);
+		return false;
+	}
+
+	if (linecount < 0 || (linecount > 0 && !lines))
+	{
+		SetError("Invalid linedef count %d", linecount);
+		return false;
+	}
+
+	for (int i = 0; i < linecount; i++)
+	{
+		if (lines[i].Front < -1 || lines[i].Front >= sectorcount || lines[i].Back < -1 || lines[i].Back >= sectorcount)
+		{
+			SetError("Linedef %d references a sector out of range", i);
+			return false;
+		}
+	}
+
+	mSectors.assign(sectors, sectors + sectorcount);
+	mLines.resize(linecount);
+	for (int i = 0; i < linecount; i++)
+	{
+		const SoundGraphLine& src = lines[i];
+		Line& line = mLines[i];
+		line.Front = src.Front;
+		line.Back = src.Back;
+		line.Flags = src.Flags;
+		line.X = src.X;
+		line.Y = src.Y;
+		line.HeightBlocked = false;
+
+		// Same as the closed doors, raised lifts etc. check of the sound propagation mode
+		if (IsLinked(line))
+		{
+			const SoundGraphSector& s1 = mSectors[line.Front];
+			const SoundGraphSector& s2 = mSectors[line.Back];
+			line.HeightBlocked = s1.CeilHeight <= s2.FloorHeight || s1.FloorHeight >= s2.CeilHeight ||
+				s2.CeilHeight <= s2.FloorHeight || s1.CeilHeight <= s1.FloorHeight;
+		}
+	}
+
+	// Sector to line rows
+	mSectorLineStart.assign(sectorcount + 1, 0);
+	for (const Line& line : mLines)
+	{
+		if (IsLinked(line))
+		{
+			mSectorLineStart[line.Front + 1]++;
+			mSectorLineStart[line.Back + 1]++;
+		}
+	}
+
+	for (int i = 0; i < sectorcount; i++)
+		mSectorLineStart[i + 1] += mSectorLineStart[i];
+
+	mSectorLines.resize(mSectorLineStart[sectorcount]);
+	std::vector<int32_t> next(mSectorLineStart.begin(), mSectorLineStart.end() - 1);
+	for (int i = 0; i < linecount; i++)
+	{
+		const Line& line = mLines[i];
+		if (IsLinked(line))
+		{
+			mSectorLines[next[line.Front]++] = i;
+			mSectorLines[next[line.Back]++] = i;
+		}
+	}
+
+	mVisited.assign(sectorcount, 0);
+	mVisitGeneration = 0;
+
+	BuildDomains();
+	return true;
+}
+
+void SoundGraph::BuildDomains()
+{
+	int sectorcount = (int)mSectors.size();
+	int linecount = (int)mLines.size();
+
+	// Link the sectors on both sides of every line sound can pass
+	ConcurrentSets sets(sectorcount);
+	int batches = (linecount + BatchSize - 1) / BatchSize;
+	mPool->Run(batches, [&](int batch) {
+		int end = std::min((batch + 1) * BatchSize, linecount);
+		for (int i = batch * BatchSize; i < end; i++)
+		{
+			const Line& line = mLines[i];
+			if (IsPassable(line))
+				sets.Link(line.Front, line.Back);
+		}
+	});
+
+	std::vector<int32_t> roots(sectorcount);
+	batches = (sectorcount + BatchSize - 1) / BatchSize;
+	mPool->Run(batches, [&](int batch) {
+		int end = std::min((batch + 1) * BatchSize, sectorcount);
+		for (int i = batch * BatchSize; i < end; i++)
+			roots[i] = sets.Find(i);
+	});
+
+	// Number the domains in the order of their lowest sector. The root comes first, so it always has its domain already.
+	mDomainOf.assign(sectorcount, -1);
+	mDomains.clear();
+	mFreeDomains.clear();
+	for (int i = 0; i < sectorcount; i++)
+	{
+		if (roots[i] == i)
+		{
+			mDomainOf[i] = (int32_t)mDomains.size();
+			mDomains.emplace_back();
+		}
+		else
+		{
+			mDomainOf[i] = mDomainOf[roots[i]];
+		}
+
+		mDomains[mDomainOf[i]].push_back(i);
+	}
+}
+
+int SoundGraph::NewDomain()
+{
+	if (!mFreeDomains.empty())
+	{
+		int domain = mFreeDomains.back();
+		mFreeDomains.pop_back();
+		return domain;
+	}
+
+	mDomains.emplace_back();
+	return (int)mDomains.size() - 1;
+}
+
+bool SoundGraph::SetLineFlags(int index, int flags, int32_t* changed, int* changedcount)
+{
+	if (index < 0 || index >= (int)mLines.size())
+	{
+		SetError("Linedef index %d out of range", index);
+		return false;
+	}
+
+	*changedcount = 0;
+
+	Line& line = mLines[index];
+	bool waspassable = IsPassable(line);
+	line.Flags = flags;
+	bool passable = IsPassable(line);
+
+	if (!waspassable && passable)
+	{
+		int front = mDomainOf[line.Front];
+		int back = mDomainOf[line.Back];
+		if (front != back)
+			MergeDomains(front, back, changed, changedcount);
+	}
+	else if (waspassable && !passable)
+	{
+		SplitDomain(index, changed, changedcount);
+	}
+
+	return true;
+}
+
+void SoundGraph::MergeDomains(int a, int b, int32_t* changed, int* changedcount)
+{
+	// Move the smaller domain into the bigger one
+	if (mDomains[a].size() < mDomains[b].size())
+		std::swap(a, b);
+
+	std::vector<int32_t>& target = mDomains[a];
+	std::vector<int32_t>& source = mDomains[b];
+	for (int32_t sector : source)
+		mDomainOf[sector] = a;
+
+	size_t middle = target.size();
+	target.insert(target.end(), source.begin(), source.end());
+	std::inplace_merge(target.begin(), target.begin() + middle, target.end());
+
+	std::vector<int32_t>().swap(source);
+	mFreeDomains.push_back(b);
+
+	changed[(*changedcount)++] = a;
+	changed[(*changedcount)++] = b;
+}
+
+void SoundGraph::SplitDomain(int index, int32_t* changed, int* changedcount)
+{
+	const Line& split = mLines[index];
+	int domain = mDomainOf[split.Front];
+
+	if (++mVisitGeneration == 0)
+	{
+		std::fill(mVisited.begin(), mVisited.end(), 0);
+		mVisitGeneration = 1;
+	}
+
+	// Search for the back sector from the front sector. Nothing changes when it can still be reached.
+	mQueue.clear();
+	mQueue.push_back(split.Front);
+	mVisited[split.Front] = mVisitGeneration;
+	for (size_t i = 0; i < mQueue.size(); i++)
+	{
+		int sector = mQueue[i];
+		for (int j = mSectorLineStart[sector]; j < mSectorLineStart[sector + 1]; j++)
+		{
+			const Line& line = mLines[mSectorLines[j]];
+			if (!IsPassable(line))
+				continue;
+
+			int other = (line.Front == sector) ? line.Back : line.Front;
+			if (mVisited[other] == mVisitGeneration)
+				continue;
+
+			if (other == split.Back)
+				return;
+
+			mVisited[other] = mVisitGeneration;
+			mQueue.push_back(other);
+		}
+	}
+
+	// Everything reached from the front sector gets its own domain
+	int created = NewDomain();
+	std::vector<int32_t>& sectors = mDomains[domain];
+	sectors.erase(std::remove_if(sectors.begin(), sectors.end(), [&](int32_t sector) { return mVisited[sector] == mVisitGeneration; }), sectors.end());
+
+	std::vector<int32_t>& createdsectors = mDomains[created];
+	createdsectors.assign(mQueue.begin(), mQueue.end());
+	std::sort(createdsectors.begin(), createdsectors.end());
+	for (int32_t sector : createdsectors)
+		mDomainOf[sector] = created;
+
+	changed[(*changedcount)++] = domain;
+	changed[(*changedcount)++] = created;
+}
+
+bool SoundGraph::GetSectorDomains(int32_t* domains, int count)
+{
+	if (count != (int)mDomainOf.size())
+	{
+		SetError("Sector count %d does not match the graph", count);
+		return false;
+	}
+
+	std::copy(mDomainOf.begin(), mDomainOf.end(), domains);
+	return true;
+}
+
+bool SoundGraph::GetDomainSectors(int domain, const int32_t** sectors, int* count)
+{
+	if (domain < 0 || domain >= (int)mDomains.size())
+	{
+		SetError("Domain %d out of range", domain);
+		return false;
+	}
+
+	*sectors = mDomains[domain].data();
+	*count = (int)mDomains[domain].size();
+	return true;
+}
+
+bool SoundGraph::GetAdjacentDomains(int domain, const int32_t** domains, int* count)
+{
+	if (domain < 0 || domain >= (int)mDomains.size())
+	{
+		SetError("Domain %d out of range", domain);
+		return false;
+	}
+
+	CollectAdjacentDomains(domain);
+	*domains = mResults.data();
+	*count = (int)mResults.size();
+	return true;
+}
+
+void SoundGraph::CollectAdjacentDomains(int domain)
+{
+	mResults.clear();
+	for (int32_t sector : mDomains[domain])
+	{
+		for (int j = mSectorLineStart[sector]; j < mSectorLineStart[sector + 1]; j++)
+		{
+			const Line& line = mLines[mSectorLines[j]];
+			if (!IsBlocking(line))
+				continue;
+
+			int other = mDomainOf[(line.Front == sector) ? line.Back : line.Front];
+			if (other != domain)
+				mResults.push_back(other);
+		}
+	}
+
+	std::sort(mResults.begin(), mResults.end());
+	mResults.erase(std::unique(mResults.begin(), mResults.end()), mResults.end());
+}
+
+bool SoundGraph::FindLeak(int startsector, const SoundGraphPoint& start, int endsector, const SoundGraphPoint& end, const SoundGraphPoint** path, int* count)
+{
+	int sectorcount = (int)mSectors.size();
+	if (startsector < 0 || startsector >= sectorcount || endsector < 0 || endsector >= sectorcount)
+	{
+		SetError("Sector index out of range");
+		return false;
+	}
+
+	mPath.clear();
+	*path = mPath.data();
+	*count = 0;
+
+	if (startsector == endsector)
+	{
+		mPath.push_back(start);
+		mPath.push_back(end);
+		*path = mPath.data();
+		*count = (int)mPath.size();
+		return true;
+	}
+
+	// Sound can only get to the start domain and the domains next to it
+	int startdomain = mDomainOf[startsector];
+	std::vector<char> allowed(mDomains.size(), 0);
+	allowed[startdomain] = 1;
+	CollectAdjacentDomains(startdomain);
+	for (int32_t domain : mResults)
+		allowed[domain] = 1;
+
+	if (!allowed[mDomainOf[endsector]])
+		return true;
+
+	// A* search where the nodes are the lines, plus the start and end positions. Each node has two
+	// states: before and after passing a sound blocking line, since sound can not pass a second one.
+	int linecount = (int)mLines.size();
+	int startnode = linecount;
+	int endnode = linecount + 1;
+	int statecount = (linecount + 2) * 2;
+	mCost.assign(statecount, DBL_MAX);
+	mFrom.assign(statecount, -1);
+
+	auto position = [&](int node) -> SoundGraphPoint {
+		if (node == startnode)
+			return start;
+		else if (node == endnode)
+			return end;
+		else
+			return { mLines[node].X, mLines[node].Y };
+	};
+
+	std::priority_queue<LeakState, std::vector<LeakState>, std::greater<LeakState>> open;
+	auto visit = [&](int from, double g, int node, int blocked) {
+		int state = node * 2 + blocked;
+		if (g < mCost[state])
+		{
+			mCost[state] = g;
+			mFrom[state] = from;
+			open.push({ g + Distance(position(node), end), g, state });
+		}
+	};
+
+	visit(-1, 0.0, startnode, 0);
+	while (!open.empty())
+	{
+		LeakState current = open.top();
+		open.pop();
+		if (current.G > mCost[current.State])
+			continue;
+
+		int node = current.State / 2;
+		int blocked = current.State % 2;
+
+		if (node == endnode)
+		{
+			for (int state = current.State; state != -1; state = mFrom[state])
+				mPath.push_back(position(state / 2));
+			std::reverse(mPath.begin(), mPath.end());
+			*path = mPath.data();
+			*count = (int)mPath.size();
+			return true;
+		}
+
+		// Sound goes from a line to all lines of the sectors on both of its sides
+		SoundGraphPoint pos = position(node);
+		int sectors[2] = { startsector, -1 };
+		if (node != startnode)
+		{
+			sectors[0] = mLines[node].Front;
+			sectors[1] = mLines[node].Back;
+		}
+
+		for (int sector : sectors)
+		{
+			if (sector == -1)
+				continue;
+
+			for (int j = mSectorLineStart[sector]; j < mSectorLineStart[sector + 1]; j++)
+			{
+				int next = mSectorLines[j];
+				const Line& line = mLines[next];
+				if (next == node || line.HeightBlocked || !allowed[mDomainOf[line.Front]] || !allowed[mDomainOf[line.Back]])
+					continue;
+
+				int nextblocked = blocked + ((line.Flags & SoundGraphBlockSound) ? 1 : 0);
+				if (nextblocked > 1)
+					continue;
+
+				visit(current.State, current.G + Distance(pos, { line.X, line.Y }), next, nextblocked);
+			}
+
+			if (sector == endsector)
+				visit(current.State, current.G + Distance(pos, end), endnode, blocked);
+		}
+	}
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+extern "C"
+{
+
+SoundGraph* SoundGraph_New()
+{
+	return new SoundGraph();
+}
+
+void SoundGraph_Delete(SoundGraph* graph)
+{
+	delete graph;
+}
+
+bool SoundGraph_SetMap(SoundGraph* graph, const SoundGraphSector* sectors, int sectorcount, const SoundGraphLine* lines, int linecount)
+{
+	return graph->SetMap(sectors, sectorcount, lines, linecount);
+}
+
+bool SoundGraph_SetLineFlags(SoundGraph* graph, int line, int flags, int32_t* changed, int* changedcount)
+{
+	return graph->SetLineFlags(line, flags, changed, changedcount);
+}
+
+int SoundGraph_GetDomainCount(SoundGraph* graph)
+{
+	return graph->GetDomainCount();
+}
+
+bool SoundGraph_GetSectorDomains(SoundGraph* graph, int32_t* domains, int count)
+{
+	return graph->GetSectorDomains(domains, count);
+}
+
+bool SoundGraph_GetDomainSectors(SoundGraph* graph, int domain, const int32_t** sectors, int* count)
+{
+	return graph->GetDomainSectors(domain, sectors, count);
+}
+
+bool SoundGraph_GetAdjacentDomains(SoundGraph* graph, int domain, const int32_t** domains, int* count)
+{
+	return graph->GetAdjacentDomains(domain, domains, count);
+}
+
+bool SoundGraph_FindLeak(SoundGraph* graph, int startsector, double startx, double starty, int endsector, double endx, double endy, const SoundGraphPoint** path, int* count)
+{
+	return graph->FindLeak(startsector, { startx, starty }, endsector, { endx, endy }, path, count);
+}
+
+}
@@ -0,0 +1,120 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#pragma once
+
+class SWWorkerPool;
+
+enum SoundGraphLineFlags : int32_t
+{
+	SoundGraphBlockSound = 1 // The line has the "block sound" flag
+};
+
+struct SoundGraphSector
+{
+	int32_t FloorHeight, CeilHeight;
+};
+
+// A linedef with the sectors of its sides, or -1 for a missing side. X and Y are the middle of
+// the line, which is where the leak search lets sound pass through it.
+struct SoundGraphLine
+{
+	int32_t Front, Back;
+	int32_t Flags;
+	double X, Y;
+};
+
+struct SoundGraphPoint
+{
+	double X, Y;
+};
+
+// Finds the sound propagation domains of a map, which are the sectors sound can reach without
+// passing a sound blocking line, and the shortest path sound can take between two positions.
+// Sectors only know the two-sided lines to other sectors, stored in one array per sector
+// (compressed sparse rows), and changing the flags of a line only updates the domains on
+// both of its sides.
+class SoundGraph
+{
+public:
+	SoundGraph();
+	~SoundGraph();
+
+	bool SetMap(const SoundGraphSector* sectors, int sectorcount, const SoundGraphLine* lines, int linecount);
+
+	// Writes the domains whose sectors changed to changed. That is at most two: the domain that
+	// grew and the one that became empty when domains merge, or both halves when one splits.
+	bool SetLineFlags(int line, int flags, int32_t* changed, int* changedcount);
+
+	// Domains get reused when they become empty, so some of the ids may have no sectors
+	int GetDomainCount() const { return (int)mDomains.size(); }
+	bool GetSectorDomains(int32_t* domains, int count);
+	bool GetDomainSectors(int domain, const int32_t** sectors, int* count);
+
+	// Domains that sound reaches through one sound blocking line
+	bool GetAdjacentDomains(int domain, const int32_t** domains, int* count);
+
+	// The shortest path from the start to the end position, passing at most one sound blocking line.
+	// Count is 0 when sound can not travel between them.
+	bool FindLeak(int startsector, const SoundGraphPoint& start, int endsector, const SoundGraphPoint& end, const SoundGraphPoint** path, int* count);
+
+private:
+	struct Line
+	{
+		int32_t Front, Back;
+		int32_t Flags;
+		bool HeightBlocked;
+		double X, Y;
+	};
+
+	// The line is part of the graph, when it connects two different sectors
+	bool IsLinked(const Line& line) const { return line.Front >= 0 && line.Back >= 0 && line.Front != line.Back; }
+	bool IsPassable(const Line& line) const { return IsLinked(line) && !line.HeightBlocked && (line.Flags & SoundGraphBlockSound) == 0; }
+	bool IsBlocking(const Line& line) const { return IsLinked(line) && !line.HeightBlocked && (line.Flags & SoundGraphBlockSound) != 0; }
+
+	void BuildDomains();
+	int NewDomain();
+	void MergeDomains(int a, int b, int32_t* changed, int* changedcount);
+	void SplitDomain(int line, int32_t* changed, int* changedcount);
+	void CollectAdjacentDomains(int domain);
+
+	std::shared_ptr<SWWorkerPool> mPool;
+	std::vector<SoundGraphSector> mSectors;
+	std::vector<Line> mLines;
+
+	// The linked lines of each sector
+	std::vector<int32_t> mSectorLineStart;
+	std::vector<int32_t> mSectorLines;
+
+	std::vector<int32_t> mDomainOf;
+	std::vector<std::vector<int32_t>> mDomains;
+	std::vector<int32_t> mFreeDomains;
+
+	// Scratch space for the searches
+	std::vector<uint32_t> mVisited;
+	uint32_t mVisitGeneration = 0;
+	std::vector<int32_t> mQueue;
+	std::vector<int32_t> mResults;
+	std::vector<double> mCost;
+	std::vector<int32_t> mFrom;
+	std::vector<SoundGraphPoint> mPath;
+};
@@ -0,0 +1,1017 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Precomp.h"
+#include "SpatialIndex.h"
+#include "Backend.h"
+#include "Software/SWRasterizer.h"
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+	// Positions per worker task in the batched queries
+	const int BatchSize = 256;
+
+	// Elements per BVH leaf
+	const int LeafSize = 4;
+
+	// Larger maps get bigger grid blocks instead of more of them
+	const double MaxCells = 1 << 20;
+
+	// Linedef uses this length for lines without one
+	const double MinLength = 0.0000000001;
+}
+
+SpatialIndex::Box SpatialIndex::Box::Empty()
+{
+	return { DBL_MAX, DBL_MAX, -DBL_MAX, -DBL_MAX };
+}
+
+void SpatialIndex::Box::Add(const Box& other)
+{
+	MinX = std::min(MinX, other.MinX);
+	MinY = std::min(MinY, other.MinY);
+	MaxX = std::max(MaxX, other.MaxX);
+	MaxY = std::max(MaxY, other.MaxY);
+}
+
+double SpatialIndex::Box::DistanceSq(double x, double y) const
+{
+	double dx = std::max(std::max(MinX - x, x - MaxX), 0.0);
+	double dy = std::max(std::max(MinY - y, y - MaxY), 0.0);
+	return dx * dx + dy * dy;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+void SpatialIndex::Tree::Init(SpatialIndexType type, int blocksize)
+{
+	mType = type;
+	mBlockSize = blocksize;
+	Build({});
+}
+
+void SpatialIndex::Tree::Build(std::vector<Box> boxes)
+{
+	mBoxes = std::move(boxes);
+	if (mType == SpatialIndexType::Grid)
+		BuildGrid();
+	else
+		BuildBVH();
+}
+
+void SpatialIndex::Tree::Set(int id, const Box& box)
+{
+	if (id == (int)mBoxes.size())
+	{
+		mBoxes.push_back(Box::Empty());
+		if (mType == SpatialIndexType::BVH)
+		{
+			mLeafOf.push_back(-1);
+			mPending.push_back(id);
+		}
+	}
+
+	Box old = mBoxes[id];
+	mBoxes[id] = box;
+
+	if (mType == SpatialIndexType::Grid)
+	{
+		// Elements outside the grid would all pile up in the blocks along its border
+		if (!box.IsEmpty() && (box.MinX < mGridBounds.MinX || box.MinY < mGridBounds.MinY || box.MaxX > mGridBounds.MaxX || box.MaxY > mGridBounds.MaxY))
+		{
+			BuildGrid();
+		}
+		else
+		{
+			RemoveFromGrid(id, old);
+			AddToGrid(id, box);
+		}
+	}
+	else
+	{
+		if (mLeafOf[id] >= 0)
+			Refit(mLeafOf[id]);
+
+		if (mPending.size() > 64 + mBoxes.size() / 8)
+			BuildBVH();
+	}
+}
+
+void SpatialIndex::Tree::BuildGrid()
+{
+	Box bounds = Box::Empty();
+	for (const Box& box : mBoxes)
+		bounds.Add(box);
+	if (bounds.IsEmpty())
+		bounds = { 0.0, 0.0, 0.0, 0.0 };
+
+	// Leave room around the map so that moving things past its edge does not rebuild the grid every time
+	double margin = std::max(std::max(bounds.MaxX - bounds.MinX, bounds.MaxY - bounds.MinY) * 0.25, (double)mBlockSize);
+	mGridBounds = { bounds.MinX - margin, bounds.MinY - margin, bounds.MaxX + margin, bounds.MaxY + margin };
+
+	mCellSize = mBlockSize;
+	while (true)
+	{
+		double width = std::floor((mGridBounds.MaxX - mGridBounds.MinX) / mCellSize) + 1.0;
+		double height = std::floor((mGridBounds.MaxY - mGridBounds.MinY) / mCellSize) + 1.0;
+		if (width * height <= MaxCells)
+		{
+			mGridWidth = (int)width;
+			mGridHeight = (int)height;
+			break;
+		}
+		mCellSize *= 2.0;
+	}
+	mGridX = mGridBounds.MinX;
+	mGridY = mGridBounds.MinY;
+
+	mCells.clear();
+	mCells.resize((size_t)mGridWidth * mGridHeight);
+
+	std::vector<int32_t> counts(mCells.size());
+	for (const Box& box : mBoxes)
+	{
+		if (box.IsEmpty())
+			continue;
+		int x0 = GetCellX(box.MinX), x1 = GetCellX(box.MaxX);
+		int y0 = GetCellY(box.MinY), y1 = GetCellY(box.MaxY);
+		for (int y = y0; y <= y1; y++)
+		{
+			for (int x = x0; x <= x1; x++)
+				counts[(size_t)y * mGridWidth + x]++;
+		}
+	}
+	for (size_t i = 0; i < mCells.size(); i++)
+		mCells[i].reserve(counts[i]);
+
+	for (int id = 0; id < (int)mBoxes.size(); id++)
+		AddToGrid(id, mBoxes[id]);
+}
+
+void SpatialIndex::Tree::AddToGrid(int id, const Box& box)
+{
+	if (box.IsEmpty())
+		return;
+
+	int x0 = GetCellX(box.MinX), x1 = GetCellX(box.MaxX);
+	int y0 = GetCellY(box.MinY), y1 = GetCellY(box.MaxY);
+	for (int y = y0; y <= y1; y++)
+	{
+		for (int x = x0; x <= x1; x++)
+			mCells[(size_t)y * mGridWidth + x].push_back(id);
+	}
+}
+
+void SpatialIndex::Tree::RemoveFromGrid(int id, const Box& box)
+{
+	if (box.IsEmpty())
+		return;
+
+	int x0 = GetCellX(box.MinX), x1 = GetCellX(box.MaxX);
+	int y0 = GetCellY(box.MinY), y1 = GetCellY(box.MaxY);
+	for (int y = y0; y <= y1; y++)
+	{
+		for (int x = x0; x <= x1; x++)
+		{
+			std::vector<int32_t>& cell = mCells[(size_t)y * mGridWidth + x];
+			auto it = std::find(cell.begin(), cell.end(), id);
+			if (it != cell.end())
+			{
+				*it = cell.back();
+				cell.pop_back();
+			}
+		}
+	}
+}
+
+int SpatialIndex::Tree::GetCellX(double x) const
+{
+	double cx = std::floor((x - mGridX) / mCellSize);
+	if (!(cx >= 0.0))
+		return 0;
+	return cx < mGridWidth ? (int)cx : mGridWidth - 1;
+}
+
+int SpatialIndex::Tree::GetCellY(double y) const
+{
+	double cy = std::floor((y - mGridY) / mCellSize);
+	if (!(cy >= 0.0))
+		return 0;
+	return cy < mGridHeight ? (int)cy : mGridHeight - 1;
+}
+
+void SpatialIndex::Tree::BuildBVH()
+{
+	mNodes.clear();
+	mItems.clear();
+	mPending.clear();
+	mLeafOf.assign(mBoxes.size(), -1);
+
+	for (int id = 0; id < (int)mBoxes.size(); id++)
+	{
+		if (!mBoxes[id].IsEmpty())
+			mItems.push_back(id);
+	}
+	if (mItems.empty())
+		return;
+
+	struct Range
+	{
+		int Node, First, Count;
+	};
+
+	std::vector<Range> stack;
+	mNodes.push_back({ Box::Empty(), -1, -1, -1, 0, (int)mItems.size() });
+	stack.push_back({ 0, 0, (int)mItems.size() });
+	while (!stack.empty())
+	{
+		Range range = stack.back();
+		stack.pop_back();
+
+		Box bounds = Box::Empty();
+		Box centers = Box::Empty();
+		for (int i = range.First; i < range.First + range.Count; i++)
+		{
+			const Box& box = mBoxes[mItems[i]];
+			double cx = (box.MinX + box.MaxX) * 0.5;
+			double cy = (box.MinY + box.MaxY) * 0.5;
+			bounds.Add(box);
+			centers.Add({ cx, cy, cx, cy });
+		}
+		mNodes[range.Node].Bounds = bounds;
+
+		if (range.Count <= LeafSize)
+		{
+			for (int i = range.First; i < range.First + range.Count; i++)
+				mLeafOf[mItems[i]] = range.Node;
+			continue;
+		}
+
+		// Split at the median center along the longest axis
+		bool xaxis = (centers.MaxX - centers.MinX) >= (centers.MaxY - centers.MinY);
+		int half = range.Count / 2;
+		std::nth_element(mItems.begin() + range.First, mItems.begin() + range.First + half, mItems.begin() + range.First + range.Count, [&](int32_t a, int32_t b) {
+			const Box& boxa = mBoxes[a];
+			const Box& boxb = mBoxes[b];
+			return xaxis ? (boxa.MinX + boxa.MaxX < boxb.MinX + boxb.MaxX) : (boxa.MinY + boxa.MaxY < boxb.MinY + boxb.MaxY);
+		});
+
+		int left = (int)mNodes.size();
+		mNodes.push_back({ Box::Empty(), range.Node, -1, -1, range.First, half });
+		mNodes.push_back({ Box::Empty(), range.Node, -1, -1, range.First + half, range.Count - half });
+		mNodes[range.Node].Left = left;
+		mNodes[range.Node].Right = left + 1;
+		mNodes[range.Node].Count = 0;
+		stack.push_back({ left, range.First, half });
+		stack.push_back({ left + 1, range.First + half, range.Count - half });
+	}
+}
+
+void SpatialIndex::Tree::Refit(int node)
+{
+	while (node >= 0)
+	{
+		Node& n = mNodes[node];
+		Box bounds = Box::Empty();
+		if (n.Left == -1)
+		{
+			for (int i = n.First; i < n.First + n.Count; i++)
+				bounds.Add(mBoxes[mItems[i]]);
+		}
+		else
+		{
+			bounds = mNodes[n.Left].Bounds;
+			bounds.Add(mNodes[n.Right].Bounds);
+		}
+		n.Bounds = bounds;
+		node = n.Parent;
+	}
+}
+
+template<typename Visit>
+void SpatialIndex::Tree::Query(const Box& box, Visit&& visit) const
+{
+	if (box.IsEmpty())
+		return;
+
+	if (mType == SpatialIndexType::Grid)
+	{
+		int x0 = GetCellX(box.MinX), x1 = GetCellX(box.MaxX);
+		int y0 = GetCellY(box.MinY), y1 = GetCellY(box.MaxY);
+		for (int y = y0; y <= y1; y++)
+		{
+			for (int x = x0; x <= x1; x++)
+			{
+				for (int32_t id : mCells[(size_t)y * mGridWidth + x])
+				{
+					const Box& element = mBoxes[id];
+					if (!element.Overlaps(box))
+						continue;
+
+					// An element in several blocks is only reported by the block with the corner of the overlap
+					if (GetCellX(std::max(element.MinX, box.MinX)) == x && GetCellY(std::max(element.MinY, box.MinY)) == y)
+						visit(id);
+				}
+			}
+		}
+	}
+	else
+	{
+		if (!mNodes.empty())
+		{
+			int stack[128];
+			int stacksize = 0;
+			stack[stacksize++] = 0;
+			while (stacksize > 0)
+			{
+				const Node& node = mNodes[stack[--stacksize]];
+				if (!node.Bounds.Overlaps(box))
+					continue;
+
+				if (node.Left == -1)
+				{
+					for (int i = node.First; i < node.First + node.Count; i++)
+					{
+						if (mBoxes[mItems[i]].Overlaps(box))
+							visit(mItems[i]);
+					}
+				}
+				else
+				{
+					stack[stacksize++] = node.Left;
+					stack[stacksize++] = node.Right;
+				}
+			}
+		}
+
+		for (int32_t id : mPending)
+		{
+			if (mBoxes[id].Overlaps(box))
+				visit(id);
+		}
+	}
+}
+
+template<typename Distance>
+int SpatialIndex::Tree::Nearest(double x, double y, double maxdistance, bool squared, Distance&& distance) const
+{
+	int best = -1;
+	double bestdist = maxdistance;
+
+	auto test = [&](int id) {
+		if (mBoxes[id].IsEmpty())
+			return;
+
+		double dist = distance(id);
+		if (dist != DBL_MAX && (dist < bestdist || (dist == bestdist && (best == -1 || id < best))))
+		{
+			best = id;
+			bestdist = dist;
+		}
+	};
+
+	// Nothing outside the searched area can be closer than this
+	auto lowerbound = [&](double dist) { return squared ? dist * dist : dist; };
+
+	if (mType == SpatialIndexType::Grid)
+	{
+		int cx = GetCellX(x);
+		int cy = GetCellY(y);
+		int rings = std::max(std::max(cx, mGridWidth - 1 - cx), std::max(cy, mGridHeight - 1 - cy));
+		bool inside = x >= mGridX && y >= mGridY && x <= mGridX + mGridWidth * mCellSize && y <= mGridY + mGridHeight * mCellSize;
+
+		// Search the blocks in growing squares around the position
+		for (int ring = 0; ring <= rings; ring++)
+		{
+			if (ring > 0)
+			{
+				double mindist;
+				if (inside)
+				{
+					double left = x - (mGridX + (cx - ring + 1) * mCellSize);
+					double right = mGridX + (cx + ring) * mCellSize - x;
+					double top = y - (mGridY + (cy - ring + 1) * mCellSize);
+					double bottom = mGridY + (cy + ring) * mCellSize - y;
+					mindist = std::min(std::min(left, right), std::min(top, bottom));
+				}
+				else
+				{
+					mindist = (ring - 1) * mCellSize;
+				}
+
+				if (lowerbound(mindist) > bestdist)
+					break;
+			}
+
+			for (int by = std::max(cy - ring, 0); by <= std::min(cy + ring, mGridHeight - 1); by++)
+			{
+				bool edgerow = (by == cy - ring || by == cy + ring);
+				int step = (edgerow || ring == 0) ? 1 : ring * 2;
+				for (int bx = cx - ring; bx <= cx + ring; bx += step)
+				{
+					if (bx < 0 || bx >= mGridWidth)
+						continue;
+					for (int32_t id : mCells[(size_t)by * mGridWidth + bx])
+						test(id);
+				}
+			}
+		}
+	}
+	else
+	{
+		if (!mNodes.empty())
+		{
+			int stack[128];
+			int stacksize = 0;
+			stack[stacksize++] = 0;
+			while (stacksize > 0)
+			{
+				const Node& node = mNodes[stack[--stacksize]];
+				double boxdist = node.Bounds.DistanceSq(x, y);
+				if ((squared ? boxdist : std::sqrt(boxdist)) > bestdist)
+					continue;
+
+				if (node.Left == -1)
+				{
+					for (int i = node.First; i < node.First + node.Count; i++)
+						test(mItems[i]);
+				}
+				else
+				{
+					// Visit the nearer child first
+					double leftdist = mNodes[node.Left].Bounds.DistanceSq(x, y);
+					double rightdist = mNodes[node.Right].Bounds.DistanceSq(x, y);
+					if (leftdist < rightdist)
+					{
+						stack[stacksize++] = node.Right;
+						stack[stacksize++] = node.Left;
+					}
+					else
+					{
+						stack[stacksize++] = node.Left;
+						stack[stacksize++] = node.Right;
+					}
+				}
+			}
+		}
+
+		for (int32_t id : mPending)
+			test(id);
+	}
+
+	return best;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+SpatialIndex::SpatialIndex(SpatialIndexType type, int blocksize)
+{
+	mPool = SWWorkerPool::GetShared();
+
+	if (type != SpatialIndexType::BVH)
+		type = SpatialIndexType::Grid;
+	for (Tree& tree : mTrees)
+		tree.Init(type, std::max(blocksize, 8));
+}
+
+SpatialIndex::~SpatialIndex()
+{
+}
+
+bool SpatialIndex::SetLines(const SpatialIndexLine* lines, int count)
+{
+	if (count < 0 || (count > 0 && !lines))
+	{
+		SetError("Invalid linedef count %d", count);
+		return false;
+	}
+
+	mLines.resize(count);
+	std::vector<Box> boxes(count);
+	for (int i = 0; i < count; i++)
+	{
+		mLines[i] = MakeLine(lines[i]);
+		boxes[i] = GetLineBox(mLines[i]);
+	}
+	mTrees[(int)SpatialIndexSet::Linedefs].Build(std::move(boxes));
+	return true;
+}
+
+bool SpatialIndex::SetLine(int index, const SpatialIndexLine& line)
+{
+	if (index < 0 || index > (int)mLines.size())
+	{
+		SetError("Linedef index %d out of range", index);
+		return false;
+	}
+
+	if (index == (int)mLines.size())
+		mLines.push_back(MakeLine(line));
+	else
+		mLines[index] = MakeLine(line);
+	mTrees[(int)SpatialIndexSet::Linedefs].Set(index, GetLineBox(mLines[index]));
+	return true;
+}
+
+bool SpatialIndex::SetPoints(SpatialIndexSet set, const SpatialIndexPoint* points, int count)
+{
+	if (!CheckPointSet(set))
+		return false;
+
+	if (count < 0 || (count > 0 && !points))
+	{
+		SetError("Invalid point count %d", count);
+		return false;
+	}
+
+	std::vector<SpatialIndexPoint>& list = mPoints[(int)set - (int)SpatialIndexSet::Vertices];
+	list.assign(points, points + count);
+	std::vector<Box> boxes(count);
+	for (int i = 0; i < count; i++)
+		boxes[i] = { points[i].X, points[i].Y, points[i].X, points[i].Y };
+	mTrees[(int)set].Build(std::move(boxes));
+	return true;
+}
+
+bool SpatialIndex::SetPoint(SpatialIndexSet set, int index, const SpatialIndexPoint& point)
+{
+	if (!CheckPointSet(set))
+		return false;
+
+	std::vector<SpatialIndexPoint>& list = mPoints[(int)set - (int)SpatialIndexSet::Vertices];
+	if (index < 0 || index > (int)list.size())
+	{
+		SetError("Point index %d out of range", index);
+		return false;
+	}
+
+	if (index == (int)list.size())
+		list.push_back(point);
+	else
+		list[index] = point;
+	mTrees[(int)set].Set(index, { point.X, point.Y, point.X, point.Y });
+	return true;
+}
+
+bool SpatialIndex::SetSectors(const SpatialIndexSectorSide* sides, const int32_t* sidecounts, int count)
+{
+	if (count < 0 || (count > 0 && (!sides || !sidecounts)))
+	{
+		SetError("Invalid sector count %d", count);
+		return false;
+	}
+
+	int total = 0;
+	for (int i = 0; i < count; i++)
+	{
+		if (sidecounts[i] < 0)
+		{
+			SetError("Invalid sidedef count %d for sector %d", sidecounts[i], i);
+			return false;
+		}
+		total += sidecounts[i];
+	}
+
+	mSectorSides.assign(sides, sides + total);
+	mUsedSectorSides = total;
+	mSectors.resize(count);
+	std::vector<Box> boxes(count);
+	int first = 0;
+	for (int i = 0; i < count; i++)
+	{
+		mSectors[i] = { first, sidecounts[i] };
+		boxes[i] = GetSectorBox(mSectors[i]);
+		first += sidecounts[i];
+	}
+	mTrees[(int)SpatialIndexSet::Sectors].Build(std::move(boxes));
+	return true;
+}
+
+bool SpatialIndex::SetSector(int index, const SpatialIndexSectorSide* sides, int sidecount)
+{
+	if (index < 0 || index > (int)mSectors.size())
+	{
+		SetError("Sector index %d out of range", index);
+		return false;
+	}
+
+	if (sidecount < 0 || (sidecount > 0 && !sides))
+	{
+		SetError("Invalid sidedef count %d for sector %d", sidecount, index);
+		return false;
+	}
+
+	if (index == (int)mSectors.size())
+		mSectors.push_back({ 0, 0 });
+
+	// The new sides go at the end, the old ones are dropped when too many of them pile up
+	Sector& sector = mSectors[index];
+	mUsedSectorSides += sidecount - sector.Count;
+	sector.First = (int)mSectorSides.size();
+	sector.Count = sidecount;
+	mSectorSides.insert(mSectorSides.end(), sides, sides + sidecount);
+	if (mSectorSides.size() > (size_t)mUsedSectorSides * 2 + 4096)
+		CompactSectorSides();
+
+	mTrees[(int)SpatialIndexSet::Sectors].Set(index, GetSectorBox(mSectors[index]));
+	return true;
+}
+
+bool SpatialIndex::Remove(SpatialIndexSet set, int index)
+{
+	if ((int)set < 0 || set >= SpatialIndexSet::Count)
+	{
+		SetError("Unknown element set %d", (int)set);
+		return false;
+	}
+
+	Tree& tree = mTrees[(int)set];
+	if (index < 0 || index >= tree.GetCount())
+	{
+		SetError("Element index %d out of range", index);
+		return false;
+	}
+
+	if (set == SpatialIndexSet::Sectors)
+	{
+		mUsedSectorSides -= mSectors[index].Count;
+		mSectors[index].Count = 0;
+	}
+
+	tree.Set(index, Box::Empty());
+	return true;
+}
+
+bool SpatialIndex::NearestLines(const SpatialIndexPoint* positions, int count, double maxrange, int32_t* results)
+{
+	if (count < 0 || (count > 0 && (!positions || !results)))
+	{
+		SetError("Invalid position count %d", count);
+		return false;
+	}
+
+	const Tree& tree = mTrees[(int)SpatialIndexSet::Linedefs];
+	double maxdistance = maxrange < 0.0 ? DBL_MAX : maxrange * maxrange;
+	RunBatch(count, [&](int i) {
+		double x = positions[i].X;
+		double y = positions[i].Y;
+		results[i] = tree.Nearest(x, y, maxdistance, true, [&](int id) { return LineDistanceSq(mLines[id], x, y); });
+	});
+	return true;
+}
+
+bool SpatialIndex::NearestPoints(SpatialIndexSet set, const SpatialIndexPoint* positions, int count, double maxrange, int32_t* results)
+{
+	if (!CheckPointSet(set))
+		return false;
+
+	if (count < 0 || (count > 0 && (!positions || !results)))
+	{
+		SetError("Invalid position count %d", count);
+		return false;
+	}
+
+	const Tree& tree = mTrees[(int)set];
+	const std::vector<SpatialIndexPoint>& points = mPoints[(int)set - (int)SpatialIndexSet::Vertices];
+
+	// The manhattan distance inside the square is at most twice the range
+	double maxdistance = maxrange < 0.0 ? DBL_MAX : maxrange * 2.0;
+	RunBatch(count, [&](int i) {
+		double x = positions[i].X;
+		double y = positions[i].Y;
+		results[i] = tree.Nearest(x, y, maxdistance, false, [&](int id) {
+			const SpatialIndexPoint& p = points[id];
+			if (maxrange >= 0.0 && (p.X < x - maxrange || p.X > x + maxrange || p.Y < y - maxrange || p.Y > y + maxrange))
+				return DBL_MAX;
+			return std::abs(p.X - x) + std::abs(p.Y - y);
+		});
+	});
+	return true;
+}
+
+bool SpatialIndex::FindSectors(const SpatialIndexPoint* positions, int count, int32_t* results)
+{
+	if (count < 0 || (count > 0 && (!positions || !results)))
+	{
+		SetError("Invalid position count %d", count);
+		return false;
+	}
+
+	RunBatch(count, [&](int i) {
+		results[i] = FindSector(positions[i].X, positions[i].Y);
+	});
+	return true;
+}
+
+bool SpatialIndex::QueryRect(SpatialIndexSet set, double left, double top, double right, double bottom, const int32_t** results, int* count)
+{
+	if ((int)set < 0 || set >= SpatialIndexSet::Count)
+	{
+		SetError("Unknown element set %d", (int)set);
+		return false;
+	}
+
+	Box box = { std::min(left, right), std::min(top, bottom), std::max(left, right), std::max(top, bottom) };
+	mResults.clear();
+	if (set == SpatialIndexSet::Linedefs)
+	{
+		mTrees[(int)set].Query(box, [&](int id) {
+			if (LineTouchesBox(mLines[id], box))
+				mResults.push_back(id);
+		});
+	}
+	else
+	{
+		mTrees[(int)set].Query(box, [&](int id) { mResults.push_back(id); });
+	}
+	std::sort(mResults.begin(), mResults.end());
+
+	*results = mResults.data();
+	*count = (int)mResults.size();
+	return true;
+}
+
+void SpatialIndex::RunBatch(int count, const std::function<void(int)>& query)
+{
+	int batches = (count + BatchSize - 1) / BatchSize;
+	mPool->Run(batches, [&](int batch) {
+		int end = std::min((batch + 1) * BatchSize, count);
+		for (int i = batch * BatchSize; i < end; i++)
+			query(i);
+	});
+}
+
+bool SpatialIndex::CheckPointSet(SpatialIndexSet set) const
+{
+	if (set != SpatialIndexSet::Vertices && set != SpatialIndexSet::Things)
+	{
+		SetError("Element set %d does not hold points", (int)set);
+		return false;
+	}
+	return true;
+}
+
+SpatialIndex::Line SpatialIndex::MakeLine(const SpatialIndexLine& line)
+{
+	Line result;
+	result.X1 = line.X1;
+	result.Y1 = line.Y1;
+	result.DX = line.X2 - line.X1;
+	result.DY = line.Y2 - line.Y1;
+	double lengthsq = result.DX * result.DX + result.DY * result.DY;
+	double length = std::sqrt(lengthsq);
+	result.LengthInv = 1.0 / (length > 0.0 ? length : MinLength);
+	result.LengthSqInv = 1.0 / (lengthsq > 0.0 ? lengthsq : MinLength);
+	return result;
+}
+
+SpatialIndex::Box SpatialIndex::GetLineBox(const Line& line)
+{
+	double x2 = line.X1 + line.DX;
+	double y2 = line.Y1 + line.DY;
+	return { std::min(line.X1, x2), std::min(line.Y1, y2), std::max(line.X1, x2), std::max(line.Y1, y2) };
+}
+
+double SpatialIndex::LineDistanceSq(const Line& line, double x, double y)
+{
+	double u = ((x - line.X1) * line.DX + (y - line.Y1) * line.DY) * line.LengthSqInv;
+
+	// Like Linedef.SafeDistanceToSq the nearest point stays off the vertices, so that
+	// lines sharing a vertex are not equally far away from a position near it
+	if (line.LengthInv > 1.0)
+		u = std::max(0.0, std::min(1.0, u));
+	else
+		u = std::max(line.LengthInv, std::min(1.0 - line.LengthInv, u));
+
+	double dx = x - (line.X1 + u * line.DX);
+	double dy = y - (line.Y1 + u * line.DY);
+	return dx * dx + dy * dy;
+}
+
+bool SpatialIndex::LineTouchesBox(const Line& line, const Box& box)
+{
+	// Clip the line against each edge of the box
+	double p[4] = { -line.DX, line.DX, -line.DY, line.DY };
+	double q[4] = { line.X1 - box.MinX, box.MaxX - line.X1, line.Y1 - box.MinY, box.MaxY - line.Y1 };
+	double t0 = 0.0, t1 = 1.0;
+	for (int i = 0; i < 4; i++)
+	{
+		if (p[i] == 0.0)
+		{
+			if (q[i] < 0.0)
+				return false;
+		}
+		else
+		{
+			double t = q[i] / p[i];
+			if (p[i] < 0.0)
+			{
+				if (t > t1)
+					return false;
+				t0 = std::max(t0, t);
+			}
+			else
+			{
+				if (t < t0)
+					return false;
+				t1 = std::min(t1, t);
+			}
+		}
+	}
+	return true;
+}
+
+SpatialIndex::Box SpatialIndex::GetSectorBox(const Sector& sector) const
+{
+	Box box = Box::Empty();
+	for (int i = sector.First; i < sector.First + sector.Count; i++)
+	{
+		const SpatialIndexSectorSide& side = mSectorSides[i];
+		box.Add({ std::min(side.X1, side.X2), std::min(side.Y1, side.Y2), std::max(side.X1, side.X2), std::max(side.Y1, side.Y2) });
+	}
+	return box;
+}
+
+void SpatialIndex::CompactSectorSides()
+{
+	std::vector<SpatialIndexSectorSide> sides;
+	sides.reserve(mUsedSectorSides);
+	for (Sector& sector : mSectors)
+	{
+		int first = (int)sides.size();
+		sides.insert(sides.end(), mSectorSides.begin() + sector.First, mSectorSides.begin() + sector.First + sector.Count);
+		sector.First = first;
+	}
+	mSectorSides = std::move(sides);
+}
+
+bool SpatialIndex::SectorContains(int index, double x, double y) const
+{
+	// This is Sector.Intersect
+	const Sector& sector = mSectors[index];
+	unsigned int crossings = 0;
+	bool selfreferencing = true;
+	for (int i = sector.First; i < sector.First + sector.Count; i++)
+	{
+		const SpatialIndexSectorSide& side = mSectorSides[i];
+		double x1 = side.X1, y1 = side.Y1, x2 = side.X2, y2 = side.Y2;
+
+		// On top of a vertex counts as inside
+		if ((x == x1 && y == y1) || (x == x2 && y == y2))
+			return true;
+
+		if (side.Front != index || side.Back != index)
+			selfreferencing = false;
+
+		if (y1 != y2 && y > std::min(y1, y2) && y <= std::max(y1, y2) &&
+			(x < std::min(x1, x2) || (x <= std::max(x1, x2) && (x1 == x2 || x <= (y - y1) * (x2 - x1) / (y2 - y1) + x1))))
+		{
+			crossings++;
+		}
+	}
+
+	// Self-referencing sectors are inside out
+	return selfreferencing ? (crossings % 2 == 0) : (crossings % 2 != 0);
+}
+
+int SpatialIndex::FindSector(double x, double y) const
+{
+	const Tree& tree = mTrees[(int)SpatialIndexSet::Sectors];
+	Box box = { x, y, x, y };
+
+	int found = -1;
+	int count = 0;
+	tree.Query(box, [&](int id) {
+		if (SectorContains(id, x, y))
+		{
+			if (count == 0 || id < found)
+				found = id;
+			count++;
+		}
+	});
+
+	if (count <= 1)
+		return found;
+
+	// Overlapping sectors, from self-referencing sectors. The side of the nearest linedef picks one.
+	int nearest = -1;
+	double bestdist = DBL_MAX;
+	tree.Query(box, [&](int id) {
+		if (!SectorContains(id, x, y))
+			return;
+
+		const Sector& sector = mSectors[id];
+		for (int i = sector.First; i < sector.First + sector.Count; i++)
+		{
+			const SpatialIndexSectorSide& side = mSectorSides[i];
+			double dist = LineDistanceSq(MakeLine({ side.X1, side.Y1, side.X2, side.Y2 }), x, y);
+			if (dist < bestdist || (dist == bestdist && i < nearest))
+			{
+				nearest = i;
+				bestdist = dist;
+			}
+		}
+	});
+
+	if (nearest == -1)
+		return found;
+
+	const SpatialIndexSectorSide& side = mSectorSides[nearest];
+	double sideofline = (y - side.Y1) * (side.X2 - side.X1) - (x - side.X1) * (side.Y2 - side.Y1);
+	if (sideofline <= 0.0 && side.Front >= 0)
+		return side.Front;
+	else
+		return side.Back;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+extern "C"
+{
+
+SpatialIndex* SpatialIndex_New(SpatialIndexType type, int blocksize)
+{
+	return new SpatialIndex(type, blocksize);
+}
+
+void SpatialIndex_Delete(SpatialIndex* index)
+{
+	delete index;
+}
+
+bool SpatialIndex_SetLines(SpatialIndex* index, const SpatialIndexLine* lines, int count)
+{
+	return index->SetLines(lines, count);
+}
+
+bool SpatialIndex_SetLine(SpatialIndex* index, int element, const SpatialIndexLine* line)
+{
+	return index->SetLine(element, *line);
+}
+
+bool SpatialIndex_SetPoints(SpatialIndex* index, SpatialIndexSet set, const SpatialIndexPoint* points, int count)
+{
+	return index->SetPoints(set, points, count);
+}
+
+bool SpatialIndex_SetPoint(SpatialIndex* index, SpatialIndexSet set, int element, const SpatialIndexPoint* point)
+{
+	return index->SetPoint(set, element, *point);
+}
+
+bool SpatialIndex_SetSectors(SpatialIndex* index, const SpatialIndexSectorSide* sides, const int32_t* sidecounts, int count)
+{
+	return index->SetSectors(sides, sidecounts, count);
+}
+
+bool SpatialIndex_SetSector(SpatialIndex* index, int element, const SpatialIndexSectorSide* sides, int sidecount)
+{
+	return index->SetSector(element, sides, sidecount);
+}
+
+bool SpatialIndex_Remove(SpatialIndex* index, SpatialIndexSet set, int element)
+{
+	return index->Remove(set, element);
+}
+
+bool SpatialIndex_NearestLines(SpatialIndex* index, const SpatialIndexPoint* positions, int count, double maxrange, int32_t* results)
+{
+	return index->NearestLines(positions, count, maxrange, results);
+}
+
+bool SpatialIndex_NearestPoints(SpatialIndex* index, SpatialIndexSet set, const SpatialIndexPoint* positions, int count, double maxrange, int32_t* results)
+{
+	return index->NearestPoints(set, positions, count, maxrange, results);
+}
+
+bool SpatialIndex_FindSectors(SpatialIndex* index, const SpatialIndexPoint* positions, int count, int32_t* results)
+{
+	return index->FindSectors(positions, count, results);
+}
+
+bool SpatialIndex_QueryRect(SpatialIndex* index, SpatialIndexSet set, double left, double top, double right, double bottom, const int32_t** results, int* count)
+{
+	return index->QueryRect(set, left, top, right, bottom, results, count);
+}
+
+}
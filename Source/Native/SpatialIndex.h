@@ -0,0 +1,185 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <functional>
+
+class SWWorkerPool;
+
+enum class SpatialIndexType : int32_t
+{
+	Grid, // Uniform blocks, like the editor's BlockMap
+	BVH   // Bounding volume hierarchy, for maps where the geometry is very unevenly spread
+};
+
+enum class SpatialIndexSet : int32_t
+{
+	Linedefs,
+	Vertices,
+	Things,
+	Sectors,
+	Count
+};
+
+struct SpatialIndexPoint
+{
+	double X, Y;
+};
+
+struct SpatialIndexLine
+{
+	double X1, Y1, X2, Y2;
+};
+
+// A sidedef of a sector. The coordinates are those of its linedef and Front and Back are the
+// sectors on both sides of that linedef, or -1 when there is none.
+struct SpatialIndexSectorSide
+{
+	double X1, Y1, X2, Y2;
+	int32_t Front, Back;
+};
+
+// Finds map elements near a position or inside an area. Every element has an index in its set
+// that stays the same until the set is replaced, so the editor can update single elements.
+class SpatialIndex
+{
+public:
+	SpatialIndex(SpatialIndexType type, int blocksize);
+	~SpatialIndex();
+
+	bool SetLines(const SpatialIndexLine* lines, int count);
+	bool SetLine(int index, const SpatialIndexLine& line);
+	bool SetPoints(SpatialIndexSet set, const SpatialIndexPoint* points, int count);
+	bool SetPoint(SpatialIndexSet set, int index, const SpatialIndexPoint& point);
+	bool SetSectors(const SpatialIndexSectorSide* sides, const int32_t* sidecounts, int count);
+	bool SetSector(int index, const SpatialIndexSectorSide* sides, int sidecount);
+	bool Remove(SpatialIndexSet set, int index);
+
+	// Same distance as Linedef.SafeDistanceToSq. A negative range searches the whole map.
+	bool NearestLines(const SpatialIndexPoint* positions, int count, double maxrange, int32_t* results);
+
+	// Same as MapSet.NearestVertexSquareRange: the smallest manhattan distance inside the square range
+	bool NearestPoints(SpatialIndexSet set, const SpatialIndexPoint* positions, int count, double maxrange, int32_t* results);
+
+	// Same as Sector.Intersect. When sectors overlap the side of the nearest linedef decides.
+	bool FindSectors(const SpatialIndexPoint* positions, int count, int32_t* results);
+
+	// Lines touching the rectangle, points inside it or sectors whose bounding box overlaps it
+	bool QueryRect(SpatialIndexSet set, double left, double top, double right, double bottom, const int32_t** results, int* count);
+
+private:
+	struct Box
+	{
+		double MinX, MinY, MaxX, MaxY;
+
+		bool IsEmpty() const { return MinX > MaxX; }
+		bool Overlaps(const Box& other) const { return MinX <= other.MaxX && MaxX >= other.MinX && MinY <= other.MaxY && MaxY >= other.MinY; }
+		void Add(const Box& other);
+		double DistanceSq(double x, double y) const;
+
+		static Box Empty();
+	};
+
+	// Finds the elements by their bounding boxes, with either a grid or a BVH
+	class Tree
+	{
+	public:
+		void Init(SpatialIndexType type, int blocksize);
+		void Build(std::vector<Box> boxes);
+		void Set(int id, const Box& box);
+
+		int GetCount() const { return (int)mBoxes.size(); }
+		const Box& GetBox(int id) const { return mBoxes[id]; }
+
+		// Calls visit once for every element overlapping the box
+		template<typename Visit> void Query(const Box& box, Visit&& visit) const;
+
+		// Returns the element with the smallest distance, or -1 when none is closer than maxdistance.
+		// The distance function returns DBL_MAX for elements it skips. Equally distant elements
+		// resolve to the lowest index, so the search order does not matter.
+		template<typename Distance> int Nearest(double x, double y, double maxdistance, bool squared, Distance&& distance) const;
+
+	private:
+		struct Node
+		{
+			Box Bounds;
+			int Parent;
+			int Left, Right; // Children, or -1 for a leaf
+			int First, Count; // Items of a leaf
+		};
+
+		void BuildGrid();
+		void BuildBVH();
+		void RemoveFromGrid(int id, const Box& box);
+		void AddToGrid(int id, const Box& box);
+		void Refit(int node);
+		int GetCellX(double x) const;
+		int GetCellY(double y) const;
+
+		SpatialIndexType mType = SpatialIndexType::Grid;
+		int mBlockSize = 128;
+		std::vector<Box> mBoxes;
+
+		// Grid
+		double mGridX = 0.0, mGridY = 0.0, mCellSize = 128.0;
+		int mGridWidth = 0, mGridHeight = 0;
+		Box mGridBounds = Box::Empty();
+		std::vector<std::vector<int32_t>> mCells;
+
+		// BVH. Elements added after the build are kept in a list until there are enough for a rebuild.
+		std::vector<Node> mNodes;
+		std::vector<int32_t> mItems;
+		std::vector<int32_t> mLeafOf;
+		std::vector<int32_t> mPending;
+	};
+
+	struct Line
+	{
+		double X1, Y1, DX, DY;
+		double LengthInv, LengthSqInv;
+	};
+
+	struct Sector
+	{
+		int First, Count;
+	};
+
+	static Line MakeLine(const SpatialIndexLine& line);
+	static Box GetLineBox(const Line& line);
+	static double LineDistanceSq(const Line& line, double x, double y);
+	static bool LineTouchesBox(const Line& line, const Box& box);
+	bool SectorContains(int sector, double x, double y) const;
+	int FindSector(double x, double y) const;
+	Box GetSectorBox(const Sector& sector) const;
+	void CompactSectorSides();
+	bool CheckPointSet(SpatialIndexSet set) const;
+	void RunBatch(int count, const std::function<void(int)>& query);
+
+	std::shared_ptr<SWWorkerPool> mPool;
+	Tree mTrees[(int)SpatialIndexSet::Count];
+	std::vector<Line> mLines;
+	std::vector<SpatialIndexPoint> mPoints[2];
+	std::vector<Sector> mSectors;
+	std::vector<SpatialIndexSectorSide> mSectorSides;
+	int mUsedSectorSides = 0;
+	std::vector<int32_t> mResults;
+};
@@ -0,0 +1,585 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Precomp.h"
+#include "ThreadedRenderDevice.h"
+#include <future>
+#include <cstring>
+
+// Commands larger than this give their memory back after execution instead of keeping it for reuse
+static const size_t MaxRetainedCommandData = 256 * 1024;
+
+RenderCommandQueue::RenderCommandQueue() : mCommands(new RenderCommand[Size])
+{
+	mWritePos = 0;
+	mReadPos = 0;
+	mConsumerSleeping = false;
+	mProducerWaiting = false;
+}
+
+RenderCommand& RenderCommandQueue::BeginWrite()
+{
+	uint32_t pos = mWritePos.load(std::memory_order_relaxed);
+	WaitForReadPos(pos + 1 - Size);
+	return mCommands[pos % Size];
+}
+
+void RenderCommandQueue::EndWrite()
+{
+	// Release: the command written since BeginWrite is visible to the acquire load in BeginRead
+	mWritePos.store(mWritePos.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	WakeConsumer();
+}
+
+void RenderCommandQueue::WaitForReadPos(uint32_t pos)
+{
+	if (HasReached(pos))
+		return;
+
+	std::unique_lock<std::mutex> lock(mWaitMutex);
+	mProducerWaiting.store(true, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst); // Pairs with the fence in EndRead
+	mProducerCondition.wait(lock, [&] { return HasReached(pos); });
+	mProducerWaiting.store(false, std::memory_order_relaxed);
+}
+
+void RenderCommandQueue::WakeConsumer()
+{
+	// Pairs with the fence in BeginRead. Either the consumer sees the new write position before it sleeps,
+	// or this sees it sleeping. The notify is done under the mutex so it can't fall between its check and its wait.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (mConsumerSleeping.load(std::memory_order_relaxed))
+	{
+		std::unique_lock<std::mutex> lock(mWaitMutex);
+		mConsumerCondition.notify_one();
+	}
+}
+
+RenderCommand* RenderCommandQueue::BeginRead()
+{
+	uint32_t pos = mReadPos.load(std::memory_order_relaxed);
+	if (mWritePos.load(std::memory_order_acquire) == pos)
+	{
+		std::unique_lock<std::mutex> lock(mWaitMutex);
+		mConsumerSleeping.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst); // Pairs with the fence in WakeConsumer
+		mConsumerCondition.wait(lock, [&] { return mWritePos.load(std::memory_order_acquire) != pos; });
+		mConsumerSleeping.store(false, std::memory_order_relaxed);
+	}
+	return &mCommands[pos % Size];
+}
+
+void RenderCommandQueue::EndRead()
+{
+	// Release: the render thread is done with the slot before HasReached lets the producer overwrite it
+	mReadPos.store(mReadPos.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+	// Pairs with the fence in WaitForReadPos, the same way as WakeConsumer
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (mProducerWaiting.load(std::memory_order_relaxed))
+	{
+		std::unique_lock<std::mutex> lock(mWaitMutex);
+		mProducerCondition.notify_one();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+ThreadedRenderDevice::ThreadedRenderDevice(Backend* backend, void* disp, void* window, bool debug) : mBackend(backend)
+{
+	mHasError = false;
+
+	std::promise<bool> started;
+	std::future<bool> result = started.get_future();
+	mThread = std::thread([=, &started]() {
+		mDevice = mBackend->NewRenderDevice(disp, window, debug);
+		if (!mDevice)
+		{
+			CaptureError();
+			started.set_value(false);
+			return;
+		}
+		started.set_value(true);
+		RenderThreadMain();
+	});
+
+	mValid = result.get();
+	if (!mValid)
+	{
+		mThread.join();
+		CheckError();
+	}
+}
+
+ThreadedRenderDevice::~ThreadedRenderDevice()
+{
+	if (mValid)
+	{
+		// The backend no longer retires objects through this device, so nothing is added to the list after this
+		EnqueueRetired();
+		Enqueue([this](RenderDevice* device, const uint8_t*) { mQuit = true; return true; });
+		mThread.join();
+	}
+}
+
+void ThreadedRenderDevice::RenderThreadMain()
+{
+	while (!mQuit)
+	{
+		RenderCommand* command = mQueue.BeginRead();
+		if (!command->Execute(*command, mDevice))
+			CaptureError();
+		if (command->Data.capacity() > MaxRetainedCommandData)
+			std::vector<uint8_t>().swap(command->Data);
+		mQueue.EndRead();
+	}
+
+	mBackend->DeleteRenderDevice(mDevice);
+	mDevice = nullptr;
+}
+
+void ThreadedRenderDevice::CaptureError()
+{
+	std::string message = GetError();
+	std::unique_lock<std::mutex> lock(mErrorMutex);
+	if (!mHasError.load())
+	{
+		mError = message;
+		mHasError.store(true);
+	}
+}
+
+bool ThreadedRenderDevice::CheckError()
+{
+	if (!mHasError.load(std::memory_order_acquire))
+		return true;
+
+	std::unique_lock<std::mutex> lock(mErrorMutex);
+	SetError("%s", mError.c_str());
+	mError.clear();
+	mHasError.store(false);
+	return false;
+}
+
+void ThreadedRenderDevice::Flush()
+{
+	EnqueueRetired();
+	mQueue.WaitForReadPos(mQueue.GetWritePos());
+}
+
+void ThreadedRenderDevice::Retire(RetiredObject* object)
+{
+	std::unique_lock<std::mutex> lock(mRetiredMutex);
+	mRetired.push_back(object);
+}
+
+void ThreadedRenderDevice::EnqueueRetired()
+{
+	std::vector<RetiredObject*> retired;
+	{
+		std::unique_lock<std::mutex> lock(mRetiredMutex);
+		if (mRetired.empty())
+			return;
+		retired.swap(mRetired);
+	}
+
+	size_t count = retired.size();
+	Enqueue([=](RenderDevice*, const uint8_t* data) {
+		for (size_t i = 0; i < count; i++)
+		{
+			RetiredObject* object;
+			memcpy(&object, data + i * sizeof(RetiredObject*), sizeof(RetiredObject*));
+			object->Release();
+		}
+		return true;
+	}, retired.data(), count * sizeof(RetiredObject*));
+}
+
+int ThreadedRenderDevice::GetVertexCount(PrimitiveType type, int primitiveCount)
+{
+	static const int toVertexCount[] = { 2, 3, 1 };
+	static const int toVertexStart[] = { 0, 0, 2 };
+	return toVertexStart[(int)type] + primitiveCount * toVertexCount[(int)type];
+}
+
+void ThreadedRenderDevice::DeclareUniform(UniformName name, const char* glslname, UniformType type)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t* data) { device->DeclareUniform(name, (const char*)data, type); return true; }, glslname, strlen(glslname) + 1);
+}
+
+void ThreadedRenderDevice::DeclareShader(ShaderName index, const char* name, const char* vertexshader, const char* fragmentshader)
+{
+	size_t namelen = strlen(name) + 1;
+	size_t vertexlen = strlen(vertexshader) + 1;
+	size_t fragmentlen = strlen(fragmentshader) + 1;
+
+	std::vector<char> strings(namelen + vertexlen + fragmentlen);
+	memcpy(strings.data(), name, namelen);
+	memcpy(strings.data() + namelen, vertexshader, vertexlen);
+	memcpy(strings.data() + namelen + vertexlen, fragmentshader, fragmentlen);
+
+	Enqueue([=](RenderDevice* device, const uint8_t* data) {
+		const char* s = (const char*)data;
+		device->DeclareShader(index, s, s + namelen, s + namelen + vertexlen);
+		return true;
+	}, strings.data(), strings.size());
+}
+
+void ThreadedRenderDevice::SetShader(ShaderName name)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t*) { device->SetShader(name); return true; });
+}
+
+void ThreadedRenderDevice::SetUniform(UniformName name, const void* values, int count, int bytesize)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t* data) { device->SetUniform(name, data, count, bytesize); return true; }, values, bytesize);
+}
+
+void ThreadedRenderDevice::SetVertexBuffer(VertexBuffer* buffer)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t*) { device->SetVertexBuffer(buffer); return true; });
+}
+
+void ThreadedRenderDevice::SetIndexBuffer(IndexBuffer* buffer)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t*) { device->SetIndexBuffer(buffer); return true; });
+}
+
+void ThreadedRenderDevice::SetAlphaBlendEnable(bool value)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t*) { device->SetAlphaBlendEnable(value); return true; });
+}
+
+void ThreadedRenderDevice::SetAlphaTestEnable(bool value)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t*) { device->SetAlphaTestEnable(value); return true; });
+}
+
+void ThreadedRenderDevice::SetCullMode(Cull mode)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t*) { device->SetCullMode(mode); return true; });
+}
+
+void ThreadedRenderDevice::SetBlendOperation(BlendOperation op)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t*) { device->SetBlendOperation(op); return true; });
+}
+
+void ThreadedRenderDevice::SetSourceBlend(Blend blend)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t*) { device->SetSourceBlend(blend); return true; });
+}
+
+void ThreadedRenderDevice::SetDestinationBlend(Blend blend)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t*) { device->SetDestinationBlend(blend); return true; });
+}
+
+void ThreadedRenderDevice::SetFillMode(FillMode mode)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t*) { device->SetFillMode(mode); return true; });
+}
+
+void ThreadedRenderDevice::SetMultisampleAntialias(bool value)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t*) { device->SetMultisampleAntialias(value); return true; });
+}
+
+void ThreadedRenderDevice::SetZEnable(bool value)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t*) { device->SetZEnable(value); return true; });
+}
+
+void ThreadedRenderDevice::SetZWriteEnable(bool value)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t*) { device->SetZWriteEnable(value); return true; });
+}
+
+void ThreadedRenderDevice::SetTexture(int unit, Texture* texture)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t*) { device->SetTexture(unit, texture); return true; });
+}
+
+void ThreadedRenderDevice::SetSamplerFilter(int unit, TextureFilter minfilter, TextureFilter magfilter, MipmapFilter mipfilter, float maxanisotropy)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t*) { device->SetSamplerFilter(unit, minfilter, magfilter, mipfilter, maxanisotropy); return true; });
+}
+
+void ThreadedRenderDevice::SetSamplerState(int unit, TextureAddress address)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t*) { device->SetSamplerState(unit, address); return true; });
+}
+
+bool ThreadedRenderDevice::Draw(PrimitiveType type, int startIndex, int primitiveCount)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t*) { return device->Draw(type, startIndex, primitiveCount); });
+	return CheckError();
+}
+
+bool ThreadedRenderDevice::DrawIndexed(PrimitiveType type, int startIndex, int primitiveCount)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t*) { return device->DrawIndexed(type, startIndex, primitiveCount); });
+	return CheckError();
+}
+
+bool ThreadedRenderDevice::DrawData(PrimitiveType type, int startIndex, int primitiveCount, const void* data)
+{
+	// Only the vertices used by the draw are copied, so the copy starts at index 0
+	size_t size = GetVertexCount(type, primitiveCount) * (size_t)VertexBuffer::FlatStride;
+	const uint8_t* src = static_cast<const uint8_t*>(data) + startIndex * (size_t)VertexBuffer::FlatStride;
+	Enqueue([=](RenderDevice* device, const uint8_t* vertices) { return device->DrawData(type, 0, primitiveCount, vertices); }, src, size);
+	return CheckError();
+}
+
+void ThreadedRenderDevice::SetInstanceBuffer(VertexBuffer* buffer)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t*) { device->SetInstanceBuffer(buffer); return true; });
+}
+
+bool ThreadedRenderDevice::DrawInstanced(PrimitiveType type, int startIndex, int primitiveCount, int instanceCount)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t*) { return device->DrawInstanced(type, startIndex, primitiveCount, instanceCount); });
+	return CheckError();
+}
+
+bool ThreadedRenderDevice::StartRendering(bool clear, int backcolor, Texture* target, bool usedepthbuffer)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t*) { return device->StartRendering(clear, backcolor, target, usedepthbuffer); });
+	return CheckError();
+}
+
+bool ThreadedRenderDevice::StartCubeRendering(bool clear, int backcolor, Texture* target, CubeMapFace face)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t*) { return device->StartCubeRendering(clear, backcolor, target, face); });
+	return CheckError();
+}
+
+bool ThreadedRenderDevice::FinishRendering()
+{
+	Enqueue([=](RenderDevice* device, const uint8_t*) { return device->FinishRendering(); });
+	return CheckError();
+}
+
+bool ThreadedRenderDevice::Present()
+{
+	EnqueueRetired();
+	Enqueue([=](RenderDevice* device, const uint8_t*) { return device->Present(); });
+
+	// Let the render thread present this frame while the UI thread records the next one
+	uint32_t pos = mQueue.GetWritePos();
+	if (mPresented)
+		mQueue.WaitForReadPos(mLastPresentPos);
+	mLastPresentPos = pos;
+	mPresented = true;
+
+	return CheckError();
+}
+
+bool ThreadedRenderDevice::ClearTexture(int backcolor, Texture* texture)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t*) { return device->ClearTexture(backcolor, texture); });
+	return CheckError();
+}
+
+bool ThreadedRenderDevice::CopyTexture(Texture* dst, CubeMapFace face)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t*) { return device->CopyTexture(dst, face); });
+	return CheckError();
+}
+
+bool ThreadedRenderDevice::SetVertexBufferData(VertexBuffer* buffer, void* data, int64_t size, VertexFormat format)
+{
+	bool hasdata = data != nullptr;
+	Enqueue([=](RenderDevice* device, const uint8_t* vertices) { return device->SetVertexBufferData(buffer, hasdata ? (void*)vertices : nullptr, size, format); }, data, (size_t)size);
+	return CheckError();
+}
+
+bool ThreadedRenderDevice::SetVertexBufferSubdata(VertexBuffer* buffer, int64_t destOffset, void* data, int64_t size)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t* vertices) { return device->SetVertexBufferSubdata(buffer, destOffset, (void*)vertices, size); }, data, (size_t)size);
+	return CheckError();
+}
+
+bool ThreadedRenderDevice::SetIndexBufferData(IndexBuffer* buffer, void* data, int64_t size)
+{
+	bool hasdata = data != nullptr;
+	Enqueue([=](RenderDevice* device, const uint8_t* indices) { return device->SetIndexBufferData(buffer, hasdata ? (void*)indices : nullptr, size); }, data, (size_t)size);
+	return CheckError();
+}
+
+bool ThreadedRenderDevice::SetPixels(Texture* texture, const void* data)
+{
+	bool hasdata = data != nullptr;
+	size_t size = (size_t)texture->GetWidth() * texture->GetHeight() * Texture::GetBytesPerPixel(texture->GetFormat());
+	Enqueue([=](RenderDevice* device, const uint8_t* pixels) { return device->SetPixels(texture, hasdata ? pixels : nullptr); }, data, size);
+	return CheckError();
+}
+
+bool ThreadedRenderDevice::SetCubePixels(Texture* texture, CubeMapFace face, const void* data)
+{
+	bool hasdata = data != nullptr;
+	size_t size = (size_t)texture->GetWidth() * texture->GetHeight() * Texture::GetBytesPerPixel(texture->GetFormat());
+	Enqueue([=](RenderDevice* device, const uint8_t* pixels) { return device->SetCubePixels(texture, face, hasdata ? pixels : nullptr); }, data, size);
+	return CheckError();
+}
+
+void* ThreadedRenderDevice::MapPBO(Texture* texture)
+{
+	// The caller writes into the mapping right away, so this has to wait for the render thread
+	void* buffer = nullptr;
+	void** result = &buffer;
+	Enqueue([=](RenderDevice* device, const uint8_t*) { *result = device->MapPBO(texture); return *result != nullptr; });
+	Flush();
+	if (!buffer)
+		CheckError();
+	return buffer;
+}
+
+bool ThreadedRenderDevice::UnmapPBO(Texture* texture)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t*) { return device->UnmapPBO(texture); });
+	return CheckError();
+}
+
+bool ThreadedRenderDevice::ReadPixelsAsync(Texture* target, PixelFormat format)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t*) { return device->ReadPixelsAsync(target, format); });
+	return CheckError();
+}
+
+bool ThreadedRenderDevice::MapReadback(Texture* target, bool wait, void** data)
+{
+	// The caller reads from the mapping right away, so this has to wait for the render thread
+	*data = nullptr;
+	Enqueue([=](RenderDevice* device, const uint8_t*) { return device->MapReadback(target, wait, data); });
+	Flush();
+	return CheckError();
+}
+
+bool ThreadedRenderDevice::UnmapReadback(Texture* target)
+{
+	Enqueue([=](RenderDevice* device, const uint8_t*) { return device->UnmapReadback(target); });
+	return CheckError();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+RenderDevice* ThreadedBackend::NewRenderDevice(void* disp, void* window, bool debug)
+{
+	return mBackend->NewRenderDevice(disp, window, debug);
+}
+
+RenderDevice* ThreadedBackend::NewOffscreenRenderDevice(int width, int height, bool debug)
+{
+	return mBackend->NewOffscreenRenderDevice(width, height, debug);
+}
+
+RenderDevice* ThreadedBackend::NewThreadedRenderDevice(void* disp, void* window, bool debug)
+{
+	ThreadedRenderDevice* device = new ThreadedRenderDevice(mBackend.get(), disp, window, debug);
+	if (!device->IsValid())
+	{
+		delete device;
+		return nullptr;
+	}
+	else
+	{
+		std::unique_lock<std::mutex> lock(mThreadedDevicesMutex);
+		mThreadedDevices.push_back(device);
+		return device;
+	}
+}
+
+void ThreadedBackend::DeleteRenderDevice(RenderDevice* device)
+{
+	bool threaded = false;
+	{
+		std::unique_lock<std::mutex> lock(mThreadedDevicesMutex);
+		auto it = std::find(mThreadedDevices.begin(), mThreadedDevices.end(), device);
+		if (it != mThreadedDevices.end())
+		{
+			mThreadedDevices.erase(it);
+			threaded = true;
+		}
+	}
+
+	if (threaded)
+		delete device;
+	else
+		mBackend->DeleteRenderDevice(device);
+}
+
+template<typename T>
+void ThreadedBackend::Retire(T* object, void(*release)(Backend*, T*))
+{
+	struct RetiredResource : RetiredObject
+	{
+		RetiredResource(int refcount, Backend* owner, T* object, void(*release)(Backend*, T*)) : RetiredObject(refcount), Owner(owner), Object(object), ReleaseFunc(release) { }
+		~RetiredResource() { ReleaseFunc(Owner, Object); }
+
+		Backend* Owner;
+		T* Object;
+		void(*ReleaseFunc)(Backend*, T*);
+	};
+
+	// Held while handing the object to the devices so that none of them can be deleted before it has its reference
+	std::unique_lock<std::mutex> lock(mThreadedDevicesMutex);
+	if (mThreadedDevices.empty())
+	{
+		lock.unlock();
+		release(mBackend.get(), object);
+		return;
+	}
+
+	RetiredResource* retired = new RetiredResource((int)mThreadedDevices.size(), mBackend.get(), object, release);
+	for (ThreadedRenderDevice* device : mThreadedDevices)
+		device->Retire(retired);
+}
+
+VertexBuffer* ThreadedBackend::NewVertexBuffer()
+{
+	return mBackend->NewVertexBuffer();
+}
+
+void ThreadedBackend::DeleteVertexBuffer(VertexBuffer* buffer)
+{
+	Retire<VertexBuffer>(buffer, [](Backend* backend, VertexBuffer* object) { backend->DeleteVertexBuffer(object); });
+}
+
+IndexBuffer* ThreadedBackend::NewIndexBuffer()
+{
+	return mBackend->NewIndexBuffer();
+}
+
+void ThreadedBackend::DeleteIndexBuffer(IndexBuffer* buffer)
+{
+	Retire<IndexBuffer>(buffer, [](Backend* backend, IndexBuffer* object) { backend->DeleteIndexBuffer(object); });
+}
+
+Texture* ThreadedBackend::NewTexture()
+{
+	return mBackend->NewTexture();
+}
+
+void ThreadedBackend::DeleteTexture(Texture* texture)
+{
+	Retire<Texture>(texture, [](Backend* backend, Texture* object) { backend->DeleteTexture(object); });
+}
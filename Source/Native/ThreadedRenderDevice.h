@@ -0,0 +1,239 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include "Backend.h"
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <type_traits>
+#include <new>
+#include <list>
+#include <mutex>
+#include <vector>
+
+// A command recorded by the UI thread and executed on the render thread.
+// The callable is stored inline in Storage. Data holds a copy of any memory the caller
+// only guarantees to be valid for the duration of the call (vertex data, pixels, uniforms).
+struct RenderCommand
+{
+	typedef bool(*ExecuteFunc)(RenderCommand& command, RenderDevice* device);
+
+	ExecuteFunc Execute = nullptr;
+	alignas(8) uint8_t Storage[48];
+	std::vector<uint8_t> Data;
+};
+
+// Single producer, single consumer ring of commands. The UI thread is the only producer
+// and the render thread the only consumer, so the read and write positions are plain atomics.
+// Each position is stored with release by its owner and loaded with acquire by the other thread,
+// which publishes the command contents (and hands a slot back) without a lock. The sleeping and
+// waiting flags use seq_cst fences so a thread is never put to sleep after missing a wake up.
+class RenderCommandQueue
+{
+public:
+	RenderCommandQueue();
+
+	static const uint32_t Size = 4096;
+
+	RenderCommand& BeginWrite();
+	void EndWrite();
+	uint32_t GetWritePos() const { return mWritePos.load(std::memory_order_relaxed); }
+	void WaitForReadPos(uint32_t pos);
+
+	RenderCommand* BeginRead();
+	void EndRead();
+
+	void WakeConsumer();
+
+private:
+	bool HasReached(uint32_t pos) const { return (int32_t)(mReadPos.load(std::memory_order_acquire) - pos) >= 0; }
+
+	// The queue is allocated with plain new, which doesn't honor alignas beyond the default alignment in C++14.
+	// The positions are kept on separate cache lines by padding instead.
+	static const size_t CacheLineSize = 64;
+
+	std::unique_ptr<RenderCommand[]> mCommands;
+
+	std::atomic<uint32_t> mWritePos;
+	uint8_t mWritePadding[CacheLineSize];
+	std::atomic<uint32_t> mReadPos;
+	uint8_t mReadPadding[CacheLineSize];
+
+	// Only used to put a thread to sleep. Commands never pass through the mutex.
+	std::mutex mWaitMutex;
+	std::condition_variable mConsumerCondition;
+	std::condition_variable mProducerCondition;
+	std::atomic<bool> mConsumerSleeping;
+	std::atomic<bool> mProducerWaiting;
+};
+
+// A buffer or texture deleted while threaded devices exist. Each device drops its reference on its render thread
+// once the commands recorded before the deletion have executed, and the last one frees the object.
+class RetiredObject
+{
+public:
+	RetiredObject(int refcount) : mRefCount(refcount) { }
+	virtual ~RetiredObject() = default;
+
+	void Release() { if (mRefCount.fetch_sub(1) == 1) delete this; }
+
+private:
+	std::atomic<int> mRefCount;
+};
+
+// Runs a RenderDevice of another backend on a dedicated thread that owns its context.
+// Calls are recorded into a RenderCommandQueue and return immediately. Errors from the
+// render thread are reported by the next call that returns a bool.
+class ThreadedRenderDevice : public RenderDevice
+{
+public:
+	ThreadedRenderDevice(Backend* backend, void* disp, void* window, bool debug);
+	~ThreadedRenderDevice();
+
+	bool IsValid() const { return mValid; }
+
+	void DeclareUniform(UniformName name, const char* glslname, UniformType type) override;
+	void DeclareShader(ShaderName index, const char* name, const char* vertexshader, const char* fragmentshader) override;
+	void SetShader(ShaderName name) override;
+	void SetUniform(UniformName name, const void* values, int count, int bytesize) override;
+	void SetVertexBuffer(VertexBuffer* buffer) override;
+	void SetIndexBuffer(IndexBuffer* buffer) override;
+	void SetAlphaBlendEnable(bool value) override;
+	void SetAlphaTestEnable(bool value) override;
+	void SetCullMode(Cull mode) override;
+	void SetBlendOperation(BlendOperation op) override;
+	void SetSourceBlend(Blend blend) override;
+	void SetDestinationBlend(Blend blend) override;
+	void SetFillMode(FillMode mode) override;
+	void SetMultisampleAntialias(bool value) override;
+	void SetZEnable(bool value) override;
+	void SetZWriteEnable(bool value) override;
+	void SetTexture(int unit, Texture* texture) override;
+	void SetSamplerFilter(int unit, TextureFilter minfilter, TextureFilter magfilter, MipmapFilter mipfilter, float maxanisotropy) override;
+	void SetSamplerState(int unit, TextureAddress address) override;
+	bool Draw(PrimitiveType type, int startIndex, int primitiveCount) override;
+	bool DrawIndexed(PrimitiveType type, int startIndex, int primitiveCount) override;
+	bool DrawData(PrimitiveType type, int startIndex, int primitiveCount, const void* data) override;
+	void SetInstanceBuffer(VertexBuffer* buffer) override;
+	bool DrawInstanced(PrimitiveType type, int startIndex, int primitiveCount, int instanceCount) override;
+	bool StartRendering(bool clear, int backcolor, Texture* target, bool usedepthbuffer) override;
+	bool StartCubeRendering(bool clear, int backcolor, Texture* target, CubeMapFace face) override;
+	bool FinishRendering() override;
+	bool Present() override;
+	bool ClearTexture(int backcolor, Texture* texture) override;
+	bool CopyTexture(Texture* dst, CubeMapFace face) override;
+	bool SetVertexBufferData(VertexBuffer* buffer, void* data, int64_t size, VertexFormat format) override;
+	bool SetVertexBufferSubdata(VertexBuffer* buffer, int64_t destOffset, void* data, int64_t size) override;
+	bool SetIndexBufferData(IndexBuffer* buffer, void* data, int64_t size) override;
+	bool SetPixels(Texture* texture, const void* data) override;
+	bool SetCubePixels(Texture* texture, CubeMapFace face, const void* data) override;
+	void* MapPBO(Texture* texture) override;
+	bool UnmapPBO(Texture* texture) override;
+	bool ReadPixelsAsync(Texture* target, PixelFormat format) override;
+	bool MapReadback(Texture* target, bool wait, void** data) override;
+	bool UnmapReadback(Texture* target) override;
+
+	// Records a callable taking (RenderDevice*, const uint8_t* data) and returning false on error
+	template<typename T>
+	void Enqueue(const T& func, const void* data = nullptr, size_t size = 0)
+	{
+		static_assert(sizeof(T) <= sizeof(RenderCommand::Storage), "Render command does not fit in the command storage");
+		static_assert(std::is_trivially_copyable<T>::value && std::is_trivially_destructible<T>::value, "Render commands must be trivially copyable");
+
+		RenderCommand& command = mQueue.BeginWrite();
+		new(command.Storage) T(func);
+		command.Execute = [](RenderCommand& cmd, RenderDevice* device) -> bool { return (*reinterpret_cast<T*>(cmd.Storage))(device, cmd.Data.data()); };
+		if (data)
+			command.Data.assign(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+		else
+			command.Data.clear();
+		mQueue.EndWrite();
+	}
+
+	// Blocks until the render thread has executed everything recorded so far
+	void Flush();
+
+	// Can be called from any thread, including the .NET finalizer. The command queue only has one producer,
+	// so the object is held in a separate list until the UI thread moves it onto the queue in Present or Flush.
+	void Retire(RetiredObject* object);
+
+private:
+	void RenderThreadMain();
+	void EnqueueRetired();
+	void CaptureError();
+	bool CheckError();
+
+	static int GetVertexCount(PrimitiveType type, int primitiveCount);
+
+	Backend* mBackend = nullptr;
+	RenderCommandQueue mQueue;
+	std::thread mThread;
+	bool mValid = false;
+
+	// Frames are double buffered: Present waits for the previous frame, never the one just recorded
+	uint32_t mLastPresentPos = 0;
+	bool mPresented = false;
+
+	// Render thread only
+	RenderDevice* mDevice = nullptr;
+	bool mQuit = false;
+
+	std::atomic<bool> mHasError;
+	std::mutex mErrorMutex;
+	std::string mError;
+
+	std::mutex mRetiredMutex;
+	std::vector<RetiredObject*> mRetired;
+};
+
+// Forwards to another backend and orders resource deletion with the command queues of
+// any threaded devices, so a buffer or texture is never freed while a queued command still uses it.
+class ThreadedBackend : public Backend
+{
+public:
+	ThreadedBackend(Backend* backend) : mBackend(backend) { }
+
+	RenderDevice* NewRenderDevice(void* disp, void* window, bool debug) override;
+	RenderDevice* NewThreadedRenderDevice(void* disp, void* window, bool debug);
+	RenderDevice* NewOffscreenRenderDevice(int width, int height, bool debug) override;
+	void DeleteRenderDevice(RenderDevice* device) override;
+
+	VertexBuffer* NewVertexBuffer() override;
+	void DeleteVertexBuffer(VertexBuffer* buffer) override;
+
+	IndexBuffer* NewIndexBuffer() override;
+	void DeleteIndexBuffer(IndexBuffer* buffer) override;
+
+	Texture* NewTexture() override;
+	void DeleteTexture(Texture* texture) override;
+
+private:
+	template<typename T>
+	void Retire(T* object, void(*release)(Backend*, T*));
+
+	std::unique_ptr<Backend> mBackend;
+
+	// Deletions may come from any thread
+	std::mutex mThreadedDevicesMutex;
+	std::list<ThreadedRenderDevice*> mThreadedDevices;
+};
@@ -0,0 +1,998 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Precomp.h"
+#include "Triangulator.h"
+#include "Backend.h"
+#include "Software/SWRasterizer.h"
+#include <cmath>
+#include <cfloat>
+#include <deque>
+
+namespace
+{
+	const double PI = 3.14159265358979323846;
+	const double PIHALF = PI * 0.5;
+	const double PI2 = PI * 2.0;
+
+	// The managed code compares against float literals
+	const double Epsilon = 0.00001f;
+	const double Bonus = 0.1f;
+
+	struct Vec2
+	{
+		double x, y;
+
+		bool operator==(const Vec2& other) const { return x == other.x && y == other.y; }
+		bool operator!=(const Vec2& other) const { return x != other.x || y != other.y; }
+	};
+
+	double GetSideOfLine(const Vec2& v1, const Vec2& v2, const Vec2& p)
+	{
+		return (p.y - v1.y) * (v2.x - v1.x) - (p.x - v1.x) * (v2.y - v1.y);
+	}
+
+	double GetNearestOnLine(const Vec2& v1, const Vec2& v2, const Vec2& p)
+	{
+		double dx = v2.x - v1.x;
+		double dy = v2.y - v1.y;
+		return ((p.x - v1.x) * dx + (p.y - v1.y) * dy) / (dx * dx + dy * dy);
+	}
+
+	Vec2 GetCoordinatesAt(const Vec2& v1, const Vec2& v2, double u)
+	{
+		return { v1.x + u * (v2.x - v1.x), v1.y + u * (v2.y - v1.y) };
+	}
+
+	// Line2D.GetIntersection. u_ray is the position along the ray (x3,y3)-(x4,y4).
+	bool GetIntersection(const Vec2& v1, const Vec2& v2, const Vec2& r1, const Vec2& r2, double& u_ray, double& u_line)
+	{
+		double div = (r2.y - r1.y) * (v2.x - v1.x) - (r2.x - r1.x) * (v2.y - v1.y);
+		if (div != 0.0)
+		{
+			u_line = ((r2.x - r1.x) * (v1.y - r1.y) - (r2.y - r1.y) * (v1.x - r1.x)) / div;
+			u_ray = ((v2.x - v1.x) * (v1.y - r1.y) - (v2.y - v1.y) * (v1.x - r1.x)) / div;
+			return !(u_ray < 0.0 || u_ray > 1.0 || u_line < 0.0 || u_line > 1.0);
+		}
+
+		u_line = NAN;
+		u_ray = NAN;
+		return false;
+	}
+
+	double Normalized(double a)
+	{
+		while (a < 0.0) a += PI2;
+		while (a >= PI2) a -= PI2;
+		return a;
+	}
+
+	double AngleDifference(double a, double b)
+	{
+		double d = Normalized(a) - Normalized(b);
+		if (d < 0.0) d += PI2;
+		if (d > PI) d = PI2 - d;
+		return d;
+	}
+
+	double GetLineAngle(const Vec2& v1, const Vec2& v2)
+	{
+		return -std::atan2(-(v2.y - v1.y), v2.x - v1.x) + PIHALF;
+	}
+
+	struct PolygonVertex
+	{
+		Vec2 pos;
+		int32_t side;
+	};
+
+	struct Polygon
+	{
+		std::vector<PolygonVertex> points;
+		std::vector<int> children;
+		bool inner = false;
+	};
+
+	// Ear clipping state of a vertex. The main list is circular, the reflex and ear tip lists are not.
+	struct EarVertex
+	{
+		Vec2 pos;
+		int32_t side;
+		int prev, next;
+		int reflexprev, reflexnext;
+		int earprev, earnext;
+		bool isreflex;
+		bool isear;
+	};
+
+	class SectorTriangulator
+	{
+	public:
+		SectorTriangulator(const TriangulatorSide* sides, int count, TriangulatorResult& result) : sides(sides), count(count), result(result) { }
+
+		void Run()
+		{
+			result.Islands.clear();
+			result.Vertices.clear();
+			result.Sides.clear();
+
+			// Tracing
+			std::vector<int> polys = DoTrace();
+
+			// Cutting
+			DoCutting(polys);
+
+			// Ear clipping
+			for (int p : polys)
+				result.Islands.push_back(DoEarClip(polygons[p]));
+		}
+
+	private:
+		/////////////////////////////////////////////////////////////////////
+		// Tracing
+
+		struct Link
+		{
+			int32_t vertex;
+			int32_t order;
+			int32_t side;
+		};
+
+		struct TraceFrame
+		{
+			int32_t vertex;
+			Vec2 pos;
+			std::vector<int> candidates;
+			size_t next;
+		};
+
+		int32_t FromVertex(int side) const { return sides[side].Front ? sides[side].Start : sides[side].End; }
+		int32_t ToVertex(int side) const { return sides[side].Front ? sides[side].End : sides[side].Start; }
+		Vec2 StartPos(int side) const { return { sides[side].X1, sides[side].Y1 }; }
+		Vec2 EndPos(int side) const { return { sides[side].X2, sides[side].Y2 }; }
+		Vec2 ToPos(int side) const { return sides[side].Front ? EndPos(side) : StartPos(side); }
+
+		bool IsIgnored(int32_t vertex) const
+		{
+			return std::find(ignores.begin(), ignores.end(), vertex) != ignores.end();
+		}
+
+		std::vector<int> DoTrace()
+		{
+			std::vector<int> root;
+
+			// First remove all sides that refer to the same sector on both sides of the line
+			std::vector<int> todo;
+			todo.reserve(count);
+			for (int i = 0; i < count; i++)
+			{
+				if (!sides[i].Skip)
+					todo.push_back(i);
+			}
+
+			intodo.assign(count, 0);
+			visited.assign(count, 0);
+			for (int i : todo)
+				intodo[i] = 1;
+
+			// Sides leaving each vertex, in the order the vertex lists its linedefs
+			links.clear();
+			for (int i : todo)
+				links.push_back({ FromVertex(i), sides[i].Order, i });
+			std::stable_sort(links.begin(), links.end(), [](const Link& a, const Link& b) { return a.vertex != b.vertex ? a.vertex < b.vertex : a.order < b.order; });
+
+			// Continue until all sidedefs have been processed
+			while (!todo.empty())
+			{
+				// Reset all visited indicators
+				for (int i : todo)
+					visited[i] = 0;
+
+				// Find the right-most vertex to start a trace with
+				int32_t start;
+				Vec2 startpos;
+				if (!FindRightMostVertex(todo, start, startpos))
+					break;
+
+				std::vector<int> path;
+				if (!TracePath(start, startpos, path))
+				{
+					// Sector not closed here. Try again with another start.
+					ignores.push_back(start);
+				}
+				else
+				{
+					// Remove the sides found in the path
+					for (int s : path)
+						intodo[s] = 0;
+					todo.erase(std::remove_if(todo.begin(), todo.end(), [&](int s) { return !intodo[s]; }), todo.end());
+
+					// Create the polygon
+					int newpoly = (int)polygons.size();
+					polygons.push_back(Polygon());
+					for (int s : path)
+						polygons[newpoly].points.push_back({ ToPos(s), s });
+
+					// Determine where this polygon goes in our tree
+					bool inserted = false;
+					for (int p : root)
+					{
+						if (InsertChild(p, newpoly))
+						{
+							inserted = true;
+							break;
+						}
+					}
+
+					// Then add it at root level as outer polygon
+					if (!inserted)
+					{
+						polygons[newpoly].inner = false;
+						root.push_back(newpoly);
+					}
+				}
+			}
+
+			return root;
+		}
+
+		bool FindRightMostVertex(const std::vector<int>& todo, int32_t& found, Vec2& foundpos) const
+		{
+			bool hasfound = false;
+			for (int i : todo)
+			{
+				const TriangulatorSide& sd = sides[i];
+				if (!hasfound && !IsIgnored(sd.Start)) { found = sd.Start; foundpos = StartPos(i); hasfound = true; }
+				if (!hasfound && !IsIgnored(sd.End)) { found = sd.End; foundpos = EndPos(i); hasfound = true; }
+
+				if (hasfound)
+				{
+					if (sd.X1 > foundpos.x && !IsIgnored(sd.Start)) { found = sd.Start; foundpos = StartPos(i); }
+					if (sd.X2 > foundpos.x && !IsIgnored(sd.End)) { found = sd.End; foundpos = EndPos(i); }
+				}
+			}
+			return hasfound;
+		}
+
+		// Relative angle used by SidedefAngleSorter
+		double CalculateRelativeAngle(int a, int b, int32_t basevertex, const Vec2& basepos) const
+		{
+			const TriangulatorSide& sa = sides[a];
+			const TriangulatorSide& sb = sides[b];
+
+			double ana = sa.Angle; if (sa.End == basevertex) ana += PI;
+			double anb = sb.Angle; if (sb.End == basevertex) anb += PI;
+
+			double n = AngleDifference(ana, anb);
+
+			Vec2 va = (sa.Start == basevertex) ? EndPos(a) : StartPos(a);
+			Vec2 vb = (sb.Start == basevertex) ? EndPos(b) : StartPos(b);
+
+			bool dir = sa.Front != 0;
+			if (sa.End == basevertex) dir = !dir;
+
+			double s = GetSideOfLine(va, vb, basepos);
+			if ((s < 0) && dir) n = PI2 - n;
+			if ((s > 0) && !dir) n = PI2 - n;
+			return n;
+		}
+
+		void FindCandidates(int32_t vertex, const Vec2& pos, int previous, std::vector<int>& candidates) const
+		{
+			candidates.clear();
+			auto range = std::equal_range(links.begin(), links.end(), Link{ vertex, 0, 0 }, [](const Link& a, const Link& b) { return a.vertex < b.vertex; });
+			for (auto it = range.first; it != range.second; ++it)
+			{
+				if (intodo[it->side] && !visited[it->side])
+					candidates.push_back(it->side);
+			}
+
+			// Continue along the smallest delta angle when more than two sides share the vertex
+			if (previous != -1 && candidates.size() > 1)
+			{
+				sortkeys.clear();
+				for (int s : candidates)
+					sortkeys.push_back(std::make_pair(CalculateRelativeAngle(previous, s, vertex, pos), s));
+				std::stable_sort(sortkeys.begin(), sortkeys.end(), [](const std::pair<double, int>& a, const std::pair<double, int>& b) { return a.first > b.first; });
+				for (size_t i = 0; i < candidates.size(); i++)
+					candidates[i] = sortkeys[i].second;
+			}
+		}
+
+		// Depth first search for a closed path back to the start vertex
+		bool TracePath(int32_t start, const Vec2& startpos, std::vector<int>& path)
+		{
+			std::vector<TraceFrame> frames;
+			frames.push_back({ start, startpos, {}, 0 });
+			FindCandidates(start, startpos, -1, frames.back().candidates);
+
+			while (!frames.empty())
+			{
+				TraceFrame& frame = frames.back();
+				if (frame.next == frame.candidates.size())
+				{
+					frames.pop_back();
+					if (!path.empty())
+						path.pop_back();
+					continue;
+				}
+
+				int s = frame.candidates[frame.next++];
+				visited[s] = 1;
+				path.push_back(s);
+
+				int32_t nextvertex = (sides[s].Start == frame.vertex) ? sides[s].End : sides[s].Start;
+				Vec2 nextpos = (sides[s].Start == frame.vertex) ? EndPos(s) : StartPos(s);
+				if (nextvertex == start)
+					return true;
+
+				frames.push_back({ nextvertex, nextpos, {}, 0 });
+				FindCandidates(nextvertex, nextpos, s, frames.back().candidates);
+			}
+
+			return false;
+		}
+
+		// EarClipPolygon.Intersect
+		bool Intersect(int poly, const Vec2& p) const
+		{
+			const std::vector<PolygonVertex>& points = polygons[poly].points;
+			Vec2 v1 = points.back().pos;
+			unsigned int c = 0;
+			for (const PolygonVertex& n : points)
+			{
+				Vec2 v2 = n.pos;
+				if (v1.y != v2.y
+					&& p.y > (v1.y < v2.y ? v1.y : v2.y)
+					&& p.y <= (v1.y > v2.y ? v1.y : v2.y)
+					&& (p.x < (v1.x < v2.x ? v1.x : v2.x) || (p.x <= (v1.x > v2.x ? v1.x : v2.x)
+						&& (v1.x == v2.x || p.x <= ((p.y - v1.y) * (v2.x - v1.x) / (v2.y - v1.y) + v1.x)))))
+					c++;
+				v1 = v2;
+			}
+
+			if (c % 2 != 0)
+			{
+				for (int child : polygons[poly].children)
+				{
+					if (Intersect(child, p))
+						return false;
+				}
+				return true;
+			}
+			return false;
+		}
+
+		// EarClipPolygon.InsertChild
+		bool InsertChild(int poly, int p)
+		{
+			if (polygons[p].points.empty())
+				return false;
+
+			for (int child : polygons[poly].children)
+			{
+				if (InsertChild(child, p))
+					return true;
+			}
+
+			if (Intersect(poly, polygons[p].points.front().pos))
+			{
+				polygons[p].inner = !polygons[poly].inner;
+				polygons[poly].children.push_back(p);
+				return true;
+			}
+			return false;
+		}
+
+		/////////////////////////////////////////////////////////////////////
+		// Cutting
+
+		void DoCutting(std::vector<int>& polys)
+		{
+			std::deque<int> todo(polys.begin(), polys.end());
+			while (!todo.empty())
+			{
+				int p = todo.front();
+				todo.pop_front();
+
+				if (!polygons[p].children.empty())
+				{
+					// The children of the children are outer polygons again
+					for (int c : polygons[p].children)
+					{
+						polys.insert(polys.end(), polygons[c].children.begin(), polygons[c].children.end());
+						todo.insert(todo.end(), polygons[c].children.begin(), polygons[c].children.end());
+						polygons[c].children.clear();
+					}
+
+					MergeInnerPolys(p);
+				}
+			}
+		}
+
+		static size_t FindRightMostVertex(const Polygon& p)
+		{
+			size_t found = 0;
+			for (size_t i = 1; i < p.points.size(); i++)
+			{
+				if (p.points[i].pos.x > p.points[found].pos.x)
+					found = i;
+			}
+			return found;
+		}
+
+		void MergeInnerPolys(int p)
+		{
+			std::vector<int> todo = polygons[p].children;
+			while (!todo.empty())
+			{
+				// Find the inner polygon with the highest x vertex
+				size_t found = 0;
+				size_t foundstart = FindRightMostVertex(polygons[todo[0]]);
+				for (size_t i = 1; i < todo.size(); i++)
+				{
+					size_t start = FindRightMostVertex(polygons[todo[i]]);
+					if (polygons[todo[i]].points[start].pos.x > polygons[todo[found]].points[foundstart].pos.x)
+					{
+						found = i;
+						foundstart = start;
+					}
+				}
+
+				int inner = todo[found];
+				todo.erase(todo.begin() + found);
+				SplitOuterWithInner(polygons[inner], foundstart, polygons[p]);
+			}
+
+			polygons[p].children.clear();
+		}
+
+		static void SplitOuterWithInner(const Polygon& inner, size_t start, Polygon& p)
+		{
+			std::vector<PolygonVertex>& points = p.points;
+			size_t count = points.size();
+			const Vec2 startpos = inner.points[start].pos;
+
+			int insertbefore = -1;
+			double foundu = DBL_MAX;
+			Vec2 foundpos = { 0.0, 0.0 };
+
+			// Create a line from start that goes beyond the right most vertex of p
+			double startx = startpos.x;
+			double endx = points[FindRightMostVertex(p)].pos.x + 10.0;
+			Vec2 rayend = { endx, startpos.y };
+
+			// Calculate a small bonus (0.1 mappixel)
+			double bonus = GetNearestOnLine(startpos, rayend, { startpos.x + Bonus, startpos.y });
+
+			for (size_t i2 = 0; i2 < count; i2++)
+			{
+				size_t i1 = (i2 == 0) ? count - 1 : i2 - 1;
+				const Vec2& v1 = points[i1].pos;
+				const Vec2& v2 = points[i2].pos;
+
+				// Check if the line goes between startx and endx
+				if ((v1.x > startx || v2.x > startx) && (v1.x < endx || v2.x < endx))
+				{
+					double u, ul;
+					GetIntersection(v1, v2, startpos, rayend, u, ul);
+					if (std::isnan(u))
+					{
+						// Horizontal line overlapping the cut scan line, possibly a previous cut
+						if (v1.y == startpos.y)
+						{
+							u = GetNearestOnLine(startpos, rayend, v1);
+							ul = GetNearestOnLine(startpos, rayend, v2);
+
+							if (u < 0.0) u = DBL_MAX;
+							if (ul < 0.0) ul = DBL_MAX;
+
+							double insert_u = std::min(u, ul);
+							Vec2 insertpos = GetCoordinatesAt(startpos, rayend, insert_u);
+
+							if (v1.x > v2.x)
+							{
+								// Right to left, so the cut goes after this line
+								size_t i3 = (i2 + 1) % count;
+								if (points[i3].pos.y < v2.y)
+									insert_u -= bonus;
+
+								if (insert_u <= foundu)
+								{
+									insertbefore = (int)i3;
+									foundu = insert_u;
+									foundpos = insertpos;
+								}
+							}
+							else
+							{
+								// Left to right, so the cut goes before this line
+								size_t i3 = (i1 == 0) ? count - 1 : i1 - 1;
+								if (points[i3].pos.y > v1.y)
+									insert_u -= bonus;
+
+								if (insert_u <= foundu)
+								{
+									insertbefore = (int)i2;
+									foundu = insert_u;
+									foundpos = insertpos;
+								}
+							}
+						}
+					}
+					else if ((ul >= 0.0) && (ul <= 1.0) && (u > 0.0) && (u <= foundu))
+					{
+						insertbefore = (int)i2;
+						foundu = u;
+						foundpos = GetCoordinatesAt(startpos, rayend, u);
+					}
+				}
+			}
+
+			if (insertbefore != -1)
+			{
+				int32_t sd = points[(insertbefore == 0) ? count - 1 : insertbefore - 1].side;
+				Vec2 insertbeforepos = points[insertbefore].pos;
+
+				std::vector<PolygonVertex> cut;
+				cut.reserve(inner.points.size() + 3);
+				cut.push_back({ foundpos, sd });
+				size_t v = start;
+				do
+				{
+					cut.push_back(inner.points[v]);
+					v = (v + 1) % inner.points.size();
+				} while (v != start);
+				cut.push_back({ startpos, sd });
+				if (foundpos != insertbeforepos)
+					cut.push_back({ foundpos, sd });
+
+				points.insert(points.begin() + insertbefore, cut.begin(), cut.end());
+			}
+		}
+
+		/////////////////////////////////////////////////////////////////////
+		// Ear clipping
+
+		void Remove(int v)
+		{
+			EarVertex& ev = verts[v];
+			if (numverts == 1)
+			{
+				first = -1;
+			}
+			else
+			{
+				verts[ev.prev].next = ev.next;
+				verts[ev.next].prev = ev.prev;
+				if (first == v)
+					first = ev.next;
+			}
+			numverts--;
+			RemoveReflex(v);
+			RemoveEarTip(v);
+		}
+
+		void AddReflex(int v)
+		{
+			EarVertex& ev = verts[v];
+			if (ev.isreflex) return;
+			ev.isreflex = true;
+			ev.reflexprev = reflextail;
+			ev.reflexnext = -1;
+			if (reflextail != -1) verts[reflextail].reflexnext = v; else reflexhead = v;
+			reflextail = v;
+		}
+
+		void RemoveReflex(int v)
+		{
+			EarVertex& ev = verts[v];
+			if (!ev.isreflex) return;
+			ev.isreflex = false;
+			if (ev.reflexprev != -1) verts[ev.reflexprev].reflexnext = ev.reflexnext; else reflexhead = ev.reflexnext;
+			if (ev.reflexnext != -1) verts[ev.reflexnext].reflexprev = ev.reflexprev; else reflextail = ev.reflexprev;
+		}
+
+		void AddEarTip(int v)
+		{
+			EarVertex& ev = verts[v];
+			if (ev.isear) return;
+			ev.isear = true;
+			ev.earprev = eartail;
+			ev.earnext = -1;
+			if (eartail != -1) verts[eartail].earnext = v; else earhead = v;
+			eartail = v;
+		}
+
+		void RemoveEarTip(int v)
+		{
+			EarVertex& ev = verts[v];
+			if (!ev.isear) return;
+			ev.isear = false;
+			if (ev.earprev != -1) verts[ev.earprev].earnext = ev.earnext; else earhead = ev.earnext;
+			if (ev.earnext != -1) verts[ev.earnext].earprev = ev.earprev; else eartail = ev.earprev;
+		}
+
+		struct Triangle
+		{
+			int v[3];
+			const Vec2& Pos(const std::vector<EarVertex>& verts, int i) const { return verts[v[i]].pos; }
+		};
+
+		Triangle GetTriangle(int v) const
+		{
+			return { { verts[v].prev, v, verts[v].next } };
+		}
+
+		bool IsReflex(const Triangle& t) const
+		{
+			return GetSideOfLine(verts[t.v[0]].pos, verts[t.v[2]].pos, verts[t.v[1]].pos) < 0.0;
+		}
+
+		bool TriangleHasArea(const Triangle& t) const
+		{
+			const Vec2& tp0 = verts[t.v[0]].pos;
+			const Vec2& tp1 = verts[t.v[1]].pos;
+			const Vec2& tp2 = verts[t.v[2]].pos;
+			return (tp0.x * (tp1.y - tp2.y) + tp1.x * (tp2.y - tp0.y) + tp2.x * (tp0.y - tp1.y)) != 0.0;
+		}
+
+		bool LineInsideTriangle(const Triangle& t, const Vec2& p1, const Vec2& p2) const
+		{
+			const Vec2& t0 = verts[t.v[0]].pos;
+			const Vec2& t1 = verts[t.v[1]].pos;
+			const Vec2& t2 = verts[t.v[2]].pos;
+
+			double s01 = GetSideOfLine(t0, t1, p2);
+			double s12 = GetSideOfLine(t1, t2, p2);
+			double s20 = GetSideOfLine(t2, t0, p2);
+			double p2_on_edge = 2.0;
+			double p1_on_same_edge = 2.0;
+
+			// Line is inside triangle, because p2 is
+			if ((s01 < 0.0) && (s12 < 0.0) && (s20 < 0.0))
+				return true;
+
+			// Is p2 on an edge of the triangle, and where?
+			if (s01 == 0.0)
+			{
+				p2_on_edge = GetNearestOnLine(t0, t1, p2);
+				p1_on_same_edge = GetSideOfLine(t0, t1, p1);
+			}
+			else if (s12 == 0.0)
+			{
+				p2_on_edge = GetNearestOnLine(t1, t2, p2);
+				p1_on_same_edge = GetSideOfLine(t1, t2, p1);
+			}
+			else if (s20 == 0.0)
+			{
+				p2_on_edge = GetNearestOnLine(t2, t0, p2);
+				p1_on_same_edge = GetSideOfLine(t2, t0, p1);
+			}
+
+			// When p1 is on the same edge the line is not inside this triangle
+			if ((p2_on_edge >= 0.0) && (p2_on_edge <= 1.0))
+			{
+				if (p1_on_same_edge == 0.0)
+					return false;
+			}
+
+			// Complete line-triangle intersection test
+			double pu, pt;
+			if (GetIntersection(t0, t1, p1, p2, pu, pt)) return true;
+			if (GetIntersection(t1, t2, p1, p2, pu, pt)) return true;
+			if (GetIntersection(t2, t0, p1, p2, pu, pt)) return true;
+			return false;
+		}
+
+		bool CheckValidEar(const Triangle& t) const
+		{
+			const Vec2& pos0 = verts[t.v[0]].pos;
+			const Vec2& pos1 = verts[t.v[1]].pos;
+			const Vec2& pos2 = verts[t.v[2]].pos;
+
+			// If the triangle has no area, there can never be a point inside
+			if (!TriangleHasArea(t))
+				return true;
+
+			double minx = std::min(pos0.x, std::min(pos1.x, pos2.x));
+			double maxx = std::max(pos0.x, std::max(pos1.x, pos2.x));
+			double miny = std::min(pos0.y, std::min(pos1.y, pos2.y));
+			double maxy = std::max(pos0.y, std::max(pos1.y, pos2.y));
+
+			for (int rv = reflexhead; rv != -1; rv = verts[rv].reflexnext)
+			{
+				const Vec2& vpos = verts[rv].pos;
+				if (vpos == pos0 || vpos == pos1 || vpos == pos2)
+					continue;
+
+				if (vpos.x < minx || vpos.x > maxx || vpos.y < miny || vpos.y > maxy)
+					continue;
+
+				double lineside01 = GetSideOfLine(pos0, pos1, vpos);
+				double lineside12 = GetSideOfLine(pos1, pos2, vpos);
+				double lineside20 = GetSideOfLine(pos2, pos0, vpos);
+				double u_on_line = 0.5;
+
+				if (lineside01 == 0.0)
+					u_on_line = GetNearestOnLine(pos0, pos1, vpos);
+				else if (lineside12 == 0.0)
+					u_on_line = GetNearestOnLine(pos1, pos2, vpos);
+				else if (lineside20 == 0.0)
+					u_on_line = GetNearestOnLine(pos2, pos0, vpos);
+
+				// On an edge the lines adjacent to the point decide if it is inside
+				if (lineside01 == 0.0 || lineside12 == 0.0 || lineside20 == 0.0)
+				{
+					if (u_on_line < 0.0 || u_on_line > 1.0)
+						continue;
+
+					if (LineInsideTriangle(t, vpos, verts[verts[rv].prev].pos)) return false;
+					if (LineInsideTriangle(t, vpos, verts[verts[rv].next].pos)) return false;
+					continue;
+				}
+
+				if (lineside01 < 0.0 && lineside12 < 0.0 && lineside20 < 0.0)
+					return false;
+			}
+
+			return true;
+		}
+
+		void AddTriangle(const Triangle& t, bool last)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				const EarVertex& v = verts[t.v[i]];
+				result.Vertices.push_back(v.pos.x);
+				result.Vertices.push_back(v.pos.y);
+				result.Sides.push_back((i < 2 || last) ? v.side : -1);
+			}
+
+			// The first vertex of this triangle no longer lies along a sidedef
+			verts[t.v[0]].side = -1;
+		}
+
+		int DoEarClip(const Polygon& poly)
+		{
+			int countvertices = 0;
+			if (poly.points.empty())
+				return 0;
+
+			// Fill the circular main list
+			int n = (int)poly.points.size();
+			verts.resize(n);
+			for (int i = 0; i < n; i++)
+			{
+				EarVertex& v = verts[i];
+				v.pos = poly.points[i].pos;
+				v.side = poly.points[i].side;
+				v.prev = (i == 0) ? n - 1 : i - 1;
+				v.next = (i == n - 1) ? 0 : i + 1;
+				v.reflexprev = v.reflexnext = -1;
+				v.earprev = v.earnext = -1;
+				v.isreflex = false;
+				v.isear = false;
+			}
+			first = 0;
+			numverts = n;
+			reflexhead = reflextail = -1;
+			earhead = eartail = -1;
+
+			// Remove any zero-length lines, these will give problems
+			int n1 = first;
+			do
+			{
+				int n2 = verts[n1].next;
+				Vec2 d = { verts[n1].pos.x - verts[n2].pos.x, verts[n1].pos.y - verts[n2].pos.y };
+				while ((std::abs(d.x) < Epsilon) && (std::abs(d.y) < Epsilon))
+				{
+					Remove(n2);
+					if (numverts == 0)
+						break;
+					n2 = verts[n1].next;
+					d = { verts[n1].pos.x - verts[n2].pos.x, verts[n1].pos.y - verts[n2].pos.y };
+				}
+				if (numverts == 0)
+					break;
+				n1 = n2;
+			} while (n1 != first);
+
+			// Vertices which have lines with the same angle are useless
+			if (numverts > 0)
+			{
+				n1 = first;
+				while (n1 != -1)
+				{
+					int n2 = (verts[n1].next == first) ? -1 : verts[n1].next;
+					Triangle t = GetTriangle(n1);
+					double a = GetLineAngle(verts[t.v[0]].pos, verts[t.v[1]].pos);
+					double b = GetLineAngle(verts[t.v[1]].pos, verts[t.v[2]].pos);
+					if (std::abs(AngleDifference(a, b)) < Epsilon)
+					{
+						Remove(n1);
+						if (numverts == 0)
+							break;
+					}
+					n1 = n2;
+				}
+			}
+
+			if (numverts == 0)
+				return 0;
+
+			// Determine reflex or convex
+			convexes.clear();
+			int v = first;
+			do
+			{
+				if (IsReflex(GetTriangle(v))) AddReflex(v); else convexes.push_back(v);
+				v = verts[v].next;
+			} while (v != first);
+
+			// Go for all convex vertices to see if they are ear tips
+			for (int cv : convexes)
+			{
+				if (CheckValidEar(GetTriangle(cv)))
+					AddEarTip(cv);
+			}
+
+			// Process ears until done
+			while (earhead != -1 && numverts > 2)
+			{
+				int ear = earhead;
+				Triangle t = GetTriangle(ear);
+
+				// Only save this triangle when it has an area
+				if (TriangleHasArea(t))
+				{
+					AddTriangle(t, numverts == 3);
+					countvertices += 3;
+				}
+
+				Remove(ear);
+				int v1 = t.v[0];
+				int v2 = t.v[2];
+
+				Triangle t1 = GetTriangle(v1);
+				if (IsReflex(t1))
+				{
+					AddReflex(v1);
+					RemoveEarTip(v1);
+				}
+				else
+				{
+					RemoveReflex(v1);
+				}
+
+				Triangle t2 = GetTriangle(v2);
+				if (IsReflex(t2))
+				{
+					AddReflex(v2);
+					RemoveEarTip(v2);
+				}
+				else
+				{
+					RemoveReflex(v2);
+				}
+
+				// Check if any neighbour has become a valid or invalid ear
+				if (!verts[v1].isreflex && CheckValidEar(t1)) AddEarTip(v1); else RemoveEarTip(v1);
+				if (!verts[v2].isreflex && CheckValidEar(t2)) AddEarTip(v2); else RemoveEarTip(v2);
+			}
+
+			return countvertices;
+		}
+
+		const TriangulatorSide* sides;
+		int count;
+		TriangulatorResult& result;
+
+		std::vector<char> intodo;
+		std::vector<char> visited;
+		std::vector<Link> links;
+		std::vector<int32_t> ignores;
+		mutable std::vector<std::pair<double, int>> sortkeys;
+		std::vector<Polygon> polygons;
+
+		std::vector<EarVertex> verts;
+		std::vector<int> convexes;
+		int first = -1;
+		int numverts = 0;
+		int reflexhead = -1, reflextail = -1;
+		int earhead = -1, eartail = -1;
+	};
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+Triangulator::Triangulator()
+{
+	mPool = SWWorkerPool::GetShared();
+}
+
+Triangulator::~Triangulator()
+{
+}
+
+bool Triangulator::Run(const TriangulatorSide* sides, const int32_t* firstside, int numsectors)
+{
+	if (numsectors < 0 || (numsectors > 0 && (!sides || !firstside)))
+	{
+		SetError("Invalid triangulator input");
+		return false;
+	}
+
+	for (int i = 0; i < numsectors; i++)
+	{
+		if (firstside[i + 1] < firstside[i])
+		{
+			SetError("Invalid side range for sector %d", i);
+			return false;
+		}
+	}
+
+	mResults.resize(numsectors);
+	mPool->Run(numsectors, [&](int sector) {
+		SectorTriangulator triangulator(sides + firstside[sector], firstside[sector + 1] - firstside[sector], mResults[sector]);
+		triangulator.Run();
+	});
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+extern "C"
+{
+
+Triangulator* Triangulator_New()
+{
+	return new Triangulator();
+}
+
+void Triangulator_Delete(Triangulator* triangulator)
+{
+	delete triangulator;
+}
+
+bool Triangulator_Run(Triangulator* triangulator, const TriangulatorSide* sides, const int32_t* firstside, int numsectors)
+{
+	return triangulator->Run(sides, firstside, numsectors);
+}
+
+bool Triangulator_GetResult(Triangulator* triangulator, int sector, const int32_t** islands, int* numislands, const double** vertices, const int32_t** sides, int* numvertices)
+{
+	if (sector < 0 || sector >= triangulator->GetResultCount())
+	{
+		SetError("Invalid triangulator sector %d", sector);
+		return false;
+	}
+
+	const TriangulatorResult& result = triangulator->GetResult(sector);
+	*islands = result.Islands.data();
+	*numislands = (int)result.Islands.size();
+	*vertices = result.Vertices.data();
+	*sides = result.Sides.data();
+	*numvertices = (int)result.Sides.size();
+	return true;
+}
+
+}
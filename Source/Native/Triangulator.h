@@ -0,0 +1,74 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+class SWWorkerPool;
+
+// One sidedef of a sector, in the order of the managed Sector.Sidedefs collection
+struct TriangulatorSide
+{
+	// Start and end of the linedef
+	double X1, Y1, X2, Y2;
+
+	// Linedef.Angle
+	double Angle;
+
+	// Vertex indices of the linedef, only compared for identity
+	int32_t Start;
+	int32_t End;
+
+	int32_t Front;
+
+	// Set when the other side of the line faces the same sector
+	int32_t Skip;
+
+	// Position of the linedef in the Linedefs list of the vertex the side is traced from
+	int32_t Order;
+
+	int32_t Padding;
+};
+
+// Triangles of one sector in the layout of the managed Triangulation class
+struct TriangulatorResult
+{
+	std::vector<int32_t> Islands;
+	std::vector<double> Vertices;
+	std::vector<int32_t> Sides;
+};
+
+// Triangulates many sectors at once, spread over the software renderer's worker threads.
+// This is a port of Triangulation.cs and must give exactly the same results.
+class Triangulator
+{
+public:
+	Triangulator();
+	~Triangulator();
+
+	bool Run(const TriangulatorSide* sides, const int32_t* firstside, int numsectors);
+
+	const TriangulatorResult& GetResult(int sector) const { return mResults[sector]; }
+	int GetResultCount() const { return (int)mResults.size(); }
+
+private:
+	std::shared_ptr<SWWorkerPool> mPool;
+	std::vector<TriangulatorResult> mResults;
+};
@@ -0,0 +1,665 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Precomp.h"
+#include "UDMFParser.h"
+#include "Backend.h"
+#include <cstdarg>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <clocale>
+
+#if !defined(NO_SSE) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define UDMF_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// These match the messages of the managed UniversalParser
+#define ERROR_KEYMISSING "Missing key name in assignment or scope."
+#define ERROR_KEYCHARACTERS "Invalid characters in key name."
+#define ERROR_VALUEINVALID "Invalid value in assignment. Missing a previous terminator symbol?"
+#define ERROR_VALUETOOBIG "Value too big."
+#define ERROR_KEYWITHOUTVALUE "Key has no value assigned."
+#define ERROR_KEYWORDUNKNOWN "Unknown keyword in assignment. Missing a previous terminator symbol?"
+
+namespace
+{
+	inline bool IsWhitespace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+	}
+
+	inline bool IsKeyDelimiter(char c)
+	{
+		return IsWhitespace(c) || c == '=' || c == '{' || c == '}' || c == ';' || c == '"' || c == '/';
+	}
+
+	inline bool IsKeyCharacter(char c)
+	{
+		return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_';
+	}
+
+	inline bool IsNumberStart(char c)
+	{
+		return (c >= '0' && c <= '9') || c == '-' || c == '.' || c == '&';
+	}
+
+	inline char ToLower(char c)
+	{
+		return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+	}
+
+	int CountNewlines(const char* begin, const char* end)
+	{
+		return (int)std::count(begin, end, '\n');
+	}
+
+	// Drops the whitespace around a number or keyword value
+	void Trim(const char*& begin, const char*& end)
+	{
+		while (begin < end && IsWhitespace(*begin)) begin++;
+		while (end > begin && IsWhitespace(end[-1])) end--;
+	}
+
+#ifdef UDMF_SSE2
+	inline int FindFirstBit(unsigned int mask)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return (int)index;
+#else
+		return __builtin_ctz(mask);
+#endif
+	}
+
+	inline int CountBits(unsigned int mask)
+	{
+		mask = mask - ((mask >> 1) & 0x55555555);
+		mask = (mask & 0x33333333) + ((mask >> 2) & 0x33333333);
+		return (int)((((mask + (mask >> 4)) & 0x0f0f0f0f) * 0x01010101) >> 24);
+	}
+
+	inline __m128i MatchWhitespace(__m128i chars)
+	{
+		__m128i ws = _mm_or_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(chars, _mm_set1_epi8('\t')));
+		ws = _mm_or_si128(ws, _mm_cmpeq_epi8(chars, _mm_set1_epi8('\r')));
+		return _mm_or_si128(ws, _mm_cmpeq_epi8(chars, _mm_set1_epi8('\n')));
+	}
+#endif
+
+	// Returns the first character that is not a space, tab or line break. Line breaks are added to line.
+	const char* FindNonWhitespace(const char* pos, const char* end, int& line)
+	{
+#ifdef UDMF_SSE2
+		const __m128i newline = _mm_set1_epi8('\n');
+		while (end - pos >= 16)
+		{
+			__m128i chars = _mm_loadu_si128((const __m128i*)pos);
+			unsigned int other = ~(unsigned int)_mm_movemask_epi8(MatchWhitespace(chars)) & 0xffff;
+			unsigned int newlines = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(chars, newline));
+			if (other == 0)
+			{
+				line += CountBits(newlines);
+				pos += 16;
+			}
+			else
+			{
+				int index = FindFirstBit(other);
+				line += CountBits(newlines & ((1u << index) - 1));
+				return pos + index;
+			}
+		}
+#endif
+		while (pos < end && IsWhitespace(*pos))
+		{
+			if (*pos == '\n') line++;
+			pos++;
+		}
+		return pos;
+	}
+
+	// Returns the first character that ends a key name
+	const char* FindKeyDelimiter(const char* pos, const char* end)
+	{
+#ifdef UDMF_SSE2
+		while (end - pos >= 16)
+		{
+			__m128i chars = _mm_loadu_si128((const __m128i*)pos);
+			__m128i match = MatchWhitespace(chars);
+			match = _mm_or_si128(match, _mm_cmpeq_epi8(chars, _mm_set1_epi8('=')));
+			match = _mm_or_si128(match, _mm_cmpeq_epi8(chars, _mm_set1_epi8('{')));
+			match = _mm_or_si128(match, _mm_cmpeq_epi8(chars, _mm_set1_epi8('}')));
+			match = _mm_or_si128(match, _mm_cmpeq_epi8(chars, _mm_set1_epi8(';')));
+			match = _mm_or_si128(match, _mm_cmpeq_epi8(chars, _mm_set1_epi8('"')));
+			match = _mm_or_si128(match, _mm_cmpeq_epi8(chars, _mm_set1_epi8('/')));
+			unsigned int mask = (unsigned int)_mm_movemask_epi8(match);
+			if (mask != 0)
+				return pos + FindFirstBit(mask);
+			pos += 16;
+		}
+#endif
+		while (pos < end && !IsKeyDelimiter(*pos))
+			pos++;
+		return pos;
+	}
+
+	// Returns the first character inside a string value that needs special handling
+	const char* FindStringSpecial(const char* pos, const char* end)
+	{
+#ifdef UDMF_SSE2
+		while (end - pos >= 16)
+		{
+			__m128i chars = _mm_loadu_si128((const __m128i*)pos);
+			__m128i match = _mm_cmpeq_epi8(chars, _mm_set1_epi8('"'));
+			match = _mm_or_si128(match, _mm_cmpeq_epi8(chars, _mm_set1_epi8('\\')));
+			match = _mm_or_si128(match, _mm_cmpeq_epi8(chars, _mm_set1_epi8('\n')));
+			match = _mm_or_si128(match, _mm_cmpeq_epi8(chars, _mm_set1_epi8('\r')));
+			unsigned int mask = (unsigned int)_mm_movemask_epi8(match);
+			if (mask != 0)
+				return pos + FindFirstBit(mask);
+			pos += 16;
+		}
+#endif
+		while (pos < end && *pos != '"' && *pos != '\\' && *pos != '\n' && *pos != '\r')
+			pos++;
+		return pos;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+bool UDMFParser::Parse(const char* data, int size, bool strict)
+{
+	mPos = data;
+	mEnd = data + size;
+	mLine = 1;
+	mErrorLine = 0;
+	mStrict = strict;
+
+	Entries.clear();
+	Fields.clear();
+	Blocks.clear();
+	StringData.clear();
+	StringOffsets.clear();
+	StringOffsets.push_back(0);
+	mStringHash.clear();
+	mStringHashes.clear();
+
+	// A typical map has one assignment for every 16 bytes or so
+	Fields.reserve(size / 16);
+
+	while (true)
+	{
+		SkipWhitespace();
+		if (mPos == mEnd)
+			return true;
+
+		if (*mPos == '}')
+			return Error("Unexpected '}' outside of a block.");
+
+		int line = mLine;
+		int32_t key;
+		if (!ParseKey(key))
+			return false;
+
+		SkipWhitespace();
+		if (mPos != mEnd && *mPos == '{')
+		{
+			mPos++;
+
+			UDMFBlock block;
+			block.Key = key;
+			block.FirstField = (int32_t)Fields.size();
+			block.NumFields = 0;
+			block.Line = line;
+
+			while (true)
+			{
+				SkipWhitespace();
+
+				// The managed parser accepted a block left open at the end of the data
+				if (mPos == mEnd)
+					break;
+
+				if (*mPos == '}')
+				{
+					mPos++;
+					break;
+				}
+
+				UDMFField field = {};
+				field.Line = mLine;
+				if (!ParseKey(field.Key))
+					return false;
+
+				SkipWhitespace();
+				if (mPos != mEnd && *mPos == '{')
+					return Error("Blocks can't be nested in UDMF map data.");
+				if (!ParseAssignment(field))
+					return false;
+				Fields.push_back(field);
+			}
+
+			block.NumFields = (int32_t)Fields.size() - block.FirstField;
+
+			UDMFField entry = {};
+			entry.Key = key;
+			entry.Type = UDMFValueType::Block;
+			entry.Line = line;
+			entry.Value.Int = (int64_t)Blocks.size();
+			Entries.push_back(entry);
+			Blocks.push_back(block);
+		}
+		else
+		{
+			// Top level assignment, such as the namespace
+			UDMFField field = {};
+			field.Key = key;
+			field.Line = line;
+			if (!ParseAssignment(field))
+				return false;
+			Entries.push_back(field);
+		}
+	}
+}
+
+bool UDMFParser::ParseKey(int32_t& key)
+{
+	const char* start = mPos;
+	mPos = FindKeyDelimiter(mPos, mEnd);
+	if (mPos == start)
+		return Error(ERROR_KEYMISSING);
+
+	// UDMF key names are case-insensitive
+	mValue.assign(start, mPos);
+	for (char& c : mValue)
+	{
+		c = ToLower(c);
+		if (mStrict && !IsKeyCharacter(c))
+			return Error(ERROR_KEYCHARACTERS);
+	}
+
+	key = AddString(mValue.data(), mValue.size());
+	return true;
+}
+
+bool UDMFParser::ParseAssignment(UDMFField& field)
+{
+	if (mPos == mEnd || *mPos != '=')
+	{
+		if (mPos != mEnd && *mPos == ';')
+			return Error(ERROR_KEYWITHOUTVALUE);
+		return Error(ERROR_KEYCHARACTERS);
+	}
+	mPos++;
+
+	SkipWhitespace();
+	if (mPos == mEnd)
+		return Error(ERROR_KEYWITHOUTVALUE);
+
+	if (*mPos == ';')
+	{
+		field.Type = UDMFValueType::Empty;
+		mPos++;
+		return true;
+	}
+
+	bool result;
+	if (*mPos == '"')
+		result = ParseString(field);
+	else if (IsNumberStart(*mPos))
+		result = ParseNumber(field);
+	else
+		result = ParseKeyword(field);
+	if (!result)
+		return false;
+
+	SkipWhitespace();
+	if (mPos == mEnd || *mPos != ';')
+		return Error(ERROR_VALUEINVALID);
+	mPos++;
+	return true;
+}
+
+bool UDMFParser::ParseString(UDMFField& field)
+{
+	mPos++;
+	mValue.clear();
+	while (true)
+	{
+		const char* start = mPos;
+		mPos = FindStringSpecial(mPos, mEnd);
+		mValue.append(start, mPos);
+
+		if (mPos == mEnd)
+			return Error("String value is missing its closing quote.");
+
+		char c = *(mPos++);
+		if (c == '"')
+		{
+			break;
+		}
+		else if (c == '\n')
+		{
+			// Line breaks were never part of the value in the managed parser
+			mLine++;
+		}
+		else if (c == '\\' && mPos != mEnd)
+		{
+			c = *(mPos++);
+			switch (c)
+			{
+			case 'n': mValue.push_back('\n'); break;
+			case 'r': mValue.push_back('\r'); break;
+			case 't': mValue.push_back('\t'); break;
+			default:
+				if (c >= '0' && c <= '9')
+				{
+					// Up to three decimal digits make a character code
+					int code = c - '0';
+					for (int i = 0; i < 2 && mPos != mEnd && *mPos >= '0' && *mPos <= '9'; i++)
+						code = code * 10 + *(mPos++) - '0';
+					mValue.push_back((char)code);
+				}
+				else
+				{
+					if (c == '\n') mLine++;
+					mValue.push_back(c);
+				}
+				break;
+			}
+		}
+	}
+
+	field.Type = UDMFValueType::String;
+	field.Value.Int = AddString(mValue.data(), mValue.size());
+	return true;
+}
+
+bool UDMFParser::ParseNumber(UDMFField& field)
+{
+	const char* start = mPos;
+	const char* end = (const char*)memchr(mPos, ';', mEnd - mPos);
+	if (!end)
+		return Error(ERROR_VALUEINVALID);
+	mLine += CountNewlines(start, end);
+	mPos = end;
+
+	Trim(start, end);
+
+	// Plain decimal integers are by far the most common values
+	const char* digits = (start < end && *start == '-') ? start + 1 : start;
+	if (digits < end && end - digits <= 18 && std::all_of(digits, end, [](char c) { return c >= '0' && c <= '9'; }))
+	{
+		int64_t value = 0;
+		for (const char* p = digits; p < end; p++)
+			value = value * 10 + (*p - '0');
+		field.Type = UDMFValueType::Int;
+		field.Value.Int = (digits != start) ? -value : value;
+		return true;
+	}
+
+	mValue.assign(start, end);
+	const char* text = mValue.c_str();
+	char* parseend = nullptr;
+
+	if (mValue.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X'))
+	{
+		// Hexadecimal. Up to 8 digits wrap around into a 32-bit value like Convert.ToInt32 does.
+		int digits = 0;
+		uint64_t value = 0;
+		for (const char* p = text + 2; *p; p++)
+		{
+			char c = ToLower(*p);
+			int digit;
+			if (c >= '0' && c <= '9') digit = c - '0';
+			else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+			else return Error(ERROR_VALUEINVALID "\n\nUnrecognized token: \"%s\"", text);
+
+			if (digits > 0 || digit != 0) digits++;
+			if (digits > 16)
+				return Error(ERROR_VALUETOOBIG);
+			value = (value << 4) | digit;
+		}
+
+		field.Type = UDMFValueType::Int;
+		field.Value.Int = (value <= 0xffffffffULL) ? (int64_t)(int32_t)(uint32_t)value : (int64_t)value;
+	}
+	else if (mValue.find('.') != std::string::npos || mValue.find("e-") != std::string::npos || mValue.find("E-") != std::string::npos)
+	{
+		// Floating point, possibly in scientific notation. strtod follows the C locale's decimal point.
+		char point = *localeconv()->decimal_point;
+		if (point != '.')
+		{
+			std::replace(mValue.begin(), mValue.end(), '.', point);
+			text = mValue.c_str();
+		}
+		double value = strtod(text, &parseend);
+		if (parseend == text || *parseend != 0)
+			return Error(ERROR_VALUEINVALID "\n\nUnrecognized token: \"%s\"", text);
+
+		field.Type = UDMFValueType::Float;
+		field.Value.Float = value;
+	}
+	else
+	{
+		errno = 0;
+		long long value = strtoll(text, &parseend, 10);
+		if (parseend == text || *parseend != 0)
+			return Error(ERROR_VALUEINVALID "\n\nUnrecognized token: \"%s\"", text);
+		if (errno == ERANGE)
+			return Error(ERROR_VALUETOOBIG);
+
+		field.Type = UDMFValueType::Int;
+		field.Value.Int = value;
+	}
+	return true;
+}
+
+bool UDMFParser::ParseKeyword(UDMFField& field)
+{
+	const char* start = mPos;
+	const char* end = (const char*)memchr(mPos, ';', mEnd - mPos);
+	if (!end)
+		return Error(ERROR_VALUEINVALID);
+	mLine += CountNewlines(start, end);
+	mPos = end;
+
+	Trim(start, end);
+	mValue.assign(start, end);
+	std::string keyword = mValue;
+	for (char& c : keyword)
+		c = ToLower(c);
+
+	if (keyword == "true" || keyword == "false")
+	{
+		field.Type = UDMFValueType::Bool;
+		field.Value.Int = keyword == "true" ? 1 : 0;
+	}
+	else if (keyword == "nan")
+	{
+		// Passed on so that the managed side can warn about the dropped field
+		field.Type = UDMFValueType::Float;
+		field.Value.Float = std::numeric_limits<double>::quiet_NaN();
+	}
+	else
+	{
+		return Error(ERROR_KEYWORDUNKNOWN "\n\nUnrecognized token: \"%s\"", mValue.c_str());
+	}
+	return true;
+}
+
+void UDMFParser::SkipWhitespace()
+{
+	while (true)
+	{
+		mPos = FindNonWhitespace(mPos, mEnd, mLine);
+		if (mEnd - mPos < 2 || mPos[0] != '/')
+			return;
+
+		if (mPos[1] == '/')
+		{
+			// Line comment
+			const char* end = (const char*)memchr(mPos, '\n', mEnd - mPos);
+			mPos = end ? end : mEnd;
+		}
+		else if (mPos[1] == '*')
+		{
+			// Block comment
+			const char* end = mPos + 2;
+			while (true)
+			{
+				end = (const char*)memchr(end, '*', mEnd - end);
+				if (!end || end + 1 == mEnd)
+				{
+					end = mEnd;
+					break;
+				}
+				if (end[1] == '/')
+				{
+					end += 2;
+					break;
+				}
+				end++;
+			}
+			mLine += CountNewlines(mPos, end);
+			mPos = end;
+		}
+		else
+		{
+			return;
+		}
+	}
+}
+
+int32_t UDMFParser::AddString(const char* str, size_t length)
+{
+	// Keys and texture names repeat all over the map, so this is looked up for nearly every field
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < length; i++)
+		hash = (hash ^ (uint8_t)str[i]) * 16777619u;
+
+	if ((StringOffsets.size() + 1) * 2 > mStringHash.size())
+	{
+		mStringHash.assign(std::max(mStringHash.size() * 2, (size_t)1024), -1);
+		int32_t count = (int32_t)StringOffsets.size() - 1;
+		for (int32_t i = 0; i < count; i++)
+		{
+			uint32_t slot = mStringHashes[i] & (uint32_t)(mStringHash.size() - 1);
+			while (mStringHash[slot] != -1)
+				slot = (slot + 1) & (uint32_t)(mStringHash.size() - 1);
+			mStringHash[slot] = i;
+		}
+	}
+
+	uint32_t mask = (uint32_t)(mStringHash.size() - 1);
+	uint32_t slot = hash & mask;
+	while (mStringHash[slot] != -1)
+	{
+		int32_t index = mStringHash[slot];
+		if (mStringHashes[index] == hash && (size_t)(StringOffsets[index + 1] - StringOffsets[index]) == length && memcmp(StringData.data() + StringOffsets[index], str, length) == 0)
+			return index;
+		slot = (slot + 1) & mask;
+	}
+
+	int32_t index = (int32_t)StringOffsets.size() - 1;
+	mStringHash[slot] = index;
+	mStringHashes.push_back(hash);
+	StringData.insert(StringData.end(), str, str + length);
+	StringOffsets.push_back((int32_t)StringData.size());
+	return index;
+}
+
+bool UDMFParser::Error(const char* fmt, ...)
+{
+	char buffer[1024];
+	va_list va;
+	va_start(va, fmt);
+	vsnprintf(buffer, sizeof(buffer), fmt, va);
+	va_end(va);
+
+	mErrorLine = mLine;
+	SetError("%s", buffer);
+	return false;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+extern "C"
+{
+
+UDMFParser* UDMFParser_New()
+{
+	return new UDMFParser();
+}
+
+void UDMFParser_Delete(UDMFParser* parser)
+{
+	delete parser;
+}
+
+bool UDMFParser_Parse(UDMFParser* parser, const void* data, int size, bool strict)
+{
+	if (size < 0)
+	{
+		SetError("Invalid UDMF data size %d", size);
+		return false;
+	}
+	return parser->Parse((const char*)data, size, strict);
+}
+
+int UDMFParser_GetErrorLine(UDMFParser* parser)
+{
+	return parser->GetErrorLine();
+}
+
+const UDMFField* UDMFParser_GetEntries(UDMFParser* parser, int* count)
+{
+	*count = (int)parser->Entries.size();
+	return parser->Entries.data();
+}
+
+const UDMFField* UDMFParser_GetFields(UDMFParser* parser, int* count)
+{
+	*count = (int)parser->Fields.size();
+	return parser->Fields.data();
+}
+
+const UDMFBlock* UDMFParser_GetBlocks(UDMFParser* parser, int* count)
+{
+	*count = (int)parser->Blocks.size();
+	return parser->Blocks.data();
+}
+
+const char* UDMFParser_GetStrings(UDMFParser* parser, const int32_t** offsets, int* count)
+{
+	*offsets = parser->StringOffsets.data();
+	*count = (int)parser->StringOffsets.size() - 1;
+	return parser->StringData.data();
+}
+
+}
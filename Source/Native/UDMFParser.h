@@ -0,0 +1,96 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+enum class UDMFValueType : int32_t
+{
+	Int,
+	Float,
+	Bool,
+	String,
+	Block,
+	Empty // "key = ;", which the managed parser always skipped
+};
+
+// One assignment in the TEXTMAP. String values and keys are indices into the string table.
+// At the top level a Block entry holds the index of the block in Value.
+struct UDMFField
+{
+	int32_t Key;
+	UDMFValueType Type;
+	int32_t Line;
+	int32_t Padding;
+	union
+	{
+		int64_t Int;
+		double Float;
+	} Value;
+};
+
+// A block's fields are stored contiguously in the field array
+struct UDMFBlock
+{
+	int32_t Key;
+	int32_t FirstField;
+	int32_t NumFields;
+	int32_t Line;
+};
+
+class UDMFParser
+{
+public:
+	bool Parse(const char* data, int size, bool strict);
+
+	int GetErrorLine() const { return mErrorLine; }
+
+	std::vector<UDMFField> Entries;
+	std::vector<UDMFField> Fields;
+	std::vector<UDMFBlock> Blocks;
+
+	// All distinct keys and string values, stored back to back. String i spans
+	// StringOffsets[i] to StringOffsets[i + 1].
+	std::vector<char> StringData;
+	std::vector<int32_t> StringOffsets;
+
+private:
+	bool ParseKey(int32_t& key);
+	bool ParseAssignment(UDMFField& field);
+	bool ParseString(UDMFField& field);
+	bool ParseNumber(UDMFField& field);
+	bool ParseKeyword(UDMFField& field);
+
+	void SkipWhitespace();
+	int32_t AddString(const char* str, size_t length);
+	bool Error(const char* fmt, ...);
+
+	const char* mPos = nullptr;
+	const char* mEnd = nullptr;
+	int mLine = 1;
+	int mErrorLine = 0;
+	bool mStrict = true;
+
+	std::string mValue;
+
+	// Open addressing table of string indices, and the hash of every string
+	std::vector<int32_t> mStringHash;
+	std::vector<uint32_t> mStringHashes;
+};
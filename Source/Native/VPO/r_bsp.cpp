@@ -71,13 +71,15 @@ Context::R_ClipSolidWallSegment ( int   first, int   last )
 	    // Post is entirely visible (above start),
 	    //  so insert a new clippost.
 	    R_StoreWallRange (first, last);
+	    if (render_stop)
+		return;
 	    next = newend;
 	    newend++;
 
       // andrewj: check for solidseg overflow
       max_solidsegs = MAX(max_solidsegs, (newend - solidsegs));
-      if (max_solidsegs >= MAXSOLIDSEGS)
-        throw overflow_exception();
+      if (R_CountExceeded (max_solidsegs, limits.maxsolidsegs, threshold_solidsegs))
+        return;
 	    
 	    while (next != start)
 	    {
@@ -91,6 +93,8 @@ Context::R_ClipSolidWallSegment ( int   first, int   last )
 		
 	// There is a fragment above *start.
 	R_StoreWallRange (first, start->first - 1);
+	if (render_stop)
+	    return;
 	// Now adjust the clip size.
 	start->first = first;	
     }
@@ -104,6 +108,8 @@ Context::R_ClipSolidWallSegment ( int   first, int   last )
     {
 	// There is a fragment between two posts.
 	R_StoreWallRange (next->last + 1, (next+1)->first - 1);
+	if (render_stop)
+	    return;
 	next++;
 	
 	if (last <= next->last)
@@ -117,6 +123,8 @@ Context::R_ClipSolidWallSegment ( int   first, int   last )
 	
     // There is a fragment after *next.
     R_StoreWallRange (next->last + 1, last);
+    if (render_stop)
+	return;
     // Adjust the clip size.
     start->last = last;
 	
@@ -140,8 +148,7 @@ Context::R_ClipSolidWallSegment ( int   first, int   last )
 
     // andrewj: check for solidseg overflow
     max_solidsegs = MAX(max_solidsegs, (newend - solidsegs));
-    if (max_solidsegs >= MAXSOLIDSEGS)
-      throw overflow_exception();
+    R_CountExceeded (max_solidsegs, limits.maxsolidsegs, threshold_solidsegs);
 }
 
 
@@ -174,6 +181,8 @@ void Context::R_ClipPassWallSegment ( int first, int last )
 		
 	// There is a fragment above *start.
 	R_StoreWallRange (first, start->first - 1);
+	if (render_stop)
+	    return;
     }
 
     // Bottom contained in start?
@@ -184,6 +193,8 @@ void Context::R_ClipPassWallSegment ( int first, int last )
     {
 	// There is a fragment between two posts.
 	R_StoreWallRange (start->last + 1, (start+1)->first - 1);
+	if (render_stop)
+	    return;
 	start++;
 	
 	if (last <= start->last)
@@ -477,6 +488,8 @@ void Context::R_Subsector (int num)
 	floorplane = R_FindPlane (frontsector->floorheight,
 				  frontsector->floorpic,
 				  frontsector->lightlevel);
+	if (render_stop)
+	    return;
     }
     else
 	floorplane = NULL;
@@ -487,6 +500,8 @@ void Context::R_Subsector (int num)
 	ceilingplane = R_FindPlane (frontsector->ceilingheight,
 				    frontsector->ceilingpic,
 				    frontsector->lightlevel);
+	if (render_stop)
+	    return;
     }
     else
 	ceilingplane = NULL;
@@ -496,6 +511,8 @@ void Context::R_Subsector (int num)
     while (count--)
     {
 	R_AddLine (line);
+	if (render_stop)
+	    return;
 	line++;
     }
 }
@@ -530,6 +547,8 @@ void Context::R_RenderBSPNode (int bspnum)
 
     // Recursively divide front space.
     R_RenderBSPNode (bsp->children[side]); 
+    if (render_stop)
+	return;
 
     // Possibly divide back space.
     if (R_CheckBBox (bsp->bbox[side^1]))	
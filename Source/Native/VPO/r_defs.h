@@ -286,17 +286,15 @@ typedef struct
 	int			minx;
 	int			maxx;
 
-	// leave pads for [minx-1]/[maxx+1]
-
-	byte		pad1;
-	// Here lies the rub for all
-	//  dynamic resize/change of resolution.
-	byte		top[SCREENWIDTH];
-	byte		pad2;
-	byte		pad3;
-	// See above.
-	byte		bottom[SCREENWIDTH];
-	byte		pad4;
+	// Sized for the render width of the context's limits,
+	//  with pads for [minx-1]/[maxx+1].
+	byte*		top;
+	byte*		bottom;
+
+	// One bit per column that has top/bottom set.
+	// Columns without a bit hold stale values, so
+	//  top/bottom never need to be cleared.
+	uint64_t*	columns;
 
 } visplane_t;
 
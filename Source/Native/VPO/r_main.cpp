@@ -378,11 +378,11 @@ void Context::R_InitBuffer ( int		width, int		height )
     // Handle resize,
     //  e.g. smaller view windows
     //  with border and/or status bar.
-    viewwindowx = (SCREENWIDTH-width) >> 1; 
+    viewwindowx = (limits.screenwidth-width) >> 1; 
     viewwindowy = 0; 
 
     // this was from R_InitSprites
-    for (i=0 ; i<SCREENWIDTH ; i++)
+    for (i=0 ; i<limits.screenwidth ; i++)
     {
       negonearray[i] = -1;
     }
@@ -420,8 +420,8 @@ void Context::R_InitTextureMapping (void)
     //  after the view angle.
     //
     // Calc focallength
-    //  so FIELDOFVIEW angles covers SCREENWIDTH.
-    focallength = FixedDiv (centerxfrac,
+    //  so FIELDOFVIEW angles covers limits.fovwidth.
+    focallength = FixedDiv ((limits.fovwidth/2)<<FRACBITS,
 			    finetangent[FINEANGLES/4+FIELDOFVIEW/2] );
 	
     for (i=0 ; i<FINEANGLES/2 ; i++)
@@ -482,8 +482,8 @@ void Context::R_SetViewSize ( int  blocks, int  detail )
 
     if (blocks == 11)
     {
-	scaledviewwidth = SCREENWIDTH;
-	viewheight = SCREENHEIGHT;
+	scaledviewwidth = limits.screenwidth;
+	viewheight = limits.screenheight;
     }
     else
     {
@@ -497,15 +497,15 @@ void Context::R_SetViewSize ( int  blocks, int  detail )
     centerx = viewwidth/2;
     centerxfrac = centerx<<FRACBITS;
     centeryfrac = centery<<FRACBITS;
-    projection = centerxfrac;
+    projection = (limits.fovwidth/2)<<FRACBITS;
 
     R_InitBuffer (scaledviewwidth, viewheight);
 	
     R_InitTextureMapping ();
 
     // psprite scales
-    pspritescale = FRACUNIT*viewwidth/SCREENWIDTH;
-    pspriteiscale = FRACUNIT*SCREENWIDTH/viewwidth;
+    pspritescale = FRACUNIT*viewwidth/limits.screenwidth;
+    pspriteiscale = FRACUNIT*limits.screenwidth/viewwidth;
     
     // thing clipping
     for (i=0 ; i<viewwidth ; i++)
@@ -516,7 +516,7 @@ void Context::R_SetViewSize ( int  blocks, int  detail )
     {
 	dy = ((i-viewheight/2)<<FRACBITS)+FRACUNIT/2;
 	dy = abs(dy);
-	yslope[i] = FixedDiv ( (viewwidth<<0)/2*FRACUNIT, dy);
+	yslope[i] = FixedDiv ( (limits.fovwidth<<0)/2*FRACUNIT, dy);
     }
 	
     for (i=0 ; i<viewwidth ; i++)
@@ -529,6 +529,99 @@ void Context::R_SetViewSize ( int  blocks, int  detail )
 
 
 
+//
+// R_Reserve
+// Reserves bytes in the scratch block, returns their offset.
+//
+static size_t R_Reserve (size_t* size, size_t bytes)
+{
+    size_t	offset = *size;
+
+    *size = (offset + bytes + 15) & ~(size_t)15;
+    return offset;
+}
+
+
+//
+// R_InitLimits
+// Sizes every per-frame array for the new limits and
+// screen size, all of them in one block of memory.
+//
+void Context::R_InitLimits (const limits_t* newlimits)
+{
+    size_t	size;
+    size_t	planebytes;
+    size_t	o_drawsegs, o_solidsegs, o_visplanes, o_planedata, o_hash, o_openings;
+    size_t	o_xtoview, o_heightarray, o_negone, o_floorclip, o_ceilingclip;
+    size_t	o_distscale, o_yslope;
+    unsigned int hashsize;
+    byte*	base;
+    byte*	plane;
+    int		numplanes;
+    int		width;
+    int		i;
+
+    limits = *newlimits;
+
+    width = limits.screenwidth;
+    numplanes = limits.maxvisplanes + 10;
+
+    hashsize = 256;
+    while (hashsize < (unsigned int)limits.maxvisplanes * 2)
+	hashsize <<= 1;
+
+    // columns, then top and bottom with a pad on each side
+    visplane_words = (width + 63) / 64;
+    planebytes = visplane_words * sizeof(uint64_t) + (width + 2) * 2;
+    planebytes = (planebytes + 7) & ~(size_t)7;
+
+    size = 0;
+    o_drawsegs    = R_Reserve (&size, (limits.maxdrawsegs + 10) * sizeof(drawseg_t));
+    o_solidsegs   = R_Reserve (&size, (limits.maxsolidsegs + 8) * sizeof(cliprange_t));
+    o_visplanes   = R_Reserve (&size, numplanes * sizeof(visplane_t));
+    o_planedata   = R_Reserve (&size, numplanes * planebytes);
+    o_hash        = R_Reserve (&size, hashsize * sizeof(visplane_hash_t));
+    o_openings    = R_Reserve (&size, (limits.maxopenings + width * 2) * sizeof(short));
+    o_xtoview     = R_Reserve (&size, (width + 1) * sizeof(angle_t));
+    o_heightarray = R_Reserve (&size, width * sizeof(short));
+    o_negone      = R_Reserve (&size, width * sizeof(short));
+    o_floorclip   = R_Reserve (&size, width * sizeof(short));
+    o_ceilingclip = R_Reserve (&size, width * sizeof(short));
+    o_distscale   = R_Reserve (&size, width * sizeof(fixed_t));
+    o_yslope      = R_Reserve (&size, limits.screenheight * sizeof(fixed_t));
+
+    scratch.assign (size + 15, 0);
+    base = (byte *)(((uintptr_t)scratch.data() + 15) & ~(uintptr_t)15);
+
+    drawsegs          = (drawseg_t *)       (base + o_drawsegs);
+    solidsegs         = (cliprange_t *)     (base + o_solidsegs);
+    visplanes         = (visplane_t *)      (base + o_visplanes);
+    visplane_hash     = (visplane_hash_t *) (base + o_hash);
+    openings          = (short *)           (base + o_openings);
+    xtoviewangle      = (angle_t *)         (base + o_xtoview);
+    screenheightarray = (short *)           (base + o_heightarray);
+    negonearray       = (short *)           (base + o_negone);
+    floorclip         = (short *)           (base + o_floorclip);
+    ceilingclip       = (short *)           (base + o_ceilingclip);
+    distscale         = (fixed_t *)         (base + o_distscale);
+    yslope            = (fixed_t *)         (base + o_yslope);
+
+    plane = base + o_planedata;
+
+    for (i=0 ; i<numplanes ; i++, plane += planebytes)
+    {
+	visplanes[i].columns = (uint64_t *) plane;
+	visplanes[i].top = plane + visplane_words * sizeof(uint64_t) + 1;
+	visplanes[i].bottom = visplanes[i].top + width + 2;
+    }
+
+    visplane_hash_mask = hashsize - 1;
+    visplane_generation = 0;
+
+    R_Init ();
+}
+
+
 //
 // R_Init
 //
@@ -594,6 +687,8 @@ void Context::R_RenderView (fixed_t x, fixed_t y, fixed_t z, angle_t angle)
 {	
     R_SetupFrame (x, y, z, angle);
 
+    render_stop = RENDER_COMPLETE;
+
     // Clear buffers.
     R_ClearClipSegs ();
     R_ClearDrawSegs ();
@@ -605,5 +700,21 @@ void Context::R_RenderView (fixed_t x, fixed_t y, fixed_t z, angle_t angle)
 }
 
 
+//
+// R_CountExceeded
+// Stops the render when a count reaches its internal limit
+// or goes past the threshold set by VPO_SetThresholds.
+//
+boolean Context::R_CountExceeded (int count, int limit, int threshold)
+{
+    if (count >= limit)
+	render_stop = RENDER_OVERFLOW;
+    else if (count > threshold)
+	render_stop = RENDER_THRESHOLD;
+
+    return render_stop != RENDER_COMPLETE;
+}
+
+
 } // namespace vpo
 
@@ -127,8 +127,12 @@ void Context::R_ClearPlanes (void)
     lastvisplane = visplanes;
     lastopening = openings;
 
-    // texture calculation
-    memset (cachedheight, 0, sizeof(cachedheight));
+    // forget all hashed visplanes
+    if (++visplane_generation == 0)
+    {
+	memset (visplane_hash, 0, (visplane_hash_mask + 1) * sizeof(visplane_hash_t));
+	visplane_generation = 1;
+    }
 
     // left to right mapping
     angle = (viewangle-ANG90)>>ANGLETOFINESHIFT;
@@ -144,48 +148,105 @@ void Context::R_ClearPlanes (void)
 //
 // R_FindPlane
 //
+// The original did a linear search of all visplanes.
+// Planes are never removed during a frame and R_CheckPlane only
+// adds planes whose key already exists, so hashing the first plane
+// of each key returns the same plane as that search did.
+//
 visplane_t* Context::R_FindPlane ( fixed_t height, int  picnum, int  lightlevel )
 {
     visplane_t*	check;
+    visplane_hash_t* entry;
+    unsigned int slot;
 	
     if (picnum == skyflatnum)
     {
 	height = 0;			// all skys map together
 	lightlevel = 0;
     }
-	
-    for (check=visplanes; check<lastvisplane; check++)
+
+    slot = (unsigned int)height * 0x9E3779B1u;
+    slot ^= (unsigned int)picnum * 0x85EBCA77u;
+    slot ^= (unsigned int)lightlevel * 0xC2B2AE3Du;
+    slot ^= slot >> 15;
+
+    for (;;)
     {
+	entry = &visplane_hash[slot & visplane_hash_mask];
+
+	if (entry->generation != visplane_generation)
+	    break;
+
+	check = visplanes + entry->index;
+
 	if (height == check->height
 	    && picnum == check->picnum
 	    && lightlevel == check->lightlevel)
 	{
-	    break;
+	    return check;
 	}
+
+	slot++;
     }
-    
-			
-    if (check < lastvisplane)
-	return check;
 		
-    if (total_visplanes >= MAXVISPLANES)
-      throw overflow_exception(); // I_Error ("R_FindPlane: no more visplanes");
+    if (R_CountExceeded (total_visplanes + 1, limits.maxvisplanes + 1, threshold_visplanes))
+      return NULL; // I_Error ("R_FindPlane: no more visplanes");
 		
+    check = lastvisplane;
+
+    entry->generation = visplane_generation;
+    entry->index = (int)(check - visplanes);
+
     total_visplanes++;
     lastvisplane++;
 
     check->height = height;
     check->picnum = picnum;
     check->lightlevel = lightlevel;
-    check->minx = SCREENWIDTH;
+    check->minx = viewwidth;
     check->maxx = -1;
     
-    memset (check->top,0xff,sizeof(check->top));
+    memset (check->columns,0,visplane_words * sizeof(uint64_t));
 		
     return check;
 }
 
 
+//
+// R_AnyColumnSet
+// True when any column from x1 to x2 inclusive is in use,
+// replaces scanning top[] for 0xff one byte at a time.
+//
+static bool R_AnyColumnSet (const visplane_t* pl, int x1, int x2)
+{
+    uint64_t	first;
+    uint64_t	last;
+    int		w1;
+    int		w2;
+    int		w;
+
+    if (x1 > x2)
+	return false;
+
+    w1 = x1 >> 6;
+    w2 = x2 >> 6;
+    first = ~(uint64_t)0 << (x1 & 63);
+    last = ~(uint64_t)0 >> (63 - (x2 & 63));
+
+    if (w1 == w2)
+	return (pl->columns[w1] & first & last) != 0;
+
+    if (pl->columns[w1] & first)
+	return true;
+
+    for (w = w1 + 1 ; w < w2 ; w++)
+	if (pl->columns[w])
+	    return true;
+
+    return (pl->columns[w2] & last) != 0;
+}
+
+
 //
 // R_CheckPlane
 //
@@ -195,7 +256,6 @@ visplane_t* Context::R_CheckPlane ( visplane_t* pl, int  start, int  stop )
     int		intrh;
     int		unionl;
     int		unionh;
-    int		x;
 	
     if (start < pl->minx)
     {
@@ -219,11 +279,7 @@ visplane_t* Context::R_CheckPlane ( visplane_t* pl, int  start, int  stop )
 	intrh = stop;
     }
 
-    for (x=intrl ; x<= intrh ; x++)
-	if (pl->top[x] != 0xff)
-	    break;
-
-    if (x > intrh)
+    if (!R_AnyColumnSet (pl, intrl, intrh))
     {
 	pl->minx = unionl;
 	pl->maxx = unionh;
@@ -237,8 +293,8 @@ visplane_t* Context::R_CheckPlane ( visplane_t* pl, int  start, int  stop )
     lastvisplane->picnum = pl->picnum;
     lastvisplane->lightlevel = pl->lightlevel;
     
-    if (total_visplanes >= MAXVISPLANES)
-      throw overflow_exception(); // I_Error ("R_FindPlane: no more visplanes");
+    if (R_CountExceeded (total_visplanes + 1, limits.maxvisplanes + 1, threshold_visplanes))
+      return NULL; // I_Error ("R_FindPlane: no more visplanes");
 
     total_visplanes++;
 
@@ -246,7 +302,7 @@ visplane_t* Context::R_CheckPlane ( visplane_t* pl, int  start, int  stop )
     pl->minx = start;
     pl->maxx = stop;
 
-    memset (pl->top,0xff,sizeof(pl->top));
+    memset (pl->columns,0,visplane_words * sizeof(uint64_t));
 
     return pl;
 }
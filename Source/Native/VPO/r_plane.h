@@ -56,6 +56,14 @@ visplane_t* R_CheckPlane ( visplane_t* pl, int start, int stop );
 // #define MAXOPENINGS	SCREENWIDTH*64
 #define MAXOPENINGS	SCREENWIDTH*256  // andrewj: increased for Visplane Explorer
 
+typedef struct
+{
+	// entries from an earlier frame are empty
+	unsigned int	generation;
+	int		index;
+
+} visplane_hash_t;
+
 /*
 extern int total_visplanes;
 extern int total_drawsegs;
@@ -72,6 +72,7 @@ void Context::R_RenderSegLoop (void)
       {
         ceilingplane->top[rw_x] = top;
         ceilingplane->bottom[rw_x] = bottom;
+        ceilingplane->columns[rw_x >> 6] |= (uint64_t)1 << (rw_x & 63);
       }
     }
 
@@ -90,6 +91,7 @@ void Context::R_RenderSegLoop (void)
       {
         floorplane->top[rw_x] = top;
         floorplane->bottom[rw_x] = bottom;
+        floorplane->columns[rw_x >> 6] |= (uint64_t)1 << (rw_x & 63);
       }
     }
 
@@ -215,8 +217,8 @@ void Context::R_StoreWallRange ( int	start, int	stop )
   // don't overflow and crash
   total_drawsegs++;
 
-  if (total_drawsegs >= MAXDRAWSEGS)
-    throw overflow_exception();
+  if (R_CountExceeded (total_drawsegs, limits.maxdrawsegs, threshold_drawsegs))
+    return;
 
 #ifdef RANGECHECK
   if (start >=viewwidth || start > stop)
@@ -428,8 +430,8 @@ void Context::R_StoreWallRange ( int	start, int	stop )
       lastopening += rw_stopx - rw_x;
       total_openings += (rw_stopx - rw_x);
 
-      if (total_openings >= MAXOPENINGS)
-        throw overflow_exception();
+      if (R_CountExceeded (total_openings, limits.maxopenings, threshold_openings))
+        return;
     }
   }
 
@@ -510,10 +512,18 @@ void Context::R_StoreWallRange ( int	start, int	stop )
 
   // render it
   if (markceiling)
+  {
     ceilingplane = R_CheckPlane (ceilingplane, rw_x, rw_stopx-1);
+    if (render_stop)
+      return;
+  }
 
   if (markfloor)
+  {
     floorplane = R_CheckPlane (floorplane, rw_x, rw_stopx-1);
+    if (render_stop)
+      return;
+  }
 
   R_RenderSegLoop ();
 
@@ -527,8 +537,8 @@ void Context::R_StoreWallRange ( int	start, int	stop )
     lastopening += rw_stopx - start;
     total_openings += (rw_stopx - start);
 
-    if (total_openings >= MAXOPENINGS)
-      throw overflow_exception();
+    if (R_CountExceeded (total_openings, limits.maxopenings, threshold_openings))
+      return;
   }
 
   if ( ((ds_p->silhouette & SIL_BOTTOM) || maskedtexture)
@@ -539,8 +549,8 @@ void Context::R_StoreWallRange ( int	start, int	stop )
     lastopening += rw_stopx - start;	
     total_openings += (rw_stopx - start);
 
-    if (total_openings >= MAXOPENINGS)
-      throw overflow_exception();
+    if (R_CountExceeded (total_openings, limits.maxopenings, threshold_openings))
+      return;
   }
 
   if (maskedtexture && !(ds_p->silhouette&SIL_TOP))
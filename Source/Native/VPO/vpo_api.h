@@ -83,13 +83,40 @@ void VPO_OpenDoorSectors(VPOContext ctx, int dir);
 // hence you need to set those variables to zero before the first
 // call at a particular (X Y) location.
 //
-// RESULT_OVERFLOW means that an internal limit overflowed (which are
-// four times or more the actual DOOM limits).
-
-#define RESULT_OK         0
-#define RESULT_BAD_Z     -1
-#define RESULT_IN_VOID   -2
-#define RESULT_OVERFLOW  -3
+// RESULT_OVERFLOW means that an internal limit overflowed (by default
+// those are four times or more the actual DOOM limits, see VPO_SetLimits).
+//
+// RESULT_OVER_THRESHOLD means that a count went past the threshold set
+// with VPO_SetThresholds() and the render was stopped there, so the
+// num_xxx values are only known to be at least that large.
+
+#define RESULT_OK              0
+#define RESULT_BAD_Z          -1
+#define RESULT_IN_VOID        -2
+#define RESULT_OVERFLOW       -3
+#define RESULT_OVER_THRESHOLD -4
+
+// engine limits and screen size the spots are tested against
+#define VPO_LIMITS_DEFAULT      0  // 320x200, limits raised far above vanilla
+#define VPO_LIMITS_VANILLA      1  // doom.exe / doom2.exe
+#define VPO_LIMITS_DOOM_PLUS    2  // vanilla with the doom-plus exe patch
+#define VPO_LIMITS_CHOCOLATE    3  // Chocolate Doom
+#define VPO_LIMITS_WIDESCREEN   4  // 426x200 (16:9), limits as the default
+
+// select the limits used by VPO_TestSpot (VPO_LIMITS_DEFAULT for a
+// new context).  internal limits overflow at these values, so the
+// num_xxx values of VPO_TestSpot never go past them.
+// returns 0 on success, negative value for an unknown profile
+int VPO_SetLimits(VPOContext ctx, int profile);
+
+// stop VPO_TestSpot as soon as a count goes above its threshold,
+// for when only "over or under the limit" is needed.
+// a value <= 0 disables the threshold for that count (the default).
+void VPO_SetThresholds(VPOContext ctx,
+                       int visplanes,
+                       int drawsegs,
+                       int openings,
+                       int solidsegs);
 
 int VPO_TestSpot(VPOContext ctx,
                  int x, int y, int dz, int angle,
@@ -74,8 +74,13 @@ void I_Error (const char *error, ...);
 
 sector_t * X_SectorForPoint(fixed_t x, fixed_t y);
 
-// exceptions thrown on overflows
-class overflow_exception { };
+// why R_RenderView stopped before the whole view was rendered
+enum render_stop_t
+{
+	RENDER_COMPLETE = 0,
+	RENDER_OVERFLOW,     // an internal limit overflowed
+	RENDER_THRESHOLD     // a count went past the caller's threshold
+};
 
 //
 // ClipWallSegment
@@ -93,6 +98,26 @@ typedef	struct
 // #define MAXSOLIDSEGS		32
 #define MAXSOLIDSEGS  128
 
+//
+// Engine limits and render resolution of a context,
+// the MAXxxx values above are the defaults.
+//
+typedef struct
+{
+	int		screenwidth;
+	int		screenheight;
+
+	// the 90 degree field of view covers this many columns,
+	// wider screens see more to the sides (like widescreen ports)
+	int		fovwidth;
+
+	int		maxvisplanes;
+	int		maxdrawsegs;
+	int		maxopenings;
+	int		maxsolidsegs;
+
+} limits_t;
+
 typedef struct
 {
 	// Should be "IWAD" or "PWAD".
@@ -156,9 +181,11 @@ struct Context
 	void R_InitTextureMapping();
 	void R_SetViewSize(int blocks, int detail);
 	void R_Init();
+	void R_InitLimits(const limits_t* newlimits);
 	subsector_t* R_PointInSubsector(fixed_t x, fixed_t y);
 	void R_SetupFrame(fixed_t x, fixed_t y, fixed_t z, angle_t angle);
 	void R_RenderView(fixed_t x, fixed_t y, fixed_t z, angle_t angle);
+	boolean R_CountExceeded(int count, int limit, int threshold);
 
 	void R_ClearPlanes();
 	visplane_t* R_FindPlane(fixed_t height, int picnum, int lightlevel);
@@ -217,17 +244,31 @@ struct Context
 	sector_t* frontsector = {};
 	sector_t* backsector = {};
 
-	drawseg_t drawsegs[MAXDRAWSEGS + 10] = {};
+	// engine limits, VPO_SetLimits picks these from a profile
+	limits_t limits = {};
+
+	// all arrays sized by the limits, carved out by R_InitLimits
+	std::vector<byte> scratch;
+
+	drawseg_t* drawsegs = {};
 	drawseg_t* ds_p = {};
 
 	int total_drawsegs = {};
 
 	// newend is one past the last valid seg
-	cliprange_t	solidsegs[MAXSOLIDSEGS + 8] = {};
+	cliprange_t* solidsegs = {};
 	cliprange_t* newend = {};
 
 	int max_solidsegs = {};
 
+	// set when a count overflows or exceeds its threshold, everything
+	// up the call chain returns as soon as it sees this
+	render_stop_t render_stop = {};
+
+	int threshold_visplanes = INT_MAX;
+	int threshold_drawsegs = INT_MAX;
+	int threshold_openings = INT_MAX;
+	int threshold_solidsegs = INT_MAX;
 
 	int			viewangleoffset = {};
 
@@ -273,7 +314,7 @@ struct Context
 	// The xtoviewangleangle[] table maps a screen pixel
 	// to the lowest viewangle that maps back to x ranges
 	// from clipangle to -clipangle.
-	angle_t			xtoviewangle[SCREENWIDTH + 1] = {};
+	angle_t*		xtoviewangle = {};
 
 
 	// UNUSED.
@@ -302,22 +343,29 @@ struct Context
 	fixed_t  pspritescale = {};
 	fixed_t  pspriteiscale = {};
 
-	short  screenheightarray[SCREENWIDTH] = {};
-	short  negonearray[SCREENWIDTH] = {};
+	short* screenheightarray = {};
+	short* negonearray = {};
 
 	//
 	// opening
 	//
 
 	// Here comes the obnoxious "visplane".
-	visplane_t visplanes[MAXVISPLANES + 10] = {};
+	visplane_t* visplanes = {};
+	int visplane_words = {};
 	visplane_t* lastvisplane = {};
 	visplane_t* floorplane = {};
 	visplane_t* ceilingplane = {};
 
 	int total_visplanes = {};
 
-	short openings[MAXOPENINGS + 400] = {};
+	// hash of the first visplane for each height/picnum/lightlevel,
+	// a power of two and at least twice limits.maxvisplanes
+	visplane_hash_t* visplane_hash = {};
+	unsigned int visplane_hash_mask = {};
+	unsigned int visplane_generation = {};
+
+	short* openings = {};
 	short* lastopening = {};
 
 	int total_openings = {};
@@ -328,31 +376,19 @@ struct Context
 	//  floorclip starts out SCREENHEIGHT
 	//  ceilingclip starts out -1
 	//
-	short floorclip[SCREENWIDTH] = {};
-	short ceilingclip[SCREENWIDTH] = {};
-
-	//
-	// spanstart holds the start of a plane span
-	// initialized to 0 at start
-	//
-	int spanstart[SCREENHEIGHT] = {};
-	int spanstop[SCREENHEIGHT] = {};
+	short* floorclip = {};
+	short* ceilingclip = {};
 
 	//
 	// texture mapping
 	//
 	fixed_t			planeheight = {};
 
-	fixed_t			yslope[SCREENHEIGHT] = {};
-	fixed_t			distscale[SCREENWIDTH] = {};
+	fixed_t*		yslope = {};
+	fixed_t*		distscale = {};
 	fixed_t			basexscale = {};
 	fixed_t			baseyscale = {};
 
-	fixed_t			cachedheight[SCREENHEIGHT] = {};
-	fixed_t			cacheddistance[SCREENHEIGHT] = {};
-	fixed_t			cachedxstep[SCREENHEIGHT] = {};
-	fixed_t			cachedystep[SCREENHEIGHT] = {};
-
 	// OPTIMIZE: closed two sided lines as single sided
 
 	// True if any of the segs textures might be visible.
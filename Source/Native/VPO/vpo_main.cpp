@@ -47,9 +47,32 @@ const char *VPO_GetError(VPOContext ctx)
 
 //------------------------------------------------------------------------
 
+// indexed by the VPO_LIMITS_XXX values
+static const vpo::limits_t limit_profiles[] =
+{
+	// VPO_LIMITS_DEFAULT
+	{ SCREENWIDTH, SCREENHEIGHT, SCREENWIDTH, MAXVISPLANES, MAXDRAWSEGS, MAXOPENINGS, MAXSOLIDSEGS },
+
+	// VPO_LIMITS_VANILLA
+	{ 320, 200, 320, 128, 256, 320*64, 32 },
+
+	// VPO_LIMITS_DOOM_PLUS : visplanes and drawsegs raised by the exe patch
+	{ 320, 200, 320, 1024, 2048, 320*64, 32 },
+
+	// VPO_LIMITS_CHOCOLATE : vanilla, but the clip list can hold every possible range
+	{ 320, 200, 320, 128, 256, 320*64, 320/2 + 1 },
+
+	// VPO_LIMITS_WIDESCREEN : 16:9 with the same vertical view as 320x200
+	{ 426, 200, 320, MAXVISPLANES, MAXDRAWSEGS, 426*256, MAXSOLIDSEGS },
+};
+
 VPOContext VPO_NewContext()
 {
-	return new vpo::Context();
+	vpo::Context* context = new vpo::Context();
+
+	context->R_InitLimits(&limit_profiles[VPO_LIMITS_DEFAULT]);
+
+	return context;
 }
 
 void VPO_DeleteContext(VPOContext ctx)
@@ -248,6 +271,37 @@ void VPO_OpenDoorSectors(VPOContext ctx, int dir)
 }
 
 
+//------------------------------------------------------------------------
+
+int VPO_SetLimits(VPOContext ctx, int profile)
+{
+	vpo::Context* context = (vpo::Context*)ctx;
+
+	context->ClearError();
+
+	if (profile < 0 || profile >= (int)(sizeof(limit_profiles) / sizeof(limit_profiles[0])))
+	{
+		context->SetError("Unknown limits profile: %d", profile);
+		return -1;
+	}
+
+	context->R_InitLimits(&limit_profiles[profile]);
+
+	return 0;
+}
+
+
+void VPO_SetThresholds(VPOContext ctx, int visplanes, int drawsegs, int openings, int solidsegs)
+{
+	vpo::Context* context = (vpo::Context*)ctx;
+
+	context->threshold_visplanes = (visplanes > 0) ? visplanes : INT_MAX;
+	context->threshold_drawsegs  = (drawsegs  > 0) ? drawsegs  : INT_MAX;
+	context->threshold_openings  = (openings  > 0) ? openings  : INT_MAX;
+	context->threshold_solidsegs = (solidsegs > 0) ? solidsegs : INT_MAX;
+}
+
+
 //------------------------------------------------------------------------
 
 int VPO_TestSpot(VPOContext ctx, int x, int y, int dz, int angle,
@@ -309,14 +363,12 @@ int VPO_TestSpot(VPOContext ctx, int x, int y, int dz, int angle,
 	int result = RESULT_OK;
 
 	// perform a no-draw render and see how many visplanes were needed
-	try
-	{
-		context->R_RenderView(rx, ry, rz, r_ang);
-	}
-	catch (vpo::overflow_exception&)
-	{
+	context->R_RenderView(rx, ry, rz, r_ang);
+
+	if (context->render_stop == vpo::RENDER_OVERFLOW)
 		result = RESULT_OVERFLOW;
-	}
+	else if (context->render_stop == vpo::RENDER_THRESHOLD)
+		result = RESULT_OVER_THRESHOLD;
 
 	*num_visplanes = MAX(*num_visplanes, context->total_visplanes);
 	*num_drawsegs  = MAX(*num_drawsegs, context->total_drawsegs);
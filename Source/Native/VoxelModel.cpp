@@ -0,0 +1,391 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "Precomp.h"
+#include "VoxelModel.h"
+#include "Backend.h"
+#include <cstring>
+
+namespace
+{
+	// One of the six face directions. Quads span the U and V axes and start at the end of
+	// the U range when FlipU is set, which keeps the winding of the faces KVXModelLoader made.
+	struct FaceDirection
+	{
+		int Flag;
+		int Normal; // Axis the face is perpendicular to
+		int Offset; // Face is at the start (0) or end (1) of the voxel along the normal
+		int U;
+		int V;
+		bool FlipU;
+	};
+
+	const FaceDirection FaceDirections[6] =
+	{
+		{ 1, 0, 0, 1, 2, false }, // Left
+		{ 2, 0, 1, 1, 2, true }, // Right
+		{ 4, 1, 0, 0, 2, true }, // Back
+		{ 8, 1, 1, 0, 2, false }, // Front
+		{ 16, 2, 0, 0, 1, false }, // Top
+		{ 32, 2, 1, 0, 1, true } // Bottom
+	};
+
+	// KVX files are at most 256 voxels in each direction, but allow some slack
+	const int MaxSize = 1024;
+	const int MaxVoxels = 1 << 24;
+
+	const int HeaderSize = 28;
+	const int PaletteSize = 768;
+
+	inline int32_t ReadInt32(const uint8_t* p)
+	{
+		int32_t v;
+		memcpy(&v, p, sizeof(int32_t));
+		return v;
+	}
+
+	inline uint16_t ReadUInt16(const uint8_t* p)
+	{
+		return p[0] | (p[1] << 8);
+	}
+}
+
+bool VoxelModel::Load(const uint8_t* data, int size)
+{
+	mSizeX = mSizeY = mSizeZ = 0;
+	mColors.clear();
+	mFlags.clear();
+	mVertices.clear();
+	mIndices.clear();
+
+	if (!data || size < HeaderSize + PaletteSize)
+	{
+		SetError("Voxel data is too small");
+		return false;
+	}
+
+	int sizex = ReadInt32(data + 4);
+	int sizey = ReadInt32(data + 8);
+	int sizez = ReadInt32(data + 12);
+	if (sizex <= 0 || sizey <= 0 || sizez <= 0 || sizex > MaxSize || sizey > MaxSize || sizez > MaxSize || (int64_t)sizex * sizey * sizez > MaxVoxels)
+	{
+		SetError("voxel has invalid size (width: %d, height: %d, depth: %d)", sizex, sizez, sizey);
+		return false;
+	}
+
+	// Column offsets are counted from the start of the x offsets
+	const uint8_t* xoffsets = data + HeaderSize;
+	const uint8_t* xyoffsets = xoffsets + (sizex + 1) * sizeof(int32_t);
+	int64_t slabsstart = HeaderSize + (int64_t)(sizex + 1) * sizeof(int32_t) + (int64_t)sizex * (sizey + 1) * sizeof(uint16_t);
+	int64_t slabsend = size - PaletteSize;
+	if (slabsstart > slabsend)
+	{
+		SetError("Voxel offset tables are truncated");
+		return false;
+	}
+
+	mSizeX = sizex;
+	mSizeY = sizey;
+	mSizeZ = sizez;
+	mPivotX = ReadInt32(data + 16) / 256.0f;
+	mPivotY = ReadInt32(data + 20) / 256.0f;
+	mPivotZ = ReadInt32(data + 24) / 256.0f;
+	mColors.resize((size_t)sizex * sizey * sizez);
+	mFlags.resize(mColors.size());
+
+	for (int x = 0; x < sizex; x++)
+	{
+		int64_t xoffset = ReadInt32(xoffsets + x * sizeof(int32_t)) + (int64_t)HeaderSize;
+		const uint8_t* column = xyoffsets + x * (sizey + 1) * sizeof(uint16_t);
+		for (int y = 0; y < sizey; y++)
+		{
+			int64_t pos = xoffset + ReadUInt16(column + y * sizeof(uint16_t));
+			int64_t end = std::min(xoffset + ReadUInt16(column + (y + 1) * sizeof(uint16_t)), slabsend);
+			if (pos < slabsstart || pos > slabsend)
+			{
+				SetError("Voxel column %d, %d is out of range", x, y);
+				return false;
+			}
+
+			// Each slab is a vertical run of voxels with the faces that are visible on all of them
+			while (pos + 3 <= end)
+			{
+				int ztop = data[pos];
+				int zleng = data[pos + 1];
+				int flags = data[pos + 2];
+				if (ztop + zleng > sizez || pos + 3 + zleng > end)
+					break;
+
+				const uint8_t* colors = data + pos + 3;
+				for (int i = 0; i < zleng; i++)
+				{
+					int offset = Offset(x, y, ztop + i);
+					int voxelflags = Solid | (flags & (FaceLeft | FaceRight | FaceBack | FaceFront));
+					if (flags != 0) voxelflags |= Drawn;
+					if (i == 0) voxelflags |= flags & FaceTop;
+					if (i == zleng - 1) voxelflags |= flags & FaceBottom;
+					mColors[offset] = colors[i];
+					mFlags[offset] = voxelflags;
+				}
+
+				pos += 3 + zleng;
+			}
+		}
+	}
+
+	return true;
+}
+
+void VoxelModel::BuildMesh()
+{
+	mVertices.clear();
+	mIndices.clear();
+
+	// Quads share corners with the same color and texture coordinate
+	std::unordered_map<uint64_t, int32_t> lookup;
+
+	const int sizes[3] = { mSizeX, mSizeY, mSizeZ };
+	std::vector<int> mask;
+	for (const FaceDirection& dir : FaceDirections)
+	{
+		int usize = sizes[dir.U];
+		int vsize = sizes[dir.V];
+		mask.resize((size_t)usize * vsize);
+
+		int pos[3];
+		for (int s = 0; s < sizes[dir.Normal]; s++)
+		{
+			// Colors of the visible faces in this slice, -1 where there is none
+			pos[dir.Normal] = s;
+			for (int v = 0; v < vsize; v++)
+			{
+				pos[dir.V] = v;
+				for (int u = 0; u < usize; u++)
+				{
+					pos[dir.U] = u;
+					int offset = Offset(pos[0], pos[1], pos[2]);
+					mask[v * usize + u] = (mFlags[offset] & dir.Flag) ? mColors[offset] : -1;
+				}
+			}
+
+			// Grow each face into the largest run of the same color along U, and then along V as long as whole runs match
+			for (int v = 0; v < vsize; v++)
+			{
+				int* row = mask.data() + v * usize;
+				int u = 0;
+				while (u < usize)
+				{
+					int color = row[u];
+					if (color == -1)
+					{
+						u++;
+						continue;
+					}
+
+					int width = 1;
+					while (u + width < usize && row[u + width] == color)
+						width++;
+
+					int height = 1;
+					while (v + height < vsize)
+					{
+						const int* next = row + height * usize + u;
+						int i = 0;
+						while (i < width && next[i] == color)
+							i++;
+						if (i != width)
+							break;
+						height++;
+					}
+
+					for (int j = 0; j < height; j++)
+						std::fill(row + j * usize + u, row + j * usize + u + width, -1);
+
+					int origin[3], a[3], b[3];
+					origin[dir.Normal] = a[dir.Normal] = b[dir.Normal] = s + dir.Offset;
+					origin[dir.U] = b[dir.U] = dir.FlipU ? u + width : u;
+					a[dir.U] = dir.FlipU ? u : u + width;
+					origin[dir.V] = a[dir.V] = v;
+					b[dir.V] = v + height;
+					AddQuad(lookup, origin, a, b, color);
+
+					u += width;
+				}
+			}
+		}
+	}
+}
+
+void VoxelModel::AddQuad(std::unordered_map<uint64_t, int32_t>& lookup, const int* origin, const int* a, const int* b, int color)
+{
+	// The voxel palette texture has a 16x16 grid of colors
+	float u0 = (color % 16) / 16.0f;
+	float u1 = u0 + 0.001f;
+	float v0 = (color / 16) / 16.0f;
+	float v1 = v0 + 0.001f;
+
+	int corners[4][3];
+	for (int i = 0; i < 3; i++)
+	{
+		corners[0][i] = origin[i];
+		corners[1][i] = a[i];
+		corners[2][i] = a[i] + b[i] - origin[i];
+		corners[3][i] = b[i];
+	}
+
+	int32_t indices[4];
+	for (int i = 0; i < 4; i++)
+	{
+		uint64_t key = (uint64_t)corners[i][0] | ((uint64_t)corners[i][1] << 11) | ((uint64_t)corners[i][2] << 22) | ((uint64_t)color << 33) | ((uint64_t)(i & 1) << 41);
+		auto it = lookup.find(key);
+		if (it != lookup.end())
+		{
+			indices[i] = it->second;
+			continue;
+		}
+
+		indices[i] = (int32_t)mVertices.size();
+		lookup[key] = indices[i];
+
+		VoxelVertex vertex;
+		vertex.x = corners[i][0] - mPivotX;
+		vertex.y = -corners[i][1] + mPivotY;
+		vertex.z = -corners[i][2] + mPivotZ;
+		vertex.c = -1;
+		vertex.u = (i & 1) ? u1 : u0;
+		vertex.v = (i & 1) ? v1 : v0;
+		vertex.nx = 0.0f;
+		vertex.ny = 0.0f;
+		vertex.nz = 0.0f;
+		mVertices.push_back(vertex);
+	}
+
+	mIndices.push_back(indices[0]);
+	mIndices.push_back(indices[1]);
+	mIndices.push_back(indices[2]);
+	mIndices.push_back(indices[3]);
+	mIndices.push_back(indices[0]);
+	mIndices.push_back(indices[2]);
+}
+
+bool VoxelModel::Project(int angle, const uint32_t* palette, uint32_t* dest) const
+{
+	if (angle != 0 && angle != 90 && angle != 180 && angle != 270)
+	{
+		SetError("Invalid voxel projection angle %d", angle);
+		return false;
+	}
+
+	// The voxels seen from the back and left are drawn front to back, the others back to front
+	int width = (angle == 0 || angle == 180) ? mSizeX : mSizeY;
+	bool keepfirst = (angle == 90 || angle == 180);
+	size_t numpixels = (size_t)width * mSizeZ;
+	std::fill(dest, dest + numpixels, 0);
+
+	for (int x = 0; x < mSizeX; x++)
+	{
+		for (int y = 0; y < mSizeY; y++)
+		{
+			for (int z = 0; z < mSizeZ; z++)
+			{
+				int offset = Offset(x, y, z);
+				if ((mFlags[offset] & Drawn) == 0)
+					continue;
+
+				int pixel;
+				switch (angle)
+				{
+				default:
+				case 0: pixel = x + z * mSizeX; break;
+				case 90: pixel = y + z * mSizeY; break;
+				case 180: pixel = mSizeX - x - 1 + z * mSizeX; break;
+				case 270: pixel = mSizeY - y - 1 + z * mSizeY; break;
+				}
+
+				if (!keepfirst || APART(dest[pixel]) == 0)
+					dest[pixel] = palette[mColors[offset]];
+			}
+		}
+	}
+
+	// Only opaque palette colors are drawn
+	for (size_t i = 0; i < numpixels; i++)
+	{
+		if (APART(dest[i]) != 255)
+			dest[i] = 0;
+	}
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+extern "C"
+{
+
+VoxelModel* VoxelModel_New()
+{
+	return new VoxelModel();
+}
+
+void VoxelModel_Delete(VoxelModel* model)
+{
+	delete model;
+}
+
+bool VoxelModel_Load(VoxelModel* model, const uint8_t* data, int size)
+{
+	return model->Load(data, size);
+}
+
+void VoxelModel_GetInfo(VoxelModel* model, int* sizex, int* sizey, int* sizez, float* pivotx, float* pivoty, float* pivotz)
+{
+	*sizex = model->GetSizeX();
+	*sizey = model->GetSizeY();
+	*sizez = model->GetSizeZ();
+	*pivotx = model->GetPivotX();
+	*pivoty = model->GetPivotY();
+	*pivotz = model->GetPivotZ();
+}
+
+void VoxelModel_BuildMesh(VoxelModel* model, int* vertexcount, int* indexcount)
+{
+	model->BuildMesh();
+	*vertexcount = (int)model->GetVertices().size();
+	*indexcount = (int)model->GetIndices().size();
+}
+
+void VoxelModel_CopyMesh(VoxelModel* model, VoxelVertex* vertices, int32_t* indices)
+{
+	const std::vector<VoxelVertex>& srcvertices = model->GetVertices();
+	const std::vector<int32_t>& srcindices = model->GetIndices();
+	if (!srcvertices.empty())
+		memcpy(vertices, srcvertices.data(), srcvertices.size() * sizeof(VoxelVertex));
+	if (!srcindices.empty())
+		memcpy(indices, srcindices.data(), srcindices.size() * sizeof(int32_t));
+}
+
+bool VoxelModel_Project(VoxelModel* model, int angle, const uint32_t* palette, uint32_t* dest)
+{
+	return model->Project(angle, palette, dest);
+}
+
+}
@@ -0,0 +1,88 @@
+/*
+**  BuilderNative Renderer
+**  Copyright (c) 2019 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#pragma once
+
+#include <unordered_map>
+
+// Same layout as WorldVertex
+struct VoxelVertex
+{
+	float x, y, z;
+	int32_t c;
+	float u, v;
+	float nx, ny, nz;
+};
+
+// Loads KVX voxels into a dense volume. Meshes are made with greedy meshing, which merges
+// the visible faces of neighbouring voxels with the same color into a single quad.
+class VoxelModel
+{
+public:
+	bool Load(const uint8_t* data, int size);
+
+	// Builds the mesh in the same space and with the same texture coordinates as KVXModelLoader did
+	void BuildMesh();
+
+	// Front projection of the voxel for sprite images, as seen from one of the cardinal directions.
+	// Pixels without a voxel get 0.
+	bool Project(int angle, const uint32_t* palette, uint32_t* dest) const;
+
+	int GetSizeX() const { return mSizeX; }
+	int GetSizeY() const { return mSizeY; }
+	int GetSizeZ() const { return mSizeZ; }
+	float GetPivotX() const { return mPivotX; }
+	float GetPivotY() const { return mPivotY; }
+	float GetPivotZ() const { return mPivotZ; }
+
+	const std::vector<VoxelVertex>& GetVertices() const { return mVertices; }
+	const std::vector<int32_t>& GetIndices() const { return mIndices; }
+
+private:
+	// Voxel flags. The face bits are the same as the visibility flags of KVX slabs.
+	enum
+	{
+		FaceLeft = 1,
+		FaceRight = 2,
+		FaceBack = 4,
+		FaceFront = 8,
+		FaceTop = 16,
+		FaceBottom = 32,
+		Solid = 64,
+		Drawn = 128 // The slab had visibility flags, sprite projections skip the others
+	};
+
+	int Offset(int x, int y, int z) const { return (z * mSizeY + y) * mSizeX + x; }
+	void AddQuad(std::unordered_map<uint64_t, int32_t>& lookup, const int* origin, const int* a, const int* b, int color);
+
+	int mSizeX = 0;
+	int mSizeY = 0;
+	int mSizeZ = 0;
+	float mPivotX = 0.0f;
+	float mPivotY = 0.0f;
+	float mPivotZ = 0.0f;
+	std::vector<uint8_t> mColors;
+	std::vector<uint8_t> mFlags;
+
+	std::vector<VoxelVertex> mVertices;
+	std::vector<int32_t> mIndices;
+};
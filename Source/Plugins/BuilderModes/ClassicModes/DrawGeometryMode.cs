@@ -340,7 +340,7 @@ namespace CodeImp.DoomBuilder.BuilderModes
 		}
 
 		// This returns the aligned and snapped draw position
-		public static DrawnVertex GetCurrentPosition(Vector2D mousemappos, bool snaptonearest, bool snaptogrid, bool snaptocardinal, bool usefourcardinaldirections, IRenderer2D renderer, List<DrawnVertex> points, BlockMap<BlockEntry> blockmap)
+		public static DrawnVertex GetCurrentPosition(Vector2D mousemappos, bool snaptonearest, bool snaptogrid, bool snaptocardinal, bool usefourcardinaldirections, IRenderer2D renderer, List<DrawnVertex> points, SpatialIndex blockmap)
 		{
 			DrawnVertex p = new DrawnVertex();
 			p.stitch = true; //mxd. Setting these to false seems to be a good way to create invalid geometry...
@@ -387,18 +387,10 @@ namespace CodeImp.DoomBuilder.BuilderModes
 					}
 				}
 
-				List<Vertex> vertices = new List<Vertex>();
-				Vertex nv = null;
-
-				// If we got a blockmap get the veritces that are in range only
-				if (blockmap != null)
-				{
-					HashSet<BlockEntry> blocks = blockmap.GetSquareRange(vm.x - vrange, vm.y - vrange, vrange * 2, vrange * 2);
-					foreach (BlockEntry be in blocks)
-						vertices.AddRange(be.Vertices);
-
-					nv = MapSet.NearestVertexSquareRange(vertices, vm, vrange);
-				}
+				// Use the blockmap when we got one
+				Vertex nv;
+				if(blockmap != null)
+					nv = blockmap.NearestVertexSquareRange(vm, vrange);
 				else
 					nv = General.Map.Map.NearestVertexSquareRange(vm, vrange);
 
@@ -423,7 +415,7 @@ namespace CodeImp.DoomBuilder.BuilderModes
 				}
 
 				// Try the nearest linedef. mxd. We'll need much bigger stitch distance when snapping to cardinal directions
-				Linedef nl = blockmap != null ? MapSet.NearestLinedefRange(blockmap, vm, BuilderPlug.Me.StitchRange / renderer.Scale) : General.Map.Map.NearestLinedefRange(vm, BuilderPlug.Me.StitchRange / renderer.Scale);
+				Linedef nl = blockmap != null ? blockmap.NearestLinedefRange(vm, BuilderPlug.Me.StitchRange / renderer.Scale) : General.Map.Map.NearestLinedefRange(vm, BuilderPlug.Me.StitchRange / renderer.Scale);
 				if(nl != null)
 				{
 					//mxd. Line angle must stay the same
@@ -65,8 +65,8 @@ namespace CodeImp.DoomBuilder.BuilderModes
 		// Interface
 		new private bool editpressed;
 
-		// The blockmap makes is used to make finding lines faster
-		BlockMap<BlockEntry> blockmap;
+		// The blockmap is used to make finding lines and vertices faster
+		SpatialIndex blockmap;
 
 		// Stores sizes of the text for text labels so that they only have to be computed once
 		private Dictionary<string, float> textlabelsizecache;
@@ -470,14 +470,14 @@ namespace CodeImp.DoomBuilder.BuilderModes
 		}
 
 		/// <summary>
-		/// Create a blockmap containing linedefs. This is used to speed up determining the closest line
-		/// to the mouse cursor
+		/// Fill the blockmap with the linedefs and vertices. This is used to speed up determining the closest line
+		/// to the mouse cursor and the vertex to snap to
 		/// </summary>
 		private void CreateBlockmap()
 		{
-			RectangleF area = MapSet.CreateArea(General.Map.Map.Vertices);
-			blockmap = new BlockMap<BlockEntry>(area);
-			blockmap.AddLinedefsSet(General.Map.Map.Linedefs);
+			if(blockmap == null) blockmap = new SpatialIndex();
+			blockmap.SetLinedefs(General.Map.Map.Linedefs);
+			blockmap.SetVertices(General.Map.Map.Vertices);
 		}
 
 		/// <summary>
@@ -646,6 +646,13 @@ namespace CodeImp.DoomBuilder.BuilderModes
 		{
 			base.OnDisengage();
 
+			// Free the blockmap
+			if(blockmap != null)
+			{
+				blockmap.Dispose();
+				blockmap = null;
+			}
+
 			// Remove toolbar buttons
 			General.Interface.BeginToolbarUpdate(); //mxd
 			General.Interface.RemoveButton(BuilderPlug.Me.MenusForm.CopyProperties);
@@ -959,7 +966,7 @@ namespace CodeImp.DoomBuilder.BuilderModes
 			else if(paintselectpressed && !editpressed && !selecting)  //mxd. Drag-select
 			{
 				// Find the nearest thing within highlight range
-				Linedef l = MapSet.NearestLinedefRange(blockmap, mousemappos, BuilderPlug.Me.HighlightRange / renderer.Scale);
+				Linedef l = blockmap.NearestLinedefRange(mousemappos, BuilderPlug.Me.HighlightRange / renderer.Scale);
 
 				if(l != null) 
 				{
@@ -991,10 +998,10 @@ namespace CodeImp.DoomBuilder.BuilderModes
 			else if(e.Button == MouseButtons.None) // Not holding any buttons?
 			{
 				// Find the nearest linedef within highlight range
-				Linedef l = MapSet.NearestLinedefRange(blockmap, mousemappos, BuilderPlug.Me.HighlightRange / renderer.Scale);
+				Linedef l = blockmap.NearestLinedefRange(mousemappos, BuilderPlug.Me.HighlightRange / renderer.Scale);
 
 				//mxd. Render insert vertex preview
-				Linedef sl = MapSet.NearestLinedefRange(blockmap, mousemappos, BuilderPlug.Me.StitchRange / renderer.Scale);
+				Linedef sl = blockmap.NearestLinedefRange(mousemappos, BuilderPlug.Me.StitchRange / renderer.Scale);
 				if (sl != null)
 				{
 					bool snaptogrid = General.Interface.ShiftState ^ General.Interface.SnapToGrid;
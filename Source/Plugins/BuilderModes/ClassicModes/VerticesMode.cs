@@ -56,8 +56,8 @@ namespace CodeImp.DoomBuilder.BuilderModes
 		// Interface
 		new private bool editpressed;
 
-		// The blockmap makes is used to make finding lines faster
-		BlockMap<BlockEntry> blockmap;
+		// The blockmap is used to make finding lines faster
+		SpatialIndex blockmap;
 
 		// Vertices that will be edited
 		ICollection<Vertex> editvertices;
@@ -82,14 +82,13 @@ namespace CodeImp.DoomBuilder.BuilderModes
 		#region ================== Methods
 
 		/// <summary>
-		/// Create a blockmap containing linedefs. This is used to speed up determining the closest line
+		/// Fill the blockmap with the linedefs. This is used to speed up determining the closest line
 		/// to the mouse cursor
 		/// </summary>
 		private void CreateBlockmap()
 		{
-			RectangleF area = MapSet.CreateArea(General.Map.Map.Vertices);
-			blockmap = new BlockMap<BlockEntry>(area);
-			blockmap.AddLinedefsSet(General.Map.Map.Linedefs);
+			if(blockmap == null) blockmap = new SpatialIndex();
+			blockmap.SetLinedefs(General.Map.Map.Linedefs);
 		}
 
 		public override void OnHelp()
@@ -140,6 +139,13 @@ namespace CodeImp.DoomBuilder.BuilderModes
 		{
 			base.OnDisengage();
 
+			// Free the blockmap
+			if(blockmap != null)
+			{
+				blockmap.Dispose();
+				blockmap = null;
+			}
+
 			// Remove toolbar buttons
 			General.Interface.BeginToolbarUpdate();
 			General.Interface.RemoveButton(BuilderPlug.Me.MenusForm.CopyProperties);
@@ -326,7 +332,7 @@ namespace CodeImp.DoomBuilder.BuilderModes
 			else if(!selecting) //mxd. We don't want to do this stuff while multiselecting
 			{
 				// Find the nearest linedef within highlight range
-				Linedef l = MapSet.NearestLinedefRange(blockmap, mousemappos, BuilderPlug.Me.SplitLinedefsRange / renderer.Scale);
+				Linedef l = blockmap.NearestLinedefRange(mousemappos, BuilderPlug.Me.SplitLinedefsRange / renderer.Scale);
 				if(l != null)
 				{
 					// Create undo
@@ -377,8 +383,9 @@ namespace CodeImp.DoomBuilder.BuilderModes
 					}
 					//BuilderPlug.Me.AdjustSplitCoordinates(l, sld);
 
-					// Create the blockmap
-					CreateBlockmap();
+					// Only the split linedef changed
+					blockmap.UpdateLinedef(l);
+					blockmap.UpdateLinedef(sld);
 
 					// Update
 					General.Map.Map.Update();
@@ -498,7 +505,7 @@ namespace CodeImp.DoomBuilder.BuilderModes
 			else if(e.Button == MouseButtons.None) // Not holding any buttons?
 			{
 				//mxd. Render insert vertex preview
-				Linedef l = MapSet.NearestLinedefRange(blockmap, mousemappos, BuilderPlug.Me.SplitLinedefsRange / renderer.Scale);
+				Linedef l = blockmap.NearestLinedefRange(mousemappos, BuilderPlug.Me.SplitLinedefsRange / renderer.Scale);
 
 				if(l != null) 
 				{
@@ -924,7 +931,7 @@ namespace CodeImp.DoomBuilder.BuilderModes
 				General.Map.UndoRedo.CreateUndo("Insert vertex");
 
 				// Snap to geometry?
-				Linedef l = MapSet.NearestLinedefRange(blockmap, mousemappos, BuilderPlug.Me.SplitLinedefsRange / renderer.Scale);
+				Linedef l = blockmap.NearestLinedefRange(mousemappos, BuilderPlug.Me.SplitLinedefsRange / renderer.Scale);
 				if(snaptonearest && (l != null))
 				{
 					// Snip to grid also?
@@ -985,7 +992,7 @@ namespace CodeImp.DoomBuilder.BuilderModes
 				if(snaptonearest)
 				{
 					//mxd. Check if snapped vertex is still on top of a linedef
-					l = MapSet.NearestLinedefRange(blockmap, v.Position, BuilderPlug.Me.SplitLinedefsRange / renderer.Scale);
+					l = blockmap.NearestLinedefRange(v.Position, BuilderPlug.Me.SplitLinedefsRange / renderer.Scale);
 					
 					if(l != null) 
 					{
@@ -1005,6 +1012,10 @@ namespace CodeImp.DoomBuilder.BuilderModes
 							return;
 						}
 						//BuilderPlug.Me.AdjustSplitCoordinates(l, sld);
+
+						// Only the split linedef changed
+						blockmap.UpdateLinedef(l);
+						blockmap.UpdateLinedef(sld);
 					}
 				}
 				else
@@ -1012,9 +1023,6 @@ namespace CodeImp.DoomBuilder.BuilderModes
 					General.Interface.DisplayStatus(StatusType.Action, "Inserted a vertex.");
 				}
 
-				// Create the blockmap
-				CreateBlockmap();
-
 				// Update
 				General.Map.Map.Update();
 
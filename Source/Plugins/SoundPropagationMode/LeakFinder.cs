@@ -21,200 +21,70 @@
 
 #endregion
 
-using System;
-using System.Collections.Concurrent;
 using System.Collections.Generic;
-using System.Linq;
-using System.Threading.Tasks;
+using System.Drawing;
 using CodeImp.DoomBuilder.Geometry;
 using CodeImp.DoomBuilder.Map;
+using CodeImp.DoomBuilder.Rendering;
 
 namespace CodeImp.DoomBuilder.SoundPropagationMode
 {
 	internal class LeakFinder
 	{
-		public SoundNode Start { get; }
-		public SoundNode End { get; }
-		public List<SoundNode> Nodes { get; }
-		public HashSet<Sector> Sectors { get; }
+		public Sector Source { get; }
+		public Vector2D SourcePosition { get; }
+		public Sector Destination { get; }
+		public Vector2D DestinationPosition { get; }
+		public List<Vector2D> Path { get; private set; }
 		public bool Finished { get; internal set; }
 
-		private ConcurrentDictionary<Linedef, SoundNode> linedefs2nodes;
-		private int numblockingnodes;
+		private SoundGraph graph;
 
-		public LeakFinder(Sector source, Vector2D sourceposition, Sector destination, Vector2D destinationposition, HashSet<Sector> sectors)
+		public LeakFinder(SoundGraph graph, Sector source, Vector2D sourceposition, Sector destination, Vector2D destinationposition)
 		{
-			if (!sectors.Contains(source) || !sectors.Contains(destination))
-				throw new ArgumentException("Sound propagation domain does not contain both the start and end sectors");
+			this.graph = graph;
 
-			End = new SoundNode(destinationposition);
-			Start = new SoundNode(sourceposition, End) { G = 0 };
-			Sectors = sectors;
+			Source = source;
+			SourcePosition = sourceposition;
+			Destination = destination;
+			DestinationPosition = destinationposition;
 
 			Finished = false;
-
-			Nodes = new List<SoundNode>() { Start, End };
-
-			linedefs2nodes = new ConcurrentDictionary<Linedef, SoundNode>();
-
-			GenerateNodes(sectors);
-
-			PopulateStartEndNeighbors(source, Start);
-			PopulateStartEndNeighbors(destination, End);
 		}
 
 		/// <summary>
-		/// Checks if the linedef is valid for passing sound.
+		/// Finds a sound leak between the start and end positions.
 		/// </summary>
-		/// <param name="linedef">The linedef to check</param>
-		/// <returns>true if sound can travel through the linedef, false if not</returns>
-		private bool CheckLinedefValidity(Linedef linedef)
+		/// <returns>true if a leak was found, false if no leak was found</returns>
+		public bool FindLeak()
 		{
-			if (linedef.Back == null)
-				return false;
-
-			if (linedef.Front.Sector == linedef.Back.Sector)
-				return false;
+			// The sound graph searches the shortest path through the middle of the linedefs. It keeps track of
+			// whether the path already went through a sound blocking line, so that it never passes a second one
+			Path = graph.FindLeak(Source, SourcePosition, Destination, DestinationPosition);
+			Finished = true;
 
-			if (SoundPropagationDomain.IsSoundBlockedByHeight(linedef))
-				return false;
-
-			return Sectors.Contains(linedef.Front.Sector) && Sectors.Contains(linedef.Back.Sector);
+			return Path != null;
 		}
 
 		/// <summary>
-		/// Generates all nodes for the A* search algorithm.
+		/// Renders the path of the sound leak from the start to the end position
 		/// </summary>
-		/// <param name="sectors">sectors to generate the nodes from</param>
-		private void GenerateNodes(HashSet<Sector> sectors)
+		/// <param name="renderer">The Renderer2D to render with</param>
+		internal void RenderPath(IRenderer2D renderer)
 		{
-			// Create sound nodes for all valid linedefs in all given sectors
-			foreach(Sector s in sectors)
-			{
-				IEnumerable<Sidedef> sidedefs = s.Sidedefs.Where(sd => CheckLinedefValidity(sd.Line));
-
-				foreach(Sidedef sd in sidedefs)
-				{
-					if(!linedefs2nodes.ContainsKey(sd.Line))
-					{
-						linedefs2nodes[sd.Line] = new SoundNode(sd.Line, End);
-						Nodes.Add(linedefs2nodes[sd.Line]);
-					}
-				}
-			}
-
-			// We need the number of blocking nodes for safety checking
-			numblockingnodes = linedefs2nodes.Values.Count(n => n.IsBlocking);
+			if (Path == null)
+				return;
 
-			// Set the neighbors for each node. The amount of interconnections can be very high in complex maps
-			// (for example there are nearly 3.9 million in Sunder map 20), so do it in parallel for speed
-			Parallel.ForEach(linedefs2nodes.Keys, ld =>
+			for (int i = 1; i < Path.Count; i++)
 			{
-				foreach (Sidedef sd in ld.Front.Sector.Sidedefs)
+				// Do not render the start and end positions
+				if (i < Path.Count - 1)
 				{
-					if (sd.Line != ld && CheckLinedefValidity(sd.Line))
-						linedefs2nodes[ld].Neighbors.Add(linedefs2nodes[sd.Line]);
-				}
-
-				foreach (Sidedef sd in ld.Back.Sector.Sidedefs)
-				{
-					if (sd.Line != ld && CheckLinedefValidity(sd.Line))
-						linedefs2nodes[ld].Neighbors.Add(linedefs2nodes[sd.Line]);
-				}
-			});
-
-#if DEBUG
-			int bla = linedefs2nodes.Values.Sum(n => n.Neighbors.Count);
-			Console.WriteLine($"There are {linedefs2nodes.Keys.Count} nodes with {bla} interconnections.");
-#endif
-		}
-
-		/// <summary>
-		/// Populates a sound node's neightbors to the linedefs of a sector. This is required for the start and end sound nodes.
-		/// </summary>
-		/// <param name="sector">The sector which linedef's sound nodes are used</param>
-		/// <param name="node">The sound node to add the neighbors to</param>
-		private void PopulateStartEndNeighbors(Sector sector, SoundNode node)
-		{
-			foreach(Sidedef sd in sector.Sidedefs)
-			{
-				if(CheckLinedefValidity(sd.Line) && linedefs2nodes.ContainsKey(sd.Line))
-				{
-					node.Neighbors.Add(linedefs2nodes[sd.Line]);
-					linedefs2nodes[sd.Line].Neighbors.Add(node);
-				}
-			}
-		}
-
-		/// <summary>
-		/// Finds a sound leak between the start and end sound nodes.
-		/// </summary>
-		/// <returns>true if a leak was found, false if no leak was found</returns>
-		public bool FindLeak()
-		{
-			Finished = false;
-
-			// Basic A* search. The twist is that sound blocking lines: we can only pass through one of them,
-			// and A* doesn't backtrack, so it can fail to find a path even if there is a possible one. If that
-			// happens we set the sound blocking node we traveled through to be ignored, and start again. We repeat
-			// that until a path was found, or all blocking nodes are set to be ignored (which shouldn't happen)
-			while (true)
-			{
-				List<SoundNode> openset = new List<SoundNode>() { Start };
-
-				while (openset.Count > 0)
-				{
-					// Find the node with the lowest F score. Doing it that way seems to be fastest
-					SoundNode current = openset[0];
-					for (int i = 1; i < openset.Count; i++)
-					{
-						if (openset[i].F < current.F)
-							current = openset[i];
-					}
-
-					// We're done if the node with the lowest F score is the end node
-					if (current == End)
-					{
-						Finished = true;
-						return true;
-					}
-
-					// Remove the current node from the open set
-					openset.Remove(current);
-
-					// Compute new values for the current node's neighbors
-					current.ProcessNeighbors(openset, Start);
-				}
-
-				// If we got here we didn't find a path. So we have to start over
-
-				int currentnumblockingnodes = 0;
-
-				// Reset all nodes
-				foreach(SoundNode sn in Nodes)
-				{
-					// Set the sound nodes that block sound and were visited (the G value was set to something) to be skipped.
-					if(sn.IsBlocking && sn.G != double.MaxValue)
-					{
-						sn.IsSkip = true;
-						currentnumblockingnodes++;
-					}
-
-					// We need to reset the sound node's G and F values
-					sn.Reset();
-				}
-
-				// All blocking sound nodes are being skipped, so no path is possible
-				if (currentnumblockingnodes == numblockingnodes)
-				{
-					Finished = true;
-
-					return false;
+					RectangleF rectangle = new RectangleF((float)(Path[i].x - 4 / renderer.Scale), (float)(Path[i].y - 4 / renderer.Scale), 8 / renderer.Scale, 8 / renderer.Scale);
+					renderer.RenderRectangleFilled(rectangle, PixelColor.FromColor(Color.Red), true);
 				}
 
-				// Don't forget the reset the start node to its special values
-				Start.G = 0.0;
-				Start.F = Start.H;
+				renderer.RenderLine(Path[i - 1], Path[i], 1.0f, PixelColor.FromColor(Color.Red), true);
 			}
 		}
 	}
@@ -0,0 +1,239 @@
+#region ================== Namespaces
+
+using System;
+using System.Collections.Generic;
+using System.Runtime.InteropServices;
+using System.Text;
+using CodeImp.DoomBuilder.Geometry;
+using CodeImp.DoomBuilder.Map;
+
+#endregion
+
+namespace CodeImp.DoomBuilder.SoundPropagationMode
+{
+	// The sectors and two-sided linedefs of the map as a graph in BuilderNative. It splits the map
+	// into sound propagation domains and finds sound leaks. Toggling the sound blocking flag of a
+	// linedef only updates the domains on both sides of it, everything else needs a new graph.
+	internal sealed unsafe class SoundGraph : IDisposable
+	{
+		#region ================== Structures
+
+		[StructLayout(LayoutKind.Sequential)]
+		struct SoundGraphSector
+		{
+			public int FloorHeight;
+			public int CeilHeight;
+		}
+
+		[StructLayout(LayoutKind.Sequential)]
+		struct SoundGraphLine
+		{
+			public int Front;
+			public int Back;
+			public int Flags;
+			public double X;
+			public double Y;
+		}
+
+		#endregion
+
+		#region ================== Constants
+
+		private const int FLAG_BLOCKSOUND = 1;
+
+		#endregion
+
+		#region ================== Variables
+
+		private IntPtr graph;
+		private readonly Sector[] sectors;
+		private readonly int[] sectordomains;
+
+		#endregion
+
+		#region ================== Properties
+
+		// Some domains can be empty, their ids are reused by later changes
+		public int DomainCount { get { return SoundGraph_GetDomainCount(graph); } }
+
+		#endregion
+
+		#region ================== Constructor / Disposer
+
+		// Constructor
+		public SoundGraph(MapSet map)
+		{
+			sectors = new Sector[map.Sectors.Count];
+			SoundGraphSector[] sectordata = new SoundGraphSector[sectors.Length];
+			foreach(Sector s in map.Sectors)
+			{
+				sectors[s.Index] = s;
+				sectordata[s.Index].FloorHeight = s.FloorHeight;
+				sectordata[s.Index].CeilHeight = s.CeilHeight;
+			}
+
+			SoundGraphLine[] linedata = new SoundGraphLine[map.Linedefs.Count];
+			foreach(Linedef ld in map.Linedefs)
+			{
+				Vector2D center = ld.Line.GetCoordinatesAt(0.5);
+				linedata[ld.Index].Front = (ld.Front != null ? ld.Front.Sector.Index : -1);
+				linedata[ld.Index].Back = (ld.Back != null ? ld.Back.Sector.Index : -1);
+				linedata[ld.Index].Flags = GetFlags(ld);
+				linedata[ld.Index].X = center.x;
+				linedata[ld.Index].Y = center.y;
+			}
+
+			sectordomains = new int[sectors.Length];
+			graph = SoundGraph_New();
+
+			fixed(SoundGraphSector* sectorsptr = sectordata)
+			fixed(SoundGraphLine* linesptr = linedata)
+			{
+				if(!SoundGraph_SetMap(graph, sectorsptr, sectordata.Length, linesptr, linedata.Length))
+				{
+					Dispose();
+					ThrowNativeError();
+				}
+			}
+
+			UpdateSectorDomains();
+		}
+
+		// Destructor
+		~SoundGraph()
+		{
+			Dispose();
+		}
+
+		// Disposer
+		public void Dispose()
+		{
+			if(graph != IntPtr.Zero)
+			{
+				SoundGraph_Delete(graph);
+				graph = IntPtr.Zero;
+				GC.SuppressFinalize(this);
+			}
+		}
+
+		#endregion
+
+		#region ================== Methods
+
+		// This returns the domain of a sector
+		public int GetDomain(Sector s)
+		{
+			return sectordomains[s.Index];
+		}
+
+		// This returns the sectors of a domain
+		public List<Sector> GetDomainSectors(int domain)
+		{
+			int* ids;
+			int count;
+			if(!SoundGraph_GetDomainSectors(graph, domain, out ids, out count)) ThrowNativeError();
+
+			List<Sector> result = new List<Sector>(count);
+			for(int i = 0; i < count; i++) result.Add(sectors[ids[i]]);
+			return result;
+		}
+
+		// This returns the domains sound reaches from the given domain by passing one sound blocking linedef
+		public List<int> GetAdjacentDomains(int domain)
+		{
+			int* ids;
+			int count;
+			if(!SoundGraph_GetAdjacentDomains(graph, domain, out ids, out count)) ThrowNativeError();
+
+			List<int> result = new List<int>(count);
+			for(int i = 0; i < count; i++) result.Add(ids[i]);
+			return result;
+		}
+
+		// This updates the graph after the sound blocking flag of the linedef changed.
+		// Returns the domains that have different sectors now.
+		public List<int> UpdateLinedef(Linedef ld)
+		{
+			int* changed = stackalloc int[2];
+			int count;
+			if(!SoundGraph_SetLineFlags(graph, ld.Index, GetFlags(ld), changed, out count)) ThrowNativeError();
+
+			List<int> result = new List<int>(count);
+			for(int i = 0; i < count; i++) result.Add(changed[i]);
+			if(count > 0) UpdateSectorDomains();
+			return result;
+		}
+
+		// This finds the shortest path sound takes from the start to the end position, passing through
+		// the middle of the linedefs. Returns null when sound can not travel between them.
+		public List<Vector2D> FindLeak(Sector startsector, Vector2D startposition, Sector endsector, Vector2D endposition)
+		{
+			Vector2D* points;
+			int count;
+			if(!SoundGraph_FindLeak(graph, startsector.Index, startposition.x, startposition.y, endsector.Index, endposition.x, endposition.y, out points, out count))
+				ThrowNativeError();
+
+			if(count == 0) return null;
+
+			List<Vector2D> path = new List<Vector2D>(count);
+			for(int i = 0; i < count; i++) path.Add(points[i]);
+			return path;
+		}
+
+		private void UpdateSectorDomains()
+		{
+			fixed(int* domainsptr = sectordomains)
+			{
+				if(!SoundGraph_GetSectorDomains(graph, domainsptr, sectordomains.Length)) ThrowNativeError();
+			}
+		}
+
+		private static int GetFlags(Linedef ld)
+		{
+			return (ld.IsFlagSet(SoundPropagationMode.BlockSoundFlag) ? FLAG_BLOCKSOUND : 0);
+		}
+
+		private static void ThrowNativeError()
+		{
+			StringBuilder sb = new StringBuilder(4096);
+			BuilderNative_GetError(sb, sb.Capacity);
+			throw new Exception(sb.ToString());
+		}
+
+		#endregion
+
+		#region ================== Native
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern IntPtr SoundGraph_New();
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern void SoundGraph_Delete(IntPtr graph);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern bool SoundGraph_SetMap(IntPtr graph, SoundGraphSector* sectors, int sectorcount, SoundGraphLine* lines, int linecount);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern bool SoundGraph_SetLineFlags(IntPtr graph, int line, int flags, int* changed, out int changedcount);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern int SoundGraph_GetDomainCount(IntPtr graph);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern bool SoundGraph_GetSectorDomains(IntPtr graph, int* domains, int count);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern bool SoundGraph_GetDomainSectors(IntPtr graph, int domain, out int* sectors, out int count);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern bool SoundGraph_GetAdjacentDomains(IntPtr graph, int domain, out int* domains, out int count);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		static extern bool SoundGraph_FindLeak(IntPtr graph, int startsector, double startx, double starty, int endsector, double endx, double endy, out Vector2D* path, out int count);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+		static extern void BuilderNative_GetError(StringBuilder str, int length);
+
+		#endregion
+	}
+}
@@ -19,7 +19,6 @@
 
 using System;
 using System.Collections.Generic;
-using System.ComponentModel;
 using System.Drawing;
 using System.Threading.Tasks;
 using System.Windows.Forms;
@@ -55,8 +54,10 @@ namespace CodeImp.DoomBuilder.SoundPropagationMode
 		private FlatVertex[] overlayGeometry;
 
 		private List<Thing> huntingThings;
-		private List<SoundPropagationDomain> propagationdomains;
-		private Dictionary<Sector, SoundPropagationDomain> sector2domain;
+		private SoundGraph soundgraph;
+		private List<SoundPropagationDomain> propagationdomains; // By domain id, null for domains without sectors
+		private SoundPropagationDomain highlighteddomain;
+		private List<SoundPropagationDomain> adjacentdomains;
 		private LeakFinder leakfinder;
 		private PixelColor doublesidedcolor;
 
@@ -69,7 +70,6 @@ namespace CodeImp.DoomBuilder.SoundPropagationMode
 		private Vector2D leakendposition;
 		private TextLabel leakstartlabel;
 		private TextLabel leakendlabel;
-		private BackgroundWorker worker;
 
 		#endregion
 
@@ -122,15 +122,6 @@ namespace CodeImp.DoomBuilder.SoundPropagationMode
 		//mxd
 		private void ResetSoundPropagation()
 		{
-			sector2domain.Clear();
-			propagationdomains.Clear();
-			BuilderPlug.Me.BlockingLinedefs.Clear();
-			UpdateSoundPropagation();
-		}
-
-		private void UpdateSoundPropagation()
-		{
-			huntingThings.Clear();
 			BuilderPlug.Me.BlockingLinedefs.Clear();
 
 			foreach(Linedef ld in General.Map.Map.Linedefs)
@@ -139,31 +130,64 @@ namespace CodeImp.DoomBuilder.SoundPropagationMode
 			}
 
 			//mxd. Create sound propagation for the whole map
-			int counter = 0;
-			foreach(Sector sector in General.Map.Map.Sectors)
+			if(soundgraph != null) soundgraph.Dispose();
+			soundgraph = new SoundGraph(General.Map.Map);
+
+			propagationdomains.Clear();
+			for(int i = 0; i < soundgraph.DomainCount; i++)
+				propagationdomains.Add(CreateDomain(i));
+
+			UpdateSoundPropagation();
+		}
+
+		// Updates the sound propagation after the sound blocking flag of a linedef was toggled.
+		// Only the domains on both sides of the linedef can change, so the others are kept.
+		private void UpdateSoundPropagation(Linedef ld)
+		{
+			if(ld.IsFlagSet(BlockSoundFlag))
+				BuilderPlug.Me.BlockingLinedefs.Add(ld);
+			else
+				BuilderPlug.Me.BlockingLinedefs.Remove(ld);
+
+			foreach(int id in soundgraph.UpdateLinedef(ld))
 			{
-				if(!sector2domain.ContainsKey(sector))
-				{
-					SoundPropagationDomain spd = new SoundPropagationDomain(sector);
-					foreach(Sector s in spd.Sectors) sector2domain[s] = spd;
-					spd.Color = BuilderPlug.Me.DistinctColors[counter++ % BuilderPlug.Me.DistinctColors.Count].WithAlpha(255).ToInt();
-					propagationdomains.Add(spd);
-				}
+				while(propagationdomains.Count <= id) propagationdomains.Add(null);
+				propagationdomains[id] = CreateDomain(id);
 			}
 
+			UpdateSoundPropagation();
+		}
+
+		private SoundPropagationDomain CreateDomain(int id)
+		{
+			SoundPropagationDomain spd = new SoundPropagationDomain(soundgraph, id);
+			if(spd.Sectors.Count == 0) return null;
+
+			spd.Color = BuilderPlug.Me.DistinctColors[id % BuilderPlug.Me.DistinctColors.Count].WithAlpha(255).ToInt();
+			return spd;
+		}
+
+		private void UpdateSoundPropagation()
+		{
+			huntingThings.Clear();
+			highlighteddomain = null;
+			adjacentdomains.Clear();
+
 			if(highlighted == null || highlighted.IsDisposed) return;
 
 			//mxd. Create the list of sectors, which will be affected by noise made in highlighted sector
-			SoundPropagationDomain curdomain = sector2domain[highlighted];
-			Dictionary<int, Sector> noisysectors = new Dictionary<int, Sector>(curdomain.Sectors.Count);
-			foreach(Sector s in curdomain.Sectors)
+			highlighteddomain = propagationdomains[soundgraph.GetDomain(highlighted)];
+			foreach(int id in soundgraph.GetAdjacentDomains(highlighteddomain.Id))
+				adjacentdomains.Add(propagationdomains[id]);
+
+			Dictionary<int, Sector> noisysectors = new Dictionary<int, Sector>(highlighteddomain.Sectors.Count);
+			foreach(Sector s in highlighteddomain.Sectors)
 			{
 				noisysectors.Add(s.Index, s);
 			}
 
-			foreach(Sector s in curdomain.AdjacentSectors)
+			foreach(SoundPropagationDomain aspd in adjacentdomains)
 			{
-				SoundPropagationDomain aspd = sector2domain[s];
 				foreach(Sector adjs in aspd.Sectors)
 				{
 					if(!noisysectors.ContainsKey(adjs.Index)) noisysectors.Add(adjs.Index, adjs);
@@ -218,7 +242,7 @@ namespace CodeImp.DoomBuilder.SoundPropagationMode
 
 			huntingThings = new List<Thing>();
 			propagationdomains = new List<SoundPropagationDomain>();
-			sector2domain = new Dictionary<Sector, SoundPropagationDomain>();
+			adjacentdomains = new List<SoundPropagationDomain>();
 			BuilderPlug.Me.BlockingLinedefs = new List<Linedef>();
 
 			doublesidedcolor = General.Colors.Linedefs.WithAlpha(General.Settings.DoubleSidedAlphaByte);
@@ -265,7 +289,7 @@ namespace CodeImp.DoomBuilder.SoundPropagationMode
 			// Convert geometry selection to sectors only
 			General.Map.Map.ConvertSelection(SelectionType.Sectors);
 
-			UpdateSoundPropagation();
+			ResetSoundPropagation();
 		}
 
 		// Mode disengages
@@ -277,17 +301,16 @@ namespace CodeImp.DoomBuilder.SoundPropagationMode
 			// Hide highlight info
 			General.Interface.HideInfo();
 
-			if (worker != null)
+			if (soundgraph != null)
 			{
-				worker.CancelAsync();
-				worker.Dispose();
+				soundgraph.Dispose();
+				soundgraph = null;
 			}
 		}
 
 		// This redraws the display
 		public override void OnRedrawDisplay()
 		{
-			List<SoundPropagationDomain> renderedspds = new List<SoundPropagationDomain>();
 			if (BuilderPlug.Me.DataIsDirty) UpdateData();
 
 			// We don't care for the actualy surfaces, but without this the render targets will not be recreated
@@ -344,22 +367,13 @@ namespace CodeImp.DoomBuilder.SoundPropagationMode
 			if (renderer.StartOverlay(true))
 			{
 				// Render highlighted domain and domains adjacent to it
-				if (highlighted != null && !highlighted.IsDisposed)
+				if (highlighteddomain != null)
 				{
 					renderer.RenderGeometry(overlayGeometry, null, true); //mxd
+					renderer.RenderGeometry(highlighteddomain.Level1Geometry, null, true);
 
-					SoundPropagationDomain spd = sector2domain[highlighted];
-					renderer.RenderGeometry(spd.Level1Geometry, null, true);
-
-					foreach (Sector s in spd.AdjacentSectors)
-					{
-						SoundPropagationDomain aspd = sector2domain[s];
-						if (!renderedspds.Contains(aspd))
-						{
-							renderer.RenderGeometry(aspd.Level2Geometry, null, true);
-							renderedspds.Add(aspd);
-						}
-					}
+					foreach (SoundPropagationDomain aspd in adjacentdomains)
+						renderer.RenderGeometry(aspd.Level2Geometry, null, true);
 
 					renderer.RenderHighlight(highlighted.FlatVertices, BuilderPlug.Me.HighlightColor.WithAlpha(128).ToInt()); //mxd
 				}
@@ -367,7 +381,10 @@ namespace CodeImp.DoomBuilder.SoundPropagationMode
 				{
 					//mxd. Render all domains using domain colors
 					foreach (SoundPropagationDomain spd in propagationdomains)
-						renderer.RenderHighlight(spd.Level1Geometry, spd.Color);
+					{
+						if (spd != null)
+							renderer.RenderHighlight(spd.Level1Geometry, spd.Color);
+					}
 				}
 
 				renderer.Finish();
@@ -377,7 +394,7 @@ namespace CodeImp.DoomBuilder.SoundPropagationMode
 			if (renderer.StartOverlay(true, 1))
 			{
 				if (leakfinder != null && leakfinder.Finished)
-					leakfinder.End.RenderPath(renderer);
+					leakfinder.RenderPath(renderer);
 
 				if (leakstartsector != null)
 					renderer.RenderText(leakstartlabel);
@@ -403,27 +420,13 @@ namespace CodeImp.DoomBuilder.SoundPropagationMode
 			highlightedline.SetFlag(BlockSoundFlag, !highlightedline.IsFlagSet(BlockSoundFlag));
 			
 			// Update
-			ResetSoundPropagation();
+			UpdateSoundPropagation(highlightedline);
 
 			FindSoundLeak();
 
 			General.Interface.RedrawDisplay();
 		}
 
-		public override bool OnUndoBegin()
-		{
-			base.OnUndoBegin();
-
-			if (worker != null)
-			{
-				worker.CancelAsync();
-				worker.Dispose();
-				worker = null;
-			}
-
-			return true;
-		}
-
 		//mxd
 		public override void OnUndoEnd()
 		{
@@ -443,20 +446,6 @@ namespace CodeImp.DoomBuilder.SoundPropagationMode
 			General.Interface.RedrawDisplay();
 		}
 
-		public override bool OnRedoBegin()
-		{
-			base.OnRedoBegin();
-
-			if (worker != null)
-			{
-				worker.CancelAsync();
-				worker.Dispose();
-				worker = null;
-			}
-
-			return true;
-		}
-
 		//mxd
 		public override void OnRedoEnd()
 		{
@@ -574,14 +563,14 @@ namespace CodeImp.DoomBuilder.SoundPropagationMode
 		}
 
 		/// <summary>
-		/// Starts finding a sound leak. Finding the actual leak is done by a background worker that's started from this method
+		/// Finds a sound leak between the leak start and end positions
 		/// </summary>
 		private void FindSoundLeak()
 		{
 			leakfinder = null;
 
 			// Do not show an error if either start or end is not set, since that'll happen when you start out
-			if (leakstartsector == null || leakendsector == null)
+			if (leakstartsector == null || leakendsector == null || leakstartsector.IsDisposed || leakendsector.IsDisposed)
 				return;
 
 			if (leakendsector == leakstartsector)
@@ -590,59 +579,25 @@ namespace CodeImp.DoomBuilder.SoundPropagationMode
 				return;
 			}
 
-			HashSet<Sector> sectors = new HashSet<Sector>(sector2domain[leakstartsector].Sectors);
-
-			// Mash all sectors from the leak start sector's domain and the adjacent domains into one hash set
-			foreach (Sector s in sector2domain[leakstartsector].AdjacentSectors)
-				sectors.UnionWith(sector2domain[s].Sectors);
+			int startdomain = soundgraph.GetDomain(leakstartsector);
+			int enddomain = soundgraph.GetDomain(leakendsector);
 
-			// If the leak end sector isn't in the list of sectors there's no way sound can travel between the start and end
-			if (!sectors.Contains(leakendsector))
+			// If the leak end sector isn't in the leak start sector's domain or the domains adjacent to it there's no way sound can travel between the start and end
+			if (startdomain != enddomain && !soundgraph.GetAdjacentDomains(startdomain).Contains(enddomain))
 			{
 				General.ToastManager.ShowToast(ToastMessages.SOUNDPROPAGATIONMODE, ToastType.WARNING, "Sound propagation", "Sound can not travel between the selected start and end positions");
 				return;
 			}
 
-			if (worker != null)
-			{
-				worker.CancelAsync();
-				worker.Dispose();
-			}
-
-			General.Interface.DisplayStatus(StatusType.Busy, "Searching for sound leak...");
-
-			worker = new BackgroundWorker();
-			worker.WorkerSupportsCancellation = true;
-			worker.DoWork += FindSoundLeakStart;
-			worker.RunWorkerCompleted += FindSoundLeakFinished;
-			worker.RunWorkerAsync(sectors);
-		}
-
-		/// <summary>
-		/// Method for the background worker that finds a sound leak.
-		/// </summary>
-		/// <param name="sender">The sender</param>
-		/// <param name="e">The event arguments</param>
-		private void FindSoundLeakStart(object sender, DoWorkEventArgs e)
-		{
 			Stopwatch sw = Stopwatch.StartNew();
 
-			leakfinder = new LeakFinder(leakstartsector, leakstartposition, leakendsector, leakendposition, (HashSet<Sector>)e.Argument);
+			leakfinder = new LeakFinder(soundgraph, leakstartsector, leakstartposition, leakendsector, leakendposition);
 
 			if (leakfinder.FindLeak() == false)
 				General.ToastManager.ShowToast(ToastMessages.SOUNDPROPAGATIONMODE, ToastType.WARNING, "Sound propagation", "Could not find a leak between the selected start and end positions, even though there should be one. This is weird");
 			else
 				General.Interface.DisplayStatus(StatusType.Info, string.Format(@"Searching for sound leak finished. Elapsed time: {0:mm\:ss\.ff}", sw.Elapsed));
-		}
 
-
-		/// <summary>
-		/// Method that's called when finding a sound leak finished.
-		/// </summary>
-		/// <param name="sender">The sender</param>
-		/// <param name="e">The event arguments</param>
-		private void FindSoundLeakFinished(object sender, RunWorkerCompletedEventArgs e)
-		{
 			General.Interface.RedrawDisplay();
 		}
 
@@ -45,11 +45,18 @@ namespace CodeImp.DoomBuilder.Plugins.VisplaneExplorer
 			this.separator = new System.Windows.Forms.ToolStripSeparator();
 			this.cbopendoors = new CodeImp.DoomBuilder.Controls.ToolStripCheckBox();
 			this.cbheatmap = new CodeImp.DoomBuilder.Controls.ToolStripCheckBox();
+			this.cbstopatlimits = new CodeImp.DoomBuilder.Controls.ToolStripCheckBox();
 			this.heightbutton = new System.Windows.Forms.ToolStripDropDownButton();
 			this.heightitems = new System.Windows.Forms.ToolStripMenuItem[General.Map.Config.VisplaneViewHeights.Count];
 			this.heightcustomitem = new System.Windows.Forms.ToolStripMenuItem();
 			this.heightcustomadd = new System.Windows.Forms.ToolStripMenuItem();
 			this.customheightdialog = new Windows.SetCustomHeightDialog();
+			this.limitsbutton = new System.Windows.Forms.ToolStripDropDownButton();
+			this.limitsdefault = new System.Windows.Forms.ToolStripMenuItem();
+			this.limitsvanilla = new System.Windows.Forms.ToolStripMenuItem();
+			this.limitsdoomplus = new System.Windows.Forms.ToolStripMenuItem();
+			this.limitschocolate = new System.Windows.Forms.ToolStripMenuItem();
+			this.limitswidescreen = new System.Windows.Forms.ToolStripMenuItem();
 			this.tooltip = new System.Windows.Forms.ToolTip(this.components);
 			this.toolstrip.SuspendLayout();
 			this.SuspendLayout();
@@ -61,7 +68,9 @@ namespace CodeImp.DoomBuilder.Plugins.VisplaneExplorer
 				this.separator,
 				this.cbopendoors,
 				this.cbheatmap,
-				this.heightbutton
+				this.cbstopatlimits,
+				this.heightbutton,
+				this.limitsbutton
 			});
 			this.toolstrip.Location = new System.Drawing.Point(0, 0);
 			this.toolstrip.Name = "toolstrip";
@@ -142,6 +151,15 @@ namespace CodeImp.DoomBuilder.Plugins.VisplaneExplorer
 			this.cbheatmap.Size = new System.Drawing.Size(88, 22);
 			this.cbheatmap.Text = "Heat Colors";
 			this.cbheatmap.Click += new System.EventHandler(this.cbheatmap_Click);
+			// 
+			// cbstopatlimits
+			// 
+			this.cbstopatlimits.Checked = false;
+			this.cbstopatlimits.Name = "cbstopatlimits";
+			this.cbstopatlimits.Size = new System.Drawing.Size(104, 22);
+			this.cbstopatlimits.Text = "Stop At Limits";
+			this.cbstopatlimits.ToolTipText = "Stop testing a spot once it goes over a static limit.\nFaster, but counts past the limits are shown as overflows";
+			this.cbstopatlimits.Click += new System.EventHandler(this.cbstopatlimits_Click);
 			//
 			// heightbutton
 			//
@@ -192,6 +210,61 @@ namespace CodeImp.DoomBuilder.Plugins.VisplaneExplorer
 			this.heightcustomadd.Text = "Set custom height";
 			this.heightcustomadd.Click += new System.EventHandler(this.heightcustomadd_Click);
 			this.heightbutton.DropDownItems.Add(this.heightcustomadd);
+			//
+			// limitsbutton
+			//
+			this.limitsbutton.DisplayStyle = System.Windows.Forms.ToolStripItemDisplayStyle.Text;
+			this.limitsbutton.DropDownItems.AddRange(new System.Windows.Forms.ToolStripItem[] {
+				this.limitsdefault,
+				this.limitsvanilla,
+				this.limitsdoomplus,
+				this.limitschocolate,
+				this.limitswidescreen
+			});
+			this.limitsbutton.Text = "Limits";
+			this.limitsbutton.Name = "limitsbutton";
+			this.limitsbutton.Size = new System.Drawing.Size(125, 22);
+			this.limitsbutton.ToolTipText = "Engine limits and screen size to calculate stats with";
+			//
+			// limitsdefault
+			//
+			this.limitsdefault.Name = "limitsdefault";
+			this.limitsdefault.Size = new System.Drawing.Size(160, 22);
+			this.limitsdefault.Tag = "0";
+			this.limitsdefault.Text = "Raised";
+			this.limitsdefault.Click += new System.EventHandler(this.limits_Click);
+			//
+			// limitsvanilla
+			//
+			this.limitsvanilla.Name = "limitsvanilla";
+			this.limitsvanilla.Size = new System.Drawing.Size(160, 22);
+			this.limitsvanilla.Tag = "1";
+			this.limitsvanilla.Text = "Vanilla";
+			this.limitsvanilla.Click += new System.EventHandler(this.limits_Click);
+			//
+			// limitsdoomplus
+			//
+			this.limitsdoomplus.Name = "limitsdoomplus";
+			this.limitsdoomplus.Size = new System.Drawing.Size(160, 22);
+			this.limitsdoomplus.Tag = "2";
+			this.limitsdoomplus.Text = "Doom-plus";
+			this.limitsdoomplus.Click += new System.EventHandler(this.limits_Click);
+			//
+			// limitschocolate
+			//
+			this.limitschocolate.Name = "limitschocolate";
+			this.limitschocolate.Size = new System.Drawing.Size(160, 22);
+			this.limitschocolate.Tag = "3";
+			this.limitschocolate.Text = "Chocolate Doom";
+			this.limitschocolate.Click += new System.EventHandler(this.limits_Click);
+			//
+			// limitswidescreen
+			//
+			this.limitswidescreen.Name = "limitswidescreen";
+			this.limitswidescreen.Size = new System.Drawing.Size(160, 22);
+			this.limitswidescreen.Tag = "4";
+			this.limitswidescreen.Text = "Widescreen";
+			this.limitswidescreen.Click += new System.EventHandler(this.limits_Click);
 			// 
 			// tooltip
 			// 
@@ -233,11 +306,18 @@ namespace CodeImp.DoomBuilder.Plugins.VisplaneExplorer
 		private System.Windows.Forms.ToolTip tooltip;
 		private CodeImp.DoomBuilder.Controls.ToolStripCheckBox cbopendoors;
 		private CodeImp.DoomBuilder.Controls.ToolStripCheckBox cbheatmap;
+		private CodeImp.DoomBuilder.Controls.ToolStripCheckBox cbstopatlimits;
 		private System.Windows.Forms.ToolStripDropDownButton heightbutton;
 		private System.Windows.Forms.ToolStripMenuItem[] heightitems;
 		private System.Windows.Forms.ToolStripMenuItem heightcustomitem;
 		private System.Windows.Forms.ToolStripMenuItem heightcustomadd;
 		private Windows.SetCustomHeightDialog customheightdialog;
+		private System.Windows.Forms.ToolStripDropDownButton limitsbutton;
+		private System.Windows.Forms.ToolStripMenuItem limitsdefault;
+		private System.Windows.Forms.ToolStripMenuItem limitsvanilla;
+		private System.Windows.Forms.ToolStripMenuItem limitsdoomplus;
+		private System.Windows.Forms.ToolStripMenuItem limitschocolate;
+		private System.Windows.Forms.ToolStripMenuItem limitswidescreen;
 		private System.Windows.Forms.ToolStripSeparator separator;
 
 	}
@@ -25,6 +25,7 @@ namespace CodeImp.DoomBuilder.Plugins.VisplaneExplorer
 		#region ================== Variables
 
 		private ViewStats viewstats;
+		private LimitProfile limitprofile;
 		private Point oldttposition;
 		private int viewheight;
 		private int viewheightcustom;
@@ -37,6 +38,8 @@ namespace CodeImp.DoomBuilder.Plugins.VisplaneExplorer
 		internal ViewStats ViewStats { get { return viewstats; } }
 		internal bool OpenDoors { get { return cbopendoors.Checked; } } //mxd
 		internal bool ShowHeatmap { get { return cbheatmap.Checked; } } //mxd
+		internal bool StopAtLimits { get { return cbstopatlimits.Checked; } }
+		internal LimitProfile LimitProfile { get { return limitprofile; } }
 		internal int ViewHeight { get { return viewheight; } }
 		internal int ViewHeightDefault { get { return viewheightdefault; } }
 
@@ -51,10 +54,14 @@ namespace CodeImp.DoomBuilder.Plugins.VisplaneExplorer
 			InitializeComponent();
 			cbopendoors.Checked = General.Settings.ReadPluginSetting("opendoors", false); //mxd
 			cbheatmap.Checked = General.Settings.ReadPluginSetting("showheatmap", false); //mxd
+			cbstopatlimits.Checked = General.Settings.ReadPluginSetting("stopatlimits", false);
 			viewheight = General.Settings.ReadPluginSetting("viewheight", viewheightdefault);
 			viewheightcustom = General.Settings.ReadPluginSetting("viewheightcustom", 0);
+			limitprofile = (LimitProfile)General.Settings.ReadPluginSetting("limitprofile", (int)LimitProfile.Default);
+			if(!Enum.IsDefined(typeof(LimitProfile), limitprofile)) limitprofile = LimitProfile.Default;
 
 			RedrawViewHeightMenuItems();
+			RedrawLimitsMenuItems();
 		}
 
 		#endregion
@@ -69,7 +76,9 @@ namespace CodeImp.DoomBuilder.Plugins.VisplaneExplorer
 			General.Interface.AddButton(separator); //mxd
 			General.Interface.AddButton(cbopendoors); //mxd
 			General.Interface.AddButton(cbheatmap); //mxd
+			General.Interface.AddButton(cbstopatlimits);
 			General.Interface.AddButton(heightbutton);
+			General.Interface.AddButton(limitsbutton);
 			General.Interface.EndToolbarUpdate(); //mxd
 		}
 
@@ -77,7 +86,9 @@ namespace CodeImp.DoomBuilder.Plugins.VisplaneExplorer
 		public void RemoveFromInterface()
 		{
 			General.Interface.BeginToolbarUpdate(); //mxd
+			General.Interface.RemoveButton(limitsbutton);
 			General.Interface.RemoveButton(heightbutton);
+			General.Interface.RemoveButton(cbstopatlimits);
 			General.Interface.RemoveButton(cbheatmap); //mxd
 			General.Interface.RemoveButton(cbopendoors); //mxd
 			General.Interface.RemoveButton(separator); //mxd
@@ -87,8 +98,10 @@ namespace CodeImp.DoomBuilder.Plugins.VisplaneExplorer
 			//mxd. Save settings
 			General.Settings.WritePluginSetting("opendoors", cbopendoors.Checked);
 			General.Settings.WritePluginSetting("showheatmap", cbheatmap.Checked);
+			General.Settings.WritePluginSetting("stopatlimits", cbstopatlimits.Checked);
 			General.Settings.WritePluginSetting("viewheight", viewheight);
 			General.Settings.WritePluginSetting("viewheightcustom", viewheightcustom);
+			General.Settings.WritePluginSetting("limitprofile", (int)limitprofile);
 		}
 
 		// This shows a tooltip
@@ -141,6 +154,11 @@ namespace CodeImp.DoomBuilder.Plugins.VisplaneExplorer
 			if(OnVisplaneSettingsChanged != null) OnVisplaneSettingsChanged(this, EventArgs.Empty);
 		}
 
+		private void cbstopatlimits_Click(object sender, EventArgs e)
+		{
+			if(OnVisplaneSettingsChanged != null) OnVisplaneSettingsChanged(this, EventArgs.Empty);
+		}
+
 		// Select the height above the floor the Visplane Explorer renderer draws from.
 		private void viewheight_Click(object sender, EventArgs e)
 		{
@@ -184,6 +202,26 @@ namespace CodeImp.DoomBuilder.Plugins.VisplaneExplorer
 			}
 		}
 
+		// Select the engine limits the spots are tested against
+		private void limits_Click(object sender, EventArgs e)
+		{
+			ToolStripMenuItem item = (ToolStripMenuItem)sender;
+			limitprofile = (LimitProfile)int.Parse(item.Tag.ToString(), CultureInfo.InvariantCulture);
+
+			RedrawLimitsMenuItems();
+
+			if(OnVisplaneSettingsChanged != null) OnVisplaneSettingsChanged(this, EventArgs.Empty);
+		}
+
+		private void RedrawLimitsMenuItems()
+		{
+			foreach(ToolStripMenuItem item in limitsbutton.DropDownItems)
+			{
+				item.Checked = (int)limitprofile == int.Parse((string)item.Tag, CultureInfo.InvariantCulture);
+				if(item.Checked) limitsbutton.Text = "Limits (" + item.Text + ")";
+			}
+		}
+
 		private void RedrawViewHeightButtonText()
 		{
 			heightbutton.Text = "View Height (" + viewheight.ToString() + ")";
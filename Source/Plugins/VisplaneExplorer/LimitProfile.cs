@@ -0,0 +1,16 @@
+#region === Copyright (c) 2010 Pascal van der Heiden ===
+
+#endregion
+
+namespace CodeImp.DoomBuilder.Plugins.VisplaneExplorer
+{
+	// Engine limits and screen size the spots are tested against (the VPO_LIMITS_XXX values)
+	internal enum LimitProfile : int
+	{
+		Default = 0,
+		Vanilla = 1,
+		DoomPlus = 2,
+		Chocolate = 3,
+		Widescreen = 4,
+	}
+}
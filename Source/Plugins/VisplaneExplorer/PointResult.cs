@@ -10,5 +10,6 @@ namespace CodeImp.DoomBuilder.Plugins.VisplaneExplorer
 		BadZ = -1,
 		Void = -2,
 		Overflow = -3,
+		OverThreshold = -4,
 	}
 }
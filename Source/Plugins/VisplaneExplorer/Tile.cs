@@ -62,6 +62,8 @@ namespace CodeImp.DoomBuilder.Plugins.VisplaneExplorer
 					t = POINT_VOID;
 					break;
 
+				// The render stopped at a static limit, so the counts are incomplete
+				case PointResult.OverThreshold:
 				case PointResult.Overflow:
 				default:
 					t = POINT_OVERFLOW;
@@ -7,6 +7,7 @@ using System.IO;
 using System.Reflection;
 using System.Runtime.InteropServices;
 using System.Threading;
+using CodeImp.DoomBuilder.Config;
 
 #endregion
 
@@ -49,6 +50,12 @@ namespace CodeImp.DoomBuilder.Plugins.VisplaneExplorer
 		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
 		private static extern void VPO_OpenDoorSectors(IntPtr handle, int dir);
 
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		private static extern int VPO_SetLimits(IntPtr handle, int profile);
+
+		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
+		private static extern void VPO_SetThresholds(IntPtr handle, int visplanes, int drawsegs, int openings, int solidsegs);
+
 		[DllImport("BuilderNative", CallingConvention = CallingConvention.Cdecl)]
 		private static extern int VPO_TestSpot(IntPtr handle, int x, int y, int dz, int angle, ref int visplanes, ref int drawsegs, ref int openings, ref int solidsegs);
 
@@ -98,6 +105,7 @@ namespace CodeImp.DoomBuilder.Plugins.VisplaneExplorer
 		private void ProcessingThread()
 		{
 			IntPtr context = VPO_NewContext();
+			if(VPO_SetLimits(context, (int)BuilderPlug.InterfaceForm.LimitProfile) != 0) throw new Exception("VPO is unable to use these limits:" + (VPO_GetError(context) ?? "<unknown error>"));
 
 			// Load the map
 			bool isHexen = General.Map.HEXEN;
@@ -105,6 +113,13 @@ namespace CodeImp.DoomBuilder.Plugins.VisplaneExplorer
 			if(VPO_OpenMap(context, mapname, ref isHexen) != 0) throw new Exception("VPO is unable to open this map:" + (VPO_GetError(context) ?? "<unknown error>"));
 			VPO_OpenDoorSectors(context, BuilderPlug.InterfaceForm.OpenDoors ? 1 : -1); //mxd
 
+			// Stop rendering a spot as soon as it goes over one of the game's static limits
+			if(BuilderPlug.InterfaceForm.StopAtLimits)
+			{
+				StaticLimits limits = General.Map.Config.StaticLimits;
+				VPO_SetThresholds(context, (int)limits.Visplanes, (int)limits.Drawsegs, (int)limits.Openings, (int)limits.Solidsegs);
+			}
+
 			// Processing
 			Queue<TilePoint> todo = new Queue<TilePoint>(POINTS_PER_ITERATION);
 			Queue<PointData> done = new Queue<PointData>(POINTS_PER_ITERATION);
@@ -141,6 +156,9 @@ namespace CodeImp.DoomBuilder.Plugins.VisplaneExplorer
 					{
 						pd.result = (PointResult)VPO_TestSpot(context, p.x, p.y, BuilderPlug.InterfaceForm.ViewHeight, TEST_ANGLES[i],
 							ref pd.visplanes, ref pd.drawsegs, ref pd.openings, ref pd.solidsegs);
+
+						// Already over a limit, the other angles can't change that
+						if(pd.result == PointResult.OverThreshold) break;
 					}
 
 					done.Enqueue(pd);
@@ -358,25 +358,42 @@ namespace CodeImp.DoomBuilder.Plugins.VisplaneExplorer
 			Point lt = TileForPoint(mapbounds.Left - Tile.TILE_SIZE, mapbounds.Top - Tile.TILE_SIZE);
 			Point rb = TileForPoint(mapbounds.Right + Tile.TILE_SIZE, mapbounds.Bottom + Tile.TILE_SIZE);
 			Rectangle tilesrect = new Rectangle(lt.X, lt.Y, rb.X - lt.X, rb.Y - lt.Y);
-			NearestLineBlockmap blockmap = new NearestLineBlockmap(tilesrect);
+			List<Point> tilepoints = new List<Point>();
+			List<Vector2D> centers = new List<Vector2D>();
 			for(int x = tilesrect.X; x <= tilesrect.Right; x += Tile.TILE_SIZE)
 			{
 				for(int y = tilesrect.Y; y <= tilesrect.Bottom; y += Tile.TILE_SIZE)
 				{
-					// If the tile is obviously outside the map, don't create it
-					Vector2D pc = new Vector2D(x + (Tile.TILE_SIZE >> 1), y + (Tile.TILE_SIZE >> 1));
-					Linedef ld = MapSet.NearestLinedef(blockmap.GetBlockAt(pc).Lines, pc);
-					double distancesq = ld.DistanceToSq(pc, true);
-					if(distancesq > (Tile.TILE_SIZE * Tile.TILE_SIZE))
-					{
-						double side = ld.SideOfLine(pc);
-						if((side > 0.0f) && (ld.Back == null))
-							continue;
-					}
+					tilepoints.Add(new Point(x, y));
+					centers.Add(new Vector2D(x + (Tile.TILE_SIZE >> 1), y + (Tile.TILE_SIZE >> 1)));
+				}
+			}
+
+			// Find the nearest single-sided linedef for all tile centers at once
+			List<Linedef> singlesided = new List<Linedef>(General.Map.Map.Linedefs.Count);
+			foreach(Linedef ld in General.Map.Map.Linedefs)
+				if(ld.Back == null) singlesided.Add(ld);
 
-					Point tp = new Point(x, y);
-					tiles.Add(tp, new Tile(tp));
+			Linedef[] nearest;
+			using(SpatialIndex index = new SpatialIndex())
+			{
+				index.SetLinedefs(singlesided);
+				nearest = index.NearestLinedefs(centers.ToArray(), -1.0);
+			}
+
+			for(int i = 0; i < tilepoints.Count; i++)
+			{
+				// If the tile is obviously outside the map, don't create it
+				Vector2D pc = centers[i];
+				Linedef ld = nearest[i];
+				if(ld != null && ld.DistanceToSq(pc, true) > (Tile.TILE_SIZE * Tile.TILE_SIZE))
+				{
+					double side = ld.SideOfLine(pc);
+					if((side > 0.0f) && (ld.Back == null))
+						continue;
 				}
+
+				tiles.Add(tilepoints[i], new Tile(tilepoints[i]));
 			}
 		}
 
@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2026 Ultimate Doom Builder contributors
+ * This program is released under GNU General Public License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+// Compresses incompressible and adversarial data with the snapshot codec and checks that
+// nothing is written past SnapshotCompressBound or past a smaller buffer, and that all of
+// it decompresses to the original. Exits with 1 when a check fails.
+
+#include "Precomp.h"
+#include "Backend.h"
+#include "SnapshotCodec.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	std::string LastError;
+
+	// Guard bytes after the output buffer, which must stay untouched
+	const size_t GuardSize = 64;
+	const uint8_t GuardValue = 0xcd;
+
+	int Failures = 0;
+
+	class Random
+	{
+	public:
+		Random(uint32_t seed) : mState(seed ? seed : 1) { }
+
+		uint8_t NextByte()
+		{
+			mState ^= mState << 13;
+			mState ^= mState >> 17;
+			mState ^= mState << 5;
+			return (uint8_t)(mState >> 11);
+		}
+
+	private:
+		uint32_t mState;
+	};
+
+	std::vector<uint8_t> RandomBytes(size_t size, uint32_t seed)
+	{
+		Random random(seed);
+		std::vector<uint8_t> data(size);
+		for (uint8_t& v : data)
+			v = random.NextByte();
+		return data;
+	}
+
+	// Runs of random literals, each followed by a copy of the first bytes of the previous run.
+	// The copies are just long enough to be found, with distances that need two byte varints.
+	std::vector<uint8_t> ShortMatches(size_t size, size_t literalcount, size_t matchlength, uint32_t seed)
+	{
+		Random random(seed);
+		std::vector<uint8_t> data;
+		data.reserve(size);
+		while (data.size() < size)
+		{
+			size_t runstart = data.size();
+			for (size_t i = 0; i < literalcount; i++)
+				data.push_back(random.NextByte());
+			for (size_t i = 0; i < matchlength && runstart >= literalcount + matchlength; i++)
+				data.push_back(data[runstart - literalcount - matchlength + i]);
+		}
+		data.resize(size);
+		return data;
+	}
+
+	void Check(const char* name, const std::vector<uint8_t>& data, const std::vector<uint8_t>& reference, size_t capacity)
+	{
+		std::vector<uint8_t> packed(capacity + GuardSize, GuardValue);
+		size_t written = SnapshotCompress(data.data(), data.size(), reference.data(), reference.size(), packed.data(), capacity);
+
+		bool ok = true;
+		for (size_t i = capacity; i < packed.size(); i++)
+		{
+			if (packed[i] != GuardValue)
+			{
+				printf("FAIL %s: wrote past the %d byte buffer\n", name, (int)capacity);
+				ok = false;
+				break;
+			}
+		}
+
+		if (written == 0)
+		{
+			// Only allowed when not even the data stored as literals fits
+			if (capacity >= SnapshotCompressBound(data.size()))
+			{
+				printf("FAIL %s: compression failed with a %d byte buffer\n", name, (int)capacity);
+				ok = false;
+			}
+		}
+		else if (written > capacity)
+		{
+			printf("FAIL %s: returned %d bytes for a %d byte buffer\n", name, (int)written, (int)capacity);
+			ok = false;
+		}
+		else
+		{
+			std::vector<uint8_t> output(data.size());
+			if (!SnapshotDecompress(packed.data(), written, reference.data(), reference.size(), output.data(), output.size()))
+			{
+				printf("FAIL %s: %s\n", name, LastError.c_str());
+				ok = false;
+			}
+			else if (output != data)
+			{
+				printf("FAIL %s: decompressed data differs\n", name);
+				ok = false;
+			}
+		}
+
+		if (ok)
+			printf("ok   %s: %d -> %d bytes (bound %d, buffer %d)\n", name, (int)data.size(), (int)written, (int)SnapshotCompressBound(data.size()), (int)capacity);
+		else
+			Failures++;
+	}
+
+	void CheckAllCapacities(const char* name, const std::vector<uint8_t>& data, const std::vector<uint8_t>& reference)
+	{
+		size_t bound = SnapshotCompressBound(data.size());
+		Check(name, data, reference, bound);
+		Check(name, data, reference, bound - 1);
+		Check(name, data, reference, data.size() / 2);
+		Check(name, data, reference, 0);
+	}
+}
+
+void SetError(const char* fmt, ...)
+{
+	char buffer[1024];
+	va_list args;
+	va_start(args, fmt);
+	vsnprintf(buffer, sizeof(buffer), fmt, args);
+	va_end(args);
+	LastError = buffer;
+}
+
+const char* GetError()
+{
+	return LastError.c_str();
+}
+
+int main()
+{
+	std::vector<uint8_t> none;
+
+	for (size_t size : { 0, 1, 14, 15, 143, 144, 16383, 16384, 1 << 20 })
+	{
+		char name[64];
+		snprintf(name, sizeof(name), "random %d", (int)size);
+		CheckAllCapacities(name, RandomBytes(size, (uint32_t)size + 1), none);
+	}
+
+	for (size_t literalcount : { 14, 15, 142, 143, 144, 200, 16382, 16383 })
+	{
+		for (size_t matchlength : { 4, 5, 18, 19 })
+		{
+			char name[64];
+			snprintf(name, sizeof(name), "short matches %d/%d", (int)literalcount, (int)matchlength);
+			CheckAllCapacities(name, ShortMatches(1 << 20, literalcount, matchlength, (uint32_t)(literalcount * 31 + matchlength)), none);
+		}
+	}
+
+	// Against a reference, where the distances into it are the longest varints
+	std::vector<uint8_t> reference = RandomBytes(1 << 20, 7);
+	std::vector<uint8_t> changed = reference;
+	Random random(9);
+	for (size_t i = 0; i < changed.size(); i += 150)
+		changed[i] = random.NextByte();
+	CheckAllCapacities("reference, sparse changes", changed, reference);
+	CheckAllCapacities("reference, unrelated data", RandomBytes(1 << 20, 11), reference);
+	CheckAllCapacities("reference, short matches", ShortMatches(1 << 20, 143, 4, 13), reference);
+
+	if (Failures != 0)
+	{
+		printf("%d checks failed\n", Failures);
+		return 1;
+	}
+	printf("All checks passed\n");
+	return 0;
+}
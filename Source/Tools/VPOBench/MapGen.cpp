@@ -0,0 +1,348 @@
+/*
+ * Copyright (c) 2026 Ultimate Doom Builder contributors
+ * This program is released under GNU General Public License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include "MapGen.h"
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+namespace
+{
+	// Same sequence on every platform, so the baselines checksums stay valid
+	class Random
+	{
+	public:
+		Random(uint32_t seed) : mState(seed ? seed : 1) { }
+
+		int Next(int count)
+		{
+			mState ^= mState << 13;
+			mState ^= mState >> 17;
+			mState ^= mState << 5;
+			return (int)(mState % (uint32_t)count);
+		}
+
+	private:
+		uint32_t mState;
+	};
+
+	std::vector<int> EvenEdges(int first, int cellsize, int count)
+	{
+		std::vector<int> edges;
+		for (int i = 0; i <= count; i++)
+			edges.push_back(first + i * cellsize);
+		return edges;
+	}
+}
+
+MapBuilder::MapBuilder(std::vector<int> xs, std::vector<int> ys) : mXs(std::move(xs)), mYs(std::move(ys))
+{
+	mCellSectors.resize(Width() * Height(), 0);
+}
+
+int MapBuilder::AddSector(int floorheight, int ceilingheight, int lightlevel)
+{
+	Sector sector = {};
+	sector.FloorHeight = (int16_t)floorheight;
+	sector.CeilingHeight = (int16_t)ceilingheight;
+	sector.LightLevel = (int16_t)lightlevel;
+	SetName(sector.FloorPic, "FLOOR4_8");
+	SetName(sector.CeilingPic, "CEIL3_5");
+	mSectors.push_back(sector);
+	return (int)mSectors.size() - 1;
+}
+
+void MapBuilder::FillSector(int sector)
+{
+	for (int& cell : mCellSectors)
+		cell = sector;
+}
+
+void MapBuilder::SetName(char* dest, const char* name)
+{
+	// Lump names are not NUL terminated when they use all 8 characters
+	memset(dest, 0, 8);
+	memcpy(dest, name, std::min(strlen(name), (size_t)8));
+}
+
+int MapBuilder::AddSidedef(int sector, bool twosided)
+{
+	Sidedef side = {};
+	SetName(side.Upper, twosided ? "BROWN1" : "-");
+	SetName(side.Lower, twosided ? "BROWN1" : "-");
+	SetName(side.Middle, twosided ? "-" : "STARTAN2");
+	side.Sector = (int16_t)sector;
+	mSidedefs.push_back(side);
+	return (int)mSidedefs.size() - 1;
+}
+
+// The front cell is on the right side of v1 -> v2. backcell is -1 for the outer walls.
+void MapBuilder::AddLine(int v1, int v2, int frontcell, int backcell, int angle)
+{
+	Linedef line = {};
+	line.V1 = (int16_t)v1;
+	line.V2 = (int16_t)v2;
+	line.Flags = backcell >= 0 ? 4 : 1; // two-sided or impassable
+	line.Sides[0] = (int16_t)AddSidedef(mCellSectors[frontcell], backcell >= 0);
+	line.Sides[1] = backcell >= 0 ? (int16_t)AddSidedef(mCellSectors[backcell], true) : -1;
+	mLinedefs.push_back(line);
+
+	Seg seg = {};
+	seg.V1 = (int16_t)v1;
+	seg.V2 = (int16_t)v2;
+	seg.Angle = (int16_t)angle;
+	seg.Linedef = (int16_t)(mLinedefs.size() - 1);
+	mCellSegs[frontcell].push_back(seg);
+
+	if (backcell >= 0)
+	{
+		std::swap(seg.V1, seg.V2);
+		seg.Angle = (int16_t)(angle + 0x8000);
+		seg.Side = 1;
+		mCellSegs[backcell].push_back(seg);
+	}
+}
+
+void MapBuilder::SetBBox(int16_t* bbox, int x1, int y1, int x2, int y2) const
+{
+	bbox[0] = (int16_t)mYs[y2]; // top
+	bbox[1] = (int16_t)mYs[y1]; // bottom
+	bbox[2] = (int16_t)mXs[x1]; // left
+	bbox[3] = (int16_t)mXs[x2]; // right
+}
+
+uint16_t MapBuilder::BuildNodes(int x1, int y1, int x2, int y2)
+{
+	if (x2 - x1 == 1 && y2 - y1 == 1)
+	{
+		std::vector<Seg>& cellsegs = mCellSegs[CellIndex(x1, y1)];
+		Subsector subsector = { (int16_t)cellsegs.size(), (int16_t)mSegs.size() };
+		mSegs.insert(mSegs.end(), cellsegs.begin(), cellsegs.end());
+		mSubsectors.push_back(subsector);
+		return (uint16_t)(0x8000 | (mSubsectors.size() - 1));
+	}
+
+	// Split the longer side in half. The right child is on the right of the partition line.
+	Node node = {};
+	bool splitx = (y2 - y1 == 1) || (x2 - x1 > 1 && mXs[x2] - mXs[x1] >= mYs[y2] - mYs[y1]);
+	if (splitx)
+	{
+		int xm = (x1 + x2) / 2;
+		node.Children[0] = BuildNodes(xm, y1, x2, y2);
+		node.Children[1] = BuildNodes(x1, y1, xm, y2);
+		node.X = (int16_t)mXs[xm];
+		node.Y = (int16_t)mYs[y1];
+		node.DY = (int16_t)(mYs[y2] - mYs[y1]);
+		SetBBox(node.BBox[0], xm, y1, x2, y2);
+		SetBBox(node.BBox[1], x1, y1, xm, y2);
+	}
+	else
+	{
+		int ym = (y1 + y2) / 2;
+		node.Children[0] = BuildNodes(x1, y1, x2, ym);
+		node.Children[1] = BuildNodes(x1, ym, x2, y2);
+		node.X = (int16_t)mXs[x1];
+		node.Y = (int16_t)mYs[ym];
+		node.DX = (int16_t)(mXs[x2] - mXs[x1]);
+		SetBBox(node.BBox[0], x1, y1, x2, ym);
+		SetBBox(node.BBox[1], x1, ym, x2, y2);
+	}
+	mNodes.push_back(node);
+	return (uint16_t)(mNodes.size() - 1);
+}
+
+void MapBuilder::BuildMap()
+{
+	int w = Width();
+	int h = Height();
+
+	mVertices.clear();
+	mLinedefs.clear();
+	mSidedefs.clear();
+	mSegs.clear();
+	mSubsectors.clear();
+	mNodes.clear();
+	mCellSegs.assign(w * h, {});
+
+	for (int y = 0; y <= h; y++)
+	{
+		for (int x = 0; x <= w; x++)
+			mVertices.push_back({ (int16_t)mXs[x], (int16_t)mYs[y] });
+	}
+
+	// Vertical edges, facing west (angle 0x4000 points north)
+	for (int y = 0; y < h; y++)
+	{
+		AddLine(VertexIndex(0, y), VertexIndex(0, y + 1), CellIndex(0, y), -1, 0x4000);
+		for (int x = 1; x < w; x++)
+			AddLine(VertexIndex(x, y), VertexIndex(x, y + 1), CellIndex(x, y), CellIndex(x - 1, y), 0x4000);
+		AddLine(VertexIndex(w, y + 1), VertexIndex(w, y), CellIndex(w - 1, y), -1, 0xc000);
+	}
+
+	// Horizontal edges
+	for (int x = 0; x < w; x++)
+	{
+		AddLine(VertexIndex(x + 1, 0), VertexIndex(x, 0), CellIndex(x, 0), -1, 0x8000);
+		for (int y = 1; y < h; y++)
+			AddLine(VertexIndex(x, y), VertexIndex(x + 1, y), CellIndex(x, y - 1), CellIndex(x, y), 0);
+		AddLine(VertexIndex(x, h), VertexIndex(x + 1, h), CellIndex(x, h - 1), -1, 0);
+	}
+
+	if (w * h == 1)
+	{
+		// A map needs at least one node
+		Node node = {};
+		node.X = (int16_t)mXs[0];
+		node.Y = (int16_t)mYs[0];
+		node.DY = (int16_t)(mYs[1] - mYs[0]);
+		SetBBox(node.BBox[0], 0, 0, 1, 1);
+		SetBBox(node.BBox[1], 0, 0, 1, 1);
+		node.Children[0] = BuildNodes(0, 0, 1, 1);
+		node.Children[1] = node.Children[0];
+		mNodes.push_back(node);
+	}
+	else
+	{
+		BuildNodes(0, 0, w, h);
+	}
+}
+
+bool MapBuilder::Save(const std::string& filename, std::string& error)
+{
+	if (Width() < 1 || Height() < 1 || mSectors.empty())
+	{
+		error = "Map has no cells or sectors";
+		return false;
+	}
+
+	BuildMap();
+
+	if (mSubsectors.size() > 0x7fff || mLinedefs.size() > 0x7fff || mSidedefs.size() > 0x7fff)
+	{
+		error = "Map is too large for the Doom map format";
+		return false;
+	}
+
+	// Player 1 start in the first cell
+	std::vector<Thing> things = { { (int16_t)(mXs[0] + 16), (int16_t)(mYs[0] + 16), 0, 1, 7 } };
+
+	std::vector<std::pair<const char*, std::string>> lumps =
+	{
+		{ "MAP01", std::string() },
+		{ "THINGS", ToLump(things) },
+		{ "LINEDEFS", ToLump(mLinedefs) },
+		{ "SIDEDEFS", ToLump(mSidedefs) },
+		{ "VERTEXES", ToLump(mVertices) },
+		{ "SEGS", ToLump(mSegs) },
+		{ "SSECTORS", ToLump(mSubsectors) },
+		{ "NODES", ToLump(mNodes) },
+		{ "SECTORS", ToLump(mSectors) },
+		{ "REJECT", std::string() },
+		{ "BLOCKMAP", std::string() }
+	};
+
+	FILE* file = fopen(filename.c_str(), "wb");
+	if (!file)
+	{
+		error = "Could not create " + filename;
+		return false;
+	}
+
+	int32_t header[3];
+	memcpy(header, "PWAD", 4);
+	header[1] = (int32_t)lumps.size();
+	header[2] = 12;
+	for (const auto& lump : lumps)
+		header[2] += (int32_t)lump.second.size();
+	bool ok = fwrite(header, sizeof(header), 1, file) == 1;
+
+	for (const auto& lump : lumps)
+		ok = ok && fwrite(lump.second.data(), 1, lump.second.size(), file) == lump.second.size();
+
+	int32_t offset = 12;
+	for (const auto& lump : lumps)
+	{
+		struct { int32_t Offset, Size; char Name[8]; } entry;
+		entry.Offset = offset;
+		entry.Size = (int32_t)lump.second.size();
+		SetName(entry.Name, lump.first);
+		ok = ok && fwrite(&entry, sizeof(entry), 1, file) == 1;
+		offset += entry.Size;
+	}
+
+	if (fclose(file) != 0 || !ok)
+	{
+		error = "Could not write " + filename;
+		return false;
+	}
+	return true;
+}
+
+// 32x32 rooms of 128 units, each with its own floor, ceiling and light
+bool GenerateGridMap(const std::string& filename, std::string& error)
+{
+	Random random(3);
+	MapBuilder builder(EvenEdges(-2048, 128, 32), EvenEdges(-2048, 128, 32));
+	for (int y = 0; y < builder.Height(); y++)
+	{
+		for (int x = 0; x < builder.Width(); x++)
+			builder.SetCellSector(x, y, builder.AddSector(random.Next(8) * 8, 128 + random.Next(8) * 16, 96 + random.Next(10) * 16));
+	}
+	return builder.Save(filename, error);
+}
+
+// A large open floor scattered with steps of other heights and lights, and some solid pillars
+bool GenerateArenaMap(const std::string& filename, std::string& error)
+{
+	Random random(5);
+	MapBuilder builder(EvenEdges(-3840, 192, 40), EvenEdges(-3840, 192, 40));
+	builder.FillSector(builder.AddSector(0, 512, 160));
+	for (int y = 1; y < builder.Height() - 1; y++)
+	{
+		for (int x = 1; x < builder.Width() - 1; x++)
+		{
+			int kind = random.Next(20);
+			if (kind < 2)
+				builder.SetCellSector(x, y, builder.AddSector(0, 0, 160));
+			else if (kind < 5)
+				builder.SetCellSector(x, y, builder.AddSector(8 + random.Next(6) * 8, 512 - random.Next(4) * 32, 128 + random.Next(6) * 16));
+		}
+	}
+	return builder.Save(filename, error);
+}
+
+// 300 columns two to four units wide, the worst case for visplane splitting
+bool GenerateSliverMap(const std::string& filename, std::string& error)
+{
+	Random random(4);
+	std::vector<int> xs = { 0 };
+	for (int i = 0; i < 300; i++)
+		xs.push_back(xs.back() + 2 + random.Next(3));
+
+	MapBuilder builder(xs, EvenEdges(0, 400, 6));
+	for (int y = 0; y < builder.Height(); y++)
+	{
+		for (int x = 0; x < builder.Width(); x++)
+		{
+			int c = y * builder.Width() + x;
+			builder.SetCellSector(x, y, builder.AddSector((c & 1) * 8, 200 - (c % 3) * 8, 128 + (c % 5) * 16));
+		}
+	}
+	return builder.Save(filename, error);
+}
+
+// One huge sector, every seg inside it is an empty two-sided line and only the outer walls are solid
+bool GenerateRoomMap(const std::string& filename, std::string& error)
+{
+	MapBuilder builder(EvenEdges(-3840, 160, 48), EvenEdges(-3840, 160, 48));
+	builder.FillSector(builder.AddSector(0, 256, 192));
+	return builder.Save(filename, error);
+}
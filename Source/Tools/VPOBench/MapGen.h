@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2026 Ultimate Doom Builder contributors
+ * This program is released under GNU General Public License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Builds a Doom format map out of a rectangular grid of cells. Every cell is one
+// subsector, cells of different sectors are joined by two-sided lines and the
+// outside of the grid is closed with single-sided walls. Nodes split the grid in
+// halves, so the map needs no external nodebuilder.
+class MapBuilder
+{
+public:
+	// xs and ys are the cell edges, in increasing order
+	MapBuilder(std::vector<int> xs, std::vector<int> ys);
+
+	int AddSector(int floorheight, int ceilingheight, int lightlevel);
+	void SetCellSector(int x, int y, int sector) { mCellSectors[y * Width() + x] = sector; }
+	void FillSector(int sector);
+
+	int Width() const { return (int)mXs.size() - 1; }
+	int Height() const { return (int)mYs.size() - 1; }
+
+	// Writes the map as MAP01 of a new PWAD
+	bool Save(const std::string& filename, std::string& error);
+
+private:
+#pragma pack(push, 1)
+	struct Vertex { int16_t X, Y; };
+	struct Linedef { int16_t V1, V2, Flags, Special, Tag, Sides[2]; };
+	struct Sidedef { int16_t XOffset, YOffset; char Upper[8], Lower[8], Middle[8]; int16_t Sector; };
+	struct Sector { int16_t FloorHeight, CeilingHeight; char FloorPic[8], CeilingPic[8]; int16_t LightLevel, Special, Tag; };
+	struct Seg { int16_t V1, V2, Angle, Linedef, Side, Offset; };
+	struct Subsector { int16_t NumSegs, FirstSeg; };
+	struct Node { int16_t X, Y, DX, DY, BBox[2][4]; uint16_t Children[2]; };
+	struct Thing { int16_t X, Y, Angle, Type, Flags; };
+#pragma pack(pop)
+
+	int VertexIndex(int x, int y) const { return y * (int)mXs.size() + x; }
+	int CellIndex(int x, int y) const { return y * Width() + x; }
+
+	int AddSidedef(int sector, bool twosided);
+	void AddLine(int v1, int v2, int frontcell, int backcell, int angle);
+	void SetBBox(int16_t* bbox, int x1, int y1, int x2, int y2) const;
+	uint16_t BuildNodes(int x1, int y1, int x2, int y2);
+	void BuildMap();
+
+	template<typename T>
+	static std::string ToLump(const std::vector<T>& items) { return std::string((const char*)items.data(), items.size() * sizeof(T)); }
+	static void SetName(char* dest, const char* name);
+
+	std::vector<int> mXs, mYs;
+	std::vector<int> mCellSectors;
+	std::vector<std::vector<Seg>> mCellSegs;
+
+	std::vector<Vertex> mVertices;
+	std::vector<Linedef> mLinedefs;
+	std::vector<Sidedef> mSidedefs;
+	std::vector<Sector> mSectors;
+	std::vector<Seg> mSegs;
+	std::vector<Subsector> mSubsectors;
+	std::vector<Node> mNodes;
+};
+
+// The synthetic maps of the benchmark. Each returns false and sets error on failure.
+bool GenerateGridMap(const std::string& filename, std::string& error);
+bool GenerateArenaMap(const std::string& filename, std::string& error);
+bool GenerateSliverMap(const std::string& filename, std::string& error);
+bool GenerateRoomMap(const std::string& filename, std::string& error);
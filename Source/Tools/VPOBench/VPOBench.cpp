@@ -0,0 +1,629 @@
+/*
+ * Copyright (c) 2026 Ultimate Doom Builder contributors
+ * This program is released under GNU General Public License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+// Benchmarks the Visplane Explorer core on synthetic maps and on any wad given on
+// the command line: map loading, VPO_TestSpot throughput for each thread count and
+// the bare R_RenderView (BSP traversal) cost. Results can be written as CSV and
+// compared against a baselines file. The checksum column covers the counts of every
+// spot, so a change to the renderer that alters results shows up as a mismatch.
+
+#include "Precomp.h"
+#include "vpo_local.h"
+#include "vpo_api.h"
+#include "MapGen.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// Same angles as the VPOManager of the Visplane Explorer plugin
+	const int TestAngles[] = { 0, 90, 180, 270, 45, 135, 225, 315 };
+	const int NumTestAngles = (int)(sizeof(TestAngles) / sizeof(TestAngles[0]));
+	const int ViewHeight = 41;
+	const int SpotsPerChunk = 100;
+
+	struct Options
+	{
+		std::vector<std::string> Synthetic = { "grid", "arena", "sliver", "room" };
+		std::vector<std::string> Wads;
+		std::vector<int> Threads;
+		int Spots = 1000;
+		int Loads = 5;
+		int Profile = VPO_LIMITS_DEFAULT;
+		double Tolerance = 10.0;
+		std::string CsvFile;
+		std::string BaselineFile;
+		std::string WorkDir = ".";
+	};
+
+	struct MapSource
+	{
+		std::string Name;
+		std::string Filename;
+		std::string MapName;
+	};
+
+	struct Spot
+	{
+		int X, Y;
+	};
+
+	struct SpotResult
+	{
+		int Result;
+		int Visplanes, Drawsegs, Openings, Solidsegs;
+	};
+
+	struct Row
+	{
+		std::string Map;
+		std::string Test;
+		int Threads = 1;
+		int64_t Points = 0;
+		double Milliseconds = 0.0;
+		double LoadMilliseconds = 0.0;
+		int64_t LevelBytes = 0;
+		int64_t ContextBytes = 0;
+		uint64_t Checksum = 0;
+
+		double PointsPerSecond() const { return Milliseconds > 0.0 ? Points * 1000.0 / Milliseconds : 0.0; }
+	};
+
+	double ElapsedMs(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	uint64_t HashValue(uint64_t hash, int value)
+	{
+		// FNV-1a over the four bytes of the value
+		for (int i = 0; i < 4; i++)
+		{
+			hash ^= (uint64_t)((value >> (i * 8)) & 0xff);
+			hash *= 0x100000001b3ULL;
+		}
+		return hash;
+	}
+
+	// A context with the map open, or null with the error in error
+	VPOContext OpenMap(const MapSource& source, int profile, std::string& error)
+	{
+		VPOContext context = VPO_NewContext();
+		bool ishexen = false;
+		if (VPO_SetLimits(context, profile) != 0 || VPO_LoadWAD(context, source.Filename.c_str()) != 0 || VPO_OpenMap(context, source.MapName.c_str(), &ishexen) != 0)
+		{
+			error = VPO_GetError(context);
+			VPO_FreeWAD(context);
+			VPO_DeleteContext(context);
+			return nullptr;
+		}
+		return context;
+	}
+
+	void CloseMap(VPOContext context)
+	{
+		VPO_CloseMap(context);
+		VPO_FreeWAD(context);
+		VPO_DeleteContext(context);
+	}
+
+	// Memory held by P_SetupLevel for the open map
+	int64_t GetLevelBytes(const vpo::Context* context)
+	{
+		int64_t bytes = 0;
+		bytes += (int64_t)context->numvertexes * sizeof(vpo::vertex_t);
+		bytes += (int64_t)context->numsegs * sizeof(vpo::seg_t);
+		bytes += (int64_t)context->numsectors * sizeof(vpo::sector_t);
+		bytes += (int64_t)context->numsubsectors * sizeof(vpo::subsector_t);
+		bytes += (int64_t)context->numnodes * sizeof(vpo::node_t);
+		bytes += (int64_t)context->numlines * sizeof(vpo::line_t);
+		bytes += (int64_t)context->numsides * sizeof(vpo::side_t);
+		for (int i = 0; i < context->numsectors; i++)
+			bytes += (int64_t)context->sectors[i].linecount * sizeof(vpo::line_t*);
+		return bytes;
+	}
+
+	int64_t GetContextBytes(const vpo::Context* context)
+	{
+		return (int64_t)sizeof(vpo::Context) + (int64_t)context->scratch.capacity();
+	}
+
+	// Spots on an even grid over the map bounds, about count of them
+	std::vector<Spot> MakeSpots(VPOContext context, int count)
+	{
+		int x1, y1, x2, y2;
+		VPO_GetBBox(context, &x1, &y1, &x2, &y2);
+
+		double area = std::max(1.0, (double)(x2 - x1) * (double)(y2 - y1));
+		int step = std::max(1, (int)std::sqrt(area / std::max(count, 1)));
+
+		std::vector<Spot> spots;
+		for (int y = y1 + step / 2; y < y2; y += step)
+		{
+			for (int x = x1 + step / 2; x < x2; x += step)
+				spots.push_back({ x, y });
+		}
+		return spots;
+	}
+
+	bool BenchLoad(const MapSource& source, const Options& options, Row& row, std::string& error)
+	{
+		std::vector<double> times;
+		for (int i = 0; i < std::max(options.Loads, 1); i++)
+		{
+			Clock::time_point start = Clock::now();
+			VPOContext context = OpenMap(source, options.Profile, error);
+			if (!context)
+				return false;
+			times.push_back(ElapsedMs(start));
+
+			row.LevelBytes = GetLevelBytes((vpo::Context*)context);
+			row.ContextBytes = GetContextBytes((vpo::Context*)context);
+			CloseMap(context);
+		}
+
+		std::sort(times.begin(), times.end());
+		row.Map = source.Name;
+		row.Test = "load";
+		row.Points = (int64_t)times.size();
+		row.Milliseconds = times[times.size() / 2];
+		row.LoadMilliseconds = row.Milliseconds;
+		return true;
+	}
+
+	// Every thread opens its own context, like the plugin does, and takes chunks of spots until none are left
+	bool BenchTestSpot(const MapSource& source, const Options& options, const std::vector<Spot>& spots, int threadcount, Row& row, std::string& error)
+	{
+		std::vector<VPOContext> contexts;
+		for (int i = 0; i < threadcount; i++)
+		{
+			VPOContext context = OpenMap(source, options.Profile, error);
+			if (!context)
+			{
+				for (VPOContext c : contexts)
+					CloseMap(c);
+				return false;
+			}
+			contexts.push_back(context);
+		}
+
+		std::vector<SpotResult> results(spots.size());
+		std::atomic<size_t> nextspot(0);
+
+		auto worker = [&](VPOContext context)
+		{
+			while (true)
+			{
+				size_t first = nextspot.fetch_add(SpotsPerChunk);
+				if (first >= spots.size())
+					break;
+
+				size_t last = std::min(first + SpotsPerChunk, spots.size());
+				for (size_t i = first; i < last; i++)
+				{
+					SpotResult& result = results[i];
+					result = {};
+					for (int angle : TestAngles)
+						result.Result = VPO_TestSpot(context, spots[i].X, spots[i].Y, ViewHeight, angle, &result.Visplanes, &result.Drawsegs, &result.Openings, &result.Solidsegs);
+				}
+			}
+		};
+
+		Clock::time_point start = Clock::now();
+		std::vector<std::thread> threads;
+		for (int i = 1; i < threadcount; i++)
+			threads.push_back(std::thread(worker, contexts[i]));
+		worker(contexts[0]);
+		for (std::thread& thread : threads)
+			thread.join();
+		row.Milliseconds = ElapsedMs(start);
+
+		for (VPOContext context : contexts)
+			CloseMap(context);
+
+		row.Map = source.Name;
+		row.Test = "testspot";
+		row.Threads = threadcount;
+		row.Points = (int64_t)spots.size() * NumTestAngles;
+		row.Checksum = 0xcbf29ce484222325ULL;
+		for (const SpotResult& result : results)
+		{
+			row.Checksum = HashValue(row.Checksum, result.Result);
+			row.Checksum = HashValue(row.Checksum, result.Visplanes);
+			row.Checksum = HashValue(row.Checksum, result.Drawsegs);
+			row.Checksum = HashValue(row.Checksum, result.Openings);
+			row.Checksum = HashValue(row.Checksum, result.Solidsegs);
+		}
+		return true;
+	}
+
+	// R_RenderView alone, without the sector lookup and spot validation of VPO_TestSpot
+	bool BenchRenderView(const MapSource& source, const Options& options, const std::vector<Spot>& spots, Row& row, std::string& error)
+	{
+		VPOContext handle = OpenMap(source, options.Profile, error);
+		if (!handle)
+			return false;
+		vpo::Context* context = (vpo::Context*)handle;
+
+		struct View { vpo::fixed_t X, Y, Z; vpo::angle_t Angle; };
+		std::vector<View> views;
+		for (const Spot& spot : spots)
+		{
+			vpo::fixed_t x = (spot.X << FRACBITS) + FRACUNIT / 2;
+			vpo::fixed_t y = (spot.Y << FRACBITS) + FRACUNIT / 2;
+			vpo::sector_t* sector = context->X_SectorForPoint(x, y);
+			if (!sector)
+				continue;
+
+			vpo::fixed_t z = sector->floorheight + (ViewHeight << FRACBITS);
+			if (z >= sector->ceilingheight)
+				continue;
+
+			for (int angle : TestAngles)
+				views.push_back({ x, y, z, (vpo::angle_t)((int64_t)angle * 0x100000000LL / 360) });
+		}
+
+		uint64_t checksum = 0xcbf29ce484222325ULL;
+		Clock::time_point start = Clock::now();
+		for (const View& view : views)
+		{
+			context->R_RenderView(view.X, view.Y, view.Z, view.Angle);
+			checksum = HashValue(checksum, context->total_visplanes);
+		}
+		row.Milliseconds = ElapsedMs(start);
+
+		CloseMap(handle);
+
+		row.Map = source.Name;
+		row.Test = "renderview";
+		row.Points = (int64_t)views.size();
+		row.Checksum = checksum;
+		return true;
+	}
+
+	bool GenerateMap(const std::string& name, const Options& options, MapSource& source, std::string& error)
+	{
+		source.Name = name;
+		source.Filename = options.WorkDir + "/vpobench_" + name + ".wad";
+		source.MapName = "MAP01";
+
+		if (name == "grid")
+			return GenerateGridMap(source.Filename, error);
+		else if (name == "arena")
+			return GenerateArenaMap(source.Filename, error);
+		else if (name == "sliver")
+			return GenerateSliverMap(source.Filename, error);
+		else if (name == "room")
+			return GenerateRoomMap(source.Filename, error);
+
+		error = "Unknown synthetic map: " + name;
+		return false;
+	}
+
+	// file.wad or file.wad:MAPNAME, the first map of the wad by default
+	bool FindWadMap(const std::string& arg, MapSource& source, std::string& error)
+	{
+		size_t colon = arg.rfind(':');
+		if (colon != std::string::npos && colon > 1)
+		{
+			source.Filename = arg.substr(0, colon);
+			source.MapName = arg.substr(colon + 1);
+		}
+		else
+		{
+			source.Filename = arg;
+		}
+
+		if (source.MapName.empty())
+		{
+			VPOContext context = VPO_NewContext();
+			if (VPO_LoadWAD(context, source.Filename.c_str()) != 0)
+			{
+				error = VPO_GetError(context);
+				VPO_DeleteContext(context);
+				return false;
+			}
+			const char* name = VPO_GetMapName(context, 0);
+			if (name)
+				source.MapName = name;
+			VPO_FreeWAD(context);
+			VPO_DeleteContext(context);
+
+			if (source.MapName.empty())
+			{
+				error = "No maps in " + source.Filename;
+				return false;
+			}
+		}
+
+		size_t slash = source.Filename.find_last_of("/\\");
+		source.Name = (slash == std::string::npos ? source.Filename : source.Filename.substr(slash + 1)) + ":" + source.MapName;
+		return true;
+	}
+
+	std::vector<std::string> SplitList(const std::string& text)
+	{
+		std::vector<std::string> items;
+		size_t start = 0;
+		while (start <= text.size())
+		{
+			size_t end = text.find(',', start);
+			if (end == std::string::npos)
+				end = text.size();
+			if (end > start)
+				items.push_back(text.substr(start, end - start));
+			start = end + 1;
+		}
+		return items;
+	}
+
+	void PrintUsage()
+	{
+		printf("Usage: vpobench [options] [file.wad[:MAPNAME] ...]\n");
+		printf("\n");
+		printf("  --maps LIST        synthetic maps to run: grid,arena,sliver,room (default all, 'none' for none)\n");
+		printf("  --threads LIST     thread counts for the testspot benchmark (default 1 and all cores)\n");
+		printf("  --spots N          about N spots per map, each tested at %d angles (default 1000)\n", NumTestAngles);
+		printf("  --loads N          times each map is loaded, the median is reported (default 5)\n");
+		printf("  --profile N        VPO_SetLimits profile (default 0)\n");
+		printf("  --csv FILE         write the results as CSV\n");
+		printf("  --baseline FILE    compare against a CSV written earlier\n");
+		printf("  --tolerance PCT    slowdown reported as a regression (default 10)\n");
+		printf("  --workdir DIR      where the synthetic wads are written (default .)\n");
+	}
+
+	bool ParseArgs(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			bool hasvalue = i + 1 < argc;
+
+			if (arg == "-h" || arg == "--help")
+				return false;
+			else if (arg == "--maps" && hasvalue)
+			{
+				std::string value = argv[++i];
+				options.Synthetic = value == "none" ? std::vector<std::string>() : SplitList(value);
+			}
+			else if (arg == "--threads" && hasvalue)
+			{
+				options.Threads.clear();
+				for (const std::string& item : SplitList(argv[++i]))
+					options.Threads.push_back(std::max(atoi(item.c_str()), 1));
+			}
+			else if (arg == "--spots" && hasvalue)
+				options.Spots = atoi(argv[++i]);
+			else if (arg == "--loads" && hasvalue)
+				options.Loads = atoi(argv[++i]);
+			else if (arg == "--profile" && hasvalue)
+				options.Profile = atoi(argv[++i]);
+			else if (arg == "--csv" && hasvalue)
+				options.CsvFile = argv[++i];
+			else if (arg == "--baseline" && hasvalue)
+				options.BaselineFile = argv[++i];
+			else if (arg == "--tolerance" && hasvalue)
+				options.Tolerance = atof(argv[++i]);
+			else if (arg == "--workdir" && hasvalue)
+				options.WorkDir = argv[++i];
+			else if (arg.size() > 1 && arg[0] == '-')
+			{
+				fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+				return false;
+			}
+			else
+				options.Wads.push_back(arg);
+		}
+
+		if (options.Threads.empty())
+		{
+			int cores = std::max((int)std::thread::hardware_concurrency(), 1);
+			options.Threads.push_back(1);
+			if (cores > 1)
+				options.Threads.push_back(cores);
+		}
+		return true;
+	}
+
+	const char* CsvHeader = "map,test,threads,points,ms,points_per_sec,points_per_sec_per_thread,load_ms,level_bytes,context_bytes,checksum";
+
+	std::string FormatCsv(const Row& row)
+	{
+		char buffer[512];
+		snprintf(buffer, sizeof(buffer), "%s,%s,%d,%lld,%.2f,%.0f,%.0f,%.3f,%lld,%lld,%016llx",
+			row.Map.c_str(), row.Test.c_str(), row.Threads, (long long)row.Points, row.Milliseconds,
+			row.PointsPerSecond(), row.PointsPerSecond() / row.Threads, row.LoadMilliseconds,
+			(long long)row.LevelBytes, (long long)row.ContextBytes, (unsigned long long)row.Checksum);
+		return buffer;
+	}
+
+	bool WriteCsv(const std::string& filename, const std::vector<Row>& rows)
+	{
+		FILE* file = fopen(filename.c_str(), "w");
+		if (!file)
+			return false;
+		fprintf(file, "%s\n", CsvHeader);
+		for (const Row& row : rows)
+			fprintf(file, "%s\n", FormatCsv(row).c_str());
+		return fclose(file) == 0;
+	}
+
+	// Rows of a CSV written by WriteCsv. Lines starting with # are comments.
+	bool ReadCsv(const std::string& filename, std::vector<Row>& rows)
+	{
+		FILE* file = fopen(filename.c_str(), "r");
+		if (!file)
+			return false;
+
+		char line[1024];
+		while (fgets(line, sizeof(line), file))
+		{
+			if (line[0] == '#' || strncmp(line, "map,", 4) == 0)
+				continue;
+
+			std::vector<std::string> fields = SplitList(std::string(line, strcspn(line, "\r\n")));
+			if (fields.size() < 11)
+				continue;
+
+			Row row;
+			row.Map = fields[0];
+			row.Test = fields[1];
+			row.Threads = atoi(fields[2].c_str());
+			row.Points = atoll(fields[3].c_str());
+			row.Milliseconds = atof(fields[4].c_str());
+			row.LoadMilliseconds = atof(fields[7].c_str());
+			row.LevelBytes = atoll(fields[8].c_str());
+			row.ContextBytes = atoll(fields[9].c_str());
+			row.Checksum = strtoull(fields[10].c_str(), nullptr, 16);
+			rows.push_back(row);
+		}
+		fclose(file);
+		return true;
+	}
+
+	// Prints the change against the baseline for every row that has one. Returns false when results differ.
+	bool CompareBaseline(const std::vector<Row>& rows, const std::vector<Row>& baseline, double tolerance)
+	{
+		bool same = true;
+		printf("\n%-24s %-10s %7s %14s %14s %8s\n", "map", "test", "threads", "baseline/s", "now/s", "change");
+		for (const Row& row : rows)
+		{
+			for (const Row& base : baseline)
+			{
+				if (base.Map != row.Map || base.Test != row.Test || base.Threads != row.Threads)
+					continue;
+
+				double change = base.PointsPerSecond() > 0.0 ? (row.PointsPerSecond() / base.PointsPerSecond() - 1.0) * 100.0 : 0.0;
+				const char* note = "";
+				if (base.Checksum != row.Checksum && base.Points == row.Points)
+				{
+					note = "  RESULTS CHANGED";
+					same = false;
+				}
+				else if (change < -tolerance)
+				{
+					note = "  slower";
+				}
+
+				printf("%-24s %-10s %7d %14.0f %14.0f %+7.1f%%%s\n", row.Map.c_str(), row.Test.c_str(), row.Threads, base.PointsPerSecond(), row.PointsPerSecond(), change, note);
+				break;
+			}
+		}
+		return same;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseArgs(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	std::vector<MapSource> sources;
+	std::string error;
+	for (const std::string& name : options.Synthetic)
+	{
+		MapSource source;
+		if (!GenerateMap(name, options, source, error))
+		{
+			fprintf(stderr, "%s\n", error.c_str());
+			return 1;
+		}
+		sources.push_back(source);
+	}
+	for (const std::string& arg : options.Wads)
+	{
+		MapSource source;
+		if (!FindWadMap(arg, source, error))
+		{
+			fprintf(stderr, "%s: %s\n", arg.c_str(), error.c_str());
+			return 1;
+		}
+		sources.push_back(source);
+	}
+
+	std::vector<Row> rows;
+	printf("%-24s %-10s %7s %10s %12s %14s %12s %12s\n", "map", "test", "threads", "points", "ms", "points/s", "per thread", "memory");
+	for (const MapSource& source : sources)
+	{
+		Row load;
+		if (!BenchLoad(source, options, load, error))
+		{
+			fprintf(stderr, "%s: %s\n", source.Name.c_str(), error.c_str());
+			return 1;
+		}
+		printf("%-24s %-10s %7d %10lld %12.3f %14s %12s %11lldK\n", load.Map.c_str(), load.Test.c_str(), 1, (long long)load.Points, load.Milliseconds, "", "", (long long)((load.LevelBytes + 1023) / 1024));
+
+		VPOContext context = OpenMap(source, options.Profile, error);
+		std::vector<Spot> spots = MakeSpots(context, options.Spots);
+		CloseMap(context);
+
+		std::vector<Row> maprows;
+		for (int threads : options.Threads)
+		{
+			Row row;
+			if (!BenchTestSpot(source, options, spots, threads, row, error))
+			{
+				fprintf(stderr, "%s: %s\n", source.Name.c_str(), error.c_str());
+				return 1;
+			}
+			maprows.push_back(row);
+		}
+
+		Row render;
+		if (!BenchRenderView(source, options, spots, render, error))
+		{
+			fprintf(stderr, "%s: %s\n", source.Name.c_str(), error.c_str());
+			return 1;
+		}
+		maprows.push_back(render);
+
+		rows.push_back(load);
+		for (Row& row : maprows)
+		{
+			row.LoadMilliseconds = load.LoadMilliseconds;
+			row.LevelBytes = load.LevelBytes;
+			row.ContextBytes = load.ContextBytes;
+			printf("%-24s %-10s %7d %10lld %12.1f %14.0f %12.0f %11lldK\n", row.Map.c_str(), row.Test.c_str(), row.Threads, (long long)row.Points, row.Milliseconds, row.PointsPerSecond(), row.PointsPerSecond() / row.Threads, (long long)((row.ContextBytes + 1023) / 1024));
+			rows.push_back(row);
+		}
+	}
+
+	if (!options.CsvFile.empty() && !WriteCsv(options.CsvFile, rows))
+	{
+		fprintf(stderr, "Could not write %s\n", options.CsvFile.c_str());
+		return 1;
+	}
+
+	if (!options.BaselineFile.empty())
+	{
+		std::vector<Row> baseline;
+		if (!ReadCsv(options.BaselineFile, baseline))
+		{
+			fprintf(stderr, "Could not read %s\n", options.BaselineFile.c_str());
+			return 1;
+		}
+		if (!CompareBaseline(rows, baseline, options.Tolerance))
+			return 2;
+	}
+
+	return 0;
+}